@@ -0,0 +1,594 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmarks for performance critical parts of the engine
+ *
+ * Each benchmark is run repeatedly in batches, until a minimum amount of time
+ * has passed. The reported time per iteration is the median over all batches,
+ * which is less sensitive to outliers than the mean. Maps and entity
+ * populations are generated synthetically, so no game data is needed.
+ *
+ * Results are printed to the console, and can additionally be written as
+ * JSON (see --json), for comparing them across commits. When building with
+ * the ALLOCATION_TRACKING CMake option, the number of heap allocations per
+ * iteration is reported as well.
+ */
+
+#include "base/warnings.hpp"
+#include "data/game_traits.hpp"
+#include "data/map.hpp"
+#include "engine/allocation_tracker.hpp"
+#include "engine/base_components.hpp"
+#include "engine/collision_checker.hpp"
+#include "engine/physical_components.hpp"
+#include "engine/physics_system.hpp"
+#include "loader/adlib_emulator.hpp"
+#include "loader/byte_buffer.hpp"
+#include "loader/cmp_file_package.hpp"
+#include "loader/ega_image_decoder.hpp"
+#include "loader/palette.hpp"
+#include "loader/voc_decoder.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <boost/program_options.hpp>
+#include <entityx/entityx.h>
+#include <nlohmann/json.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+using namespace rigel;
+using namespace std;
+
+namespace ex = entityx;
+namespace po = boost::program_options;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int mMapWidth = 256;
+  int mMapHeight = 128;
+  int mNumEntities = 500;
+  double mMinTimePerBenchmark = 0.5;
+  string mFilter;
+  string mJsonFile;
+};
+
+
+struct BenchmarkResult {
+  string mName;
+  std::size_t mIterations;
+  double mMedianNs;
+  double mMinNs;
+
+  /** Only available when building with allocation tracking */
+  std::optional<double> mAllocationsPerIteration;
+};
+
+
+// Results of benchmarked code are added to this, so that the compiler can't
+// optimize the code away
+volatile std::size_t gSink = 0;
+
+
+template <typename T>
+void consume(const T& value) {
+  gSink = gSink + static_cast<std::size_t>(value);
+}
+
+
+/** Run func repeatedly, and measure the time per invocation
+ *
+ * The batch size is determined so that a single batch takes at least a
+ * millisecond, which keeps the clock's overhead and resolution out of the
+ * measurement.
+ */
+BenchmarkResult runBenchmark(
+  const string& name,
+  const double minTime,
+  const function<void()>& func
+) {
+  using namespace std::chrono;
+
+  const auto minBatchTime = milliseconds{1};
+
+  auto timeBatch = [&](const std::size_t batchSize) {
+    const auto start = Clock::now();
+    for (auto i = std::size_t{0}; i < batchSize; ++i) {
+      func();
+    }
+    return Clock::now() - start;
+  };
+
+  auto batchSize = std::size_t{1};
+  while (timeBatch(batchSize) < minBatchTime) {
+    batchSize *= 2;
+  }
+
+  namespace at = engine::allocation_tracking;
+
+  vector<double> nsPerIteration;
+  const auto allocationsAtStart = at::threadCounters();
+  auto totalTime = Clock::duration{};
+  while (totalTime < duration<double>{minTime}) {
+    const auto batchTime = timeBatch(batchSize);
+    totalTime += batchTime;
+    nsPerIteration.push_back(
+      duration<double, nano>(batchTime).count() / batchSize);
+  }
+
+  const auto numIterations = batchSize * nsPerIteration.size();
+  const auto allocations = at::threadCounters() - allocationsAtStart;
+
+  sort(nsPerIteration.begin(), nsPerIteration.end());
+  return BenchmarkResult{
+    name,
+    numIterations,
+    nsPerIteration[nsPerIteration.size() / 2],
+    nsPerIteration.front(),
+    at::isEnabledInBuild()
+      ? std::optional{double(allocations.mNumAllocations) / numIterations}
+      : std::nullopt};
+}
+
+
+/** Map with a bit of everything: Floors, walls and platforms
+ *
+ * Uses tile 1 as fully solid tile, all others are empty.
+ */
+data::map::Map makeSyntheticMap(const BenchmarkOptions& options) {
+  const auto width = options.mMapWidth;
+  const auto height = options.mMapHeight;
+
+  data::map::Map map{width, height, data::map::TileAttributeDict{{0x0, 0xF}}};
+
+  for (auto x = 0; x < width; ++x) {
+    map.setTileAt(0, x, height - 1, 1);
+  }
+
+  for (auto y = 0; y < height; ++y) {
+    map.setTileAt(0, 0, y, 1);
+    map.setTileAt(0, width - 1, y, 1);
+  }
+
+  std::mt19937 randomGenerator{1234};
+  std::uniform_int_distribution<int> xDistribution{1, width - 16};
+  std::uniform_int_distribution<int> yDistribution{1, height - 2};
+  std::uniform_int_distribution<int> lengthDistribution{2, 14};
+
+  const auto numPlatforms = width * height / 64;
+  for (auto i = 0; i < numPlatforms; ++i) {
+    const auto x = xDistribution(randomGenerator);
+    const auto y = yDistribution(randomGenerator);
+    const auto length = lengthDistribution(randomGenerator);
+    for (auto offset = 0; offset < length; ++offset) {
+      map.setTileAt(0, x + offset, y, 1);
+    }
+  }
+
+  return map;
+}
+
+
+vector<engine::components::BoundingBox> makeBoundingBoxes(
+  const BenchmarkOptions& options
+) {
+  std::mt19937 randomGenerator{5678};
+  std::uniform_int_distribution<int> xDistribution{1, options.mMapWidth - 6};
+  std::uniform_int_distribution<int> yDistribution{4, options.mMapHeight - 2};
+  std::uniform_int_distribution<int> sizeDistribution{1, 4};
+
+  vector<engine::components::BoundingBox> boxes;
+  for (auto i = 0; i < options.mNumEntities; ++i) {
+    const auto size = base::Extents{
+      sizeDistribution(randomGenerator), sizeDistribution(randomGenerator)};
+    boxes.push_back({
+      {xDistribution(randomGenerator), yDistribution(randomGenerator)},
+      size});
+  }
+
+  return boxes;
+}
+
+
+void runCollisionBenchmarks(
+  const BenchmarkOptions& options,
+  const std::function<void(const string&, const function<void()>&)>& run
+) {
+  ex::EntityX entityx;
+  const auto map = makeSyntheticMap(options);
+  engine::CollisionChecker collisionChecker{
+    &map, entityx.entities, entityx.events};
+  const auto boxes = makeBoundingBoxes(options);
+
+  run("collision_checker.is_on_solid_ground", [&]() {
+    auto count = 0;
+    for (const auto& box : boxes) {
+      count += collisionChecker.isOnSolidGround(box) ? 1 : 0;
+    }
+    consume(count);
+  });
+
+  run("collision_checker.is_touching_walls", [&]() {
+    auto count = 0;
+    for (const auto& box : boxes) {
+      count += collisionChecker.isTouchingLeftWall(box) ? 1 : 0;
+      count += collisionChecker.isTouchingRightWall(box) ? 1 : 0;
+      count += collisionChecker.isTouchingCeiling(box) ? 1 : 0;
+    }
+    consume(count);
+  });
+
+  run("collision_checker.free_distance", [&]() {
+    auto total = 0;
+    for (const auto& box : boxes) {
+      total += collisionChecker.freeDistanceDown(box, 16);
+      total += collisionChecker.freeDistanceLeft(box, 4);
+      total += collisionChecker.freeDistanceRight(box, 4);
+    }
+    consume(total);
+  });
+}
+
+
+void runPhysicsBenchmarks(
+  const BenchmarkOptions& options,
+  const std::function<void(const string&, const function<void()>&)>& run
+) {
+  using namespace engine::components;
+
+  ex::EntityX entityx;
+  const auto map = makeSyntheticMap(options);
+  engine::CollisionChecker collisionChecker{
+    &map, entityx.entities, entityx.events};
+  engine::PhysicsSystem physicsSystem{&collisionChecker, &map, &entityx.events};
+
+  const auto boxes = makeBoundingBoxes(options);
+
+  vector<ex::Entity> entities;
+  for (auto i = std::size_t{0}; i < boxes.size(); ++i) {
+    auto entity = entityx.entities.create();
+    entity.assign<BoundingBox>(BoundingBox{{0, 0}, boxes[i].size});
+    entity.assign<WorldPosition>(boxes[i].topLeft);
+    entity.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, true});
+    entity.assign<Active>();
+
+    // Every fourth entity is a solid body, so that the collision checker's
+    // solid body handling is exercised as well
+    if (i % 4 == 0) {
+      entity.assign<SolidBody>();
+    }
+
+    entities.push_back(entity);
+  }
+
+  // Bodies come to rest on the ground eventually, so they are moved back up
+  // to their initial position regularly. Otherwise, we'd only measure
+  // resting bodies after the first couple of batches.
+  auto updatesSinceReset = 0;
+  run("physics_system.update", [&]() {
+    if (updatesSinceReset++ == 30) {
+      for (auto i = std::size_t{0}; i < entities.size(); ++i) {
+        *entities[i].component<WorldPosition>() = boxes[i].topLeft;
+        entities[i].component<MovingBody>()->mVelocity = {
+          i % 2 == 0 ? 1.0f : -1.0f, 0.0f};
+      }
+
+      updatesSinceReset = 0;
+    }
+
+    physicsSystem.update(entityx.entities);
+  });
+}
+
+
+void runLoaderBenchmarks(
+  const BenchmarkOptions& options,
+  const std::function<void(const string&, const function<void()>&)>& run
+) {
+  std::mt19937 randomGenerator{91011};
+  std::uniform_int_distribution<int> byteDistribution{0, 255};
+  auto randomBytes = [&](const std::size_t count) {
+    loader::ByteBuffer bytes(count);
+    for (auto& byte : bytes) {
+      byte = static_cast<std::uint8_t>(byteDistribution(randomGenerator));
+    }
+    return bytes;
+  };
+
+  // Tile set sized like the ones used by the game: 40 tiles wide, with
+  // unmasked and masked tiles
+  {
+    const auto widthInTiles = std::size_t{40};
+    const auto numTiles = widthInTiles * 25;
+    const auto unmaskedTiles = randomBytes(numTiles * 32);
+    const auto maskedTiles = randomBytes(numTiles * 40);
+
+    run("ega_decoder.load_tiled_image_unmasked", [&]() {
+      const auto image = loader::loadTiledImage(
+        unmaskedTiles, widthInTiles, loader::INGAME_PALETTE);
+      consume(image.width());
+    });
+
+    run("ega_decoder.load_tiled_image_masked", [&]() {
+      const auto image = loader::loadTiledImage(
+        maskedTiles,
+        widthInTiles,
+        loader::INGAME_PALETTE,
+        data::TileImageType::Masked);
+      consume(image.width());
+    });
+  }
+
+  // CMP package with a few hundred files. The package can only be opened
+  // from a file, so we write one temporarily.
+  {
+    const auto numFiles = 200;
+    const auto fileSize = std::size_t{16 * 1024};
+    const auto dictSize = std::size_t{(numFiles + 1) * 20};
+
+    auto fileName = [](const int index) {
+      ostringstream stream;
+      stream << "F" << setw(7) << setfill('0') << index << ".MNI";
+      return stream.str();
+    };
+
+    const auto packagePath = string{"rigel_bench_package.cmp"};
+    {
+      ofstream file(packagePath, ios::binary);
+      auto writeU32 = [&](const std::uint32_t value) {
+        for (auto i = 0; i < 4; ++i) {
+          file.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+        }
+      };
+
+      for (auto i = 0; i < numFiles; ++i) {
+        const auto name = fileName(i);
+        file.write(name.data(), name.size());
+        writeU32(static_cast<std::uint32_t>(dictSize + i * fileSize));
+        writeU32(static_cast<std::uint32_t>(fileSize));
+      }
+
+      const auto terminator = string(20, '\0');
+      file.write(terminator.data(), terminator.size());
+
+      const auto contents = randomBytes(fileSize);
+      for (auto i = 0; i < numFiles; ++i) {
+        file.write(
+          reinterpret_cast<const char*>(contents.data()), contents.size());
+      }
+    }
+
+    const auto package = loader::CMPFilePackage{packagePath};
+    std::remove(packagePath.c_str());
+
+    auto nextFile = 0;
+    run("cmp_file_package.file", [&]() {
+      const auto name = fileName(nextFile);
+      nextFile = (nextFile + 1) % numFiles;
+      consume(package.file(name).size());
+    });
+  }
+
+  // One second of 4-bit ADPCM audio at 11025 Hz
+  {
+    const auto numSamples = std::size_t{11025};
+
+    loader::ByteBuffer vocFile;
+    const auto signature = string{"Creative Voice File\x1A"};
+    vocFile.insert(vocFile.end(), signature.begin(), signature.end());
+
+    auto appendLe = [&](const std::uint32_t value, const int numBytes) {
+      for (auto i = 0; i < numBytes; ++i) {
+        vocFile.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+      }
+    };
+
+    const auto version = std::uint16_t{0x010A};
+    appendLe(0x1A, 2);
+    appendLe(version, 2);
+    appendLe(static_cast<std::uint16_t>(~version + 0x1234), 2);
+
+    // Reference sample, followed by two samples per byte
+    const auto encodedSize = 1 + numSamples / 2;
+    vocFile.push_back(1);
+    appendLe(static_cast<std::uint32_t>(encodedSize + 2), 3);
+    vocFile.push_back(static_cast<std::uint8_t>(256 - 1000000 / 11025));
+    vocFile.push_back(1);
+
+    const auto encodedAudio = randomBytes(encodedSize);
+    vocFile.insert(vocFile.end(), encodedAudio.begin(), encodedAudio.end());
+    vocFile.push_back(0);
+
+    run("voc_decoder.decode_voc", [&]() {
+      consume(loader::decodeVoc(vocFile).mSamples.size());
+    });
+  }
+
+  // One second of music, with all 9 channels playing a note
+  {
+    const auto sampleRate = 44100;
+    loader::AdlibEmulator emulator{sampleRate};
+
+    // Modulator operator for each channel, the carrier is 3 above
+    const std::uint32_t OPERATOR_OFFSETS[] = {0, 1, 2, 8, 9, 10, 16, 17, 18};
+    for (auto channel = 0u; channel < 9u; ++channel) {
+      const auto modulator = OPERATOR_OFFSETS[channel];
+      for (const auto op : {modulator, modulator + 3}) {
+        emulator.writeRegister(0x20 + op, 0x01); // Frequency multiplier
+        emulator.writeRegister(0x40 + op, 0x10); // Output level
+        emulator.writeRegister(0x60 + op, 0xF0); // Attack/decay
+        emulator.writeRegister(0x80 + op, 0x77); // Sustain/release
+      }
+
+      emulator.writeRegister(0xA0 + channel, 0x98); // Frequency, low bits
+      emulator.writeRegister(0xB0 + channel, 0x31); // Key on, octave
+    }
+
+    vector<std::int16_t> buffer(sampleRate);
+    run("adlib_emulator.render", [&]() {
+      emulator.render(buffer.size(), buffer.data());
+      consume(buffer[buffer.size() / 2]);
+    });
+  }
+}
+
+
+nlohmann::json toJson(
+  const BenchmarkOptions& options,
+  const vector<BenchmarkResult>& results
+) {
+  auto serializedResults = nlohmann::json::array();
+  for (const auto& result : results) {
+    auto serialized = nlohmann::json{
+      {"name", result.mName},
+      {"iterations", result.mIterations},
+      {"medianNs", result.mMedianNs},
+      {"minNs", result.mMinNs}};
+    if (result.mAllocationsPerIteration) {
+      serialized["allocationsPerIteration"] = *result.mAllocationsPerIteration;
+    }
+
+    serializedResults.push_back(serialized);
+  }
+
+  return {
+    {"parameters", {
+      {"mapWidth", options.mMapWidth},
+      {"mapHeight", options.mMapHeight},
+      {"entities", options.mNumEntities}}},
+    {"results", serializedResults}};
+}
+
+
+void runBenchmarks(const BenchmarkOptions& options) {
+  vector<BenchmarkResult> results;
+
+  auto run = [&](const string& name, const function<void()>& func) {
+    if (name.find(options.mFilter) == string::npos) {
+      return;
+    }
+
+    const auto result = runBenchmark(
+      name, options.mMinTimePerBenchmark, func);
+    cout
+      << left << setw(42) << result.mName
+      << right << setw(14) << fixed << setprecision(1) << result.mMedianNs
+      << " ns (min " << result.mMinNs << " ns, "
+      << result.mIterations << " iterations";
+    if (result.mAllocationsPerIteration) {
+      cout << ", " << *result.mAllocationsPerIteration << " allocations";
+    }
+    cout << ")\n";
+    results.push_back(result);
+  };
+
+  runCollisionBenchmarks(options, run);
+  runPhysicsBenchmarks(options, run);
+  runLoaderBenchmarks(options, run);
+
+  if (!options.mJsonFile.empty()) {
+    ofstream file(options.mJsonFile);
+    if (!file.is_open()) {
+      throw runtime_error("Can't open output file: " + options.mJsonFile);
+    }
+
+    file << toJson(options, results).dump(2) << '\n';
+  }
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+
+  po::options_description optionsDescription("Options");
+  optionsDescription.add_options()
+    ("help,h", "Show command line help message")
+    ("map-width",
+     po::value<int>(&options.mMapWidth)->default_value(options.mMapWidth),
+     "Width of the synthetic map, in tiles")
+    ("map-height",
+     po::value<int>(&options.mMapHeight)->default_value(options.mMapHeight),
+     "Height of the synthetic map, in tiles")
+    ("entities,e",
+     po::value<int>(&options.mNumEntities)->default_value(
+       options.mNumEntities),
+     "Number of entities/bounding boxes for collision and physics benchmarks")
+    ("min-time,t",
+     po::value<double>(&options.mMinTimePerBenchmark)->default_value(
+       options.mMinTimePerBenchmark),
+     "Minimum time to spend on each benchmark, in seconds")
+    ("filter,f",
+     po::value<string>(&options.mFilter),
+     "Only run benchmarks whose name contains the given text")
+    ("json,j",
+     po::value<string>(&options.mJsonFile),
+     "Additionally write results to the given file as JSON");
+
+  try
+  {
+    po::variables_map variables;
+    po::store(po::parse_command_line(argc, argv, optionsDescription), variables);
+    po::notify(variables);
+
+    if (variables.count("help")) {
+      cout << optionsDescription << '\n';
+      return 0;
+    }
+
+    if (options.mMapWidth < 32 || options.mMapHeight < 16) {
+      throw invalid_argument("Map needs to be at least 32x16 tiles");
+    }
+
+    if (options.mNumEntities < 1) {
+      throw invalid_argument("Number of entities must be at least 1");
+    }
+
+    runBenchmarks(options);
+  }
+  catch (const po::error& err)
+  {
+    cerr << "ERROR: " << err.what() << "\n\n";
+    cerr << optionsDescription << '\n';
+    return -1;
+  }
+  catch (const std::exception& ex)
+  {
+    cerr << "ERROR: " << ex.what() << '\n';
+    return -2;
+  }
+
+  return 0;
+}
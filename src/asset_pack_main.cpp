@@ -0,0 +1,159 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* Asset cache generator
+ *
+ * Fills an asset cache directory (see the game's --asset-cache option) ahead
+ * of time. All levels are loaded once per difficulty, which decodes their
+ * tile sets and backdrops and stores the preprocessed level data. All actor
+ * images are decoded as well, including any replacement images found in the
+ * game's asset_replacements directory. Afterwards, the game can load all of
+ * these straight from the cache, without having to decode PNG files or the
+ * original game's image formats.
+ *
+ * The cache is tied to the game data and replacement images it was created
+ * from. Whenever these change, the tool needs to be run again, otherwise the
+ * game just falls back to decoding (and caching) assets on demand.
+ */
+
+#include "base/warnings.hpp"
+#include "data/game_session_data.hpp"
+#include "loader/level_loader.hpp"
+#include "loader/resource_loader.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <boost/program_options.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+using namespace rigel;
+using namespace std;
+
+namespace po = boost::program_options;
+
+
+namespace {
+
+void fillAssetCache(const string& gamePath, const string& cacheDirectory) {
+  const auto startTime = chrono::steady_clock::now();
+
+  loader::ResourceLoader resources(gamePath, cacheDirectory);
+
+  auto numLevels = 0;
+  for (auto episode = 0; episode < data::NUM_EPISODES; ++episode) {
+    for (auto level = 0; level < data::NUM_LEVELS_PER_EPISODE; ++level) {
+      const auto mapName = loader::levelFileName(episode, level);
+      if (!resources.mFilePackage.hasFile(mapName)) {
+        continue;
+      }
+
+      // The result isn't needed, loading the level puts its tile set,
+      // backdrops, actors and preprocessed map data into the cache. The
+      // latter depends on the difficulty.
+      for (const auto difficulty : {
+        data::Difficulty::Easy,
+        data::Difficulty::Medium,
+        data::Difficulty::Hard}
+      ) {
+        loader::loadLevel(mapName, resources, difficulty);
+      }
+      ++numLevels;
+    }
+  }
+
+  // Not all actors appear in levels, some are only spawned during gameplay
+  const auto& actorImages = resources.mActorImagePackage;
+  auto numActors = 0;
+  for (std::size_t index = 0; index < actorImages.numActorIds(); ++index) {
+    const auto id = static_cast<data::ActorID>(index);
+    if (id != data::ActorID::Menu_font_grayscale && actorImages.hasActor(id)) {
+      actorImages.loadActor(id);
+      ++numActors;
+    }
+  }
+
+  const auto elapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - startTime).count();
+  cout
+    << "Cached assets for " << numLevels << " levels and " << numActors
+    << " actors in " << elapsed << " s\n";
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  string gamePath;
+  string cacheDirectory;
+
+  po::options_description optionsDescription("Options");
+  optionsDescription.add_options()
+    ("help,h", "Show command line help message")
+    ("asset-cache",
+     po::value<string>(&cacheDirectory)->required(),
+     "Directory to store decoded assets in. This is the directory to give to "
+     "the game's --asset-cache option")
+    ("game-path",
+     po::value<string>(&gamePath)->required(),
+     "Path to original game's installation. Can also be given as positional "
+     "argument.");
+
+  po::positional_options_description positionalArgsDescription;
+  positionalArgsDescription.add("game-path", -1);
+
+  try
+  {
+    po::variables_map variables;
+    po::store(
+      po::command_line_parser(argc, argv)
+        .options(optionsDescription)
+        .positional(positionalArgsDescription)
+        .run(),
+      variables);
+
+    if (variables.count("help")) {
+      cout << optionsDescription << '\n';
+      return 0;
+    }
+
+    po::notify(variables);
+
+    if (gamePath.back() != '/') {
+      gamePath += "/";
+    }
+
+    fillAssetCache(gamePath, cacheDirectory);
+  }
+  catch (const po::error& err)
+  {
+    cerr << "ERROR: " << err.what() << "\n\n";
+    cerr << optionsDescription << '\n';
+    return -1;
+  }
+  catch (const std::exception& ex)
+  {
+    cerr << "ERROR: " << ex.what() << '\n';
+    return -2;
+  }
+
+  return 0;
+}
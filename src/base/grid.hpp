@@ -16,6 +16,12 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
+#include "base/spatial_types.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 
 
@@ -51,6 +57,13 @@ public:
     return valueAt(x, y);
   }
 
+  /** All values in the given row, from left to right */
+  ArrayView<ValueT> row(const std::size_t y) const {
+    assert(y < mHeight);
+    return ArrayView<ValueT>{
+      mStorage.data() + y*mWidth, static_cast<std::uint32_t>(mWidth)};
+  }
+
   std::size_t width() const {
     return mWidth;
   }
@@ -61,8 +74,134 @@ public:
 
 private:
   std::vector<ValueT> mStorage;
-  const std::size_t mWidth = 0;
-  const std::size_t mHeight = 0;
+  std::size_t mWidth = 0;
+  std::size_t mHeight = 0;
+};
+
+
+/** Grid of flags, stored as one bit per cell
+ *
+ * Each row starts at a new 64-bit word, so that a row can be processed
+ * a word at a time via rowWords(). Bits past the end of a row in its last
+ * word are always 0.
+ */
+template<>
+class Grid<bool> {
+public:
+  using Word = std::uint64_t;
+
+  static constexpr auto BITS_PER_WORD = std::size_t{64};
+
+  Grid() = default;
+  Grid(const std::size_t width, const std::size_t height)
+    : mStorage(wordsPerRow(width)*height)
+    , mWordsPerRow(wordsPerRow(width))
+    , mWidth(width)
+    , mHeight(height)
+  {
+  }
+
+  bool valueAt(const std::size_t x, const std::size_t y) const {
+    return (word(x, y) >> (x % BITS_PER_WORD)) & 1;
+  }
+
+  void setValueAt(const std::size_t x, const std::size_t y, const bool value) {
+    const auto mask = Word{1} << (x % BITS_PER_WORD);
+    auto& target = word(x, y);
+    target = value ? (target | mask) : (target & ~mask);
+  }
+
+  bool valueAtWithDefault(
+    const std::size_t x,
+    const std::size_t y,
+    const bool defaultValue
+  ) const {
+    if (x >= mWidth || y >= mHeight) {
+      return defaultValue;
+    }
+    return valueAt(x, y);
+  }
+
+  /** The words holding the given row, with x = 0 being the lowest bit */
+  ArrayView<Word> rowWords(const std::size_t y) const {
+    assert(y < mHeight);
+    return ArrayView<Word>{
+      mStorage.data() + y*mWordsPerRow,
+      static_cast<std::uint32_t>(mWordsPerRow)};
+  }
+
+  /** Set all cells within rect to value. Parts outside the grid are ignored */
+  void fill(const Rect<int>& rect, const bool value) {
+    const auto left = std::max(rect.left(), 0);
+    const auto top = std::max(rect.top(), 0);
+    const auto right = std::min(rect.right(), int(mWidth) - 1);
+    const auto bottom = std::min(rect.bottom(), int(mHeight) - 1);
+    if (left > right || top > bottom) {
+      return;
+    }
+
+    const auto firstWord = std::size_t(left) / BITS_PER_WORD;
+    const auto lastWord = std::size_t(right) / BITS_PER_WORD;
+
+    for (auto y = std::size_t(top); y <= std::size_t(bottom); ++y) {
+      auto pRow = mStorage.data() + y*mWordsPerRow;
+
+      for (auto i = firstWord; i <= lastWord; ++i) {
+        auto mask = ~Word{0};
+        if (i == firstWord) {
+          mask &= ~Word{0} << (left % BITS_PER_WORD);
+        }
+        if (i == lastWord) {
+          mask &= ~Word{0} >> (BITS_PER_WORD - 1 - right % BITS_PER_WORD);
+        }
+
+        pRow[i] = value ? (pRow[i] | mask) : (pRow[i] & ~mask);
+      }
+    }
+  }
+
+  /** Combine with another grid of the same size, cell by cell */
+  Grid& operator|=(const Grid& other) {
+    assert(other.mWidth == mWidth && other.mHeight == mHeight);
+    for (std::size_t i = 0; i < mStorage.size(); ++i) {
+      mStorage[i] |= other.mStorage[i];
+    }
+    return *this;
+  }
+
+  Grid& operator&=(const Grid& other) {
+    assert(other.mWidth == mWidth && other.mHeight == mHeight);
+    for (std::size_t i = 0; i < mStorage.size(); ++i) {
+      mStorage[i] &= other.mStorage[i];
+    }
+    return *this;
+  }
+
+  std::size_t width() const {
+    return mWidth;
+  }
+
+  std::size_t height() const {
+    return mHeight;
+  }
+
+private:
+  static std::size_t wordsPerRow(const std::size_t width) {
+    return (width + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  }
+
+  const Word& word(const std::size_t x, const std::size_t y) const {
+    return mStorage[x / BITS_PER_WORD + y*mWordsPerRow];
+  }
+
+  Word& word(const std::size_t x, const std::size_t y) {
+    return mStorage[x / BITS_PER_WORD + y*mWordsPerRow];
+  }
+
+  std::vector<Word> mStorage;
+  std::size_t mWordsPerRow = 0;
+  std::size_t mWidth = 0;
+  std::size_t mHeight = 0;
 };
 
 }
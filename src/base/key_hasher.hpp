@@ -0,0 +1,77 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+
+namespace rigel::base {
+
+/** Incremental 64-bit FNV-1a hash, used to derive cache keys
+ *
+ * Multi-byte values are added in little-endian byte order, so that the
+ * resulting hash is the same on all platforms.
+ */
+class KeyHasher {
+public:
+  void add(const std::uint8_t byte) {
+    mHash ^= byte;
+    mHash *= std::uint64_t{1099511628211ull};
+  }
+
+  void add(const std::uint16_t value) {
+    add(static_cast<std::uint8_t>(value & 0xFF));
+    add(static_cast<std::uint8_t>(value >> 8));
+  }
+
+  void add(const std::uint32_t value) {
+    add(static_cast<std::uint16_t>(value & 0xFFFF));
+    add(static_cast<std::uint16_t>(value >> 16));
+  }
+
+  void add(const std::uint64_t value) {
+    add(static_cast<std::uint32_t>(value & 0xFFFFFFFF));
+    add(static_cast<std::uint32_t>(value >> 32));
+  }
+
+  void add(const std::string_view text) {
+    for (const auto ch : text) {
+      add(static_cast<std::uint8_t>(ch));
+    }
+
+    // Terminate, so that e.g. "ab" + "c" and "a" + "bc" differ
+    add(std::uint8_t{0});
+  }
+
+  template <typename Iter>
+  void addBytes(Iter first, const Iter last) {
+    for (; first != last; ++first) {
+      add(static_cast<std::uint8_t>(*first));
+    }
+  }
+
+  std::uint64_t value() const {
+    return mHash;
+  }
+
+private:
+  std::uint64_t mHash = 14695981039346656037ull;
+};
+
+}
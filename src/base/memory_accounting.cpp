@@ -0,0 +1,202 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory_accounting.hpp"
+
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <ostream>
+#include <utility>
+
+
+namespace rigel::base::memory_accounting {
+
+namespace {
+
+struct AtomicUsage {
+  std::atomic<std::int64_t> mCurrentBytes{0};
+  std::atomic<std::int64_t> mPeakBytes{0};
+};
+
+
+std::array<AtomicUsage, NUM_CATEGORIES> gUsageByCategory;
+
+// Negative means no budget
+std::atomic<std::int64_t> gBudget{-1};
+
+
+AtomicUsage& usageFor(const Category category) {
+  return gUsageByCategory[static_cast<std::size_t>(category)];
+}
+
+
+void addBytes(const Category category, const std::int64_t numBytes) {
+  if (numBytes == 0) {
+    return;
+  }
+
+  auto& usage = usageFor(category);
+  const auto newValue =
+    usage.mCurrentBytes.fetch_add(numBytes, std::memory_order_relaxed) +
+    numBytes;
+
+  auto peak = usage.mPeakBytes.load(std::memory_order_relaxed);
+  while (
+    newValue > peak &&
+    !usage.mPeakBytes.compare_exchange_weak(
+      peak, newValue, std::memory_order_relaxed)
+  ) {
+  }
+}
+
+
+double toMegaBytes(const std::int64_t numBytes) {
+  return double(numBytes) / (1024.0 * 1024.0);
+}
+
+}
+
+
+const char* categoryName(const Category category) {
+  switch (category) {
+    case Category::FilePackage: return "File package";
+    case Category::Images: return "Images";
+    case Category::Sounds: return "Sounds";
+    case Category::Scripts: return "Scripts";
+    case Category::Textures: return "Textures";
+    case Category::RenderTargets: return "Render targets";
+    case Category::PooledRenderTargets: return "Pooled render targets";
+  }
+
+  return "";
+}
+
+
+bool isGpuMemory(const Category category) {
+  return category >= Category::Textures;
+}
+
+
+Usage usage(const Category category) {
+  const auto& usage = usageFor(category);
+  return {
+    usage.mCurrentBytes.load(std::memory_order_relaxed),
+    usage.mPeakBytes.load(std::memory_order_relaxed)};
+}
+
+
+std::int64_t totalBytes() {
+  auto result = std::int64_t{0};
+  for (const auto& usage : gUsageByCategory) {
+    result += usage.mCurrentBytes.load(std::memory_order_relaxed);
+  }
+
+  return result;
+}
+
+
+void setBudget(const std::optional<std::int64_t> numBytes) {
+  gBudget.store(numBytes.value_or(-1), std::memory_order_relaxed);
+}
+
+
+bool isOverBudget() {
+  const auto budget = gBudget.load(std::memory_order_relaxed);
+  return budget >= 0 && totalBytes() > budget;
+}
+
+
+void printReport(std::ostream& stream) {
+  stream << "Memory usage (MiB)       current      peak\n";
+
+  for (auto i = 0; i < NUM_CATEGORIES; ++i) {
+    const auto category = static_cast<Category>(i);
+    const auto categoryUsage = usage(category);
+    stream << (isGpuMemory(category) ? "  GPU " : "  CPU ")
+      << std::left << std::setw(18) << categoryName(category) << std::right
+      << std::fixed << std::setprecision(2)
+      << std::setw(8) << toMegaBytes(categoryUsage.mCurrentBytes)
+      << std::setw(10) << toMegaBytes(categoryUsage.mPeakBytes) << '\n';
+  }
+
+  stream << "  Total" << std::setw(27) << toMegaBytes(totalBytes());
+
+  const auto budget = gBudget.load(std::memory_order_relaxed);
+  if (budget >= 0) {
+    stream << " (budget: " << toMegaBytes(budget) << ')';
+  }
+
+  stream << '\n';
+}
+
+
+TrackedBytes::TrackedBytes(const Category category, const std::size_t numBytes)
+  : mCategory(category)
+  , mNumBytes(numBytes)
+{
+  addBytes(mCategory, std::int64_t(mNumBytes));
+}
+
+
+TrackedBytes::~TrackedBytes() {
+  addBytes(mCategory, -std::int64_t(mNumBytes));
+}
+
+
+TrackedBytes::TrackedBytes(const TrackedBytes& other)
+  : TrackedBytes(other.mCategory, other.mNumBytes)
+{
+}
+
+
+TrackedBytes::TrackedBytes(TrackedBytes&& other) noexcept
+  : mCategory(other.mCategory)
+  , mNumBytes(std::exchange(other.mNumBytes, 0))
+{
+}
+
+
+TrackedBytes& TrackedBytes::operator=(const TrackedBytes& other) {
+  if (&other != this) {
+    addBytes(mCategory, -std::int64_t(mNumBytes));
+    mCategory = other.mCategory;
+    mNumBytes = other.mNumBytes;
+    addBytes(mCategory, std::int64_t(mNumBytes));
+  }
+
+  return *this;
+}
+
+
+TrackedBytes& TrackedBytes::operator=(TrackedBytes&& other) noexcept {
+  if (&other != this) {
+    addBytes(mCategory, -std::int64_t(mNumBytes));
+    mCategory = other.mCategory;
+    mNumBytes = std::exchange(other.mNumBytes, 0);
+  }
+
+  return *this;
+}
+
+
+void TrackedBytes::resize(const std::size_t numBytes) {
+  addBytes(mCategory, std::int64_t(numBytes) - std::int64_t(mNumBytes));
+  mNumBytes = numBytes;
+}
+
+}
@@ -0,0 +1,108 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+
+
+namespace rigel::base::memory_accounting {
+
+/** Keeps track of how much memory is used by assets, per category
+ *
+ * Objects holding asset data contain a TrackedBytes member, which adds the
+ * size of the data to its category for as long as the object exists. This
+ * counts the bulk of the memory, like pixel and sample buffers, not every
+ * allocation made on the way. See engine/allocation_tracker.hpp for the
+ * latter.
+ *
+ * The totals are global and can be updated from any thread.
+ */
+enum class Category {
+  // CPU memory
+  FilePackage,
+  Images,
+  Sounds,
+  Scripts,
+
+  // GPU memory
+  Textures,
+  RenderTargets,
+  PooledRenderTargets
+};
+
+constexpr auto NUM_CATEGORIES = 7;
+
+
+struct Usage {
+  std::int64_t mCurrentBytes = 0;
+  std::int64_t mPeakBytes = 0;
+};
+
+
+const char* categoryName(Category category);
+bool isGpuMemory(Category category);
+
+Usage usage(Category category);
+
+/** Current usage summed over all categories */
+std::int64_t totalBytes();
+
+
+/** Set a limit for totalBytes(), or remove it by passing std::nullopt
+ *
+ * Exceeding the budget isn't an error. Owners of cached data, which could
+ * be recreated when needed, are expected to check isOverBudget() and release
+ * what they can.
+ */
+void setBudget(std::optional<std::int64_t> numBytes);
+bool isOverBudget();
+
+
+/** Write current and peak usage for all categories as a table */
+void printReport(std::ostream& stream);
+
+
+/** Adds a number of bytes to a category for as long as it exists
+ *
+ * Copying adds the bytes once more, moving transfers them.
+ */
+class TrackedBytes {
+public:
+  TrackedBytes() = default;
+  TrackedBytes(Category category, std::size_t numBytes);
+  ~TrackedBytes();
+
+  TrackedBytes(const TrackedBytes& other);
+  TrackedBytes(TrackedBytes&& other) noexcept;
+  TrackedBytes& operator=(const TrackedBytes& other);
+  TrackedBytes& operator=(TrackedBytes&& other) noexcept;
+
+  void resize(std::size_t numBytes);
+
+  std::size_t size() const {
+    return mNumBytes;
+  }
+
+private:
+  Category mCategory = Category::Images;
+  std::size_t mNumBytes = 0;
+};
+
+}
@@ -24,6 +24,7 @@ RIGEL_DISABLE_WARNINGS
 RIGEL_RESTORE_WARNINGS
 
 
+#include <algorithm>
 #include <cstdint>
 #include <tuple>
 
@@ -129,10 +130,24 @@ struct Rect {
     return bottomRight().x;
   }
 
+  /** Check if the two rectangles overlap
+   *
+   * Same semantics as SDL_HasIntersection() (coordinates are converted to
+   * int, and empty rectangles never intersect anything), but inline. This
+   * is called a lot in the game logic's inner loops, where the call into
+   * SDL got in the way of the compiler's optimizations.
+   */
   bool intersects(const Rect& other) const {
     const auto r1 = detail::toSdlRect(*this);
     const auto r2 = detail::toSdlRect(other);
-    return SDL_HasIntersection(&r1, &r2);
+
+    if (r1.w <= 0 || r1.h <= 0 || r2.w <= 0 || r2.h <= 0) {
+      return false;
+    }
+
+    return
+      std::max(r1.x, r2.x) < std::min(r1.x + r1.w, r2.x + r2.w) &&
+      std::max(r1.y, r2.y) < std::min(r1.y + r1.h, r2.y + r2.h);
   }
 
   bool containsPoint(const Point<ValueT>& point) const {
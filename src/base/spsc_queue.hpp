@@ -0,0 +1,79 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+
+namespace rigel::base {
+
+/** Lock-free queue for passing data from one thread to another
+ *
+ * Works for exactly one producer thread and one consumer thread. Neither
+ * push() nor pop() ever block or allocate, which makes the queue suitable
+ * for communicating with real-time threads like the audio callback.
+ *
+ * The queue can hold up to Capacity - 1 elements at a time.
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+  static_assert(Capacity >= 2);
+
+public:
+  /** Add an element, to be called from the producer thread only
+   *
+   * Returns false if the queue is full. item is left untouched in that case.
+   */
+  bool push(T&& item) {
+    const auto writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const auto nextWriteIndex = advance(writeIndex);
+    if (nextWriteIndex == mReadIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    mSlots[writeIndex] = std::move(item);
+    mWriteIndex.store(nextWriteIndex, std::memory_order_release);
+    return true;
+  }
+
+  /** Take the oldest element, to be called from the consumer thread only */
+  std::optional<T> pop() {
+    const auto readIndex = mReadIndex.load(std::memory_order_relaxed);
+    if (readIndex == mWriteIndex.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+
+    auto item = std::optional<T>{std::move(mSlots[readIndex])};
+    mReadIndex.store(advance(readIndex), std::memory_order_release);
+    return item;
+  }
+
+private:
+  static std::size_t advance(const std::size_t index) {
+    return (index + 1) % Capacity;
+  }
+
+  std::array<T, Capacity> mSlots;
+  std::atomic<std::size_t> mReadIndex{0};
+  std::atomic<std::size_t> mWriteIndex{0};
+};
+
+}
@@ -0,0 +1,139 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+
+
+namespace rigel::base {
+
+/** Vector-like container with a fixed maximum size and inline storage
+ *
+ * Offers a subset of std::vector's interface, but never allocates. Adding
+ * more than Capacity elements throws std::length_error. For trivially
+ * copyable element types, the container itself is trivially copyable as
+ * well.
+ */
+template<typename T, std::size_t Capacity>
+class StaticVector {
+public:
+  using value_type = T;
+  using size_type = std::uint32_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = value_type*;
+  using const_iterator = const value_type*;
+
+  StaticVector() = default;
+
+  StaticVector(std::initializer_list<T> elements) // NOLINT
+    : StaticVector(elements.begin(), elements.end())
+  {
+  }
+
+  template <typename Iterator>
+  StaticVector(Iterator first, Iterator last) {
+    for (; first != last; ++first) {
+      push_back(*first);
+    }
+  }
+
+  iterator begin() {
+    return mElements.data();
+  }
+
+  iterator end() {
+    return mElements.data() + mSize;
+  }
+
+  const_iterator begin() const {
+    return mElements.data();
+  }
+
+  const_iterator end() const {
+    return mElements.data() + mSize;
+  }
+
+  reference operator[](const size_type index) {
+    assert(index < mSize);
+    return mElements[index];
+  }
+
+  const_reference operator[](const size_type index) const {
+    assert(index < mSize);
+    return mElements[index];
+  }
+
+  reference back() {
+    assert(mSize > 0);
+    return mElements[mSize - 1];
+  }
+
+  const_reference back() const {
+    assert(mSize > 0);
+    return mElements[mSize - 1];
+  }
+
+  void push_back(const T& element) {
+    if (mSize >= Capacity) {
+      throw std::length_error("StaticVector capacity exceeded");
+    }
+
+    mElements[mSize] = element;
+    ++mSize;
+  }
+
+  void pop_back() {
+    assert(mSize > 0);
+    --mSize;
+  }
+
+  void clear() {
+    mSize = 0;
+  }
+
+  size_type size() const {
+    return mSize;
+  }
+
+  bool empty() const {
+    return mSize == 0;
+  }
+
+  static constexpr size_type capacity() {
+    return static_cast<size_type>(Capacity);
+  }
+
+  bool operator==(const StaticVector& other) const {
+    return std::equal(begin(), end(), other.begin(), other.end());
+  }
+
+  bool operator!=(const StaticVector& other) const {
+    return !(*this == other);
+  }
+
+private:
+  std::array<T, Capacity> mElements{};
+  size_type mSize = 0;
+};
+
+}
@@ -0,0 +1,133 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tunables.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+namespace rigel::base {
+
+namespace {
+
+std::vector<TunableRef>& registry() {
+  // Function-local, so that it's ready to use when tunables defined in
+  // other translation units register themselves during static
+  // initialization
+  static std::vector<TunableRef> tunables;
+  return tunables;
+}
+
+
+bool parseValue(const std::string& text, const Tunable<bool>&) {
+  if (text == "true" || text == "on" || text == "1") {
+    return true;
+  }
+
+  if (text == "false" || text == "off" || text == "0") {
+    return false;
+  }
+
+  throw std::invalid_argument("Not a boolean value: " + text);
+}
+
+
+int parseValue(const std::string& text, const Tunable<int>&) {
+  std::size_t numCharsParsed = 0;
+  auto value = 0;
+  try {
+    value = std::stoi(text, &numCharsParsed);
+  } catch (const std::logic_error&) {
+    // Thrown for both invalid and out of range input
+  }
+
+  if (numCharsParsed == 0 || numCharsParsed != text.size()) {
+    throw std::invalid_argument("Not an integer value: " + text);
+  }
+
+  return value;
+}
+
+}
+
+
+template <typename T>
+Tunable<T>::Tunable(
+  const char* name,
+  const char* description,
+  const T defaultValue,
+  const T minValue,
+  const T maxValue
+)
+  : mpName(name)
+  , mpDescription(description)
+  , mValue(defaultValue)
+  , mMinValue(minValue)
+  , mMaxValue(maxValue)
+{
+  registry().push_back(this);
+}
+
+
+template <typename T>
+void Tunable<T>::set(const T value) {
+  mValue = std::clamp(value, mMinValue, mMaxValue);
+}
+
+
+template class Tunable<bool>;
+template class Tunable<int>;
+
+
+const std::vector<TunableRef>& allTunables() {
+  return registry();
+}
+
+
+void applyTunableSetting(const std::string_view assignment) {
+  const auto separatorPos = assignment.find('=');
+  if (separatorPos == std::string_view::npos) {
+    throw std::invalid_argument(
+      "Expected name=value: " + std::string{assignment});
+  }
+
+  const auto name = assignment.substr(0, separatorPos);
+  const auto valueText = std::string{assignment.substr(separatorPos + 1)};
+
+  for (const auto& tunable : registry()) {
+    const auto applied = std::visit(
+      [&](auto* pTunable) {
+        if (name != pTunable->name()) {
+          return false;
+        }
+
+        pTunable->set(parseValue(valueText, *pTunable));
+        return true;
+      },
+      tunable);
+
+    if (applied) {
+      return;
+    }
+  }
+
+  throw std::invalid_argument("Unknown tunable: " + std::string{name});
+}
+
+}
@@ -0,0 +1,102 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <limits>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+
+namespace rigel::base {
+
+/** A setting which can be changed while the game is running
+ *
+ * Meant for switching performance features on and off, or adjusting their
+ * parameters, without rebuilding. Tunables are defined as global objects
+ * next to the code using them, and register themselves on construction.
+ * They can then be changed via the --set command line option, or the
+ * tunables window (see ui/tunables_window.hpp).
+ *
+ * Tunables must not affect game logic, since that would break replays.
+ * They are only meant to be used from the main thread.
+ */
+template <typename T>
+class Tunable {
+public:
+  Tunable(
+    const char* name,
+    const char* description,
+    T defaultValue,
+    T minValue = std::numeric_limits<T>::lowest(),
+    T maxValue = std::numeric_limits<T>::max());
+
+  Tunable(const Tunable&) = delete;
+  Tunable& operator=(const Tunable&) = delete;
+
+  const char* name() const {
+    return mpName;
+  }
+
+  const char* description() const {
+    return mpDescription;
+  }
+
+  T value() const {
+    return mValue;
+  }
+
+  T minValue() const {
+    return mMinValue;
+  }
+
+  T maxValue() const {
+    return mMaxValue;
+  }
+
+  /** Set a new value, clamped to the tunable's range */
+  void set(T value);
+
+  operator T() const { // NOLINT
+    return mValue;
+  }
+
+private:
+  const char* mpName;
+  const char* mpDescription;
+  T mValue;
+  T mMinValue;
+  T mMaxValue;
+};
+
+
+using TunableRef = std::variant<Tunable<bool>*, Tunable<int>*>;
+
+/** All tunables in the order they were registered */
+const std::vector<TunableRef>& allTunables();
+
+
+/** Apply a setting given as "name=value"
+ *
+ * Boolean tunables accept true/false, on/off or 1/0. Throws
+ * std::invalid_argument if there's no tunable with the given name, or the
+ * value can't be parsed.
+ */
+void applyTunableSetting(std::string_view assignment);
+
+}
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "base/warnings.hpp"
+#include "data/game_traits.hpp"
 #include "engine/timing.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "renderer/renderer.hpp"
@@ -25,6 +26,7 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL_events.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <optional>
 #include <string>
 
 
@@ -37,11 +39,17 @@ namespace engine {
   class TiledTexture;
 }
 
+namespace game_logic {
+  class SpriteFactory;
+}
+
 namespace loader {
   class ResourceLoader;
 }
 
 namespace ui {
+  class FullScreenImageCache;
+  struct HudAssets;
   class MenuElementRenderer;
   class DukeScriptRunner;
 }
@@ -58,13 +66,47 @@ struct GameMode {
     ui::MenuElementRenderer* mpUiRenderer;
     engine::TiledTexture* mpUiSpriteSheet;
     UserProfile* mpUserProfile;
+    game_logic::SpriteFactory* mpSpriteFactory;
+    const ui::HudAssets* mpHudAssets;
+    ui::FullScreenImageCache* mpFullScreenImages;
+    data::ViewPortSize mViewPortSize;
+
+    /** How many times faster than normal to run in-game logic
+     *
+     * UNCAPPED_GAME_SPEED runs as many logic updates per frame as fit
+     * into a fixed time budget.
+     */
+    int mGameSpeedMultiplier = 1;
   };
 
+  static constexpr auto UNCAPPED_GAME_SPEED = 0;
+
   virtual ~GameMode() = default;
 
   virtual void handleEvent(const SDL_Event& event) = 0;
 
   virtual void updateAndRender(engine::TimeDelta dt) = 0;
+
+  /** How long the mode can go without updateAndRender() being called
+   *
+   * Modes showing mostly static screens can return the time until their
+   * next animation step here. As long as no events arrive, the main loop
+   * then waits instead of rendering and presenting identical frames.
+   * Returning nothing (the default) means the mode needs to be updated every
+   * frame.
+   */
+  virtual std::optional<engine::TimeDelta> timeUntilNextUpdate() const {
+    return std::nullopt;
+  }
+
+  /** True if the mode draws debug UI via Dear ImGui in its next update
+   *
+   * The main loop only runs ImGui while there's something to show, so
+   * modes must not use any ImGui functionality while this returns false.
+   */
+  virtual bool isShowingDebugUi() const {
+    return false;
+  }
 };
 
 
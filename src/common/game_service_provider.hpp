@@ -46,6 +46,14 @@ struct IGameServiceProvider {
   virtual void scheduleEnterMainMenu() = 0;
   virtual void scheduleGameQuit() = 0;
   virtual bool isShareWareVersion() const = 0;
+
+  /** Signal that input received so far has been acted upon
+   *
+   * Modes which don't react to input immediately, like the in-game logic
+   * running at a fixed tick rate, call this once a tick has consumed it.
+   * Used for measuring input latency.
+   */
+  virtual void markInputProcessed() {}
 };
 
 }
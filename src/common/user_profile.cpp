@@ -18,67 +18,25 @@
 
 #include "base/warnings.hpp"
 #include "loader/file_utils.hpp"
+#include "loader/msgpack.hpp"
 #include "loader/user_profile_import.hpp"
 
 RIGEL_DISABLE_WARNINGS
-#include <nlohmann/json.hpp>
 #include <SDL_filesystem.h>
 RIGEL_RESTORE_WARNINGS
 
-#include <iostream>
+#include <algorithm>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
 
 namespace rigel {
 
-namespace data {
-
-NLOHMANN_JSON_SERIALIZE_ENUM(Difficulty, {
-  {Difficulty::Easy, "Easy"},
-  {Difficulty::Medium, "Medium"},
-  {Difficulty::Hard, "Hard"},
-})
-
-NLOHMANN_JSON_SERIALIZE_ENUM(WeaponType, {
-  {WeaponType::Normal, "Normal"},
-  {WeaponType::Laser, "Laser"},
-  {WeaponType::Rocket, "Rocket"},
-  {WeaponType::FlameThrower, "FlameThrower"},
-})
-
-
-NLOHMANN_JSON_SERIALIZE_ENUM(TutorialMessageId, {
-  {TutorialMessageId::FoundRapidFire, "FoundRapidFire"},
-  {TutorialMessageId::FoundHealthMolecule, "FoundHealthMolecule"},
-  {TutorialMessageId::FoundRegularWeapon, "FoundRegularWeapon"},
-  {TutorialMessageId::FoundLaser, "FoundLaser"},
-  {TutorialMessageId::FoundFlameThrower, "FoundFlameThrower"},
-  {TutorialMessageId::FoundRocketLauncher, "FoundRocketLauncher"},
-  {TutorialMessageId::EarthQuake, "EarthQuake"},
-  {TutorialMessageId::FoundBlueKey, "FoundBlueKey"},
-  {TutorialMessageId::FoundAccessCard, "FoundAccessCard"},
-  {TutorialMessageId::FoundSpaceShip, "FoundSpaceShip"},
-  {TutorialMessageId::FoundLetterN, "FoundLetterN"},
-  {TutorialMessageId::FoundLetterU, "FoundLetterU"},
-  {TutorialMessageId::FoundLetterK, "FoundLetterK"},
-  {TutorialMessageId::FoundLetterE, "FoundLetterE"},
-  {TutorialMessageId::KeyNeeded, "KeyNeeded"},
-  {TutorialMessageId::AccessCardNeeded, "AccessCardNeeded"},
-  {TutorialMessageId::CloakNeeded, "CloakNeeded"},
-  {TutorialMessageId::RadarsStillFunctional, "RadarsStillFunctional"},
-  {TutorialMessageId::HintGlobeNeeded, "HintGlobeNeeded"},
-  {TutorialMessageId::FoundTurboLift, "FoundTurboLift"},
-  {TutorialMessageId::FoundTeleporter, "FoundTeleporter"},
-  {TutorialMessageId::LettersCollectedRightOrder, "LettersCollectedRightOrder"},
-  {TutorialMessageId::FoundSoda, "FoundSoda"},
-  {TutorialMessageId::FoundForceField, "FoundForceField"},
-  {TutorialMessageId::FoundDoor, "FoundDoor"},
-})
-
-}
-
-
 namespace {
 
 constexpr auto PREF_PATH_ORG_NAME = "lethal-guitar";
@@ -104,150 +62,516 @@ UserProfile importProfile(
 }
 
 
-nlohmann::json serialize(const data::TutorialMessageState& messageState) {
-  auto serialized = nlohmann::json::array();
+template <typename EnumT>
+struct EnumName {
+  EnumT mValue;
+  const char* mName;
+};
+
+
+constexpr EnumName<data::Difficulty> DIFFICULTY_NAMES[] = {
+  {data::Difficulty::Easy, "Easy"},
+  {data::Difficulty::Medium, "Medium"},
+  {data::Difficulty::Hard, "Hard"},
+};
+
+
+constexpr EnumName<data::WeaponType> WEAPON_TYPE_NAMES[] = {
+  {data::WeaponType::Normal, "Normal"},
+  {data::WeaponType::Laser, "Laser"},
+  {data::WeaponType::Rocket, "Rocket"},
+  {data::WeaponType::FlameThrower, "FlameThrower"},
+};
+
+
+constexpr EnumName<data::TutorialMessageId> TUTORIAL_MESSAGE_ID_NAMES[] = {
+  {data::TutorialMessageId::FoundRapidFire, "FoundRapidFire"},
+  {data::TutorialMessageId::FoundHealthMolecule, "FoundHealthMolecule"},
+  {data::TutorialMessageId::FoundRegularWeapon, "FoundRegularWeapon"},
+  {data::TutorialMessageId::FoundLaser, "FoundLaser"},
+  {data::TutorialMessageId::FoundFlameThrower, "FoundFlameThrower"},
+  {data::TutorialMessageId::FoundRocketLauncher, "FoundRocketLauncher"},
+  {data::TutorialMessageId::EarthQuake, "EarthQuake"},
+  {data::TutorialMessageId::FoundBlueKey, "FoundBlueKey"},
+  {data::TutorialMessageId::FoundAccessCard, "FoundAccessCard"},
+  {data::TutorialMessageId::FoundSpaceShip, "FoundSpaceShip"},
+  {data::TutorialMessageId::FoundLetterN, "FoundLetterN"},
+  {data::TutorialMessageId::FoundLetterU, "FoundLetterU"},
+  {data::TutorialMessageId::FoundLetterK, "FoundLetterK"},
+  {data::TutorialMessageId::FoundLetterE, "FoundLetterE"},
+  {data::TutorialMessageId::KeyNeeded, "KeyNeeded"},
+  {data::TutorialMessageId::AccessCardNeeded, "AccessCardNeeded"},
+  {data::TutorialMessageId::CloakNeeded, "CloakNeeded"},
+  {data::TutorialMessageId::RadarsStillFunctional, "RadarsStillFunctional"},
+  {data::TutorialMessageId::HintGlobeNeeded, "HintGlobeNeeded"},
+  {data::TutorialMessageId::FoundTurboLift, "FoundTurboLift"},
+  {data::TutorialMessageId::FoundTeleporter, "FoundTeleporter"},
+  {
+    data::TutorialMessageId::LettersCollectedRightOrder,
+    "LettersCollectedRightOrder"},
+  {data::TutorialMessageId::FoundSoda, "FoundSoda"},
+  {data::TutorialMessageId::FoundForceField, "FoundForceField"},
+  {data::TutorialMessageId::FoundDoor, "FoundDoor"},
+};
+
+
+/** Look up the name for an enum value
+ *
+ * Unknown values map to the first name in the table, and vice versa
+ * when reading. This matches what user profiles written by earlier
+ * versions (via nlohmann::json's enum conversion) expect.
+ */
+template <typename EnumT, std::size_t N>
+const char* nameOf(const EnumName<EnumT> (&names)[N], const EnumT value) {
+  const auto iName = std::find_if(
+    std::begin(names), std::end(names), [&](const EnumName<EnumT>& entry) {
+      return entry.mValue == value;
+    });
+  return iName != std::end(names) ? iName->mName : names[0].mName;
+}
+
+
+template <typename EnumT, std::size_t N>
+EnumT readEnum(
+  loader::MsgPackReader& reader,
+  const EnumName<EnumT> (&names)[N]
+) {
+  if (reader.peekType() != loader::MsgPackReader::Type::String) {
+    reader.skipValue();
+    return names[0].mValue;
+  }
+
+  const auto name = reader.readString();
+  const auto iName = std::find_if(
+    std::begin(names), std::end(names), [&](const EnumName<EnumT>& entry) {
+      return name == entry.mName;
+    });
+  return iName != std::end(names) ? iName->mValue : names[0].mValue;
+}
+
+
+/** Read a map, invoking readValue(key) for each entry
+ *
+ * readValue must return true if it consumed the value belonging to the
+ * key. Entries it doesn't know about are skipped.
+ */
+template <typename Callback>
+void readMap(loader::MsgPackReader& reader, Callback&& readValue) {
+  const auto numEntries = reader.readMapSize();
+  for (std::size_t i = 0; i < numEntries; ++i) {
+    if (reader.peekType() != loader::MsgPackReader::Type::String) {
+      reader.skipValue();
+      reader.skipValue();
+      continue;
+    }
+
+    const auto key = reader.readString();
+    if (!readValue(key)) {
+      reader.skipValue();
+    }
+  }
+}
+
+
+template <typename T>
+const T& required(const std::optional<T>& value, const char* key) {
+  if (!value) {
+    throw std::runtime_error(
+      std::string("Missing key in user profile: ") + key);
+  }
+
+  return *value;
+}
+
+
+int readInt(loader::MsgPackReader& reader) {
+  return static_cast<int>(reader.readInt());
+}
+
+
+// Keys in maps are written in alphabetical order, which is what
+// nlohmann::json used to produce. This keeps the files byte-identical to
+// those written by earlier versions.
+
+void serialize(
+  loader::MsgPackWriter& writer,
+  const data::TutorialMessageState& messageState
+) {
+  auto numMessagesShown = std::size_t{0};
+  for (int i = 0; i < data::NUM_TUTORIAL_MESSAGES; ++i) {
+    if (messageState.hasBeenShown(static_cast<data::TutorialMessageId>(i))) {
+      ++numMessagesShown;
+    }
+  }
 
+  writer.beginArray(numMessagesShown);
   for (int i = 0; i < data::NUM_TUTORIAL_MESSAGES; ++i) {
     const auto value = static_cast<data::TutorialMessageId>(i);
     if (messageState.hasBeenShown(value)) {
-      serialized.push_back(value);
+      writer.writeString(nameOf(TUTORIAL_MESSAGE_ID_NAMES, value));
     }
   }
+}
 
-  return serialized;
+
+void serialize(
+  loader::MsgPackWriter& writer,
+  const data::SavedGame& savedGame
+) {
+  writer.beginMap(8);
+  writer.writeString("ammo");
+  writer.writeInt(savedGame.mAmmo);
+  writer.writeString("difficulty");
+  writer.writeString(
+    nameOf(DIFFICULTY_NAMES, savedGame.mSessionId.mDifficulty));
+  writer.writeString("episode");
+  writer.writeInt(savedGame.mSessionId.mEpisode);
+  writer.writeString("level");
+  writer.writeInt(savedGame.mSessionId.mLevel);
+  writer.writeString("name");
+  writer.writeString(savedGame.mName);
+  writer.writeString("score");
+  writer.writeInt(savedGame.mScore);
+  writer.writeString("tutorialMessagesAlreadySeen");
+  serialize(writer, savedGame.mTutorialMessagesAlreadySeen);
+  writer.writeString("weapon");
+  writer.writeString(nameOf(WEAPON_TYPE_NAMES, savedGame.mWeapon));
 }
 
 
-nlohmann::json serialize(const data::SavedGame& savedGame) {
-  using json = nlohmann::json;
-
-  json serialized;
-  serialized["episode"] = savedGame.mSessionId.mEpisode;
-  serialized["level"] = savedGame.mSessionId.mLevel;
-  serialized["difficulty"] = savedGame.mSessionId.mDifficulty;
-  serialized["tutorialMessagesAlreadySeen"] =
-    serialize(savedGame.mTutorialMessagesAlreadySeen);
-  serialized["name"] = savedGame.mName;
-  serialized["weapon"] = savedGame.mWeapon;
-  serialized["ammo"] = savedGame.mAmmo;
-  serialized["score"] = savedGame.mScore;
-  return serialized;
+void serialize(
+  loader::MsgPackWriter& writer,
+  const data::HighScoreEntry& entry
+) {
+  writer.beginMap(2);
+  writer.writeString("name");
+  writer.writeString(entry.mName);
+  writer.writeString("score");
+  writer.writeInt(entry.mScore);
 }
 
 
-nlohmann::json serialize(const data::HighScoreEntry& entry) {
-  using json = nlohmann::json;
+data::TutorialMessageState deserializeTutorialMessages(
+  loader::MsgPackReader& reader
+) {
+  data::TutorialMessageState result;
+
+  const auto numMessageIds = reader.readArraySize();
+  for (std::size_t i = 0; i < numMessageIds; ++i) {
+    result.markAsShown(readEnum(reader, TUTORIAL_MESSAGE_ID_NAMES));
+  }
 
-  json serialized;
-  serialized["name"] = entry.mName;
-  serialized["score"] = entry.mScore;
-  return serialized;
+  return result;
 }
 
 
-data::SavedGame deserializeSavedGame(const nlohmann::json& json) {
+data::SavedGame deserializeSavedGame(loader::MsgPackReader& reader) {
   using namespace data;
 
+  std::optional<int> ammo;
+  std::optional<Difficulty> difficulty;
+  std::optional<int> episode;
+  std::optional<int> level;
+  std::optional<std::string> name;
+  std::optional<int> score;
+  std::optional<TutorialMessageState> tutorialMessagesAlreadySeen;
+  std::optional<WeaponType> weapon;
+
+  readMap(reader, [&](const std::string& key) {
+    if (key == "ammo") {
+      ammo = readInt(reader);
+    } else if (key == "difficulty") {
+      difficulty = readEnum(reader, DIFFICULTY_NAMES);
+    } else if (key == "episode") {
+      episode = readInt(reader);
+    } else if (key == "level") {
+      level = readInt(reader);
+    } else if (key == "name") {
+      name = reader.readString();
+    } else if (key == "score") {
+      score = readInt(reader);
+    } else if (key == "tutorialMessagesAlreadySeen") {
+      tutorialMessagesAlreadySeen = deserializeTutorialMessages(reader);
+    } else if (key == "weapon") {
+      weapon = readEnum(reader, WEAPON_TYPE_NAMES);
+    } else {
+      return false;
+    }
+
+    return true;
+  });
+
   // TODO: Does it make sense to share the clamping/validation code with the
   // user profile importer?
   data::SavedGame result;
   result.mSessionId.mEpisode = std::clamp(
-    json.at("episode").get<int>(), 0, NUM_EPISODES - 1);
+    required(episode, "episode"), 0, NUM_EPISODES - 1);
   result.mSessionId.mLevel = std::clamp(
-    json.at("level").get<int>(), 0, NUM_LEVELS_PER_EPISODE - 1);
-  result.mSessionId.mDifficulty = json.at("difficulty").get<data::Difficulty>();
-
-  const auto& messageIds = json.at("tutorialMessagesAlreadySeen");
-  for (const auto& messageId : messageIds) {
-    result.mTutorialMessagesAlreadySeen.markAsShown(
-      messageId.get<data::TutorialMessageId>());
-  }
-
-  result.mName = json.at("name").get<std::string>();
-  result.mWeapon = json.at("weapon").get<data::WeaponType>();
+    required(level, "level"), 0, NUM_LEVELS_PER_EPISODE - 1);
+  result.mSessionId.mDifficulty = required(difficulty, "difficulty");
+  result.mTutorialMessagesAlreadySeen = required(
+    tutorialMessagesAlreadySeen, "tutorialMessagesAlreadySeen");
+  result.mName = required(name, "name");
+  result.mWeapon = required(weapon, "weapon");
 
   const auto maxAmmo = result.mWeapon == WeaponType::FlameThrower
     ? MAX_AMMO_FLAME_THROWER
     : MAX_AMMO;
-  result.mAmmo = std::clamp(json.at("ammo").get<int>(), 0, maxAmmo);
-  result.mScore = std::clamp(json.at("score").get<int>(), 0, MAX_SCORE);
+  result.mAmmo = std::clamp(required(ammo, "ammo"), 0, maxAmmo);
+  result.mScore = std::clamp(required(score, "score"), 0, MAX_SCORE);
   return result;
 }
 
 
-data::HighScoreEntry deserializeHighScoreEntry(const nlohmann::json& json) {
+data::HighScoreEntry deserializeHighScoreEntry(loader::MsgPackReader& reader) {
+  std::optional<std::string> name;
+  std::optional<int> score;
+
+  readMap(reader, [&](const std::string& key) {
+    if (key == "name") {
+      name = reader.readString();
+    } else if (key == "score") {
+      score = readInt(reader);
+    } else {
+      return false;
+    }
+
+    return true;
+  });
+
   data::HighScoreEntry result;
 
-  result.mName = json.at("name").get<std::string>();
-  result.mScore = std::clamp(json.at("score").get<int>(), 0, data::MAX_SCORE);
+  result.mName = required(name, "name");
+  result.mScore = std::clamp(required(score, "score"), 0, data::MAX_SCORE);
 
   return result;
 }
 
 
-void saveToFile(const loader::ByteBuffer& buffer, const std::string& filename) {
-  std::ofstream file(filename, std::ios::binary);
-  if (!file.is_open()) {
-    std::cerr << "WARNING: Failed to store user profile\n";
-    return;
+struct ProfileData {
+  data::SaveSlotArray mSaveSlots;
+  std::array<data::HighScoreList, data::NUM_EPISODES> mHighScoreLists;
+};
+
+
+loader::ByteBuffer serialize(const ProfileData& profile) {
+  loader::MsgPackWriter writer;
+
+  writer.beginMap(2);
+
+  writer.writeString("highScoreLists");
+  writer.beginArray(profile.mHighScoreLists.size());
+  for (const auto& list : profile.mHighScoreLists) {
+    writer.beginArray(list.size());
+    for (const auto& entry : list) {
+      serialize(writer, entry);
+    }
+  }
+
+  writer.writeString("saveSlots");
+  writer.beginArray(profile.mSaveSlots.size());
+  for (const auto& slot : profile.mSaveSlots) {
+    if (slot) {
+      serialize(writer, *slot);
+    } else {
+      writer.writeNil();
+    }
   }
 
-  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  return writer.takeBuffer();
 }
 
+
+data::SaveSlotArray deserializeSaveSlots(loader::MsgPackReader& reader) {
+  data::SaveSlotArray result;
+
+  const auto numSlots = reader.readArraySize();
+  for (std::size_t i = 0; i < numSlots; ++i) {
+    if (i >= result.size()) {
+      reader.skipValue();
+    } else if (reader.peekType() == loader::MsgPackReader::Type::Nil) {
+      reader.readNil();
+    } else {
+      result[i] = deserializeSavedGame(reader);
+    }
+  }
+
+  return result;
 }
 
 
-UserProfile::UserProfile(const std::string& profilePath)
-  : mProfilePath(profilePath)
+data::HighScoreList deserializeHighScoreList(loader::MsgPackReader& reader) {
+  using std::begin;
+  using std::end;
+
+  data::HighScoreList result;
+
+  const auto numEntries = reader.readArraySize();
+  for (std::size_t i = 0; i < numEntries; ++i) {
+    if (i >= result.size()) {
+      reader.skipValue();
+    } else {
+      result[i] = deserializeHighScoreEntry(reader);
+    }
+  }
+
+  std::sort(begin(result), end(result));
+  return result;
+}
+
+
+std::array<data::HighScoreList, data::NUM_EPISODES>
+  deserializeHighScoreLists(loader::MsgPackReader& reader)
 {
+  std::array<data::HighScoreList, data::NUM_EPISODES> result;
+
+  const auto numLists = reader.readArraySize();
+  for (std::size_t i = 0; i < numLists; ++i) {
+    if (i >= result.size()) {
+      reader.skipValue();
+    } else {
+      result[i] = deserializeHighScoreList(reader);
+    }
+  }
+
+  return result;
 }
 
 
-void UserProfile::saveToDisk() {
-  if (!mProfilePath) {
-    return;
+/** Write buffer to a temporary file, then move that over filename */
+void saveToFile(const loader::ByteBuffer& buffer, const std::string& filename) {
+  namespace fs = std::filesystem;
+
+  const auto path = fs::u8path(filename);
+  auto tempPath = path;
+  tempPath += ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "WARNING: Failed to store user profile\n";
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    file.close();
+
+    if (!file) {
+      std::cerr << "WARNING: Failed to store user profile\n";
+      std::error_code ignored;
+      fs::remove(tempPath, ignored);
+      return;
+    }
   }
 
-  using json = nlohmann::json;
+  std::error_code error;
+  fs::rename(tempPath, path, error);
+  if (error) {
+    std::cerr << "WARNING: Failed to store user profile: "
+      << error.message() << '\n';
+  }
+}
 
-  json serializedProfile;
+}
 
-  // TODO: Refactor this long function into sub-functions
 
-  auto serializedSaveSlots = json::array();
-  for (const auto& slot : mSaveSlots) {
-    if (slot) {
-      serializedSaveSlots.push_back(serialize(*slot));
-    } else {
-      serializedSaveSlots.push_back(nullptr);
+/** Background thread writing profile data to disk
+ *
+ * Holds at most one pending write. Submitting new data while a write is
+ * pending replaces the pending data, so rapid successive saves result in
+ * a single write of the most recent state.
+ */
+class UserProfile::Writer {
+public:
+  explicit Writer(std::string profilePath)
+    : mProfilePath(std::move(profilePath))
+    , mThread([this]() { run(); })
+  {
+  }
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mShutDownRequested = true;
     }
+
+    mCondition.notify_one();
+    mThread.join();
   }
 
-  serializedProfile["saveSlots"] = serializedSaveSlots;
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
 
-  auto serializedHighScoreLists = json::array();
-  for (const auto& list : mHighScoreLists) {
-    auto serializedList = json::array();
-    for (const auto& entry : list) {
-      serializedList.push_back(serialize(entry));
+  void submit(ProfileData data) {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mPendingData = std::move(data);
     }
 
-    serializedHighScoreLists.push_back(serializedList);
+    mCondition.notify_one();
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;) {
+      mCondition.wait(
+        lock, [this]() { return mPendingData || mShutDownRequested; });
+
+      // Pending data is always written before shutting down
+      if (!mPendingData) {
+        return;
+      }
+
+      const auto data = std::move(*mPendingData);
+      mPendingData.reset();
+
+      lock.unlock();
+      saveToFile(serialize(data), mProfilePath);
+      lock.lock();
+    }
   }
 
-  serializedProfile["highScoreLists"] = serializedHighScoreLists;
+  std::string mProfilePath;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::optional<ProfileData> mPendingData;
+  bool mShutDownRequested = false;
+
+  // Must come last, the thread accesses the other members
+  std::thread mThread;
+};
+
+
+UserProfile::UserProfile() = default;
+
 
-  const auto buffer = json::to_msgpack(serializedProfile);
-  saveToFile(buffer, *mProfilePath);
+UserProfile::UserProfile(const std::string& profilePath)
+  : mProfilePath(profilePath)
+{
 }
 
 
-void UserProfile::loadFromDisk() {
-  using std::begin;
-  using std::end;
-  using std::sort;
+UserProfile::~UserProfile() = default;
+UserProfile::UserProfile(UserProfile&&) noexcept = default;
+UserProfile& UserProfile::operator=(UserProfile&&) noexcept = default;
+
+
+void UserProfile::saveToDisk() {
+  if (!mProfilePath) {
+    return;
+  }
+
+  if (!mpWriter) {
+    mpWriter = std::make_unique<Writer>(*mProfilePath);
+  }
+
+  mpWriter->submit(ProfileData{mSaveSlots, mHighScoreLists});
+}
+
 
+void UserProfile::loadFromDisk() {
   if (!mProfilePath) {
     return;
   }
@@ -257,50 +581,30 @@ void UserProfile::loadFromDisk() {
 
   try {
     const auto buffer = loader::loadFile(*mProfilePath);
-    const auto serializedProfile = nlohmann::json::from_msgpack(buffer);
-
-    const auto serializedSaveSlots = serializedProfile.at("saveSlots");
-
-    // TODO: Refactor this long function into sub-functions
-    {
-      std::size_t i = 0;
-      for (const auto& serializedSlot : serializedSaveSlots) {
-        if (!serializedSlot.is_null()) {
-          mSaveSlots[i] = deserializeSavedGame(serializedSlot);
-        }
-        ++i;
-        if (i >= mSaveSlots.size()) {
-          break;
-        }
+    loader::MsgPackReader reader{buffer};
+
+    std::optional<data::SaveSlotArray> saveSlots;
+    std::optional<std::array<data::HighScoreList, data::NUM_EPISODES>>
+      highScoreLists;
+
+    readMap(reader, [&](const std::string& key) {
+      if (key == "saveSlots") {
+        saveSlots = deserializeSaveSlots(reader);
+      } else if (key == "highScoreLists") {
+        highScoreLists = deserializeHighScoreLists(reader);
+      } else {
+        return false;
       }
-    }
 
-    const auto serializedHighScoreLists =
-      serializedProfile.at("highScoreLists");
+      return true;
+    });
 
-    {
-      std::size_t i = 0;
-      for (const auto& serializedList : serializedHighScoreLists) {
-        {
-          std::size_t j = 0;
-          for (const auto& serializedEntry : serializedList) {
-            mHighScoreLists[i][j] = deserializeHighScoreEntry(serializedEntry);
-
-            ++j;
-            if (j >= data::NUM_HIGH_SCORE_ENTRIES) {
-              break;
-            }
-          }
-        }
-
-        sort(begin(mHighScoreLists[i]), end(mHighScoreLists[i]));
-
-        ++i;
-        if (i >= mHighScoreLists.size()) {
-          break;
-        }
-      }
+    if (reader.hasData()) {
+      throw std::runtime_error("Unexpected trailing data in user profile");
     }
+
+    mSaveSlots = required(saveSlots, "saveSlots");
+    mHighScoreLists = required(highScoreLists, "highScoreLists");
   } catch (const std::exception& ex) {
     std::cerr << "WARNING: Failed to load user profile\n";
     std::cerr << ex.what() << '\n';
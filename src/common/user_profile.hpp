@@ -19,6 +19,7 @@
 #include "data/high_score_list.hpp"
 #include "data/saved_game.hpp"
 
+#include <memory>
 #include <string>
 
 
@@ -26,9 +27,23 @@ namespace rigel {
 
 class UserProfile {
 public:
-  UserProfile() = default;
+  UserProfile();
   explicit UserProfile(const std::string& profilePath);
-
+  ~UserProfile();
+
+  UserProfile(UserProfile&&) noexcept;
+  UserProfile& operator=(UserProfile&&) noexcept;
+
+  /** Write the profile to disk, in the background
+   *
+   * Takes a copy of the current state and hands it to a worker thread,
+   * which serializes it and writes it to a temporary file. That file then
+   * replaces the profile via rename, so that an interrupted write can't
+   * leave a truncated profile behind. If the worker is still busy, only the
+   * most recent state is written once it's done.
+   *
+   * Destroying the profile waits for any outstanding write to finish.
+   */
   void saveToDisk();
   void loadFromDisk();
 
@@ -36,7 +51,10 @@ public:
   std::array<data::HighScoreList, data::NUM_EPISODES> mHighScoreLists;
 
 private:
+  class Writer;
+
   std::optional<std::string> mProfilePath;
+  std::unique_ptr<Writer> mpWriter;
 };
 
 
@@ -107,4 +107,35 @@ struct GameTraits {
 };
 
 
+/** Size of the in-game view, can be changed at runtime
+ *
+ * The original game always shows GameTraits::mapViewPortSize tiles of the
+ * map, which is the default. A wider view shows more of the map. The HUD's
+ * right hand side panel moves over to stay at the view's edge, and the
+ * in-game area as a whole extends beyond the original 320x200 screen, by the
+ * same amount on the left and right.
+ */
+struct ViewPortSize {
+  base::Extents mapViewPortSize() const {
+    return {mMapWidthTiles, GameTraits::mapViewPortHeightTiles};
+  }
+
+  /** Size of map view and HUD together, in pixels */
+  base::Extents inGameViewPortSize() const {
+    return {
+      GameTraits::inGameViewPortSize.width + extraWidthPx(),
+      GameTraits::inGameViewPortSize.height};
+  }
+
+  /** How much wider the in-game area is compared to the original game */
+  int extraWidthPx() const {
+    return
+      (mMapWidthTiles - GameTraits::mapViewPortWidthTiles) *
+      GameTraits::tileSize;
+  }
+
+  int mMapWidthTiles = GameTraits::mapViewPortWidthTiles;
+};
+
+
 }
@@ -32,6 +32,9 @@ Image::Image(
   : mPixels(pixels)
   , mWidth(width)
   , mHeight(height)
+  , mTrackedBytes(
+      base::memory_accounting::Category::Images,
+      mPixels.size() * sizeof(Pixel))
 {
 }
 
@@ -44,6 +47,9 @@ Image::Image(
   : mPixels(std::move(pixels))
   , mWidth(width)
   , mHeight(height)
+  , mTrackedBytes(
+      base::memory_accounting::Category::Images,
+      mPixels.size() * sizeof(Pixel))
 {
 }
 
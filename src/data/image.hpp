@@ -17,6 +17,7 @@
 #pragma once
 
 #include "base/color.hpp"
+#include "base/memory_accounting.hpp"
 
 #include <cstdint>
 #include <vector>
@@ -61,6 +62,7 @@ private:
   PixelBuffer mPixels;
   std::size_t mWidth;
   std::size_t mHeight;
+  base::memory_accounting::TrackedBytes mTrackedBytes;
 };
 
 
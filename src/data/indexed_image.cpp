@@ -0,0 +1,85 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "indexed_image.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace rigel::data {
+
+using namespace std;
+
+
+IndexedImage::IndexedImage(
+  IndexBuffer&& indices,
+  const std::size_t width,
+  const std::size_t height
+)
+  : mIndices(std::move(indices))
+  , mWidth(width)
+  , mHeight(height)
+  , mTrackedBytes(
+      base::memory_accounting::Category::Images,
+      mIndices.size() * sizeof(PaletteIndex))
+{
+}
+
+
+IndexedImage::IndexedImage(const std::size_t width, const std::size_t height)
+  : IndexedImage(IndexBuffer(width*height, PaletteIndex{0}), width, height)
+{
+}
+
+
+void IndexedImage::insertImage(
+  const size_t x,
+  const size_t y,
+  const IndexedImage& image
+) {
+  if (x + image.width() > mWidth || y + image.height() > mHeight) {
+    throw invalid_argument("Source image doesn't fit");
+  }
+
+  auto sourceIter = image.indexData().cbegin();
+  for (size_t row=0; row<image.height(); ++row) {
+    const auto targetIter = mIndices.begin() + x + (y+row)*mWidth;
+    copy(sourceIter, sourceIter + image.width(), targetIter);
+    sourceIter += image.width();
+  }
+}
+
+
+Image IndexedImage::toRgba(const Palette16& palette) const {
+  // Covers all combinations of color index and transparency flag, so that
+  // each pixel is a single lookup
+  array<Pixel, TRANSPARENCY_FLAG * 2> lookupTable;
+  for (size_t i = 0; i < palette.size(); ++i) {
+    lookupTable[i] = palette[i];
+    lookupTable[i | TRANSPARENCY_FLAG] = palette[i];
+    lookupTable[i | TRANSPARENCY_FLAG].a = 0;
+  }
+
+  PixelBuffer pixels;
+  pixels.reserve(mIndices.size());
+  transform(mIndices.begin(), mIndices.end(), back_inserter(pixels),
+    [&](const PaletteIndex index) { return lookupTable[index]; });
+  return Image(std::move(pixels), mWidth, mHeight);
+}
+
+}
@@ -0,0 +1,79 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/memory_accounting.hpp"
+#include "data/image.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel::data {
+
+using PaletteIndex = std::uint8_t;
+using IndexBuffer = std::vector<PaletteIndex>;
+using Palette16 = std::array<Pixel, 16>;
+
+
+/** Image data in the form of palette indices
+ *
+ * This is how all of the original game's graphics are stored. Keeping
+ * images in this form takes a quarter of the memory of an Image, and lets
+ * us apply different palettes to the same image without decoding it again.
+ *
+ * Each pixel is one byte. The lower 4 bits refer to an entry in a Palette16,
+ * and TRANSPARENCY_FLAG is set for pixels which are masked out. Masked
+ * pixels keep their color index, since the original data has one as well.
+ */
+class IndexedImage {
+public:
+  static constexpr PaletteIndex TRANSPARENCY_FLAG = 0x10;
+
+  IndexedImage(IndexBuffer&& indices, std::size_t width, std::size_t height);
+  IndexedImage(std::size_t width, std::size_t height);
+
+  const IndexBuffer& indexData() const {
+    return mIndices;
+  }
+
+  std::size_t width() const {
+    return mWidth;
+  }
+
+  std::size_t height() const {
+    return mHeight;
+  }
+
+  void insertImage(std::size_t x, std::size_t y, const IndexedImage& image);
+
+  /** Create an RGBA version of the image using the given palette
+   *
+   * Transparent pixels get their palette color with an alpha of 0.
+   */
+  Image toRgba(const Palette16& palette) const;
+
+private:
+  IndexBuffer mIndices;
+  std::size_t mWidth;
+  std::size_t mHeight;
+  base::memory_accounting::TrackedBytes mTrackedBytes;
+};
+
+}
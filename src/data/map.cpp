@@ -28,21 +28,197 @@ namespace rigel::data::map {
 
 using namespace std;
 
+namespace {
+
+constexpr auto BITS_PER_WORD = std::size_t{64};
+
+// When the change journal is full, the older half of it is dropped
+constexpr auto MAX_JOURNALED_CHANGES = std::size_t{512};
+
+// Granularity of sharing tile data between copies of a map. Chunks always
+// consist of whole rows, so that Map::row() can hand out a contiguous view.
+// The number of rows is chosen to give roughly this many tiles per chunk.
+constexpr auto TILES_PER_CHUNK = std::size_t{1024};
+
+
+std::size_t wordsNeeded(const std::size_t numBits) {
+  return (numBits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+
+void setBit(
+  std::vector<std::uint64_t>& plane,
+  const std::size_t index,
+  const bool value
+) {
+  const auto mask = std::uint64_t{1} << (index % BITS_PER_WORD);
+  auto& word = plane[index / BITS_PER_WORD];
+  word = value ? (word | mask) : (word & ~mask);
+}
+
+
+/** Check if any bit in [first, last] is set, starting at pWords */
+bool isAnyBitSet(
+  const std::uint64_t* pWords,
+  const std::size_t first,
+  const std::size_t last
+) {
+  const auto firstWord = first / BITS_PER_WORD;
+  const auto lastWord = last / BITS_PER_WORD;
+
+  for (auto i = firstWord; i <= lastWord; ++i) {
+    auto mask = ~std::uint64_t{0};
+    if (i == firstWord) {
+      mask &= ~std::uint64_t{0} << (first % BITS_PER_WORD);
+    }
+    if (i == lastWord) {
+      mask &= ~std::uint64_t{0} >> (BITS_PER_WORD - 1 - last % BITS_PER_WORD);
+    }
+
+    if ((pWords[i] & mask) != 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+/** Find the lowest set bit in [first, last], starting at pWords */
+std::optional<std::size_t> findFirstSetBit(
+  const std::uint64_t* pWords,
+  const std::size_t first,
+  const std::size_t last
+) {
+  const auto firstWord = first / BITS_PER_WORD;
+  const auto lastWord = last / BITS_PER_WORD;
+
+  for (auto i = firstWord; i <= lastWord; ++i) {
+    auto mask = ~std::uint64_t{0};
+    if (i == firstWord) {
+      mask &= ~std::uint64_t{0} << (first % BITS_PER_WORD);
+    }
+    if (i == lastWord) {
+      mask &= ~std::uint64_t{0} >> (BITS_PER_WORD - 1 - last % BITS_PER_WORD);
+    }
+
+    const auto word = pWords[i] & mask;
+    if (word != 0) {
+      auto bit = std::size_t{0};
+      while ((word & (std::uint64_t{1} << bit)) == 0) {
+        ++bit;
+      }
+
+      return i * BITS_PER_WORD + bit;
+    }
+  }
+
+  return std::nullopt;
+}
+
+
+bool hasFeatureAttribute(
+  const TileAttributes& attributes,
+  const TileFeature feature
+) {
+  switch (feature) {
+    case TileFeature::ConveyorBeltLeft:
+      return attributes.isConveyorBeltLeft();
+
+    case TileFeature::ConveyorBeltRight:
+      return attributes.isConveyorBeltRight();
+
+    case TileFeature::Ladder:
+      return attributes.isLadder();
+
+    case TileFeature::Climbable:
+      return attributes.isClimbable();
+  }
+
+  return false;
+}
+
+
+constexpr TileFeature ALL_FEATURES[] = {
+  TileFeature::ConveyorBeltLeft,
+  TileFeature::ConveyorBeltRight,
+  TileFeature::Ladder,
+  TileFeature::Climbable
+};
+
+
+bool touches(const base::Rect<int>& lhs, const base::Rect<int>& rhs) {
+  return
+    lhs.left() <= rhs.right() + 1 && rhs.left() <= lhs.right() + 1 &&
+    lhs.top() <= rhs.bottom() + 1 && rhs.top() <= lhs.bottom() + 1;
+}
+
+
+base::Rect<int> boundingRect(
+  const base::Rect<int>& lhs,
+  const base::Rect<int>& rhs
+) {
+  const auto left = std::min(lhs.left(), rhs.left());
+  const auto top = std::min(lhs.top(), rhs.top());
+  const auto right = std::max(lhs.right(), rhs.right());
+  const auto bottom = std::max(lhs.bottom(), rhs.bottom());
+  return {{left, top}, {right - left + 1, bottom - top + 1}};
+}
+
+
+int area(const base::Rect<int>& rect) {
+  return rect.size.width * rect.size.height;
+}
+
+}
+
 
 Map::Map(
   const int widthInTiles,
   const int heightInTiles,
   TileAttributeDict attributes
 )
-  : mLayers({
-      TileArray(widthInTiles*heightInTiles, 0),
-      TileArray(widthInTiles*heightInTiles, 0)})
+  : mpAttributes(
+      std::make_shared<const TileAttributeDict>(std::move(attributes)))
   , mWidthInTiles(static_cast<size_t>(widthInTiles))
   , mHeightInTiles(static_cast<size_t>(heightInTiles))
-  , mAttributes(std::move(attributes))
 {
   assert(widthInTiles >= 0);
   assert(heightInTiles >= 0);
+
+  mRowsPerChunk = static_cast<int>(
+    std::max(TILES_PER_CHUNK / std::max(mWidthInTiles, size_t{1}), size_t{1}));
+
+  for (auto& rows : mRows) {
+    rows.resize(mHeightInTiles, nullptr);
+  }
+
+  for (auto firstRow = 0; firstRow < heightInTiles; firstRow += mRowsPerChunk) {
+    const auto numRows = std::min(mRowsPerChunk, heightInTiles - firstRow);
+    const auto numTiles = static_cast<size_t>(numRows) * mWidthInTiles;
+
+    mChunks.push_back(std::make_shared<TileChunk>(
+      TileChunk{{TileArray(numTiles, 0), TileArray(numTiles, 0)}}));
+    updateRowPointers(mChunks.size() - 1);
+  }
+
+  mWordsPerRow = wordsNeeded(mWidthInTiles);
+  mWordsPerColumn = wordsNeeded(mHeightInTiles);
+  for (auto& plane : mpBitPlanes->mTopBottom) {
+    plane.resize(mWordsPerRow * mHeightInTiles, 0);
+  }
+  for (auto& plane : mpBitPlanes->mLeftRight) {
+    plane.resize(mWordsPerColumn * mWidthInTiles, 0);
+  }
+  for (auto& plane : mpBitPlanes->mFeatures) {
+    plane.resize(mWordsPerRow * mHeightInTiles, 0);
+  }
+
+  for (auto y = 0; y < heightInTiles; ++y) {
+    for (auto x = 0; x < widthInTiles; ++x) {
+      updateBitPlanes(x, y);
+    }
+  }
 }
 
 
@@ -51,7 +227,8 @@ map::TileIndex Map::tileAt(
   const int x,
   const int y
 ) const {
-  return tileRefAt(layer, x, y);
+  checkCoordinates(layer, x, y);
+  return tileAtUnchecked(layer, x, y);
 }
 
 
@@ -64,7 +241,12 @@ void Map::setTileAt(
   if (index >= GameTraits::CZone::numTilesTotal) {
     throw invalid_argument("Tile index too large for tile set");
   }
-  tileRefAt(layer, x, y) = index;
+
+  checkCoordinates(layer, x, y);
+  rememberOriginalTiles(x, y);
+  mutableRow(layer, y)[x] = index;
+  updateBitPlanes(x, y);
+  recordChange({{x, y}, {1, 1}});
 }
 
 
@@ -83,8 +265,48 @@ void Map::clearSection(
 }
 
 
+void Map::setRestorePoint() {
+  mOriginalTiles.clear();
+  mHasOriginalTiles.assign(mWidthInTiles * mHeightInTiles, false);
+}
+
+
+void Map::revertToRestorePoint() {
+  assert(!mHasOriginalTiles.empty());
+
+  for (const auto& original : mOriginalTiles) {
+    const auto x = static_cast<int>(original.mOffset % mWidthInTiles);
+    const auto y = static_cast<int>(original.mOffset / mWidthInTiles);
+
+    for (auto layer = 0; layer < int(mRows.size()); ++layer) {
+      mutableRow(layer, y)[x] = original.mTiles[layer];
+    }
+
+    updateBitPlanes(x, y);
+    recordChange({{x, y}, {1, 1}});
+    mHasOriginalTiles[original.mOffset] = false;
+  }
+
+  mOriginalTiles.clear();
+}
+
+
+void Map::restoreTilesFrom(const Map& copy) {
+  assert(copy.mWidthInTiles == mWidthInTiles);
+  assert(copy.mHeightInTiles == mHeightInTiles);
+
+  mChunks = copy.mChunks;
+  mRows = copy.mRows;
+  mpBitPlanes = copy.mpBitPlanes;
+  mOriginalTiles = copy.mOriginalTiles;
+  mHasOriginalTiles = copy.mHasOriginalTiles;
+
+  recordChange({{0, 0}, {width(), height()}});
+}
+
+
 const TileAttributeDict& Map::attributeDict() const {
-  return mAttributes;
+  return *mpAttributes;
 }
 
 
@@ -97,17 +319,50 @@ TileAttributes Map::attributes(const int x, const int y) const {
     return TileAttributes{};
   }
 
-  if (tileAt(0, x, y) != 0 && tileAt(1, x, y) != 0) {
+  const auto tile0 = tileAtUnchecked(0, x, y);
+  const auto tile1 = tileAtUnchecked(1, x, y);
+  if (tile0 != 0 && tile1 != 0) {
     // "Composite" tiles (content on both layers) are ignored for attribute
     // checking
     return TileAttributes{};
   }
 
-  if (tileAt(1, x, y) != 0) {
-    return TileAttributes{mAttributes.attributes(tileAt(1, x, y))};
+  if (tile1 != 0) {
+    return TileAttributes{mpAttributes->attributes(tile1)};
   }
 
-  return TileAttributes{mAttributes.attributes(tileAt(0, x, y))};
+  return TileAttributes{mpAttributes->attributes(tile0)};
+}
+
+
+TileAttributes Map::combinedAttributesInRow(
+  const int y,
+  const int startX,
+  const int endX
+) const {
+  if (static_cast<std::size_t>(y) >= mHeightInTiles) {
+    return TileAttributes{};
+  }
+
+  const auto first = std::max(startX, 0);
+  const auto last = std::min(endX, static_cast<int>(mWidthInTiles) - 1);
+
+  const auto pBitPacks = mpAttributes->attributeBitPacks().data();
+  const auto pLayer0 = mRows[0][y];
+  const auto pLayer1 = mRows[1][y];
+
+  // Same rules as in attributes(), written without branches so that the
+  // compiler can vectorize the loop
+  auto result = std::uint16_t{0};
+  for (auto x = first; x <= last; ++x) {
+    const auto tile0 = pLayer0[x];
+    const auto tile1 = pLayer1[x];
+    const auto isComposite = tile0 != 0 && tile1 != 0;
+    const auto bitPack = pBitPacks[tile1 != 0 ? tile1 : tile0];
+    result |= isComposite ? std::uint16_t{0} : bitPack;
+  }
+
+  return TileAttributes{result};
 }
 
 
@@ -122,19 +377,127 @@ CollisionData Map::collisionData(const int x, const int y) const {
     return CollisionData{};
   }
 
-  if (tileAt(0, x, y) != 0 && tileAt(1, x, y) != 0) {
+  return computeCollisionData(x, y);
+}
+
+
+bool Map::isAnyTileSolidInRow(
+  const int y,
+  const int startX,
+  const int endX,
+  const SolidEdge edge
+) const {
+  assert(edge == SolidEdge::top() || edge == SolidEdge::bottom());
+
+  if (startX > endX) {
+    return false;
+  }
+
+  // Same rules regarding the map's edges as in collisionData()
+  if (startX < 0 || static_cast<std::size_t>(endX) >= mWidthInTiles) {
+    return true;
+  }
+
+  if (static_cast<std::size_t>(y) >= mHeightInTiles) {
+    return false;
+  }
+
+  const auto& plane =
+    mpBitPlanes->mTopBottom[edge == SolidEdge::top() ? 0 : 1];
+  return isAnyBitSet(&plane[y * mWordsPerRow], startX, endX);
+}
+
+
+bool Map::isAnyTileSolidInColumn(
+  const int x,
+  const int startY,
+  const int endY,
+  const SolidEdge edge
+) const {
+  assert(edge == SolidEdge::left() || edge == SolidEdge::right());
+
+  if (startY > endY) {
+    return false;
+  }
+
+  // Same rules regarding the map's edges as in collisionData()
+  if (static_cast<std::size_t>(x) >= mWidthInTiles) {
+    return true;
+  }
+
+  const auto first = std::max(startY, 0);
+  const auto last = std::min(endY, static_cast<int>(mHeightInTiles) - 1);
+  if (first > last) {
+    return false;
+  }
+
+  const auto& plane =
+    mpBitPlanes->mLeftRight[edge == SolidEdge::left() ? 0 : 1];
+  return isAnyBitSet(&plane[x * mWordsPerColumn], first, last);
+}
+
+
+bool Map::hasFeature(
+  const int x,
+  const int y,
+  const TileFeature feature
+) const {
+  if (
+    static_cast<std::size_t>(x) >= mWidthInTiles ||
+    static_cast<std::size_t>(y) >= mHeightInTiles
+  ) {
+    return false;
+  }
+
+  const auto& plane = mpBitPlanes->mFeatures[static_cast<int>(feature)];
+  const auto index = y * mWordsPerRow * BITS_PER_WORD + x;
+  return (plane[index / BITS_PER_WORD] &
+    (std::uint64_t{1} << (index % BITS_PER_WORD))) != 0;
+}
+
+
+std::optional<int> Map::findFeatureInRow(
+  const int y,
+  const int startX,
+  const int endX,
+  const TileFeature feature
+) const {
+  if (static_cast<std::size_t>(y) >= mHeightInTiles) {
+    return std::nullopt;
+  }
+
+  const auto first = std::max(startX, 0);
+  const auto last = std::min(endX, static_cast<int>(mWidthInTiles) - 1);
+  if (first > last) {
+    return std::nullopt;
+  }
+
+  const auto& plane = mpBitPlanes->mFeatures[static_cast<int>(feature)];
+  const auto maybeIndex = findFirstSetBit(&plane[y * mWordsPerRow], first, last);
+  if (!maybeIndex) {
+    return std::nullopt;
+  }
+
+  return static_cast<int>(*maybeIndex);
+}
+
+
+CollisionData Map::computeCollisionData(const int x, const int y) const {
+  const auto tile0 = tileAtUnchecked(0, x, y);
+  const auto tile1 = tileAtUnchecked(1, x, y);
+  if (tile0 != 0 && tile1 != 0) {
     // "Composite" tiles (content on both layers) are ignored for collision
     // checking
     return CollisionData{};
   }
 
-  const auto data1 = mAttributes.collisionData(tileAt(0, x, y));
-  const auto data2 = mAttributes.collisionData(tileAt(1, x, y));
+  const auto data1 = mpAttributes->collisionData(tile0);
+  const auto data2 = mpAttributes->collisionData(tile1);
   return CollisionData{data1, data2};
 }
 
 
-const map::TileIndex& Map::tileRefAt(
+void Map::checkCoordinates(
   const int layerS,
   const int xS,
   const int yS
@@ -143,7 +506,7 @@ const map::TileIndex& Map::tileRefAt(
   const auto x = static_cast<size_t>(xS);
   const auto y = static_cast<size_t>(yS);
 
-  if (layer >= mLayers.size()) {
+  if (layer >= mRows.size()) {
     throw invalid_argument("Layer index out of bounds");
   }
   if (x >= mWidthInTiles) {
@@ -152,17 +515,117 @@ const map::TileIndex& Map::tileRefAt(
   if (y >= mHeightInTiles) {
     throw invalid_argument("Y coord out of bounds");
   }
-  return mLayers[layer][x + y*mWidthInTiles];
 }
 
 
-map::TileIndex& Map::tileRefAt(
-  const int layer,
-  const int x,
-  const int y
-) {
-  return const_cast<map::TileIndex&>(
-    static_cast<const Map&>(*this).tileRefAt(layer, x, y));
+map::TileIndex* Map::mutableRow(const int layer, const int y) {
+  const auto chunkIndex = static_cast<size_t>(y / mRowsPerChunk);
+  auto& pChunk = mChunks[chunkIndex];
+
+  // If we are the only owner, nobody else can gain access to the chunk
+  // without going through this map. This relies on all copies sharing the
+  // chunk living on the same thread, see the class documentation.
+  if (pChunk.use_count() > 1) {
+    pChunk = std::make_shared<TileChunk>(*pChunk);
+    updateRowPointers(chunkIndex);
+  }
+
+  const auto rowInChunk = static_cast<size_t>(y % mRowsPerChunk);
+  return pChunk->mLayers[layer].data() + rowInChunk * mWidthInTiles;
+}
+
+
+Map::BitPlanes& Map::mutableBitPlanes() {
+  if (mpBitPlanes.use_count() > 1) {
+    mpBitPlanes = std::make_shared<BitPlanes>(*mpBitPlanes);
+  }
+
+  return *mpBitPlanes;
+}
+
+
+void Map::updateRowPointers(const std::size_t chunkIndex) {
+  const auto& chunk = *mChunks[chunkIndex];
+  const auto firstRow = chunkIndex * mRowsPerChunk;
+  const auto numRows = std::min(
+    static_cast<size_t>(mRowsPerChunk), mHeightInTiles - firstRow);
+
+  for (auto layer = 0u; layer < mRows.size(); ++layer) {
+    for (auto row = size_t{0}; row < numRows; ++row) {
+      mRows[layer][firstRow + row] =
+        chunk.mLayers[layer].data() + row * mWidthInTiles;
+    }
+  }
+}
+
+
+void Map::updateBitPlanes(const int x, const int y) {
+  const auto data = computeCollisionData(x, y);
+  auto& planes = mutableBitPlanes();
+
+  const auto indexInRow = y * mWordsPerRow * BITS_PER_WORD + x;
+  setBit(planes.mTopBottom[0], indexInRow, data.isSolidOn(SolidEdge::top()));
+  setBit(
+    planes.mTopBottom[1], indexInRow, data.isSolidOn(SolidEdge::bottom()));
+
+  const auto indexInColumn = x * mWordsPerColumn * BITS_PER_WORD + y;
+  setBit(
+    planes.mLeftRight[0], indexInColumn, data.isSolidOn(SolidEdge::left()));
+  setBit(
+    planes.mLeftRight[1], indexInColumn, data.isSolidOn(SolidEdge::right()));
+
+  const auto tileAttributes = attributes(x, y);
+  for (const auto feature : ALL_FEATURES) {
+    setBit(
+      planes.mFeatures[static_cast<int>(feature)],
+      indexInRow,
+      hasFeatureAttribute(tileAttributes, feature));
+  }
+}
+
+
+void Map::rememberOriginalTiles(const int x, const int y) {
+  if (mHasOriginalTiles.empty()) {
+    return;
+  }
+
+  const auto offset = static_cast<std::uint32_t>(x + y * mWidthInTiles);
+  if (!mHasOriginalTiles[offset]) {
+    mHasOriginalTiles[offset] = true;
+    mOriginalTiles.push_back(OriginalTiles{
+      offset, {tileAtUnchecked(0, x, y), tileAtUnchecked(1, x, y)}});
+  }
+}
+
+
+void Map::recordChange(const base::Rect<int>& section) {
+  ++mChangeRevision;
+
+  // Modifications usually come in runs of neighboring tiles, like when
+  // clearing a section tile by tile. Growing the most recent entry keeps
+  // the journal short, at the price of sometimes reporting a few
+  // unmodified tiles as well.
+  if (!mChangeJournal.empty()) {
+    auto& previous = mChangeJournal.back();
+    const auto merged = boundingRect(previous.mSection, section);
+    if (
+      touches(previous.mSection, section) &&
+      area(merged) <= 2 * (area(previous.mSection) + area(section))
+    ) {
+      previous.mSection = merged;
+      previous.mRevision = mChangeRevision;
+      return;
+    }
+  }
+
+  if (mChangeJournal.size() == MAX_JOURNALED_CHANGES) {
+    const auto numToDrop = MAX_JOURNALED_CHANGES / 2;
+    mOldestJournaledRevision = mChangeJournal[numToDrop - 1].mRevision;
+    mChangeJournal.erase(
+      mChangeJournal.begin(), mChangeJournal.begin() + numToDrop);
+  }
+
+  mChangeJournal.push_back(Change{section, mChangeRevision});
 }
 
 
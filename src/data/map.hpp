@@ -16,12 +16,17 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
 #include "base/spatial_types.hpp"
 #include "data/actor_ids.hpp"
 #include "data/tile_attributes.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -45,6 +50,29 @@ enum class BackdropSwitchCondition {
 };
 
 
+/** Tile attributes which the map keeps a precomputed bit plane for */
+enum class TileFeature {
+  ConveyorBeltLeft,
+  ConveyorBeltRight,
+  Ladder,
+  Climbable
+};
+
+
+/** Two layers of tiles, plus attributes for the tiles in the tile set
+ *
+ * Tile data is stored in chunks of consecutive rows. Copies of a map share
+ * all chunks, as well as the attribute dictionary and the collision data
+ * derived from the tiles, until they are modified. Copying a map is thus
+ * cheap, and a copy only costs memory for the parts where it differs from
+ * the original.
+ *
+ * Whether a chunk needs to be copied before modifying it is decided based on
+ * its use count, which is not synchronized with other threads. A map and all
+ * copies made from it (directly or indirectly) must therefore only be used
+ * on a single thread. To use a map on another thread, load it separately
+ * there instead of copying it.
+ */
 class Map {
 public:
   Map() = default;
@@ -52,6 +80,41 @@ public:
 
   TileIndex tileAt(int layer, int x, int y) const;
 
+  /** Like tileAt(), but without range checking
+   *
+   * For use in inner loops which already know that their coordinates are
+   * within the map. The arguments are only checked via assertions.
+   */
+  TileIndex tileAtUnchecked(const int layer, const int x, const int y) const {
+    assert(layer >= 0 && layer < int(mRows.size()));
+    assert(x >= 0 && x < width());
+    assert(y >= 0 && y < height());
+    return mRows[layer][y][x];
+  }
+
+  /** View of all tiles in the given row of a layer
+   *
+   * Not range checked, y must be within the map.
+   */
+  base::ArrayView<TileIndex> row(const int layer, const int y) const {
+    assert(layer >= 0 && layer < int(mRows.size()));
+    assert(y >= 0 && y < height());
+    return {
+      mRows[layer][y],
+      static_cast<base::ArrayView<TileIndex>::size_type>(mWidthInTiles)};
+  }
+
+  /** Invoke callback(x, y, tileIndex) for each tile of a layer in rect
+   *
+   * The rect is clipped against the map once up front, tiles outside of the
+   * map are skipped.
+   */
+  template <typename Callback>
+  void forEachTileInRect(
+    int layer,
+    const base::Rect<int>& rect,
+    Callback&& callback) const;
+
   void setTileAt(int layer, int x, int y, TileIndex index);
 
   int width() const {
@@ -64,26 +127,222 @@ public:
 
   void clearSection(int x, int y, int width, int height);
 
+  /** Change counter for the whole map
+   *
+   * Incremented whenever a tile is modified. Together with
+   * forEachChangeSince(), this allows keeping derived data (like a copy of
+   * the map on the GPU) up to date without having to compare the whole map.
+   */
+  std::uint32_t changeRevision() const {
+    return mChangeRevision;
+  }
+
+  /** Invoke callback(section) for each section modified after revision
+   *
+   * The map keeps a journal of the most recent modifications, with adjacent
+   * changes merged into a single rect. The reported sections cover at least
+   * all tiles modified since the given revision, but might include some
+   * more. With the same revision, the same sections are reported again.
+   *
+   * Returns false if the journal doesn't go back far enough. In that case,
+   * the callback isn't invoked at all, and the caller needs to treat the
+   * whole map as modified.
+   */
+  template <typename Callback>
+  bool forEachChangeSince(std::uint32_t revision, Callback&& callback) const;
+
+  /** Remember the current state of the map, to be restored later
+   *
+   * From now on, the original tiles of all modified locations are recorded,
+   * so that revertToRestorePoint() only needs to touch those. Replaces any
+   * previously set restore point.
+   */
+  void setRestorePoint();
+
+  /** Undo all modifications made since the last call to setRestorePoint()
+   *
+   * Restored tiles show up as modifications in the change journal, like any
+   * other change. The restore point stays in place.
+   */
+  void revertToRestorePoint();
+
+  /** Replace all tiles with those of a previously made copy of this map
+   *
+   * The copy's restore point is taken over as well. Unlike assigning the
+   * copy, this keeps the change journal going, reporting the whole map as
+   * modified. No tile data is copied, both maps share the chunks until one
+   * of them is modified again.
+   */
+  void restoreTilesFrom(const Map& copy);
+
   const TileAttributeDict& attributeDict() const;
   TileAttributes attributes(int x, int y) const;
 
+  /** Bitwise OR of attributes(x, y) for each x in [startX, endX]
+   *
+   * Follows the same rules as attributes(), but looks up a whole row section
+   * at once. Tiles outside of the map don't contribute anything.
+   */
+  TileAttributes combinedAttributesInRow(int y, int startX, int endX) const;
+
   CollisionData collisionData(int x, int y) const;
 
+  /** Check if any tile in the given row section is solid on the given edge
+   *
+   * Equivalent to testing collisionData(x, y).isSolidOn(edge) for each x in
+   * [startX, endX], but operates on many tiles at once. Only the top and
+   * bottom edges can be tested this way.
+   */
+  bool isAnyTileSolidInRow(int y, int startX, int endX, SolidEdge edge) const;
+
+  /** Check if any tile in the given column section is solid on the given edge
+   *
+   * Like isAnyTileSolidInRow(), but for the left and right edges.
+   */
+  bool isAnyTileSolidInColumn(
+    int x,
+    int startY,
+    int endY,
+    SolidEdge edge) const;
+
+  /** Check if the tile at the given location has the given feature
+   *
+   * Equivalent to testing the corresponding attribute of attributes(x, y),
+   * but only needs a single bit lookup.
+   */
+  bool hasFeature(int x, int y, TileFeature feature) const;
+
+  /** Find the left-most tile in the given row section with the given feature
+   *
+   * Returns the tile's x coordinate, or nothing if no tile in [startX, endX]
+   * has the feature. Tiles outside of the map never have any features.
+   */
+  std::optional<int> findFeatureInRow(
+    int y,
+    int startX,
+    int endX,
+    TileFeature feature) const;
+
 private:
-  const TileIndex& tileRefAt(int layer, int x, int y) const;
-  TileIndex& tileRefAt(int layer, int x, int y);
+  struct TileChunk;
+  struct BitPlanes;
+
+  void checkCoordinates(int layer, int x, int y) const;
+  TileIndex* mutableRow(int layer, int y);
+  BitPlanes& mutableBitPlanes();
+  void updateRowPointers(std::size_t chunkIndex);
+
+  CollisionData computeCollisionData(int x, int y) const;
+  void updateBitPlanes(int x, int y);
+
+  void rememberOriginalTiles(int x, int y);
+  void recordChange(const base::Rect<int>& section);
 
 private:
   using TileArray = std::vector<TileIndex>;
-  std::array<TileArray, 2> mLayers;
+  using BitPlane = std::vector<std::uint64_t>;
 
-  std::size_t mWidthInTiles;
-  std::size_t mHeightInTiles;
+  struct Change {
+    base::Rect<int> mSection;
+    std::uint32_t mRevision;
+  };
+
+  struct OriginalTiles {
+    std::uint32_t mOffset;
+    std::array<TileIndex, 2> mTiles;
+  };
+
+  struct TileChunk {
+    std::array<TileArray, 2> mLayers;
+  };
+
+  // Derived from the tile layers: One bit per tile for each solid edge, kept
+  // up to date by setTileAt(). Top/bottom solidity is only ever tested along
+  // rows, and left/right solidity along columns, so the former planes are
+  // stored row by row and the latter column by column. This way, a span of
+  // tiles always occupies consecutive bits.
+  // The feature planes hold one bit per tile for each TileFeature, following
+  // the same rules as attributes(). They are stored row by row.
+  struct BitPlanes {
+    std::array<BitPlane, 2> mTopBottom;
+    std::array<BitPlane, 2> mLeftRight;
+    std::array<BitPlane, 4> mFeatures;
+  };
+
+  // Chunks and bit planes are shared with copies of the map. Before
+  // modifying them, mutableRow() and mutableBitPlanes() make a private
+  // copy if needed.
+  std::vector<std::shared_ptr<TileChunk>> mChunks;
+  std::shared_ptr<BitPlanes> mpBitPlanes =
+    std::make_shared<BitPlanes>();
+  std::shared_ptr<const TileAttributeDict> mpAttributes =
+    std::make_shared<const TileAttributeDict>();
+
+  // Start of each row within the chunks, per layer
+  std::array<std::vector<const TileIndex*>, 2> mRows;
+  int mRowsPerChunk = 1;
+
+  // Most recent modifications, in order of increasing revision. All changes
+  // made after mOldestJournaledRevision are contained.
+  std::vector<Change> mChangeJournal;
+  std::uint32_t mChangeRevision = 0;
+  std::uint32_t mOldestJournaledRevision = 0;
+
+  // Tiles as they were when setRestorePoint() was called, for each location
+  // modified since then. mHasOriginalTiles is empty if there's no restore
+  // point.
+  std::vector<OriginalTiles> mOriginalTiles;
+  std::vector<bool> mHasOriginalTiles;
+
+  std::size_t mWordsPerRow = 0;
+  std::size_t mWordsPerColumn = 0;
 
-  TileAttributeDict mAttributes;
+  std::size_t mWidthInTiles = 0;
+  std::size_t mHeightInTiles = 0;
 };
 
 
+template <typename Callback>
+void Map::forEachTileInRect(
+  const int layer,
+  const base::Rect<int>& rect,
+  Callback&& callback
+) const {
+  const auto startX = std::max(rect.left(), 0);
+  const auto startY = std::max(rect.top(), 0);
+  const auto endX = std::min(rect.left() + rect.size.width, width());
+  const auto endY = std::min(rect.top() + rect.size.height, height());
+
+  for (auto y = startY; y < endY; ++y) {
+    const auto tiles = row(layer, y);
+    for (auto x = startX; x < endX; ++x) {
+      callback(x, y, tiles[x]);
+    }
+  }
+}
+
+
+template <typename Callback>
+bool Map::forEachChangeSince(
+  const std::uint32_t revision,
+  Callback&& callback
+) const {
+  if (revision < mOldestJournaledRevision) {
+    return false;
+  }
+
+  const auto firstNewChange = std::partition_point(
+    mChangeJournal.begin(),
+    mChangeJournal.end(),
+    [revision](const Change& change) { return change.mRevision <= revision; });
+  for (auto it = firstNewChange; it != mChangeJournal.end(); ++it) {
+    callback(it->mSection);
+  }
+
+  return true;
+}
+
+
 struct LevelData {
   struct Actor {
     base::Vector mPosition;
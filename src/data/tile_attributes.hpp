@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
 #include "image.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 
@@ -29,15 +31,19 @@ using TileIndex = std::uint32_t;
 
 class SolidEdge {
 public:
-  static SolidEdge top();
-  static SolidEdge bottom();
-  static SolidEdge left();
-  static SolidEdge right();
+  static constexpr SolidEdge top();
+  static constexpr SolidEdge bottom();
+  static constexpr SolidEdge left();
+  static constexpr SolidEdge right();
+
+  constexpr bool operator==(const SolidEdge& other) const {
+    return mFlagsBitPack == other.mFlagsBitPack;
+  }
 
   friend class CollisionData;
 
 private:
-  explicit SolidEdge(const std::uint8_t bitPack)
+  constexpr explicit SolidEdge(const std::uint8_t bitPack)
     : mFlagsBitPack(bitPack)
   {
   }
@@ -48,16 +54,20 @@ private:
 
 class CollisionData {
 public:
-  static CollisionData fullySolid();
+  static constexpr CollisionData fullySolid();
 
-  CollisionData() = default;
-  CollisionData(const std::initializer_list<CollisionData>& items);
-  explicit CollisionData(std::uint8_t flagsBitPack);
+  constexpr CollisionData() = default;
+  constexpr CollisionData(const std::initializer_list<CollisionData>& items);
+  constexpr explicit CollisionData(std::uint8_t flagsBitPack);
 
-  bool isSolidOn(const SolidEdge& edge) const {
+  constexpr bool isSolidOn(const SolidEdge& edge) const {
     return (mCollisionFlagsBitPack & edge.mFlagsBitPack) != 0;
   }
 
+  constexpr std::uint8_t bitPack() const {
+    return mCollisionFlagsBitPack;
+  }
+
 private:
   std::uint8_t mCollisionFlagsBitPack = 0;
 };
@@ -65,26 +75,41 @@ private:
 
 class TileAttributes {
 public:
-  TileAttributes() = default;
-  explicit TileAttributes(std::uint16_t attributesBitPack);
-
-  bool isAnimated() const;
-  bool isFastAnimation() const;
-  bool isForeGround() const;
-  bool isLadder() const;
-  bool isClimbable() const;
-  bool isConveyorBeltLeft() const;
-  bool isConveyorBeltRight() const;
-  bool isFlammable() const;
+  constexpr TileAttributes() = default;
+  constexpr explicit TileAttributes(std::uint16_t attributesBitPack);
+
+  constexpr bool isAnimated() const;
+  constexpr bool isFastAnimation() const;
+  constexpr bool isForeGround() const;
+  constexpr bool isLadder() const;
+  constexpr bool isClimbable() const;
+  constexpr bool isConveyorBeltLeft() const;
+  constexpr bool isConveyorBeltRight() const;
+  constexpr bool isFlammable() const;
+
+  constexpr std::uint16_t bitPack() const {
+    return mAttributesBitPack;
+  }
 
 private:
   std::uint16_t mAttributesBitPack = 0;
 };
 
 
+/** Attributes and collision data for all tiles of a tile set
+ *
+ * Both are kept in flat arrays indexed by tile index, one attribute word and
+ * one collision byte per tile. The collision bytes are extracted from the
+ * attribute words once up front, so that lookups don't need to decode
+ * anything. Code which needs to look at many tiles at once can use the raw
+ * arrays directly, via attributeBitPacks() and collisionBitPacks(). The
+ * values can be decoded with TileAttributes and CollisionData, which also
+ * works at compile time.
+ */
 class TileAttributeDict {
 public:
   using AttributeArray = std::vector<std::uint16_t>;
+  using CollisionArray = std::vector<std::uint8_t>;
 
   TileAttributeDict() = default;
   explicit TileAttributeDict(const AttributeArray& bitpacks);
@@ -93,11 +118,15 @@ public:
   TileAttributes attributes(TileIndex tile) const;
   CollisionData collisionData(TileIndex tile) const;
 
+  base::ArrayView<std::uint16_t> attributeBitPacks() const;
+  base::ArrayView<std::uint8_t> collisionBitPacks() const;
+
 private:
-  std::uint16_t bitPackFor(TileIndex tile) const;
+  void extractCollisionData();
 
 private:
   AttributeArray mAttributeBitPacks;
+  CollisionArray mCollisionBitPacks;
 };
 
 }
@@ -25,39 +25,42 @@ using namespace std;
 
 namespace detail {
 
-inline bool isBitSet(uint16_t bitPack, uint16_t bitMask) {
+constexpr bool isBitSet(uint16_t bitPack, uint16_t bitMask) {
   return (bitPack & bitMask) != 0;
 }
 
+
+constexpr auto COLLISION_BITS_MASK = uint16_t{0xF};
+
 }
 
 
-inline SolidEdge SolidEdge::top() {
+constexpr SolidEdge SolidEdge::top() {
   return SolidEdge{0x01};
 }
 
 
-inline SolidEdge SolidEdge::bottom() {
+constexpr SolidEdge SolidEdge::bottom() {
   return SolidEdge{0x02};
 }
 
 
-inline SolidEdge SolidEdge::left() {
+constexpr SolidEdge SolidEdge::left() {
   return SolidEdge{0x08};
 }
 
 
-inline SolidEdge SolidEdge::right() {
+constexpr SolidEdge SolidEdge::right() {
   return SolidEdge{0x04};
 }
 
 
-inline CollisionData CollisionData::fullySolid() {
+constexpr CollisionData CollisionData::fullySolid() {
   return CollisionData{0xFF};
 }
 
 
-inline CollisionData::CollisionData(
+constexpr CollisionData::CollisionData(
   const std::initializer_list<CollisionData>& items
 ) {
   for (const auto& item : items) {
@@ -66,54 +69,54 @@ inline CollisionData::CollisionData(
 }
 
 
-inline CollisionData::CollisionData(const std::uint8_t flagsBitPack)
+constexpr CollisionData::CollisionData(const std::uint8_t flagsBitPack)
   : mCollisionFlagsBitPack(flagsBitPack)
 {
 }
 
 
-inline TileAttributes::TileAttributes(const std::uint16_t attributesBitPack)
+constexpr TileAttributes::TileAttributes(const std::uint16_t attributesBitPack)
   : mAttributesBitPack(attributesBitPack)
 {
 }
 
 
-inline bool TileAttributes::isAnimated() const {
+constexpr bool TileAttributes::isAnimated() const {
   return detail::isBitSet(mAttributesBitPack, 0x10);
 }
 
 
-inline bool TileAttributes::isFastAnimation() const {
+constexpr bool TileAttributes::isFastAnimation() const {
   return !detail::isBitSet(mAttributesBitPack, 0x400);
 }
 
 
-inline bool TileAttributes::isForeGround() const {
+constexpr bool TileAttributes::isForeGround() const {
   return detail::isBitSet(mAttributesBitPack, 0x20);
 }
 
 
-inline bool TileAttributes::isLadder() const {
+constexpr bool TileAttributes::isLadder() const {
   return detail::isBitSet(mAttributesBitPack, 0x4000);
 }
 
 
-inline bool TileAttributes::isClimbable() const {
+constexpr bool TileAttributes::isClimbable() const {
   return detail::isBitSet(mAttributesBitPack, 0x80);
 }
 
 
-inline bool TileAttributes::isConveyorBeltLeft() const {
+constexpr bool TileAttributes::isConveyorBeltLeft() const {
   return detail::isBitSet(mAttributesBitPack, 0x100);
 }
 
 
-inline bool TileAttributes::isConveyorBeltRight() const {
+constexpr bool TileAttributes::isConveyorBeltRight() const {
   return detail::isBitSet(mAttributesBitPack, 0x200);
 }
 
 
-inline bool TileAttributes::isFlammable() const {
+constexpr bool TileAttributes::isFlammable() const {
   return detail::isBitSet(mAttributesBitPack, 0x40);
 }
 
@@ -121,28 +124,55 @@ inline bool TileAttributes::isFlammable() const {
 inline TileAttributeDict::TileAttributeDict(const AttributeArray& bitpacks)
   : mAttributeBitPacks(bitpacks)
 {
+  extractCollisionData();
 }
 
 
 inline TileAttributeDict::TileAttributeDict(AttributeArray&& bitpacks)
   : mAttributeBitPacks(move(bitpacks))
 {
+  extractCollisionData();
 }
 
 
-inline uint16_t TileAttributeDict::bitPackFor(const TileIndex tile) const {
+inline void TileAttributeDict::extractCollisionData() {
+  mCollisionBitPacks.resize(mAttributeBitPacks.size());
+  for (size_t i = 0; i < mAttributeBitPacks.size(); ++i) {
+    mCollisionBitPacks[i] = static_cast<uint8_t>(
+      mAttributeBitPacks[i] & detail::COLLISION_BITS_MASK);
+  }
+}
+
+
+inline TileAttributes TileAttributeDict::attributes(
+  const TileIndex tile
+) const {
   assert(tile < mAttributeBitPacks.size());
-  return mAttributeBitPacks[tile];
+  return TileAttributes{mAttributeBitPacks[tile]};
+}
+
+
+inline CollisionData TileAttributeDict::collisionData(
+  const TileIndex tile
+) const {
+  assert(tile < mCollisionBitPacks.size());
+  return CollisionData{mCollisionBitPacks[tile]};
 }
 
 
-inline TileAttributes TileAttributeDict::attributes(const TileIndex tile) const {
-  return TileAttributes(bitPackFor(tile));
+inline base::ArrayView<uint16_t> TileAttributeDict::attributeBitPacks() const {
+  return {
+    mAttributeBitPacks.data(),
+    static_cast<base::ArrayView<uint16_t>::size_type>(
+      mAttributeBitPacks.size())};
 }
 
 
-inline CollisionData TileAttributeDict::collisionData(const TileIndex tile) const {
-  return CollisionData(static_cast<uint8_t>(bitPackFor(tile) & 0xF));
+inline base::ArrayView<uint8_t> TileAttributeDict::collisionBitPacks() const {
+  return {
+    mCollisionBitPacks.data(),
+    static_cast<base::ArrayView<uint8_t>::size_type>(
+      mCollisionBitPacks.size())};
 }
 
 }
@@ -0,0 +1,172 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "allocation_tracker.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+
+namespace rigel::engine::allocation_tracking {
+
+#ifdef RIGEL_ENABLE_ALLOCATION_TRACKING
+
+namespace {
+
+struct ScopeSlot {
+  std::atomic<const char*> mpName{nullptr};
+  std::atomic<std::uint64_t> mNumAllocations{0};
+  std::atomic<std::uint64_t> mNumBytes{0};
+};
+
+
+// None of this may allocate, since it's used from within operator new.
+// Hence the fixed size array instead of a map.
+std::array<ScopeSlot, MAX_SCOPES> gScopeSlots;
+
+thread_local Counters tThreadCounters;
+thread_local int tCurrentScopeIndex = -1;
+
+
+int scopeIndex(const char* pName) {
+  for (auto i = 0; i < MAX_SCOPES; ++i) {
+    auto& slot = gScopeSlots[i];
+
+    const char* pExpected = nullptr;
+    if (
+      slot.mpName.compare_exchange_strong(pExpected, pName) ||
+      pExpected == pName
+    ) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+
+void countAllocation(const std::size_t size) {
+  ++tThreadCounters.mNumAllocations;
+  tThreadCounters.mNumBytes += size;
+
+  if (tCurrentScopeIndex >= 0) {
+    auto& slot = gScopeSlots[tCurrentScopeIndex];
+    slot.mNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    slot.mNumBytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+}
+
+
+Scope::Scope(const char* pName)
+  : mPreviousScopeIndex(tCurrentScopeIndex)
+{
+  const auto index = scopeIndex(pName);
+  if (index >= 0) {
+    tCurrentScopeIndex = index;
+  }
+}
+
+
+Scope::~Scope() {
+  tCurrentScopeIndex = mPreviousScopeIndex;
+}
+
+
+Counters threadCounters() {
+  return tThreadCounters;
+}
+
+
+std::vector<ScopeStatistics> scopeStatistics() {
+  std::vector<ScopeStatistics> result;
+  for (const auto& slot : gScopeSlots) {
+    const auto pName = slot.mpName.load();
+    if (!pName) {
+      break;
+    }
+
+    result.push_back(ScopeStatistics{
+      pName,
+      Counters{
+        slot.mNumAllocations.load(std::memory_order_relaxed),
+        slot.mNumBytes.load(std::memory_order_relaxed)}});
+  }
+
+  return result;
+}
+
+#else
+
+Counters threadCounters() {
+  return {};
+}
+
+
+std::vector<ScopeStatistics> scopeStatistics() {
+  return {};
+}
+
+#endif
+
+
+void printScopeStatistics(std::ostream& stream) {
+  if constexpr (isEnabledInBuild()) {
+    stream << "Allocations per scope (count, bytes):\n";
+    for (const auto& statistics : scopeStatistics()) {
+      stream
+        << "  " << std::left << std::setw(24) << statistics.mpName
+        << std::right
+        << std::setw(12) << statistics.mCounters.mNumAllocations
+        << std::setw(14) << statistics.mCounters.mNumBytes << '\n';
+    }
+  }
+}
+
+}
+
+
+#ifdef RIGEL_ENABLE_ALLOCATION_TRACKING
+
+// Only the basic forms need replacing, the array and nothrow versions are
+// implemented in terms of these by the standard library. Aligned new is
+// left alone, the engine doesn't use over-aligned types.
+void* operator new(const std::size_t size) {
+  rigel::engine::allocation_tracking::countAllocation(size);
+
+  if (auto pMemory = std::malloc(size == 0 ? 1 : size)) {
+    return pMemory;
+  }
+
+  throw std::bad_alloc{};
+}
+
+
+void operator delete(void* pMemory) noexcept {
+  std::free(pMemory);
+}
+
+
+void operator delete(void* pMemory, std::size_t) noexcept {
+  std::free(pMemory);
+}
+
+#endif
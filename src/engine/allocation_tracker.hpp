@@ -0,0 +1,106 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+
+namespace rigel::engine::allocation_tracking {
+
+/** Counts heap allocations, optionally attributed to named scopes
+ *
+ * When RIGEL_ENABLE_ALLOCATION_TRACKING is defined (see the
+ * ALLOCATION_TRACKING CMake option), the global operator new and delete are
+ * replaced with versions that count every allocation made by the calling
+ * thread, and additionally attribute it to the innermost active Scope on
+ * that thread. Without it, all counters stay at zero and Scope compiles
+ * down to nothing.
+ *
+ * Counting per thread means that the audio thread's allocations don't show
+ * up in the game thread's numbers. To get the number of allocations made by
+ * a piece of code, take the difference of threadCounters() before and after
+ * running it.
+ *
+ * Scope names must be string literals, or otherwise outlive the program.
+ * At most MAX_SCOPES different names can be used, allocations in any
+ * further scopes are only counted for the thread.
+ */
+struct Counters {
+  std::uint64_t mNumAllocations = 0;
+  std::uint64_t mNumBytes = 0;
+
+  Counters operator-(const Counters& other) const {
+    return {
+      mNumAllocations - other.mNumAllocations,
+      mNumBytes - other.mNumBytes};
+  }
+};
+
+
+struct ScopeStatistics {
+  const char* mpName;
+
+  /** Sum over all threads and all times the scope was active */
+  Counters mCounters;
+};
+
+
+constexpr auto MAX_SCOPES = 64;
+
+
+constexpr bool isEnabledInBuild() {
+#ifdef RIGEL_ENABLE_ALLOCATION_TRACKING
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+/** Allocations made by the calling thread since it was started */
+Counters threadCounters();
+
+/** Statistics for all scopes used so far, in order of first use */
+std::vector<ScopeStatistics> scopeStatistics();
+
+/** Write scopeStatistics() as a table, nothing if tracking isn't enabled */
+void printScopeStatistics(std::ostream& stream);
+
+
+/** Attributes all allocations on the current thread to the given name,
+ * for as long as the object exists. Scopes can be nested.
+ */
+class Scope {
+public:
+#ifdef RIGEL_ENABLE_ALLOCATION_TRACKING
+  explicit Scope(const char* pName);
+  ~Scope();
+
+private:
+  int mPreviousScopeIndex;
+#else
+  explicit Scope(const char*) {}
+#endif
+
+public:
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+}
@@ -0,0 +1,223 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio_mixer.hpp"
+
+#include "base/match.hpp"
+#include "engine/trace_recorder.hpp"
+
+#include <speex/speex_resampler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+
+namespace rigel::engine {
+
+namespace {
+
+// Speex resampler quality, ranging from 0 (fastest) to 10 (best)
+const auto RESAMPLER_QUALITY = 5;
+
+
+/** Add source onto destination, clamping to the range of int16
+ *
+ * Written as a plain loop over widened values so that compilers turn it into
+ * packed saturating adds.
+ */
+void mixSaturating(
+  std::int16_t* pDestination,
+  const std::int16_t* pSource,
+  const std::size_t count
+) {
+  for (std::size_t i = 0; i < count; ++i) {
+    using Limits = std::numeric_limits<std::int16_t>;
+
+    const auto sum = std::int32_t{pDestination[i]} + std::int32_t{pSource[i]};
+    pDestination[i] = static_cast<std::int16_t>(std::clamp(
+      sum, std::int32_t{Limits::min()}, std::int32_t{Limits::max()}));
+  }
+}
+
+}
+
+
+void AudioMixer::ResamplerDeleter::operator()(
+  SpeexResamplerState* pResampler
+) const {
+  speex_resampler_destroy(pResampler);
+}
+
+
+AudioMixer::AudioMixer(
+  const int sampleRate,
+  AudioStatistics* pStatistics,
+  const loader::AdlibEmulator::Mode musicEmulationMode
+)
+  : mMusicPlayer(sampleRate, pStatistics, musicEmulationMode)
+  , mSampleRate(sampleRate)
+{
+  for (auto& pResampler : mResamplers) {
+    pResampler.reset(speex_resampler_init(
+      1, sampleRate, sampleRate, RESAMPLER_QUALITY, nullptr));
+  }
+
+  mResamplerInputRates.fill(sampleRate);
+}
+
+
+AudioMixer::~AudioMixer() = default;
+
+
+void AudioMixer::startVoice(
+  const VoiceId id,
+  const base::ArrayView<data::Sample> samples,
+  const int sampleRate
+) {
+  assert(id >= 0 && id < MAX_VOICES);
+  sendCommand(StartVoice{id, samples, sampleRate});
+}
+
+
+void AudioMixer::stopVoice(const VoiceId id) {
+  assert(id >= 0 && id < MAX_VOICES);
+  sendCommand(StopVoice{id});
+}
+
+
+void AudioMixer::sendCommand(Command&& command) {
+  // The queue is large enough to hold a command for each voice multiple
+  // times over. Should it still be full, the audio thread is hopelessly
+  // behind, and dropping the request is the best we can do.
+  const auto wasQueued = mCommandQueue.push(std::move(command));
+  (void)wasQueued;
+  assert(wasQueued);
+}
+
+
+void AudioMixer::processCommands() {
+  while (auto command = mCommandQueue.pop()) {
+    base::match(*command,
+      [this](const StartVoice& start) {
+        auto& voice = mVoices[start.mId];
+        voice = Voice{start.mSamples};
+
+        if (start.mSamples.empty() || start.mSampleRate == mSampleRate) {
+          return;
+        }
+
+        const auto pResampler = mResamplers[start.mId].get();
+        if (start.mSampleRate != mResamplerInputRates[start.mId]) {
+          speex_resampler_set_rate(
+            pResampler,
+            static_cast<spx_uint32_t>(start.mSampleRate),
+            static_cast<spx_uint32_t>(mSampleRate));
+          mResamplerInputRates[start.mId] = start.mSampleRate;
+        }
+
+        speex_resampler_reset_mem(pResampler);
+        speex_resampler_skip_zeros(pResampler);
+
+        voice.mIsResampled = true;
+        voice.mFlushSamplesLeft = static_cast<std::uint32_t>(
+          speex_resampler_get_input_latency(pResampler));
+      },
+
+      [this](const StopVoice& stop) {
+        mVoices[stop.mId] = Voice{};
+      });
+  }
+}
+
+
+void AudioMixer::render(
+  std::int16_t* pBuffer,
+  const std::size_t samplesRequired
+) {
+  TraceZone zone("Audio mixing");
+
+  processCommands();
+
+  mMusicPlayer.render(pBuffer, samplesRequired);
+
+  for (auto id = 0; id < MAX_VOICES; ++id) {
+    auto& voice = mVoices[id];
+    if (voice.isFinished()) {
+      continue;
+    }
+
+    if (voice.mIsResampled) {
+      mixResampledVoice(id, pBuffer, samplesRequired);
+      continue;
+    }
+
+    const auto samplesLeft = voice.mSamples.size() - voice.mPosition;
+    const auto count = std::min<std::size_t>(samplesLeft, samplesRequired);
+    mixSaturating(pBuffer, voice.mSamples.begin() + voice.mPosition, count);
+    voice.mPosition += static_cast<std::uint32_t>(count);
+  }
+}
+
+
+void AudioMixer::mixResampledVoice(
+  const VoiceId id,
+  std::int16_t* pBuffer,
+  const std::size_t samplesRequired
+) {
+  auto& voice = mVoices[id];
+  const auto pResampler = mResamplers[id].get();
+
+  auto samplesDone = std::size_t{0};
+  while (samplesDone < samplesRequired && !voice.isFinished()) {
+    auto outputLength = static_cast<spx_uint32_t>(
+      std::min(samplesRequired - samplesDone, RESAMPLE_BUFFER_SIZE));
+    auto inputLength = spx_uint32_t{0};
+
+    if (voice.mPosition < voice.mSamples.size()) {
+      inputLength =
+        static_cast<spx_uint32_t>(voice.mSamples.size() - voice.mPosition);
+      speex_resampler_process_int(
+        pResampler,
+        0,
+        voice.mSamples.begin() + voice.mPosition,
+        &inputLength,
+        mResampleBuffer.data(),
+        &outputLength);
+      voice.mPosition += inputLength;
+    } else {
+      // A null input makes the resampler read zeros
+      inputLength = voice.mFlushSamplesLeft;
+      speex_resampler_process_int(
+        pResampler,
+        0,
+        nullptr,
+        &inputLength,
+        mResampleBuffer.data(),
+        &outputLength);
+      voice.mFlushSamplesLeft -= inputLength;
+    }
+
+    if (inputLength == 0 && outputLength == 0) {
+      break;
+    }
+
+    mixSaturating(pBuffer + samplesDone, mResampleBuffer.data(), outputLength);
+    samplesDone += outputLength;
+  }
+}
+
+}
@@ -0,0 +1,142 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/array_view.hpp"
+#include "base/spsc_queue.hpp"
+#include "data/audio_buffer.hpp"
+#include "engine/imf_player.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <variant>
+#include <vector>
+
+
+struct SpeexResamplerState_;
+
+
+namespace rigel::engine {
+
+/** Mixes music and sound effects into a single output stream
+ *
+ * Music is provided by an ImfPlayer. On top of that, there is a fixed number
+ * of voices for playing sound effects. Each voice plays one sample buffer at
+ * a time. Starting a voice which is already playing restarts it with the new
+ * buffer.
+ *
+ * Sample data doesn't need to be at the mixer's sample rate. Each voice has
+ * its own resampler, which converts while mixing. This allows keeping sound
+ * effects at their (much lower) original rates in memory.
+ *
+ * Like with ImfPlayer, render() runs on the audio thread, while voices are
+ * started and stopped from the main thread. Requests are passed on via
+ * a lock-free queue.
+ */
+class AudioMixer {
+public:
+  using VoiceId = int;
+
+  static constexpr auto MAX_VOICES = 64;
+
+  /** pStatistics is optional. If given, it must outlive the mixer. */
+  explicit AudioMixer(
+    int sampleRate,
+    AudioStatistics* pStatistics = nullptr,
+    loader::AdlibEmulator::Mode musicEmulationMode =
+      loader::AdlibEmulator::Mode::Accurate);
+  ~AudioMixer();
+
+  ImfPlayer& musicPlayer() {
+    return mMusicPlayer;
+  }
+
+  /** Start playing samples on the given voice
+   *
+   * The sample data is not copied, it must stay alive until the voice has
+   * been stopped or the mixer is destroyed.
+   *
+   * Samples are converted from sampleRate to the mixer's rate while playing.
+   * Switching a voice to a different sample rate than it played at before
+   * reconfigures its resampler on the audio thread, which can allocate
+   * memory. Each voice should therefore stick to one rate, e.g. by always
+   * playing the same sound on it.
+   */
+  void startVoice(
+    VoiceId id,
+    base::ArrayView<data::Sample> samples,
+    int sampleRate);
+  void stopVoice(VoiceId id);
+
+  void render(std::int16_t* pBuffer, std::size_t samplesRequired);
+
+private:
+  struct StartVoice {
+    VoiceId mId;
+    base::ArrayView<data::Sample> mSamples;
+    int mSampleRate;
+  };
+
+  struct StopVoice {
+    VoiceId mId;
+  };
+
+  using Command = std::variant<StartVoice, StopVoice>;
+
+  struct Voice {
+    base::ArrayView<data::Sample> mSamples;
+    std::uint32_t mPosition = 0;
+
+    // Once all samples have been fed into the resampler, it still holds on
+    // to the end of the sound. Feeding this many zeros gets it out.
+    std::uint32_t mFlushSamplesLeft = 0;
+    bool mIsResampled = false;
+
+    bool isFinished() const {
+      return mPosition >= mSamples.size() && mFlushSamplesLeft == 0;
+    }
+  };
+
+  struct ResamplerDeleter {
+    void operator()(SpeexResamplerState_* pResampler) const;
+  };
+
+  using ResamplerPtr = std::unique_ptr<SpeexResamplerState_, ResamplerDeleter>;
+
+  static constexpr auto QUEUE_CAPACITY = std::size_t{256};
+  static constexpr auto RESAMPLE_BUFFER_SIZE = std::size_t{1024};
+
+  void sendCommand(Command&& command);
+  void processCommands();
+  void mixResampledVoice(
+    VoiceId id,
+    std::int16_t* pBuffer,
+    std::size_t samplesRequired);
+
+  ImfPlayer mMusicPlayer;
+  base::SpscQueue<Command, QUEUE_CAPACITY> mCommandQueue;
+  int mSampleRate;
+
+  // Only accessed by the audio thread
+  std::array<Voice, MAX_VOICES> mVoices;
+  std::array<ResamplerPtr, MAX_VOICES> mResamplers;
+  std::array<int, MAX_VOICES> mResamplerInputRates;
+  std::array<data::Sample, RESAMPLE_BUFFER_SIZE> mResampleBuffer;
+};
+
+}
@@ -0,0 +1,115 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace rigel::engine {
+
+/** Performance counters for the audio thread
+ *
+ * Written by the audio thread and read by the main thread at any time. Only
+ * relaxed atomic operations are used, so recording never blocks. Values
+ * which are read one after another might stem from different callbacks,
+ * which is fine for monitoring purposes.
+ */
+struct AudioStatistics {
+  using Duration = std::chrono::nanoseconds;
+
+  static constexpr auto NUM_DURATION_BUCKETS = std::size_t{8};
+
+  /** Upper limits of the callback duration histogram buckets, in µs
+   *
+   * The last bucket has no upper limit.
+   */
+  static constexpr std::array<std::int64_t, NUM_DURATION_BUCKETS - 1>
+    DURATION_BUCKET_LIMITS_US{250, 500, 1000, 2000, 4000, 8000, 16000};
+
+  void recordCallback(const Duration duration) {
+    const auto durationUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+    auto bucket = std::size_t{0};
+    while (
+      bucket < DURATION_BUCKET_LIMITS_US.size() &&
+      durationUs >= DURATION_BUCKET_LIMITS_US[bucket]
+    ) {
+      ++bucket;
+    }
+
+    increment(mCallbackDurationHistogram[bucket]);
+    increment(mNumCallbacks);
+    add(mTotalCallbackTimeNs, duration.count());
+    updateMax(mMaxCallbackTimeNs, duration.count());
+  }
+
+  void recordEmulation(const Duration duration, const std::size_t samples) {
+    add(mEmulationTimeNs, duration.count());
+    add(mEmulatedSamples, samples);
+  }
+
+  void recordSongSwitch(const Duration latency) {
+    mLastSongSwitchLatencyNs.store(
+      static_cast<std::uint64_t>(latency.count()), std::memory_order_relaxed);
+    updateMax(mMaxSongSwitchLatencyNs, latency.count());
+  }
+
+  void recordUnderrun() {
+    increment(mNumUnderruns);
+  }
+
+  std::array<std::atomic<std::uint64_t>, NUM_DURATION_BUCKETS>
+    mCallbackDurationHistogram{};
+  std::atomic<std::uint64_t> mNumCallbacks{0};
+  std::atomic<std::uint64_t> mTotalCallbackTimeNs{0};
+  std::atomic<std::uint64_t> mMaxCallbackTimeNs{0};
+  std::atomic<std::uint64_t> mEmulationTimeNs{0};
+  std::atomic<std::uint64_t> mEmulatedSamples{0};
+  std::atomic<std::uint64_t> mLastSongSwitchLatencyNs{0};
+  std::atomic<std::uint64_t> mMaxSongSwitchLatencyNs{0};
+  std::atomic<std::uint64_t> mNumUnderruns{0};
+
+private:
+  template <typename Value>
+  static void add(std::atomic<std::uint64_t>& counter, const Value value) {
+    counter.fetch_add(
+      static_cast<std::uint64_t>(value), std::memory_order_relaxed);
+  }
+
+  static void increment(std::atomic<std::uint64_t>& counter) {
+    add(counter, 1);
+  }
+
+  template <typename Value>
+  static void updateMax(std::atomic<std::uint64_t>& maximum, const Value value) {
+    const auto newValue = static_cast<std::uint64_t>(value);
+    auto current = maximum.load(std::memory_order_relaxed);
+    while (
+      newValue > current &&
+      !maximum.compare_exchange_weak(
+        current, newValue, std::memory_order_relaxed)
+    ) {
+    }
+  }
+};
+
+}
@@ -27,20 +27,53 @@ using data::map::CollisionData;
 using data::map::SolidEdge;
 using namespace engine::components;
 
+namespace {
+
+// Size of a solid body grid cell, in tiles
+constexpr auto GRID_CELL_SIZE = 16;
+
+
+int gridCellsNeeded(const int sizeInTiles) {
+  return std::max((sizeInTiles + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE, 1);
+}
+
+
+std::optional<BoundingBox> worldSpaceBbox(ex::Entity entity) {
+  if (
+    entity.has_component<BoundingBox>() &&
+    entity.has_component<WorldPosition>()
+  ) {
+    return engine::toWorldSpace(
+      *entity.component<const BoundingBox>(),
+      *entity.component<const WorldPosition>());
+  }
+
+  return std::nullopt;
+}
+
+}
+
 
 CollisionChecker::CollisionChecker(
   const data::map::Map* pMap,
   ex::EntityManager& entities,
   ex::EventManager& eventManager
 )
-  : mpMap(pMap)
+  : mGridColumns(gridCellsNeeded(pMap->width()))
+  , mGridRows(gridCellsNeeded(pMap->height()))
+  , mpMap(pMap)
 {
+  mSolidBodyGrid.resize(mGridColumns * mGridRows);
+
   entities.each<SolidBody>([this](ex::Entity entity, const SolidBody&) {
-    mSolidBodies.push_back(entity);
+    addSolidBody(entity);
   });
 
   eventManager.subscribe<ex::ComponentAddedEvent<SolidBody>>(*this);
   eventManager.subscribe<ex::ComponentRemovedEvent<SolidBody>>(*this);
+  eventManager.subscribe<ex::ComponentAddedEvent<MovingBody>>(*this);
+  eventManager.subscribe<events::SolidBodyChanged>(*this);
+  eventManager.subscribe<events::ClearingAllEntities>(*this);
 }
 
 
@@ -92,15 +125,9 @@ bool CollisionChecker::testHorizontalSpan(
     return true;
   }
 
-  const auto startX = bbox.left();
-  const auto endX = bbox.right();
-  for (int x = startX; x <= endX; ++x) {
-    if (mpMap->collisionData(x, y).isSolidOn(edge)) {
-      return true;
-    }
-  }
+  mStatistics.mNumTilesExamined += bbox.size.width;
 
-  return false;
+  return mpMap->isAnyTileSolidInRow(y, bbox.left(), bbox.right(), edge);
 }
 
 
@@ -116,41 +143,267 @@ bool CollisionChecker::testVerticalSpan(
     return true;
   }
 
-  const auto startY = bbox.top();
-  const auto endY = bbox.bottom();
-  for (int y = startY; y <= endY; ++y) {
-    if (mpMap->collisionData(x, y).isSolidOn(edge)) {
-      return true;
-    }
-  }
+  mStatistics.mNumTilesExamined += bbox.size.height;
 
-  return false;
+  return mpMap->isAnyTileSolidInColumn(x, bbox.top(), bbox.bottom(), edge);
 }
 
 
 bool CollisionChecker::testSolidBodyCollision(
   const BoundingBox& bboxToTest
 ) const {
-  return any_of(cbegin(mSolidBodies), cend(mSolidBodies),
-    [&bboxToTest](const ex::Entity& entity) {
-      if (
-        entity.has_component<BoundingBox>() &&
-        entity.has_component<WorldPosition>()
-      ) {
-        const auto solidBodyBbox = engine::toWorldSpace(
-          *entity.component<const BoundingBox>(),
-          *entity.component<const WorldPosition>());
-        return solidBodyBbox.intersects(bboxToTest);
+  if (mSolidBodies.empty()) {
+    return false;
+  }
+
+  updateMovableSolidBodies();
+  ++mStatistics.mNumSolidBodyTests;
+
+  auto collisionFound = false;
+  forEachCoveredCell(bboxToTest, [&](const std::vector<std::size_t>& cell) {
+    mStatistics.mNumSolidBodiesVisited += cell.size();
+    collisionFound = collisionFound ||
+      any_of(cbegin(cell), cend(cell), [&](const std::size_t index) {
+        return mSolidBodies[index].mWorldSpaceBbox->intersects(bboxToTest);
+      });
+  });
+
+  return collisionFound;
+}
+
+
+int CollisionChecker::freeDistanceLeft(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  return sweep(worldSpaceBbox, maxDistance, SweepDirection::Left);
+}
+
+
+int CollisionChecker::freeDistanceRight(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  return sweep(worldSpaceBbox, maxDistance, SweepDirection::Right);
+}
+
+
+int CollisionChecker::freeDistanceUp(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  return sweep(worldSpaceBbox, maxDistance, SweepDirection::Up);
+}
+
+
+int CollisionChecker::freeDistanceDown(
+  const BoundingBox& worldSpaceBbox,
+  const int maxDistance
+) const {
+  return sweep(worldSpaceBbox, maxDistance, SweepDirection::Down);
+}
+
+
+int CollisionChecker::sweep(
+  const BoundingBox& bbox,
+  const int maxDistance,
+  const SweepDirection direction
+) const {
+  if (maxDistance <= 0) {
+    return 0;
+  }
+
+  ++mStatistics.mNumSweeps;
+
+  const auto horizontal =
+    direction == SweepDirection::Left || direction == SweepDirection::Right;
+  const auto stepSign =
+    direction == SweepDirection::Left || direction == SweepDirection::Up
+      ? -1 : 1;
+
+  // The line (column or row) which the n-th step's collision test looks at,
+  // see isTouchingLeftWall() etc.
+  const auto firstLine = [&]() {
+    switch (direction) {
+      case SweepDirection::Left: return bbox.left() - 1;
+      case SweepDirection::Right: return bbox.right() + 1;
+      case SweepDirection::Up: return bbox.top() - 1;
+      case SweepDirection::Down: return bbox.bottom() + 1;
+    }
+    return 0;
+  }();
+  const auto lineForStep = [&](const int step) {
+    return firstLine + step * stepSign;
+  };
+
+  const auto testAreaForStep = [&](const int step) {
+    auto area = bbox;
+    if (horizontal) {
+      area.topLeft.x = lineForStep(step);
+      area.size.width = 1;
+    } else {
+      area.topLeft.y = lineForStep(step);
+      area.size.height = 1;
+    }
+    return area;
+  };
+
+  // Solid bodies: Find the first step whose test area hits any body
+  auto distance = maxDistance;
+  if (!mSolidBodies.empty()) {
+    updateMovableSolidBodies();
+
+    const auto firstArea = testAreaForStep(0);
+    const auto lastArea = testAreaForStep(maxDistance - 1);
+    const auto sweptArea = BoundingBox{
+      {
+        std::min(firstArea.left(), lastArea.left()),
+        std::min(firstArea.top(), lastArea.top())
+      },
+      {
+        std::abs(lastArea.left() - firstArea.left()) + firstArea.size.width,
+        std::abs(lastArea.top() - firstArea.top()) + firstArea.size.height
+      }};
+
+    ++mStatistics.mNumSolidBodyTests;
+    forEachCoveredCell(sweptArea, [&](const std::vector<std::size_t>& cell) {
+      mStatistics.mNumSolidBodiesVisited += cell.size();
+      for (const auto index : cell) {
+        const auto& bodyBbox = *mSolidBodies[index].mWorldSpaceBbox;
+        const auto bodyStart = horizontal ? bodyBbox.left() : bodyBbox.top();
+        const auto bodyEnd = horizontal ? bodyBbox.right() : bodyBbox.bottom();
+
+        // Steps for which the tested line lies within the body's extents
+        const auto firstHit = std::max(0, stepSign < 0
+          ? firstLine - bodyEnd
+          : bodyStart - firstLine);
+        const auto lastHit = stepSign < 0
+          ? firstLine - bodyStart
+          : bodyEnd - firstLine;
+
+        if (
+          firstHit < distance &&
+          firstHit <= lastHit &&
+          testAreaForStep(firstHit).intersects(bodyBbox)
+        ) {
+          distance = firstHit;
+        }
       }
+    });
+  }
 
+  // World: Test each line along the path using the map's solidity planes,
+  // stopping at the first solid one
+  const auto spanLength = horizontal ? bbox.size.height : bbox.size.width;
+  for (int step = 0; step < distance; ++step) {
+    const auto line = lineForStep(step);
+    mStatistics.mNumTilesExamined += spanLength;
+    const auto isBlocked = [&]() {
+      switch (direction) {
+        case SweepDirection::Left:
+          return mpMap->isAnyTileSolidInColumn(
+            line, bbox.top(), bbox.bottom(), SolidEdge::right());
+        case SweepDirection::Right:
+          return mpMap->isAnyTileSolidInColumn(
+            line, bbox.top(), bbox.bottom(), SolidEdge::left());
+        case SweepDirection::Up:
+          return mpMap->isAnyTileSolidInRow(
+            line, bbox.left(), bbox.right(), SolidEdge::bottom());
+        case SweepDirection::Down:
+          return mpMap->isAnyTileSolidInRow(
+            line, bbox.left(), bbox.right(), SolidEdge::top());
+      }
       return false;
+    }();
+
+    if (isBlocked) {
+      return step;
+    }
+  }
+
+  return distance;
+}
+
+
+void CollisionChecker::addSolidBody(ex::Entity entity) {
+  if (!mSolidBodyEntities.insert(entity)) {
+    return;
+  }
+
+  const auto bbox = worldSpaceBbox(entity);
+  const auto mayMove = entity.has_component<MovingBody>() || !bbox;
+  mSolidBodies.push_back(SolidBodyInfo{bbox, mayMove});
+  insertIntoGrid(mSolidBodies.size() - 1);
+
+  if (mayMove) {
+    mMovableSolidBodies.push_back(mSolidBodies.size() - 1);
+  }
+}
+
+
+void CollisionChecker::updateMovableSolidBodies() const {
+  for (const auto index : mMovableSolidBodies) {
+    updateSolidBodyPosition(index);
+  }
+}
+
+
+void CollisionChecker::updateSolidBodyPosition(const std::size_t index) const {
+  auto& info = mSolidBodies[index];
+  const auto currentBbox = worldSpaceBbox(mSolidBodyEntities[index]);
+  if (currentBbox != info.mWorldSpaceBbox) {
+    removeFromGrid(index);
+    info.mWorldSpaceBbox = currentBbox;
+    insertIntoGrid(index);
+  }
+}
+
+
+void CollisionChecker::insertIntoGrid(const std::size_t index) const {
+  if (const auto& bbox = mSolidBodies[index].mWorldSpaceBbox) {
+    forEachCoveredCell(*bbox, [index](std::vector<std::size_t>& cell) {
+      cell.push_back(index);
+    });
+  }
+}
+
+
+void CollisionChecker::removeFromGrid(const std::size_t index) const {
+  if (const auto& bbox = mSolidBodies[index].mWorldSpaceBbox) {
+    forEachCoveredCell(*bbox, [index](std::vector<std::size_t>& cell) {
+      cell.erase(remove(begin(cell), end(cell), index), end(cell));
     });
+  }
+}
+
+
+template <typename Callback>
+void CollisionChecker::forEachCoveredCell(
+  const BoundingBox& bbox,
+  Callback&& callback
+) const {
+  const auto toColumn = [this](const int x) {
+    return std::clamp(x / GRID_CELL_SIZE, 0, mGridColumns - 1);
+  };
+  const auto toRow = [this](const int y) {
+    return std::clamp(y / GRID_CELL_SIZE, 0, mGridRows - 1);
+  };
+
+  const auto lastColumn = toColumn(bbox.right());
+  const auto lastRow = toRow(bbox.bottom());
+  for (auto row = toRow(bbox.top()); row <= lastRow; ++row) {
+    for (auto col = toColumn(bbox.left()); col <= lastColumn; ++col) {
+      callback(mSolidBodyGrid[col + row * mGridColumns]);
+    }
+  }
 }
 
 
 bool CollisionChecker::isTouchingCeiling(
   const BoundingBox& worldSpaceBbox
 ) const {
+  ++mStatistics.mNumCeilingTests;
+
   const auto y = worldSpaceBbox.top() - 1;
   return testHorizontalSpan(worldSpaceBbox, y, SolidEdge::bottom());
 }
@@ -159,6 +412,8 @@ bool CollisionChecker::isTouchingCeiling(
 bool CollisionChecker::isOnSolidGround(
   const BoundingBox& worldSpaceBbox
 ) const {
+  ++mStatistics.mNumGroundTests;
+
   const auto y = worldSpaceBbox.bottom() + 1;
   return testHorizontalSpan(worldSpaceBbox, y, SolidEdge::top());
 }
@@ -167,6 +422,8 @@ bool CollisionChecker::isOnSolidGround(
 bool CollisionChecker::isTouchingLeftWall(
   const BoundingBox& worldSpaceBbox
 ) const {
+  ++mStatistics.mNumLeftWallTests;
+
   const auto x = worldSpaceBbox.left() - 1;
   return testVerticalSpan(worldSpaceBbox, x, SolidEdge::right());
 }
@@ -175,6 +432,8 @@ bool CollisionChecker::isTouchingLeftWall(
 bool CollisionChecker::isTouchingRightWall(
   const BoundingBox& worldSpaceBbox
 ) const {
+  ++mStatistics.mNumRightWallTests;
+
   const auto x = worldSpaceBbox.right() + 1;
   return testVerticalSpan(worldSpaceBbox, x, SolidEdge::left());
 }
@@ -183,21 +442,72 @@ bool CollisionChecker::isTouchingRightWall(
 void CollisionChecker::receive(
   const ex::ComponentAddedEvent<SolidBody>& event
 ) {
-  mSolidBodies.push_back(event.entity);
+  addSolidBody(event.entity);
 }
 
 
 void CollisionChecker::receive(
   const ex::ComponentRemovedEvent<SolidBody>& event
 ) {
-  const auto it = find_if(begin(mSolidBodies), end(mSolidBodies),
-    [&event](const auto& entity) {
-      return entity == event.entity;
-    });
+  const auto maybeIndex = mSolidBodyEntities.indexOf(event.entity);
+  if (!maybeIndex) {
+    return;
+  }
+
+  // Move the last body into the removed one's slot, which means its grid
+  // entries need to be updated as well. The entity list does the same
+  // swap internally, so both stay in sync.
+  const auto index = *maybeIndex;
+  const auto lastIndex = mSolidBodies.size() - 1;
+
+  removeFromGrid(index);
+  if (mSolidBodies[index].mMayMove) {
+    mMovableSolidBodies.erase(find(
+      begin(mMovableSolidBodies), end(mMovableSolidBodies), index));
+  }
+
+  if (index != lastIndex) {
+    removeFromGrid(lastIndex);
+    mSolidBodies[index] = mSolidBodies[lastIndex];
+    insertIntoGrid(index);
+
+    if (mSolidBodies[index].mMayMove) {
+      *find(begin(mMovableSolidBodies), end(mMovableSolidBodies), lastIndex) =
+        index;
+    }
+  }
 
-  if (it != end(mSolidBodies)) {
-    mSolidBodies.erase(it);
+  mSolidBodies.pop_back();
+  mSolidBodyEntities.removeAt(index);
+}
+
+
+void CollisionChecker::receive(
+  const ex::ComponentAddedEvent<MovingBody>& event
+) {
+  const auto maybeIndex = mSolidBodyEntities.indexOf(event.entity);
+  if (maybeIndex && !mSolidBodies[*maybeIndex].mMayMove) {
+    mSolidBodies[*maybeIndex].mMayMove = true;
+    mMovableSolidBodies.push_back(*maybeIndex);
+  }
+}
+
+
+void CollisionChecker::receive(const events::SolidBodyChanged& event) {
+  if (const auto maybeIndex = mSolidBodyEntities.indexOf(event.mEntity)) {
+    updateSolidBodyPosition(*maybeIndex);
   }
 }
 
+
+void CollisionChecker::receive(const events::ClearingAllEntities&) {
+  for (auto& cell : mSolidBodyGrid) {
+    cell.clear();
+  }
+
+  mSolidBodies.clear();
+  mSolidBodyEntities.clear();
+  mMovableSolidBodies.clear();
+}
+
 }
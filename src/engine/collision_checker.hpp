@@ -19,8 +19,13 @@
 #include "base/warnings.hpp"
 #include "data/map.hpp"
 #include "engine/base_components.hpp"
+#include "engine/collision_statistics.hpp"
+#include "engine/entity_slot_list.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/physical_components.hpp"
 
+#include <cstddef>
+#include <optional>
 #include <vector>
 
 RIGEL_DISABLE_WARNINGS
@@ -58,10 +63,39 @@ public:
   bool isTouchingLeftWall(const engine::components::BoundingBox& bbox) const;
   bool isTouchingRightWall(const engine::components::BoundingBox& bbox) const;
 
+  /** Find how far the given bbox can move before hitting something
+   *
+   * Gives the same result as repeatedly moving the bbox by one unit for as
+   * long as the corresponding isTouching...()/isOnSolidGround() check
+   * returns false, up to maxDistance units. But instead of doing a full
+   * collision test for each step, the whole path is tested at once.
+   */
+  int freeDistanceLeft(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int freeDistanceRight(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int freeDistanceUp(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+  int freeDistanceDown(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance) const;
+
   void receive(
     const entityx::ComponentAddedEvent<components::SolidBody>& event);
   void receive(
     const entityx::ComponentRemovedEvent<components::SolidBody>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::MovingBody>& event);
+  void receive(const events::SolidBodyChanged& event);
+  void receive(const events::ClearingAllEntities& event);
+
+  /** Counts of work done by all tests so far */
+  const CollisionStatistics& statistics() const {
+    return mStatistics;
+  }
 
 private:
   bool testHorizontalSpan(
@@ -75,8 +109,61 @@ private:
   bool testSolidBodyCollision(
     const engine::components::BoundingBox& bbox) const;
 
-  std::vector<entityx::Entity> mSolidBodies;
+  enum class SweepDirection {
+    Left,
+    Right,
+    Up,
+    Down
+  };
+
+  int sweep(
+    const engine::components::BoundingBox& bbox,
+    int maxDistance,
+    SweepDirection direction) const;
+
+  struct SolidBodyInfo {
+    // World space bounding box at the time the body was put into the grid.
+    // Empty if the entity lacked a position or bounding box.
+    std::optional<engine::components::BoundingBox> mWorldSpaceBbox;
+
+    // Whether the body needs to be checked for movement before each test
+    bool mMayMove;
+  };
+
+  void addSolidBody(entityx::Entity entity);
+  void updateMovableSolidBodies() const;
+  void updateSolidBodyPosition(std::size_t index) const;
+  void insertIntoGrid(std::size_t index) const;
+  void removeFromGrid(std::size_t index) const;
+
+  template <typename Callback>
+  void forEachCoveredCell(
+    const engine::components::BoundingBox& bbox,
+    Callback&& callback) const;
+
+  // Solid bodies are indexed by a uniform grid of cells covering the map, so
+  // that span tests only need to look at bodies close to the tested area.
+  // Bodies which are outside of the map are put into the closest cells.
+  //
+  // Bodies with a MovingBody, and those that lacked a position or bounding
+  // box when they were added, are checked for movement before each test and
+  // moved to different cells as needed. These can change position at any
+  // time, and tests later in the same frame need to see that. All other
+  // bodies are only looked at again when a SolidBodyChanged event names
+  // them, since most of them are level geometry that never moves.
+  //
+  // mSolidBodyEntities holds the entity for each entry in mSolidBodies,
+  // at the same position. mMovableSolidBodies lists the indices of all
+  // entries with mMayMove set, so that the check before each test only
+  // needs to visit those.
+  mutable std::vector<SolidBodyInfo> mSolidBodies;
+  EntitySlotList mSolidBodyEntities;
+  std::vector<std::size_t> mMovableSolidBodies;
+  mutable std::vector<std::vector<std::size_t>> mSolidBodyGrid;
+  int mGridColumns;
+  int mGridRows;
   const data::map::Map* mpMap;
+  mutable CollisionStatistics mStatistics;
 };
 
 }
@@ -0,0 +1,69 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+
+namespace rigel::engine {
+
+/** Counts of work done by CollisionChecker
+ *
+ * Used by the performance tests, and by the logic profiler to attribute
+ * collision queries to the systems making them.
+ */
+struct CollisionStatistics {
+  std::uint64_t mNumGroundTests = 0;
+  std::uint64_t mNumCeilingTests = 0;
+  std::uint64_t mNumLeftWallTests = 0;
+  std::uint64_t mNumRightWallTests = 0;
+  std::uint64_t mNumSweeps = 0;
+
+  // Tiles covered by all map spans tested. A span test may stop early on
+  // finding a solid tile, so this is an upper bound of tiles looked at.
+  std::uint64_t mNumTilesExamined = 0;
+
+  std::uint64_t mNumSolidBodyTests = 0;
+  std::uint64_t mNumSolidBodiesVisited = 0;
+
+  CollisionStatistics& operator+=(const CollisionStatistics& other) {
+    mNumGroundTests += other.mNumGroundTests;
+    mNumCeilingTests += other.mNumCeilingTests;
+    mNumLeftWallTests += other.mNumLeftWallTests;
+    mNumRightWallTests += other.mNumRightWallTests;
+    mNumSweeps += other.mNumSweeps;
+    mNumTilesExamined += other.mNumTilesExamined;
+    mNumSolidBodyTests += other.mNumSolidBodyTests;
+    mNumSolidBodiesVisited += other.mNumSolidBodiesVisited;
+    return *this;
+  }
+
+  CollisionStatistics operator-(const CollisionStatistics& other) const {
+    return CollisionStatistics{
+      mNumGroundTests - other.mNumGroundTests,
+      mNumCeilingTests - other.mNumCeilingTests,
+      mNumLeftWallTests - other.mNumLeftWallTests,
+      mNumRightWallTests - other.mNumRightWallTests,
+      mNumSweeps - other.mNumSweeps,
+      mNumTilesExamined - other.mNumTilesExamined,
+      mNumSolidBodyTests - other.mNumSolidBodyTests,
+      mNumSolidBodiesVisited - other.mNumSolidBodiesVisited};
+  }
+};
+
+}
@@ -17,18 +17,45 @@
 #include "entity_activation_system.hpp"
 
 #include "data/game_traits.hpp"
-#include "engine/base_components.hpp"
+#include "data/map.hpp"
 #include "engine/entity_tools.hpp"
-#include "engine/physical_components.hpp"
+
+#include <algorithm>
 
 
 namespace rigel::engine {
 
+namespace ex = entityx;
+
 using namespace components;
 
 
 namespace {
 
+// Size of a sector, in tiles
+constexpr auto SECTOR_SIZE = 16;
+
+
+int sectorsNeeded(const int sizeInTiles) {
+  return std::max((sizeInTiles + SECTOR_SIZE - 1) / SECTOR_SIZE, 1);
+}
+
+
+bool hasBoundsComponents(ex::Entity entity) {
+  return
+    entity.valid() &&
+    entity.has_component<WorldPosition>() &&
+    entity.has_component<BoundingBox>();
+}
+
+
+BoundingBox worldSpaceBboxOf(ex::Entity entity) {
+  return toWorldSpace(
+    *entity.component<const BoundingBox>(),
+    *entity.component<const WorldPosition>());
+}
+
+
 bool determineActiveState(entityx::Entity entity, const bool inActiveRegion) {
   using Policy = ActivationSettings::Policy;
 
@@ -58,27 +85,296 @@ bool determineActiveState(entityx::Entity entity, const bool inActiveRegion) {
 }
 
 
-void markActiveEntities(
+EntityActivationSystem::EntityActivationSystem(
+  const data::map::Map& map,
+  const data::ViewPortSize& viewPortSize,
+  entityx::EventManager& events
+)
+  : mActiveEntities(events)
+  , mActiveRegionSize(viewPortSize.mapViewPortSize())
+  , mSectorColumns(sectorsNeeded(map.width()))
+  , mSectorRows(sectorsNeeded(map.height()))
+{
+  mSectors.resize(mSectorColumns * mSectorRows);
+
+  events.subscribe<ex::ComponentAddedEvent<WorldPosition>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<BoundingBox>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<ActivationSettings>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<Active>>(*this);
+  events.subscribe<events::ClearingAllEntities>(*this);
+}
+
+
+void EntityActivationSystem::update(
   entityx::EntityManager& es,
   const base::Vector& cameraPosition
 ) {
-  const BoundingBox activeRegionBox{
-    cameraPosition,
-    data::GameTraits::mapViewPortSize};
+  const BoundingBox activeRegion{cameraPosition, mActiveRegionSize};
+
+  mIsUpdating = true;
+
+  if (mNeedsFullScan) {
+    scanAllEntities(es, activeRegion);
+    mNeedsFullScan = false;
+  } else {
+    mEntitiesToExamine.clear();
+    mActiveEntities.each(es, [this](
+      ex::Entity entity,
+      const WorldPosition&,
+      const BoundingBox&,
+      const Active&
+    ) {
+      mEntitiesToExamine.push_back(entity);
+    });
+
+    // Pending entities might already be in sectors. scanSectors() skips
+    // them, which needs the list sorted. They are sorted back in below,
+    // which makes any entries not visited by scanSectors() stale.
+    std::sort(begin(mPendingEntities), end(mPendingEntities));
+
+    // Adds entities which moved to the list
+    scanSectors(activeRegion);
+
+    mEntitiesToExamine.insert(
+      end(mEntitiesToExamine),
+      begin(mPendingEntities),
+      end(mPendingEntities));
+    mPendingEntities.clear();
+
+    // Pending and moved entities might also be active already, and moved
+    // entities are found once for each sector they were in. Make sure we
+    // don't examine (and possibly insert into sectors) the same entity twice
+    std::sort(begin(mEntitiesToExamine), end(mEntitiesToExamine));
+    mEntitiesToExamine.erase(
+      std::unique(begin(mEntitiesToExamine), end(mEntitiesToExamine)),
+      end(mEntitiesToExamine));
+
+    for (auto entity : mEntitiesToExamine) {
+      if (hasBoundsComponents(entity)) {
+        const auto bbox = worldSpaceBboxOf(entity);
+        if (!updateActiveState(entity, bbox, activeRegion)) {
+          insertIntoSectors(entity, bbox);
+        }
+      }
+    }
+  }
+
+  mIsUpdating = false;
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<WorldPosition>& event
+) {
+  if (!mIsUpdating) {
+    mPendingEntities.push_back(event.entity);
+  }
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<BoundingBox>& event
+) {
+  if (!mIsUpdating) {
+    mPendingEntities.push_back(event.entity);
+  }
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentAddedEvent<ActivationSettings>& event
+) {
+  if (!mIsUpdating) {
+    mPendingEntities.push_back(event.entity);
+  }
+}
+
+
+void EntityActivationSystem::receive(
+  const ex::ComponentRemovedEvent<Active>& event
+) {
+  if (!mIsUpdating) {
+    mPendingEntities.push_back(event.entity);
+  }
+}
+
+
+void EntityActivationSystem::receive(const events::ClearingAllEntities&) {
+  // The sectors would otherwise keep referring to the destroyed entities,
+  // whose IDs can be handed out again (e.g. by restoring a snapshot)
+  for (auto& sector : mSectors) {
+    sector.clear();
+  }
+  mPendingEntities.clear();
+  mNeedsFullScan = true;
+}
+
 
-  es.each<WorldPosition, BoundingBox>([&activeRegionBox](
-    entityx::Entity entity,
+void EntityActivationSystem::scanAllEntities(
+  entityx::EntityManager& es,
+  const BoundingBox& activeRegion
+) {
+  for (auto& sector : mSectors) {
+    sector.clear();
+  }
+  mPendingEntities.clear();
+
+  es.each<WorldPosition, BoundingBox>([&, this](
+    ex::Entity entity,
     const WorldPosition& position,
     const BoundingBox& bbox
   ) {
     const auto worldSpaceBbox = toWorldSpace(bbox, position);
-    const auto inActiveRegion = worldSpaceBbox.intersects(activeRegionBox);
-    const auto active = determineActiveState(entity, inActiveRegion);
-    setTag<Active>(entity, active);
-    if (active) {
-      entity.component<Active>()->mIsOnScreen = inActiveRegion;
+    if (!updateActiveState(entity, worldSpaceBbox, activeRegion)) {
+      insertIntoSectors(entity, worldSpaceBbox);
     }
   });
 }
 
+
+void EntityActivationSystem::scanSectors(const BoundingBox& activeRegion) {
+  const auto lastColumn = sectorColumn(activeRegion.right());
+  const auto lastRow = sectorRow(activeRegion.bottom());
+  for (auto row = sectorRow(activeRegion.top()); row <= lastRow; ++row) {
+    for (
+      auto col = sectorColumn(activeRegion.left());
+      col <= lastColumn;
+      ++col
+    ) {
+      scanSector(mSectors[col + row * mSectorColumns], true, activeRegion);
+    }
+  }
+
+  // Entities in the other sectors can't be in the active region unless they
+  // moved, so those sectors only need to be checked for moved entities. To
+  // spread the work, only some of them are checked on each update.
+  const auto numSectors = static_cast<int>(mSectors.size());
+  const auto numSectorsToCheck =
+    (numSectors + SECTOR_CHECK_INTERVAL - 1) / SECTOR_CHECK_INTERVAL;
+  for (auto i = 0; i < numSectorsToCheck; ++i) {
+    const auto index = mNextSectorToCheck;
+    mNextSectorToCheck = (mNextSectorToCheck + 1) % numSectors;
+
+    const auto col = index % mSectorColumns;
+    const auto row = index / mSectorColumns;
+    if (!sectorOverlaps(col, row, activeRegion)) {
+      scanSector(mSectors[index], false, activeRegion);
+    }
+  }
+}
+
+
+void EntityActivationSystem::scanSector(
+  Sector& sector,
+  const bool overlapsActiveRegion,
+  const BoundingBox& activeRegion
+) {
+  auto numKept = std::size_t{0};
+  for (std::size_t i = 0; i < sector.size(); ++i) {
+    const auto& entry = sector[i];
+    auto entity = entry.mEntity;
+
+    // Active entities have already been taken care of. Entities which
+    // lost their position or bbox will be examined again once they
+    // get them back.
+    if (!hasBoundsComponents(entity) || entity.has_component<Active>()) {
+      continue;
+    }
+
+    // The entity has been sorted into sectors again since this entry was
+    // made. Its current entries are elsewhere.
+    if (entry.mSortStamp != mSortStamps[entity.id().index()]) {
+      continue;
+    }
+
+    const auto isPending = std::binary_search(
+      begin(mPendingEntities), end(mPendingEntities), entity);
+    if (isPending) {
+      continue;
+    }
+
+    // Moved entities are examined by the caller, and sorted into their new
+    // sectors. That also makes their entries in other sectors stale.
+    const auto bbox = worldSpaceBboxOf(entity);
+    if (bbox != entry.mBbox) {
+      mEntitiesToExamine.push_back(entity);
+      continue;
+    }
+
+    if (
+      !overlapsActiveRegion ||
+      !updateActiveState(entity, bbox, activeRegion)
+    ) {
+      sector[numKept++] = entry;
+    }
+  }
+
+  sector.resize(numKept);
+}
+
+
+bool EntityActivationSystem::sectorOverlaps(
+  const int column,
+  const int row,
+  const BoundingBox& region
+) const {
+  return
+    column >= sectorColumn(region.left()) &&
+    column <= sectorColumn(region.right()) &&
+    row >= sectorRow(region.top()) &&
+    row <= sectorRow(region.bottom());
+}
+
+
+bool EntityActivationSystem::updateActiveState(
+  entityx::Entity entity,
+  const BoundingBox& worldSpaceBbox,
+  const BoundingBox& activeRegion
+) {
+  const auto inActiveRegion = worldSpaceBbox.intersects(activeRegion);
+  const auto active = determineActiveState(entity, inActiveRegion);
+  setTag<Active>(entity, active);
+  if (active) {
+    entity.component<Active>()->mIsOnScreen = inActiveRegion;
+  }
+
+  return active;
+}
+
+
+void EntityActivationSystem::insertIntoSectors(
+  entityx::Entity entity,
+  const BoundingBox& worldSpaceBbox
+) {
+  const auto index = entity.id().index();
+  if (index >= mSortStamps.size()) {
+    mSortStamps.resize(index + 1);
+  }
+
+  const auto stamp = ++mSortStamps[index];
+
+  const auto lastColumn = sectorColumn(worldSpaceBbox.right());
+  const auto lastRow = sectorRow(worldSpaceBbox.bottom());
+  for (auto row = sectorRow(worldSpaceBbox.top()); row <= lastRow; ++row) {
+    for (
+      auto col = sectorColumn(worldSpaceBbox.left());
+      col <= lastColumn;
+      ++col
+    ) {
+      mSectors[col + row * mSectorColumns].push_back(
+        SectorEntry{entity, worldSpaceBbox, stamp});
+    }
+  }
+}
+
+
+int EntityActivationSystem::sectorColumn(const int x) const {
+  return std::clamp(x / SECTOR_SIZE, 0, mSectorColumns - 1);
+}
+
+
+int EntityActivationSystem::sectorRow(const int y) const {
+  return std::clamp(y / SECTOR_SIZE, 0, mSectorRows - 1);
+}
+
 }
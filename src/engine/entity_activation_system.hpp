@@ -18,16 +18,129 @@
 
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
+#include "engine/base_components.hpp"
+#include "engine/entity_tools.hpp"
+#include "engine/packed_entity_view.hpp"
+#include "engine/physical_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel::data { struct ViewPortSize; }
+namespace rigel::data::map { class Map; }
+
 
 namespace rigel::engine {
 
-void markActiveEntities(
-  entityx::EntityManager& es,
-  const base::Vector& cameraPosition);
+/** Assigns/removes the Active tag based on the camera position
+ *
+ * See components::Active and components::ActivationSettings for the rules.
+ *
+ * To avoid examining every entity on each update, inactive entities are
+ * kept in a grid of map sectors, and only those in sectors overlapping the
+ * active region are examined. Active entities are always re-examined, as
+ * are entities which were given a position, bounding box or activation
+ * settings since the last update.
+ *
+ * Positions and bounding boxes are plain components which can be written
+ * to at any time, even while an entity is inactive. Each sector entry
+ * therefore remembers the bounding box the entity was sorted in with. On
+ * each update, the entries of all sectors overlapping the active region are
+ * compared against their entity's current bounding box. Entities which
+ * moved are sorted into their new sectors and examined right away.
+ *
+ * The remaining sectors are checked for moved entities in turns, so that
+ * each of them is checked once every SECTOR_CHECK_INTERVAL updates. An
+ * inactive entity which is moved directly into the active region from a
+ * sector that doesn't overlap it therefore becomes active up to
+ * SECTOR_CHECK_INTERVAL - 1 updates later than if all entities were
+ * examined. Entities moved by way of a MovingBody are only moved while
+ * they are active, and so are not affected. Neither are entities which are
+ * given a new position or bounding box component, or entities moved within
+ * or out of sectors overlapping the active region.
+ */
+class EntityActivationSystem :
+  public entityx::Receiver<EntityActivationSystem> {
+public:
+  static constexpr auto SECTOR_CHECK_INTERVAL = 8;
+
+  EntityActivationSystem(
+    const data::map::Map& map,
+    const data::ViewPortSize& viewPortSize,
+    entityx::EventManager& events);
+
+  void update(
+    entityx::EntityManager& es,
+    const base::Vector& cameraPosition);
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::WorldPosition>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::BoundingBox>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::ActivationSettings>&
+      event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::Active>& event);
+  void receive(const events::ClearingAllEntities& event);
+
+private:
+  struct SectorEntry {
+    entityx::Entity mEntity;
+
+    /** World-space bounding box at the time of sorting into sectors */
+    components::BoundingBox mBbox;
+
+    /** Entries whose stamp differs from mSortStamps are left over from an
+     * earlier sorting, and are dropped
+     */
+    std::uint32_t mSortStamp;
+  };
+
+  using Sector = std::vector<SectorEntry>;
+
+  void scanAllEntities(
+    entityx::EntityManager& es,
+    const components::BoundingBox& activeRegion);
+  void scanSectors(const components::BoundingBox& activeRegion);
+  void scanSector(
+    Sector& sector,
+    bool overlapsActiveRegion,
+    const components::BoundingBox& activeRegion);
+  bool sectorOverlaps(
+    int column,
+    int row,
+    const components::BoundingBox& region) const;
+  bool updateActiveState(
+    entityx::Entity entity,
+    const components::BoundingBox& worldSpaceBbox,
+    const components::BoundingBox& activeRegion);
+  void insertIntoSectors(
+    entityx::Entity entity,
+    const components::BoundingBox& worldSpaceBbox);
+
+  int sectorColumn(int x) const;
+  int sectorRow(int y) const;
+
+  PackedEntityView<
+    components::WorldPosition,
+    components::BoundingBox,
+    components::Active> mActiveEntities;
+  std::vector<Sector> mSectors;
+  std::vector<std::uint32_t> mSortStamps;
+  std::vector<entityx::Entity> mPendingEntities;
+  std::vector<entityx::Entity> mEntitiesToExamine;
+  base::Extents mActiveRegionSize;
+  int mSectorColumns;
+  int mSectorRows;
+  int mNextSectorToCheck = 0;
+  bool mNeedsFullScan = true;
+  bool mIsUpdating = false;
+};
 
 }
@@ -0,0 +1,202 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "entity_grid.hpp"
+
+#include "engine/physical_components.hpp"
+
+#include <algorithm>
+
+
+namespace rigel::engine {
+
+namespace ex = entityx;
+
+using namespace engine::components;
+
+namespace {
+
+// Size of a grid cell, in tiles
+constexpr auto GRID_CELL_SIZE = 16;
+
+
+int gridCellsNeeded(const int sizeInTiles) {
+  return std::max((sizeInTiles + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE, 1);
+}
+
+
+std::optional<BoundingBox> worldSpaceBbox(ex::Entity entity) {
+  if (
+    entity.has_component<BoundingBox>() &&
+    entity.has_component<WorldPosition>()
+  ) {
+    return engine::toWorldSpace(
+      *entity.component<const BoundingBox>(),
+      *entity.component<const WorldPosition>());
+  }
+
+  return std::nullopt;
+}
+
+}
+
+
+EntityGrid::EntityGrid(const int mapWidthInTiles, const int mapHeightInTiles)
+  : mColumns(gridCellsNeeded(mapWidthInTiles))
+  , mRows(gridCellsNeeded(mapHeightInTiles))
+{
+  mGrid.resize(mColumns * mRows);
+}
+
+
+void EntityGrid::insert(ex::Entity entity) {
+  if (!mEntities.insert(entity)) {
+    return;
+  }
+
+  const auto bbox = worldSpaceBbox(entity);
+  const auto mayMove = entity.has_component<MovingBody>() || !bbox;
+  mEntries.push_back(EntryInfo{bbox, mayMove});
+  insertIntoGrid(mEntries.size() - 1);
+}
+
+
+void EntityGrid::insert(ex::Entity entity, const BoundingBox& area) {
+  if (!mEntities.insert(entity)) {
+    return;
+  }
+
+  mEntries.push_back(EntryInfo{area, false});
+  insertIntoGrid(mEntries.size() - 1);
+}
+
+
+void EntityGrid::remove(ex::Entity entity) {
+  const auto maybeIndex = mEntities.indexOf(entity);
+  if (!maybeIndex) {
+    return;
+  }
+
+  // Same approach as in CollisionChecker: The last entry is moved into the
+  // removed one's slot, so its grid entries need to be updated as well.
+  const auto index = *maybeIndex;
+  const auto lastIndex = mEntries.size() - 1;
+
+  removeFromGrid(index);
+  if (index != lastIndex) {
+    removeFromGrid(lastIndex);
+    mEntries[index] = mEntries[lastIndex];
+    insertIntoGrid(index);
+  }
+
+  mEntries.pop_back();
+  mEntities.removeAt(index);
+}
+
+
+void EntityGrid::clear() {
+  for (auto& cell : mGrid) {
+    cell.clear();
+  }
+
+  mEntries.clear();
+  mEntities.clear();
+}
+
+
+const std::vector<ex::Entity>& EntityGrid::entitiesNear(
+  const BoundingBox& area
+) {
+  updateMovableEntities();
+
+  mQueryResult.clear();
+  forEachCoveredCell(area, [this](const std::vector<std::size_t>& cell) {
+    for (const auto index : cell) {
+      mQueryResult.push_back(mEntities[index]);
+    }
+  });
+
+  // Entities covering more than one cell show up multiple times
+  const auto byIndex = [](const ex::Entity lhs, const ex::Entity rhs) {
+    return lhs.id().index() < rhs.id().index();
+  };
+  std::sort(mQueryResult.begin(), mQueryResult.end(), byIndex);
+  mQueryResult.erase(
+    std::unique(mQueryResult.begin(), mQueryResult.end()),
+    mQueryResult.end());
+
+  return mQueryResult;
+}
+
+
+void EntityGrid::updateMovableEntities() {
+  for (std::size_t i = 0; i < mEntries.size(); ++i) {
+    auto& info = mEntries[i];
+    if (!info.mMayMove) {
+      continue;
+    }
+
+    const auto currentBbox = worldSpaceBbox(mEntities[i]);
+    if (currentBbox != info.mWorldSpaceBbox) {
+      removeFromGrid(i);
+      info.mWorldSpaceBbox = currentBbox;
+      insertIntoGrid(i);
+    }
+  }
+}
+
+
+void EntityGrid::insertIntoGrid(const std::size_t index) {
+  if (const auto& bbox = mEntries[index].mWorldSpaceBbox) {
+    forEachCoveredCell(*bbox, [index](std::vector<std::size_t>& cell) {
+      cell.push_back(index);
+    });
+  }
+}
+
+
+void EntityGrid::removeFromGrid(const std::size_t index) {
+  if (const auto& bbox = mEntries[index].mWorldSpaceBbox) {
+    forEachCoveredCell(*bbox, [index](std::vector<std::size_t>& cell) {
+      cell.erase(std::remove(cell.begin(), cell.end(), index), cell.end());
+    });
+  }
+}
+
+
+template <typename Callback>
+void EntityGrid::forEachCoveredCell(
+  const BoundingBox& bbox,
+  Callback&& callback
+) {
+  const auto toColumn = [this](const int x) {
+    return std::clamp(x / GRID_CELL_SIZE, 0, mColumns - 1);
+  };
+  const auto toRow = [this](const int y) {
+    return std::clamp(y / GRID_CELL_SIZE, 0, mRows - 1);
+  };
+
+  const auto lastColumn = toColumn(bbox.right());
+  const auto lastRow = toRow(bbox.bottom());
+  for (auto row = toRow(bbox.top()); row <= lastRow; ++row) {
+    for (auto col = toColumn(bbox.left()); col <= lastColumn; ++col) {
+      callback(mGrid[col + row * mColumns]);
+    }
+  }
+}
+
+}
@@ -0,0 +1,113 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "engine/base_components.hpp"
+#include "engine/entity_slot_list.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+
+namespace rigel::engine {
+
+/** Uniform grid of entities, for finding the ones close to a given area
+ *
+ * Works like the solid body grid in CollisionChecker. Entities are put into
+ * all cells covered by their world space bounding box at the time they are
+ * inserted. Entities with a MovingBody, and those that lack a position or
+ * bounding box when inserted, are checked for movement before each query,
+ * and moved to different cells as needed.
+ *
+ * All other entities are assumed to stay in place. Changing their position
+ * or bounding box directly is not supported: the grid keeps reporting them
+ * in the old area. Only use this for kinds of entities that either don't
+ * move at all, or move by way of a MovingBody.
+ *
+ * Entities need to be removed before they are destroyed, see EntitySlotList.
+ */
+class EntityGrid {
+public:
+  EntityGrid(int mapWidthInTiles, int mapHeightInTiles);
+
+  void insert(entityx::Entity entity);
+
+  /** Insert entity with a fixed world space area
+   *
+   * The area is used instead of the entity's bounding box, and is never
+   * updated. Useful for trigger volumes, which cover the area in which an
+   * entity reacts to something rather than the entity itself.
+   */
+  void insert(entityx::Entity entity, const components::BoundingBox& area);
+
+  void remove(entityx::Entity entity);
+
+  /** Remove all entities at once */
+  void clear();
+
+  /** Find entities that might intersect the given world space area
+   *
+   * The result contains all entities whose bounding box intersects the
+   * area, but might contain some more. Entities are ordered by index, like
+   * when iterating with EntityManager::each(). The returned list stays valid
+   * until the next query, so the grid can be modified while going through
+   * it.
+   */
+  const std::vector<entityx::Entity>& entitiesNear(
+    const components::BoundingBox& area);
+
+  const EntitySlotList& entities() const {
+    return mEntities;
+  }
+
+private:
+  struct EntryInfo {
+    // World space bounding box at the time the entity was put into the
+    // grid. Empty if the entity lacked a position or bounding box.
+    std::optional<components::BoundingBox> mWorldSpaceBbox;
+
+    // Whether the entity needs to be checked for movement on each query
+    bool mMayMove;
+  };
+
+  void updateMovableEntities();
+  void insertIntoGrid(std::size_t index);
+  void removeFromGrid(std::size_t index);
+
+  template <typename Callback>
+  void forEachCoveredCell(
+    const components::BoundingBox& bbox,
+    Callback&& callback);
+
+  // mEntities holds the entity for each entry in mEntries, at the same
+  // position
+  std::vector<EntryInfo> mEntries;
+  EntitySlotList mEntities;
+  std::vector<std::vector<std::size_t>> mGrid;
+  std::vector<entityx::Entity> mQueryResult;
+  int mColumns;
+  int mRows;
+};
+
+}
@@ -0,0 +1,165 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Densely stored set of entities with constant time lookup and removal
+ *
+ * A table indexed by entity index stores each entity's position in the list.
+ * The table also remembers the entity's version, so that an entity which
+ * reuses the index of a destroyed one isn't mistaken for it.
+ *
+ * Entities need to be removed before they are destroyed, typically by
+ * listening to the ComponentRemovedEvent of the component that defines
+ * membership in the list.
+ */
+class EntitySlotList {
+public:
+  /** Append entity, unless it's already contained
+   *
+   * Returns true if the entity was added.
+   */
+  bool insert(const entityx::Entity entity) {
+    const auto id = entity.id();
+    if (id.index() >= mSlots.size()) {
+      mSlots.resize(id.index() + 1);
+    }
+
+    auto& slot = mSlots[id.index()];
+    if (slot.mPosition != NOT_CONTAINED) {
+      assert(slot.mVersion == id.version());
+      return false;
+    }
+
+    slot.mVersion = id.version();
+    slot.mPosition = static_cast<std::uint32_t>(mEntities.size());
+    mEntities.push_back(entity);
+    return true;
+  }
+
+  std::optional<std::size_t> indexOf(const entityx::Entity entity) const {
+    const auto id = entity.id();
+    if (id.index() >= mSlots.size()) {
+      return std::nullopt;
+    }
+
+    const auto& slot = mSlots[id.index()];
+    if (slot.mPosition == NOT_CONTAINED || slot.mVersion != id.version()) {
+      return std::nullopt;
+    }
+
+    return slot.mPosition;
+  }
+
+  bool contains(const entityx::Entity entity) const {
+    return indexOf(entity).has_value();
+  }
+
+  /** Remove the entity at the given position
+   *
+   * The last entity is moved into the freed position.
+   */
+  void removeAt(const std::size_t index) {
+    assert(index < mEntities.size());
+    assert(mEntities[index].valid());
+
+    mSlots[mEntities[index].id().index()].mPosition = NOT_CONTAINED;
+
+    // The last entity might be a gap left by removeAtKeepingOrder()
+    const auto lastIndex = mEntities.size() - 1;
+    if (index != lastIndex) {
+      mEntities[index] = mEntities[lastIndex];
+      if (mEntities[index].valid()) {
+        mSlots[mEntities[index].id().index()].mPosition =
+          static_cast<std::uint32_t>(index);
+      }
+    }
+
+    mEntities.pop_back();
+  }
+
+  /** Remove the entity at the given position, keeping the order intact
+   *
+   * This leaves an invalid entity behind in the freed position, which
+   * needs to be skipped when iterating. It's only reclaimed by clear().
+   */
+  void removeAtKeepingOrder(const std::size_t index) {
+    assert(index < mEntities.size());
+    assert(mEntities[index].valid());
+
+    mSlots[mEntities[index].id().index()].mPosition = NOT_CONTAINED;
+    mEntities[index] = entityx::Entity{};
+  }
+
+  void clear() {
+    for (const auto& entity : mEntities) {
+      if (entity.valid()) {
+        mSlots[entity.id().index()].mPosition = NOT_CONTAINED;
+      }
+    }
+
+    mEntities.clear();
+  }
+
+  std::size_t size() const {
+    return mEntities.size();
+  }
+
+  bool empty() const {
+    return mEntities.empty();
+  }
+
+  entityx::Entity operator[](const std::size_t index) const {
+    return mEntities[index];
+  }
+
+  auto begin() const {
+    return mEntities.begin();
+  }
+
+  auto end() const {
+    return mEntities.end();
+  }
+
+private:
+  static constexpr auto NOT_CONTAINED =
+    std::numeric_limits<std::uint32_t>::max();
+
+  struct Slot {
+    std::uint32_t mVersion = 0;
+    std::uint32_t mPosition = NOT_CONTAINED;
+  };
+
+  std::vector<entityx::Entity> mEntities;
+  std::vector<Slot> mSlots;
+};
+
+}
@@ -23,9 +23,45 @@ RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <bitset>
+
 
 namespace rigel::engine {
 
+namespace events {
+
+/** Emitted by clearAllEntities() right before all entities are destroyed */
+struct ClearingAllEntities {};
+
+}
+
+
+using ComponentMask = std::bitset<entityx::MAX_COMPONENTS>;
+
+
+template<typename... Components>
+const ComponentMask& componentMask() {
+  static const auto mask = []() {
+    ComponentMask result;
+    (result.set(entityx::Component<Components>::family()), ...);
+    return result;
+  }();
+  return mask;
+}
+
+
+/** Like has_component, but for several component types at once
+ *
+ * Tests the entity's component mask a single time, instead of doing a
+ * separate look-up for each type.
+ */
+template<typename... Components>
+bool hasAllComponents(const entityx::Entity entity) {
+  const auto& mask = componentMask<Components...>();
+  return (entity.component_mask() & mask) == mask;
+}
+
+
 template<typename TagComponent>
 void setTag(entityx::Entity entity, const bool assignTag) {
   if (!entity.has_component<TagComponent>() && assignTag) {
@@ -53,6 +89,23 @@ void reassign(entityx::Entity entity, Args&&... args) {
 }
 
 
+/** Destroy all entities at once, e.g. when restarting a level
+ *
+ * entityx still emits a ComponentRemovedEvent for every single component
+ * while resetting the entity manager. Systems which keep their own index of
+ * entities listen to ClearingAllEntities and drop that index wholesale, so
+ * that those events don't find anything to remove anymore. Otherwise,
+ * removing every entry one by one can take quadratic time.
+ */
+inline void clearAllEntities(
+  entityx::EntityManager& es,
+  entityx::EventManager& events
+) {
+  events.emit(events::ClearingAllEntities{});
+  es.reset();
+}
+
+
 inline bool isOnScreen(const entityx::Entity entity) {
   return
       entity.has_component<components::Active>() &&
@@ -0,0 +1,66 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Buffer for events of a single type, to be dispatched in one batch
+ *
+ * Meant for events which are produced in large numbers by a tight loop,
+ * like a system's update. Instead of going through the event manager for
+ * each event individually while the loop is running, events are collected
+ * and then handed out all at once afterwards.
+ *
+ * The storage is kept across batches, so no allocations happen once the
+ * queue has grown to the typical number of events per batch.
+ */
+template <typename Event>
+class EventQueue {
+public:
+  void push(const Event& event) {
+    mEvents.push_back(event);
+  }
+
+  /** Invoke func for each queued event in order, then clear the queue
+   *
+   * Events which are pushed from within func are dispatched as part of the
+   * same batch.
+   */
+  template <typename Func>
+  void dispatch(Func func) {
+    for (std::size_t i = 0; i < mEvents.size(); ++i) {
+      // Copy, since func might push new events and thus reallocate
+      const auto event = mEvents[i];
+      func(event);
+    }
+
+    mEvents.clear();
+  }
+
+  bool empty() const {
+    return mEvents.empty();
+  }
+
+private:
+  std::vector<Event> mEvents;
+};
+
+}
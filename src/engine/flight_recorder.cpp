@@ -0,0 +1,153 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "flight_recorder.hpp"
+
+#include "base/tunables.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+
+namespace rigel::engine {
+
+namespace {
+
+base::Tunable<int> gSlowFrameBudgetMs{
+  "slow-frame-budget-ms",
+  "Frames taking longer than this are written out by the flight recorder",
+  50,
+  1,
+  10000};
+
+base::Tunable<int> gSlowTickBudgetMs{
+  "slow-tick-budget-ms",
+  "Logic ticks taking longer than this are written out by the flight "
+  "recorder",
+  10,
+  1,
+  10000};
+
+
+std::string formatMs(const double timeMs) {
+  std::stringstream stream;
+  stream << std::fixed << std::setprecision(2) << timeMs;
+  return stream.str();
+}
+
+}
+
+
+void FlightRecorder::enable(std::string pathPrefix) {
+  mPathPrefix = std::move(pathPrefix);
+  mIsEnabled = true;
+  traceRecorder().setEnabled(true);
+}
+
+
+void FlightRecorder::setWorldState(
+  const std::string& levelName,
+  const base::Vector& cameraPosition,
+  const std::size_t numEntities
+) {
+  if (!mWorldState) {
+    mWorldState = WorldState{};
+  }
+
+  // Assigning an equal string doesn't allocate, so this is cheap enough to
+  // do on every tick
+  mWorldState->mLevelName = levelName;
+  mWorldState->mCameraPosition = cameraPosition;
+  mWorldState->mNumEntities = numEntities;
+}
+
+
+void FlightRecorder::clearWorldState() {
+  mWorldState = std::nullopt;
+}
+
+
+void FlightRecorder::checkFrameTime(const double frameTimeMs) {
+  if (mIsEnabled && frameTimeMs > gSlowFrameBudgetMs) {
+    dump("Slow frame", frameTimeMs, gSlowFrameBudgetMs);
+  }
+}
+
+
+void FlightRecorder::checkTickTime(const double tickTimeMs) {
+  if (mIsEnabled && tickTimeMs > gSlowTickBudgetMs) {
+    dump("Slow logic tick", tickTimeMs, gSlowTickBudgetMs);
+  }
+}
+
+
+void FlightRecorder::dump(
+  const char* pReason,
+  const double timeMs,
+  const int budgetMs
+) {
+  const auto now = Clock::now();
+  if (
+    mNumDumps >= MAX_DUMPS ||
+    (mLastDumpTime && now - *mLastDumpTime < MIN_TIME_BETWEEN_DUMPS)
+  ) {
+    return;
+  }
+
+  TraceZone zone("Flight recorder dump");
+
+  mLastDumpTime = now;
+  ++mNumDumps;
+
+  std::vector<std::pair<std::string, std::string>> metadata{
+    {"reason", pReason},
+    {"durationMs", formatMs(timeMs)},
+    {"budgetMs", std::to_string(budgetMs)}};
+  if (mWorldState) {
+    metadata.emplace_back("level", mWorldState->mLevelName);
+    metadata.emplace_back(
+      "cameraPosition",
+      std::to_string(mWorldState->mCameraPosition.x) + "," +
+        std::to_string(mWorldState->mCameraPosition.y));
+    metadata.emplace_back(
+      "numEntities", std::to_string(mWorldState->mNumEntities));
+  }
+
+  const auto path = mPathPrefix + "_" + std::to_string(mNumDumps) + ".json";
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    std::cerr
+      << "WARNING: Failed to write flight recorder dump " << path << '\n';
+    return;
+  }
+
+  traceRecorder().writeChromeTrace(file, now - RECORDING_WINDOW, metadata);
+  std::cout
+    << pReason << " (" << formatMs(timeMs) << " ms), trace written to "
+    << path << '\n';
+}
+
+
+FlightRecorder& flightRecorder() {
+  static FlightRecorder recorder;
+  return recorder;
+}
+
+}
@@ -0,0 +1,91 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "engine/trace_recorder.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+
+
+namespace rigel::engine {
+
+/** Writes out recent trace data whenever a frame or logic tick is too slow
+ *
+ * Occasional hitches are hard to catch with a manually started trace. Once
+ * enabled, the flight recorder keeps the process-wide TraceRecorder running
+ * and checks each frame and logic tick against the budgets given by the
+ * slow-frame-budget-ms and slow-tick-budget-ms tunables. When one is
+ * exceeded, everything recorded during the last RECORDING_WINDOW is written
+ * to a new trace file, together with the current level, camera position
+ * and entity count.
+ *
+ * Dumps are at least MIN_TIME_BETWEEN_DUMPS apart, and there are at most
+ * MAX_DUMPS per run, so that a series of hitches doesn't flood the disk.
+ * Writing a dump is itself slow, and shows up in the next one.
+ *
+ * Only meant to be used from the main thread.
+ */
+class FlightRecorder {
+public:
+  using Clock = TraceRecorder::Clock;
+
+  static constexpr auto RECORDING_WINDOW = std::chrono::seconds{5};
+  static constexpr auto MIN_TIME_BETWEEN_DUMPS = std::chrono::seconds{10};
+  static constexpr auto MAX_DUMPS = 20;
+
+  /** Start recording. Dumps are named <pathPrefix>_<number>.json */
+  void enable(std::string pathPrefix);
+
+  bool isEnabled() const {
+    return mIsEnabled;
+  }
+
+  /** Remember what the game world looks like, for the next dump */
+  void setWorldState(
+    const std::string& levelName,
+    const base::Vector& cameraPosition,
+    std::size_t numEntities);
+  void clearWorldState();
+
+  void checkFrameTime(double frameTimeMs);
+  void checkTickTime(double tickTimeMs);
+
+private:
+  struct WorldState {
+    std::string mLevelName;
+    base::Vector mCameraPosition;
+    std::size_t mNumEntities = 0;
+  };
+
+  void dump(const char* pReason, double timeMs, int budgetMs);
+
+  std::string mPathPrefix;
+  std::optional<WorldState> mWorldState;
+  std::optional<Clock::time_point> mLastDumpTime;
+  int mNumDumps = 0;
+  bool mIsEnabled = false;
+};
+
+
+/** The process-wide flight recorder */
+FlightRecorder& flightRecorder();
+
+}
@@ -0,0 +1,141 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <thread>
+
+
+namespace rigel::engine {
+
+namespace {
+
+// Sleeping is only precise to about a millisecond on most systems, so the
+// remainder of the wait is spent spinning
+constexpr auto SPIN_TIME = std::chrono::milliseconds{1};
+
+
+double toMs(const FramePacer::Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}
+
+
+FramePacer::FramePacer(const std::optional<int> targetFrameRate)
+  : mFrameStart(Clock::now())
+{
+  if (targetFrameRate) {
+    assert(*targetFrameRate > 0);
+    mFrameDuration = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>{1.0 / *targetFrameRate});
+  }
+}
+
+
+void FramePacer::beginFrame() {
+  mFrameStart = Clock::now();
+}
+
+
+void FramePacer::waitForNextFrame() {
+  const auto waitStart = Clock::now();
+  const auto workTime = waitStart - mFrameStart;
+
+  ++mCurrentReport.mNumFrames;
+  mTotalWorkTime += workTime;
+  mCurrentReport.mMaxWorkTimeMs =
+    std::max(mCurrentReport.mMaxWorkTimeMs, toMs(workTime));
+
+  if (!mFrameDuration) {
+    return;
+  }
+
+  if (workTime > *mFrameDuration) {
+    ++mCurrentReport.mNumFramesOverBudget;
+  }
+
+  // Deadlines are derived from the previous one instead of the current time,
+  // so that small inaccuracies don't add up over time. If we've fallen behind
+  // (e.g. due to a slow frame or the main loop idling), we start over from
+  // the current time instead of trying to catch up.
+  const auto deadline = mNextFrameStart.value_or(mFrameStart + *mFrameDuration);
+  if (waitStart >= deadline) {
+    mNextFrameStart = waitStart + *mFrameDuration;
+    return;
+  }
+
+  if (deadline - waitStart > SPIN_TIME) {
+    std::this_thread::sleep_for(deadline - waitStart - SPIN_TIME);
+  }
+
+  while (Clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+
+  mTotalWaitTime += Clock::now() - waitStart;
+  mNextFrameStart = deadline + *mFrameDuration;
+}
+
+
+FramePacer::Report FramePacer::takeReport() {
+  auto report = mCurrentReport;
+  if (report.mNumFrames > 0) {
+    report.mAverageWorkTimeMs = toMs(mTotalWorkTime) / report.mNumFrames;
+    report.mAverageWaitTimeMs = toMs(mTotalWaitTime) / report.mNumFrames;
+  }
+
+  mCurrentReport = Report{};
+  mTotalWorkTime = {};
+  mTotalWaitTime = {};
+
+  return report;
+}
+
+
+std::optional<double> FramePacer::frameBudgetMs() const {
+  if (mFrameDuration) {
+    return toMs(*mFrameDuration);
+  }
+
+  return std::nullopt;
+}
+
+
+void printFramePacingReport(
+  std::ostream& stream,
+  const FramePacer::Report& report,
+  const std::optional<double> frameBudgetMs
+) {
+  stream
+    << "Frame pacing: " << report.mNumFrames << " frames, "
+    << report.mAverageWorkTimeMs << " ms avg. work, "
+    << report.mMaxWorkTimeMs << " ms max. work, "
+    << report.mAverageWaitTimeMs << " ms avg. wait";
+
+  if (frameBudgetMs) {
+    stream
+      << ", " << report.mNumFramesOverBudget << " over budget of "
+      << *frameBudgetMs << " ms";
+  }
+
+  stream << '\n';
+}
+
+}
@@ -0,0 +1,81 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+
+
+namespace rigel::engine {
+
+/** Limits the main loop to a target frame rate
+ *
+ * Vsync alone doesn't pace the main loop when it's disabled by the driver,
+ * or on variable refresh rate displays, where the game would otherwise
+ * render as many frames as it possibly can. With a target frame rate, the
+ * pacer waits at the end of each frame until the next one is due. Most of
+ * that time is spent sleeping, only the last bit is done by spinning, since
+ * the OS' sleep granularity is often too coarse for precise timing.
+ *
+ * Without a target frame rate, the pacer never waits, but still measures
+ * how long frames take.
+ */
+class FramePacer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Report {
+    std::size_t mNumFrames = 0;
+    std::size_t mNumFramesOverBudget = 0;
+    double mAverageWorkTimeMs = 0.0;
+    double mMaxWorkTimeMs = 0.0;
+    double mAverageWaitTimeMs = 0.0;
+  };
+
+  explicit FramePacer(std::optional<int> targetFrameRate);
+
+  /** Mark the start of a new frame */
+  void beginFrame();
+
+  /** Wait until the next frame is due, if there is a target frame rate */
+  void waitForNextFrame();
+
+  /** Statistics since the last call, resets to an empty report */
+  Report takeReport();
+
+  /** Time available per frame, if there is a target frame rate */
+  std::optional<double> frameBudgetMs() const;
+
+private:
+  std::optional<Clock::duration> mFrameDuration;
+  Clock::time_point mFrameStart;
+  std::optional<Clock::time_point> mNextFrameStart;
+
+  Report mCurrentReport;
+  Clock::duration mTotalWorkTime{};
+  Clock::duration mTotalWaitTime{};
+};
+
+
+void printFramePacingReport(
+  std::ostream& stream,
+  const FramePacer::Report& report,
+  std::optional<double> frameBudgetMs);
+
+}
@@ -16,8 +16,13 @@
 
 #include "imf_player.hpp"
 
+#include "base/match.hpp"
 #include "base/math_tools.hpp"
 #include "data/game_traits.hpp"
+#include "engine/audio_statistics.hpp"
+#include "engine/trace_recorder.hpp"
+
+#include <algorithm>
 
 
 namespace rigel::engine {
@@ -33,59 +38,274 @@ int imfDelayToSamples(const int delay, const int sampleRate) {
 }
 
 
-ImfPlayer::ImfPlayer(const int sampleRate)
-  : mEmulator(sampleRate)
+data::AudioBuffer renderImfSong(const data::Song& song, const int sampleRate) {
+  loader::AdlibEmulator emulator{sampleRate};
+  data::AudioBuffer result{sampleRate, {}};
+
+  for (const auto& command : song) {
+    emulator.writeRegister(command.reg, command.value);
+
+    if (command.delay > 0) {
+      const auto samples = imfDelayToSamples(command.delay, sampleRate);
+      const auto previousSize = result.mSamples.size();
+      result.mSamples.resize(previousSize + samples);
+      emulator.render(samples, result.mSamples.data() + previousSize);
+    }
+  }
+
+  return result;
+}
+
+
+ImfPlayer::ImfPlayer(
+  const int sampleRate,
+  AudioStatistics* pStatistics,
+  const loader::AdlibEmulator::Mode emulationMode
+)
+  : mEmulator(sampleRate, emulationMode)
+  , mpStatistics(pStatistics)
   , mSampleRate(sampleRate)
-  , mSongSwitchPending(false)
 {
 }
 
 
 void ImfPlayer::playSong(data::Song&& song) {
-  {
-    std::lock_guard<std::mutex> takeLock{mAudioLock};
-    mNextSongData = std::move(song);
+  sendCommand(PlaySong{prepareSong(song), std::chrono::steady_clock::now()});
+}
+
+
+void ImfPlayer::stop() {
+  sendCommand(Stop{});
+}
+
+
+void ImfPlayer::useRenderedSong(RenderedSong pRendered) {
+  sendCommand(UseRenderedSong{std::move(pRendered)});
+}
+
+
+void ImfPlayer::setVolume(const float volume) {
+  sendCommand(SetVolume{std::clamp(volume, 0.0f, 1.0f)});
+}
+
+
+void ImfPlayer::fadeVolume(const float targetVolume, const TimeDelta duration) {
+  const auto durationInSamples = base::round(duration * mSampleRate);
+  sendCommand(FadeVolume{
+    std::clamp(targetVolume, 0.0f, 1.0f), std::max(durationInSamples, 0)});
+}
+
+
+auto ImfPlayer::prepareSong(const data::Song& song) const -> PreparedSong {
+  PreparedSong result;
+  result.mWrites.reserve(song.size());
+
+  auto totalSamples = std::uint64_t{0};
+  auto blockStart = std::uint32_t{0};
+  for (const auto& command : song) {
+    result.mWrites.push_back(RegisterWrite{command.reg, command.value});
+
+    // Commands at the end of the song without delay belong to the first
+    // block when looping. Giving them a block with a duration of 0 has the
+    // same effect.
+    const auto isLastCommand = result.mWrites.size() == song.size();
+    if (command.delay > 0 || isLastCommand) {
+      const auto writesEnd = static_cast<std::uint32_t>(result.mWrites.size());
+      const auto samples = imfDelayToSamples(command.delay, mSampleRate);
+      result.mBlocks.push_back(PreparedSong::Block{
+        blockStart, writesEnd, static_cast<std::uint32_t>(samples)});
+
+      blockStart = writesEnd;
+      totalSamples += samples;
+    }
+  }
+
+  // A song without any duration can't be played in a loop
+  if (totalSamples == 0) {
+    return {};
   }
-  mSongSwitchPending = true;
+
+  return result;
 }
 
 
-void ImfPlayer::render(std::int16_t* pBuffer, std::size_t samplesRequired) {
-  if (mSongSwitchPending && mAudioLock.try_lock()) {
-    mSongData = std::move(mNextSongData);
-    mSongSwitchPending = false;
-    mAudioLock.unlock();
+void ImfPlayer::sendCommand(Command&& command) {
+  while (mRetiredSongs.pop()) {
+  }
 
-    miNextCommand = mSongData.cbegin();
-    mSamplesAvailable = 0;
+  // The command queue only fills up if lots of commands are issued within
+  // the time of a single audio buffer. In that case, we keep the remaining
+  // commands around and try again on the next call.
+  mOverflowingCommands.push_back(std::move(command));
+  while (
+    !mOverflowingCommands.empty() &&
+    mCommandQueue.push(std::move(mOverflowingCommands.front()))
+  ) {
+    mOverflowingCommands.pop_front();
   }
+}
 
-  if (mSongData.empty()) {
-    std::fill(pBuffer, pBuffer + samplesRequired, int16_t{0});
+
+void ImfPlayer::processCommands() {
+  while (auto command = mCommandQueue.pop()) {
+    base::match(*command,
+      [this](PlaySong& playSong) {
+        switchToSong(std::move(playSong.mSong));
+
+        const auto now = std::chrono::steady_clock::now();
+        if (mpStatistics) {
+          mpStatistics->recordSongSwitch(now - playSong.mRequestTime);
+        }
+
+        if (traceRecorder().isEnabled()) {
+          traceRecorder().addZone("Song switch", playSong.mRequestTime, now);
+        }
+      },
+
+      [this](const Stop&) {
+        switchToSong({});
+      },
+
+      [this](const SetVolume& setVolume) {
+        mVolume = setVolume.mVolume;
+        mFadeSamplesRemaining = 0;
+      },
+
+      [this](const FadeVolume& fade) {
+        if (fade.mDurationInSamples == 0) {
+          mVolume = fade.mTargetVolume;
+          mFadeSamplesRemaining = 0;
+          return;
+        }
+
+        mFadeTargetVolume = fade.mTargetVolume;
+        mFadeStep =
+          (fade.mTargetVolume - mVolume) / fade.mDurationInSamples;
+        mFadeSamplesRemaining = fade.mDurationInSamples;
+      },
+
+      [this](UseRenderedSong& useRendered) {
+        auto& pRendered = useRendered.mpRendered;
+        if (mSongData.empty() || !pRendered || pRendered->mSamples.empty()) {
+          retire(RetiredSong{{}, std::move(pRendered)});
+          return;
+        }
+
+        retire(RetiredSong{{}, std::move(mpRenderedSong)});
+        mpRenderedSong = std::move(pRendered);
+        mRenderedSongPosition =
+          mSamplesPlayed % mpRenderedSong->mSamples.size();
+      });
+  }
+}
+
+
+void ImfPlayer::switchToSong(PreparedSong&& song) {
+  retire(RetiredSong{std::move(mSongData), std::move(mpRenderedSong)});
+
+  mSongData = std::move(song);
+  mNextBlock = 0;
+  mSamplesAvailable = 0;
+  mSamplesPlayed = 0;
+  mpRenderedSong = nullptr;
+  mRenderedSongPosition = 0;
+}
+
+
+void ImfPlayer::retire(RetiredSong&& song) {
+  // If the main thread hasn't picked up previously retired songs yet, we
+  // have no choice but to free the memory here.
+  mRetiredSongs.push(std::move(song));
+}
+
+
+void ImfPlayer::applyVolume(std::int16_t* pBuffer, const std::size_t samples) {
+  if (mVolume == 1.0f && mFadeSamplesRemaining == 0) {
     return;
   }
 
+  for (std::size_t i = 0; i < samples; ++i) {
+    if (mFadeSamplesRemaining > 0) {
+      --mFadeSamplesRemaining;
+      mVolume = mFadeSamplesRemaining > 0
+        ? mVolume + mFadeStep
+        : mFadeTargetVolume;
+    }
+
+    pBuffer[i] = base::roundTo<std::int16_t>(pBuffer[i] * mVolume);
+  }
+}
+
+
+void ImfPlayer::render(std::int16_t* pBuffer, std::size_t samplesRequired) {
+  TraceZone zone("IMF audio render");
+
+  processCommands();
+
+  if (mpRenderedSong) {
+    renderFromRenderedSong(pBuffer, samplesRequired);
+  } else if (mSongData.empty()) {
+    std::fill(pBuffer, pBuffer + samplesRequired, int16_t{0});
+  } else {
+    emulate(pBuffer, samplesRequired);
+  }
+
+  mSamplesPlayed += samplesRequired;
+  applyVolume(pBuffer, samplesRequired);
+}
+
+
+void ImfPlayer::emulate(std::int16_t* pBuffer, std::size_t samplesRequired) {
+  const auto startTime = std::chrono::steady_clock::now();
+  const auto totalSamples = samplesRequired;
+
   while (samplesRequired > mSamplesAvailable) {
     mEmulator.render(mSamplesAvailable, pBuffer);
     pBuffer += mSamplesAvailable;
     samplesRequired -= mSamplesAvailable;
 
-    auto commandDelay = 0;
-    do {
-      const auto& command = *miNextCommand;
-      commandDelay = command.delay;
-      mEmulator.writeRegister(command.reg, command.value);
-      ++miNextCommand;
-      if (miNextCommand == mSongData.cend()) {
-        miNextCommand = mSongData.cbegin();
-      }
-    } while (commandDelay == 0);
-
-    mSamplesAvailable = imfDelayToSamples(commandDelay, mSampleRate);
+    const auto& block = mSongData.mBlocks[mNextBlock];
+    for (auto i = block.mFirstWrite; i < block.mWritesEnd; ++i) {
+      const auto& write = mSongData.mWrites[i];
+      mEmulator.writeRegister(write.mRegister, write.mValue);
+    }
+
+    mSamplesAvailable = block.mSamples;
+
+    ++mNextBlock;
+    if (mNextBlock == mSongData.mBlocks.size()) {
+      mNextBlock = 0;
+    }
   }
 
   mEmulator.render(samplesRequired, pBuffer);
   mSamplesAvailable -= samplesRequired;
+
+  if (mpStatistics) {
+    mpStatistics->recordEmulation(
+      std::chrono::steady_clock::now() - startTime, totalSamples);
+  }
+}
+
+
+void ImfPlayer::renderFromRenderedSong(
+  std::int16_t* pBuffer,
+  std::size_t samplesRequired
+) {
+  const auto& samples = mpRenderedSong->mSamples;
+
+  while (samplesRequired > 0) {
+    const auto count =
+      std::min(samplesRequired, samples.size() - mRenderedSongPosition);
+    std::copy_n(samples.begin() + mRenderedSongPosition, count, pBuffer);
+
+    pBuffer += count;
+    samplesRequired -= count;
+    mRenderedSongPosition += count;
+    if (mRenderedSongPosition == samples.size()) {
+      mRenderedSongPosition = 0;
+    }
+  }
 }
 
 
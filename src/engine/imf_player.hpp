@@ -16,18 +16,50 @@
 
 #pragma once
 
+#include "base/spsc_queue.hpp"
+#include "data/audio_buffer.hpp"
 #include "data/song.hpp"
+#include "engine/timing.hpp"
 #include "loader/adlib_emulator.hpp"
 
-#include <atomic>
-#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <variant>
+#include <vector>
 
 
 namespace rigel::engine {
 
+struct AudioStatistics;
+
+using RenderedSong = std::shared_ptr<const data::AudioBuffer>;
+
+
+/** Render a single pass through song, exactly like ImfPlayer would play it
+ *
+ * Since ImfPlayer loops songs, playing back the result in a loop gives the
+ * same output as live emulation.
+ */
+data::AudioBuffer renderImfSong(const data::Song& song, int sampleRate);
+
+
+/** Plays IMF music via an emulated AdLib
+ *
+ * render() is meant to be called from the audio thread, all other functions
+ * from the main thread. Requests from the main thread are passed to the audio
+ * thread via a lock-free queue and take effect at the start of the next
+ * render() call, so neither side ever has to wait for the other one.
+ */
 class ImfPlayer {
 public:
-  explicit ImfPlayer(int sampleRate);
+  /** pStatistics is optional. If given, it must outlive the player. */
+  explicit ImfPlayer(
+    int sampleRate,
+    AudioStatistics* pStatistics = nullptr,
+    loader::AdlibEmulator::Mode emulationMode =
+      loader::AdlibEmulator::Mode::Accurate);
   ImfPlayer(const ImfPlayer&) = delete;
   ImfPlayer(ImfPlayer&&) = delete;
 
@@ -35,20 +67,118 @@ public:
   ImfPlayer& operator=(ImfPlayer&&) = delete;
 
   void playSong(data::Song&& song);
+  void stop();
+
+  /** Switch the current song over to pre-rendered PCM
+   *
+   * rendered must be the result of renderImfSong() for the song given to the
+   * most recent playSong() call. Playback continues seamlessly at the current
+   * position, but without the cost of emulation from then on.
+   */
+  void useRenderedSong(RenderedSong pRendered);
+
+  /** Set music volume, in the range [0.0, 1.0] */
+  void setVolume(float volume);
+
+  /** Gradually change music volume to the given target over duration */
+  void fadeVolume(float targetVolume, TimeDelta duration);
 
   void render(std::int16_t* pBuffer, std::size_t samplesRequired);
 
 private:
+  struct RegisterWrite {
+    std::uint8_t mRegister;
+    std::uint8_t mValue;
+  };
+
+  /** Song converted into a form more suitable for playback
+   *
+   * Consecutive commands without delay are grouped into blocks. Each block
+   * consists of a run of register writes, followed by a period of sound
+   * output with the length already converted to samples at the output rate.
+   * The player can then render a whole block at a time.
+   */
+  struct PreparedSong {
+    struct Block {
+      std::uint32_t mFirstWrite;
+      std::uint32_t mWritesEnd;
+      std::uint32_t mSamples;
+    };
+
+    std::vector<RegisterWrite> mWrites;
+    std::vector<Block> mBlocks;
+
+    bool empty() const {
+      return mBlocks.empty();
+    }
+  };
+
+  struct PlaySong {
+    PreparedSong mSong;
+    std::chrono::steady_clock::time_point mRequestTime;
+  };
+
+  struct Stop {};
+
+  struct SetVolume {
+    float mVolume;
+  };
+
+  struct FadeVolume {
+    float mTargetVolume;
+    int mDurationInSamples;
+  };
+
+  struct UseRenderedSong {
+    RenderedSong mpRendered;
+  };
+
+  using Command =
+    std::variant<PlaySong, Stop, SetVolume, FadeVolume, UseRenderedSong>;
+
+  struct RetiredSong {
+    PreparedSong mSong;
+    RenderedSong mpRendered;
+  };
+
+  static constexpr auto QUEUE_CAPACITY = std::size_t{32};
+
+  PreparedSong prepareSong(const data::Song& song) const;
+  void sendCommand(Command&& command);
+  void processCommands();
+  void switchToSong(PreparedSong&& song);
+  void retire(RetiredSong&& song);
+  void emulate(std::int16_t* pBuffer, std::size_t samplesRequired);
+  void renderFromRenderedSong(
+    std::int16_t* pBuffer,
+    std::size_t samplesRequired);
+  void applyVolume(std::int16_t* pBuffer, std::size_t samples);
+
   loader::AdlibEmulator mEmulator;
-  std::mutex mAudioLock;
-  data::Song mNextSongData;
+  AudioStatistics* mpStatistics;
+
+  // Only accessed by the main thread
+  std::deque<Command> mOverflowingCommands;
+
+  base::SpscQueue<Command, QUEUE_CAPACITY> mCommandQueue;
+
+  // Songs which the audio thread has stopped playing are handed back to the
+  // main thread, so that their memory isn't freed on the audio thread.
+  base::SpscQueue<RetiredSong, QUEUE_CAPACITY> mRetiredSongs;
 
-  data::Song mSongData;
-  data::Song::const_iterator miNextCommand;
+  // Only accessed by the audio thread
+  PreparedSong mSongData;
+  std::size_t mNextBlock = 0;
   std::size_t mSamplesAvailable = 0;
+  std::uint64_t mSamplesPlayed = 0;
+  RenderedSong mpRenderedSong;
+  std::size_t mRenderedSongPosition = 0;
   int mSampleRate;
 
-  std::atomic<bool> mSongSwitchPending;
+  float mVolume = 1.0f;
+  float mFadeTargetVolume = 1.0f;
+  float mFadeStep = 0.0f;
+  int mFadeSamplesRemaining = 0;
 };
 
 }
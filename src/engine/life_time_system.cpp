@@ -14,43 +14,206 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include "life_time_system.hpp"
 
-#include "engine/physical_components.hpp"
+#include <algorithm>
 
 
 namespace rigel::engine {
 
-void LifeTimeSystem::update(entityx::EntityManager& es) {
-  using Condition = components::AutoDestroy::Condition;
-  es.each<components::AutoDestroy>([](
-    entityx::Entity entity,
-    components::AutoDestroy& autoDestroyProperties
+namespace ex = entityx;
+
+using components::Active;
+using components::AutoDestroy;
+using components::CollidedWithWorld;
+
+
+namespace {
+
+bool conditionIsSet(
+  const AutoDestroy& autoDestroyProperties,
+  const AutoDestroy::Condition condition
+) {
+  const auto conditionValue = static_cast<int>(condition);
+  return (autoDestroyProperties.mConditionFlags & conditionValue) != 0;
+}
+
+
+bool hasNonTimeoutCondition(const AutoDestroy& autoDestroyProperties) {
+  using Condition = AutoDestroy::Condition;
+  return
+    conditionIsSet(autoDestroyProperties, Condition::OnWorldCollision) ||
+    conditionIsSet(autoDestroyProperties, Condition::OnLeavingActiveRegion);
+}
+
+
+bool nonTimeoutConditionFulfilled(ex::Entity entity) {
+  using Condition = AutoDestroy::Condition;
+
+  const auto& autoDestroyProperties = *entity.component<const AutoDestroy>();
+  return
+    (conditionIsSet(autoDestroyProperties, Condition::OnWorldCollision) &&
+      entity.has_component<CollidedWithWorld>()) ||
+    (conditionIsSet(autoDestroyProperties, Condition::OnLeavingActiveRegion) &&
+      !entity.has_component<Active>());
+}
+
+}
+
+
+LifeTimeSystem::LifeTimeSystem(
+  ex::EntityManager& es,
+  ex::EventManager& events
+) {
+  events.subscribe<ex::ComponentAddedEvent<AutoDestroy>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<AutoDestroy>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<CollidedWithWorld>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<Active>>(*this);
+
+  es.each<AutoDestroy>([this](
+    ex::Entity entity,
+    const AutoDestroy& autoDestroyProperties
   ) {
-    const auto flags = autoDestroyProperties.mConditionFlags;
+    track(entity, autoDestroyProperties);
+  });
+}
+
 
-    const auto conditionIsSet = [&flags](const Condition condition) {
-      const auto conditionValue = static_cast<int>(condition);
-      return (flags & conditionValue) != 0;
-    };
+void LifeTimeSystem::update() {
+  ++mUpdateCount;
 
-    const auto hasTimeout = conditionIsSet(Condition::OnTimeoutElapsed);
-    if (hasTimeout) {
-      --autoDestroyProperties.mFramesToLive;
+  mEntitiesToDestroy.clear();
+
+  // Timeouts which are further away than the size of the wheel stay in their
+  // slot until the wheel has gone around often enough.
+  auto& slot = mTimerWheel[mUpdateCount % NUM_WHEEL_SLOTS];
+  const auto iEnd = std::remove_if(
+    slot.begin(), slot.end(), [this](const Timeout& timeout) {
+      if (!isCurrent(timeout)) {
+        return true;
+      }
+
+      if (timeout.mExpiresOnUpdate == mUpdateCount) {
+        mEntitiesToDestroy.push_back(timeout.mEntity);
+        return true;
+      }
+
+      return false;
+    });
+  slot.erase(iEnd, slot.end());
+
+  for (auto entity : mCandidates) {
+    if (
+      entity.valid() &&
+      entity.has_component<AutoDestroy>() &&
+      nonTimeoutConditionFulfilled(entity)
+    ) {
+      mEntitiesToDestroy.push_back(entity);
     }
+  }
+  mCandidates.clear();
+
+  // Destroy in order of entity index, like a full iteration over all
+  // AutoDestroy entities would. This determines the order in which indices
+  // are reused by entities created afterwards.
+  std::sort(
+    mEntitiesToDestroy.begin(),
+    mEntitiesToDestroy.end(),
+    [](const ex::Entity lhs, const ex::Entity rhs) {
+      return lhs.id().index() < rhs.id().index();
+    });
+  mEntitiesToDestroy.erase(
+    std::unique(mEntitiesToDestroy.begin(), mEntitiesToDestroy.end()),
+    mEntitiesToDestroy.end());
 
-    const auto mustDestroy =
-      (conditionIsSet(Condition::OnWorldCollision) &&
-        entity.has_component<components::CollidedWithWorld>()) ||
-      (conditionIsSet(Condition::OnLeavingActiveRegion) &&
-        !entity.has_component<components::Active>()) ||
-      (hasTimeout && autoDestroyProperties.mFramesToLive < 0);
+  for (auto entity : mEntitiesToDestroy) {
+    entity.destroy();
+  }
+}
 
-    if (mustDestroy) {
-      entity.destroy();
+
+void LifeTimeSystem::writeRemainingFramesToLive() {
+  for (const auto& slot : mTimerWheel) {
+    for (const auto& timeout : slot) {
+      if (isCurrent(timeout)) {
+        auto entity = timeout.mEntity;
+        auto& autoDestroyProperties = *entity.component<AutoDestroy>();
+        autoDestroyProperties.mFramesToLive =
+          static_cast<int>(timeout.mExpiresOnUpdate - mUpdateCount) - 1;
+      }
     }
-  });
+  }
+}
+
+
+void LifeTimeSystem::receive(
+  const ex::ComponentAddedEvent<AutoDestroy>& event
+) {
+  track(event.entity, *event.component);
+}
+
+
+void LifeTimeSystem::receive(
+  const ex::ComponentRemovedEvent<AutoDestroy>& event
+) {
+  // Invalidates any pending timeout, in case the entity gets a new
+  // AutoDestroy later on
+  ++generation(event.entity);
+}
+
+
+void LifeTimeSystem::receive(
+  const ex::ComponentAddedEvent<CollidedWithWorld>& event
+) {
+  mCandidates.push_back(event.entity);
+}
+
+
+void LifeTimeSystem::receive(
+  const ex::ComponentRemovedEvent<Active>& event
+) {
+  mCandidates.push_back(event.entity);
 }
 
+
+void LifeTimeSystem::track(
+  ex::Entity entity,
+  const AutoDestroy& autoDestroyProperties
+) {
+  if (hasNonTimeoutCondition(autoDestroyProperties)) {
+    mCandidates.push_back(entity);
+  }
+
+  if (conditionIsSet(
+    autoDestroyProperties, AutoDestroy::Condition::OnTimeoutElapsed)
+  ) {
+    // The frames to live are counted down once per update, and the entity
+    // is destroyed on the update that takes the count below zero.
+    const auto framesToLive = std::max(autoDestroyProperties.mFramesToLive, 0);
+    const auto expiresOnUpdate =
+      mUpdateCount + static_cast<std::uint64_t>(framesToLive) + 1;
+
+    mTimerWheel[expiresOnUpdate % NUM_WHEEL_SLOTS].push_back(
+      Timeout{entity, expiresOnUpdate, generation(entity)});
+  }
 }
 
+
+std::uint32_t& LifeTimeSystem::generation(ex::Entity entity) {
+  const auto index = entity.id().index();
+  if (index >= mGenerations.size()) {
+    mGenerations.resize(index + 1, 0);
+  }
+
+  return mGenerations[index];
+}
+
+
+bool LifeTimeSystem::isCurrent(const Timeout& timeout) {
+  return
+    timeout.mEntity.valid() &&
+    generation(timeout.mEntity) == timeout.mGeneration;
+}
+
+}
@@ -16,18 +16,71 @@
 
 #pragma once
 
+#include "engine/base_components.hpp"
 #include "engine/life_time_components.hpp"
+#include "engine/physical_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <array>
+#include <cstdint>
+#include <vector>
+
 
 namespace rigel::engine {
 
-class LifeTimeSystem {
+/** Destroys entities once their AutoDestroy condition is fulfilled
+ *
+ * Instead of looking at every AutoDestroy entity on each update, timeouts
+ * are kept in a timer wheel indexed by the update on which they expire, and
+ * the other conditions are only examined for entities which gained
+ * CollidedWithWorld, lost Active or were given an AutoDestroy since the last
+ * update.
+ *
+ * To keep the wheel authoritative, AutoDestroy::mFramesToLive is not counted
+ * down on each update. Call writeRemainingFramesToLive() before copying
+ * components elsewhere, e.g. when taking an entity snapshot.
+ */
+class LifeTimeSystem : public entityx::Receiver<LifeTimeSystem> {
 public:
-  void update(entityx::EntityManager& es);
+  LifeTimeSystem(entityx::EntityManager& es, entityx::EventManager& events);
+
+  void update();
+
+  void writeRemainingFramesToLive();
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::AutoDestroy>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::AutoDestroy>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::CollidedWithWorld>&
+      event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::Active>& event);
+
+private:
+  struct Timeout {
+    entityx::Entity mEntity;
+    std::uint64_t mExpiresOnUpdate;
+    std::uint32_t mGeneration;
+  };
+
+  static constexpr auto NUM_WHEEL_SLOTS = std::size_t{256};
+
+  void track(
+    entityx::Entity entity,
+    const components::AutoDestroy& autoDestroyProperties);
+  std::uint32_t& generation(entityx::Entity entity);
+  bool isCurrent(const Timeout& timeout);
+
+  std::array<std::vector<Timeout>, NUM_WHEEL_SLOTS> mTimerWheel;
+  std::vector<std::uint32_t> mGenerations;
+  std::vector<entityx::Entity> mCandidates;
+  std::vector<entityx::Entity> mEntitiesToDestroy;
+  std::uint64_t mUpdateCount = 0;
 };
 
 }
@@ -0,0 +1,201 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logic_profiler.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+
+namespace rigel::engine {
+
+namespace {
+
+double toMs(const LogicProfiler::Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+
+double toUs(const LogicProfiler::Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}
+
+
+void LogicProfiler::beginTick() {
+  mCurrentTick = (mCurrentTick + 1) % HISTORY_SIZE;
+
+  auto& tick = mTicks[mCurrentTick];
+  tick.mStart = Clock::now();
+  tick.mEvents.clear();
+
+  for (auto& section : mSections) {
+    section.mTimesMs[mCurrentTick] = 0.0;
+    section.mCollisionStatistics[mCurrentTick] = {};
+  }
+}
+
+
+void LogicProfiler::endTick(const std::size_t numEntities) {
+  auto& tick = mTicks[mCurrentTick];
+  tick.mEnd = Clock::now();
+  tick.mNumEntities = numEntities;
+
+  mNumRecordedTicks = std::min(mNumRecordedTicks + 1, HISTORY_SIZE);
+}
+
+
+void LogicProfiler::addSample(
+  const char* pName,
+  const Clock::time_point start,
+  const Clock::time_point end
+) {
+  const auto index = sectionIndex(pName);
+  mSections[index].mTimesMs[mCurrentTick] += toMs(end - start);
+  mTicks[mCurrentTick].mEvents.push_back(Event{index, start, end});
+}
+
+
+void LogicProfiler::addCollisionStatistics(
+  const char* pName,
+  const CollisionStatistics& statistics
+) {
+  const auto index = sectionIndex(pName);
+  mSections[index].mCollisionStatistics[mCurrentTick] += statistics;
+}
+
+
+std::vector<LogicProfiler::SectionStatistics>
+  LogicProfiler::statistics() const
+{
+  std::vector<SectionStatistics> result;
+  if (mNumRecordedTicks == 0) {
+    return result;
+  }
+
+  std::vector<double> sortedTimes;
+  sortedTimes.reserve(mNumRecordedTicks);
+
+  for (const auto& section : mSections) {
+    sortedTimes.clear();
+    for (auto i = std::size_t{0}; i < mNumRecordedTicks; ++i) {
+      const auto tickIndex = (mCurrentTick + HISTORY_SIZE - i) % HISTORY_SIZE;
+      sortedTimes.push_back(section.mTimesMs[tickIndex]);
+    }
+
+    std::sort(sortedTimes.begin(), sortedTimes.end());
+
+    auto percentile = [&](const std::size_t percent) {
+      return sortedTimes[(sortedTimes.size() - 1) * percent / 100];
+    };
+
+    result.push_back(SectionStatistics{
+      section.mpName,
+      sortedTimes.front(),
+      percentile(50),
+      percentile(99),
+      sortedTimes.back()});
+  }
+
+  return result;
+}
+
+
+std::vector<LogicProfiler::SectionCollisionStatistics>
+  LogicProfiler::collisionStatistics() const
+{
+  std::vector<SectionCollisionStatistics> result;
+
+  for (const auto& section : mSections) {
+    CollisionStatistics total;
+    for (auto i = std::size_t{0}; i < mNumRecordedTicks; ++i) {
+      const auto tickIndex = (mCurrentTick + HISTORY_SIZE - i) % HISTORY_SIZE;
+      total += section.mCollisionStatistics[tickIndex];
+    }
+
+    const auto numQueries = total.mNumGroundTests + total.mNumCeilingTests +
+      total.mNumLeftWallTests + total.mNumRightWallTests + total.mNumSweeps;
+    if (numQueries > 0) {
+      result.push_back(SectionCollisionStatistics{section.mpName, total});
+    }
+  }
+
+  return result;
+}
+
+
+std::size_t LogicProfiler::lastEntityCount() const {
+  return mNumRecordedTicks > 0 ? mTicks[mCurrentTick].mNumEntities : 0;
+}
+
+
+void LogicProfiler::writeChromeTrace(std::ostream& stream) const {
+  if (mNumRecordedTicks == 0) {
+    stream << "{\"traceEvents\":[]}\n";
+    return;
+  }
+
+  const auto oldestTick =
+    (mCurrentTick + HISTORY_SIZE + 1 - mNumRecordedTicks) % HISTORY_SIZE;
+  const auto origin = mTicks[oldestTick].mStart;
+
+  auto pSeparator = "";
+  auto writeEvent = [&](
+    const char* pName,
+    const Clock::time_point start,
+    const Clock::time_point end,
+    const int depth
+  ) {
+    stream
+      << pSeparator
+      << "\n{\"name\":\"" << pName << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+      << ",\"ts\":" << toUs(start - origin)
+      << ",\"dur\":" << toUs(end - start)
+      << ",\"args\":{\"depth\":" << depth << "}}";
+    pSeparator = ",";
+  };
+
+  stream << "{\"traceEvents\":[";
+
+  for (auto i = std::size_t{0}; i < mNumRecordedTicks; ++i) {
+    const auto& tick = mTicks[(oldestTick + i) % HISTORY_SIZE];
+    writeEvent("Tick", tick.mStart, tick.mEnd, 0);
+
+    for (const auto& event : tick.mEvents) {
+      writeEvent(
+        mSections[event.mSectionIndex].mpName, event.mStart, event.mEnd, 1);
+    }
+  }
+
+  stream << "\n]}\n";
+}
+
+
+std::size_t LogicProfiler::sectionIndex(const char* pName) {
+  const auto it = std::find_if(
+    mSections.begin(),
+    mSections.end(),
+    [pName](const Section& section) { return section.mpName == pName; });
+  if (it != mSections.end()) {
+    return static_cast<std::size_t>(std::distance(mSections.begin(), it));
+  }
+
+  mSections.push_back(Section{pName, {}, {}});
+  return mSections.size() - 1;
+}
+
+}
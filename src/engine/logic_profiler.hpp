@@ -0,0 +1,153 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "engine/collision_statistics.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Measures CPU time spent on named sections of game logic updates
+ *
+ * Keeps the timings of the last HISTORY_SIZE ticks for each section, and
+ * derives min/median/99th percentile/max from them. The same history can be
+ * written out in Chrome's trace event format, for viewing in
+ * chrome://tracing or similar tools.
+ *
+ * Sections can also be given the collision queries made while they ran,
+ * to see which systems ask the CollisionChecker how much.
+ *
+ * A section name can be used several times per tick, the times are summed
+ * up in that case. Names must be string literals, or otherwise outlive the
+ * profiler.
+ *
+ * Instrumentation is done via profileSection(), which compiles down to a
+ * plain function call unless RIGEL_ENABLE_LOGIC_PROFILER is defined. That's
+ * the case for debug builds, and when enabling the LOGIC_PROFILER CMake
+ * option. Without it, the profiler never receives any data.
+ */
+class LogicProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto HISTORY_SIZE = std::size_t{128};
+
+  struct SectionStatistics {
+    const char* mpName;
+    double mMinMs;
+    double mMedianMs;
+    double mP99Ms;
+    double mMaxMs;
+  };
+
+  struct SectionCollisionStatistics {
+    const char* mpName;
+
+    // Summed up over all recorded ticks
+    CollisionStatistics mTotal;
+  };
+
+  static constexpr bool isEnabledInBuild() {
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void beginTick();
+  void endTick(std::size_t numEntities);
+
+  void addSample(
+    const char* pName,
+    Clock::time_point start,
+    Clock::time_point end);
+
+  void addCollisionStatistics(
+    const char* pName,
+    const CollisionStatistics& statistics);
+
+  /** Statistics over the recorded history, in order of first appearance */
+  std::vector<SectionStatistics> statistics() const;
+
+  /** Collision queries over the recorded history, for sections with any */
+  std::vector<SectionCollisionStatistics> collisionStatistics() const;
+
+  /** Number of entities in existence at the end of the most recent tick */
+  std::size_t lastEntityCount() const;
+
+  std::size_t numRecordedTicks() const {
+    return mNumRecordedTicks;
+  }
+
+  /** Write recorded history as Chrome trace event JSON */
+  void writeChromeTrace(std::ostream& stream) const;
+
+private:
+  struct Event {
+    std::size_t mSectionIndex;
+    Clock::time_point mStart;
+    Clock::time_point mEnd;
+  };
+
+  struct TickRecord {
+    Clock::time_point mStart;
+    Clock::time_point mEnd;
+    std::vector<Event> mEvents;
+    std::size_t mNumEntities = 0;
+  };
+
+  struct Section {
+    const char* mpName;
+
+    // Time spent per tick, indexed like mTicks
+    std::array<double, HISTORY_SIZE> mTimesMs{};
+    std::array<CollisionStatistics, HISTORY_SIZE> mCollisionStatistics{};
+  };
+
+  std::size_t sectionIndex(const char* pName);
+
+  std::vector<Section> mSections;
+  std::array<TickRecord, HISTORY_SIZE> mTicks;
+  std::size_t mCurrentTick = 0;
+  std::size_t mNumRecordedTicks = 0;
+};
+
+
+/** Invoke func, measuring its duration if the profiler is enabled in build */
+template <typename Func>
+void profileSection(
+  [[maybe_unused]] LogicProfiler& profiler,
+  [[maybe_unused]] const char* pName,
+  Func&& func
+) {
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+  const auto start = LogicProfiler::Clock::now();
+  func();
+  profiler.addSample(pName, start, LogicProfiler::Clock::now());
+#else
+  func();
+#endif
+}
+
+}
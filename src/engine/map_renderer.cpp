@@ -18,8 +18,11 @@
 
 #include "base/math_tools.hpp"
 #include "data/game_traits.hpp"
+#include "data/unit_conversions.hpp"
+#include "engine/tile_debris_system.hpp"
 
-#include <cfenv>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 
@@ -38,6 +41,65 @@ const auto FAST_ANIM_FRAME_DELAY = 1;
 const auto SLOW_ANIM_FRAME_DELAY = 2;
 const auto PARALLAX_FACTOR = 4;
 
+// Auto-scrolling backdrops move by one pixel per frame at 60 FPS when
+// scrolling vertically, and by half a pixel when scrolling horizontally.
+const auto AUTO_SCROLL_SPEED_VERTICAL = 60.0;
+const auto AUTO_SCROLL_SPEED_HORIZONTAL = 30.0;
+
+#ifdef RIGEL_USE_GL_ES
+const auto CHUNK_SIZE = 32;
+#endif
+
+// Bits in the per-tile render flags table
+const auto TILE_FLAG_FOREGROUND = std::uint8_t{1 << 0};
+const auto TILE_FLAG_ANIMATED = std::uint8_t{1 << 1};
+const auto TILE_FLAG_FAST_ANIMATION = std::uint8_t{1 << 2};
+
+
+std::vector<std::uint8_t> buildTileRenderFlags(
+  const map::TileAttributeDict& attributeDict
+) {
+  const auto numTiles = map::TileIndex{GameTraits::CZone::numTilesTotal};
+
+  std::vector<std::uint8_t> flags;
+  flags.reserve(numTiles);
+
+  for (map::TileIndex index = 0; index < numTiles; ++index) {
+    const auto attributes = attributeDict.attributes(index);
+
+    auto tileFlags = std::uint8_t{0};
+    if (attributes.isForeGround()) {
+      tileFlags |= TILE_FLAG_FOREGROUND;
+    }
+    if (attributes.isAnimated()) {
+      tileFlags |= TILE_FLAG_ANIMATED;
+    }
+    if (attributes.isFastAnimation()) {
+      tileFlags |= TILE_FLAG_FAST_ANIMATION;
+    }
+
+    flags.push_back(tileFlags);
+  }
+
+  return flags;
+}
+
+
+// Returns the tiles which are at least partially covered by the given
+// area (in pixels). Tiles left of/above the map's origin are excluded.
+base::Rect<int> coveredTiles(const base::Rect<int>& areaPx) {
+  const auto left = std::max(areaPx.left(), 0) / GameTraits::tileSize;
+  const auto top = std::max(areaPx.top(), 0) / GameTraits::tileSize;
+  const auto right =
+    (areaPx.left() + areaPx.size.width + GameTraits::tileSize - 1) /
+    GameTraits::tileSize;
+  const auto bottom =
+    (areaPx.top() + areaPx.size.height + GameTraits::tileSize - 1) /
+    GameTraits::tileSize;
+
+  return {{left, top}, {right - left, bottom - top}};
+}
+
 
 base::Vector wrapBackgroundOffset(base::Vector offset) {
   return {
@@ -46,25 +108,93 @@ base::Vector wrapBackgroundOffset(base::Vector offset) {
   };
 }
 
+
+#ifndef RIGEL_USE_GL_ES
+
+std::vector<std::uint16_t> tileMapTexels(
+  const map::Map& map,
+  const std::vector<std::uint8_t>& tileRenderFlags,
+  const int layer,
+  const base::Rect<int>& section
+) {
+  std::vector<std::uint16_t> texels;
+  texels.reserve(section.size.width * section.size.height);
+
+  map.forEachTileInRect(layer, section,
+    [&](int, int, const map::TileIndex tileIndex) {
+      const auto flags = tileRenderFlags[tileIndex];
+
+      auto texel =
+        static_cast<std::uint16_t>(tileIndex & renderer::TILE_MAP_INDEX_MASK);
+      if (flags & TILE_FLAG_FOREGROUND) {
+        texel |= renderer::TILE_MAP_FOREGROUND_FLAG;
+      }
+      if (flags & TILE_FLAG_ANIMATED) {
+        texel |= renderer::TILE_MAP_ANIMATED_FLAG;
+      }
+      if (flags & TILE_FLAG_FAST_ANIMATION) {
+        texel |= renderer::TILE_MAP_FAST_ANIMATION_FLAG;
+      }
+
+      texels.push_back(texel);
+    });
+
+  return texels;
+}
+
+#endif
+
 }
 
 MapRenderer::MapRenderer(
   renderer::Renderer* pRenderer,
   const data::map::Map* pMap,
+  const data::ViewPortSize& viewPortSize,
   MapRenderData&& renderData
 )
   : mpRenderer(pRenderer)
   , mpMap(pMap)
+  , mViewPortSize(viewPortSize)
   , mTileSetTexture(
       renderer::OwningTexture(pRenderer, renderData.mTileSetImage),
       pRenderer)
   , mBackdropTexture(mpRenderer, renderData.mBackdropImage)
   , mScrollMode(renderData.mBackdropScrollMode)
+  , mTileRenderFlags(buildTileRenderFlags(pMap->attributeDict()))
+  , mRowHasForegroundTiles(pMap->height(), false)
 {
+  updateForegroundRowInfo(0, mpMap->height());
+
   if (renderData.mSecondaryBackdropImage) {
     mAlternativeBackdropTexture = renderer::OwningTexture(
       mpRenderer, *renderData.mSecondaryBackdropImage);
   }
+
+#ifndef RIGEL_USE_GL_ES
+  mpRenderer->enableTextureRepeat(mBackdropTexture.data());
+  if (mAlternativeBackdropTexture.data().mHandle != 0) {
+    mpRenderer->enableTextureRepeat(mAlternativeBackdropTexture.data());
+  }
+#endif
+
+  mKnownMapRevision = mpMap->changeRevision();
+
+#ifdef RIGEL_USE_GL_ES
+  mChunksPerRow = (mpMap->width() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  const auto numChunkRows = (mpMap->height() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  mChunks.resize(mChunksPerRow * numChunkRows);
+#else
+  for (int layer = 0; layer < 2; ++layer) {
+    const auto texels = tileMapTexels(
+      *mpMap,
+      mTileRenderFlags,
+      layer,
+      {{0, 0}, {mpMap->width(), mpMap->height()}});
+    mLayerTextures[layer] = renderer::TileMapTexture(
+      mpRenderer, mpMap->width(), mpMap->height(), texels.data());
+  }
+#endif
 }
 
 
@@ -73,13 +203,19 @@ void MapRenderer::switchBackdrops() {
 }
 
 
-void MapRenderer::renderBackground(const base::Vector& cameraPosition) {
-  renderMapTiles(cameraPosition, false);
+void MapRenderer::renderBackground(
+  const base::Vector& cameraPosition,
+  const base::Vector& cameraOffsetPx
+) {
+  renderMapTiles(cameraPosition, cameraOffsetPx, false);
 }
 
 
-void MapRenderer::renderForeground(const base::Vector& cameraPosition) {
-  renderMapTiles(cameraPosition, true);
+void MapRenderer::renderForeground(
+  const base::Vector& cameraPosition,
+  const base::Vector& cameraOffsetPx
+) {
+  renderMapTiles(cameraPosition, cameraOffsetPx, true);
 }
 
 
@@ -99,13 +235,10 @@ void MapRenderer::renderBackdrop(const base::Vector& cameraPosition) {
       parallaxBoth ?  cameraPosition.y*PARALLAX_FACTOR : 0
     });
   } else if (autoScrollX || autoScrollY) {
-    // TODO Currently this only works right when running at 60 FPS.
-    // It should be time-based instead, but it's trickier to get it smooth
-    // then.
-    const double speedFactor = autoScrollX ? 2.0 : 1.0;
-    std::fesetround(FE_TONEAREST);
-    const auto offsetPixels = base::round(mElapsedFrames60Fps / speedFactor);
-    ++mElapsedFrames60Fps;
+    const auto speed = autoScrollX
+      ? AUTO_SCROLL_SPEED_HORIZONTAL
+      : AUTO_SCROLL_SPEED_VERTICAL;
+    const auto offsetPixels = base::round(mBackdropAutoScrollTime * speed);
 
     if (autoScrollX) {
       offset.x = offsetPixels % GameTraits::viewPortWidthPx;
@@ -115,70 +248,363 @@ void MapRenderer::renderBackdrop(const base::Vector& cameraPosition) {
     }
   }
 
-  const auto offsetForDrawing = offset * -1;
-  const auto offsetForRepeating = base::Vector{
-    GameTraits::viewPortWidthPx - offset.x,
-    GameTraits::viewPortHeightPx - offset.y};
-
-  // TODO: This can be simplified by using texture wrap mode (GL_REPEAT)
-  mBackdropTexture.render(mpRenderer, offsetForDrawing);
-  if (!autoScrollY) {
-    mBackdropTexture.render(
-      mpRenderer,
-      base::Vector{offsetForRepeating.x, offsetForDrawing.y});
+  // Views wider than the original game need more than one backdrop's worth
+  // of width
+  const auto originalWidth = GameTraits::viewPortWidthPx;
+  const auto backdropAreaWidth =
+    std::max(originalWidth, mViewPortSize.inGameViewPortSize().width);
+
+#ifndef RIGEL_USE_GL_ES
+  // The backdrop textures repeat (see constructor), so a single quad with
+  // shifted texture coordinates takes care of wrapping around.
+  mBackdropTexture.render(
+    mpRenderer,
+    base::Vector{},
+    {offset, {backdropAreaWidth, GameTraits::viewPortHeightPx}});
+#else
+  // GL ES 2.0 can't repeat non-power-of-two textures, so we need to draw
+  // the backdrop multiple times to cover the wrapped around parts.
+  const auto needsVerticalRepeat = parallaxBoth || autoScrollY;
+  for (
+    auto x = -offset.x;
+    x < backdropAreaWidth;
+    x += GameTraits::viewPortWidthPx
+  ) {
+    mBackdropTexture.render(mpRenderer, base::Vector{x, -offset.y});
+
+    if (needsVerticalRepeat) {
+      mBackdropTexture.render(
+        mpRenderer,
+        base::Vector{x, GameTraits::viewPortHeightPx - offset.y});
+    }
   }
+#endif
+}
 
-  if (parallaxBoth || autoScrollY) {
-    mBackdropTexture.render(
-      mpRenderer,
-      base::Vector{offsetForDrawing.x, offsetForRepeating.y});
-  }
 
-  if (parallaxBoth) {
-    mBackdropTexture.render(mpRenderer, offsetForRepeating);
-  }
+void MapRenderer::updateBackdropAutoScroll(const engine::TimeDelta dt) {
+  // Wrap around once the backdrop has scrolled by a whole screen, so that
+  // the accumulated time doesn't lose precision in long sessions.
+  const auto period =
+    mScrollMode == BackdropScrollMode::AutoHorizontal
+      ? GameTraits::viewPortWidthPx / AUTO_SCROLL_SPEED_HORIZONTAL
+      : GameTraits::viewPortHeightPx / AUTO_SCROLL_SPEED_VERTICAL;
+  mBackdropAutoScrollTime = std::fmod(mBackdropAutoScrollTime + dt, period);
 }
 
 
 void MapRenderer::renderMapTiles(
   const base::Vector& cameraPosition,
+  const base::Vector& cameraOffsetPx,
   const bool renderForeground
 ) {
-  for (int layer=0; layer<2; ++layer) {
-    for (int y=0; y<GameTraits::mapViewPortHeightTiles; ++y) {
-      for (int x=0; x<GameTraits::mapViewPortWidthTiles; ++x) {
-        const auto col = x + cameraPosition.x;
-        const auto row = y + cameraPosition.y;
-        if (col >= mpMap->width() || row >= mpMap->height()) {
+  const auto viewPortPx = base::Rect<int>{
+    tileVectorToPixelVector(cameraPosition) + cameraOffsetPx,
+    tileExtentsToPixelExtents(mViewPortSize.mapViewPortSize())};
+
+#ifndef RIGEL_USE_GL_ES
+  updateTileMapTextures();
+
+  const auto visibleTiles = coveredTiles(viewPortPx);
+  const auto skipForeground = renderForeground &&
+    !hasForegroundTiles(visibleTiles.top(), visibleTiles.size.height);
+  if (skipForeground) {
+    return;
+  }
+
+  renderer::Renderer::TileMapParams params;
+  params.mTileSet = mTileSetTexture.textureData();
+  params.mLayers = {mLayerTextures[0].data(), mLayerTextures[1].data()};
+  params.mMapOffsetPx = viewPortPx.topLeft;
+  params.mFastAnimOffset =
+    int((mElapsedFrames / FAST_ANIM_FRAME_DELAY) % ANIM_STATES);
+  params.mSlowAnimOffset =
+    int((mElapsedFrames / SLOW_ANIM_FRAME_DELAY) % ANIM_STATES);
+  params.mDrawForeground = renderForeground;
+
+  mpRenderer->drawTileMap({{0, 0}, viewPortPx.size}, params);
+#else
+  renderCachedMapTiles(viewPortPx, renderForeground);
+#endif
+}
+
+
+bool MapRenderer::isForegroundTile(const map::TileIndex index) const {
+  return (mTileRenderFlags[index] & TILE_FLAG_FOREGROUND) != 0;
+}
+
+
+bool MapRenderer::isAnimatedTile(const map::TileIndex index) const {
+  return (mTileRenderFlags[index] & TILE_FLAG_ANIMATED) != 0;
+}
+
+
+void MapRenderer::updateForegroundRowInfo(
+  const int firstRow,
+  const int numRows
+) {
+  for (auto row = firstRow; row < firstRow + numRows; ++row) {
+    const auto tiles0 = mpMap->row(0, row);
+    const auto tiles1 = mpMap->row(1, row);
+
+    auto hasForeground = false;
+    for (int col = 0; col < mpMap->width() && !hasForeground; ++col) {
+      hasForeground =
+        isForegroundTile(tiles0[col]) || isForegroundTile(tiles1[col]);
+    }
+
+    mRowHasForegroundTiles[row] = hasForeground;
+  }
+}
+
+
+bool MapRenderer::hasForegroundTiles(
+  const int firstRow,
+  const int numRows
+) const {
+  const auto endRow = std::min(firstRow + numRows, mpMap->height());
+  for (auto row = std::max(firstRow, 0); row < endRow; ++row) {
+    if (mRowHasForegroundTiles[row]) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+template <typename Callback>
+void MapRenderer::forEachModifiedSection(Callback&& callback) {
+  if (mpMap->changeRevision() == mKnownMapRevision) {
+    return;
+  }
+
+  auto handleSection = [&](const base::Rect<int>& section) {
+    updateForegroundRowInfo(section.top(), section.size.height);
+    callback(section);
+  };
+
+  const auto isJournalComplete =
+    mpMap->forEachChangeSince(mKnownMapRevision, handleSection);
+  if (!isJournalComplete) {
+    handleSection({{0, 0}, {mpMap->width(), mpMap->height()}});
+  }
+
+  mKnownMapRevision = mpMap->changeRevision();
+}
+
+
+#ifdef RIGEL_USE_GL_ES
+
+void MapRenderer::invalidateModifiedChunks() {
+  forEachModifiedSection([this](const base::Rect<int>& section) {
+    const auto firstChunkCol = section.left() / CHUNK_SIZE;
+    const auto lastChunkCol = section.right() / CHUNK_SIZE;
+    const auto firstChunkRow = section.top() / CHUNK_SIZE;
+    const auto lastChunkRow = section.bottom() / CHUNK_SIZE;
+
+    for (auto row = firstChunkRow; row <= lastChunkRow; ++row) {
+      for (auto col = firstChunkCol; col <= lastChunkCol; ++col) {
+        mChunks[col + row * mChunksPerRow].mNeedsUpdate = true;
+      }
+    }
+  });
+}
+
+
+void MapRenderer::updateChunk(const int chunkIndex) {
+  auto& chunk = mChunks[chunkIndex];
+
+  const auto firstCol = (chunkIndex % mChunksPerRow) * CHUNK_SIZE;
+  const auto firstRow = (chunkIndex / mChunksPerRow) * CHUNK_SIZE;
+  const auto numCols = std::min(CHUNK_SIZE, mpMap->width() - firstCol);
+  const auto numRows = std::min(CHUNK_SIZE, mpMap->height() - firstRow);
+
+  auto isAnimated = [this](const int layer, const int col, const int row) {
+    return isAnimatedTile(mpMap->tileAtUnchecked(layer, col, row));
+  };
+
+  // Cells with an animated tile on any layer are left out of the cache
+  // entirely. Otherwise, an animated tile on layer 0 would end up being
+  // drawn on top of a static tile on layer 1.
+  std::vector<bool> isCellAnimated(CHUNK_SIZE * CHUNK_SIZE, false);
+  chunk.mAnimatedCells.clear();
+  for (int y = 0; y < numRows; ++y) {
+    for (int x = 0; x < numCols; ++x) {
+      const auto col = firstCol + x;
+      const auto row = firstRow + y;
+      if (isAnimated(0, col, row) || isAnimated(1, col, row)) {
+        isCellAnimated[x + y * CHUNK_SIZE] = true;
+        chunk.mAnimatedCells.emplace_back(col, row);
+      }
+    }
+  }
+
+  std::vector<TiledTexture::TileDraw> tileDraws;
+  auto renderPass = [&](
+    std::optional<renderer::RenderTargetTexture>& target,
+    const bool renderForeground
+  ) {
+    if (!target) {
+      target.emplace(
+        mpRenderer, tilesToPixels(CHUNK_SIZE), tilesToPixels(CHUNK_SIZE));
+    }
+
+    renderer::RenderTargetTexture::Binder bindTarget(*target, mpRenderer);
+    mpRenderer->clear({0, 0, 0, 0});
+
+    tileDraws.clear();
+    for (int layer = 0; layer < 2; ++layer) {
+      for (int y = 0; y < numRows; ++y) {
+        if (renderForeground && !hasForegroundTiles(firstRow + y, 1)) {
           continue;
         }
 
-        const auto tileIndex = mpMap->tileAt(layer, col, row);
-        const auto isForeground =
-          mpMap->attributeDict().attributes(tileIndex).isForeGround();
-        if (isForeground != renderForeground) {
+        const auto tiles = mpMap->row(layer, firstRow + y);
+        for (int x = 0; x < numCols; ++x) {
+          if (isCellAnimated[x + y * CHUNK_SIZE]) {
+            continue;
+          }
+
+          // Animated tiles aren't cached, so there's no need to look up
+          // animation states here. Index 0 is transparent, see
+          // renderTileAtPixelPos().
+          const auto tileIndex = tiles[firstCol + x];
+          if (
+            tileIndex != 0 &&
+            isForegroundTile(tileIndex) == renderForeground
+          ) {
+            tileDraws.push_back({int(tileIndex), {x, y}});
+          }
+        }
+      }
+    }
+
+    mTileSetTexture.renderTiles(
+      {tileDraws.data(),
+       base::ArrayView<TiledTexture::TileDraw>::size_type(tileDraws.size())});
+  };
+
+  renderPass(chunk.mBackground, false);
+  renderPass(chunk.mForeground, true);
+  chunk.mNeedsUpdate = false;
+}
+
+
+void MapRenderer::renderCachedMapTiles(
+  const base::Rect<int>& viewPortPx,
+  const bool renderForeground
+) {
+  invalidateModifiedChunks();
+
+  const auto viewPort = coveredTiles(viewPortPx);
+
+  const auto firstChunkCol = viewPort.left() / CHUNK_SIZE;
+  const auto firstChunkRow = viewPort.top() / CHUNK_SIZE;
+  const auto lastChunkCol = std::min(
+    (viewPort.left() + viewPort.size.width - 1) / CHUNK_SIZE,
+    mChunksPerRow - 1);
+  const auto lastChunkRow = std::min(
+    (viewPort.top() + viewPort.size.height - 1) / CHUNK_SIZE,
+    int(mChunks.size()) / std::max(mChunksPerRow, 1) - 1);
+
+  for (auto chunkRow = firstChunkRow; chunkRow <= lastChunkRow; ++chunkRow) {
+    for (auto chunkCol = firstChunkCol; chunkCol <= lastChunkCol; ++chunkCol) {
+      const auto chunkIndex = chunkCol + chunkRow * mChunksPerRow;
+      if (mChunks[chunkIndex].mNeedsUpdate) {
+        updateChunk(chunkIndex);
+      }
+
+      const auto& chunk = mChunks[chunkIndex];
+      const auto& texture =
+        renderForeground ? *chunk.mForeground : *chunk.mBackground;
+
+      // Only draw the part of the chunk that's inside the viewport
+      const auto chunkRect = base::Rect<int>{
+        {chunkCol * CHUNK_SIZE, chunkRow * CHUNK_SIZE},
+        {CHUNK_SIZE, CHUNK_SIZE}};
+      const auto visibleLeft = std::max(chunkRect.left(), viewPort.left());
+      const auto visibleTop = std::max(chunkRect.top(), viewPort.top());
+      const auto visibleRight = std::min(
+        chunkRect.left() + chunkRect.size.width,
+        viewPort.left() + viewPort.size.width);
+      const auto visibleBottom = std::min(
+        chunkRect.top() + chunkRect.size.height,
+        viewPort.top() + viewPort.size.height);
+
+      const auto skipTexture = renderForeground &&
+        !hasForegroundTiles(visibleTop, visibleBottom - visibleTop);
+      if (!skipTexture) {
+        const auto sourceRect = base::Rect<int>{
+          tileVectorToPixelVector(
+            {visibleLeft - chunkRect.left(), visibleTop - chunkRect.top()}),
+          tileExtentsToPixelExtents(
+            {visibleRight - visibleLeft, visibleBottom - visibleTop})};
+        texture.render(
+          mpRenderer,
+          tileVectorToPixelVector({visibleLeft, visibleTop}) -
+            viewPortPx.topLeft,
+          sourceRect);
+      }
+
+      for (const auto& cell : chunk.mAnimatedCells) {
+        if (!viewPort.containsPoint(cell)) {
           continue;
         }
 
-        renderTile(tileIndex, x, y);
+        const auto screenPositionPx =
+          tileVectorToPixelVector(cell) - viewPortPx.topLeft;
+        for (int layer = 0; layer < 2; ++layer) {
+          const auto tileIndex =
+            mpMap->tileAtUnchecked(layer, cell.x, cell.y);
+          if (isForegroundTile(tileIndex) == renderForeground) {
+            renderTileAtPixelPos(tileIndex, screenPositionPx);
+          }
+        }
       }
     }
   }
 }
 
+#else
+
+void MapRenderer::updateTileMapTextures() {
+  forEachModifiedSection([this](const base::Rect<int>& section) {
+    for (int layer = 0; layer < 2; ++layer) {
+      const auto texels =
+        tileMapTexels(*mpMap, mTileRenderFlags, layer, section);
+      mpRenderer->updateTileMapTexture(
+        mLayerTextures[layer].data(), section, texels.data());
+    }
+  });
+}
+
+#endif
+
 
 void MapRenderer::updateAnimatedMapTiles() {
   ++mElapsedFrames;
 }
 
 
-void MapRenderer::renderSingleTile(
-  const data::map::TileIndex index,
-  const base::Vector& position,
+void MapRenderer::renderTileDebris(
+  const TileDebrisSystem& debris,
   const base::Vector& cameraPosition
 ) {
-  const auto screenPosition = position - cameraPosition;
-  renderTile(index, screenPosition.x, screenPosition.y);
+  const auto viewPortRect =
+    base::Rect<int>{{}, mViewPortSize.inGameViewPortSize()};
+
+  debris.forEach(
+    [&](const map::TileIndex index, const base::Vector& position) {
+      const auto positionPx =
+        tileVectorToPixelVector(position - cameraPosition);
+      const auto tileRect = base::Rect<int>{
+        positionPx, {GameTraits::tileSize, GameTraits::tileSize}};
+
+      if (tileRect.intersects(viewPortRect)) {
+        renderTileAtPixelPos(index, positionPx);
+      }
+    });
 }
 
 
@@ -186,12 +612,22 @@ void MapRenderer::renderTile(
   const data::map::TileIndex tileIndex,
   const int x,
   const int y
+) {
+  renderTileAtPixelPos(tileIndex, tileVectorToPixelVector({x, y}));
+}
+
+
+void MapRenderer::renderTileAtPixelPos(
+  const data::map::TileIndex tileIndex,
+  const base::Vector& positionPx
 ) {
   // Tile index 0 is used to represent a transparent tile, i.e. the backdrop
   // should be visible. Therefore, don't draw if the index is 0.
   if (tileIndex != 0) {
     const auto tileIndexToDraw = animatedTileIndex(tileIndex);
-    mTileSetTexture.renderTile(tileIndexToDraw, x, y);
+    mTileSetTexture.renderTileStretched(
+      tileIndexToDraw,
+      {positionPx, {GameTraits::tileSize, GameTraits::tileSize}});
   }
 }
 
@@ -199,14 +635,14 @@ void MapRenderer::renderTile(
 map::TileIndex MapRenderer::animatedTileIndex(
   const map::TileIndex tileIndex
 ) const {
-  if (mpMap->attributeDict().attributes(tileIndex).isAnimated()) {
+  const auto flags = mTileRenderFlags[tileIndex];
+  if (flags & TILE_FLAG_ANIMATED) {
     const auto fastAnimOffset =
       (mElapsedFrames / FAST_ANIM_FRAME_DELAY) % ANIM_STATES;
     const auto slowAnimOffset =
       (mElapsedFrames / SLOW_ANIM_FRAME_DELAY) % ANIM_STATES;
 
-    const auto isFastAnim =
-      mpMap->attributeDict().attributes(tileIndex).isFastAnimation();
+    const auto isFastAnim = (flags & TILE_FLAG_FAST_ANIMATION) != 0;
     return tileIndex + (isFastAnim ? fastAnimOffset : slowAnimOffset);
   } else {
     return tileIndex;
@@ -17,14 +17,24 @@
 #pragma once
 
 #include "base/spatial_types.hpp"
+#include "data/game_traits.hpp"
 #include "engine/tiled_texture.hpp"
+#include "engine/timing.hpp"
 #include "loader/level_loader.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/texture.hpp"
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 
 namespace rigel::engine {
 
+class TileDebrisSystem;
+
+
 class MapRenderer {
 public:
   struct MapRenderData {
@@ -45,31 +55,88 @@ public:
   MapRenderer(
     renderer::Renderer* renderer,
     const data::map::Map* pMap,
+    const data::ViewPortSize& viewPortSize,
     MapRenderData&& renderData);
 
   void switchBackdrops();
 
   void renderBackdrop(const base::Vector& cameraPosition);
-  void renderBackground(const base::Vector& cameraPosition);
-  void renderForeground(const base::Vector& cameraPosition);
+
+  /** Advance auto-scrolling backdrops by the given amount of time
+   *
+   * Should be called once per frame, independently of the game logic
+   * update rate.
+   */
+  void updateBackdropAutoScroll(engine::TimeDelta dt);
+
+  /** Render background/foreground map tiles
+   *
+   * The camera position is given in tiles. cameraOffsetPx is added on top,
+   * to allow scrolling by fractions of a tile (see RenderingSystem).
+   */
+  void renderBackground(
+    const base::Vector& cameraPosition,
+    const base::Vector& cameraOffsetPx = {});
+  void renderForeground(
+    const base::Vector& cameraPosition,
+    const base::Vector& cameraOffsetPx = {});
 
   void updateAnimatedMapTiles();
 
-  void renderSingleTile(
-    data::map::TileIndex index,
-    const base::Vector& position,
+  /** Render all pieces of tile debris in view
+   *
+   * Pieces outside of the in-game view port are skipped. All others are
+   * drawn from the tile set texture, so they end up in a single batch.
+   */
+  void renderTileDebris(
+    const TileDebrisSystem& debris,
     const base::Vector& cameraPosition);
 
 private:
   void renderMapTiles(
     const base::Vector& cameraPosition,
+    const base::Vector& cameraOffsetPx,
     bool renderForeground);
   void renderTile(data::map::TileIndex index, int x, int y);
+  void renderTileAtPixelPos(
+    data::map::TileIndex index,
+    const base::Vector& positionPx);
   data::map::TileIndex animatedTileIndex(data::map::TileIndex) const;
 
+  bool isForegroundTile(data::map::TileIndex index) const;
+  bool isAnimatedTile(data::map::TileIndex index) const;
+
+  void updateForegroundRowInfo(int firstRow, int numRows);
+  bool hasForegroundTiles(int firstRow, int numRows) const;
+
+  template <typename Callback>
+  void forEachModifiedSection(Callback&& callback);
+
+#ifdef RIGEL_USE_GL_ES
+  struct CachedChunk {
+    // Created when the chunk is first rendered. Many chunks are never on
+    // screen, so this saves most of the video memory.
+    std::optional<renderer::RenderTargetTexture> mBackground;
+    std::optional<renderer::RenderTargetTexture> mForeground;
+
+    // Map positions of cells with animated tiles, which can't be cached
+    std::vector<base::Vector> mAnimatedCells;
+    bool mNeedsUpdate = true;
+  };
+
+  void invalidateModifiedChunks();
+  void updateChunk(int chunkIndex);
+  void renderCachedMapTiles(
+    const base::Rect<int>& viewPortPx,
+    bool renderForeground);
+#else
+  void updateTileMapTextures();
+#endif
+
 private:
   renderer::Renderer* mpRenderer;
   const data::map::Map* mpMap;
+  data::ViewPortSize mViewPortSize;
 
   TiledTexture mTileSetTexture;
   renderer::OwningTexture mBackdropTexture;
@@ -78,7 +145,29 @@ private:
   data::map::BackdropScrollMode mScrollMode;
 
   std::uint32_t mElapsedFrames = 0;
-  std::uint32_t mElapsedFrames60Fps = 0;
+  engine::TimeDelta mBackdropAutoScrollTime = 0.0;
+
+  // Foreground/animation flags for each tile in the tile set, to avoid
+  // decoding tile attributes over and over while rendering
+  std::vector<std::uint8_t> mTileRenderFlags;
+
+  // For each map row, whether any of its tiles (on either layer) is a
+  // foreground tile. Rows without any can be skipped in the foreground pass.
+  std::vector<bool> mRowHasForegroundTiles;
+
+  // Map revision at the time the cached/uploaded map data was last updated,
+  // see data::map::Map::forEachChangeSince()
+  std::uint32_t mKnownMapRevision = 0;
+
+#ifdef RIGEL_USE_GL_ES
+  // The non-animated parts of the map, pre-rendered in chunks of
+  // CHUNK_SIZE x CHUNK_SIZE tiles
+  std::vector<CachedChunk> mChunks;
+  int mChunksPerRow = 0;
+#else
+  // Copy of the map's tile layers on the GPU, see Renderer::drawTileMap()
+  std::array<renderer::TileMapTexture, 2> mLayerTextures;
+#endif
 };
 
 }
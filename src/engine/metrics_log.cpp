@@ -0,0 +1,270 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "metrics_log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+namespace rigel::engine {
+
+namespace {
+
+constexpr auto INTERVAL_S = 1.0;
+
+// Records waiting for the worker thread. At one record per second, the
+// worker would need to be stalled for over a minute to hit this.
+constexpr auto MAX_QUEUED_RECORDS = 64;
+
+const auto CSV_HEADER =
+  "unix_time_s,frames,frame_ms_avg,frame_ms_max,render_ms_avg,render_ms_max,"
+  "draw_calls_avg,quads_avg,bytes_uploaded,audio_callback_ms_avg,"
+  "audio_underruns,allocations,memory_bytes\n";
+
+
+double perFrame(const double total, const int numFrames) {
+  return numFrames > 0 ? total / numFrames : 0.0;
+}
+
+}
+
+
+/** Worker thread which writes records to the log file */
+class MetricsLog::Writer {
+public:
+  Writer(std::string path, const std::size_t maxFileSize)
+    : mPath(std::move(path))
+    , mMaxFileSize(maxFileSize)
+    , mThread([this]() { run(); })
+  {
+  }
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mShutDownRequested = true;
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+  }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  void submit(const Record& record) {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+      if (mRecords.size() >= MAX_QUEUED_RECORDS) {
+        ++mNumDroppedRecords;
+        return;
+      }
+
+      mRecords.push_back(record);
+    }
+
+    mCondition.notify_one();
+  }
+
+private:
+  void run() {
+    openFile();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;) {
+      mCondition.wait(
+        lock, [this]() { return !mRecords.empty() || mShutDownRequested; });
+
+      if (mRecords.empty()) {
+        return;
+      }
+
+      const auto record = mRecords.front();
+      mRecords.pop_front();
+      const auto numDroppedRecords = std::exchange(mNumDroppedRecords, 0);
+
+      lock.unlock();
+      write(record, numDroppedRecords);
+      lock.lock();
+    }
+  }
+
+  void openFile() {
+    mFile.open(mPath, std::ios::app);
+    if (!mFile.is_open()) {
+      std::cerr
+        << "WARNING: Failed to open metrics log file " << mPath << '\n';
+      return;
+    }
+
+    mFile.seekp(0, std::ios::end);
+    mFileSize = std::size_t(mFile.tellp());
+    if (mFileSize == 0) {
+      mFile << CSV_HEADER;
+      mFileSize = std::size_t(mFile.tellp());
+    }
+  }
+
+  void rotateFile() {
+    mFile.close();
+
+    const auto previousPath = mPath + ".1";
+    std::remove(previousPath.c_str());
+    std::rename(mPath.c_str(), previousPath.c_str());
+
+    openFile();
+  }
+
+  void write(const Record& record, const int numDroppedRecords) {
+    if (!mFile.is_open()) {
+      return;
+    }
+
+    if (numDroppedRecords > 0) {
+      mFile << "# " << numDroppedRecords << " records dropped\n";
+    }
+
+    mFile
+      << std::fixed << std::setprecision(3) << record.mTimestampS << ','
+      << std::defaultfloat
+      << record.mNumFrames << ','
+      << record.mAvgFrameTimeMs << ','
+      << record.mMaxFrameTimeMs << ','
+      << record.mAvgRenderTimeMs << ','
+      << record.mMaxRenderTimeMs << ','
+      << record.mAvgDrawCalls << ','
+      << record.mAvgQuads << ','
+      << record.mBytesUploaded << ','
+      << record.mAvgAudioCallbackTimeMs << ','
+      << record.mNumAudioUnderruns << ','
+      << record.mNumAllocations << ','
+      << record.mMemoryBytes << '\n';
+
+    // Flushing each record keeps the data in case of a crash, and at one
+    // record per second, that's cheap enough
+    mFile.flush();
+    mFileSize = std::size_t(mFile.tellp());
+
+    if (mFileSize >= mMaxFileSize) {
+      rotateFile();
+    }
+  }
+
+  // Only accessed by the worker thread
+  std::ofstream mFile;
+  std::size_t mFileSize = 0;
+
+  const std::string mPath;
+  const std::size_t mMaxFileSize;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<Record> mRecords;
+  int mNumDroppedRecords = 0;
+  bool mShutDownRequested = false;
+
+  // Must come last, the thread accesses the other members
+  std::thread mThread;
+};
+
+
+MetricsLog::MetricsLog(std::string path, const std::size_t maxFileSize)
+  : mpWriter(std::make_unique<Writer>(std::move(path), maxFileSize))
+{
+}
+
+
+MetricsLog::~MetricsLog() = default;
+
+
+void MetricsLog::addFrame(const FrameMetrics& metrics) {
+  if (!mHasPreviousTotals) {
+    mPreviousTotals = metrics;
+    mHasPreviousTotals = true;
+  }
+
+  const auto frameTimeS = metrics.mFrameTimeMs / 1000.0;
+  mIntervalElapsedS += frameTimeS;
+
+  ++mNumFrames;
+  mTotalFrameTimeMs += metrics.mFrameTimeMs;
+  mMaxFrameTimeMs = std::max(mMaxFrameTimeMs, metrics.mFrameTimeMs);
+  mTotalRenderTimeMs += metrics.mRenderTimeMs;
+  mMaxRenderTimeMs = std::max(mMaxRenderTimeMs, metrics.mRenderTimeMs);
+  mTotalDrawCalls += metrics.mDrawCalls;
+  mTotalQuads += metrics.mQuads;
+  mTotalBytesUploaded += metrics.mBytesUploaded;
+
+  if (mIntervalElapsedS >= INTERVAL_S) {
+    finishInterval(metrics);
+  }
+}
+
+
+void MetricsLog::finishInterval(const FrameMetrics& latest) {
+  const auto numCallbacks =
+    latest.mNumAudioCallbacks - mPreviousTotals.mNumAudioCallbacks;
+  const auto callbackTimeNs =
+    latest.mTotalAudioCallbackTimeNs -
+    mPreviousTotals.mTotalAudioCallbackTimeNs;
+
+  Record record;
+  record.mTimestampS = std::chrono::duration<double>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  record.mNumFrames = mNumFrames;
+  record.mAvgFrameTimeMs = perFrame(mTotalFrameTimeMs, mNumFrames);
+  record.mMaxFrameTimeMs = mMaxFrameTimeMs;
+  record.mAvgRenderTimeMs = perFrame(mTotalRenderTimeMs, mNumFrames);
+  record.mMaxRenderTimeMs = mMaxRenderTimeMs;
+  record.mAvgDrawCalls = perFrame(double(mTotalDrawCalls), mNumFrames);
+  record.mAvgQuads = perFrame(double(mTotalQuads), mNumFrames);
+  record.mBytesUploaded = mTotalBytesUploaded;
+  record.mAvgAudioCallbackTimeMs = numCallbacks > 0
+    ? double(callbackTimeNs) / double(numCallbacks) / 1'000'000.0
+    : 0.0;
+  record.mNumAudioUnderruns =
+    latest.mNumAudioUnderruns - mPreviousTotals.mNumAudioUnderruns;
+  record.mNumAllocations =
+    latest.mNumAllocations - mPreviousTotals.mNumAllocations;
+  record.mMemoryBytes = latest.mMemoryBytes;
+
+  mpWriter->submit(record);
+
+  mPreviousTotals = latest;
+  mIntervalElapsedS = 0.0;
+  mNumFrames = 0;
+  mTotalFrameTimeMs = 0.0;
+  mMaxFrameTimeMs = 0.0;
+  mTotalRenderTimeMs = 0.0;
+  mMaxRenderTimeMs = 0.0;
+  mTotalDrawCalls = 0;
+  mTotalQuads = 0;
+  mTotalBytesUploaded = 0;
+}
+
+}
@@ -0,0 +1,119 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+
+namespace rigel::engine {
+
+/** Measurements taken once per frame, see MetricsLog::addFrame() */
+struct FrameMetrics {
+  double mFrameTimeMs = 0.0;
+
+  /** CPU time spent on updating and rendering, without waiting for vsync */
+  double mRenderTimeMs = 0.0;
+
+  int mDrawCalls = 0;
+  int mQuads = 0;
+  std::size_t mBytesUploaded = 0;
+
+  // Running totals, the log records their change per interval
+  std::uint64_t mNumAudioCallbacks = 0;
+  std::uint64_t mTotalAudioCallbackTimeNs = 0;
+  std::uint64_t mNumAudioUnderruns = 0;
+  std::uint64_t mNumAllocations = 0;
+
+  std::int64_t mMemoryBytes = 0;
+};
+
+
+/** Appends per-second performance aggregates to a CSV file
+ *
+ * Meant for unattended machines, where performance data needs to be
+ * collected for later analysis. Frames are aggregated on the calling
+ * thread, which only involves a few additions. Once a second, the
+ * aggregate is handed to a worker thread which formats and writes it.
+ * If the worker falls behind, records are dropped instead of blocking the
+ * caller.
+ *
+ * Each record is stamped with the wall clock time, so that records remain
+ * meaningful when the log spans several runs.
+ *
+ * Once the file exceeds the given size, it's renamed by appending ".1" to
+ * its name, replacing any previous file of that name, and a new file is
+ * started. Up to twice the given size is therefore kept on disk.
+ */
+class MetricsLog {
+public:
+  static constexpr auto DEFAULT_MAX_FILE_SIZE =
+    std::size_t{16 * 1024 * 1024};
+
+  explicit MetricsLog(
+    std::string path,
+    std::size_t maxFileSize = DEFAULT_MAX_FILE_SIZE);
+  ~MetricsLog();
+
+  MetricsLog(const MetricsLog&) = delete;
+  MetricsLog& operator=(const MetricsLog&) = delete;
+
+  void addFrame(const FrameMetrics& metrics);
+
+private:
+  struct Record {
+    double mTimestampS = 0.0;
+    int mNumFrames = 0;
+    double mAvgFrameTimeMs = 0.0;
+    double mMaxFrameTimeMs = 0.0;
+    double mAvgRenderTimeMs = 0.0;
+    double mMaxRenderTimeMs = 0.0;
+    double mAvgDrawCalls = 0.0;
+    double mAvgQuads = 0.0;
+    std::size_t mBytesUploaded = 0;
+    double mAvgAudioCallbackTimeMs = 0.0;
+    std::uint64_t mNumAudioUnderruns = 0;
+    std::uint64_t mNumAllocations = 0;
+    std::int64_t mMemoryBytes = 0;
+  };
+
+  class Writer;
+
+  void finishInterval(const FrameMetrics& latest);
+
+  std::unique_ptr<Writer> mpWriter;
+
+  // Current interval
+  double mIntervalElapsedS = 0.0;
+  int mNumFrames = 0;
+  double mTotalFrameTimeMs = 0.0;
+  double mMaxFrameTimeMs = 0.0;
+  double mTotalRenderTimeMs = 0.0;
+  double mMaxRenderTimeMs = 0.0;
+  std::int64_t mTotalDrawCalls = 0;
+  std::int64_t mTotalQuads = 0;
+  std::size_t mTotalBytesUploaded = 0;
+
+  // Running totals as of the end of the previous interval
+  FrameMetrics mPreviousTotals;
+  bool mHasPreviousTotals = false;
+};
+
+}
@@ -16,14 +16,9 @@
 
 #include "movement.hpp"
 
-#include "base/warnings.hpp"
 #include "data/map.hpp"
 #include "engine/collision_checker.hpp"
 
-RIGEL_DISABLE_WARNINGS
-#include <boost/container/static_vector.hpp>
-RIGEL_RESTORE_WARNINGS
-
 #include <algorithm>
 
 
@@ -34,41 +29,27 @@ using namespace engine::components;
 
 namespace {
 
-enum class ConveyorBeltFlag {
-  None,
-  Left,
-  Right
-};
-
-
 constexpr auto WALK_OFF_LEDGE_LEEWAY = 2;
 
-constexpr auto MAX_WIDTH_FOR_CONVEYOR_CHECK = 16u;
-
-
+/** Move by amount, or as far as possible without colliding
+ *
+ * findFreeDistance is given the desired distance, and must return how far
+ * the entity can actually move (see CollisionChecker::freeDistanceLeft()).
+ */
 template<typename CallableT>
 MovementResult move(
   int* pPosition,
   const int amount,
-  CallableT isColliding
+  CallableT findFreeDistance
 ) {
   if (amount == 0) {
     return MovementResult::Completed;
   }
 
   const auto desiredDistance = std::abs(amount);
-  const auto movement = amount < 0 ? -1 : 1;
-
-  const auto previousPosition = *pPosition;
-  for (int i = 0; i < desiredDistance; ++i) {
-    if (isColliding()) {
-      break;
-    }
+  const auto actualDistance = findFreeDistance(desiredDistance);
+  *pPosition += amount < 0 ? -actualDistance : actualDistance;
 
-    *pPosition += movement;
-  }
-
-  const auto actualDistance = std::abs(*pPosition - previousPosition);
   if (actualDistance == 0) {
     return MovementResult::Failed;
   }
@@ -153,10 +134,11 @@ MovementResult moveHorizontally(
   auto& bbox = *entity.component<BoundingBox>();
 
   return move(&position.x, amount,
-    [&]() {
+    [&](const int distance) {
+      const auto worldSpaceBbox = toWorldSpace(bbox, position);
       return amount < 0
-        ? collisionChecker.isTouchingLeftWall(position, bbox)
-        : collisionChecker.isTouchingRightWall(position, bbox);
+        ? collisionChecker.freeDistanceLeft(worldSpaceBbox, distance)
+        : collisionChecker.freeDistanceRight(worldSpaceBbox, distance);
     });
 }
 
@@ -170,10 +152,11 @@ MovementResult moveVertically(
   auto& bbox = *entity.component<BoundingBox>();
 
   return move(&position.y, amount,
-    [&]() {
+    [&](const int distance) {
+      const auto worldSpaceBbox = toWorldSpace(bbox, position);
       return amount < 0
-        ? collisionChecker.isTouchingCeiling(position, bbox)
-        : collisionChecker.isOnSolidGround(position, bbox);
+        ? collisionChecker.freeDistanceUp(worldSpaceBbox, distance)
+        : collisionChecker.freeDistanceDown(worldSpaceBbox, distance);
     });
 }
 
@@ -183,43 +166,22 @@ void applyConveyorBeltMotion(
   const data::map::Map& map,
   entityx::Entity entity
 ) {
-  namespace bc = boost::container;
-
-  using std::any_of;
-  using std::begin;
-  using std::end;
-
-  auto getFlag = [&map](const int x, const int y) {
-    const auto attributes = map.attributes(x, y);
-    if (attributes.isConveyorBeltLeft()) {
-      return ConveyorBeltFlag::Left;
-    } else if (attributes.isConveyorBeltRight()) {
-      return ConveyorBeltFlag::Right;
-    } else {
-      return ConveyorBeltFlag::None;
-    }
-  };
-
-  bc::static_vector<ConveyorBeltFlag, MAX_WIDTH_FOR_CONVEYOR_CHECK> flags;
+  using data::map::TileFeature;
 
-  {
-    const auto& position = *entity.component<WorldPosition>();
-    const auto& bbox = *entity.component<BoundingBox>();
-    const auto worldBbox = toWorldSpace(bbox, position);
-    for (auto x = 0; x < worldBbox.size.width; ++x) {
-      flags.push_back(getFlag(worldBbox.left() + x, worldBbox.bottom() + 1));
-    }
-  }
+  const auto& position = *entity.component<WorldPosition>();
+  const auto& bbox = *entity.component<BoundingBox>();
+  const auto worldBbox = toWorldSpace(bbox, position);
 
-  auto anyFlagIs = [&flags](const ConveyorBeltFlag desiredFlag) {
-    return any_of(begin(flags), end(flags), [&](const ConveyorBeltFlag flag) {
-      return flag == desiredFlag;
-    });
+  auto isAnyTileBelow = [&](const TileFeature feature) {
+    return map
+      .findFeatureInRow(
+        worldBbox.bottom() + 1, worldBbox.left(), worldBbox.right(), feature)
+      .has_value();
   };
 
-  if (anyFlagIs(ConveyorBeltFlag::Left)) {
+  if (isAnyTileBelow(TileFeature::ConveyorBeltLeft)) {
     moveHorizontally(collisionChecker, entity, -1);
-  } else if (anyFlagIs(ConveyorBeltFlag::Right)) {
+  } else if (isAnyTileBelow(TileFeature::ConveyorBeltRight)) {
     moveHorizontally(collisionChecker, entity, 1);
   }
 }
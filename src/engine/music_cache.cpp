@@ -0,0 +1,125 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "music_cache.hpp"
+
+#include "base/key_hasher.hpp"
+#include "engine/pcm_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+
+namespace rigel::engine {
+
+namespace {
+
+std::uint64_t hashSong(const data::Song& song) {
+  base::KeyHasher hasher;
+  for (const auto& command : song) {
+    hasher.add(command.reg);
+    hasher.add(command.value);
+    hasher.add(command.delay);
+  }
+
+  return hasher.value();
+}
+
+
+RenderedSong fetchRenderedSong(
+  const std::string& directory,
+  const data::Song& song,
+  const int sampleRate
+) {
+  const auto path =
+    pcm_cache::entryPath(directory, hashSong(song), sampleRate);
+
+  if (auto cached = pcm_cache::load(path, sampleRate)) {
+    return std::make_shared<data::AudioBuffer>(std::move(*cached));
+  }
+
+  auto pRendered =
+    std::make_shared<data::AudioBuffer>(renderImfSong(song, sampleRate));
+  pcm_cache::save(path, *pRendered);
+
+  return pRendered;
+}
+
+
+bool isReady(const std::future<RenderedSong>& future) {
+  return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}
+
+
+MusicCache::MusicCache(std::string directory, const int sampleRate)
+  : mDirectory(std::move(directory))
+  , mSampleRate(sampleRate)
+{
+}
+
+
+MusicCache::~MusicCache() = default;
+
+
+void MusicCache::request(const data::Song& song) {
+  abandonPendingJob();
+
+  if (song.empty()) {
+    return;
+  }
+
+  mPendingJob = std::async(
+    std::launch::async,
+    [directory = mDirectory, song, sampleRate = mSampleRate]() {
+      return fetchRenderedSong(directory, song, sampleRate);
+    });
+}
+
+
+void MusicCache::cancel() {
+  abandonPendingJob();
+}
+
+
+RenderedSong MusicCache::takeResult() {
+  mAbandonedJobs.erase(
+    std::remove_if(mAbandonedJobs.begin(), mAbandonedJobs.end(), isReady),
+    mAbandonedJobs.end());
+
+  if (!mPendingJob.valid() || !isReady(mPendingJob)) {
+    return nullptr;
+  }
+
+  try {
+    return mPendingJob.get();
+  } catch (const std::exception& ex) {
+    std::cerr << "WARNING: Failed to pre-render music: " << ex.what() << '\n';
+    return nullptr;
+  }
+}
+
+
+void MusicCache::abandonPendingJob() {
+  if (mPendingJob.valid()) {
+    mAbandonedJobs.push_back(std::move(mPendingJob));
+  }
+}
+
+}
@@ -0,0 +1,77 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "data/song.hpp"
+#include "engine/imf_player.hpp"
+
+#include <future>
+#include <string>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Disk cache for pre-rendered IMF music
+ *
+ * Emulating the AdLib in real time is one of the more expensive things the
+ * audio thread does. With the cache, each song is rendered to PCM once, by
+ * a background thread, and stored on disk. Files are keyed by a hash of the
+ * song data and the sample rate.
+ *
+ * Requests are always served asynchronously, the caller is expected to keep
+ * using live emulation until the result is ready.
+ */
+class MusicCache {
+public:
+  MusicCache(std::string directory, int sampleRate);
+  ~MusicCache();
+
+  MusicCache(const MusicCache&) = delete;
+  MusicCache& operator=(const MusicCache&) = delete;
+
+  /** Start fetching the pre-rendered version of song
+   *
+   * Loads from disk if the song has been rendered before, otherwise renders
+   * and stores it. Replaces any previous request.
+   */
+  void request(const data::Song& song);
+
+  /** Forget about the current request, if any */
+  void cancel();
+
+  /** Result of the most recent request, once it's ready
+   *
+   * Returns nullptr while the request is still in progress, if it failed,
+   * or if the result has already been taken.
+   */
+  RenderedSong takeResult();
+
+private:
+  void abandonPendingJob();
+
+  std::string mDirectory;
+  int mSampleRate;
+  std::future<RenderedSong> mPendingJob;
+
+  // Jobs we're no longer interested in still run to completion, which fills
+  // the cache for next time. Futures returned by std::async block on
+  // destruction, so we keep them around until they're done.
+  std::vector<std::future<RenderedSong>> mAbandonedJobs;
+};
+
+}
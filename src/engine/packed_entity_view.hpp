@@ -0,0 +1,220 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "engine/entity_tools.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Packed list of all entities having a certain set of components
+ *
+ * EntityManager::each() has to look at every single entity and test its
+ * component mask, and then look up each component individually. For systems
+ * which iterate over the same combination of components on every update,
+ * this view keeps a dense array of matching entities together with pointers
+ * to their components, so that iteration becomes a linear sweep.
+ *
+ * The components themselves stay in entityx's pools, which never move
+ * existing components when growing. Membership is kept up to date by
+ * listening to the ComponentAdded/RemovedEvents of all the component types.
+ * Entries are kept sorted by entity index, so that iteration order is the
+ * same as with EntityManager::each().
+ *
+ * Entities which already exist when the view is created are picked up on the
+ * first call to each().
+ */
+template <typename... Components>
+class PackedEntityView :
+  public entityx::Receiver<PackedEntityView<Components...>> {
+public:
+  explicit PackedEntityView(entityx::EventManager& events) {
+    (events.subscribe<entityx::ComponentAddedEvent<Components>>(*this), ...);
+    (events.subscribe<entityx::ComponentRemovedEvent<Components>>(*this),
+     ...);
+    events.subscribe<events::ClearingAllEntities>(*this);
+  }
+
+  /** Invoke func(entity, components...) for all matching entities
+   *
+   * Entities which gain the required components while iterating are visited
+   * as well, after all others. Entities which lose them are skipped.
+   */
+  template <typename Func>
+  void each(entityx::EntityManager& es, Func func) {
+    if (!mIsInitialized) {
+      initialize(es);
+    }
+
+    mIsIterating = true;
+
+    // New entries are appended during iteration, so we can't use iterators
+    for (std::size_t i = 0; i < mEntries.size(); ++i) {
+      auto entry = mEntries[i];
+      if (!entry.mEntity.valid()) {
+        continue;
+      }
+
+      std::apply(
+        [&](Components*... pComponents) {
+          func(entry.mEntity, *pComponents...);
+        },
+        entry.mComponents);
+    }
+
+    mIsIterating = false;
+
+    if (mNeedsCleanup) {
+      compact();
+    }
+  }
+
+  std::size_t size() const {
+    return mEntries.size();
+  }
+
+  template <typename C>
+  void receive(const entityx::ComponentAddedEvent<C>& event) {
+    if (!mIsInitialized) {
+      return;
+    }
+
+    entityx::Entity entity = event.entity;
+    const auto hasAllComponents =
+      (entity.has_component<Components>() && ...);
+    if (hasAllComponents && !findEntry(entity)) {
+      insert(entity);
+    }
+  }
+
+  template <typename C>
+  void receive(const entityx::ComponentRemovedEvent<C>& event) {
+    if (!mIsInitialized) {
+      return;
+    }
+
+    if (auto pEntry = findEntry(event.entity)) {
+      if (mIsIterating) {
+        pEntry->mEntity = entityx::Entity{};
+        mNeedsCleanup = true;
+      } else {
+        mEntries.erase(mEntries.begin() + (pEntry - mEntries.data()));
+      }
+    }
+  }
+
+  void receive(const events::ClearingAllEntities&) {
+    assert(!mIsIterating);
+
+    // Entities created afterwards are picked up by initialize() again,
+    // instead of being inserted one by one.
+    mEntries.clear();
+    mNeedsCleanup = false;
+    mIsInitialized = false;
+  }
+
+private:
+  struct Entry {
+    entityx::Entity mEntity;
+    std::tuple<Components*...> mComponents;
+  };
+
+  static bool isOrderedBefore(const Entry& lhs, const Entry& rhs) {
+    return lhs.mEntity.id().index() < rhs.mEntity.id().index();
+  }
+
+  static Entry makeEntry(entityx::Entity entity) {
+    return Entry{entity, {entity.component<Components>().get()...}};
+  }
+
+  void initialize(entityx::EntityManager& es) {
+    es.each<Components...>([this](entityx::Entity entity, Components&...) {
+      mEntries.push_back(makeEntry(entity));
+    });
+
+    mIsInitialized = true;
+  }
+
+  void insert(entityx::Entity entity) {
+    const auto entry = makeEntry(entity);
+
+    if (mIsIterating) {
+      // Inserting in the middle would mess up the ongoing iteration. The
+      // entry is moved into its sorted position once iteration has finished.
+      mEntries.push_back(entry);
+      mNeedsCleanup = true;
+      return;
+    }
+
+    mEntries.insert(
+      std::upper_bound(
+        mEntries.begin(), mEntries.end(), entry, &isOrderedBefore),
+      entry);
+  }
+
+  Entry* findEntry(entityx::Entity entity) {
+    // While iterating, entries after the sorted range might have been
+    // appended, and entities might have been invalidated. Fall back to
+    // a linear search in that case.
+    if (mNeedsCleanup) {
+      const auto iEntry = std::find_if(
+        mEntries.begin(), mEntries.end(), [&](const Entry& entry) {
+          return entry.mEntity == entity;
+        });
+      return iEntry != mEntries.end() ? &*iEntry : nullptr;
+    }
+
+    const auto probe = Entry{entity, {}};
+    const auto iEntry = std::lower_bound(
+      mEntries.begin(), mEntries.end(), probe, &isOrderedBefore);
+    if (iEntry != mEntries.end() && iEntry->mEntity == entity) {
+      return &*iEntry;
+    }
+
+    return nullptr;
+  }
+
+  void compact() {
+    mEntries.erase(
+      std::remove_if(
+        mEntries.begin(),
+        mEntries.end(),
+        [](const Entry& entry) { return !entry.mEntity.valid(); }),
+      mEntries.end());
+    std::stable_sort(mEntries.begin(), mEntries.end(), &isOrderedBefore);
+
+    mNeedsCleanup = false;
+  }
+
+  std::vector<Entry> mEntries;
+  bool mIsInitialized = false;
+  bool mIsIterating = false;
+  bool mNeedsCleanup = false;
+};
+
+}
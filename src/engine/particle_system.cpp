@@ -22,8 +22,10 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <functional>
-#include <memory>
+#include <optional>
 
 
 namespace rigel::engine {
@@ -49,90 +51,100 @@ static_assert(INITIAL_INDEX_LIMIT + PARTICLE_SYSTEM_LIFE_TIME <
   VERTICAL_MOVEMENT_TABLE.size());
 
 
-auto yOffsetAtTime(
-  const std::int16_t initialOffsetIndex,
-  const int framesElapsed
-) {
-  assert(initialOffsetIndex + framesElapsed <
-    static_cast<int>(VERTICAL_MOVEMENT_TABLE.size()));
-
-  const auto baseOffset =
-    VERTICAL_MOVEMENT_TABLE[initialOffsetIndex + framesElapsed];
-
-  return baseOffset - VERTICAL_MOVEMENT_TABLE[initialOffsetIndex];
-}
-
-
-struct Particle {
-  base::Vector offsetAtTime(const int framesElapsed) const {
-    return {
-      mVelocityX * framesElapsed,
-      yOffsetAtTime(mInitialOffsetIndexY, framesElapsed)
-    };
-  }
-
-  std::int16_t mVelocityX;
-  std::int16_t mInitialOffsetIndexY;
-};
+constexpr auto PARTICLES_PER_GROUP = std::size_t{64};
 
-
-using ParticlesList = std::array<Particle, 64>;
-
-
-std::unique_ptr<ParticlesList> createParticles(
-  RandomNumberGenerator& randomGenerator,
-  const int velocityScaleX
-) {
-  auto pParticles = std::make_unique<ParticlesList>();
-  for (auto& particle : *pParticles) {
-    const auto randomVariation = randomGenerator.gen() % 20;
-    particle.mVelocityX = static_cast<std::int16_t>(velocityScaleX == 0
-      ? 10 - randomVariation
-      : velocityScaleX * (randomVariation + 1));
-    particle.mInitialOffsetIndexY =
-      randomGenerator.gen() % (INITIAL_INDEX_LIMIT + 1);
-  }
-  return pParticles;
-}
+// Enough for a few big explosions at once. The vector can still grow
+// beyond this, it's only to avoid reallocations in the common case.
+constexpr auto INITIAL_GROUP_CAPACITY = std::size_t{32};
 
 }
 
 
+/** A group of particles spawned at the same time
+ *
+ * Particles are stored as separate columns of velocities and initial
+ * offsets, so that positions for a whole group can be computed in a
+ * simple loop over contiguous arrays, which the compiler can vectorize.
+ * Everything is stored inline, so that spawning a group doesn't allocate
+ * once mParticleGroups has grown to the typical number of groups in flight.
+ *
+ * On desktop GL, the same data is also uploaded to the GPU when spawning,
+ * and positions are then computed by the renderer's particle shader. The
+ * CPU path is used on GL ES, and when the renderer runs out of space for
+ * particle groups.
+ */
 struct ParticleGroup {
+  using PositionList = std::array<base::Vector, PARTICLES_PER_GROUP>;
+
   ParticleGroup(
     const base::Vector& origin,
     const base::Color& color,
-    std::unique_ptr<ParticlesList> pParticles
+    RandomNumberGenerator& randomGenerator,
+    const int velocityScaleX
   )
-    : mpParticles(std::move(pParticles))
-    , mOrigin(origin)
+    : mOrigin(origin)
     , mColor(color)
   {
+    for (auto i = std::size_t{0}; i < PARTICLES_PER_GROUP; ++i) {
+      const auto randomVariation = randomGenerator.gen() % 20;
+      mVelocitiesX[i] = static_cast<std::int16_t>(velocityScaleX == 0
+        ? 10 - randomVariation
+        : velocityScaleX * (randomVariation + 1));
+      mInitialOffsetIndicesY[i] =
+        randomGenerator.gen() % (INITIAL_INDEX_LIMIT + 1);
+    }
   }
 
   void update() {
     ++mFramesElapsed;
   }
 
-  void render(Renderer& renderer, const base::Vector& cameraPosition) {
+  void computePositions(
+    const base::Vector& screenSpaceOrigin,
+    PositionList& positions
+  ) const {
+    assert(INITIAL_INDEX_LIMIT + mFramesElapsed <
+      static_cast<int>(VERTICAL_MOVEMENT_TABLE.size()));
+
+    for (auto i = std::size_t{0}; i < PARTICLES_PER_GROUP; ++i) {
+      const auto initialIndex = mInitialOffsetIndicesY[i];
+      positions[i].x = screenSpaceOrigin.x + mVelocitiesX[i] * mFramesElapsed;
+      positions[i].y = screenSpaceOrigin.y +
+        VERTICAL_MOVEMENT_TABLE[initialIndex + mFramesElapsed] -
+        VERTICAL_MOVEMENT_TABLE[initialIndex];
+    }
+  }
+
+  void render(
+    Renderer& renderer,
+    const base::Vector& cameraPosition,
+    PositionList& positions
+  ) const {
     const auto screenSpaceOrigin =
       data::tileVectorToPixelVector(mOrigin - cameraPosition);
-    for (auto& particle : *mpParticles) {
-      const auto particlePosition =
-        screenSpaceOrigin + particle.offsetAtTime(mFramesElapsed);
-      renderer.drawPoint(particlePosition, mColor);
+
+#ifndef RIGEL_USE_GL_ES
+    if (mGpuId) {
+      renderer.drawParticleGroup(
+        *mGpuId, screenSpaceOrigin, mFramesElapsed, mColor);
+      return;
     }
-  }
+#endif
 
+    computePositions(screenSpaceOrigin, positions);
+    renderer.drawPoints(positions, mColor);
+  }
 
   bool isExpired() const {
     return mFramesElapsed >= PARTICLE_SYSTEM_LIFE_TIME;
   }
 
-  std::unique_ptr<ParticlesList> mpParticles;
+  std::array<std::int16_t, PARTICLES_PER_GROUP> mVelocitiesX;
+  std::array<std::int16_t, PARTICLES_PER_GROUP> mInitialOffsetIndicesY;
   base::Vector mOrigin;
   base::Color mColor;
   int mFramesElapsed = 0;
+  std::optional<int> mGpuId;
 };
 
 
@@ -143,10 +155,23 @@ ParticleSystem::ParticleSystem(
   : mpRandomGenerator(pRandomGenerator)
   , mpRenderer(pRenderer)
 {
+  mParticleGroups.reserve(INITIAL_GROUP_CAPACITY);
+
+#ifndef RIGEL_USE_GL_ES
+  mpRenderer->setParticleMovementTable(VERTICAL_MOVEMENT_TABLE);
+#endif
 }
 
 
-ParticleSystem::~ParticleSystem() = default;
+ParticleSystem::~ParticleSystem() {
+#ifndef RIGEL_USE_GL_ES
+  for (const auto& group : mParticleGroups) {
+    if (group.mGpuId) {
+      mpRenderer->destroyParticleGroup(*group.mGpuId);
+    }
+  }
+#endif
+}
 
 
 void ParticleSystem::spawnParticles(
@@ -154,15 +179,30 @@ void ParticleSystem::spawnParticles(
   const base::Color& color,
   int velocityScaleX
 ) {
-  auto pParticles = createParticles(*mpRandomGenerator, velocityScaleX);
-  mParticleGroups.emplace_back(
-    origin + SPAWN_OFFSET, color, std::move(pParticles));
+  [[maybe_unused]] auto& group = mParticleGroups.emplace_back(
+    origin + SPAWN_OFFSET, color, *mpRandomGenerator, velocityScaleX);
+
+#ifndef RIGEL_USE_GL_ES
+  group.mGpuId = mpRenderer->createParticleGroup(
+    group.mVelocitiesX, group.mInitialOffsetIndicesY);
+#endif
 }
 
 
 void ParticleSystem::update() {
   using namespace std;
 
+#ifndef RIGEL_USE_GL_ES
+  // This needs to happen before removing, since remove_if() leaves the
+  // elements at the end in an unspecified state
+  for (auto& group : mParticleGroups) {
+    if (group.isExpired() && group.mGpuId) {
+      mpRenderer->destroyParticleGroup(*group.mGpuId);
+      group.mGpuId = std::nullopt;
+    }
+  }
+#endif
+
   const auto it = remove_if(
     begin(mParticleGroups),
     end(mParticleGroups),
@@ -176,8 +216,9 @@ void ParticleSystem::update() {
 
 
 void ParticleSystem::render(const base::Vector& cameraPosition) {
-  for (auto& group : mParticleGroups) {
-    group.render(*mpRenderer, cameraPosition);
+  ParticleGroup::PositionList positions;
+  for (const auto& group : mParticleGroups) {
+    group.render(*mpRenderer, cameraPosition, positions);
   }
 }
 
@@ -0,0 +1,133 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pcm_cache.hpp"
+
+#include "loader/file_utils.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+
+namespace rigel::engine::pcm_cache {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const auto CACHE_FILE_MAGIC = std::uint32_t{0x314D4352}; // "RCM1"
+
+}
+
+
+std::string entryPath(
+  const std::string& directory,
+  const std::uint64_t sourceHash,
+  const int sampleRate
+) {
+  std::stringstream fileName;
+  fileName
+    << std::hex << std::setw(16) << std::setfill('0') << sourceHash
+    << std::dec << '_' << sampleRate << ".pcm";
+  return (fs::u8path(directory) / fileName.str()).u8string();
+}
+
+
+std::optional<data::AudioBuffer> load(
+  const std::string& path,
+  const int sampleRate
+) {
+  std::error_code error;
+  if (!fs::exists(fs::u8path(path), error)) {
+    return std::nullopt;
+  }
+
+  try {
+    const auto buffer = loader::loadFile(path);
+    loader::LeStreamReader reader(buffer);
+
+    if (
+      reader.readU32() != CACHE_FILE_MAGIC ||
+      static_cast<int>(reader.readU32()) != sampleRate
+    ) {
+      return std::nullopt;
+    }
+
+    const auto numSamples = reader.readU32();
+    data::AudioBuffer result{sampleRate, {}};
+    result.mSamples.reserve(numSamples);
+    for (auto i = std::uint32_t{0}; i < numSamples; ++i) {
+      result.mSamples.push_back(reader.readS16());
+    }
+
+    return result;
+  } catch (const std::exception&) {
+    // Treat broken cache files like missing ones
+    return std::nullopt;
+  }
+}
+
+
+void save(const std::string& path, const data::AudioBuffer& audio) {
+  std::vector<std::uint8_t> buffer;
+  buffer.reserve(12 + audio.mSamples.size() * 2);
+
+  auto writeU32 = [&](const std::uint32_t value) {
+    for (auto shift = 0; shift < 32; shift += 8) {
+      buffer.push_back(static_cast<std::uint8_t>((value >> shift) & 0xFF));
+    }
+  };
+
+  writeU32(CACHE_FILE_MAGIC);
+  writeU32(static_cast<std::uint32_t>(audio.mSampleRate));
+  writeU32(static_cast<std::uint32_t>(audio.mSamples.size()));
+  for (const auto sample : audio.mSamples) {
+    const auto value = static_cast<std::uint16_t>(sample);
+    buffer.push_back(static_cast<std::uint8_t>(value & 0xFF));
+    buffer.push_back(static_cast<std::uint8_t>(value >> 8));
+  }
+
+  const auto filePath = fs::u8path(path);
+  std::error_code error;
+  fs::create_directories(filePath.parent_path(), error);
+
+  // Write to a temporary file first, so that an interrupted write doesn't
+  // leave a truncated cache entry behind.
+  auto tempPath = filePath;
+  tempPath += ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "WARNING: Failed to write audio cache file\n";
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  }
+
+  fs::rename(tempPath, filePath, error);
+  if (error) {
+    std::cerr << "WARNING: Failed to write audio cache file\n";
+    fs::remove(tempPath, error);
+  }
+}
+
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "data/audio_buffer.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+
+namespace rigel::engine::pcm_cache {
+
+/** Path of the cache file for the given key and sample rate */
+std::string entryPath(
+  const std::string& directory,
+  std::uint64_t sourceHash,
+  int sampleRate);
+
+/** Load a cache file, if it exists and is valid */
+std::optional<data::AudioBuffer> load(const std::string& path, int sampleRate);
+
+/** Store audio in a cache file, creating the directory if needed
+ *
+ * Failures are reported on the console, but are otherwise not an error.
+ */
+void save(const std::string& path, const data::AudioBuffer& audio);
+
+}
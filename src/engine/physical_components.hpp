@@ -62,6 +62,12 @@ struct MovingBody {
    * still be emitted.
    */
   bool mIgnoreCollisions;
+
+  /** When cleared, the body moves without consulting the collision checker
+   * at all, so it passes through walls and no collision events are emitted.
+   * Only supported for bodies which aren't affected by gravity.
+   */
+  bool mDetectCollisions = true;
   bool mIsActive = true;
 };
 
@@ -76,6 +82,10 @@ struct CollidedWithWorld {};
  *
  * Other MovingBody entities will collide against the bounding box of any
  * SolidBody entity as if it were part of the world.
+ *
+ * Solid bodies that don't have a MovingBody are assumed to stay where they
+ * are. When changing the position or bounding box of such an entity, emit a
+ * events::SolidBodyChanged afterwards.
  * */
 struct SolidBody {};
 
@@ -112,10 +122,27 @@ struct CollidedWithWorld {
   bool mCollidedBottom;
 };
 
+
+/** Tells the collision checker to look at a solid body's position again */
+struct SolidBodyChanged {
+  entityx::Entity mEntity;
+};
+
 }
 
 
-components::BoundingBox toWorldSpace(
-  const components::BoundingBox& bbox, const base::Vector& entityPosition);
+/** Translate an entity's bounding box into world space
+ *
+ * This is called very frequently by the collision, damage and activation
+ * code, so it's kept inline.
+ */
+inline components::BoundingBox toWorldSpace(
+  const components::BoundingBox& bbox,
+  const base::Vector& entityPosition
+) {
+  return bbox + base::Vector(
+    entityPosition.x,
+    entityPosition.y - (bbox.size.height - 1));
+}
 
 }
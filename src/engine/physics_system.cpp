@@ -63,24 +63,13 @@ base::Point<float> updateMovementSequence(
 }
 
 
-// TODO: This is implemented here, but declared in physical_components.hpp.
-// It would be cleaner to have a matching .cpp file for that file.
-BoundingBox toWorldSpace(
-  const BoundingBox& bbox,
-  const base::Vector& entityPosition
-) {
-  return bbox + base::Vector(
-    entityPosition.x,
-    entityPosition.y - (bbox.size.height - 1));
-}
-
-
 PhysicsSystem::PhysicsSystem(
   const engine::CollisionChecker* pCollisionChecker,
   const data::map::Map* pMap,
   entityx::EventManager* pEvents
 )
-  : mpCollisionChecker(pCollisionChecker)
+  : mPhysicsObjects(*pEvents)
+  , mpCollisionChecker(pCollisionChecker)
   , mpMap(pMap)
   , mpEvents(pEvents)
 {
@@ -90,7 +79,8 @@ PhysicsSystem::PhysicsSystem(
 
 
 void PhysicsSystem::update(ex::EntityManager& es) {
-  es.each<MovingBody, WorldPosition, BoundingBox, components::Active>(
+  mPhysicsObjects.each(
+    es,
     [this](
       ex::Entity entity,
       MovingBody& body,
@@ -100,6 +90,8 @@ void PhysicsSystem::update(ex::EntityManager& es) {
     ) {
       applyPhysics(entity, body, position, collisionRect);
     });
+
+  emitCollisionEvents();
 }
 
 
@@ -111,6 +103,12 @@ void PhysicsSystem::updatePhase1(ex::EntityManager& es) {
 
 void PhysicsSystem::updatePhase2(ex::EntityManager& es) {
   for (auto entity : mPhysicsObjectsForPhase2) {
+    // Entries of entities that lost their MovingBody are left in place
+    // as invalid entities, in order to preserve processing order
+    if (!entity.valid()) {
+      continue;
+    }
+
     assert(entity.has_component<MovingBody>());
     const auto hasRequiredComponents =
       entity.has_component<WorldPosition>() &&
@@ -128,6 +126,18 @@ void PhysicsSystem::updatePhase2(ex::EntityManager& es) {
 
   mPhysicsObjectsForPhase2.clear();
   mShouldCollectForPhase2 = false;
+
+  emitCollisionEvents();
+}
+
+
+void PhysicsSystem::emitCollisionEvents() {
+  mCollisionEvents.dispatch([this](const events::CollidedWithWorld& event) {
+    // A handler for an earlier event might have destroyed the entity
+    if (event.mEntity.valid()) {
+      mpEvents->emit(event);
+    }
+  });
 }
 
 
@@ -153,6 +163,15 @@ void PhysicsSystem::applyPhysics(
   const auto originalPosition = position;
 
   const auto movementX = static_cast<std::int16_t>(body.mVelocity.x);
+
+  if (!body.mDetectCollisions) {
+    assert(!body.mGravityAffected);
+
+    const auto movementY = static_cast<std::int16_t>(body.mVelocity.y);
+    position += WorldPosition{movementX, movementY};
+    return;
+  }
+
   moveHorizontally(*mpCollisionChecker, entity, movementX);
 
   // Cache new world space BBox after applying horizontal movement
@@ -183,7 +202,7 @@ void PhysicsSystem::applyPhysics(
     const auto top = targetPosition.y != position.y && movementY < 0;
     const auto bottom = targetPosition.y != position.y && movementY > 0;
 
-    mpEvents->emit(events::CollidedWithWorld{
+    mCollisionEvents.push(events::CollidedWithWorld{
       entity, left, right, top, bottom});
   }
 
@@ -201,28 +220,19 @@ void PhysicsSystem::receive(
     return;
   }
 
-  mPhysicsObjectsForPhase2.push_back(event.entity);
+  mPhysicsObjectsForPhase2.insert(event.entity);
 }
 
 
 void PhysicsSystem::receive(
   const entityx::ComponentRemovedEvent<components::MovingBody>& event
 ) {
-  using namespace std;
-
   if (!mShouldCollectForPhase2) {
     return;
   }
 
-  const auto it = find_if(
-    begin(mPhysicsObjectsForPhase2),
-    end(mPhysicsObjectsForPhase2),
-    [&event](const auto& entity) {
-      return entity == event.entity;
-    });
-
-  if (it != end(mPhysicsObjectsForPhase2)) {
-    mPhysicsObjectsForPhase2.erase(it);
+  if (const auto index = mPhysicsObjectsForPhase2.indexOf(event.entity)) {
+    mPhysicsObjectsForPhase2.removeAtKeepingOrder(*index);
   }
 }
 
@@ -19,6 +19,9 @@
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/entity_slot_list.hpp"
+#include "engine/event_queue.hpp"
+#include "engine/packed_entity_view.hpp"
 #include "engine/physical_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
@@ -44,7 +47,9 @@ class CollisionChecker;
  * entities will also fall down until they hit solid ground.
  *
  * Entities that collided with the world on the last update() will be tagged
- * with the CollidedWithWorld component.
+ * with the CollidedWithWorld component. A CollidedWithWorld event is also
+ * emitted for each of them, but only once all entities have been processed,
+ * before update() (or updatePhase2()) returns.
  *
  * The collision detection is very simple and relies on knowing each entity's
  * previous position. Therefore, entities which are to collide against the
@@ -99,9 +104,16 @@ private:
   float applyGravity(
     const components::BoundingBox& bbox,
     float currentVelocity);
+  void emitCollisionEvents();
 
 private:
-  std::vector<entityx::Entity> mPhysicsObjectsForPhase2;
+  PackedEntityView<
+    components::MovingBody,
+    components::WorldPosition,
+    components::BoundingBox,
+    components::Active> mPhysicsObjects;
+  EntitySlotList mPhysicsObjectsForPhase2;
+  EventQueue<events::CollidedWithWorld> mCollisionEvents;
   const CollisionChecker* mpCollisionChecker;
   const data::map::Map* mpMap;
   entityx::EventManager* mpEvents;
@@ -16,6 +16,8 @@
 
 #include "random_number_generator.hpp"
 
+#include <stdexcept>
+
 
 namespace rigel::engine {
 
@@ -46,10 +48,37 @@ const std::array<int, 256> RANDOM_NUMBER_TABLE{
 };
 
 
+RandomNumberGenerator RandomNumberGenerator::stream(
+  const std::uint32_t seed,
+  const std::uint32_t id
+) {
+  // The table size is a power of two, so any odd step size visits every
+  // entry once before repeating. That gives one distinct walk per stream.
+  static_assert(RANDOM_NUMBER_TABLE.size() == 2 * NUM_STREAMS);
+  if (id >= NUM_STREAMS) {
+    throw std::invalid_argument("Invalid random number stream ID");
+  }
+
+  // Hash seed and ID into a starting point. This doesn't depend on the step
+  // size, so streams only share a starting point by chance.
+  auto hash = seed ^ (id * 0x9E3779B9u);
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35u;
+  hash ^= hash >> 16;
+
+  RandomNumberGenerator result;
+  result.mStep = 2 * id + 1;
+  result.setState(hash);
+  return result;
+}
+
+
 int RandomNumberGenerator::gen() {
-  ++mNextNumberIndex;
+  mNextNumberIndex += mStep;
   if (mNextNumberIndex >= RANDOM_NUMBER_TABLE.size()) {
-    mNextNumberIndex = 0;
+    mNextNumberIndex -= RANDOM_NUMBER_TABLE.size();
   }
 
   return RANDOM_NUMBER_TABLE[mNextNumberIndex];
@@ -27,10 +27,49 @@ extern const std::array<int, 256> RANDOM_NUMBER_TABLE;
 
 class RandomNumberGenerator {
 public:
+  /** Number of distinct streams, see stream() */
+  static constexpr std::uint32_t NUM_STREAMS = 128;
+
+  /** Generator producing the same sequence as the original game */
+  RandomNumberGenerator() = default;
+
+  /** Create a generator with its own, independent sequence
+   *
+   * Like the original generator, a stream reads numbers from the random
+   * number table, but it walks the table with a different step size and
+   * starting point. The step size is determined by the stream ID, which
+   * must be less than NUM_STREAMS, so that each stream has its own.
+   * Other IDs throw std::invalid_argument. The starting point is derived
+   * from both the seed and the ID. The numbers produced by a stream only
+   * depend on how often that same stream has been used before. Systems
+   * which each use their own stream can thus be updated in any order, or
+   * in parallel, and still behave deterministically.
+   *
+   * Existing systems keep using the shared default generator, since
+   * switching them over would change the game's behavior compared to the
+   * original and invalidate recorded replays.
+   */
+  static RandomNumberGenerator stream(std::uint32_t seed, std::uint32_t id);
+
   int gen();
 
+  /** Position in the random number table
+   *
+   * Together with the step size, which is fixed at construction, this is
+   * the generator's entire state. Restoring it via setState() makes the
+   * generator produce the same sequence of numbers again.
+   */
+  std::size_t state() const {
+    return mNextNumberIndex;
+  }
+
+  void setState(const std::size_t state) {
+    mNextNumberIndex = state % RANDOM_NUMBER_TABLE.size();
+  }
+
 private:
   std::size_t mNextNumberIndex = 0;
+  std::size_t mStep = 1;
 };
 
 }
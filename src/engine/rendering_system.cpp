@@ -16,15 +16,18 @@
 
 #include "rendering_system.hpp"
 
+#include "base/math_tools.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/physics_system.hpp"
 #include "engine/sprite_tools.hpp"
 #include "game_logic/actor_tag.hpp"
-#include "game_logic/dynamic_geometry_components.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 #include <functional>
+#include <iterator>
 
 
 namespace ex = entityx;
@@ -39,10 +42,15 @@ using components::DrawTopMost;
 using components::Orientation;
 using components::Sprite;
 using components::WorldPosition;
+using game_logic::components::ActorTag;
 
 
 namespace {
 
+// Positions which changed by more than this many tiles between two game logic
+// updates are assumed to be teleports, respawns etc., which we don't want to
+// interpolate.
+constexpr auto MAX_INTERPOLATION_DISTANCE = 4;
 
 void advanceAnimation(Sprite& sprite, AnimationLoop& animated) {
   const auto numFrames = static_cast<int>(sprite.mpDrawData->mFrames.size());
@@ -63,6 +71,73 @@ void advanceAnimation(Sprite& sprite, AnimationLoop& animated) {
   sprite.mFramesToRender[animated.mRenderSlot] = newFrameNr;
 }
 
+
+// Returns the distance (in pixels) from the current position to the
+// interpolated one
+base::Vector interpolationOffsetPx(
+  const base::Vector& previousPosition,
+  const base::Vector& currentPosition,
+  const float interpolationFactor
+) {
+  const auto delta = previousPosition - currentPosition;
+  const auto isTooFar =
+    std::abs(delta.x) > MAX_INTERPOLATION_DISTANCE ||
+    std::abs(delta.y) > MAX_INTERPOLATION_DISTANCE;
+  if (isTooFar || interpolationFactor >= 1.0f) {
+    return {};
+  }
+
+  const auto deltaPx = data::tileVectorToPixelVector(delta);
+  const auto remainder = 1.0f - interpolationFactor;
+  return {
+    base::round(deltaPx.x * remainder),
+    base::round(deltaPx.y * remainder)};
+}
+
+
+base::Vector spriteFrameTopLeftPx(
+  const SpriteFrame& frame,
+  const base::Vector& position
+) {
+  // World-space tile positions refer to a sprite's bottom left tile,
+  // but we need its top left corner for drawing.
+  const auto heightTiles = data::pixelsToTiles(frame.mImage.height());
+  const auto topLeft = position - base::Vector(0, heightTiles - 1);
+  const auto topLeftPx = data::tileVectorToPixelVector(topLeft);
+  const auto drawOffsetPx = data::tileVectorToPixelVector(
+    frame.mDrawOffset);
+
+  return topLeftPx + drawOffsetPx;
+}
+
+
+bool isSpriteOnScreen(
+  const Sprite& sprite,
+  const ex::Entity entity,
+  const base::Vector& screenPosition,
+  const base::Vector& drawOffsetPx,
+  const base::Rect<int>& viewPortRect
+) {
+  for (const auto baseFrameIndex : sprite.mFramesToRender) {
+    if (baseFrameIndex == IGNORE_RENDER_SLOT) {
+      continue;
+    }
+
+    const auto frameIndex =
+      virtualToRealFrame(baseFrameIndex, *sprite.mpDrawData, entity);
+    const auto& frame = sprite.mpDrawData->mFrames[frameIndex];
+    const auto frameRect = base::Rect<int>{
+      spriteFrameTopLeftPx(frame, screenPosition) + drawOffsetPx,
+      frame.mImage.extents()};
+
+    if (frameRect.intersects(viewPortRect)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 }
 
 
@@ -90,8 +165,16 @@ int virtualToRealFrame(
 }
 
 
-void updateAnimatedSprites(ex::EntityManager& es) {
-  es.each<Sprite, AnimationLoop>([](
+SpriteAnimationSystem::SpriteAnimationSystem(ex::EventManager& events)
+  : mAnimationLoops(events)
+  , mAnimationSequences(events)
+  , mSprites(events)
+{
+}
+
+
+void SpriteAnimationSystem::update(ex::EntityManager& es) {
+  mAnimationLoops.each(es, [](
     ex::Entity entity,
     Sprite& sprite,
     AnimationLoop& animated
@@ -110,7 +193,7 @@ void updateAnimatedSprites(ex::EntityManager& es) {
     }
   });
 
-  es.each<Sprite, AnimationSequence>([](
+  mAnimationSequences.each(es, [](
     ex::Entity entity,
     Sprite& sprite,
     AnimationSequence& sequence
@@ -136,8 +219,8 @@ void updateAnimatedSprites(ex::EntityManager& es) {
     }
   });
 
-  es.each<Sprite>([](ex::Entity entity, Sprite& sprite) {
-     sprite.mFlashingWhite = false;
+  mSprites.each(es, [](ex::Entity, Sprite& sprite) {
+    sprite.mFlashingWhite = false;
   });
 }
 
@@ -147,44 +230,31 @@ void drawSpriteFrame(
   const base::Vector& position,
   renderer::Renderer* pRenderer
 ) {
-  // World-space tile positions refer to a sprite's bottom left tile,
-  // but we need its top left corner for drawing.
-  const auto heightTiles = data::pixelsToTiles(frame.mImage.height());
-  const auto topLeft = position - base::Vector(0, heightTiles - 1);
-  const auto topLeftPx = data::tileVectorToPixelVector(topLeft);
-  const auto drawOffsetPx = data::tileVectorToPixelVector(
-    frame.mDrawOffset);
-
-  frame.mImage.render(pRenderer, topLeftPx + drawOffsetPx);
+  frame.mImage.render(pRenderer, spriteFrameTopLeftPx(frame, position));
 }
 
 
 struct RenderingSystem::SpriteData {
   SpriteData(
-    const ex::Entity entity,
+    const SpriteDrawList::Entry& entry,
     const Sprite* pSprite,
-    const bool drawTopMost,
-    const WorldPosition& position
+    const WorldPosition& position,
+    const base::Vector& drawOffsetPx
   )
-    : mEntity(entity)
+    : mEntity(entry.mEntity)
     , mPosition(position)
+    , mDrawOffsetPx(drawOffsetPx)
     , mpSprite(pSprite)
-    , mDrawOrder(
-        entity.has_component<components::OverrideDrawOrder>()
-        ? entity.component<const components::OverrideDrawOrder>()->mDrawOrder
-        : pSprite->mpDrawData->mDrawOrder)
-    , mDrawTopMost(drawTopMost)
+    , mDrawOrder(entry.mDrawOrder)
+    , mDrawTopMost(entry.mDrawTopMost)
   {
   }
 
-  bool operator<(const SpriteData& rhs) const {
-    return
-      std::tie(mDrawTopMost, mDrawOrder) <
-      std::tie(rhs.mDrawTopMost, rhs.mDrawOrder);
-  }
-
   entityx::Entity mEntity;
   WorldPosition mPosition;
+
+  // Added to the sprite's screen position, for motion interpolation
+  base::Vector mDrawOffsetPx;
   const Sprite* mpSprite;
   int mDrawOrder;
   bool mDrawTopMost;
@@ -195,47 +265,217 @@ RenderingSystem::RenderingSystem(
   const base::Vector* pCameraPosition,
   renderer::Renderer* pRenderer,
   const data::map::Map* pMap,
-  MapRenderer::MapRenderData&& mapRenderData
+  const TileDebrisSystem* pTileDebris,
+  const data::ViewPortSize& viewPortSize,
+  MapRenderer::MapRenderData&& mapRenderData,
+  entityx::EntityManager& entities,
+  entityx::EventManager& events
 )
   : mpRenderer(pRenderer)
+  , mViewPortRect{{0, 0}, viewPortSize.inGameViewPortSize()}
   , mRenderTarget(
       pRenderer,
-      data::GameTraits::inGameViewPortSize.width,
-      data::GameTraits::inGameViewPortSize.height)
-  , mMapRenderer(pRenderer, pMap, std::move(mapRenderData))
+      mViewPortRect.size.width,
+      mViewPortRect.size.height)
+  , mRenderQueue(pRenderer)
+  , mMapRenderer(pRenderer, pMap, viewPortSize, std::move(mapRenderData))
+  , mpTileDebris(pTileDebris)
   , mpCameraPosition(pCameraPosition)
+  , mPreviousCameraPosition(*pCameraPosition)
+  , mSpriteEntities(events)
 {
+  using components::OverrideDrawOrder;
+
+  events.subscribe<ex::ComponentAddedEvent<Sprite>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<Sprite>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<WorldPosition>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<WorldPosition>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<DrawTopMost>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<DrawTopMost>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<OverrideDrawOrder>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<OverrideDrawOrder>>(*this);
+  events.subscribe<ex::ComponentAddedEvent<ActorTag>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<ActorTag>>(*this);
+  events.subscribe<events::ClearingAllEntities>(*this);
+
+  entities.each<ActorTag>([this](ex::Entity entity, const ActorTag&) {
+    addWaterArea(entity);
+  });
+}
+
+
+RenderingSystem::~RenderingSystem() = default;
+
+
+void RenderingSystem::rememberPreviousPositions(ex::EntityManager& es) {
+  mPreviousCameraPosition = *mpCameraPosition;
+
+  // The game logic update which follows might change draw order in ways
+  // that don't cause any events, so refresh the draw list afterwards.
+  mDrawListOutdated = true;
+
+  // Sprite positions are only needed if the last frame was actually drawn
+  // with interpolation. This keeps the cost out of regular play and the
+  // headless simulator.
+  if (!mIsInterpolating) {
+    mHasPreviousPositions = false;
+    return;
+  }
+
+  ++mPreviousPositionsTick;
+  mHasPreviousPositions = true;
+
+  mSpriteEntities.each(es,
+    [this](ex::Entity entity, const Sprite&, const WorldPosition& pos) {
+      const auto id = entity.id();
+      if (id.index() >= mPreviousPositions.size()) {
+        mPreviousPositions.resize(id.index() + 1);
+      }
+
+      mPreviousPositions[id.index()] =
+        PreviousPosition{pos, id.version(), mPreviousPositionsTick};
+    });
+}
+
+
+const base::Vector* RenderingSystem::previousPosition(
+  const ex::Entity entity
+) const {
+  const auto id = entity.id();
+  if (!mHasPreviousPositions || id.index() >= mPreviousPositions.size()) {
+    return nullptr;
+  }
+
+  // Entities spawned during the last update have no entry for it yet, and
+  // the entity's index might have been used by a different one before
+  const auto& entry = mPreviousPositions[id.index()];
+  if (
+    entry.mTick != mPreviousPositionsTick ||
+    entry.mEntityVersion != id.version()
+  ) {
+    return nullptr;
+  }
+
+  return &entry.mPosition;
 }
 
 
 void RenderingSystem::update(
   ex::EntityManager& es,
-  const std::optional<base::Color>& backdropFlashColor
+  const std::optional<base::Color>& backdropFlashColor,
+  const float interpolationFactor
 ) {
   using namespace std;
-  using game_logic::components::TileDebris;
 
-  // Collect sprites, then order by draw index
-  vector<SpriteData> spritesByDrawOrder;
-  es.each<Sprite, WorldPosition>([&spritesByDrawOrder](
-    ex::Entity entity,
-    Sprite& sprite,
-    const WorldPosition& pos
-  ) {
-    const auto drawTopMost = entity.has_component<DrawTopMost>();
-    spritesByDrawOrder.emplace_back(entity, &sprite, drawTopMost, pos);
-  });
-  sort(begin(spritesByDrawOrder), end(spritesByDrawOrder));
+  mIsInterpolating = interpolationFactor < 1.0f;
+  mCameraOffsetPx = interpolationOffsetPx(
+    mPreviousCameraPosition, *mpCameraPosition, interpolationFactor);
+
+  if (mDrawListOutdated) {
+    mDrawList.update(mSpriteEntities, es);
+    mDrawListOutdated = false;
+  }
+
+  // Collect visible sprites. The draw list is already in draw order.
+  auto& spritesByDrawOrder = mVisibleSprites;
+  spritesByDrawOrder.clear();
+  for (const auto& entry : mDrawList.entries()) {
+    auto entity = entry.mEntity;
+    const auto& sprite = *entity.component<const Sprite>();
+    const auto& pos = *entity.component<const WorldPosition>();
+
+    if (!sprite.mShow) {
+      continue;
+    }
+
+    auto drawOffsetPx = base::Vector{} - mCameraOffsetPx;
+    if (mIsInterpolating) {
+      if (const auto pPreviousPos = previousPosition(entity)) {
+        drawOffsetPx +=
+          interpolationOffsetPx(*pPreviousPos, pos, interpolationFactor);
+      }
+    }
+
+    // Custom render functions might draw outside of the sprite's frames, so
+    // we can't cull those
+    const auto isOffScreen =
+      !entity.has_component<CustomRenderFunc>() &&
+      !isSpriteOnScreen(
+        sprite,
+        entity,
+        pos - *mpCameraPosition,
+        drawOffsetPx,
+        mViewPortRect);
+    if (isOffScreen) {
+      continue;
+    }
+
+    spritesByDrawOrder.emplace_back(entry, &sprite, pos, drawOffsetPx);
+  }
 
   const auto firstTopMostIt = find_if(
     begin(spritesByDrawOrder),
     end(spritesByDrawOrder),
     mem_fn(&SpriteData::mDrawTopMost));
 
+  // The water effect needs to read back what has been drawn so far, which
+  // requires rendering into an intermediate render target. Without any
+  // water on screen, we can skip that and draw into the current target
+  // directly.
+  //
+  // When there is water, copying only the affected areas out of the
+  // current target isn't an option: It's usually the upscaled screen, with
+  // global translation and scale applied, whereas the water effect needs
+  // the unscaled pixels. So everything goes through the intermediate target
+  // in that case, and gets composited with a single full-size draw.
+  collectVisibleWaterEffectAreas();
+
+  if (mVisibleWaterEffectAreas.empty()) {
+    renderBackgroundLayers(
+      spritesByDrawOrder.cbegin(), firstTopMostIt, backdropFlashColor);
+  } else {
+    {
+      renderer::RenderTargetTexture::Binder bindRenderTarget(
+        mRenderTarget, mpRenderer);
+
+      renderBackgroundLayers(
+        spritesByDrawOrder.cbegin(), firstTopMostIt, backdropFlashColor);
+    }
+
+    renderer::Renderer::GpuTimerScope timerScope(mpRenderer, "Water effect");
+    mRenderTarget.render(mpRenderer, 0, 0);
+
+    renderWaterEffectAreas();
+  }
+
+  {
+    renderer::Renderer::GpuTimerScope timerScope(
+      mpRenderer, "Foreground tiles");
+    mMapRenderer.renderForeground(*mpCameraPosition, mCameraOffsetPx);
+  }
+
   {
-    renderer::RenderTargetTexture::Binder bindRenderTarget(mRenderTarget, mpRenderer);
+    // top most
+    renderer::Renderer::GpuTimerScope timerScope(mpRenderer, "Sprites");
+    renderSprites(firstTopMostIt, spritesByDrawOrder.cend());
+  }
+
+  mSpritesRendered = spritesByDrawOrder.size();
+
+
+  // tile debris
+  mMapRenderer.renderTileDebris(*mpTileDebris, *mpCameraPosition);
+}
+
+
+void RenderingSystem::renderBackgroundLayers(
+  const SpriteIter firstSprite,
+  const SpriteIter lastSprite,
+  const std::optional<base::Color>& backdropFlashColor
+) {
+  {
+    renderer::Renderer::GpuTimerScope timerScope(mpRenderer, "Backdrop");
 
-    // Render
     if (backdropFlashColor) {
       mpRenderer->setOverlayColor(*backdropFlashColor);
       mMapRenderer.renderBackdrop(*mpCameraPosition);
@@ -243,39 +483,44 @@ void RenderingSystem::update(
     } else {
       mMapRenderer.renderBackdrop(*mpCameraPosition);
     }
-
-    mMapRenderer.renderBackground(*mpCameraPosition);
-
-    // behind foreground
-    for (auto it = spritesByDrawOrder.cbegin(); it != firstTopMostIt; ++it) {
-      renderSprite(*it);
-    }
   }
 
+  {
+    renderer::Renderer::GpuTimerScope timerScope(
+      mpRenderer, "Background tiles");
+    mMapRenderer.renderBackground(*mpCameraPosition, mCameraOffsetPx);
+  }
 
-  mRenderTarget.render(mpRenderer, 0, 0);
+  // behind foreground
+  renderer::Renderer::GpuTimerScope timerScope(mpRenderer, "Sprites");
+  renderSprites(firstSprite, lastSprite);
+}
 
-  renderWaterEffectAreas(es);
 
-  mMapRenderer.renderForeground(*mpCameraPosition);
+void RenderingSystem::renderSprites(
+  const SpriteIter first,
+  const SpriteIter last
+) {
+  // Sprites are sorted by draw order at this point. Each distinct draw order
+  // becomes a layer in the render queue, which keeps the order of sprites
+  // within a layer and only merges adjacent frames sharing the same state.
+  std::uint16_t layer = 0;
+  for (auto it = first; it != last; ++it) {
+    if (it != first && std::prev(it)->mDrawOrder != it->mDrawOrder) {
+      ++layer;
+    }
 
-  // top most
-  for (auto it = firstTopMostIt; it != spritesByDrawOrder.cend(); ++it) {
-    renderSprite(*it);
+    renderSprite(*it, layer);
   }
 
-  mSpritesRendered = spritesByDrawOrder.size();
-
-
-  // tile debris
-  es.each<TileDebris, WorldPosition>(
-    [this](ex::Entity, const TileDebris& debris, const WorldPosition& pos) {
-      mMapRenderer.renderSingleTile(debris.mTileIndex, pos, *mpCameraPosition);
-    });
+  mRenderQueue.submit();
 }
 
 
-void RenderingSystem::renderSprite(const SpriteData& data) const {
+void RenderingSystem::renderSprite(
+  const SpriteData& data,
+  const std::uint16_t layer
+) {
   const auto& pos = data.mPosition;
   const auto& sprite = *data.mpSprite;
 
@@ -284,9 +529,21 @@ void RenderingSystem::renderSprite(const SpriteData& data) const {
   }
 
   if (data.mEntity.has_component<CustomRenderFunc>()) {
+    // Custom render functions draw directly, so everything recorded so far
+    // needs to be drawn first to keep the order intact.
+    mRenderQueue.submit();
+
     const auto renderFunc = *data.mEntity.component<const CustomRenderFunc>();
     renderFunc(mpRenderer, data.mEntity, sprite, pos - *mpCameraPosition);
   } else {
+    // White flash takes priority over translucency
+    const auto overlayColor = sprite.mFlashingWhite
+      ? base::Color{255, 255, 255, 255}
+      : base::Color{};
+    const auto colorModulation = !sprite.mFlashingWhite && sprite.mTranslucent
+      ? base::Color{255, 255, 255, 130}
+      : base::Color{255, 255, 255, 255};
+
     for (const auto baseFrameIndex : sprite.mFramesToRender) {
       assert(baseFrameIndex < int(sprite.mpDrawData->mFrames.size()));
 
@@ -296,60 +553,103 @@ void RenderingSystem::renderSprite(const SpriteData& data) const {
 
       const auto frameIndex = virtualToRealFrame(
         baseFrameIndex, *sprite.mpDrawData, data.mEntity);
+      const auto& frame = sprite.mpDrawData->mFrames[frameIndex];
+      const auto& image = frame.mImage;
+
+      mRenderQueue.drawTexture(
+        layer,
+        image.pageData(),
+        image.rectInPage(),
+        {
+          spriteFrameTopLeftPx(frame, pos - *mpCameraPosition) +
+            data.mDrawOffsetPx,
+          image.extents()
+        },
+        overlayColor,
+        colorModulation);
+    }
+  }
+}
 
-      // White flash effect/translucency
 
-      // White flash takes priority over translucency
-      if (sprite.mFlashingWhite) {
-        mpRenderer->setOverlayColor(base::Color{255, 255, 255, 255});
-      } else if (sprite.mTranslucent) {
-        mpRenderer->setColorModulation(base::Color{255, 255, 255, 130});
-      }
+void RenderingSystem::receive(
+  const ex::ComponentAddedEvent<ActorTag>& event
+) {
+  addWaterArea(event.entity);
+}
 
-      auto& frame = sprite.mpDrawData->mFrames[frameIndex];
 
-      drawSpriteFrame(frame, pos - *mpCameraPosition, mpRenderer);
+void RenderingSystem::receive(
+  const ex::ComponentRemovedEvent<ActorTag>& event
+) {
+  const auto iWaterArea =
+    std::find(mWaterAreas.begin(), mWaterAreas.end(), event.entity);
+  if (iWaterArea != mWaterAreas.end()) {
+    mWaterAreas.erase(iWaterArea);
+  }
+}
 
-      mpRenderer->setOverlayColor(base::Color{});
-      mpRenderer->setColorModulation(base::Color{255, 255, 255, 255});
-    }
+
+void RenderingSystem::addWaterArea(ex::Entity entity) {
+  using T = ActorTag::Type;
+
+  const auto type = entity.component<const ActorTag>()->mType;
+  if (type != T::AnimatedWaterArea && type != T::WaterArea) {
+    return;
   }
+
+  const auto iInsertionPoint = std::lower_bound(
+    mWaterAreas.begin(),
+    mWaterAreas.end(),
+    entity,
+    [](const ex::Entity lhs, const ex::Entity rhs) {
+      return lhs.id().index() < rhs.id().index();
+    });
+  mWaterAreas.insert(iInsertionPoint, entity);
 }
 
 
-void RenderingSystem::renderWaterEffectAreas(entityx::EntityManager& es) {
+void RenderingSystem::collectVisibleWaterEffectAreas() {
   using engine::components::BoundingBox;
-  using game_logic::components::ActorTag;
-
-  es.each<ActorTag, WorldPosition, BoundingBox>(
-    [&, this](
-      entityx::Entity,
-      const ActorTag& tag,
-      const WorldPosition& position,
-      const BoundingBox& bbox
-    ) {
-      using T = ActorTag::Type;
-
-      const auto isWaterArea =
-        tag.mType == T::AnimatedWaterArea || tag.mType == T::WaterArea;
-      if (isWaterArea) {
-        const auto screenPosition = position - *mpCameraPosition;
-        const auto worldSpaceBbox = engine::toWorldSpace(bbox, screenPosition);
-        const auto topLeftPx =
-          data::tileVectorToPixelVector(worldSpaceBbox.topLeft);
-        const auto sizePx =
-          data::tileExtentsToPixelExtents(worldSpaceBbox.size);
-
-        const auto hasAnimatedSurface = tag.mType == T::AnimatedWaterArea;
-
-        mpRenderer->drawWaterEffect(
-          {topLeftPx, sizePx},
-          mRenderTarget.data(),
-          hasAnimatedSurface
-            ? std::optional<int>(mWaterAnimStep)
-            : std::nullopt);
-      }
-    });
+  using T = ActorTag::Type;
+
+  mVisibleWaterEffectAreas.clear();
+
+  for (const auto entity : mWaterAreas) {
+    if (!hasAllComponents<WorldPosition, BoundingBox>(entity)) {
+      continue;
+    }
+
+    const auto& position = *entity.component<const WorldPosition>();
+    const auto& bbox = *entity.component<const BoundingBox>();
+    const auto& tag = *entity.component<const ActorTag>();
+
+    const auto screenPosition = position - *mpCameraPosition;
+    const auto worldSpaceBbox = engine::toWorldSpace(bbox, screenPosition);
+    const auto topLeftPx =
+      data::tileVectorToPixelVector(worldSpaceBbox.topLeft);
+    const auto sizePx =
+      data::tileExtentsToPixelExtents(worldSpaceBbox.size);
+    const auto area =
+      base::Rect<int>{topLeftPx - mCameraOffsetPx, sizePx};
+
+    if (area.intersects(mViewPortRect)) {
+      mVisibleWaterEffectAreas.push_back(
+        {area, tag.mType == T::AnimatedWaterArea});
+    }
+  }
+}
+
+
+void RenderingSystem::renderWaterEffectAreas() {
+  for (const auto& waterArea : mVisibleWaterEffectAreas) {
+    mpRenderer->drawWaterEffect(
+      waterArea.mArea,
+      mRenderTarget.data(),
+      waterArea.mHasAnimatedSurface
+        ? std::optional<int>(mWaterAnimStep)
+        : std::nullopt);
+  }
 }
 
 }
@@ -19,9 +19,14 @@
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/map_renderer.hpp"
+#include "engine/packed_entity_view.hpp"
+#include "engine/sprite_draw_list.hpp"
+#include "engine/tile_debris_system.hpp"
 #include "engine/timing.hpp"
 #include "engine/visual_components.hpp"
+#include "renderer/render_queue.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/texture.hpp"
 
@@ -35,15 +40,34 @@ RIGEL_RESTORE_WARNINGS
 #include <vector>
 
 
+namespace rigel::game_logic::components { struct ActorTag; }
+
+
 namespace rigel::engine {
 
-/** Animates sprites with an AnimationLoop component
+/** Animates sprites with an AnimationLoop or AnimationSequence component
+ *
+ * update() should be called at game-logic rate. It adjusts the animation
+ * frame of all sprites having one of the animation components, and ends
+ * the white flash of any sprite that had flashWhite() called on it during
+ * the previous update.
  *
- * Should be called at game-logic rate. Works on all entities that have a
- * Sprite and an AnimationLoop component. Adjusts the sprite's animation frame
- * based on the animation.
+ * Animated and flashing sprites are visited via packed views, so entities
+ * without a sprite don't need to be looked at.
  */
-void updateAnimatedSprites(entityx::EntityManager& es);
+class SpriteAnimationSystem {
+public:
+  explicit SpriteAnimationSystem(entityx::EventManager& events);
+
+  void update(entityx::EntityManager& es);
+
+private:
+  PackedEntityView<components::Sprite, components::AnimationLoop>
+    mAnimationLoops;
+  PackedEntityView<components::Sprite, components::AnimationSequence>
+    mAnimationSequences;
+  PackedEntityView<components::Sprite> mSprites;
+};
 
 
 /** Renders the map and in-game sprites
@@ -52,14 +76,24 @@ void updateAnimatedSprites(entityx::EntityManager& es);
  * Also renders the map using a engine::MapRenderer. Map and sprite rendering
  * are handled by the same system so that draw-order can be done properly
  * (e.g. some sprites are rendered behind certain tiles, others before etc.)
+ *
+ * Sprites are kept in a persistent list sorted by draw order. The list is
+ * brought up to date at most once per game logic update, and whenever
+ * a sprite entity or its draw order changed. Render frames in between only
+ * need to cull and draw.
  */
-class RenderingSystem {
+class RenderingSystem : public entityx::Receiver<RenderingSystem> {
 public:
   RenderingSystem(
     const base::Vector* pCameraPosition,
     renderer::Renderer* pRenderer,
     const data::map::Map* pMap,
-    MapRenderer::MapRenderData&& mapRenderData);
+    const TileDebrisSystem* pTileDebris,
+    const data::ViewPortSize& viewPortSize,
+    MapRenderer::MapRenderData&& mapRenderData,
+    entityx::EntityManager& entities,
+    entityx::EventManager& events);
+  ~RenderingSystem();
 
   /** Update map tile animation state. Should be called at game-logic rate. */
   void updateAnimatedMapTiles() {
@@ -71,31 +105,121 @@ public:
     }
   }
 
-  /** Render everything. Can be called at full frame rate. */
+  /** Remember the current camera and sprite positions
+   *
+   * Should be called at game-logic rate, before updating the game logic.
+   * The remembered positions are used for motion interpolation, see update().
+   * Sprite positions are only recorded while the previous frame was drawn
+   * with interpolation, otherwise this does very little work.
+   */
+  void rememberPreviousPositions(entityx::EntityManager& es);
+
+  /** Render everything. Can be called at full frame rate.
+   *
+   * The interpolation factor gives the time passed since the last game logic
+   * update, as a fraction of the update interval. With a factor below 1, the
+   * camera and sprites are drawn at a position in between their previous
+   * and current ones, so that motion appears smooth when rendering at a
+   * higher rate than the game logic runs. With a factor of 1, everything is
+   * drawn at its current position.
+   */
   void update(
     entityx::EntityManager& es,
-    const std::optional<base::Color>& backdropFlashColor);
+    const std::optional<base::Color>& backdropFlashColor,
+    float interpolationFactor = 1.0f);
 
   void switchBackdrops() {
     mMapRenderer.switchBackdrops();
   }
 
+  void updateBackdropAutoScroll(const engine::TimeDelta dt) {
+    mMapRenderer.updateBackdropAutoScroll(dt);
+  }
+
   std::size_t spritesRendered() const {
     return mSpritesRendered;
   }
 
+  template <typename C>
+  void receive(const entityx::ComponentAddedEvent<C>&) {
+    mDrawListOutdated = true;
+  }
+
+  template <typename C>
+  void receive(const entityx::ComponentRemovedEvent<C>&) {
+    mDrawListOutdated = true;
+  }
+
+  void receive(
+    const entityx::ComponentAddedEvent<game_logic::components::ActorTag>&
+      event);
+  void receive(
+    const entityx::ComponentRemovedEvent<game_logic::components::ActorTag>&
+      event);
+
+  void receive(const events::ClearingAllEntities&) {
+    // A restored snapshot reuses the same entity IDs, so the remembered
+    // positions would otherwise be matched to the new entities
+    mHasPreviousPositions = false;
+  }
+
 private:
   struct SpriteData;
-  void renderSprite(const SpriteData& data) const;
-  void renderWaterEffectAreas(entityx::EntityManager& es);
+  using SpriteIter = std::vector<SpriteData>::const_iterator;
+
+  struct WaterEffectArea {
+    base::Rect<int> mArea;
+    bool mHasAnimatedSurface;
+  };
+
+  struct PreviousPosition {
+    base::Vector mPosition;
+    std::uint32_t mEntityVersion = 0;
+    std::uint32_t mTick = 0;
+  };
+
+  void renderBackgroundLayers(
+    SpriteIter firstSprite,
+    SpriteIter lastSprite,
+    const std::optional<base::Color>& backdropFlashColor);
+  const base::Vector* previousPosition(entityx::Entity entity) const;
+  void renderSprites(SpriteIter first, SpriteIter last);
+  void renderSprite(const SpriteData& data, std::uint16_t layer);
+  void addWaterArea(entityx::Entity entity);
+  void collectVisibleWaterEffectAreas();
+  void renderWaterEffectAreas();
 
 private:
   renderer::Renderer* mpRenderer;
+  base::Rect<int> mViewPortRect;
   renderer::RenderTargetTexture mRenderTarget;
+  renderer::RenderQueue mRenderQueue;
   MapRenderer mMapRenderer;
+  const TileDebrisSystem* mpTileDebris;
   const base::Vector* mpCameraPosition;
+  base::Vector mPreviousCameraPosition;
+  base::Vector mCameraOffsetPx;
+
+  // Sprite positions at the time of the previous game logic update, indexed
+  // by entity index. Kept here instead of in a component, so that they don't
+  // end up in entity snapshots.
+  std::vector<PreviousPosition> mPreviousPositions;
+  std::uint32_t mPreviousPositionsTick = 0;
+  bool mHasPreviousPositions = false;
+  bool mIsInterpolating = false;
+  PackedEntityView<components::Sprite, components::WorldPosition>
+    mSpriteEntities;
+  SpriteDrawList mDrawList;
+  std::vector<SpriteData> mVisibleSprites;
+
+  // Entities tagged as water areas, in entity index order. Water areas are
+  // part of the level, so this list is built once and rarely changes
+  // afterwards. That saves looking through all tagged actors every frame.
+  std::vector<entityx::Entity> mWaterAreas;
+  std::vector<WaterEffectArea> mVisibleWaterEffectAreas;
   int mWaterAnimStep = 0;
   std::size_t mSpritesRendered = 0;
+  bool mDrawListOutdated = true;
 };
 
 }
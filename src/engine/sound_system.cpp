@@ -17,12 +17,15 @@
 #include "sound_system.hpp"
 
 #include "base/math_tools.hpp"
-#include "engine/imf_player.hpp"
+#include "engine/audio_mixer.hpp"
+#include "engine/music_cache.hpp"
+#include "engine/trace_recorder.hpp"
 #include "sdl_utils/error.hpp"
 
-#include <speex/speex_resampler.h>
-
+#include <algorithm>
 #include <cassert>
+#include <iostream>
+#include <thread>
 #include <utility>
 
 namespace rigel::engine {
@@ -31,55 +34,16 @@ namespace {
 
 using SoundHandle = SoundSystem::SoundHandle;
 
-const auto SAMPLE_RATE = 44100;
-const auto BUFFER_SIZE = 2048;
-
-
-sdl_utils::Ptr<Mix_Chunk> createMixChunk(data::AudioBuffer& buffer) {
-  const auto bufferSize = buffer.mSamples.size() * sizeof(data::Sample);
-  return sdl_utils::Ptr<Mix_Chunk>(
-    Mix_QuickLoad_RAW(reinterpret_cast<Uint8*>(buffer.mSamples.data()),
-    static_cast<Uint32>(bufferSize)));
-}
-
+const auto MAX_SOUND_LOADING_THREADS = std::size_t{8};
 
-data::AudioBuffer resampleAudio(
-  const data::AudioBuffer& buffer,
-  const int newSampleRate
-) {
-  using ResamplerPtr =
-    std::unique_ptr<SpeexResamplerState, decltype(&speex_resampler_destroy)>;
-  ResamplerPtr pResampler(
-    speex_resampler_init(
-      1,
-      buffer.mSampleRate,
-      newSampleRate,
-      5,
-      nullptr),
-    &speex_resampler_destroy);
-  speex_resampler_skip_zeros(pResampler.get());
-
-  auto inputLength = static_cast<spx_uint32_t>(buffer.mSamples.size());
-  auto outputLength = static_cast<spx_uint32_t>(
-    base::integerDivCeil<spx_uint32_t>(
-      inputLength, buffer.mSampleRate) * newSampleRate);
-
-  std::vector<data::Sample> resampled(outputLength);
-  speex_resampler_process_int(
-    pResampler.get(),
-    0,
-    buffer.mSamples.data(),
-    &inputLength,
-    resampled.data(),
-    &outputLength);
-  resampled.resize(outputLength);
-  return {newSampleRate, resampled};
-}
+// A callback which comes this much later than the duration of one buffer
+// most likely means that the device ran out of data
+const auto UNDERRUN_THRESHOLD = 1.5;
 
 
 void appendRampToZero(data::AudioBuffer& buffer) {
   // Roughly 10 ms of linear ramp
-  const auto rampLength = (SAMPLE_RATE / 100);
+  const auto rampLength = (buffer.mSampleRate / 100);
 
   buffer.mSamples.reserve(buffer.mSamples.size() + rampLength - 1);
   const auto lastSample = buffer.mSamples.back();
@@ -91,115 +55,230 @@ void appendRampToZero(data::AudioBuffer& buffer) {
   }
 }
 
+
+data::AudioBuffer prepareSound(data::AudioBuffer buffer) {
+  if (buffer.mSamples.back() != 0) {
+    // Prevent clicks/pops with samples that don't return to 0 at the end
+    // by adding a small linear ramp leading back to zero.
+    appendRampToZero(buffer);
+  }
+
+  return buffer;
+}
+
 }
 
 
-SoundSystem::SoundSystem()
-  : mpMusicPlayer(std::make_unique<ImfPlayer>(SAMPLE_RATE))
-{
-  sdl_utils::check(Mix_OpenAudio(
-      SAMPLE_RATE,
-      MIX_DEFAULT_FORMAT,
-      1, // mono
-      BUFFER_SIZE));
-  Mix_HookMusic(
-    [](void* pUserData, Uint8* pOutBuffer, int bytesRequired) {
-      auto pPlayer = static_cast<ImfPlayer*>(pUserData);
-      auto pDestination = reinterpret_cast<std::int16_t*>(pOutBuffer);
-      const auto samplesRequired = bytesRequired / sizeof(std::int16_t);
-
-      pPlayer->render(pDestination, samplesRequired);
-    },
-    mpMusicPlayer.get());
-
-  Mix_AllocateChannels(MAX_CONCURRENT_SOUNDS);
+SoundSystem::SoundSystem(const AudioSettings& settings) {
+  static_assert(MAX_CONCURRENT_SOUNDS <= AudioMixer::MAX_VOICES);
+
+  SDL_AudioSpec desiredSpec{};
+  desiredSpec.freq = settings.mSampleRate;
+  desiredSpec.format = AUDIO_S16SYS;
+  desiredSpec.channels = 1;
+  desiredSpec.samples = static_cast<Uint16>(settings.mBufferSize);
+  desiredSpec.userdata = this;
+  desiredSpec.callback = [](void* pUserData, Uint8* pOutBuffer, int bytes) {
+    auto pSelf = static_cast<SoundSystem*>(pUserData);
+    auto pDestination = reinterpret_cast<std::int16_t*>(pOutBuffer);
+    const auto samplesRequired = bytes / sizeof(std::int16_t);
+
+    pSelf->renderAudio(pDestination, samplesRequired);
+  };
+
+  // We let the device pick a different sample rate and buffer size if it
+  // doesn't support the requested ones. Music is then rendered and sound
+  // effects resampled at whatever rate we got, instead of having SDL convert
+  // the final output. Sound effects are kept at their original rate, the
+  // mixer converts them while playing.
+  SDL_AudioSpec obtainedSpec{};
+  mAudioDevice = SDL_OpenAudioDevice(
+    settings.mDeviceName ? settings.mDeviceName->c_str() : nullptr,
+    0,
+    &desiredSpec,
+    &obtainedSpec,
+    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+  if (mAudioDevice == 0) {
+    throw sdl_utils::Error{};
+  }
+
+  mActiveSettings = settings;
+  mActiveSettings.mSampleRate = obtainedSpec.freq;
+  mActiveSettings.mBufferSize = obtainedSpec.samples;
+
+  // The device starts out paused, so the callback won't run before the mixer
+  // exists
+  mpMixer = std::make_unique<AudioMixer>(
+    mActiveSettings.mSampleRate,
+    &mStatistics,
+    settings.mLowCpuMusicEmulation
+      ? loader::AdlibEmulator::Mode::LowCpu
+      : loader::AdlibEmulator::Mode::Accurate);
+  SDL_PauseAudioDevice(mAudioDevice, 0);
+
+  if (settings.mCacheDirectory) {
+    mpMusicCache = std::make_unique<MusicCache>(
+      *settings.mCacheDirectory, mActiveSettings.mSampleRate);
+  }
 }
 
 
 SoundSystem::~SoundSystem() {
-  Mix_HookMusic(nullptr, nullptr);
+  // Closing the device waits for the audio callback to finish, after which
+  // the mixer isn't accessed anymore.
+  SDL_CloseAudioDevice(mAudioDevice);
+}
+
 
-  // We have to destroy all the MixChunks before we can call Mix_Quit().
-  for (auto& sound : mSounds) {
-    sound.mpMixChunk.reset(nullptr);
+std::vector<SoundHandle> SoundSystem::addSoundsAsync(
+  std::vector<SoundLoader> loaders
+) {
+  assert(mNextHandle + loaders.size() <= MAX_CONCURRENT_SOUNDS);
+
+  struct Job {
+    SoundLoader mLoad;
+    std::promise<data::AudioBuffer> mResult;
+  };
+
+  // The workers don't access the sound system itself, they only share the
+  // job list. Each job is picked up by exactly one worker.
+  auto pJobs = std::make_shared<std::vector<Job>>();
+  auto pNextJobIndex = std::make_shared<std::atomic<std::size_t>>(0);
+
+  std::vector<SoundHandle> handles;
+  for (auto& loader : loaders) {
+    const auto handle = mNextHandle++;
+
+    auto job = Job{std::move(loader), {}};
+    mLoadingSounds[handle] = job.mResult.get_future();
+    pJobs->push_back(std::move(job));
+    handles.push_back(handle);
+  }
+
+  auto work = [pJobs, pNextJobIndex]() {
+    for (
+      auto index = (*pNextJobIndex)++;
+      index < pJobs->size();
+      index = (*pNextJobIndex)++
+    ) {
+      auto& job = (*pJobs)[index];
+      try {
+        job.mResult.set_value(prepareSound(job.mLoad()));
+      } catch (...) {
+        job.mResult.set_exception(std::current_exception());
+      }
+    }
+  };
+
+  const auto numWorkers = std::clamp(
+    static_cast<std::size_t>(std::thread::hardware_concurrency()),
+    std::size_t{1},
+    std::min(MAX_SOUND_LOADING_THREADS, pJobs->size()));
+  for (auto i = std::size_t{0}; i < numWorkers; ++i) {
+    mLoadingWorkers.push_back(std::async(std::launch::async, work));
   }
 
-  Mix_Quit();
+  return handles;
 }
 
 
-SoundHandle SoundSystem::addSound(const data::AudioBuffer& original) {
-  auto buffer = resampleAudio(original, SAMPLE_RATE);
-  if (buffer.mSamples.back() != 0) {
-    // Prevent clicks/pops with samples that don't return to 0 at the end
-    // by adding a small linear ramp leading back to zero.
-    appendRampToZero(buffer);
+void SoundSystem::installLoadedSound(const SoundHandle handle) {
+  try {
+    mSounds[handle] = mLoadingSounds[handle].get();
+    mSoundBytes[handle] = base::memory_accounting::TrackedBytes(
+      base::memory_accounting::Category::Sounds,
+      mSounds[handle].mSamples.size() * sizeof(data::Sample));
+  } catch (const std::exception& ex) {
+    std::cerr << "WARNING: Failed to load sound: " << ex.what() << '\n';
+  }
+}
+
+
+void SoundSystem::renderAudio(
+  std::int16_t* pBuffer,
+  const std::size_t samplesRequired
+) {
+  using namespace std::chrono;
+
+  const auto now = steady_clock::now();
+  if (mLastCallbackTime) {
+    const auto bufferDuration = duration<double>(
+      double(samplesRequired) / mActiveSettings.mSampleRate);
+    if (now - *mLastCallbackTime > bufferDuration * UNDERRUN_THRESHOLD) {
+      mStatistics.recordUnderrun();
+
+      // Makes the gap between the two callbacks visible on the timeline
+      if (traceRecorder().isEnabled()) {
+        traceRecorder().addZone("Audio underrun", *mLastCallbackTime, now);
+      }
+    }
   }
+  mLastCallbackTime = now;
+
+  mpMixer->render(pBuffer, samplesRequired);
 
-#if MIX_DEFAULT_FORMAT != AUDIO_S16LSB
-  SDL_AudioSpec originalSoundSpec{
-    buffer.mSampleRate,
-    AUDIO_S16LSB,
-    1,
-    0, 0, 0, 0, nullptr};
-  SDL_AudioCVT conversionSpecs;
-  SDL_BuildAudioCVT(
-    &conversionSpecs,
-    AUDIO_S16LSB, 1, buffer.mSampleRate,
-    MIX_DEFAULT_FORMAT, 1, SAMPLE_RATE);
-
-  conversionSpecs.len = static_cast<int>(
-    buffer.mSamples.size() * 2);
-  std::vector<data::Sample> tempBuffer(
-    conversionSpecs.len * conversionSpecs.len_mult);
-  conversionSpecs.buf = reinterpret_cast<Uint8*>(tempBuffer.data());
-  std::copy(
-    buffer.mSamples.cbegin(), buffer.mSamples.cend(), tempBuffer.begin());
-
-  SDL_ConvertAudio(&conversionSpecs);
-
-  data::AudioBuffer convertedBuffer{SAMPLE_RATE};
-  convertedBuffer.mSamples.insert(
-    convertedBuffer.mSamples.end(),
-    tempBuffer.cbegin(),
-    tempBuffer.cbegin() + conversionSpecs.len_cvt);
-  return addConvertedSound(convertedBuffer);
-#else
-  return addConvertedSound(buffer);
-#endif
+  mStatistics.recordCallback(steady_clock::now() - now);
 }
 
 
-SoundHandle SoundSystem::addConvertedSound(data::AudioBuffer buffer) {
-  assert(mNextHandle < MAX_CONCURRENT_SOUNDS);
+void SoundSystem::update() {
+  for (auto handle = 0; handle < mNextHandle; ++handle) {
+    auto& loadingSound = mLoadingSounds[handle];
+    if (
+      loadingSound.valid() &&
+      loadingSound.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready
+    ) {
+      installLoadedSound(handle);
+    }
+  }
 
-  const auto assignedHandle = mNextHandle++;
-  auto& sound = mSounds[assignedHandle];
-  sound.mBuffer = std::move(buffer);
-  sound.mpMixChunk = createMixChunk(sound.mBuffer);
-  return assignedHandle;
+  if (mpMusicCache) {
+    if (auto pRendered = mpMusicCache->takeResult()) {
+      mpMixer->musicPlayer().useRenderedSong(std::move(pRendered));
+    }
+  }
 }
 
 
 void SoundSystem::playSong(data::Song&& song) {
-  mpMusicPlayer->playSong(std::move(song));
+  if (mpMusicCache) {
+    mpMusicCache->request(song);
+  }
+
+  mpMixer->musicPlayer().playSong(std::move(song));
 }
 
 
 void SoundSystem::stopMusic() const {
-  mpMusicPlayer->playSong({});
+  if (mpMusicCache) {
+    mpMusicCache->cancel();
+  }
+
+  mpMixer->musicPlayer().stop();
 }
 
 
-void SoundSystem::playSound(const SoundHandle handle) const {
+void SoundSystem::playSound(const SoundHandle handle) {
   assert(handle < int(mSounds.size()));
-  Mix_PlayChannel(handle, mSounds[handle].mpMixChunk.get(), 0);
+
+  if (mLoadingSounds[handle].valid()) {
+    installLoadedSound(handle);
+  }
+
+  const auto& sound = mSounds[handle];
+  mpMixer->startVoice(
+    handle,
+    base::ArrayView<data::Sample>{
+      sound.mSamples.data(),
+      static_cast<std::uint32_t>(sound.mSamples.size())},
+    sound.mSampleRate);
 }
 
 
 void SoundSystem::stopSound(const SoundHandle handle) const {
   assert(handle < int(mSounds.size()));
-  Mix_HaltChannel(handle);
+  mpMixer->stopVoice(handle);
 }
 
 }
@@ -1,63 +1,140 @@
-/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
- *
- *  This program is free software: you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation, either version 2 of the License, or
- *  (at your option) any later version.
- *
- *  This program is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- *  GNU General Public License for more details.
- *
- *  You should have received a copy of the GNU General Public License
- *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
-
-#pragma once
-
-#include "data/audio_buffer.hpp"
-#include "data/song.hpp"
-#include "sdl_utils/ptr.hpp"
-
-#include <array>
-#include <memory>
-#include <unordered_map>
-
-
-namespace rigel::engine {
-
-class ImfPlayer;
-
-
-class SoundSystem {
-public:
-  using SoundHandle = int;
-
-  SoundSystem();
-  ~SoundSystem();
-
-  SoundHandle addSound(const data::AudioBuffer& buffer);
-
-  void playSong(data::Song&& song);
-  void stopMusic() const;
-
-  void playSound(SoundHandle handle) const;
-  void stopSound(SoundHandle handle) const;
-
-private:
-  static const int MAX_CONCURRENT_SOUNDS = 64;
-
-  struct LoadedSound {
-    data::AudioBuffer mBuffer;
-    sdl_utils::Ptr<Mix_Chunk> mpMixChunk;
-  };
-
-  SoundHandle addConvertedSound(data::AudioBuffer buffer);
-
-  std::unique_ptr<ImfPlayer> mpMusicPlayer;
-  std::array<LoadedSound, MAX_CONCURRENT_SOUNDS> mSounds;
-  SoundHandle mNextHandle = 0;
-};
-
-}
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/memory_accounting.hpp"
+#include "base/warnings.hpp"
+#include "data/audio_buffer.hpp"
+#include "data/song.hpp"
+#include "engine/audio_statistics.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <SDL.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace rigel::engine {
+
+class AudioMixer;
+class MusicCache;
+
+
+struct AudioSettings {
+  int mSampleRate = 44100;
+
+  /** Size of the audio device's buffer, in samples. Must be a power of 2. */
+  int mBufferSize = 512;
+
+  /** Name of the output device to use. System default if not set. */
+  std::optional<std::string> mDeviceName;
+
+  /** Where to store pre-rendered music
+   *
+   * If not set, music is always emulated live.
+   */
+  std::optional<std::string> mCacheDirectory;
+
+  /** Emulate music at a reduced rate, see loader::AdlibEmulator::Mode
+   *
+   * Only affects music emulated live, pre-rendered music is always rendered
+   * accurately.
+   */
+  bool mLowCpuMusicEmulation = false;
+};
+
+
+class SoundSystem {
+public:
+  using SoundHandle = int;
+  using SoundLoader = std::function<data::AudioBuffer()>;
+
+  explicit SoundSystem(const AudioSettings& settings = {});
+  ~SoundSystem();
+
+  /** Load and prepare sounds in the background
+   *
+   * Each loader is invoked on one of several worker threads. Sounds are kept
+   * at their original sample rate, and converted to the output rate while
+   * playing. Handles are returned in the same order as the loaders and
+   * can be used right away. Playing a sound which isn't ready yet waits for
+   * that sound to finish loading.
+   */
+  std::vector<SoundHandle> addSoundsAsync(std::vector<SoundLoader> loaders);
+
+  /** Needs to be called regularly, e.g. once per frame */
+  void update();
+
+  void playSong(data::Song&& song);
+  void stopMusic() const;
+
+  void playSound(SoundHandle handle);
+  void stopSound(SoundHandle handle) const;
+
+  /** Settings actually in use, these can differ from the requested ones */
+  const AudioSettings& activeSettings() const {
+    return mActiveSettings;
+  }
+
+  /** Number of times the audio callback was invoked late
+   *
+   * A late callback means that the device most likely ran out of data to
+   * play, which results in audible crackling. If this number keeps growing,
+   * the buffer size should be increased.
+   */
+  std::uint64_t underrunCount() const {
+    return mStatistics.mNumUnderruns.load(std::memory_order_relaxed);
+  }
+
+  const AudioStatistics& statistics() const {
+    return mStatistics;
+  }
+
+private:
+  static const int MAX_CONCURRENT_SOUNDS = 64;
+
+  void renderAudio(std::int16_t* pBuffer, std::size_t samplesRequired);
+  void installLoadedSound(SoundHandle handle);
+
+  AudioSettings mActiveSettings;
+  AudioStatistics mStatistics;
+  std::unique_ptr<AudioMixer> mpMixer;
+  std::unique_ptr<MusicCache> mpMusicCache;
+  SDL_AudioDeviceID mAudioDevice = 0;
+
+  // Only accessed by the audio thread
+  std::optional<std::chrono::steady_clock::time_point> mLastCallbackTime;
+  std::array<data::AudioBuffer, MAX_CONCURRENT_SOUNDS> mSounds;
+  std::array<base::memory_accounting::TrackedBytes, MAX_CONCURRENT_SOUNDS>
+    mSoundBytes;
+  std::array<std::future<data::AudioBuffer>, MAX_CONCURRENT_SOUNDS>
+    mLoadingSounds;
+  std::vector<std::future<void>> mLoadingWorkers;
+  SoundHandle mNextHandle = 0;
+};
+
+}
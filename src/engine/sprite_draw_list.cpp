@@ -0,0 +1,149 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "sprite_draw_list.hpp"
+
+#include "engine/entity_tools.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+
+namespace rigel::engine {
+
+namespace ex = entityx;
+
+using components::DrawTopMost;
+using components::OverrideDrawOrder;
+using components::Sprite;
+using components::WorldPosition;
+
+
+namespace {
+
+// Draw order values normally span a few hundred values at most. Should
+// a level ever contain a wider range, we fall back to a comparison sort
+// instead of using a huge bucket array.
+constexpr auto MAX_COUNTING_SORT_RANGE = std::size_t{4096};
+
+
+void refreshSortKey(SpriteDrawList::Entry& entry) {
+  const auto entity = entry.mEntity;
+  entry.mDrawOrder = entity.has_component<OverrideDrawOrder>()
+    ? entity.component<const OverrideDrawOrder>()->mDrawOrder
+    : entity.component<const Sprite>()->mpDrawData->mDrawOrder;
+  entry.mDrawTopMost = entity.has_component<DrawTopMost>();
+}
+
+}
+
+
+void SpriteDrawList::update(
+  SpriteEntityView& spriteEntities,
+  ex::EntityManager& es
+) {
+  // Drop entries for entities which are gone or lost their sprite or
+  // position, and refresh the sort keys of all others
+  mEntries.erase(
+    std::remove_if(
+      mEntries.begin(),
+      mEntries.end(),
+      [&](Entry& entry) {
+        const auto entity = entry.mEntity;
+        const auto isStillDrawable =
+          entity.valid() &&
+          hasAllComponents<Sprite, WorldPosition>(entity);
+
+        if (!isStillDrawable) {
+          mListedEntityVersions[entity.id().index()] = 0;
+          return true;
+        }
+
+        refreshSortKey(entry);
+        return false;
+      }),
+    mEntries.end());
+
+  // Add new entities at the end
+  spriteEntities.each(es,
+    [&](ex::Entity entity, const Sprite&, const WorldPosition&) {
+      const auto id = entity.id();
+      if (id.index() >= mListedEntityVersions.size()) {
+        mListedEntityVersions.resize(id.index() + 1, 0);
+      }
+
+      auto& listedVersion = mListedEntityVersions[id.index()];
+      if (listedVersion != id.version()) {
+        listedVersion = id.version();
+
+        auto entry = Entry{entity, 0, false};
+        refreshSortKey(entry);
+        mEntries.push_back(entry);
+      }
+    });
+
+  sort();
+}
+
+
+void SpriteDrawList::sort() {
+  if (mEntries.empty()) {
+    return;
+  }
+
+  const auto [iMin, iMax] = std::minmax_element(
+    mEntries.begin(),
+    mEntries.end(),
+    [](const Entry& lhs, const Entry& rhs) {
+      return lhs.mDrawOrder < rhs.mDrawOrder;
+    });
+  const auto minDrawOrder = iMin->mDrawOrder;
+  const auto drawOrderRange =
+    static_cast<std::size_t>(iMax->mDrawOrder - minDrawOrder) + 1;
+
+  if (drawOrderRange > MAX_COUNTING_SORT_RANGE) {
+    std::stable_sort(mEntries.begin(), mEntries.end());
+    return;
+  }
+
+  // Stable counting sort. Top-most sprites go into a second set of buckets
+  // after all regular ones, matching Entry::operator<. Keys are computed
+  // into a compact array once, and each entry is moved exactly once.
+  mSortKeys.clear();
+  for (const auto& entry : mEntries) {
+    const auto bucket =
+      static_cast<std::size_t>(entry.mDrawOrder - minDrawOrder) +
+      (entry.mDrawTopMost ? drawOrderRange : 0);
+    mSortKeys.push_back(static_cast<std::uint32_t>(bucket));
+  }
+
+  mBucketOffsets.assign(drawOrderRange * 2 + 1, 0);
+  for (const auto key : mSortKeys) {
+    ++mBucketOffsets[key + 1];
+  }
+  std::partial_sum(
+    mBucketOffsets.begin(), mBucketOffsets.end(), mBucketOffsets.begin());
+
+  mSortedEntries.resize(mEntries.size());
+  for (std::size_t i = 0; i < mEntries.size(); ++i) {
+    mSortedEntries[mBucketOffsets[mSortKeys[i]]++] = mEntries[i];
+  }
+
+  std::swap(mEntries, mSortedEntries);
+}
+
+}
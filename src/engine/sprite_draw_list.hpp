@@ -0,0 +1,78 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "engine/base_components.hpp"
+#include "engine/packed_entity_view.hpp"
+#include "engine/visual_components.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** All sprite entities, in the order in which they need to be drawn
+ *
+ * Contains every entity which has a Sprite and WorldPosition component,
+ * sorted by DrawTopMost first and draw order second. The list persists
+ * between updates. update() drops entities which are gone, refreshes the
+ * draw order of all others, and appends new entities before sorting. The
+ * sort is stable, so sprites with equal draw order keep their relative
+ * order from one update to the next, with new ones after existing ones.
+ */
+class SpriteDrawList {
+public:
+  struct Entry {
+    bool operator<(const Entry& rhs) const {
+      return
+        std::tie(mDrawTopMost, mDrawOrder) <
+        std::tie(rhs.mDrawTopMost, rhs.mDrawOrder);
+    }
+
+    entityx::Entity mEntity;
+    int mDrawOrder;
+    bool mDrawTopMost;
+  };
+
+  using SpriteEntityView =
+    PackedEntityView<components::Sprite, components::WorldPosition>;
+
+  void update(SpriteEntityView& spriteEntities, entityx::EntityManager& es);
+
+  const std::vector<Entry>& entries() const {
+    return mEntries;
+  }
+
+private:
+  void sort();
+
+  std::vector<Entry> mEntries;
+  std::vector<std::uint32_t> mListedEntityVersions;
+  std::vector<Entry> mSortedEntries;
+  std::vector<std::uint32_t> mSortKeys;
+  std::vector<std::uint32_t> mBucketOffsets;
+};
+
+}
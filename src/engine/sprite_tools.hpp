@@ -39,13 +39,34 @@ inline components::BoundingBox inferBoundingBox(
 }
 
 
+inline void precomputeFrameBoundingBoxes(SpriteDrawData& drawData) {
+  drawData.mFrameBoundingBoxes.clear();
+  drawData.mFrameBoundingBoxes.reserve(drawData.mFrames.size());
+  for (const auto& frame : drawData.mFrames) {
+    drawData.mFrameBoundingBoxes.push_back(inferBoundingBox(frame));
+  }
+}
+
+
+inline components::BoundingBox frameBoundingBox(
+  const SpriteDrawData& drawData,
+  const int realFrame
+) {
+  if (realFrame < int(drawData.mFrameBoundingBoxes.size())) {
+    return drawData.mFrameBoundingBoxes[realFrame];
+  }
+
+  return inferBoundingBox(drawData.mFrames[realFrame]);
+}
+
+
 inline components::BoundingBox inferBoundingBox(
   const components::Sprite& sprite,
   entityx::Entity entity
 ) {
   const auto realFrame = virtualToRealFrame(
     0, *sprite.mpDrawData, entity);
-  return inferBoundingBox(sprite.mpDrawData->mFrames[realFrame]);
+  return frameBoundingBox(*sprite.mpDrawData, realFrame);
 }
 
 
@@ -60,7 +81,7 @@ inline void synchronizeBoundingBoxToSprite(
     sprite.mFramesToRender[renderSlot],
     *sprite.mpDrawData,
     entity);
-  bbox = inferBoundingBox(sprite.mpDrawData->mFrames[currentRealFrame]);
+  bbox = frameBoundingBox(*sprite.mpDrawData, currentRealFrame);
 }
 
 
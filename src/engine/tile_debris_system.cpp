@@ -0,0 +1,103 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tile_debris_system.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
+
+
+namespace rigel::engine {
+
+namespace {
+
+constexpr std::array<std::int8_t, 11> VERTICAL_MOVEMENT_SEQUENCE{
+  -3, -3, -2, -2, -1, 0, 0, 1, 2, 2, 3
+};
+
+constexpr auto LIFE_TIME = std::int16_t{80};
+
+
+template <typename T>
+void eraseFront(std::vector<T>& vec, const std::size_t count) {
+  vec.erase(vec.begin(), std::next(vec.begin(), count));
+}
+
+}
+
+
+void TileDebrisSystem::spawn(
+  const base::Vector& position,
+  const data::map::TileIndex tileIndex,
+  const int velocityX,
+  const int sequenceOffset
+) {
+  assert(
+    sequenceOffset >= 0 &&
+    sequenceOffset < int(VERTICAL_MOVEMENT_SEQUENCE.size()));
+
+  mPositions.push_back(position);
+  mTileIndices.push_back(tileIndex);
+  mVelocitiesX.push_back(static_cast<std::int8_t>(velocityX));
+  mSequenceSteps.push_back(static_cast<std::uint8_t>(sequenceOffset));
+  mFramesToLive.push_back(LIFE_TIME);
+}
+
+
+void TileDebrisSystem::update() {
+  const auto lastStep = std::uint8_t(VERTICAL_MOVEMENT_SEQUENCE.size() - 1);
+
+  for (std::size_t i = 0; i < mPositions.size(); ++i) {
+    // Once the sequence is over, pieces keep moving with its last velocity
+    auto& step = mSequenceSteps[i];
+    const auto velocityY = VERTICAL_MOVEMENT_SEQUENCE[std::min(step, lastStep)];
+    if (step <= lastStep) {
+      ++step;
+    }
+
+    mPositions[i].x += mVelocitiesX[i];
+    mPositions[i].y += velocityY;
+    --mFramesToLive[i];
+  }
+
+  const auto numExpired = static_cast<std::size_t>(std::distance(
+    mFramesToLive.begin(),
+    std::find_if(
+      mFramesToLive.begin(),
+      mFramesToLive.end(),
+      [](const std::int16_t framesToLive) { return framesToLive >= 0; })));
+
+  if (numExpired > 0) {
+    eraseFront(mPositions, numExpired);
+    eraseFront(mTileIndices, numExpired);
+    eraseFront(mVelocitiesX, numExpired);
+    eraseFront(mSequenceSteps, numExpired);
+    eraseFront(mFramesToLive, numExpired);
+  }
+}
+
+
+void TileDebrisSystem::clear() {
+  mPositions.clear();
+  mTileIndices.clear();
+  mVelocitiesX.clear();
+  mSequenceSteps.clear();
+  mFramesToLive.clear();
+}
+
+}
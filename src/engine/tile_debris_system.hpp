@@ -0,0 +1,78 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "data/tile_attributes.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Pieces of map geometry flying away after a section was destroyed
+ *
+ * Exploding a wall turns each of its tiles into a piece of debris. This
+ * used to be done with one entity per tile, but a big section can produce
+ * hundreds of them at once. Their behavior is completely fixed, so they are
+ * simulated here instead, in the style of the ParticleSystem.
+ *
+ * Each piece moves by a constant horizontal velocity, and a vertical
+ * velocity taken from a fixed sequence, ignoring collisions. It disappears
+ * after a fixed amount of time. Should be updated once per game logic tick,
+ * after physics, which gives the same motion and timing as the entity
+ * based implementation had.
+ *
+ * Since all pieces have the same life time, they expire in the order they
+ * were spawned. Data is kept in parallel arrays in that order, so removing
+ * expired pieces always means dropping a prefix.
+ */
+class TileDebrisSystem {
+public:
+  void spawn(
+    const base::Vector& position,
+    data::map::TileIndex tileIndex,
+    int velocityX,
+    int sequenceOffset);
+
+  void update();
+
+  /** Remove all pieces, for restarting a level */
+  void clear();
+
+  std::size_t size() const {
+    return mPositions.size();
+  }
+
+  /** Invoke func(tileIndex, position) for each piece, in spawn order */
+  template <typename Func>
+  void forEach(Func&& func) const {
+    for (std::size_t i = 0; i < mPositions.size(); ++i) {
+      func(mTileIndices[i], mPositions[i]);
+    }
+  }
+
+private:
+  std::vector<base::Vector> mPositions;
+  std::vector<data::map::TileIndex> mTileIndices;
+  std::vector<std::int8_t> mVelocitiesX;
+  std::vector<std::uint8_t> mSequenceSteps;
+  std::vector<std::int16_t> mFramesToLive;
+};
+
+}
@@ -30,7 +30,16 @@ using namespace renderer;
 TiledTexture::TiledTexture(OwningTexture&& tileSet, Renderer* pRenderer)
   : mTileSetTexture(std::move(tileSet))
   , mpRenderer(pRenderer)
+  , mTilesPerRow(data::pixelsToTiles(mTileSetTexture.width()))
 {
+  const auto numRows = data::pixelsToTiles(mTileSetTexture.height());
+  mTileOrigins.reserve(mTilesPerRow * numRows);
+
+  for (int row = 0; row < numRows; ++row) {
+    for (int col = 0; col < mTilesPerRow; ++col) {
+      mTileOrigins.push_back(tileVectorToPixelVector({col, row}));
+    }
+  }
 }
 
 
@@ -76,8 +85,25 @@ void TiledTexture::renderTileDoubleQuad(
 }
 
 
+void TiledTexture::renderTiles(const base::ArrayView<TileDraw> tiles) const {
+  mQuadBuffer.clear();
+
+  for (const auto& tile : tiles) {
+    const auto sourceRect = this->sourceRect(
+      tile.mIndex, tile.mSpan.width, tile.mSpan.height);
+    mQuadBuffer.push_back(
+      {sourceRect, {tileVectorToPixelVector(tile.mPosition), sourceRect.size}});
+  }
+
+  mpRenderer->drawTextures(
+    mTileSetTexture.data(),
+    {mQuadBuffer.data(),
+     base::ArrayView<Renderer::TexturedQuad>::size_type(mQuadBuffer.size())});
+}
+
+
 int TiledTexture::tilesPerRow() const {
-  return data::pixelsToTiles(mTileSetTexture.width());
+  return mTilesPerRow;
 }
 
 
@@ -100,13 +126,15 @@ base::Rect<int> TiledTexture::sourceRect(
   const int tileSpanX,
   const int tileSpanY
 ) const {
-  const base::Vector tileSetStartPosition{
-    index % tilesPerRow(),
-    index / tilesPerRow()};
-  return {
-    tileVectorToPixelVector(tileSetStartPosition),
-    tileExtentsToPixelExtents({tileSpanX, tileSpanY})
-  };
+  assert(index >= 0);
+
+  // Indices past the end of the table refer to positions below the tile
+  // set's texture
+  const auto origin = index < int(mTileOrigins.size())
+    ? mTileOrigins[index]
+    : tileVectorToPixelVector({index % mTilesPerRow, index / mTilesPerRow});
+
+  return {origin, tileExtentsToPixelExtents({tileSpanX, tileSpanY})};
 }
 
 }
@@ -0,0 +1,168 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+
+namespace rigel::engine {
+
+TraceRecorder::TraceRecorder()
+  : mOrigin(Clock::now())
+{
+}
+
+
+void TraceRecorder::setEnabled(const bool enabled) {
+  if (enabled) {
+    std::lock_guard<std::mutex> guard(mMutex);
+    mZones.reserve(CAPACITY);
+  }
+
+  mIsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+void TraceRecorder::addZone(
+  const char* pName,
+  const Clock::time_point start,
+  const Clock::time_point end
+) {
+  record(Zone{pName, std::this_thread::get_id(), start, end, 0, Kind::Zone});
+}
+
+
+void TraceRecorder::addInstant(
+  const char* pName,
+  const Clock::time_point time
+) {
+  record(
+    Zone{pName, std::this_thread::get_id(), time, time, 0, Kind::Instant});
+}
+
+
+void TraceRecorder::addCounter(
+  const char* pName,
+  const Clock::time_point time,
+  const std::int64_t value
+) {
+  record(
+    Zone{pName, std::this_thread::get_id(), time, time, value, Kind::Counter});
+}
+
+
+void TraceRecorder::record(const Zone& zone) {
+  std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    mNumDroppedZones.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (mZones.size() < CAPACITY) {
+    mZones.push_back(zone);
+  } else {
+    mZones[mNextIndex] = zone;
+  }
+
+  mNextIndex = (mNextIndex + 1) % CAPACITY;
+}
+
+
+void TraceRecorder::writeChromeTrace(std::ostream& stream) const {
+  writeChromeTrace(stream, Clock::time_point::min(), {});
+}
+
+
+void TraceRecorder::writeChromeTrace(
+  std::ostream& stream,
+  const Clock::time_point since,
+  const std::vector<std::pair<std::string, std::string>>& metadata
+) const {
+  using std::chrono::duration;
+
+  std::lock_guard<std::mutex> guard(mMutex);
+
+  // Chrome wants small integers as thread ids, so we number threads in
+  // order of appearance
+  std::vector<std::thread::id> threads;
+  auto threadNumber = [&](const std::thread::id id) {
+    const auto it = std::find(threads.begin(), threads.end(), id);
+    if (it != threads.end()) {
+      return std::distance(threads.begin(), it) + 1;
+    }
+
+    threads.push_back(id);
+    return static_cast<std::ptrdiff_t>(threads.size());
+  };
+
+  auto toUs = [this](const Clock::time_point time) {
+    return duration<double, std::micro>(time - mOrigin).count();
+  };
+
+  stream << "{\"traceEvents\":[";
+
+  // Once the buffer has wrapped around, the oldest zone is the one which
+  // will be overwritten next
+  const auto firstIndex = mZones.size() < CAPACITY ? 0 : mNextIndex;
+
+  auto pSeparator = "";
+  for (auto i = std::size_t{0}; i < mZones.size(); ++i) {
+    const auto& zone = mZones[(firstIndex + i) % mZones.size()];
+    if (zone.mEnd < since) {
+      continue;
+    }
+
+    stream
+      << pSeparator << "\n{\"name\":\"" << zone.mpName << "\",\"pid\":1"
+      << ",\"tid\":" << threadNumber(zone.mThreadId)
+      << ",\"ts\":" << toUs(zone.mStart);
+
+    switch (zone.mKind) {
+      case Kind::Zone:
+        stream
+          << ",\"ph\":\"X\",\"dur\":" << toUs(zone.mEnd) - toUs(zone.mStart);
+        break;
+
+      case Kind::Instant:
+        stream << ",\"ph\":\"i\",\"s\":\"g\"";
+        break;
+
+      case Kind::Counter:
+        stream << ",\"ph\":\"C\",\"args\":{\"value\":" << zone.mValue << '}';
+        break;
+    }
+
+    stream << '}';
+    pSeparator = ",";
+  }
+
+  stream
+    << "\n],\"otherData\":{\"droppedZones\":" << numDroppedZones();
+  for (const auto& [key, value] : metadata) {
+    stream << ",\"" << key << "\":\"" << value << '"';
+  }
+  stream << "}}\n";
+}
+
+
+TraceRecorder& traceRecorder() {
+  static TraceRecorder recorder;
+  return recorder;
+}
+
+}
@@ -0,0 +1,147 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace rigel::engine {
+
+/** Collects timed zones from all threads into a ring buffer
+ *
+ * Meant for correlating hitches across the main loop, game logic and audio
+ * threads. The most recent CAPACITY zones are kept, and can be written out in
+ * Chrome's trace event format (viewable in chrome://tracing, Perfetto, or
+ * converted for Tracy).
+ *
+ * While disabled, recording a zone costs a single atomic load. The audio
+ * thread must never block, so recording uses a try-lock, and zones are
+ * dropped (and counted) in case of contention.
+ *
+ * Besides zones, the recorder takes instant events (for things like cache
+ * evictions) and counter values (like draw calls per frame), which share
+ * the same ring buffer.
+ *
+ * Zone names must be string literals, or otherwise outlive the recorder.
+ */
+class TraceRecorder {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr auto CAPACITY = std::size_t{32768};
+
+  TraceRecorder();
+
+  void setEnabled(bool enabled);
+
+  bool isEnabled() const {
+    return mIsEnabled.load(std::memory_order_relaxed);
+  }
+
+  void addZone(
+    const char* pName,
+    Clock::time_point start,
+    Clock::time_point end);
+  void addInstant(const char* pName, Clock::time_point time);
+  void addCounter(
+    const char* pName,
+    Clock::time_point time,
+    std::int64_t value);
+
+  std::size_t numDroppedZones() const {
+    return mNumDroppedZones.load(std::memory_order_relaxed);
+  }
+
+  void writeChromeTrace(std::ostream& stream) const;
+
+  /** Write only what was recorded at or after the given time
+   *
+   * The given key/value pairs are added to the trace's "otherData" object.
+   */
+  void writeChromeTrace(
+    std::ostream& stream,
+    Clock::time_point since,
+    const std::vector<std::pair<std::string, std::string>>& metadata) const;
+
+private:
+  enum class Kind : std::uint8_t {
+    Zone,
+    Instant,
+    Counter
+  };
+
+  struct Zone {
+    const char* mpName;
+    std::thread::id mThreadId;
+    Clock::time_point mStart;
+    Clock::time_point mEnd;
+    std::int64_t mValue;
+    Kind mKind;
+  };
+
+  void record(const Zone& zone);
+
+  mutable std::mutex mMutex;
+  std::vector<Zone> mZones;
+  std::size_t mNextIndex = 0;
+  Clock::time_point mOrigin;
+  std::atomic<bool> mIsEnabled{false};
+  std::atomic<std::size_t> mNumDroppedZones{0};
+};
+
+
+/** The process-wide trace recorder */
+TraceRecorder& traceRecorder();
+
+
+/** Records a zone spanning the lifetime of the object */
+class TraceZone {
+public:
+  explicit TraceZone(const char* pName)
+    : mpName(pName)
+    , mIsActive(traceRecorder().isEnabled())
+  {
+    if (mIsActive) {
+      mStart = TraceRecorder::Clock::now();
+    }
+  }
+
+  ~TraceZone() {
+    if (mIsActive) {
+      traceRecorder().addZone(mpName, mStart, TraceRecorder::Clock::now());
+    }
+  }
+
+  TraceZone(const TraceZone&) = delete;
+  TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+  const char* mpName;
+  TraceRecorder::Clock::time_point mStart;
+  bool mIsActive;
+};
+
+}
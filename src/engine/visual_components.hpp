@@ -18,17 +18,20 @@
 
 #include "base/array_view.hpp"
 #include "base/spatial_types.hpp"
+#include "base/static_vector.hpp"
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
 #include "engine/timing.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/texture.hpp"
+#include "renderer/texture_atlas.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
 #include <optional>
+#include <type_traits>
 #include <vector>
 
 
@@ -37,21 +40,29 @@ namespace rigel::engine {
 struct SpriteFrame {
   SpriteFrame() = default;
   SpriteFrame(
-    renderer::OwningTexture image,
+    renderer::AtlasTexture image,
     base::Vector drawOffset
   )
-    : mImage(std::move(image))
+    : mImage(image)
     , mDrawOffset(drawOffset)
   {
   }
 
-  renderer::OwningTexture mImage;
+  renderer::AtlasTexture mImage;
   base::Vector mDrawOffset;
 };
 
 
 struct SpriteDrawData {
   std::vector<SpriteFrame> mFrames;
+
+  /** Tile-space bounding box for each entry in mFrames
+   *
+   * Filled in once the frames' draw offsets are final, so that animating
+   * an entity's bounding box doesn't need to convert image extents on each
+   * frame change.
+   */
+  std::vector<components::BoundingBox> mFrameBoundingBoxes;
   base::ArrayView<int> mVirtualToRealFrameMap;
   std::optional<int> mOrientationOffset;
   int mDrawOrder;
@@ -72,12 +83,26 @@ void drawSpriteFrame(
   renderer::Renderer* pRenderer);
 
 
+constexpr auto MAX_RENDER_SLOTS = std::size_t{8};
+
+using FramesToRender = base::StaticVector<int, MAX_RENDER_SLOTS>;
+
+
 namespace components {
 
+/** Renderable sprite
+ *
+ * The draw data is shared between all sprites of the same actor type and
+ * never modified. Each render slot selects one of its frames for drawing.
+ * Sprites don't own any heap memory and can be copied freely.
+ */
 struct Sprite {
   Sprite() = default;
-  Sprite(const SpriteDrawData* pDrawData, std::vector<int> framesToRender)
-    : mFramesToRender(std::move(framesToRender))
+  Sprite(
+    const SpriteDrawData* pDrawData,
+    const FramesToRender& framesToRender
+  )
+    : mFramesToRender(framesToRender)
     , mpDrawData(pDrawData)
   {
   }
@@ -86,13 +111,15 @@ struct Sprite {
     mFlashingWhite = true;
   }
 
-  std::vector<int> mFramesToRender;
+  FramesToRender mFramesToRender;
   const SpriteDrawData* mpDrawData = nullptr;
   bool mFlashingWhite = false;
   bool mTranslucent = false;
   bool mShow = true;
 };
 
+static_assert(std::is_trivially_copyable_v<Sprite>);
+
 
 /** Specify a custom rendering function for a sprite
  *
@@ -0,0 +1,54 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actor_tag_counter.hpp"
+
+#include <cassert>
+
+
+namespace ex = entityx;
+
+namespace rigel::game_logic {
+
+using components::ActorTag;
+
+
+ActorTagCounter::ActorTagCounter(ex::EventManager& events) {
+  events.subscribe<ex::ComponentAddedEvent<ActorTag>>(*this);
+  events.subscribe<ex::ComponentRemovedEvent<ActorTag>>(*this);
+}
+
+
+int ActorTagCounter::count(const ActorTag::Type type) const {
+  return mCounts[static_cast<int>(type)];
+}
+
+
+void ActorTagCounter::receive(const ex::ComponentAddedEvent<ActorTag>& event) {
+  ++mCounts[static_cast<int>(event.component->mType)];
+}
+
+
+void ActorTagCounter::receive(
+  const ex::ComponentRemovedEvent<ActorTag>& event
+) {
+  auto& count = mCounts[static_cast<int>(event.component->mType)];
+  assert(count > 0);
+  --count;
+}
+
+}
@@ -0,0 +1,55 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/warnings.hpp"
+#include "game_logic/actor_tag.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <array>
+
+
+namespace rigel::game_logic {
+
+/** Keeps track of how many entities with each type of ActorTag exist
+ *
+ * Counts are updated as tags are added and removed, so querying them
+ * doesn't require going through all entities.
+ */
+class ActorTagCounter : public entityx::Receiver<ActorTagCounter> {
+public:
+  explicit ActorTagCounter(entityx::EventManager& events);
+
+  int count(components::ActorTag::Type type) const;
+
+  void receive(
+    const entityx::ComponentAddedEvent<components::ActorTag>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::ActorTag>& event);
+
+private:
+  static constexpr auto NUM_TYPES =
+    static_cast<int>(components::ActorTag::Type::FireBomb) + 1;
+
+  std::array<int, NUM_TYPES> mCounts{};
+};
+
+}
@@ -23,8 +23,11 @@ RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
-#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <new>
 #include <type_traits>
+#include <utility>
 
 namespace rigel::engine::events {
   struct CollidedWithWorld;
@@ -146,29 +149,110 @@ behaviorControllerOnCollision(
 }
 
 
+/** Type-erased wrapper for behavior controller types
+ *
+ * Controllers are small, so they are normally stored inline instead of
+ * being allocated separately. This keeps their state inside the component
+ * pool, next to the state of other controllers. Types which don't fit are
+ * stored on the heap.
+ *
+ * Copying a BehaviorController copies the wrapped controller. Moving leaves
+ * the source empty. An empty BehaviorController can be copied, moved,
+ * assigned to and destroyed, but not used otherwise.
+ *
+ * Behaviors which spend a while just counting down a timer can put
+ * themselves to sleep via sleepBehaviorController(). Their update() is then
+ * skipped until the given number of updates has passed, without going
+ * through the wrapped controller at all. Event handlers like onHit() are
+ * still invoked while sleeping. The remaining sleep time is part of the
+ * component, so it's saved and restored with entity snapshots.
+ */
 class BehaviorController {
 public:
   template<typename T>
-  explicit BehaviorController(T controller)
-    : mpSelf(std::make_shared<Model<T>>(std::move(controller)))
+  explicit BehaviorController(T controller) {
+    if constexpr (fitsInline<T>()) {
+      mpSelf = new (&mStorage) Model<T>(std::move(controller));
+    } else {
+      mpSelf = new Model<T>(std::move(controller));
+    }
+  }
+
+  BehaviorController(const BehaviorController& other)
+    : mpSelf(other.mpSelf ? other.mpSelf->copyInto(&mStorage) : nullptr)
+    , mNumUpdatesToSkip(other.mNumUpdatesToSkip)
   {
   }
 
+  BehaviorController(BehaviorController&& other) noexcept
+    : mNumUpdatesToSkip(other.mNumUpdatesToSkip)
+  {
+    takeFrom(other);
+  }
+
+  BehaviorController& operator=(const BehaviorController& other) {
+    if (this != &other) {
+      destroy();
+      mpSelf = other.mpSelf ? other.mpSelf->copyInto(&mStorage) : nullptr;
+      mNumUpdatesToSkip = other.mNumUpdatesToSkip;
+    }
+    return *this;
+  }
+
+  BehaviorController& operator=(BehaviorController&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      takeFrom(other);
+      mNumUpdatesToSkip = other.mNumUpdatesToSkip;
+    }
+    return *this;
+  }
+
+  ~BehaviorController() {
+    destroy();
+  }
+
+  /** True if this has been moved from */
+  bool isEmpty() const {
+    return mpSelf == nullptr;
+  }
+
   void update(
     GlobalDependencies& dependencies,
     GlobalState& state,
     const bool isOnScreen,
     entityx::Entity entity
   ) {
+    if (mNumUpdatesToSkip > 0) {
+      --mNumUpdatesToSkip;
+      return;
+    }
+
+    assert(mpSelf);
     mpSelf->update(dependencies, state, isOnScreen, entity);
   }
 
+  /** Skip the next numUpdates calls to update() */
+  void sleepFor(const int numUpdates) {
+    mNumUpdatesToSkip = numUpdates;
+  }
+
+  /** Resume calling update() right away, e.g. from an event handler */
+  void wakeUp() {
+    mNumUpdatesToSkip = 0;
+  }
+
+  bool isSleeping() const {
+    return mNumUpdatesToSkip > 0;
+  }
+
   void onHit(
     GlobalDependencies& dependencies,
     GlobalState& state,
     const base::Point<float>& inflictorVelocity,
     entityx::Entity entity
   ) {
+    assert(mpSelf);
     mpSelf->onHit(dependencies, state, inflictorVelocity, entity);
   }
 
@@ -178,6 +262,7 @@ public:
     const base::Point<float>& inflictorVelocity,
     entityx::Entity entity
   ) {
+    assert(mpSelf);
     mpSelf->onKilled(dependencies, state, inflictorVelocity, entity);
   }
 
@@ -187,19 +272,41 @@ public:
     const engine::events::CollidedWithWorld& event,
     entityx::Entity entity
   ) {
+    assert(mpSelf);
     mpSelf->onCollision(dependencies, state, event, entity);
   }
 
   template<typename T>
   T& get() {
-    auto pSelf = mpSelf.get();
-    return dynamic_cast<Model<T>*>(pSelf)->mData;
+    assert(mpSelf);
+    return dynamic_cast<Model<T>*>(mpSelf)->mData;
   }
 
 private:
+  static constexpr auto INLINE_STORAGE_SIZE = std::size_t{64};
+  using Storage = std::aligned_storage_t<
+    INLINE_STORAGE_SIZE,
+    alignof(std::max_align_t)>;
+
+  template <typename T>
+  static constexpr bool fitsInline();
+
   struct Concept {
     virtual ~Concept() = default;
 
+    /** Create a copy in the given inline storage, or on the heap */
+    virtual Concept* copyInto(Storage* pStorage) const = 0;
+
+    /** Move into the given inline storage
+     *
+     * Heap-allocated controllers don't need to be moved, they return
+     * themselves instead to indicate that ownership should be transferred.
+     */
+    virtual Concept* moveInto(Storage* pStorage) = 0;
+
+    /** Destroy the controller, freeing heap storage if necessary */
+    virtual void destroy() = 0;
+
     virtual void update(
       GlobalDependencies& dependencies,
       GlobalState& state,
@@ -232,6 +339,30 @@ private:
     {
     }
 
+    Concept* copyInto(Storage* pStorage) const override {
+      if constexpr (fitsInline<T>()) {
+        return new (pStorage) Model(*this);
+      } else {
+        return new Model(*this);
+      }
+    }
+
+    Concept* moveInto(Storage* pStorage) override {
+      if constexpr (fitsInline<T>()) {
+        return new (pStorage) Model(std::move(*this));
+      } else {
+        return this;
+      }
+    }
+
+    void destroy() override {
+      if constexpr (fitsInline<T>()) {
+        this->~Model();
+      } else {
+        delete this;
+      }
+    }
+
     void update(
       GlobalDependencies& dependencies,
       GlobalState& state,
@@ -286,7 +417,57 @@ private:
     T mData;
   };
 
-  std::shared_ptr<Concept> mpSelf;
+  void destroy() {
+    if (mpSelf) {
+      mpSelf->destroy();
+      mpSelf = nullptr;
+    }
+  }
+
+  /** Take over other's controller, leaving other empty
+   *
+   * Expects this to be empty already.
+   */
+  void takeFrom(BehaviorController& other) noexcept {
+    if (!other.mpSelf) {
+      mpSelf = nullptr;
+      return;
+    }
+
+    mpSelf = other.mpSelf->moveInto(&mStorage);
+    if (mpSelf == other.mpSelf) {
+      // Heap-allocated, ownership was transferred
+      other.mpSelf = nullptr;
+    } else {
+      other.destroy();
+    }
+  }
+
+  Storage mStorage;
+  Concept* mpSelf = nullptr;
+  int mNumUpdatesToSkip = 0;
 };
 
+
+template <typename T>
+constexpr bool BehaviorController::fitsInline() {
+  return
+    sizeof(Model<T>) <= sizeof(Storage) &&
+    alignof(Model<T>) <= alignof(Storage) &&
+    std::is_nothrow_move_constructible_v<T>;
+}
+
+
+/** Put the behavior controller of the given entity to sleep
+ *
+ * To be called by behaviors from within their update(). See
+ * BehaviorController::sleepFor().
+ */
+inline void sleepBehaviorController(
+  entityx::Entity entity,
+  const int numUpdates
+) {
+  entity.component<BehaviorController>()->sleepFor(numUpdates);
+}
+
 }
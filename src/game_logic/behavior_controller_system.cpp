@@ -18,6 +18,7 @@
 
 #include "common/global.hpp"
 #include "engine/base_components.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/physical_components.hpp"
 #include "game_logic/behavior_controller.hpp"
 
@@ -27,14 +28,18 @@ namespace rigel::game_logic {
 BehaviorControllerSystem::BehaviorControllerSystem(
   GlobalDependencies dependencies,
   Player* pPlayer,
+  PlayerPerception* pPlayerPerception,
   const base::Vector* pCameraPosition,
-  data::map::Map* pMap
+  data::map::Map* pMap,
+  const data::ViewPortSize* pViewPortSize
 )
   : mDependencies(dependencies)
   , mGlobalState(
       pPlayer,
+      pPlayerPerception,
       pCameraPosition,
       pMap,
+      pViewPortSize,
       &mPerFrameState)
 {
   mDependencies.mpEvents->subscribe<events::ShootableDamaged>(*this);
@@ -75,10 +80,7 @@ void BehaviorControllerSystem::receive(const events::ShootableDamaged& event) {
   using game_logic::components::BehaviorController;
 
   auto entity = event.mEntity;
-  if (
-    entity.has_component<BehaviorController>() &&
-    entity.has_component<Active>()
-  ) {
+  if (engine::hasAllComponents<BehaviorController, Active>(entity)) {
     entity.component<BehaviorController>()->onHit(
       mDependencies,
       mGlobalState,
@@ -93,10 +95,7 @@ void BehaviorControllerSystem::receive(const events::ShootableKilled& event) {
   using game_logic::components::BehaviorController;
 
   auto entity = event.mEntity;
-  if (
-    entity.has_component<BehaviorController>() &&
-    entity.has_component<Active>()
-  ) {
+  if (engine::hasAllComponents<BehaviorController, Active>(entity)) {
     entity.component<BehaviorController>()->onKilled(
       mDependencies,
       mGlobalState,
@@ -113,10 +112,7 @@ void BehaviorControllerSystem::receive(
   using game_logic::components::BehaviorController;
 
   auto entity = event.mEntity;
-  if (
-    entity.has_component<BehaviorController>() &&
-    entity.has_component<Active>()
-  ) {
+  if (engine::hasAllComponents<BehaviorController, Active>(entity)) {
     entity.component<BehaviorController>()->onCollision(
       mDependencies,
       mGlobalState,
@@ -38,8 +38,10 @@ public:
   explicit BehaviorControllerSystem(
     GlobalDependencies dependencies,
     Player* pPlayer,
+    PlayerPerception* pPlayerPerception,
     const base::Vector* pCameraPosition,
-    data::map::Map* pMap);
+    data::map::Map* pMap,
+    const data::ViewPortSize* pViewPortSize);
 
   void update(
     entityx::EntityManager& es,
@@ -83,12 +83,14 @@ base::Rect<int> deadZoneRect(const Player& player) {
 
 base::Vector offsetToDeadZone(
   const Player& player,
-  const base::Vector& cameraPosition
+  const base::Vector& cameraPosition,
+  const int deadZoneOffsetX
 ) {
   const auto playerBounds = player.worldSpaceCollisionBox();
 
   auto worldSpaceDeadZone = deadZoneRect(player);
-  worldSpaceDeadZone.topLeft += cameraPosition;
+  worldSpaceDeadZone.topLeft +=
+    cameraPosition + base::Vector{deadZoneOffsetX, 0};
 
   // horizontal
   const auto offsetLeft =
@@ -115,12 +117,17 @@ base::Vector offsetToDeadZone(
 Camera::Camera(
   const Player* pPlayer,
   const data::map::Map& map,
+  const data::ViewPortSize& viewPortSize,
   entityx::EventManager& eventManager
 )
   : mpPlayer(pPlayer)
   , mMaxPosition(base::Extents{
-    static_cast<int>(map.width() - data::GameTraits::mapViewPortWidthTiles),
-    static_cast<int>(map.height() - data::GameTraits::mapViewPortHeightTiles)})
+    std::max(0, map.width() - viewPortSize.mapViewPortSize().width),
+    std::max(0, map.height() - viewPortSize.mapViewPortSize().height)})
+  // With a wider view, the dead zone stays in the middle of the screen
+  , mDeadZoneOffsetX(
+      (viewPortSize.mapViewPortSize().width -
+        data::GameTraits::mapViewPortWidthTiles) / 2)
 {
   eventManager.subscribe<rigel::events::PlayerFiredShot>(*this);
 }
@@ -155,7 +162,8 @@ void Camera::updateManualScrolling(const PlayerInput& input) {
 
 
 void Camera::updateAutomaticScrolling() {
-  const auto [offsetX, offsetY] = offsetToDeadZone(*mpPlayer, mPosition);
+  const auto [offsetX, offsetY] =
+    offsetToDeadZone(*mpPlayer, mPosition, mDeadZoneOffsetX);
 
   const auto maxAdjustDown = mpPlayer->isRidingElevator()
     ? MAX_ADJUST_DOWN_ELEVATOR
@@ -176,7 +184,7 @@ void Camera::setPosition(const base::Vector position) {
 
 
 void Camera::centerViewOnPlayer() {
-  setPosition(offsetToDeadZone(*mpPlayer, {}));
+  setPosition(offsetToDeadZone(*mpPlayer, {}, mDeadZoneOffsetX));
 }
 
 
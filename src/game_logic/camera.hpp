@@ -26,6 +26,7 @@ RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+namespace rigel::data { struct ViewPortSize; }
 namespace rigel::data::map { class Map; }
 namespace rigel::events { struct PlayerFiredShot; }
 
@@ -40,6 +41,7 @@ public:
   Camera(
     const Player* pPlayer,
     const data::map::Map& map,
+    const data::ViewPortSize& viewPortSize,
     entityx::EventManager& eventManager);
 
   void update(const PlayerInput& input);
@@ -57,6 +59,7 @@ private:
   const Player* mpPlayer;
   base::Vector mPosition;
   base::Extents mMaxPosition;
+  int mDeadZoneOffsetX;
   int mManualScrollCooldown = 0;
 };
 
@@ -22,6 +22,9 @@
 #include "engine/physical_components.hpp"
 #include "engine/visual_components.hpp"
 
+#include <algorithm>
+#include <optional>
+
 
 namespace rigel::game_logic {
 
@@ -39,6 +42,10 @@ using game_logic::components::Shootable;
 
 namespace {
 
+// Shootables wider than this (in tiles) don't go into the sorted index
+constexpr auto MAX_INDEXED_SHOOTABLE_WIDTH = 8;
+
+
 auto extractVelocity(entityx::Entity entity) {
   return entity.has_component<MovingBody>()
     ? entity.component<MovingBody>()->mVelocity
@@ -56,11 +63,15 @@ DamageInflictionSystem::DamageInflictionSystem(
   : mpPlayerModel(pPlayerModel)
   , mpServiceProvider(pServiceProvider)
   , mpEvents(pEvents)
+  , mShootables(*pEvents)
 {
+  mpEvents->subscribe<ex::ComponentAddedEvent<Shootable>>(*this);
 }
 
 
 void DamageInflictionSystem::update(ex::EntityManager& es) {
+  mShootableIndexOutdated = true;
+
   es.each<DamageInflicting, WorldPosition, BoundingBox>(
     [this, &es](
       ex::Entity inflictorEntity,
@@ -70,28 +81,48 @@ void DamageInflictionSystem::update(ex::EntityManager& es) {
     ) {
       const auto inflictorBbox = engine::toWorldSpace(bbox, inflictorPosition);
 
-      ex::ComponentHandle<Shootable> shootable;
-      ex::ComponentHandle<WorldPosition> shootablePos;
-      ex::ComponentHandle<BoundingBox> shootableBboxLocal;
-      for (auto shootableEntity : es.entities_with_components(
-        shootable, shootablePos, shootableBboxLocal)
-      ) {
-        const auto shootableBbox =
-          engine::toWorldSpace(*shootableBboxLocal, *shootablePos);
-
-        const auto shootableOnScreen =
-          shootableEntity.has_component<Active>() &&
-          shootableEntity.component<Active>()->mIsOnScreen;
-
-        if (
-          shootableBbox.intersects(inflictorBbox) &&
-          !shootable->mInvincible &&
-          (shootableOnScreen || shootable->mCanBeHitWhenOffscreen)
-        ) {
-          const auto destroyOnContact = damage.mDestroyOnContact ||
-            shootable->mAlwaysConsumeInflictor;
-          inflictDamage(inflictorEntity, damage, shootableEntity, *shootable);
-          if (destroyOnContact) {
+      // Shootables are visited in order of entity index, the same order as
+      // when iterating over all entities. Entities created while handling
+      // this inflictor (e.g. items dropped by a destroyed container) are
+      // left for the next one, except when they reuse an index which comes
+      // after the last hit.
+      const auto indexLimit = es.capacity();
+      std::optional<std::uint32_t> lastHitIndex;
+
+      auto hitFound = true;
+      while (hitFound) {
+        hitFound = false;
+
+        updateShootableIndex(es);
+        collectCandidates(inflictorBbox);
+
+        for (const auto& candidate : mCandidates) {
+          auto shootableEntity = candidate.mEntity;
+          const auto index = shootableEntity.id().index();
+          if (index >= indexLimit || (lastHitIndex && index <= *lastHitIndex)) {
+            continue;
+          }
+
+          auto& shootable = *shootableEntity.component<Shootable>();
+          const auto shootableOnScreen =
+            shootableEntity.has_component<Active>() &&
+            shootableEntity.component<Active>()->mIsOnScreen;
+
+          if (
+            !shootable.mInvincible &&
+            (shootableOnScreen || shootable.mCanBeHitWhenOffscreen)
+          ) {
+            const auto destroyOnContact = damage.mDestroyOnContact ||
+              shootable.mAlwaysConsumeInflictor;
+            inflictDamage(inflictorEntity, damage, shootableEntity, shootable);
+            if (destroyOnContact) {
+              return;
+            }
+
+            // The hit might have changed other shootables, so look for the
+            // next one using an up to date index
+            lastHitIndex = index;
+            hitFound = true;
             break;
           }
         }
@@ -100,6 +131,133 @@ void DamageInflictionSystem::update(ex::EntityManager& es) {
 }
 
 
+void DamageInflictionSystem::receive(
+  const ex::ComponentAddedEvent<Shootable>&
+) {
+  mShootableIndexOutdated = true;
+}
+
+
+void DamageInflictionSystem::updateShootableIndex(ex::EntityManager& es) {
+  if (
+    !mShootableIndexOutdated &&
+    mShootablesMayHaveChanged &&
+    !isShootableIndexCurrent()
+  ) {
+    mShootableIndexOutdated = true;
+  }
+
+  if (mShootableIndexOutdated) {
+    buildShootableIndex(es);
+  }
+
+  mShootablesMayHaveChanged = false;
+}
+
+
+void DamageInflictionSystem::buildShootableIndex(ex::EntityManager& es) {
+  ++mStatistics.mNumIndexRebuilds;
+  mShootablesByLeftEdge.clear();
+  mWideShootables.clear();
+  mMaxShootableWidth = 0;
+
+  mShootables.each(es, [&](
+    ex::Entity entity,
+    const Shootable&,
+    const WorldPosition& position,
+    const BoundingBox& bboxLocal
+  ) {
+    const auto bbox = engine::toWorldSpace(bboxLocal, position);
+    const auto info = ShootableInfo{entity, bbox};
+
+    if (bbox.size.width > MAX_INDEXED_SHOOTABLE_WIDTH) {
+      mWideShootables.push_back(info);
+    } else {
+      mShootablesByLeftEdge.push_back(info);
+      mMaxShootableWidth = std::max(mMaxShootableWidth, bbox.size.width);
+    }
+  });
+
+  std::sort(
+    begin(mShootablesByLeftEdge),
+    end(mShootablesByLeftEdge),
+    [](const ShootableInfo& lhs, const ShootableInfo& rhs) {
+      return lhs.mWorldSpaceBbox.left() < rhs.mWorldSpaceBbox.left();
+    });
+
+  mShootableIndexOutdated = false;
+}
+
+
+bool DamageInflictionSystem::isShootableIndexCurrent() const {
+  // All indexed entities still being shootables at the same place, with no
+  // other shootables around, means that the index is still accurate.
+  const auto numIndexed =
+    mShootablesByLeftEdge.size() + mWideShootables.size();
+  if (mShootables.size() != numIndexed) {
+    return false;
+  }
+
+  const auto isCurrent = [](const ShootableInfo& info) {
+    auto entity = info.mEntity;
+    return
+      entity.valid() &&
+      entity.has_component<Shootable>() &&
+      entity.has_component<WorldPosition>() &&
+      entity.has_component<BoundingBox>() &&
+      engine::toWorldSpace(
+        *entity.component<const BoundingBox>(),
+        *entity.component<const WorldPosition>()) == info.mWorldSpaceBbox;
+  };
+
+  return
+    std::all_of(
+      begin(mShootablesByLeftEdge), end(mShootablesByLeftEdge), isCurrent) &&
+    std::all_of(begin(mWideShootables), end(mWideShootables), isCurrent);
+}
+
+
+void DamageInflictionSystem::collectCandidates(const BoundingBox& bbox) {
+  mCandidates.clear();
+  ++mStatistics.mNumInflictors;
+
+  const auto firstPossibleLeft = bbox.left() - mMaxShootableWidth + 1;
+  auto it = std::lower_bound(
+    begin(mShootablesByLeftEdge),
+    end(mShootablesByLeftEdge),
+    firstPossibleLeft,
+    [](const ShootableInfo& info, const int left) {
+      return info.mWorldSpaceBbox.left() < left;
+    });
+
+  for (; it != end(mShootablesByLeftEdge); ++it) {
+    if (it->mWorldSpaceBbox.left() > bbox.right()) {
+      break;
+    }
+
+    ++mStatistics.mNumShootablesVisited;
+
+    if (it->mWorldSpaceBbox.intersects(bbox)) {
+      mCandidates.push_back(*it);
+    }
+  }
+
+  mStatistics.mNumShootablesVisited += mWideShootables.size();
+  for (const auto& info : mWideShootables) {
+    if (info.mWorldSpaceBbox.intersects(bbox)) {
+      mCandidates.push_back(info);
+    }
+  }
+
+  std::sort(
+    begin(mCandidates),
+    end(mCandidates),
+    [](const ShootableInfo& lhs, const ShootableInfo& rhs) {
+      return lhs.mEntity.id().index() < rhs.mEntity.id().index();
+    });
+}
+
+
 void DamageInflictionSystem::inflictDamage(
   entityx::Entity inflictorEntity,
   DamageInflicting& damage,
@@ -107,6 +265,8 @@ void DamageInflictionSystem::inflictDamage(
   Shootable& shootable
 ) {
   const auto inflictorVelocity = extractVelocity(inflictorEntity);
+  mShootablesMayHaveChanged = true;
+
   if (damage.mDestroyOnContact || shootable.mAlwaysConsumeInflictor) {
     inflictorEntity.destroy();
   } else {
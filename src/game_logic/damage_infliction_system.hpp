@@ -18,12 +18,17 @@
 
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
+#include "engine/packed_entity_view.hpp"
+#include "engine/physical_components.hpp"
 #include "game_logic/damage_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
+#include <vector>
+
 namespace rigel { struct IGameServiceProvider; }
 
 namespace rigel::data { class PlayerModel; }
@@ -31,7 +36,8 @@ namespace rigel::data { class PlayerModel; }
 
 namespace rigel::game_logic {
 
-class DamageInflictionSystem {
+class DamageInflictionSystem :
+  public entityx::Receiver<DamageInflictionSystem> {
 public:
   DamageInflictionSystem(
     data::PlayerModel* pPlayerModel,
@@ -40,7 +46,31 @@ public:
 
   void update(entityx::EntityManager& es);
 
+  void receive(
+    const entityx::ComponentAddedEvent<components::Shootable>& event);
+
+  /** Counts of work done by all updates so far, for performance tests */
+  struct Statistics {
+    std::uint64_t mNumInflictors = 0;
+    std::uint64_t mNumShootablesVisited = 0;
+    std::uint64_t mNumIndexRebuilds = 0;
+  };
+
+  const Statistics& statistics() const {
+    return mStatistics;
+  }
+
 private:
+  struct ShootableInfo {
+    entityx::Entity mEntity;
+    engine::components::BoundingBox mWorldSpaceBbox;
+  };
+
+  void updateShootableIndex(entityx::EntityManager& es);
+  void buildShootableIndex(entityx::EntityManager& es);
+  bool isShootableIndexCurrent() const;
+  void collectCandidates(const engine::components::BoundingBox& bbox);
+
   void inflictDamage(
     entityx::Entity inflictorEntity,
     components::DamageInflicting& damage,
@@ -50,6 +80,31 @@ private:
   data::PlayerModel* mpPlayerModel;
   IGameServiceProvider* mpServiceProvider;
   entityx::EventManager* mpEvents;
+
+  engine::PackedEntityView<
+    components::Shootable,
+    engine::components::WorldPosition,
+    engine::components::BoundingBox> mShootables;
+
+  // Broad phase for finding shootables overlapping an inflictor. Built on
+  // each update, sorted by left edge. Since no shootable is wider than
+  // mMaxShootableWidth, all candidates are found in a contiguous range.
+  //
+  // A single wide shootable, like a boss, would make that range large for
+  // every inflictor. Shootables above a certain width are therefore kept
+  // in mWideShootables instead, which is always tested in full. There are
+  // only ever a few of those.
+  //
+  // Reactions to a hit (event listeners) can move, resize, spawn or remove
+  // shootables. The index is therefore checked against the current state
+  // after each hit, and rebuilt if anything changed.
+  std::vector<ShootableInfo> mShootablesByLeftEdge;
+  std::vector<ShootableInfo> mWideShootables;
+  std::vector<ShootableInfo> mCandidates;
+  int mMaxShootableWidth = 0;
+  bool mShootableIndexOutdated = true;
+  bool mShootablesMayHaveChanged = false;
+  Statistics mStatistics;
 };
 
 }
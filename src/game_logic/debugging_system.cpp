@@ -36,12 +36,52 @@ using data::map::SolidEdge;
 
 namespace {
 
+// Extra tiles around the view port covered by the collision overlay cache
+constexpr auto COLLISION_OVERLAY_MARGIN = 8;
+
+enum OverlayLayer {
+  SolidEdges,
+  Climbable,
+  Ladder,
+  Flammable
+};
+
+
 struct SolidEdgeVisualizationInfo {
   data::map::SolidEdge mEdge;
   tuple<int, int, int, int> mCoordinates;
 };
 
 
+void addLine(
+  std::vector<base::Vector>& endPoints,
+  const int x1,
+  const int y1,
+  const int x2,
+  const int y2
+) {
+  endPoints.push_back({x1, y1});
+  endPoints.push_back({x2, y2});
+}
+
+
+// Same lines as Renderer::drawRectangle() draws
+void addRectangle(
+  std::vector<base::Vector>& endPoints,
+  const base::Rect<int>& rect
+) {
+  const auto left = rect.left();
+  const auto right = rect.right();
+  const auto top = rect.top();
+  const auto bottom = rect.bottom();
+
+  addLine(endPoints, left, top, left, bottom);
+  addLine(endPoints, left, bottom, right, bottom);
+  addLine(endPoints, right, bottom, right, top);
+  addLine(endPoints, right, top, left, top);
+}
+
+
 base::Color colorForEntity(entityx::Entity entity) {
   const auto isPlayerDamaging =
     entity.has_component<game_logic::components::PlayerDamaging>();
@@ -63,11 +103,18 @@ base::Color colorForEntity(entityx::Entity entity) {
 DebuggingSystem::DebuggingSystem(
   renderer::Renderer* pRenderer,
   const base::Vector* pCameraPos,
-  data::map::Map* pMap
+  data::map::Map* pMap,
+  const data::ViewPortSize& viewPortSize
 )
   : mpRenderer(pRenderer)
   , mpCameraPos(pCameraPos)
   , mpMap(pMap)
+  , mViewPortSize(viewPortSize.mapViewPortSize())
+  , mCollisionOverlay{{
+      {base::Color{255, 255, 0, 255}, {}},
+      {base::Color{255, 100, 255, 220}, {}},
+      {base::Color{0, 100, 255, 220}, {}},
+      {base::Color{255, 127, 0, 220}, {}}}}
 {
 }
 
@@ -89,59 +136,7 @@ void DebuggingSystem::toggleGridDisplay() {
 
 void DebuggingSystem::update(ex::EntityManager& es) {
   if (mShowWorldCollisionData) {
-    const auto drawColor = base::Color{255, 255, 0, 255};
-
-    for (int y=0; y<GameTraits::mapViewPortHeightTiles; ++y) {
-      for (int x=0; x<GameTraits::mapViewPortWidthTiles; ++x) {
-        const auto col = x + mpCameraPos->x;
-        const auto row = y + mpCameraPos->y;
-        if (col >= mpMap->width() || row >= mpMap->height()) {
-          continue;
-        }
-
-        const auto collisionData = mpMap->collisionData(col, row);
-        const auto topLeft = tileVectorToPixelVector({x, y});
-        const auto bottomRight = tileVectorToPixelVector({x + 1, y + 1});
-        const auto left = topLeft.x;
-        const auto top = topLeft.y;
-        const auto right = bottomRight.x;
-        const auto bottom = bottomRight.y;
-
-        const SolidEdgeVisualizationInfo visualizationInfos[] = {
-          {SolidEdge::top(),    make_tuple(left, top, right, top)},
-          {SolidEdge::right(),  make_tuple(right, top, right, bottom)},
-          {SolidEdge::bottom(), make_tuple(left, bottom, right, bottom)},
-          {SolidEdge::left(),   make_tuple(left, top, left, bottom)}
-        };
-
-        for (const auto& info : visualizationInfos) {
-          if (collisionData.isSolidOn(info.mEdge)) {
-            int x1, y1, x2, y2;
-            tie(x1, y1, x2, y2) = info.mCoordinates;
-            mpRenderer->drawLine(x1, y1, x2, y2, drawColor);
-          }
-        }
-
-        const auto isClimbable = mpMap->attributes(col, row).isClimbable();
-        const auto isLadder = mpMap->attributes(col, row).isLadder();
-        const auto isFlammable = mpMap->attributes(col, row).isFlammable();
-
-        if (isClimbable) {
-          auto tileBox = base::makeRect<int>(topLeft, bottomRight);
-          mpRenderer->drawRectangle(tileBox, base::Color(255, 100, 255, 220));
-        }
-
-        if (isLadder) {
-          auto tileBox = base::makeRect<int>(topLeft, bottomRight);
-          mpRenderer->drawRectangle(tileBox, base::Color(0, 100, 255, 220));
-        }
-
-        if (isFlammable) {
-          auto tileBox = base::makeRect<int>(topLeft, bottomRight);
-          mpRenderer->drawRectangle(tileBox, base::Color(255, 127, 0, 220));
-        }
-      }
-    }
+    drawCollisionOverlay();
   }
 
   if (mShowBoundingBoxes) {
@@ -178,21 +173,116 @@ void DebuggingSystem::update(ex::EntityManager& es) {
 
   if (mShowGrid) {
     const auto drawColor = base::Color{255, 255, 255, 190};
-    const auto maxX = tilesToPixels(GameTraits::mapViewPortWidthTiles);
-    const auto maxY = tilesToPixels(GameTraits::mapViewPortHeightTiles);
+    const auto maxX = tilesToPixels(mViewPortSize.width);
+    const auto maxY = tilesToPixels(mViewPortSize.height);
 
     // Horizontal lines
-    for (int y=0; y<GameTraits::mapViewPortHeightTiles; ++y) {
+    for (int y=0; y<mViewPortSize.height; ++y) {
       const auto pxY = tilesToPixels(y);
       mpRenderer->drawLine(0, pxY, maxX, pxY, drawColor);
     }
 
     // Vertical lines
-    for (int x=0; x<GameTraits::mapViewPortWidthTiles; ++x) {
+    for (int x=0; x<mViewPortSize.width; ++x) {
       const auto pxX = tilesToPixels(x);
       mpRenderer->drawLine(pxX, 0, pxX, maxY, drawColor);
     }
   }
 }
 
+
+void DebuggingSystem::drawCollisionOverlay() {
+  const auto visibleSection =
+    base::Rect<int>{*mpCameraPos, base::Size<int>{
+      mViewPortSize.width, mViewPortSize.height}};
+  const auto isUpToDate =
+    mCollisionOverlaySection &&
+    mCollisionOverlayRevision == mpMap->changeRevision() &&
+    mCollisionOverlaySection->containsPoint(visibleSection.topLeft) &&
+    mCollisionOverlaySection->containsPoint(visibleSection.bottomRight());
+
+  if (!isUpToDate) {
+    updateCollisionOverlay();
+  }
+
+  const auto worldToScreenPx = tileVectorToPixelVector(*mpCameraPos);
+  for (const auto& lines : mCollisionOverlay) {
+    mScreenSpaceEndPoints.clear();
+    for (const auto& point : lines.mEndPoints) {
+      mScreenSpaceEndPoints.push_back(point - worldToScreenPx);
+    }
+
+    mpRenderer->drawLines(
+      {mScreenSpaceEndPoints.data(),
+       base::ArrayView<base::Vector>::size_type(
+         mScreenSpaceEndPoints.size())},
+      lines.mColor);
+  }
+}
+
+
+void DebuggingSystem::updateCollisionOverlay() {
+  for (auto& lines : mCollisionOverlay) {
+    lines.mEndPoints.clear();
+  }
+
+  const auto section = base::Rect<int>{
+    *mpCameraPos -
+      base::Vector{COLLISION_OVERLAY_MARGIN, COLLISION_OVERLAY_MARGIN},
+    base::Size<int>{
+      mViewPortSize.width + COLLISION_OVERLAY_MARGIN * 2,
+      mViewPortSize.height + COLLISION_OVERLAY_MARGIN * 2}};
+
+  for (int row = section.top(); row <= section.bottom(); ++row) {
+    for (int col = section.left(); col <= section.right(); ++col) {
+      if (
+        col < 0 || row < 0 || col >= mpMap->width() || row >= mpMap->height()
+      ) {
+        continue;
+      }
+
+      const auto collisionData = mpMap->collisionData(col, row);
+      const auto topLeft = tileVectorToPixelVector({col, row});
+      const auto bottomRight = tileVectorToPixelVector({col + 1, row + 1});
+      const auto left = topLeft.x;
+      const auto top = topLeft.y;
+      const auto right = bottomRight.x;
+      const auto bottom = bottomRight.y;
+
+      const SolidEdgeVisualizationInfo visualizationInfos[] = {
+        {SolidEdge::top(),    make_tuple(left, top, right, top)},
+        {SolidEdge::right(),  make_tuple(right, top, right, bottom)},
+        {SolidEdge::bottom(), make_tuple(left, bottom, right, bottom)},
+        {SolidEdge::left(),   make_tuple(left, top, left, bottom)}
+      };
+
+      for (const auto& info : visualizationInfos) {
+        if (collisionData.isSolidOn(info.mEdge)) {
+          int x1, y1, x2, y2;
+          tie(x1, y1, x2, y2) = info.mCoordinates;
+          addLine(mCollisionOverlay[SolidEdges].mEndPoints, x1, y1, x2, y2);
+        }
+      }
+
+      const auto attributes = mpMap->attributes(col, row);
+      const auto tileBox = base::makeRect<int>(topLeft, bottomRight);
+
+      if (attributes.isClimbable()) {
+        addRectangle(mCollisionOverlay[Climbable].mEndPoints, tileBox);
+      }
+
+      if (attributes.isLadder()) {
+        addRectangle(mCollisionOverlay[Ladder].mEndPoints, tileBox);
+      }
+
+      if (attributes.isFlammable()) {
+        addRectangle(mCollisionOverlay[Flammable].mEndPoints, tileBox);
+      }
+    }
+  }
+
+  mCollisionOverlaySection = section;
+  mCollisionOverlayRevision = mpMap->changeRevision();
+}
+
 }
@@ -18,6 +18,7 @@
 
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
+#include "data/game_traits.hpp"
 #include "data/map.hpp"
 #include "renderer/renderer.hpp"
 
@@ -25,6 +26,11 @@ RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
 
 namespace rigel::game_logic {
 
@@ -33,7 +39,8 @@ public:
   DebuggingSystem(
     renderer::Renderer* pRenderer,
     const base::Vector* pCameraPos,
-    data::map::Map* pMap);
+    data::map::Map* pMap,
+    const data::ViewPortSize& viewPortSize);
 
   void toggleBoundingBoxDisplay();
   void toggleWorldCollisionDataDisplay();
@@ -42,9 +49,28 @@ public:
   void update(entityx::EntityManager& es);
 
 private:
+  struct OverlayLines {
+    base::Color mColor;
+
+    // Start and end point of each line, in world space pixels
+    std::vector<base::Vector> mEndPoints;
+  };
+
+  void drawCollisionOverlay();
+  void updateCollisionOverlay();
+
   renderer::Renderer* mpRenderer;
   const base::Vector* mpCameraPos;
   data::map::Map* mpMap;
+  base::Extents mViewPortSize;
+
+  // Walking the map for the collision overlay is costly, so the resulting
+  // lines are kept for a section somewhat larger than the view port. They
+  // are recreated once the view leaves the section or the map changes.
+  std::array<OverlayLines, 4> mCollisionOverlay;
+  std::vector<base::Vector> mScreenSpaceEndPoints;
+  std::optional<base::Rect<int>> mCollisionOverlaySection;
+  std::uint32_t mCollisionOverlayRevision = 0;
 
   bool mShowBoundingBoxes = false;
   bool mShowWorldCollisionData = false;
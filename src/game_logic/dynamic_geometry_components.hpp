@@ -32,11 +32,6 @@ struct MapGeometryLink {
   engine::components::BoundingBox mLinkedGeometrySection;
 };
 
-
-struct TileDebris {
-  data::map::TileIndex mTileIndex;
-};
-
 }
 
 namespace behaviors {
@@ -23,9 +23,8 @@
 #include "engine/base_components.hpp"
 #include "engine/collision_checker.hpp"
 #include "engine/entity_tools.hpp"
-#include "engine/life_time_components.hpp"
-#include "engine/physical_components.hpp"
 #include "engine/random_number_generator.hpp"
+#include "engine/tile_debris_system.hpp"
 #include "game_logic/actor_tag.hpp"
 #include "game_logic/behavior_controller.hpp"
 #include "game_logic/damage_components.hpp"
@@ -41,84 +40,32 @@ namespace {
 
 constexpr auto GEOMETRY_FALL_SPEED = 2;
 
-const base::Point<float> TILE_DEBRIS_MOVEMENT_SEQUENCE[] = {
-  {0.0f, -3.0f},
-  {0.0f, -3.0f},
-  {0.0f, -2.0f},
-  {0.0f, -2.0f},
-  {0.0f, -1.0f},
-  {0.0f, 0.0f},
-  {0.0f, 0.0f},
-  {0.0f, 1.0f},
-  {0.0f, 2.0f},
-  {0.0f, 2.0f},
-  {0.0f, 3.0f}
-};
-
-
-void spawnTileDebris(
-  entityx::EntityManager& entities,
-  const int x,
-  const int y,
-  const data::map::TileIndex tileIndex,
-  const int velocityX,
-  const int ySequenceOffset
-) {
-  using namespace engine::components;
-  using namespace engine::components::parameter_aliases;
-  using components::TileDebris;
-
-  auto movement = MovementSequence{
-    TILE_DEBRIS_MOVEMENT_SEQUENCE,
-    ResetAfterSequence{false},
-    EnableX{false}};
-  movement.mCurrentStep = ySequenceOffset;
-
-  auto debris = entities.create();
-  debris.assign<WorldPosition>(x, y);
-  debris.assign<BoundingBox>(BoundingBox{{}, {1, 1}});
-  debris.assign<Active>();
-  debris.assign<ActivationSettings>(ActivationSettings::Policy::Always);
-  debris.assign<AutoDestroy>(AutoDestroy::afterTimeout(80));
-  debris.assign<TileDebris>(TileDebris{tileIndex});
-  debris.assign<MovingBody>(
-    Velocity{static_cast<float>(velocityX), 0.0f},
-    GravityAffected{false},
-    IgnoreCollisions{true});
-  debris.assign<MovementSequence>(movement);
-}
-
-
 void spawnTileDebrisForSection(
   const engine::components::BoundingBox& mapSection,
   data::map::Map& map,
-  entityx::EntityManager& entities,
+  engine::TileDebrisSystem& tileDebris,
   engine::RandomNumberGenerator& randomGen
 ) {
-  const auto& start = mapSection.topLeft;
-  const auto& size = mapSection.size;
-  for (auto y = start.y; y < start.y + size.height; ++y) {
-    for (auto x = start.x; x < start.x + size.width; ++x) {
-      const auto tileIndex = map.tileAt(0, x, y);
+  map.forEachTileInRect(0, mapSection,
+    [&](const int x, const int y, const data::map::TileIndex tileIndex) {
       if (tileIndex == 0) {
-        continue;
+        return;
       }
 
       const auto velocityX = 3 - randomGen.gen() % 6;
       const auto ySequenceOffset = randomGen.gen() % 5;
-      spawnTileDebris(entities, x, y, tileIndex, velocityX, ySequenceOffset);
-    }
-  }
+      tileDebris.spawn({x, y}, tileIndex, velocityX, ySequenceOffset);
+    });
 }
 
 
 void explodeMapSection(
   const base::Rect<int>& mapSection,
   data::map::Map& map,
-  entityx::EntityManager& entityManager,
+  engine::TileDebrisSystem& tileDebris,
   engine::RandomNumberGenerator& randomGenerator
 ) {
-  spawnTileDebrisForSection(mapSection, map, entityManager, randomGenerator);
+  spawnTileDebrisForSection(mapSection, map, tileDebris, randomGenerator);
 
   map.clearSection(
     mapSection.topLeft.x, mapSection.topLeft.y,
@@ -132,7 +79,7 @@ void explodeMapSection(
   GlobalState& s
 ) {
   explodeMapSection(
-    mapSection, *s.mpMap, *d.mpEntityManager, *d.mpRandomGenerator);
+    mapSection, *s.mpMap, *d.mpTileDebris, *d.mpRandomGenerator);
 }
 
 
@@ -188,13 +135,13 @@ void squashTileSection(
 
 DynamicGeometrySystem::DynamicGeometrySystem(
   IGameServiceProvider* pServiceProvider,
-  entityx::EntityManager* pEntityManager,
+  engine::TileDebrisSystem* pTileDebris,
   data::map::Map* pMap,
   engine::RandomNumberGenerator* pRandomGenerator,
   entityx::EventManager* pEvents
 )
   : mpServiceProvider(pServiceProvider)
-  , mpEntityManager(pEntityManager)
+  , mpTileDebris(pTileDebris)
   , mpMap(pMap)
   , mpRandomGenerator(pRandomGenerator)
   , mpEvents(pEvents)
@@ -214,7 +161,7 @@ void DynamicGeometrySystem::receive(const events::ShootableKilled& event) {
 
   const auto& mapSection =
     entity.component<MapGeometryLink>()->mLinkedGeometrySection;
-  explodeMapSection(mapSection, *mpMap, *mpEntityManager, *mpRandomGenerator);
+  explodeMapSection(mapSection, *mpMap, *mpTileDebris, *mpRandomGenerator);
   mpServiceProvider->playSound(data::SoundId::BigExplosion);
   mpEvents->emit(rigel::events::ScreenFlash{});
 }
@@ -240,7 +187,7 @@ void DynamicGeometrySystem::receive(
   engine::components::BoundingBox mapSection{
     event.mImpactPosition - base::Vector{0, 2},
     {3, 3}};
-  explodeMapSection(mapSection, *mpMap, *mpEntityManager, *mpRandomGenerator);
+  explodeMapSection(mapSection, *mpMap, *mpTileDebris, *mpRandomGenerator);
   mpEvents->emit(rigel::events::ScreenFlash{});
 }
 
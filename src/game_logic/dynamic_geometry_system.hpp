@@ -26,7 +26,7 @@ RIGEL_RESTORE_WARNINGS
 namespace rigel {
   struct IGameServiceProvider;
   namespace data::map { class Map; }
-  namespace engine { class RandomNumberGenerator; }
+  namespace engine { class RandomNumberGenerator; class TileDebrisSystem; }
   namespace events { struct DoorOpened; struct MissileDetonated; }
   namespace game_logic::events { struct ShootableKilled; }
 }
@@ -38,7 +38,7 @@ class DynamicGeometrySystem : public entityx::Receiver<DynamicGeometrySystem> {
 public:
   DynamicGeometrySystem(
     IGameServiceProvider* pServiceProvider,
-    entityx::EntityManager* pEntityManager,
+    engine::TileDebrisSystem* pTileDebris,
     data::map::Map* pMap,
     engine::RandomNumberGenerator* pRandomGenerator,
     entityx::EventManager* pEvents);
@@ -49,7 +49,7 @@ public:
 
 private:
   IGameServiceProvider* mpServiceProvider;
-  entityx::EntityManager* mpEntityManager;
+  engine::TileDebrisSystem* mpTileDebris;
   data::map::Map* mpMap;
   engine::RandomNumberGenerator* mpRandomGenerator;
   entityx::EventManager* mpEvents;
@@ -29,7 +29,6 @@ namespace rigel::game_logic::components {
 
 namespace {
 
-const auto RIGHT_SCREEN_EDGE = data::GameTraits::mapViewPortSize.width - 1;
 constexpr auto MAX_Y_OFFSET = 16;
 
 }
@@ -48,7 +47,8 @@ void WindBlownSpiderGenerator::update(
     s.mpPerFrameState->mIsOddFrame
   ) {
     const auto effectActorId = 241 + d.mpRandomGenerator->gen() % 3;
-    const auto xPos = s.mpCameraPosition->x + RIGHT_SCREEN_EDGE;
+    const auto rightScreenEdge = s.mpViewPortSize->mapViewPortSize().width - 1;
+    const auto xPos = s.mpCameraPosition->x + rightScreenEdge;
     const auto yPos = s.mpCameraPosition->y +
       d.mpRandomGenerator->gen() % MAX_Y_OFFSET;
     const auto movementType = d.mpRandomGenerator->gen() % 2 != 0
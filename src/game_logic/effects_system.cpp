@@ -28,6 +28,8 @@
 #include "game_logic/entity_factory.hpp"
 #include "loader/palette.hpp"
 
+#include <algorithm>
+
 
 namespace rigel::game_logic {
 
@@ -84,22 +86,46 @@ EffectsSystem::EffectsSystem(
 {
   events.subscribe<events::ShootableKilled>(*this);
   events.subscribe<engine::events::CollidedWithWorld>(*this);
+  events.subscribe<entityx::ComponentAddedEvent<DestructionEffects>>(*this);
+  events.subscribe<entityx::ComponentRemovedEvent<DestructionEffects>>(
+    *this);
+  events.subscribe<engine::events::ClearingAllEntities>(*this);
+
+  pEntityManager->each<DestructionEffects>(
+    [this](entityx::Entity entity, const DestructionEffects& effects) {
+      if (effects.mActivated) {
+        mActiveEffects.push_back(entity);
+      }
+    });
 }
 
 
 void EffectsSystem::update(entityx::EntityManager& es) {
   using namespace engine::components;
 
-  es.each<DestructionEffects, WorldPosition>(
-    [this](
-      entityx::Entity entity,
-      DestructionEffects& effects,
-      const WorldPosition& position
-    ) {
-      if (effects.mActivated) {
-        processEffectsAndAdvance(position, effects);
-      }
-    });
+  // Effects spawn entities and draw random numbers, so they need to be
+  // processed in a fixed order. We use the same order as iterating over the
+  // entity manager would.
+  if (mActiveEffectsNeedSorting) {
+    std::sort(
+      mActiveEffects.begin(),
+      mActiveEffects.end(),
+      [](const entityx::Entity lhs, const entityx::Entity rhs) {
+        return lhs.id().index() < rhs.id().index();
+      });
+    mActiveEffectsNeedSorting = false;
+  }
+
+  // Processing effects only spawns new entities, without DestructionEffects
+  // of their own, so the list stays the same during the loop.
+  for (auto entity : mActiveEffects) {
+    // triggerEffects() assigns the position after the effects
+    if (entity.has_component<WorldPosition>()) {
+      processEffectsAndAdvance(
+        *entity.component<const WorldPosition>(),
+        *entity.component<DestructionEffects>());
+    }
+  }
 
   es.each<SpriteCascadeSpawner>(
     [this](entityx::Entity, SpriteCascadeSpawner& spawner) {
@@ -134,6 +160,33 @@ void EffectsSystem::receive(const engine::events::CollidedWithWorld& event) {
 }
 
 
+void EffectsSystem::receive(
+  const entityx::ComponentAddedEvent<DestructionEffects>& event
+) {
+  if (event.component->mActivated) {
+    mActiveEffects.push_back(event.entity);
+    mActiveEffectsNeedSorting = true;
+  }
+}
+
+
+void EffectsSystem::receive(
+  const entityx::ComponentRemovedEvent<DestructionEffects>& event
+) {
+  const auto iEntity =
+    std::find(mActiveEffects.begin(), mActiveEffects.end(), event.entity);
+  if (iEntity != mActiveEffects.end()) {
+    mActiveEffects.erase(iEntity);
+  }
+}
+
+
+void EffectsSystem::receive(const engine::events::ClearingAllEntities&) {
+  mActiveEffects.clear();
+  mActiveEffectsNeedSorting = false;
+}
+
+
 void EffectsSystem::triggerEffectsIfConditionMatches(
   entityx::Entity entity,
   const DestructionEffects::TriggerCondition expectedCondition
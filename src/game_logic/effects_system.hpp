@@ -18,12 +18,15 @@
 
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
+#include "engine/entity_tools.hpp"
 #include "game_logic/effect_components.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <vector>
+
 namespace rigel { struct IGameServiceProvider; }
 namespace rigel::engine {
   namespace events {
@@ -62,6 +65,12 @@ public:
 
   void receive(const events::ShootableKilled& event);
   void receive(const engine::events::CollidedWithWorld& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::DestructionEffects>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::DestructionEffects>&
+      event);
+  void receive(const engine::events::ClearingAllEntities& event);
 
 private:
   void triggerEffectsIfConditionMatches(
@@ -77,6 +86,12 @@ private:
   entityx::EntityManager* mpEntityManager;
   EntityFactory* mpEntityFactory;
   engine::ParticleSystem* mpParticles;
+
+  // Entities whose DestructionEffects are activated. Almost every shootable
+  // actor has DestructionEffects waiting to be triggered, so tracking the
+  // activated ones saves us from looking at all of them on each update.
+  std::vector<entityx::Entity> mActiveEffects;
+  bool mActiveEffectsNeedSorting = false;
 };
 
 }
@@ -25,7 +25,7 @@
 #include "engine/visual_components.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/entity_factory.hpp"
-#include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 #include <optional>
 
@@ -46,25 +46,21 @@ const auto GUARD_WIDTH = 3;
 
 bool playerInNoticeableRange(
   const WorldPosition& myPosition,
-  const WorldPosition& playerPosition
+  const PlayerPerception& player
 ) {
-  const auto playerCenterX = playerPosition.x + 1;
-  const auto myCenterX = myPosition.x + GUARD_WIDTH/2;
-  const auto centerToCenterDistance = std::abs(playerCenterX - myCenterX);
-
   return
-    myPosition.y == playerPosition.y &&
-    centerToCenterDistance <= 6;
+    myPosition.y == player.mPosition.y &&
+    player.centerToCenterDistanceX(myPosition, GUARD_WIDTH) <= 6;
 }
 
 
 bool playerVisible(
   components::BlueGuard& state,
   const WorldPosition& myPosition,
-  const Player& player
+  const PlayerPerception& player
 ) {
-  const auto playerX = player.position().x;
-  const auto playerY = player.position().y;
+  const auto playerX = player.mPosition.x;
+  const auto playerY = player.mPosition.y;
   const auto facingLeft = state.mOrientation == Orientation::Left;
 
   const auto hasLineOfSightHorizontal =
@@ -75,8 +71,8 @@ bool playerVisible(
     playerY + 3 > myPosition.y;
 
   return
-    player.isInRegularState() &&
-    !player.isCloaked() &&
+    player.mIsInRegularState &&
+    !player.mIsCloaked &&
     hasLineOfSightHorizontal &&
     hasLineOfSightVertical;
 }
@@ -94,14 +90,14 @@ base::Vector offsetForShot(const components::BlueGuard& state) {
 
 
 BlueGuardSystem::BlueGuardSystem(
-  const Player* pPlayer,
+  const PlayerPerception* pPlayerPerception,
   CollisionChecker* pCollisionChecker,
   EntityFactory* pEntityFactory,
   IGameServiceProvider* pServiceProvider,
   engine::RandomNumberGenerator* pRandomGenerator,
   entityx::EventManager& events
 )
-  : mpPlayer(pPlayer)
+  : mpPlayerPerception(pPlayerPerception)
   , mpCollisionChecker(pCollisionChecker)
   , mpEntityFactory(pEntityFactory)
   , mpServiceProvider(pServiceProvider)
@@ -122,7 +118,7 @@ void BlueGuardSystem::update(entityx::EntityManager& es) {
     ) {
       if (state.mTypingOnTerminal) {
         const auto noticesPlayer =
-          playerInNoticeableRange(position, mpPlayer->position());
+          playerInNoticeableRange(position, *mpPlayerPerception);
 
         if (noticesPlayer) {
           stopTyping(state, sprite, position);
@@ -169,7 +165,7 @@ void BlueGuardSystem::stopTyping(
   state.mTypingOnTerminal = false;
   state.mOneStepWalkedSinceTypingStop = false;
 
-  const auto playerX = mpPlayer->orientedPosition().x;
+  const auto playerX = mpPlayerPerception->mOrientedPosition.x;
   state.mOrientation = position.x <= playerX
     ? Orientation::Right
     : Orientation::Left;
@@ -195,13 +191,13 @@ void BlueGuardSystem::updateGuard(
   // fulfilled.
   const auto canAttack =
     state.mOneStepWalkedSinceTypingStop &&
-    playerVisible(state, position, *mpPlayer);
+    playerVisible(state, position, *mpPlayerPerception);
 
   if (canAttack) {
     // Change stance if necessary
     if (state.mStanceChangeCountdown <= 0) {
-      const auto playerCrouched = mpPlayer->isCrouching();
-      const auto playerBelow = mpPlayer->position().y > position.y;
+      const auto playerCrouched = mpPlayerPerception->mIsCrouching;
+      const auto playerBelow = mpPlayerPerception->mPosition.y > position.y;
       state.mIsCrouched = playerCrouched || playerBelow;
 
       if (state.mIsCrouched) {
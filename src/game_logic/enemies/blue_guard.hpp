@@ -31,7 +31,7 @@ namespace engine { class RandomNumberGenerator; }
 namespace engine::components { struct Sprite; }
 namespace game_logic {
   class EntityFactory;
-  class Player;
+  struct PlayerPerception;
 }
 namespace game_logic::events { struct ShootableDamaged; }
 
@@ -69,7 +69,7 @@ struct BlueGuard {
 class BlueGuardSystem : public entityx::Receiver<BlueGuardSystem> {
 public:
   BlueGuardSystem(
-    const Player* pPlayer,
+    const PlayerPerception* pPlayerPerception,
     engine::CollisionChecker* pCollisionChecker,
     EntityFactory* pEntityFactory,
     IGameServiceProvider* pServiceProvider,
@@ -92,7 +92,7 @@ private:
     engine::components::WorldPosition& position);
 
 private:
-  const Player* mpPlayer;
+  const PlayerPerception* mpPlayerPerception;
   engine::CollisionChecker* mpCollisionChecker;
   EntityFactory* mpEntityFactory;
   IGameServiceProvider* mpServiceProvider;
@@ -20,13 +20,19 @@
 #include "engine/base_components.hpp"
 #include "engine/physical_components.hpp"
 #include "engine/sprite_tools.hpp"
+#include "game_logic/behavior_controller.hpp"
 #include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
 
 namespace {
 
+// Number of updates to wait after grabbing, before being ready again
+constexpr auto WAIT_TIME = 39;
+
+
 constexpr int ANIM_SEQUENCE_GRAB_AIR[] = {
   0, 1, 2, 3, 4, 5, 4, 3, 2, 1, 0
 };
@@ -59,6 +65,13 @@ void CeilingSucker::update(
     return worldBbox.intersects(s.mpPlayer->worldSpaceHitBox());
   };
 
+  // Waiting doesn't do anything besides letting time pass, so we sleep
+  // through all but the last update of it
+  auto startWaiting = [&, this]() {
+    mState = Waiting{};
+    components::sleepBehaviorController(entity, WAIT_TIME - 1);
+  };
+
   base::match(mState,
     [&, this](const Ready&) {
       if (
@@ -73,7 +86,7 @@ void CeilingSucker::update(
     [&, this](Grabbing& state) {
       ++state.mFramesElapsed;
       if (state.mFramesElapsed >= 9) {
-        mState = Waiting{};
+        startWaiting();
         return;
       }
 
@@ -85,6 +98,7 @@ void CeilingSucker::update(
         position.x + 1 >= playerPos.x
       ) {
         s.mpPlayer->incapacitate(1);
+        s.mpPlayerPerception->update(*s.mpPlayer);
         mState = HoldingPlayer{};
         engine::startAnimationSequence(entity, ANIM_SEQUENCE_GRAB_PLAYER);
       }
@@ -96,18 +110,16 @@ void CeilingSucker::update(
         s.mpPlayer->position().x = position.x;
         s.mpPlayer->setFree();
         s.mpPlayer->takeDamage(1);
+        s.mpPlayerPerception->update(*s.mpPlayer);
       }
 
       if (state.mFramesElapsed >= 24) {
-        mState = Waiting{};
+        startWaiting();
       }
     },
 
-    [this](Waiting& state) {
-      ++state.mFramesElapsed;
-      if (state.mFramesElapsed >= 39) {
-        mState = Ready{};
-      }
+    [this](const Waiting&) {
+      mState = Ready{};
     });
 }
 
@@ -38,9 +38,7 @@ struct HoldingPlayer {
 };
 
 
-struct Waiting {
-  int mFramesElapsed = 0;
-};
+struct Waiting {};
 
 
 using State = std::variant<
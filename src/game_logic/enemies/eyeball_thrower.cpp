@@ -21,7 +21,7 @@
 #include "engine/movement.hpp"
 #include "engine/sprite_tools.hpp"
 #include "game_logic/entity_factory.hpp"
-#include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -45,19 +45,17 @@ void EyeballThrower::update(
   using namespace eyeball_thrower;
 
   const auto& position = *entity.component<WorldPosition>();
-  const auto& playerPos = s.mpPlayer->orientedPosition();
+  const auto& player = *s.mpPlayerPerception;
+  const auto& playerPos = player.mOrientedPosition;
 
   auto& orientation = *entity.component<Orientation>();
   auto& animationFrame = entity.component<Sprite>()->mFramesToRender[0];
 
   auto canShootAtPlayer = [&]() {
-    // TODO: Extract helper function centerToCenterDistance()
-
     // [playerpos] Using orientation-independent position here
-    const auto playerX = s.mpPlayer->position().x;
-    const auto playerCenterX = playerX + PLAYER_WIDTH/2;
-    const auto myCenterX = position.x + EYEBALL_THROWER_WIDTH/2;
-    const auto centerToCenterDistance = std::abs(playerCenterX - myCenterX);
+    const auto playerX = player.mPosition.x;
+    const auto centerToCenterDistance =
+      player.centerToCenterDistanceX(position, EYEBALL_THROWER_WIDTH);
 
     const auto facingPlayer =
       (orientation == Orientation::Left && position.x > playerX) ||
@@ -23,6 +23,7 @@
 #include "engine/visual_components.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/entity_factory.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::ai {
@@ -45,11 +46,11 @@ constexpr auto TELEPORT_ANIMATION_END_FRAME =
 
 
 HoverBotSystem::HoverBotSystem(
-  entityx::Entity player,
+  const PlayerPerception* pPlayerPerception,
   engine::CollisionChecker* pCollisionChecker,
   EntityFactory* pEntityFactory
 )
-  : mPlayer(player)
+  : mpPlayerPerception(pPlayerPerception)
   , mpCollisionChecker(pCollisionChecker)
   , mpEntityFactory(pEntityFactory)
 {
@@ -124,7 +125,7 @@ void HoverBotSystem::update(entityx::EntityManager& es) {
           engine::walk(*mpCollisionChecker, entity, state.mOrientation);
 
           // TODO: use wonky player position (orientation dependent)
-          const auto& playerPosition = *mPlayer.component<WorldPosition>();
+          const auto& playerPosition = mpPlayerPerception->mPosition;
           const auto playerIsLeft = position.x > playerPosition.x;
           const auto playerIsRight = position.x < playerPosition.x;
           if (
@@ -27,7 +27,10 @@ RIGEL_RESTORE_WARNINGS
 
 namespace rigel::engine { class CollisionChecker; }
 namespace rigel::engine::components { struct Sprite; }
-namespace rigel::game_logic { class EntityFactory; }
+namespace rigel::game_logic {
+  class EntityFactory;
+  struct PlayerPerception;
+}
 
 
 namespace rigel::game_logic::ai {
@@ -79,7 +82,7 @@ using HoverBot =
 class HoverBotSystem {
 public:
   HoverBotSystem(
-    entityx::Entity player,
+    const PlayerPerception* pPlayerPerception,
     engine::CollisionChecker* pCollisionChecker,
     EntityFactory* pEntityFactory);
 
@@ -92,7 +95,7 @@ private:
     engine::components::Sprite& sprite);
 
 private:
-  entityx::Entity mPlayer;
+  const PlayerPerception* mpPlayerPerception;
   engine::CollisionChecker* mpCollisionChecker;
   EntityFactory* mpEntityFactory;
   bool mIsOddFrame = false;
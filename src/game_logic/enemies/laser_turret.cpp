@@ -24,6 +24,7 @@
 #include "engine/visual_components.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/entity_factory.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::ai {
@@ -62,14 +63,14 @@ void configureLaserTurret(entityx::Entity& entity, const int givenScore) {
 
 
 LaserTurretSystem::LaserTurretSystem(
-  entityx::Entity player,
+  const PlayerPerception* pPlayerPerception,
   data::PlayerModel* pPlayerModel,
   EntityFactory* pEntityFactory,
   engine::RandomNumberGenerator* pRandomGenerator,
   IGameServiceProvider* pServiceProvider,
   entityx::EventManager& events
 )
-  : mPlayer(player)
+  : mpPlayerPerception(pPlayerPerception)
   , mpPlayerModel(pPlayerModel)
   , mpEntityFactory(pEntityFactory)
   , mpRandomGenerator(pRandomGenerator)
@@ -84,7 +85,7 @@ void LaserTurretSystem::update(entityx::EntityManager& es) {
   using namespace engine::components;
   using game_logic::components::PlayerDamaging;
 
-  const auto& playerPosition = *mPlayer.component<WorldPosition>();
+  const auto& playerPosition = mpPlayerPerception->mPosition;
 
   es.each<components::LaserTurret, WorldPosition, Sprite, Shootable, Active>(
     [this, &playerPosition](
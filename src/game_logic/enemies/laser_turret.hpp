@@ -30,7 +30,10 @@ RIGEL_RESTORE_WARNINGS
 namespace rigel { struct IGameServiceProvider; }
 namespace rigel::data { class PlayerModel; }
 namespace rigel::engine { class RandomNumberGenerator; }
-namespace rigel::game_logic { class EntityFactory; }
+namespace rigel::game_logic {
+  class EntityFactory;
+  struct PlayerPerception;
+}
 namespace rigel::game_logic::events {
   struct ShootableDamaged;
   struct ShootableKilled;
@@ -56,7 +59,7 @@ void configureLaserTurret(entityx::Entity& entity, int givenScore);
 class LaserTurretSystem : public entityx::Receiver<LaserTurretSystem> {
 public:
   LaserTurretSystem(
-    entityx::Entity player,
+    const PlayerPerception* pPlayerPerception,
     data::PlayerModel* pPlayerModel,
     EntityFactory* pEntityFactory,
     engine::RandomNumberGenerator* pRandomGenerator,
@@ -71,7 +74,7 @@ public:
 private:
   void performBaseHitEffect(entityx::Entity entity);
 
-  entityx::Entity mPlayer;
+  const PlayerPerception* mpPlayerPerception;
   data::PlayerModel* mpPlayerModel;
   EntityFactory* mpEntityFactory;
   engine::RandomNumberGenerator* mpRandomGenerator;
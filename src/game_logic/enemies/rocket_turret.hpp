@@ -25,7 +25,10 @@ RIGEL_RESTORE_WARNINGS
 
 
 namespace rigel { struct IGameServiceProvider; }
-namespace rigel::game_logic { class EntityFactory; }
+namespace rigel::game_logic {
+  class EntityFactory;
+  struct PlayerPerception;
+}
 
 
 namespace rigel::game_logic::ai {
@@ -53,7 +56,7 @@ void configureRocketTurret(entityx::Entity& entity, int givenScore);
 class RocketTurretSystem {
 public:
   RocketTurretSystem(
-    entityx::Entity player,
+    const PlayerPerception* pPlayerPerception,
     EntityFactory* pEntityFactory,
     IGameServiceProvider* pServiceProvider);
 
@@ -65,7 +68,7 @@ private:
     components::RocketTurret::Orientation myOrientation);
 
 private:
-  entityx::Entity mPlayer;
+  const PlayerPerception* mpPlayerPerception;
   EntityFactory* mpEntityFactory;
   IGameServiceProvider* mpServiceProvider;
 };
@@ -17,7 +17,7 @@
 #include "security_camera.hpp"
 
 #include "engine/visual_components.hpp"
-#include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -28,14 +28,11 @@ using engine::components::WorldPosition;
 
 namespace {
 
-int determineFrameForCameraPosition(
-  const WorldPosition& cameraPosition,
-  const WorldPosition& playerPosition
-) {
-  const auto playerAbove = playerPosition.y < cameraPosition.y;
-  const auto playerBelow = playerPosition.y > cameraPosition.y;
-  const auto playerLeft = playerPosition.x < cameraPosition.x;
-  const auto playerRight = playerPosition.x > cameraPosition.x;
+int determineFrameForDirectionToPlayer(const base::Vector& direction) {
+  const auto playerAbove = direction.y < 0;
+  const auto playerBelow = direction.y > 0;
+  const auto playerLeft = direction.x < 0;
+  const auto playerRight = direction.x > 0;
 
   if (playerBelow) {
     return playerLeft ? 7 : (playerRight ? 1 : 0);
@@ -55,15 +52,16 @@ void SecurityCamera::update(
   const bool isOnScreen,
   entityx::Entity entity
 ) {
-  if (s.mpPlayer->isCloaked()) {
+  const auto& player = *s.mpPlayerPerception;
+  if (player.mIsCloaked) {
     return;
   }
 
   const auto& position = *entity.component<WorldPosition>();
   auto& sprite = *entity.component<Sprite>();
 
-  const auto newFrame = determineFrameForCameraPosition(
-    position, s.mpPlayer->position());
+  const auto newFrame =
+    determineFrameForDirectionToPlayer(player.directionFrom(position));
   sprite.mFramesToRender[0] = newFrame;
 }
 
@@ -26,6 +26,7 @@
 #include "game_logic/damage_components.hpp"
 #include "game_logic/effect_components.hpp"
 #include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -160,6 +161,10 @@ void Snake::update(
 
   engine::synchronizeBoundingBoxToSprite(entity);
 
+  // The snake moves, damages, grabs and releases the player. Entities
+  // updated after this one need to see the result.
+  s.mpPlayerPerception->update(*s.mpPlayer);
+
   if (destroySelf) {
     entity.destroy();
   }
@@ -28,7 +28,7 @@
 #include "game_logic/behavior_controller.hpp"
 #include "game_logic/effect_components.hpp"
 #include "game_logic/entity_factory.hpp"
-#include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -90,7 +90,7 @@ void WatchBot::update(
 
   const auto& position = *entity.component<WorldPosition>();
   const auto& bbox = *entity.component<BoundingBox>();
-  const auto& playerPos = s.mpPlayer->orientedPosition();
+  const auto& playerPos = s.mpPlayerPerception->mOrientedPosition;
 
   auto& animationFrame = entity.component<Sprite>()->mFramesToRender[0];
   auto& movingBody = *entity.component<MovingBody>();
@@ -237,7 +237,7 @@ void WatchBotCarrier::update(
   using namespace engine::components;
 
   const auto& position = *entity.component<WorldPosition>();
-  const auto& playerPos = s.mpPlayer->position();
+  const auto& playerPos = s.mpPlayerPerception->mPosition;
 
   auto& animationFrame = entity.component<Sprite>()->mFramesToRender[0];
 
@@ -663,6 +663,359 @@ void addItemBoxDestroyEffect(ex::Entity entity) {
 } // namespace
 
 
+/** Compile-time description of an item box and the item it contains
+ *
+ * Most item boxes only differ in their color and the collectable they
+ * release. Those are described by the table below instead of having
+ * a case each in configureEntity().
+ */
+struct ItemBoxPrototype {
+  ActorID mId;
+  ContainerColor mColor;
+  int mGivenScore;
+  CollectableItem mItem;
+  std::optional<ActorTag::Type> mTag;
+  bool mIsAnimated;
+  bool mRequiresActivation;
+};
+
+
+namespace {
+
+constexpr CollectableItem inventoryItem(
+  const InventoryItemType type,
+  const std::optional<TutorialMessageId> message,
+  const bool spawnScoreNumbers = true
+) {
+  return CollectableItem{
+    500,
+    std::nullopt,
+    std::nullopt,
+    type,
+    std::nullopt,
+    std::nullopt,
+    message,
+    spawnScoreNumbers};
+}
+
+
+constexpr CollectableItem weapon(
+  const WeaponType type,
+  const TutorialMessageId message
+) {
+  return CollectableItem{
+    2000,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    type,
+    std::nullopt,
+    message,
+    true};
+}
+
+
+constexpr CollectableItem letter(
+  const CollectableLetterType type,
+  const std::optional<TutorialMessageId> message
+) {
+  return CollectableItem{
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    type,
+    message,
+    true};
+}
+
+
+constexpr CollectableItem merchandise(const int givenScore) {
+  return CollectableItem{
+    givenScore,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    std::nullopt,
+    true};
+}
+
+
+constexpr auto HEALTH_MOLECULE = CollectableItem{
+  500,
+  10000,
+  1,
+  std::nullopt,
+  std::nullopt,
+  std::nullopt,
+  TutorialMessageId::FoundHealthMolecule,
+  true};
+
+
+constexpr auto NO_MESSAGE = std::optional<TutorialMessageId>{};
+
+constexpr auto WEAPON_TAG = ActorTag::Type::CollectableWeapon;
+constexpr auto MERCHANDISE_TAG = ActorTag::Type::Merchandise;
+
+
+constexpr ItemBoxPrototype ITEM_BOX_PROTOTYPES[] = {
+  // White boxes
+  {
+    ActorID::White_box_circuit_card,
+    ContainerColor::White,
+    100,
+    inventoryItem(
+      InventoryItemType::CircuitBoard, TutorialMessageId::FoundAccessCard),
+    std::nullopt,
+    false,
+    false
+  },
+  {
+    ActorID::White_box_blue_key,
+    ContainerColor::White,
+    100,
+    inventoryItem(InventoryItemType::BlueKey, TutorialMessageId::FoundBlueKey),
+    std::nullopt,
+    false,
+    false
+  },
+  {
+    ActorID::White_box_rapid_fire,
+    ContainerColor::White,
+    100,
+    inventoryItem(
+      InventoryItemType::RapidFire, TutorialMessageId::FoundRapidFire),
+    std::nullopt,
+    true,
+    false
+  },
+  {
+    ActorID::White_box_cloaking_device,
+    ContainerColor::White,
+    100,
+    inventoryItem(InventoryItemType::CloakingDevice, NO_MESSAGE, false),
+    std::nullopt,
+    true,
+    false
+  },
+
+  // Green boxes
+  {
+    ActorID::Green_box_rocket_launcher,
+    ContainerColor::Green,
+    100,
+    weapon(WeaponType::Rocket, TutorialMessageId::FoundRocketLauncher),
+    WEAPON_TAG,
+    false,
+    false
+  },
+  {
+    ActorID::Green_box_flame_thrower,
+    ContainerColor::Green,
+    100,
+    weapon(WeaponType::FlameThrower, TutorialMessageId::FoundFlameThrower),
+    WEAPON_TAG,
+    false,
+    false
+  },
+  {
+    ActorID::Green_box_normal_weapon,
+    ContainerColor::Green,
+    100,
+    weapon(WeaponType::Normal, TutorialMessageId::FoundRegularWeapon),
+    WEAPON_TAG,
+    false,
+    false
+  },
+  {
+    ActorID::Green_box_laser,
+    ContainerColor::Green,
+    100,
+    weapon(WeaponType::Laser, TutorialMessageId::FoundLaser),
+    WEAPON_TAG,
+    false,
+    false
+  },
+
+  // Blue boxes
+  {
+    ActorID::Blue_box_health_molecule,
+    ContainerColor::Blue,
+    0,
+    HEALTH_MOLECULE,
+    MERCHANDISE_TAG,
+    true,
+    true
+  },
+  {
+    ActorID::Blue_box_N,
+    ContainerColor::Blue,
+    0,
+    letter(CollectableLetterType::N, TutorialMessageId::FoundLetterN),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_U,
+    ContainerColor::Blue,
+    0,
+    letter(CollectableLetterType::U, TutorialMessageId::FoundLetterU),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_K,
+    ContainerColor::Blue,
+    0,
+    letter(CollectableLetterType::K, TutorialMessageId::FoundLetterK),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_E,
+    ContainerColor::Blue,
+    0,
+    letter(CollectableLetterType::E, TutorialMessageId::FoundLetterE),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_M,
+    ContainerColor::Blue,
+    0,
+    letter(CollectableLetterType::M, NO_MESSAGE),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_video_game_cartridge,
+    ContainerColor::Blue,
+    0,
+    merchandise(500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_sunglasses,
+    ContainerColor::Blue,
+    0,
+    merchandise(100),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_phone,
+    ContainerColor::Blue,
+    0,
+    merchandise(2000),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_boom_box,
+    ContainerColor::Blue,
+    0,
+    merchandise(1000),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_disk,
+    ContainerColor::Blue,
+    0,
+    merchandise(500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_TV,
+    ContainerColor::Blue,
+    0,
+    merchandise(1500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_camera,
+    ContainerColor::Blue,
+    0,
+    merchandise(2500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_PC,
+    ContainerColor::Blue,
+    0,
+    merchandise(500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_CD,
+    ContainerColor::Blue,
+    0,
+    merchandise(500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_T_shirt,
+    ContainerColor::Blue,
+    0,
+    merchandise(5000),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+  {
+    ActorID::Blue_box_videocassette,
+    ContainerColor::Blue,
+    0,
+    merchandise(500),
+    MERCHANDISE_TAG,
+    false,
+    true
+  },
+};
+
+
+constexpr const ItemBoxPrototype* findItemBoxPrototype(const ActorID id) {
+  for (const auto& prototype : ITEM_BOX_PROTOTYPES) {
+    if (prototype.mId == id) {
+      return &prototype;
+    }
+  }
+
+  return nullptr;
+}
+
+
+static_assert(
+  findItemBoxPrototype(ActorID::Blue_box_videocassette)->mItem.mGivenScore ==
+  500);
+static_assert(findItemBoxPrototype(ActorID::Red_box_cola) == nullptr);
+
+} // namespace
+
+
 template<typename... Args>
 void EntityFactory::configureItemBox(
   ex::Entity entity,
@@ -687,6 +1040,37 @@ void EntityFactory::configureItemBox(
 }
 
 
+void EntityFactory::configureItemBox(
+  ex::Entity entity,
+  const ItemBoxPrototype& prototype
+) {
+  const auto& item = prototype.mItem;
+  const auto color = prototype.mColor;
+  const auto score = prototype.mGivenScore;
+
+  if (prototype.mTag) {
+    const auto tag = ActorTag{*prototype.mTag};
+    if (prototype.mIsAnimated) {
+      configureItemBox(entity, color, score, item, AnimationLoop{1}, tag);
+    } else {
+      configureItemBox(entity, color, score, item, tag);
+    }
+
+    entity.assign<ActorTag>(tag);
+  } else {
+    if (prototype.mIsAnimated) {
+      configureItemBox(entity, color, score, item, AnimationLoop{1});
+    } else {
+      configureItemBox(entity, color, score, item);
+    }
+  }
+
+  if (!prototype.mRequiresActivation) {
+    entity.remove<ActivationSettings>();
+  }
+}
+
+
 void EntityFactory::configureEntity(
   ex::Entity entity,
   const ActorID actorID,
@@ -753,72 +1137,8 @@ void EntityFactory::configureEntity(
       addItemBoxDestroyEffect(entity);
       break;
 
-    // ----------------------------------------------------------------------
-    // White boxes
-    // ----------------------------------------------------------------------
-    case ActorID::White_box_circuit_card: // Circuit board
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        item.mGivenItem = InventoryItemType::CircuitBoard;
-        item.mShownTutorialMessage = TutorialMessageId::FoundAccessCard;
-        configureItemBox(
-          entity,
-          ContainerColor::White,
-          100,
-          item);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::White_box_blue_key: // Blue key
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        item.mGivenItem = InventoryItemType::BlueKey;
-        item.mShownTutorialMessage = TutorialMessageId::FoundBlueKey;
-        configureItemBox(
-          entity,
-          ContainerColor::White,
-          100,
-          item);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::White_box_rapid_fire: // Rapid fire item
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        item.mGivenItem = InventoryItemType::RapidFire;
-        item.mShownTutorialMessage = TutorialMessageId::FoundRapidFire;
-        auto animation = AnimationLoop{1};
-        configureItemBox(
-          entity,
-          ContainerColor::White,
-          100,
-          item,
-          animation);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::White_box_cloaking_device: // Cloaking device
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        item.mGivenItem = InventoryItemType::CloakingDevice;
-        item.mSpawnScoreNumbers = false;
-        auto animation = AnimationLoop{1};
-        configureItemBox(
-          entity,
-          ContainerColor::White,
-          100,
-          item,
-          animation);
-        entity.remove<ActivationSettings>();
-      }
-      break;
+    // White, green and blue boxes without any special behavior are described
+    // by ITEM_BOX_PROTOTYPES, and handled in the default case below.
 
     // ----------------------------------------------------------------------
     // Red boxes
@@ -974,326 +1294,6 @@ void EntityFactory::configureEntity(
       }
       break;
 
-    // ----------------------------------------------------------------------
-    // Green boxes
-    // ----------------------------------------------------------------------
-    case ActorID::Green_box_rocket_launcher: // Rocket launcher
-      {
-        CollectableItem item;
-        item.mGivenScore = 2000;
-        item.mGivenWeapon = WeaponType::Rocket;
-        item.mShownTutorialMessage = TutorialMessageId::FoundRocketLauncher;
-        configureItemBox(
-          entity,
-          ContainerColor::Green,
-          100,
-          item,
-          ActorTag{ActorTag::Type::CollectableWeapon});
-        entity.assign<ActorTag>(ActorTag::Type::CollectableWeapon);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::Green_box_flame_thrower: // Flame thrower
-      {
-        CollectableItem item;
-        item.mGivenScore = 2000;
-        item.mGivenWeapon = WeaponType::FlameThrower;
-        item.mShownTutorialMessage = TutorialMessageId::FoundFlameThrower;
-        configureItemBox(
-          entity,
-          ContainerColor::Green,
-          100,
-          item,
-          ActorTag{ActorTag::Type::CollectableWeapon});
-        entity.assign<ActorTag>(ActorTag::Type::CollectableWeapon);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::Green_box_normal_weapon: // Default weapon
-      {
-        CollectableItem item;
-        item.mGivenScore = 2000;
-        item.mGivenWeapon = WeaponType::Normal;
-        item.mShownTutorialMessage = TutorialMessageId::FoundRegularWeapon;
-        configureItemBox(
-          entity,
-          ContainerColor::Green,
-          100,
-          item,
-          ActorTag{ActorTag::Type::CollectableWeapon});
-        entity.assign<ActorTag>(ActorTag::Type::CollectableWeapon);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    case ActorID::Green_box_laser: // Laser
-      {
-        CollectableItem item;
-        item.mGivenScore = 2000;
-        item.mGivenWeapon = WeaponType::Laser;
-        item.mShownTutorialMessage = TutorialMessageId::FoundLaser;
-        configureItemBox(
-          entity,
-          ContainerColor::Green,
-          100,
-          item,
-          ActorTag{ActorTag::Type::CollectableWeapon});
-        entity.assign<ActorTag>(ActorTag::Type::CollectableWeapon);
-        entity.remove<ActivationSettings>();
-      }
-      break;
-
-    // ----------------------------------------------------------------------
-    // Blue boxes
-    // ----------------------------------------------------------------------
-    case ActorID::Blue_box_health_molecule: // Health molecule
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        item.mGivenScoreAtFullHealth = 10000;
-        item.mGivenHealth = 1;
-        item.mShownTutorialMessage = TutorialMessageId::FoundHealthMolecule;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          AnimationLoop{1},
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_N: // Collectable letter N in blue box
-      {
-        CollectableItem item;
-        item.mGivenCollectableLetter = CollectableLetterType::N;
-        item.mShownTutorialMessage = TutorialMessageId::FoundLetterN;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_U: // Collectable letter U in blue box
-      {
-        CollectableItem item;
-        item.mGivenCollectableLetter = CollectableLetterType::U;
-        item.mShownTutorialMessage = TutorialMessageId::FoundLetterU;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_K: // Collectable letter K in blue box
-      {
-        CollectableItem item;
-        item.mGivenCollectableLetter = CollectableLetterType::K;
-        item.mShownTutorialMessage = TutorialMessageId::FoundLetterK;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_E: // Collectable letter E in blue box
-      {
-        CollectableItem item;
-        item.mGivenCollectableLetter = CollectableLetterType::E;
-        item.mShownTutorialMessage = TutorialMessageId::FoundLetterE;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_M: // Collectable letter M in blue box
-      {
-        CollectableItem item;
-        item.mGivenCollectableLetter = CollectableLetterType::M;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_video_game_cartridge: // Video game cartridge in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_sunglasses: // Sunglasses in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 100;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_phone: // Phone in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 2000;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_boom_box: // Boom box in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 1000;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_disk: // Game disk in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_TV: // TV in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 1500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_camera: // Camera in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 2500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_PC: // Computer in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_CD: // CD in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_T_shirt: // T-Shirt in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 5000;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
-    case ActorID::Blue_box_videocassette: // Video tape in blue box
-      {
-        CollectableItem item;
-        item.mGivenScore = 500;
-        configureItemBox(
-          entity,
-          ContainerColor::Blue,
-          0,
-          item,
-          ActorTag{ActorTag::Type::Merchandise});
-        entity.assign<ActorTag>(ActorTag::Type::Merchandise);
-      }
-      break;
-
     case ActorID::Teleporter_1: // teleporter
     case ActorID::Teleporter_2: // teleporter
       entity.assign<AnimationLoop>(1);
@@ -1333,7 +1333,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         HOVER_BOT_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     // Green panther
@@ -1342,7 +1342,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BIOLOGICAL_ENEMY_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     // Wall-mounted flame thrower
@@ -1357,7 +1357,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         SIMPLE_TECH_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       addDefaultMovingBody(entity, boundingBox);
       entity.component<MovingBody>()->mGravityAffected = false;
       entity.assign<BehaviorController>(behaviors::WatchBot{});
@@ -1371,7 +1371,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         SIMPLE_TECH_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     // Rocket turret rockets
@@ -1432,7 +1432,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BIOLOGICAL_ENEMY_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       entity.assign<PlayerDamaging>(Damage{1});
       entity.assign<ai::components::SlimeBlob>();
       addDefaultMovingBody(entity, boundingBox);
@@ -1484,7 +1484,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BIOLOGICAL_ENEMY_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       entity.assign<BoundingBox>(boundingBox);
       entity.assign<BehaviorController>(behaviors::CeilingSucker{});
       break;
@@ -1517,7 +1517,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         SKELETON_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       entity.assign<PlayerDamaging>(Damage{1});
       entity.assign<ai::components::SimpleWalker>(skeletonAiConfig());
       addDefaultMovingBody(entity, boundingBox);
@@ -1549,7 +1549,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BIOLOGICAL_ENEMY_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     // petrified green monster
@@ -1559,7 +1559,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         EXTENDED_BIOLOGICAL_ENEMY_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     case ActorID::Small_flying_ship_1: // Small flying ship 1
@@ -1586,7 +1586,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BLUE_GUARD_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(ActorID::Blue_guard_RIGHT, 0));
+        mpSpriteFactory->actorFrameRect(ActorID::Blue_guard_RIGHT, 0));
       break;
 
 
@@ -1648,7 +1648,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         BOSS4_PROJECTILE_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(actorID, 0));
+        mpSpriteFactory->actorFrameRect(actorID, 0));
       break;
 
     case ActorID::Rigelatin_soldier: // Rigelatin soldier
@@ -1661,7 +1661,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         RIGELATIN_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(ActorID::Rigelatin_soldier, 0));
+        mpSpriteFactory->actorFrameRect(ActorID::Rigelatin_soldier, 0));
       break;
 
     // ----------------------------------------------------------------------
@@ -1703,7 +1703,7 @@ void EntityFactory::configureEntity(
       entity.assign<DestructionEffects>(
         REACTOR_KILL_EFFECT_SPEC,
         DestructionEffects::TriggerCondition::OnKilled,
-        mSpriteFactory.actorFrameRect(ActorID::Electric_reactor, 0));
+        mpSpriteFactory->actorFrameRect(ActorID::Electric_reactor, 0));
       entity.assign<ActorTag>(ActorTag::Type::Reactor);
       break;
 
@@ -2018,6 +2018,9 @@ void EntityFactory::configureEntity(
       break;
 
     default:
+      if (const auto pPrototype = findItemBoxPrototype(actorID)) {
+        configureItemBox(entity, *pPrototype);
+      }
       break;
   }
 
@@ -21,6 +21,7 @@
 #include "engine/life_time_components.hpp"
 #include "engine/physics_system.hpp"
 #include "engine/sprite_tools.hpp"
+#include "engine/trace_recorder.hpp"
 #include "game_logic/actor_tag.hpp"
 #include "game_logic/behavior_controller.hpp"
 #include "game_logic/collectable_components.hpp"
@@ -63,6 +64,11 @@
 #include "game_logic/interactive/tile_burner.hpp"
 #include "game_logic/trigger_components.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
 #include <tuple>
 #include <utility>
 
@@ -84,6 +90,12 @@ using namespace game_logic::components;
 
 namespace {
 
+// Upper bound for the number of threads used in
+// SpriteFactory::preloadSprites(). A level only uses a few dozen different
+// actors, so more threads wouldn't help much.
+constexpr auto MAX_SPRITE_DECODING_THREADS = std::size_t{8};
+
+
 // Assign gravity affected moving body component
 template<typename EntityLike>
 void addDefaultMovingBody(
@@ -306,53 +318,237 @@ base::ArrayView<int> frameMapForActor(const ActorID actorId) {
 
 SpriteFactory::SpriteFactory(
   renderer::Renderer* pRenderer,
-  const ActorImagePackage* pSpritePackage
+  const ActorImagePackage* pSpritePackage,
+  const std::size_t textureBudget
 )
-  : mpRenderer(pRenderer)
-  , mpSpritePackage(pSpritePackage)
+  : mpSpritePackage(pSpritePackage)
+  , mAtlas(pRenderer)
+  , mTextureBudget(textureBudget)
 {
 }
 
 
-Sprite SpriteFactory::createSprite(const ActorID mainId) {
-  auto iData = mSpriteDataCache.find(mainId);
-  if (iData == mSpriteDataCache.end()) {
-    engine::SpriteDrawData drawData;
+SpriteFactory::SpriteDataPtr SpriteFactory::spriteData(const ActorID mainId) {
+  auto iEntry = mSpriteDataCache.find(mainId);
+  if (iEntry == mSpriteDataCache.end()) {
+    insertIntoCache(
+      mainId,
+      createSpriteData(mainId, [this](const ActorID part) -> const ActorData& {
+        return mpSpritePackage->loadActor(part);
+      }));
+    iEntry = mSpriteDataCache.find(mainId);
+  }
 
-    int lastDrawOrder = 0;
-    int lastFrameCount = 0;
-    std::vector<int> framesToRender;
+  iEntry->second.mLastRequested = ++mRequestCounter;
+  return iEntry->second.mpData;
+}
 
-    const auto actorParts = actorIDListForActor(mainId);
-    for (const auto part : actorParts) {
-      const auto& actorData = mpSpritePackage->loadActor(part);
-      lastDrawOrder = actorData.mDrawIndex;
 
-      for (const auto& frameData : actorData.mFrames) {
-        auto texture = renderer::OwningTexture{
-          mpRenderer, frameData.mFrameImage};
-        drawData.mFrames.emplace_back(
-          std::move(texture), frameData.mDrawOffset);
-      }
+void SpriteFactory::evictUnusedSprites() {
+  if (mAtlas.textureMemoryUsed() <= mTextureBudget) {
+    return;
+  }
 
-      framesToRender.push_back(lastFrameCount);
-      lastFrameCount = int(actorData.mFrames.size());
+  // Only the cache itself refers to unused sprites
+  std::vector<std::pair<std::uint64_t, ActorID>> candidates;
+  for (const auto& [id, entry] : mSpriteDataCache) {
+    if (entry.mpData.use_count() == 1) {
+      candidates.emplace_back(entry.mLastRequested, id);
     }
+  }
 
-    drawData.mOrientationOffset = orientationOffsetForActor(mainId);
-    drawData.mVirtualToRealFrameMap = frameMapForActor(mainId);
-    drawData.mDrawOrder = adjustedDrawOrder(mainId, lastDrawOrder);
+  std::sort(candidates.begin(), candidates.end());
 
-    adjustOffsets(drawData.mFrames, mainId);
+  if (!candidates.empty() && engine::traceRecorder().isEnabled()) {
+    engine::traceRecorder().addInstant(
+      "Sprite cache eviction", engine::TraceRecorder::Clock::now());
+  }
 
-    iData = mSpriteDataCache.emplace(
-      mainId,
-      SpriteData{std::move(drawData), std::move(framesToRender)}
-    ).first;
+  for (const auto& candidate : candidates) {
+    if (mAtlas.textureMemoryUsed() <= mTextureBudget) {
+      break;
+    }
+
+    mSpriteDataCache.erase(candidate.second);
+  }
+}
+
+
+void SpriteFactory::insertIntoCache(
+  const ActorID id,
+  std::shared_ptr<SpriteData> pData
+) {
+  mSpriteDataCache.emplace(id, CacheEntry{std::move(pData), ++mRequestCounter});
+}
+
+
+void SpriteFactory::preloadSprites(const std::vector<ActorID>& ids) {
+  std::vector<ActorID> partsToLoad;
+  for (const auto id : ids) {
+    if (mSpriteDataCache.count(id) == 0) {
+      const auto actorParts = actorIDListForActor(id);
+      partsToLoad.insert(
+        partsToLoad.end(), std::begin(actorParts), std::end(actorParts));
+    }
+  }
+
+  std::sort(partsToLoad.begin(), partsToLoad.end());
+  partsToLoad.erase(
+    std::unique(partsToLoad.begin(), partsToLoad.end()),
+    partsToLoad.end());
+
+  if (partsToLoad.empty()) {
+    return;
   }
 
-  const auto& data = iData->second;
-  return {&data.mDrawData, data.mInitialFramesToRender};
+  // The sprite package synchronizes access to its cache of decoded actors,
+  // so the workers don't need any synchronization apart from picking the
+  // next part to decode. Each worker only writes to its own slots in
+  // decodedParts.
+  std::vector<const ActorData*> decodedParts(partsToLoad.size());
+  std::atomic<std::size_t> nextPartIndex{0};
+
+  auto decodeParts = [&]() {
+    for (
+      auto index = nextPartIndex++;
+      index < partsToLoad.size();
+      index = nextPartIndex++
+    ) {
+      decodedParts[index] = &mpSpritePackage->loadActor(partsToLoad[index]);
+    }
+  };
+
+  const auto numWorkers = std::clamp(
+    static_cast<std::size_t>(std::thread::hardware_concurrency()),
+    std::size_t{1},
+    std::min(MAX_SPRITE_DECODING_THREADS, partsToLoad.size()));
+
+  std::vector<std::future<void>> workers;
+  for (auto i = std::size_t{1}; i < numWorkers; ++i) {
+    workers.push_back(std::async(std::launch::async, decodeParts));
+  }
+
+  decodeParts();
+
+  for (auto& worker : workers) {
+    // Re-throws any exception raised during decoding
+    worker.get();
+  }
+
+  // Texture uploads need to happen on the thread owning the GL context,
+  // so building the sprites is done here.
+  std::unordered_map<ActorID, const ActorData*> actorDataById;
+  for (auto i = std::size_t{0}; i < partsToLoad.size(); ++i) {
+    actorDataById.emplace(partsToLoad[i], decodedParts[i]);
+  }
+
+  for (const auto id : ids) {
+    if (mSpriteDataCache.count(id) == 0) {
+      insertIntoCache(
+        id,
+        createSpriteData(id, [&](const ActorID part) -> const ActorData& {
+          return *actorDataById.at(part);
+        }));
+    }
+  }
+}
+
+
+void SpriteFactory::prefetchSprite(const ActorID id) {
+  const auto isPending = std::any_of(
+    mPendingSprites.begin(),
+    mPendingSprites.end(),
+    [id](const PendingSprite& pending) { return pending.mId == id; });
+  if (isPending || mSpriteDataCache.count(id) != 0) {
+    return;
+  }
+
+  auto decodeParts = [pSpritePackage = mpSpritePackage, id]() {
+    std::vector<const ActorData*> parts;
+    for (const auto part : actorIDListForActor(id)) {
+      parts.push_back(&pSpritePackage->loadActor(part));
+    }
+    return parts;
+  };
+
+  mPendingSprites.push_back(
+    PendingSprite{id, std::async(std::launch::async, decodeParts)});
+}
+
+
+void SpriteFactory::uploadPrefetchedSprites(const int maxSprites) {
+  using namespace std::chrono_literals;
+
+  auto numUploaded = 0;
+  auto iPending = mPendingSprites.begin();
+  while (iPending != mPendingSprites.end() && numUploaded < maxSprites) {
+    auto& pending = *iPending;
+    if (pending.mDecodedParts.wait_for(0s) != std::future_status::ready) {
+      ++iPending;
+      continue;
+    }
+
+    // Re-throws any exception raised during decoding
+    const auto decodedParts = pending.mDecodedParts.get();
+
+    // The sprite may have been created on demand in the meantime
+    if (mSpriteDataCache.count(pending.mId) == 0) {
+      auto iPart = decodedParts.begin();
+      insertIntoCache(
+        pending.mId,
+        createSpriteData(pending.mId, [&](ActorID) -> const ActorData& {
+          // createSpriteData() asks for the parts in the same order as
+          // actorIDListForActor() lists them
+          return **iPart++;
+        }));
+      ++numUploaded;
+    }
+
+    iPending = mPendingSprites.erase(iPending);
+  }
+}
+
+
+template <typename GetActorDataFunc>
+std::shared_ptr<SpriteFactory::SpriteData> SpriteFactory::createSpriteData(
+  const ActorID mainId,
+  GetActorDataFunc&& getActorData
+) {
+  engine::SpriteDrawData drawData;
+  std::vector<renderer::TextureAtlas::PageRef> pages;
+
+  int lastDrawOrder = 0;
+  int lastFrameCount = 0;
+  engine::FramesToRender framesToRender;
+
+  const auto actorParts = actorIDListForActor(mainId);
+  for (const auto part : actorParts) {
+    const auto& actorData = getActorData(part);
+    lastDrawOrder = actorData.mDrawIndex;
+
+    for (const auto& frameData : actorData.mFrames) {
+      drawData.mFrames.emplace_back(
+        mAtlas.insert(frameData.mFrameImage), frameData.mDrawOffset);
+
+      auto pPage = mAtlas.lastUsedPage();
+      if (std::find(pages.begin(), pages.end(), pPage) == pages.end()) {
+        pages.push_back(std::move(pPage));
+      }
+    }
+
+    framesToRender.push_back(lastFrameCount);
+    lastFrameCount = int(actorData.mFrames.size());
+  }
+
+  drawData.mOrientationOffset = orientationOffsetForActor(mainId);
+  drawData.mVirtualToRealFrameMap = frameMapForActor(mainId);
+  drawData.mDrawOrder = adjustedDrawOrder(mainId, lastDrawOrder);
+
+  adjustOffsets(drawData.mFrames, mainId);
+  engine::precomputeFrameBoundingBoxes(drawData);
+
+  return std::make_shared<SpriteData>(
+    SpriteData{std::move(drawData), framesToRender, std::move(pages)});
 }
 
 
@@ -365,21 +561,37 @@ base::Rect<int> SpriteFactory::actorFrameRect(
 
 
 EntityFactory::EntityFactory(
-  renderer::Renderer* pRenderer,
+  SpriteFactory* pSpriteFactory,
   ex::EntityManager* pEntityManager,
-  const loader::ActorImagePackage* pSpritePackage,
   const data::Difficulty difficulty)
-  : mSpriteFactory(pRenderer, pSpritePackage)
+  : mpSpriteFactory(pSpriteFactory)
   , mpEntityManager(pEntityManager)
   , mDifficulty(difficulty)
 {
 }
 
 
+void EntityFactory::prefetchSprite(const ActorID actorID) {
+  mpSpriteFactory->prefetchSprite(actorID);
+}
+
+
+void EntityFactory::uploadPrefetchedSprites(const int maxSprites) {
+  mpSpriteFactory->uploadPrefetchedSprites(maxSprites);
+}
+
+
 Sprite EntityFactory::createSpriteForId(const ActorID actorID) {
-  auto sprite = mSpriteFactory.createSprite(actorID);
-  configureSprite(sprite, actorID);
-  return sprite;
+  auto iPrototype = mSpritePrototypes.find(actorID);
+  if (iPrototype == mSpritePrototypes.end()) {
+    auto pData = mpSpriteFactory->spriteData(actorID);
+    auto sprite = Sprite{&pData->mDrawData, pData->mInitialFramesToRender};
+    configureSprite(sprite, actorID);
+    iPrototype = mSpritePrototypes.emplace(
+      actorID, SpritePrototype{sprite, std::move(pData)}).first;
+  }
+
+  return iPrototype->second.mSprite;
 }
 
 
@@ -388,8 +600,7 @@ entityx::Entity EntityFactory::createSprite(
   const bool assignBoundingBox
 ) {
   auto entity = mpEntityManager->create();
-  auto sprite = createSpriteForId(actorID);
-  entity.assign<Sprite>(sprite);
+  const auto& sprite = *entity.assign<Sprite>(createSpriteForId(actorID));
 
   if (assignBoundingBox) {
     entity.assign<BoundingBox>(engine::inferBoundingBox(sprite, entity));
@@ -488,6 +699,16 @@ void EntityFactory::configureProjectile(
     entity.component<MovingBody>()->mIgnoreCollisions = true;
     entity.component<MovingBody>()->mIsActive = false;
 
+    // Lasers, flames and reactor debris fly through walls, so there is
+    // no need to check them for collisions at all.
+    const auto passesThroughWalls =
+      type == ProjectileType::PlayerLaserShot ||
+      type == ProjectileType::PlayerFlameShot ||
+      type == ProjectileType::ReactorDebris;
+    if (passesThroughWalls) {
+      entity.component<MovingBody>()->mDetectCollisions = false;
+    }
+
     entity.assign<DamageInflicting>(damageAmount, DestroyOnContact{false});
     entity.assign<PlayerProjectile>(toPlayerProjectileType(type));
 
@@ -518,6 +739,19 @@ entityx::Entity EntityFactory::createEntitiesForLevel(
 ) {
   entityx::Entity playerEntity;
 
+  std::vector<ActorID> actorsWithSprites;
+  for (const auto& actor : actors) {
+    if (!actor.mAssignedArea && hasAssociatedSprite(actor.mID)) {
+      actorsWithSprites.push_back(actor.mID);
+    }
+  }
+  mpSpriteFactory->evictUnusedSprites();
+  mpSpriteFactory->preloadSprites(actorsWithSprites);
+
+  // Entities must be created in the order given by the level file. It
+  // determines the entity indices, and thereby the order in which all
+  // systems process entities. Since many behaviors draw from the shared
+  // random number generator, that order is part of the game's behavior.
   for (const auto& actor : actors) {
     // Difficulty/section markers should never appear in the actor descriptions
     // coming from the loader, as they are handled during pre-processing.
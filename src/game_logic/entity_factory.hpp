@@ -23,18 +23,25 @@
 #include "game_logic/ientity_factory.hpp"
 #include "loader/level_loader.hpp"
 #include "renderer/renderer.hpp"
+#include "renderer/texture_atlas.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
+#include <future>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <vector>
 
 
-namespace rigel::loader { class ActorImagePackage; }
+namespace rigel::loader {
+  class ActorImagePackage;
+  struct ActorData;
+}
 
 namespace rigel::game_logic {
 
@@ -89,33 +96,109 @@ inline bool isHorizontal(const ProjectileDirection direction) {
 }
 
 
+/** Creates and caches the sprites of actors
+ *
+ * A single sprite factory is meant to be shared by all game worlds created
+ * in a session, so that sprites used by many levels (the player, common
+ * effects etc.) are only created once. Users keep the sprites they need
+ * alive via the SpriteDataPtrs returned by spriteData().
+ *
+ * Once the cached sprites take up more texture memory than the given
+ * budget, evictUnusedSprites() drops those which aren't referenced anymore,
+ * least recently requested first. A texture atlas page is freed once none
+ * of its sprites are left.
+ */
 class SpriteFactory {
 public:
+  static constexpr auto DEFAULT_TEXTURE_BUDGET =
+    std::size_t{32 * 1024 * 1024};
+
+  struct SpriteData {
+    engine::SpriteDrawData mDrawData;
+    engine::FramesToRender mInitialFramesToRender;
+    std::vector<renderer::TextureAtlas::PageRef> mPages;
+  };
+
+  using SpriteDataPtr = std::shared_ptr<const SpriteData>;
+
   SpriteFactory(
     renderer::Renderer* pRenderer,
-    const loader::ActorImagePackage* pSpritePackage);
+    const loader::ActorImagePackage* pSpritePackage,
+    std::size_t textureBudget = DEFAULT_TEXTURE_BUDGET);
 
-  engine::components::Sprite createSprite(data::ActorID id);
+  SpriteDataPtr spriteData(data::ActorID id);
   base::Rect<int> actorFrameRect(data::ActorID id, int frame) const;
 
+  /** Create the sprite data for the given actors ahead of time
+   *
+   * Decoding actor images is relatively expensive. This decodes the images
+   * for all given actors in parallel on worker threads, instead of one after
+   * another when spriteData() is first called for each actor. The texture
+   * uploads still happen on the calling thread, since they need the GL
+   * context.
+   */
+  void preloadSprites(const std::vector<data::ActorID>& ids);
+
+  /** Start decoding the given actor's images on a worker thread
+   *
+   * Does nothing if the sprite has already been created or requested. The
+   * sprite itself is created by a later uploadPrefetchedSprites() call,
+   * once decoding has finished. Calling spriteData() before then works as
+   * usual.
+   */
+  void prefetchSprite(data::ActorID id);
+
+  /** Create sprites for prefetched actors which have finished decoding
+   *
+   * Uploads the textures of at most maxSprites sprites, to limit the time
+   * spent per frame. Sprites which are still being decoded are left for
+   * later calls.
+   */
+  void uploadPrefetchedSprites(int maxSprites);
+
+  /** Drop unused sprites until the texture budget is met, if possible
+   *
+   * Sprites which are still referenced by a SpriteDataPtr outside of the
+   * factory are kept. Should be called when no new sprites are about to be
+   * requested anyway, like before loading a level.
+   */
+  void evictUnusedSprites();
+
 private:
-  struct SpriteData {
-    engine::SpriteDrawData mDrawData;
-    std::vector<int> mInitialFramesToRender;
+  struct CacheEntry {
+    std::shared_ptr<SpriteData> mpData;
+    std::uint64_t mLastRequested;
+  };
+
+  template <typename GetActorDataFunc>
+  std::shared_ptr<SpriteData> createSpriteData(
+    data::ActorID mainId,
+    GetActorDataFunc&& getActorData);
+
+  struct PendingSprite {
+    data::ActorID mId;
+    std::future<std::vector<const loader::ActorData*>> mDecodedParts;
   };
 
-  renderer::Renderer* mpRenderer;
+  void insertIntoCache(data::ActorID id, std::shared_ptr<SpriteData> pData);
+
   const loader::ActorImagePackage* mpSpritePackage;
-  std::unordered_map<data::ActorID, SpriteData> mSpriteDataCache;
+  renderer::TextureAtlas mAtlas;
+  std::unordered_map<data::ActorID, CacheEntry> mSpriteDataCache;
+  std::vector<PendingSprite> mPendingSprites;
+  std::size_t mTextureBudget;
+  std::uint64_t mRequestCounter = 0;
 };
 
 
+struct ItemBoxPrototype;
+
+
 class EntityFactory : public IEntityFactory {
 public:
   EntityFactory(
-    renderer::Renderer* pRenderer,
+    SpriteFactory* pSpriteFactory,
     entityx::EntityManager* pEntityManager,
-    const loader::ActorImagePackage* pSpritePackage,
     data::Difficulty difficulty);
 
   entityx::Entity createEntitiesForLevel(
@@ -143,7 +226,19 @@ public:
     data::ActorID actorID,
     const base::Vector& position) override;
 
+  /** See SpriteFactory::prefetchSprite() */
+  void prefetchSprite(data::ActorID actorID);
+
+  /** See SpriteFactory::uploadPrefetchedSprites() */
+  void uploadPrefetchedSprites(int maxSprites);
+
 private:
+  /** Create a fully configured sprite for the given actor
+   *
+   * Sprites are set up once per actor ID and then copied from the
+   * resulting prototype, since effects and projectiles create the same few
+   * sprites over and over again.
+   */
   engine::components::Sprite createSpriteForId(const data::ActorID actorID);
 
   void configureEntity(
@@ -158,6 +253,10 @@ private:
     int givenScore,
     Args&&... components);
 
+  void configureItemBox(
+    entityx::Entity entity,
+    const ItemBoxPrototype& prototype);
+
   engine::components::Sprite createSpriteComponent(data::ActorID mainId);
 
   void configureProjectile(
@@ -168,7 +267,13 @@ private:
     const engine::components::BoundingBox& boundingBox
   );
 
-  SpriteFactory mSpriteFactory;
+  struct SpritePrototype {
+    engine::components::Sprite mSprite;
+    SpriteFactory::SpriteDataPtr mpData;
+  };
+
+  SpriteFactory* mpSpriteFactory;
+  std::unordered_map<data::ActorID, SpritePrototype> mSpritePrototypes;
   entityx::EntityManager* mpEntityManager;
   int mSpawnIndex = 0;
   data::Difficulty mDifficulty;
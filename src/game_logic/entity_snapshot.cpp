@@ -0,0 +1,289 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "entity_snapshot.hpp"
+
+#include "engine/base_components.hpp"
+#include "engine/entity_tools.hpp"
+#include "engine/life_time_components.hpp"
+#include "engine/physical_components.hpp"
+#include "engine/visual_components.hpp"
+#include "game_logic/actor_tag.hpp"
+#include "game_logic/behavior_controller.hpp"
+#include "game_logic/collectable_components.hpp"
+#include "game_logic/damage_components.hpp"
+#include "game_logic/dynamic_geometry_components.hpp"
+#include "game_logic/effect_components.hpp"
+#include "game_logic/enemies/blue_guard.hpp"
+#include "game_logic/enemies/hover_bot.hpp"
+#include "game_logic/enemies/laser_turret.hpp"
+#include "game_logic/enemies/messenger_drone.hpp"
+#include "game_logic/enemies/prisoner.hpp"
+#include "game_logic/enemies/rocket_turret.hpp"
+#include "game_logic/enemies/simple_walker.hpp"
+#include "game_logic/enemies/slime_blob.hpp"
+#include "game_logic/enemies/spider.hpp"
+#include "game_logic/enemies/spike_ball.hpp"
+#include "game_logic/interactive/elevator.hpp"
+#include "game_logic/interactive/enemy_radar.hpp"
+#include "game_logic/interactive/item_container.hpp"
+#include "game_logic/interactive/sliding_door.hpp"
+#include "game_logic/player/components.hpp"
+#include "game_logic/trigger_components.hpp"
+
+#include <bitset>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+
+namespace rigel::game_logic {
+
+namespace ex = entityx;
+
+using ComponentMask = std::bitset<ex::MAX_COMPONENTS>;
+
+
+struct EntitySnapshot::ComponentStoreBase {
+  virtual ~ComponentStoreBase() = default;
+
+  virtual void capture(ex::Entity entity) = 0;
+
+  /** Assign the component at position to entity, if it belongs to it
+   *
+   * Returns the position of the next component to look at.
+   */
+  virtual std::size_t restore(ex::Entity entity, std::size_t position)
+    const = 0;
+};
+
+
+namespace {
+
+template <typename C>
+struct ComponentStore : EntitySnapshot::ComponentStoreBase {
+  static_assert(std::is_copy_constructible_v<C>);
+
+  void capture(ex::Entity entity) override {
+    if (entity.has_component<C>()) {
+      mComponents.emplace_back(
+        entity.id().index(), *entity.component<const C>());
+    }
+  }
+
+  std::size_t restore(ex::Entity entity, const std::size_t position)
+    const override
+  {
+    if (
+      position < mComponents.size() &&
+      mComponents[position].first == entity.id().index()
+    ) {
+      entity.assign<C>(mComponents[position].second);
+      return position + 1;
+    }
+
+    return position;
+  }
+
+  std::vector<std::pair<std::uint32_t, C>> mComponents;
+};
+
+
+template <typename... Components>
+struct ComponentList {
+  static ComponentMask mask() {
+    ComponentMask result;
+    (result.set(ex::Component<Components>::family()), ...);
+    return result;
+  }
+
+  static auto makeStores() {
+    std::vector<std::unique_ptr<EntitySnapshot::ComponentStoreBase>> stores;
+    (stores.push_back(std::make_unique<ComponentStore<Components>>()), ...);
+    return stores;
+  }
+};
+
+
+// Order matters: Components are assigned in this order when restoring.
+// Some systems look at other components when they see a SolidBody or Active
+// being added, so those come last.
+using SnapshotComponents = ComponentList<
+  engine::components::WorldPosition,
+  engine::components::BoundingBox,
+  engine::components::Orientation,
+  engine::components::ActivationSettings,
+  engine::components::AutoDestroy,
+  engine::components::MovingBody,
+  engine::components::MovementSequence,
+  engine::components::CollidedWithWorld,
+  engine::components::Sprite,
+  engine::components::CustomRenderFunc,
+  engine::components::DrawTopMost,
+  engine::components::OverrideDrawOrder,
+  engine::components::AnimationLoop,
+  engine::components::AnimationSequence,
+  components::ActorTag,
+  components::BehaviorController,
+  components::CollectableItem,
+  components::PlayerDamaging,
+  components::Shootable,
+  components::DamageInflicting,
+  components::PlayerProjectile,
+  components::MapGeometryLink,
+  components::DestructionEffects,
+  components::SpriteCascadeSpawner,
+  components::Interactable,
+  components::Trigger,
+  components::ItemContainer,
+  components::RadarDish,
+  components::RadarComputer,
+  interaction::components::Elevator,
+  ai::components::BlueGuard,
+  ai::components::HorizontalSlidingDoor,
+  ai::components::VerticalSlidingDoor,
+  ai::components::HoverBot,
+  ai::components::HoverBotSpawnMachine,
+  ai::components::LaserTurret,
+  ai::components::MessengerDrone,
+  ai::components::Prisoner,
+  ai::components::RocketTurret,
+  ai::components::SimpleWalker,
+  ai::components::SlimeBlob,
+  ai::components::SlimeContainer,
+  ai::components::Spider,
+  ai::components::SpikeBall,
+  engine::components::SolidBody,
+  engine::components::Active>;
+
+}
+
+
+EntitySnapshot::EntitySnapshot()
+  : mComponentStores(SnapshotComponents::makeStores())
+{
+}
+
+
+EntitySnapshot::EntitySnapshot(EntitySnapshot&&) noexcept = default;
+EntitySnapshot& EntitySnapshot::operator=(EntitySnapshot&&) noexcept =
+  default;
+EntitySnapshot::~EntitySnapshot() = default;
+
+
+std::optional<EntitySnapshot> EntitySnapshot::capture(ex::EntityManager& es) {
+  static const auto supportedComponents = SnapshotComponents::mask();
+
+  EntitySnapshot snapshot;
+
+  // entityx doesn't expose the order of its free list, which decides the
+  // indices that future entities get. To learn it, we take all unused
+  // indices off the list by creating entities, and then put them back in
+  // the same order by destroying those entities again.
+  const auto numUnusedIndices = es.capacity() - es.size();
+
+  std::vector<ex::Entity> recycledEntities;
+  recycledEntities.reserve(numUnusedIndices);
+  for (std::size_t i = 0; i < numUnusedIndices; ++i) {
+    recycledEntities.push_back(es.create());
+  }
+
+  snapshot.mFreeList.reserve(numUnusedIndices);
+  while (!recycledEntities.empty()) {
+    auto& entity = recycledEntities.back();
+    snapshot.mFreeList.push_back(entity.id().index());
+    entity.destroy();
+    recycledEntities.pop_back();
+  }
+
+  // Initially, we assume that all indices are unused. entityx reports
+  // the current version for unused indices as well, which is the version
+  // the index will have once it's reused.
+  snapshot.mEntityInfos.reserve(es.capacity());
+  for (auto index = std::uint32_t{0}; index < es.capacity(); ++index) {
+    snapshot.mEntityInfos.push_back(
+      EntityInfo{es.create_id(index).version(), false});
+  }
+
+  for (auto entity : es.entities_for_debugging()) {
+    if ((entity.component_mask() & ~supportedComponents).any()) {
+      return std::nullopt;
+    }
+
+    snapshot.mEntityInfos[entity.id().index()].mIsAlive = true;
+
+    for (auto& pStore : snapshot.mComponentStores) {
+      pStore->capture(entity);
+    }
+  }
+
+  return snapshot;
+}
+
+
+void EntitySnapshot::restore(
+  ex::EntityManager& es,
+  ex::EventManager& events
+) const {
+  engine::clearAllEntities(es, events);
+
+  // After a reset, entities are created with consecutive indices, starting
+  // at version 1. Destroying an entity bumps its version and puts its index
+  // on the free list, from which the next create() takes it again. This lets
+  // us recreate the exact same IDs.
+  std::vector<ex::Entity> entities;
+  entities.reserve(mEntityInfos.size());
+  for (std::size_t i = 0; i < mEntityInfos.size(); ++i) {
+    entities.push_back(es.create());
+  }
+
+  auto bumpVersion = [&](ex::Entity& entity) {
+    entity.destroy();
+    entity = es.create();
+  };
+
+  for (std::size_t i = 0; i < mEntityInfos.size(); ++i) {
+    const auto& info = mEntityInfos[i];
+
+    // Unused indices get destroyed one more time at the end
+    const auto targetVersion =
+      info.mIsAlive ? info.mVersion : info.mVersion - 1;
+    while (entities[i].id().version() < targetVersion) {
+      bumpVersion(entities[i]);
+    }
+
+    assert(entities[i].id().version() == targetVersion);
+  }
+
+  // Destroying in the captured order recreates entityx's free list
+  for (const auto index : mFreeList) {
+    entities[index].destroy();
+  }
+
+  std::vector<std::size_t> positions(mComponentStores.size(), 0);
+  for (std::size_t i = 0; i < mEntityInfos.size(); ++i) {
+    if (!mEntityInfos[i].mIsAlive) {
+      continue;
+    }
+
+    for (std::size_t store = 0; store < mComponentStores.size(); ++store) {
+      positions[store] =
+        mComponentStores[store]->restore(entities[i], positions[store]);
+    }
+  }
+}
+
+}
@@ -0,0 +1,82 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+
+namespace rigel::game_logic {
+
+/** Copy of all entities and their components at a certain point in time
+ *
+ * Restoring a snapshot replaces all entities in the entity manager with
+ * the ones stored in the snapshot. Entity IDs are restored as well, so
+ * components referring to other entities stay valid.
+ *
+ * Only component types known to the snapshot implementation can be stored.
+ * capture() fails if it encounters an entity with any other component.
+ *
+ * Systems observe the restoration like any other entity creation, via
+ * ComponentAddedEvents. For each entity, components are added in
+ * a fixed order, with SolidBody coming after position and bounding box.
+ * Any existing entities are destroyed first, via engine::clearAllEntities().
+ *
+ * entityx reuses the indices of destroyed entities in a fixed order. The
+ * snapshot records that order, so entities created after restoring get the
+ * same IDs as they would have gotten after capturing. Capturing has to
+ * recycle all unused indices once to find out the order, which increments
+ * their versions. Since entityx offers no way to set an entity's version
+ * directly, restoring takes time proportional to the sum of all versions.
+ */
+class EntitySnapshot {
+public:
+  static std::optional<EntitySnapshot> capture(entityx::EntityManager& es);
+
+  EntitySnapshot(EntitySnapshot&&) noexcept;
+  EntitySnapshot& operator=(EntitySnapshot&&) noexcept;
+  ~EntitySnapshot();
+
+  void restore(
+    entityx::EntityManager& es,
+    entityx::EventManager& events) const;
+
+  struct ComponentStoreBase;
+
+private:
+  EntitySnapshot();
+
+  struct EntityInfo {
+    std::uint32_t mVersion;
+    bool mIsAlive;
+  };
+
+  std::vector<EntityInfo> mEntityInfos;
+  std::vector<std::uint32_t> mFreeList;
+
+  std::vector<std::unique_ptr<ComponentStoreBase>> mComponentStores;
+};
+
+}
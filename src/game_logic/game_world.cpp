@@ -22,10 +22,14 @@
 #include "data/sound_ids.hpp"
 #include "data/strings.hpp"
 #include "data/unit_conversions.hpp"
+#include "engine/entity_tools.hpp"
+#include "engine/flight_recorder.hpp"
 #include "engine/physical_components.hpp"
+#include "engine/trace_recorder.hpp"
 #include "game_logic/actor_tag.hpp"
 #include "game_logic/ingame_systems.hpp"
 #include "game_logic/trigger_components.hpp"
+#include "loader/level_loader.hpp"
 #include "loader/resource_loader.hpp"
 #include "ui/menu_element_renderer.hpp"
 #include "ui/utils.hpp"
@@ -47,58 +51,9 @@ using engine::components::WorldPosition;
 
 namespace {
 
-char EPISODE_PREFIXES[] = {'L', 'M', 'N', 'O'};
-
-
-std::string levelFileName(const int episode, const int level) {
-  assert(episode >=0 && episode < 4);
-  assert(level >=0 && level < 8);
-
-  std::string fileName;
-  fileName += EPISODE_PREFIXES[episode];
-  fileName += std::to_string(level + 1);
-  fileName += ".MNI";
-  return fileName;
-}
-
-
 constexpr auto BOSS_LEVEL_INTRO_MUSIC = "CALM.IMF";
 
 
-struct BonusRelatedItemCounts {
-  int mCameraCount = 0;
-  int mFireBombCount = 0;
-  int mWeaponCount = 0;
-  int mMerchandiseCount = 0;
-  int mBonusGlobeCount = 0;
-  int mLaserTurretCount = 0;
-};
-
-
-BonusRelatedItemCounts countBonusRelatedItems(entityx::EntityManager& es) {
-  using game_logic::components::ActorTag;
-  using AT = ActorTag::Type;
-
-  BonusRelatedItemCounts counts;
-
-  es.each<ActorTag>([&counts](entityx::Entity, const ActorTag& tag) {
-      switch (tag.mType) {
-        case AT::ShootableCamera: ++counts.mCameraCount; break;
-        case AT::FireBomb: ++counts.mFireBombCount; break;
-        case AT::CollectableWeapon: ++counts.mWeaponCount; break;
-        case AT::Merchandise: ++counts.mMerchandiseCount; break;
-        case AT::ShootableBonusGlobe: ++counts.mBonusGlobeCount; break;
-        case AT::MountedLaserTurret: ++counts.mLaserTurretCount; break;
-
-        default:
-          break;
-      }
-    });
-
-  return counts;
-}
-
-
 constexpr auto HEALTH_BAR_LABEL_START_X = 1;
 constexpr auto HEALTH_BAR_LABEL_START_Y = 0;
 constexpr auto HEALTH_BAR_TILE_INDEX = 4*40 + 1;
@@ -131,6 +86,7 @@ auto asSize(const base::Vector& vec) {
 
 [[nodiscard]] auto setupIngameViewport(
   renderer::Renderer* pRenderer,
+  const data::ViewPortSize& viewPortSize,
   const int screenShakeOffsetX
 ) {
   auto saved = renderer::Renderer::StateSaver{pRenderer};
@@ -149,12 +105,13 @@ auto asSize(const base::Vector& vec) {
   };
 
 
+  // A wider view extends equally to both sides of the original screen
   const auto offset = data::GameTraits::inGameViewPortOffset +
-    base::Vector{screenShakeOffsetX, 0};
+    base::Vector{screenShakeOffsetX - viewPortSize.extraWidthPx() / 2, 0};
 
   pRenderer->setClipRect(base::Rect<int>{
     transform(offset),
-    asSize(applyScale(asVec(data::GameTraits::inGameViewPortSize)))});
+    asSize(applyScale(asVec(viewPortSize.inGameViewPortSize())))});
   pRenderer->setGlobalTranslation(transform(offset));
 
   return saved;
@@ -168,7 +125,8 @@ GameWorld::GameWorld(
   const data::GameSessionId& sessionId,
   GameMode::Context context,
   std::optional<base::Vector> playerPositionOverride,
-  bool showWelcomeMessage
+  bool showWelcomeMessage,
+  std::optional<data::map::LevelData> preloadedLevel
 )
   : mpRenderer(context.mpRenderer)
   , mpServiceProvider(context.mpServiceProvider)
@@ -176,19 +134,21 @@ GameWorld::GameWorld(
   , mpTextRenderer(context.mpUiRenderer)
   , mEntities(mEventManager)
   , mEntityFactory(
-      context.mpRenderer,
+      context.mpSpriteFactory,
       &mEntities,
-      &context.mpResources->mActorImagePackage,
       sessionId.mDifficulty)
+  , mViewPortSize(context.mViewPortSize)
   , mpPlayerModel(pPlayerModel)
   , mPlayerModelAtLevelStart(*mpPlayerModel)
   , mRadarDishCounter(mEntities, mEventManager)
+  , mActorTagCounter(mEventManager)
   , mHudRenderer(
       mpPlayerModel,
       sessionId.mLevel + 1,
       mpRenderer,
-      *context.mpResources,
-      context.mpUiSpriteSheet)
+      context.mpHudAssets,
+      context.mpUiSpriteSheet,
+      mViewPortSize)
   , mMessageDisplay(mpServiceProvider, context.mpUiRenderer)
 {
   mEventManager.subscribe<rigel::events::CheckPointActivated>(*this);
@@ -206,7 +166,7 @@ GameWorld::GameWorld(
   using namespace std::chrono;
   auto before = high_resolution_clock::now();
 
-  loadLevel(sessionId, *context.mpResources);
+  loadLevel(sessionId, *context.mpResources, std::move(preloadedLevel));
 
   if (playerPositionOverride) {
     mpSystems->player().position() = *playerPositionOverride;
@@ -234,7 +194,11 @@ GameWorld::GameWorld(
 }
 
 
-GameWorld::~GameWorld() = default;
+GameWorld::~GameWorld() {
+  if (engine::flightRecorder().isEnabled()) {
+    engine::flightRecorder().clearWorldState();
+  }
+}
 
 
 bool GameWorld::levelFinished() const {
@@ -249,32 +213,39 @@ std::set<data::Bonus> GameWorld::achievedBonuses() const {
     bonuses.insert(data::Bonus::NoDamageTaken);
   }
 
-  const auto counts =
-    countBonusRelatedItems(const_cast<entityx::EntityManager&>(mEntities));
+  using AT = components::ActorTag::Type;
 
-  if (mBonusInfo.mInitialCameraCount > 0 && counts.mCameraCount == 0) {
+  if (
+    mBonusInfo.mInitialCameraCount > 0 &&
+    mActorTagCounter.count(AT::ShootableCamera) == 0
+  ) {
     bonuses.insert(data::Bonus::DestroyedAllCameras);
   }
 
   // NOTE: This is a bug (?) in the original game - if a level doesn't contain
   // any fire bombs, bonus 6 will be awarded, as if the player had destroyed
   // all fire bombs.
-  if (counts.mFireBombCount == 0) {
+  if (mActorTagCounter.count(AT::FireBomb) == 0) {
     bonuses.insert(data::Bonus::DestroyedAllFireBombs);
   }
 
   if (
-    mBonusInfo.mInitialMerchandiseCount > 0 && counts.mMerchandiseCount == 0
+    mBonusInfo.mInitialMerchandiseCount > 0 &&
+    mActorTagCounter.count(AT::Merchandise) == 0
   ) {
     bonuses.insert(data::Bonus::CollectedAllMerchandise);
   }
 
-  if (mBonusInfo.mInitialWeaponCount > 0 && counts.mWeaponCount == 0) {
+  if (
+    mBonusInfo.mInitialWeaponCount > 0 &&
+    mActorTagCounter.count(AT::CollectableWeapon) == 0
+  ) {
     bonuses.insert(data::Bonus::CollectedEveryWeapon);
   }
 
   if (
-    mBonusInfo.mInitialLaserTurretCount > 0 && counts.mLaserTurretCount == 0
+    mBonusInfo.mInitialLaserTurretCount > 0 &&
+    mActorTagCounter.count(AT::MountedLaserTurret) == 0
   ) {
     bonuses.insert(data::Bonus::DestroyedAllSpinningLaserTurrets);
   }
@@ -372,28 +343,43 @@ void GameWorld::receive(const rigel::events::BossActivated& event) {
 
 void GameWorld::loadLevel(
   const data::GameSessionId& sessionId,
-  const loader::ResourceLoader& resources
+  const loader::ResourceLoader& resources,
+  std::optional<data::map::LevelData> preloadedLevel
 ) {
-  auto loadedLevel = loader::loadLevel(
-    levelFileName(sessionId.mEpisode, sessionId.mLevel),
-    resources,
-    sessionId.mDifficulty);
+  engine::TraceZone zone("Level loading");
+
+  mLevelFileName = loader::levelFileName(sessionId.mEpisode, sessionId.mLevel);
+
+  auto loadedLevel = preloadedLevel
+    ? std::move(*preloadedLevel)
+    : loader::loadLevel(mLevelFileName, resources, sessionId.mDifficulty);
   auto playerEntity =
     mEntityFactory.createEntitiesForLevel(loadedLevel.mActors);
 
-  const auto counts = countBonusRelatedItems(mEntities);
-  mBonusInfo.mInitialCameraCount = counts.mCameraCount;
-  mBonusInfo.mInitialMerchandiseCount = counts.mMerchandiseCount;
-  mBonusInfo.mInitialWeaponCount = counts.mWeaponCount;
-  mBonusInfo.mInitialLaserTurretCount = counts.mLaserTurretCount;
-  mBonusInfo.mInitialBonusGlobeCount = counts.mBonusGlobeCount;
+  mEntitiesAtLevelStart = EntitySnapshot::capture(mEntities);
+  mPlayerEntityIdAtLevelStart = playerEntity.id();
+  if (!mEntitiesAtLevelStart) {
+    std::cerr <<
+      "WARNING: Unsupported components in level, restarting will be slow\n";
+  }
+
+  using AT = components::ActorTag::Type;
+  mBonusInfo.mInitialCameraCount = mActorTagCounter.count(AT::ShootableCamera);
+  mBonusInfo.mInitialMerchandiseCount =
+    mActorTagCounter.count(AT::Merchandise);
+  mBonusInfo.mInitialWeaponCount =
+    mActorTagCounter.count(AT::CollectableWeapon);
+  mBonusInfo.mInitialLaserTurretCount =
+    mActorTagCounter.count(AT::MountedLaserTurret);
+  mBonusInfo.mInitialBonusGlobeCount =
+    mActorTagCounter.count(AT::ShootableBonusGlobe);
 
   mLevelData = LevelData{
     std::move(loadedLevel.mMap),
     std::move(loadedLevel.mActors),
     loadedLevel.mBackdropSwitchCondition
   };
-  mMapAtLevelStart = mLevelData.mMap;
+  mLevelData.mMap.setRestorePoint();
 
   mpSystems = std::make_unique<IngameSystems>(
     sessionId,
@@ -401,6 +387,7 @@ void GameWorld::loadLevel(
     mpPlayerModel,
     &mLevelData.mMap,
     engine::MapRenderer::MapRenderData{std::move(loadedLevel)},
+    &mViewPortSize,
     mpServiceProvider,
     &mEntityFactory,
     &mRandomGenerator,
@@ -436,21 +423,56 @@ void GameWorld::updateGameLogic(const PlayerInput& input) {
     mEarthQuakeEffect->update();
   }
 
+  const auto allocationsAtStart =
+    engine::allocation_tracking::threadCounters();
+  const auto tickStart = std::chrono::steady_clock::now();
+
   mHudRenderer.updateAnimation();
   mMessageDisplay.update();
 
   mpSystems->update(input, mEntities);
+
+  mAllocationsLastTick =
+    engine::allocation_tracking::threadCounters() - allocationsAtStart;
+
+  if (engine::flightRecorder().isEnabled()) {
+    using namespace std::chrono;
+
+    auto& recorder = engine::flightRecorder();
+    recorder.setWorldState(
+      mLevelFileName, mpSystems->cameraPosition(), mEntities.size());
+    recorder.checkTickTime(
+      duration<double, std::milli>(steady_clock::now() - tickStart).count());
+  }
+}
+
+
+void GameWorld::updateRealTimeEffects(const engine::TimeDelta dt) {
+  mpSystems->updateBackdropAutoScroll(dt);
 }
 
 
-void GameWorld::render() {
+void GameWorld::render(const float interpolationFactor) {
+  // Everything on this thread since the last render counts as one frame
+  const auto allocations = engine::allocation_tracking::threadCounters();
+  mAllocationsLastFrame = allocations - mAllocationsAtLastRender;
+  mAllocationsAtLastRender = allocations;
+
+  engine::allocation_tracking::Scope allocationScope("Rendering");
+
   mpRenderer->clear();
 
+  // Screen shake and flashes cost a fixed number of renderer state changes
+  // per frame, independent of what's on screen: The shake offset is part of
+  // the one translation set up for the in-game viewport, a screen flash
+  // replaces world rendering altogether, and the backdrop flash color only
+  // wraps the backdrop draw (see RenderingSystem::renderBackgroundLayers).
   {
-    const auto saved = setupIngameViewport(mpRenderer, mScreenShakeOffsetX);
+    const auto saved = setupIngameViewport(
+      mpRenderer, mViewPortSize, mScreenShakeOffsetX);
 
     if (!mScreenFlashColor) {
-      mpSystems->render(mEntities, mBackdropFlashColor);
+      mpSystems->render(mEntities, mBackdropFlashColor, interpolationFactor);
     } else {
       mpRenderer->clear(*mScreenFlashColor);
     }
@@ -478,6 +500,74 @@ void GameWorld::processEndOfFrameActions() {
 }
 
 
+bool GameWorld::quickSave() {
+  mpSystems->lifeTimeSystem().writeRemainingFramesToLive();
+
+  auto entities = EntitySnapshot::capture(mEntities);
+  if (!entities) {
+    std::cerr << "WARNING: Unsupported components in level, can't quick save\n";
+    return false;
+  }
+
+  mQuickSave = QuickSaveData{
+    mLevelData.mMap,
+    std::move(*entities),
+    mpSystems->player().entity().id(),
+    *mpPlayerModel,
+    mBonusInfo,
+    mActivatedCheckpoint,
+    mActiveBossEntity,
+    mEarthQuakeEffect,
+    mReactorDestructionFramesElapsed,
+    mRandomGenerator.state(),
+    mBackdropSwitched};
+  return true;
+}
+
+
+StateHash GameWorld::computeStateHash() {
+  return mStateHasher.hash(
+    mEntities, mLevelData.mMap, mRandomGenerator, *mpPlayerModel);
+}
+
+
+bool GameWorld::canQuickLoad() const {
+  return mQuickSave.has_value();
+}
+
+
+void GameWorld::quickLoad() {
+  assert(mQuickSave);
+
+  mpServiceProvider->fadeOutScreen();
+
+  if (mBackdropSwitched != mQuickSave->mBackdropSwitched) {
+    mpSystems->switchBackdrops();
+    mBackdropSwitched = mQuickSave->mBackdropSwitched;
+  }
+
+  mLevelData.mMap.restoreTilesFrom(mQuickSave->mMap);
+
+  mQuickSave->mEntities.restore(mEntities, mEventManager);
+  mpSystems->restartFromBeginning(mEntities.get(mQuickSave->mPlayerEntityId));
+
+  *mpPlayerModel = mQuickSave->mPlayerModel;
+  mBonusInfo = mQuickSave->mBonusInfo;
+  mActivatedCheckpoint = mQuickSave->mActivatedCheckpoint;
+  mActiveBossEntity = mQuickSave->mActiveBossEntity;
+  mEarthQuakeEffect = mQuickSave->mEarthQuakeEffect;
+  mReactorDestructionFramesElapsed =
+    mQuickSave->mReactorDestructionFramesElapsed;
+  mRandomGenerator.setState(mQuickSave->mRandomGeneratorState);
+  mTeleportTargetPosition = std::nullopt;
+
+  mpSystems->centerViewOnPlayer();
+  render();
+
+  mpServiceProvider->fadeInScreen();
+}
+
+
 void GameWorld::onReactorDestroyed(const base::Vector& position) {
   mScreenFlashColor = loader::INGAME_PALETTE[7];
   mEntityFactory.createProjectile(
@@ -572,11 +662,18 @@ void GameWorld::restartLevel() {
     mBackdropSwitched = false;
   }
 
-  mLevelData.mMap = mMapAtLevelStart;
+  mLevelData.mMap.revertToRestorePoint();
+
+  auto playerEntity = entityx::Entity{};
+  if (mEntitiesAtLevelStart) {
+    mEntitiesAtLevelStart->restore(mEntities, mEventManager);
+    playerEntity = mEntities.get(mPlayerEntityIdAtLevelStart);
+  } else {
+    engine::clearAllEntities(mEntities, mEventManager);
+    playerEntity = mEntityFactory.createEntitiesForLevel(
+      mLevelData.mInitialActors);
+  }
 
-  mEntities.reset();
-  auto playerEntity = mEntityFactory.createEntitiesForLevel(
-    mLevelData.mInitialActors);
   mpSystems->restartFromBeginning(playerEntity);
 
   *mpPlayerModel = mPlayerModelAtLevelStart;
@@ -647,6 +744,13 @@ void GameWorld::showDebugText() {
   infoText
     << "Entities: " << mEntities.size();
 
+  if constexpr (engine::allocation_tracking::isEnabledInBuild()) {
+    infoText
+      << "\nAllocations: " << mAllocationsLastTick.mNumAllocations
+      << " last tick, " << mAllocationsLastFrame.mNumAllocations
+      << " last frame";
+  }
+
   ui::drawText(infoText.str(), 0, 32, {255, 255, 255, 255});
 }
 
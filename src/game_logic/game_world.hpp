@@ -22,15 +22,20 @@
 #include "common/game_mode.hpp"
 #include "common/global.hpp"
 #include "data/bonus.hpp"
+#include "data/map.hpp"
 #include "data/player_model.hpp"
 #include "data/tutorial_messages.hpp"
+#include "engine/allocation_tracker.hpp"
 #include "engine/random_number_generator.hpp"
+#include "game_logic/actor_tag_counter.hpp"
 #include "game_logic/damage_components.hpp"
 #include "game_logic/earth_quake_effect.hpp"
 #include "game_logic/entity_factory.hpp"
+#include "game_logic/entity_snapshot.hpp"
 #include "game_logic/input.hpp"
 #include "game_logic/interactive/enemy_radar.hpp"
 #include "game_logic/player/components.hpp"
+#include "game_logic/state_hash.hpp"
 #include "ui/hud_renderer.hpp"
 #include "ui/ingame_message_display.hpp"
 
@@ -56,12 +61,17 @@ public:
     const data::GameSessionId& sessionId,
     GameMode::Context context,
     std::optional<base::Vector> playerPositionOverride = std::nullopt,
-    bool showWelcomeMessage = false);
+    bool showWelcomeMessage = false,
+    std::optional<data::map::LevelData> preloadedLevel = std::nullopt);
   ~GameWorld(); // NOLINT
 
   bool levelFinished() const;
   std::set<data::Bonus> achievedBonuses() const;
 
+  std::size_t entityCount() const {
+    return mEntities.size();
+  }
+
   void receive(const rigel::events::CheckPointActivated& event);
   void receive(const rigel::events::ExitReached& event);
   void receive(const rigel::events::PlayerDied& event);
@@ -75,15 +85,58 @@ public:
   void receive(const rigel::events::BossActivated& event);
 
   void updateGameLogic(const PlayerInput& input);
-  void render();
+  /** Render the world
+   *
+   * See engine::RenderingSystem::update() regarding the interpolation factor.
+   */
+  void render(float interpolationFactor = 1.0f);
+
+  /** Advance effects which run in real time instead of game logic time
+   *
+   * Should be called once per frame, with the time elapsed since the
+   * previous frame.
+   */
+  void updateRealTimeEffects(engine::TimeDelta dt);
   void processEndOfFrameActions();
 
+  /** Remember the current state of the level, to be restored by quickLoad()
+   *
+   * The state is kept in memory, and only for as long as the level is
+   * running. Returns false if the current state can't be captured, which
+   * happens when there are entities the snapshot doesn't support.
+   */
+  bool quickSave();
+  bool canQuickLoad() const;
+
+  /** Go back to the state stored by the last quickSave()
+   *
+   * Doesn't involve the level loader, the map and entities are restored
+   * straight from the saved copies.
+   */
+  void quickLoad();
+
+  std::size_t randomGeneratorState() const {
+    return mRandomGenerator.state();
+  }
+
+  void setRandomGeneratorState(const std::size_t state) {
+    mRandomGenerator.setState(state);
+  }
+
+  /** Fingerprint of the current state, see StateHash
+   *
+   * Meant to be called right after updateGameLogic(). Hashing visits every
+   * entity, so this is only done when recording or verifying replays.
+   */
+  StateHash computeStateHash();
+
   friend class rigel::GameRunner;
 
 private:
   void loadLevel(
     const data::GameSessionId& sessionId,
-    const loader::ResourceLoader& resources);
+    const loader::ResourceLoader& resources,
+    std::optional<data::map::LevelData> preloadedLevel);
 
   void onReactorDestroyed(const base::Vector& position);
   void updateReactorDestructionEvent();
@@ -122,12 +175,14 @@ private:
   entityx::EventManager mEventManager;
   entityx::EntityManager mEntities;
   EntityFactory mEntityFactory;
+  data::ViewPortSize mViewPortSize;
 
   data::PlayerModel* mpPlayerModel;
   data::PlayerModel mPlayerModelAtLevelStart;
   LevelBonusInfo mBonusInfo;
   std::optional<CheckpointData> mActivatedCheckpoint;
   std::optional<std::string> mLevelMusicFile;
+  std::string mLevelFileName;
 
   std::optional<base::Vector> mTeleportTargetPosition;
   entityx::Entity mActiveBossEntity;
@@ -141,12 +196,29 @@ private:
     data::map::BackdropSwitchCondition mBackdropSwitchCondition;
   };
 
+  struct QuickSaveData {
+    data::map::Map mMap;
+    EntitySnapshot mEntities;
+    entityx::Entity::Id mPlayerEntityId;
+    data::PlayerModel mPlayerModel;
+    LevelBonusInfo mBonusInfo;
+    std::optional<CheckpointData> mActivatedCheckpoint;
+    entityx::Entity mActiveBossEntity;
+    std::optional<EarthQuakeEffect> mEarthQuakeEffect;
+    std::optional<int> mReactorDestructionFramesElapsed;
+    std::size_t mRandomGeneratorState;
+    bool mBackdropSwitched;
+  };
+
   LevelData mLevelData;
-  data::map::Map mMapAtLevelStart;
+  std::optional<EntitySnapshot> mEntitiesAtLevelStart;
+  entityx::Entity::Id mPlayerEntityIdAtLevelStart;
+  std::optional<QuickSaveData> mQuickSave;
 
   std::unique_ptr<IngameSystems> mpSystems;
 
   RadarDishCounter mRadarDishCounter;
+  ActorTagCounter mActorTagCounter;
   engine::RandomNumberGenerator mRandomGenerator;
   ui::HudRenderer mHudRenderer;
   ui::IngameMessageDisplay mMessageDisplay;
@@ -156,6 +228,13 @@ private:
   std::optional<base::Color> mBackdropFlashColor;
   std::optional<int> mReactorDestructionFramesElapsed;
   int mScreenShakeOffsetX = 0;
+
+  StateHasher mStateHasher;
+
+  // Only filled in when building with allocation tracking
+  engine::allocation_tracking::Counters mAllocationsLastTick;
+  engine::allocation_tracking::Counters mAllocationsLastFrame;
+  engine::allocation_tracking::Counters mAllocationsAtLastRender;
 };
 
 }
@@ -28,6 +28,10 @@ RIGEL_RESTORE_WARNINGS
 namespace rigel {
   struct IGameServiceProvider;
 
+  namespace data {
+    struct ViewPortSize;
+  }
+
   namespace data::map {
     class Map;
   }
@@ -36,11 +40,13 @@ namespace rigel {
     class CollisionChecker;
     class ParticleSystem;
     class RandomNumberGenerator;
+    class TileDebrisSystem;
   }
 
   namespace game_logic {
     struct IEntityFactory;
     class Player;
+    struct PlayerPerception;
   }
 }
 
@@ -51,6 +57,7 @@ struct GlobalDependencies {
   const engine::CollisionChecker* mpCollisionChecker;
   engine::ParticleSystem* mpParticles;
   engine::RandomNumberGenerator* mpRandomGenerator;
+  engine::TileDebrisSystem* mpTileDebris;
   IEntityFactory* mpEntityFactory;
   IGameServiceProvider* mpServiceProvider;
   entityx::EntityManager* mpEntityManager;
@@ -68,20 +75,26 @@ struct PerFrameState {
 struct GlobalState {
   GlobalState(
     Player* pPlayer,
+    PlayerPerception* pPlayerPerception,
     const base::Vector* pCameraPosition,
     data::map::Map* pMap,
+    const data::ViewPortSize* pViewPortSize,
     const PerFrameState* pPerFrameState
   )
     : mpPlayer(pPlayer)
+    , mpPlayerPerception(pPlayerPerception)
     , mpCameraPosition(pCameraPosition)
     , mpMap(pMap)
+    , mpViewPortSize(pViewPortSize)
     , mpPerFrameState(pPerFrameState)
   {
   }
 
   Player* mpPlayer;
+  PlayerPerception* mpPlayerPerception;
   const base::Vector* mpCameraPosition;
   data::map::Map* mpMap;
+  const data::ViewPortSize* mpViewPortSize;
   const PerFrameState* mpPerFrameState;
 };
 
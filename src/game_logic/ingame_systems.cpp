@@ -17,6 +17,7 @@
 #include "ingame_systems.hpp"
 
 #include "data/player_model.hpp"
+#include "engine/allocation_tracker.hpp"
 #include "engine/random_number_generator.hpp"
 #include "game_logic/entity_factory.hpp"
 #include "game_logic/interactive/enemy_radar.hpp"
@@ -50,6 +51,7 @@ IngameSystems::IngameSystems(
   data::PlayerModel* pPlayerModel,
   data::map::Map* pMap,
   engine::MapRenderer::MapRenderData&& mapRenderData,
+  const data::ViewPortSize* pViewPortSize,
   IGameServiceProvider* pServiceProvider,
   EntityFactory* pEntityFactory,
   engine::RandomNumberGenerator* pRandomGenerator,
@@ -70,21 +72,35 @@ IngameSystems::IngameSystems(
       pEntityFactory,
       &eventManager,
       pRandomGenerator)
-  , mCamera(&mPlayer, *pMap, eventManager)
+  , mCamera(&mPlayer, *pMap, *pViewPortSize, eventManager)
+  , mEntityActivationSystem(*pMap, *pViewPortSize, eventManager)
+  , mSpritePrefetcher(pEntityFactory, &mCamera.position(), *pViewPortSize)
   , mParticles(pRandomGenerator, pRenderer)
+  , mSpriteAnimationSystem(eventManager)
   , mRenderingSystem(
       &mCamera.position(),
       pRenderer,
       pMap,
-      std::move(mapRenderData))
+      &mTileDebris,
+      *pViewPortSize,
+      std::move(mapRenderData),
+      entities,
+      eventManager)
   , mPhysicsSystem(&mCollisionChecker, pMap, &eventManager)
-  , mDebuggingSystem(pRenderer, &mCamera.position(), pMap)
+  , mLifeTimeSystem(entities, eventManager)
+  , mDebuggingSystem(
+      pRenderer,
+      &mCamera.position(),
+      pMap,
+      *pViewPortSize)
   , mPlayerInteractionSystem(
       sessionId,
       &mPlayer,
       pPlayerModel,
       pServiceProvider,
       pEntityFactory,
+      pMap,
+      entities,
       &eventManager,
       resources)
   , mPlayerDamageSystem(&mPlayer, &eventManager)
@@ -98,7 +114,7 @@ IngameSystems::IngameSystems(
   , mDamageInflictionSystem(pPlayerModel, pServiceProvider, &eventManager)
   , mDynamicGeometrySystem(
       pServiceProvider,
-      &entities,
+      &mTileDebris,
       pMap,
       pRandomGenerator,
       &eventManager)
@@ -111,18 +127,18 @@ IngameSystems::IngameSystems(
       eventManager)
   , mItemContainerSystem(&entities, eventManager)
   , mBlueGuardSystem(
-      &mPlayer,
+      &mPlayerPerception,
       &mCollisionChecker,
       pEntityFactory,
       pServiceProvider,
       pRandomGenerator,
       eventManager)
   , mHoverBotSystem(
-      playerEntity,
+      &mPlayerPerception,
       &mCollisionChecker,
       pEntityFactory)
   , mLaserTurretSystem(
-      playerEntity,
+      &mPlayerPerception,
       pPlayerModel,
       pEntityFactory,
       pRandomGenerator,
@@ -136,11 +152,19 @@ IngameSystems::IngameSystems(
       &mParticles,
       pRandomGenerator,
       eventManager)
-  , mRocketTurretSystem(playerEntity, pEntityFactory, pServiceProvider)
+  , mRocketTurretSystem(
+      &mPlayerPerception,
+      pEntityFactory,
+      pServiceProvider)
   , mSimpleWalkerSystem(
       playerEntity,
       &mCollisionChecker)
-  , mSlidingDoorSystem(playerEntity, pServiceProvider)
+  , mSlidingDoorSystem(
+      playerEntity,
+      pServiceProvider,
+      *pMap,
+      entities,
+      eventManager)
   , mSlimeBlobSystem(
       &mPlayer,
       &mCollisionChecker,
@@ -159,16 +183,20 @@ IngameSystems::IngameSystems(
         &mCollisionChecker,
         &mParticles,
         pRandomGenerator,
+        &mTileDebris,
         pEntityFactory,
         pServiceProvider,
         &entities,
         &eventManager},
       &mPlayer,
+      &mPlayerPerception,
       &mCamera.position(),
-      pMap)
+      pMap,
+      pViewPortSize)
   , mpRandomGenerator(pRandomGenerator)
   , mpServiceProvider(pServiceProvider)
 {
+  mPlayerPerception.update(mPlayer);
 }
 
 
@@ -176,74 +204,124 @@ void IngameSystems::update(
   const PlayerInput& input,
   entityx::EntityManager& es
 ) {
+  auto profiled = [this](const char* pName, auto&& func) {
+    engine::allocation_tracking::Scope allocationScope(pName);
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+    const auto collisionStatisticsBefore = mCollisionChecker.statistics();
+#endif
+    engine::profileSection(mProfiler, pName, func);
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+    mProfiler.addCollisionStatistics(
+      pName, mCollisionChecker.statistics() - collisionStatisticsBefore);
+#endif
+  };
+
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+  mProfiler.beginTick();
+#endif
+
+  mRenderingSystem.rememberPreviousPositions(es);
+
   // ----------------------------------------------------------------------
   // Animation update
   // ----------------------------------------------------------------------
-  mRenderingSystem.updateAnimatedMapTiles();
-  engine::updateAnimatedSprites(es);
-  interaction::animateForceFields(es, *mpRandomGenerator, *mpServiceProvider);
+  profiled("Animation", [&]() {
+    mRenderingSystem.updateAnimatedMapTiles();
+    mSpriteAnimationSystem.update(es);
+    interaction::animateForceFields(
+      es, *mpRandomGenerator, *mpServiceProvider);
+  });
 
   // ----------------------------------------------------------------------
   // Player update, camera, mark active entities
   // ----------------------------------------------------------------------
-  mPlayerInteractionSystem.updatePlayerInteraction(input, es);
+  profiled("Player interaction", [&]() {
+    mPlayerInteractionSystem.updatePlayerInteraction(input, es);
+  });
 
-  mPlayer.update(input);
-  mCamera.update(input);
-  engine::markActiveEntities(es, mCamera.position());
+  profiled("Player", [&]() { mPlayer.update(input); });
+  profiled("Camera", [&]() { mCamera.update(input); });
+  profiled("Entity activation", [&]() {
+    mEntityActivationSystem.update(es, mCamera.position());
+  });
+  profiled("Sprite prefetching", [&]() { mSpritePrefetcher.update(es); });
 
   // ----------------------------------------------------------------------
   // Player related logic update
   // ----------------------------------------------------------------------
-  mElevatorSystem.update(es);
-  mRadarComputerSystem.update(es);
+  profiled("Elevator", [&]() { mElevatorSystem.update(es); });
+  profiled("Radar computer", [&]() { mRadarComputerSystem.update(es); });
 
   // ----------------------------------------------------------------------
   // A.I. logic update
   // ----------------------------------------------------------------------
-  mBlueGuardSystem.update(es);
-  mHoverBotSystem.update(es);
-  mLaserTurretSystem.update(es);
-  mMessengerDroneSystem.update(es);
-  mPrisonerSystem.update(es);
-  mRocketTurretSystem.update(es);
-  mSimpleWalkerSystem.update(es);
-  mSlidingDoorSystem.update(es);
-  mSlimeBlobSystem.update(es);
-  mSpiderSystem.update(es);
-  mSpikeBallSystem.update(es);
-  mBehaviorControllerSystem.update(es, input);
+  // Within a world, these need to run one after the other, on the thread
+  // owning the world's renderer. Besides moving their own entities, they
+  // assign components, spawn entities (which can upload new sprites to the
+  // texture atlas) and see each other's changes through the collision
+  // checker. The order in which that happens is part of the game's behavior.
+  // Separate worlds with their own renderers can still be updated in
+  // parallel, as rigel_sim does.
+  mPlayerPerception.update(mPlayer);
+
+  profiled("Blue guard", [&]() { mBlueGuardSystem.update(es); });
+  profiled("Hover bot", [&]() { mHoverBotSystem.update(es); });
+  profiled("Laser turret", [&]() { mLaserTurretSystem.update(es); });
+  profiled("Messenger drone", [&]() { mMessengerDroneSystem.update(es); });
+  profiled("Prisoner", [&]() { mPrisonerSystem.update(es); });
+  profiled("Rocket turret", [&]() { mRocketTurretSystem.update(es); });
+  profiled("Simple walker", [&]() { mSimpleWalkerSystem.update(es); });
+  profiled("Sliding door", [&]() { mSlidingDoorSystem.update(es); });
+  profiled("Slime blob", [&]() { mSlimeBlobSystem.update(es); });
+  profiled("Spider", [&]() { mSpiderSystem.update(es); });
+  profiled("Spike ball", [&]() { mSpikeBallSystem.update(es); });
+  profiled("Behavior controllers", [&]() {
+    mBehaviorControllerSystem.update(es, input);
+  });
 
   // ----------------------------------------------------------------------
   // Physics and other updates
   // ----------------------------------------------------------------------
-  mPhysicsSystem.updatePhase1(es);
+  profiled("Physics", [&]() { mPhysicsSystem.updatePhase1(es); });
 
   // Collect items after physics, so that any collectible
   // items are in their final positions for this frame.
-  mPlayerInteractionSystem.updateItemCollection(es);
+  profiled("Item collection", [&]() {
+    mPlayerInteractionSystem.updateItemCollection(es);
+  });
 
-  mPlayerDamageSystem.update(es);
-  mDamageInflictionSystem.update(es);
-  mItemContainerSystem.update(es);
+  profiled("Player damage", [&]() { mPlayerDamageSystem.update(es); });
+  profiled("Damage infliction", [&]() { mDamageInflictionSystem.update(es); });
+  profiled("Item containers", [&]() { mItemContainerSystem.update(es); });
 
-  mPlayerProjectileSystem.update(es);
+  profiled("Player projectiles", [&]() {
+    mPlayerProjectileSystem.update(es);
+  });
 
-  mEffectsSystem.update(es);
-  mLifeTimeSystem.update(es);
+  profiled("Effects", [&]() { mEffectsSystem.update(es); });
+  profiled("Life time", [&]() { mLifeTimeSystem.update(); });
 
   // Now process any MovingBody objects that have been spawned after phase 1
-  mPhysicsSystem.updatePhase2(es);
+  profiled("Physics", [&]() { mPhysicsSystem.updatePhase2(es); });
 
-  mParticles.update();
+  // Moves debris spawned at any point during this update as well, like the
+  // two physics phases together do for regular entities
+  profiled("Tile debris", [&]() { mTileDebris.update(); });
+
+  profiled("Particles", [&]() { mParticles.update(); });
+
+#ifdef RIGEL_ENABLE_LOGIC_PROFILER
+  mProfiler.endTick(es.size());
+#endif
 }
 
 
 void IngameSystems::render(
   entityx::EntityManager& es,
-  const std::optional<base::Color>& backdropFlashColor
+  const std::optional<base::Color>& backdropFlashColor,
+  const float interpolationFactor
 ) {
-  mRenderingSystem.update(es, backdropFlashColor);
+  mRenderingSystem.update(es, backdropFlashColor, interpolationFactor);
   mParticles.render(mCamera.position());
   mDebuggingSystem.update(es);
 }
@@ -259,7 +337,13 @@ void IngameSystems::switchBackdrops() {
 }
 
 
+void IngameSystems::updateBackdropAutoScroll(const engine::TimeDelta dt) {
+  mRenderingSystem.updateBackdropAutoScroll(dt);
+}
+
+
 void IngameSystems::restartFromBeginning(entityx::Entity newPlayerEntity) {
+  mTileDebris.clear();
   mPlayer.resetAfterDeath(newPlayerEntity);
 }
 
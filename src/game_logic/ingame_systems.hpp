@@ -19,10 +19,12 @@
 #include "engine/collision_checker.hpp"
 #include "engine/entity_activation_system.hpp"
 #include "engine/life_time_system.hpp"
+#include "engine/logic_profiler.hpp"
 #include "engine/particle_system.hpp"
 #include "engine/physics_system.hpp"
 #include "engine/rendering_system.hpp"
 #include "engine/rendering_system.hpp"
+#include "engine/tile_debris_system.hpp"
 #include "game_logic/behavior_controller_system.hpp"
 #include "game_logic/camera.hpp"
 #include "game_logic/damage_infliction_system.hpp"
@@ -47,6 +49,8 @@
 #include "game_logic/player/damage_system.hpp"
 #include "game_logic/player/interaction_system.hpp"
 #include "game_logic/player/projectile_system.hpp"
+#include "game_logic/player_perception.hpp"
+#include "game_logic/sprite_prefetcher.hpp"
 
 #include <iosfwd>
 
@@ -75,6 +79,7 @@ public:
     data::PlayerModel* pPlayerModel,
     data::map::Map* pMap,
     engine::MapRenderer::MapRenderData&& mapRenderData,
+    const data::ViewPortSize* pViewPortSize,
     IGameServiceProvider* pServiceProvider,
     EntityFactory* pEntityFactory,
     engine::RandomNumberGenerator* pRandomGenerator,
@@ -87,30 +92,52 @@ public:
   void update(const PlayerInput& inputState, entityx::EntityManager& es);
   void render(
     entityx::EntityManager& es,
-    const std::optional<base::Color>& backdropFlashColor);
+    const std::optional<base::Color>& backdropFlashColor,
+    float interpolationFactor);
 
   DebuggingSystem& debuggingSystem();
 
+  engine::LifeTimeSystem& lifeTimeSystem() {
+    return mLifeTimeSystem;
+  }
+
   void switchBackdrops();
+  void updateBackdropAutoScroll(engine::TimeDelta dt);
 
   void restartFromBeginning(entityx::Entity newPlayerEntity);
   void restartFromCheckpoint(const base::Vector& checkpointPosition);
 
   void centerViewOnPlayer();
 
+  const base::Vector& cameraPosition() const {
+    return mCamera.position();
+  }
+
   Player& player() {
     return mPlayer;
   }
 
   void printDebugText(std::ostream& stream) const;
 
+  const engine::LogicProfiler& profiler() const {
+    return mProfiler;
+  }
+
 private:
+  engine::LogicProfiler mProfiler;
+
   engine::CollisionChecker mCollisionChecker;
   Player mPlayer;
+  PlayerPerception mPlayerPerception;
   Camera mCamera;
 
+  engine::EntityActivationSystem mEntityActivationSystem;
+  SpritePrefetcher mSpritePrefetcher;
+
   engine::ParticleSystem mParticles;
+  engine::TileDebrisSystem mTileDebris;
 
+  engine::SpriteAnimationSystem mSpriteAnimationSystem;
   engine::RenderingSystem mRenderingSystem;
   engine::PhysicsSystem mPhysicsSystem;
   engine::LifeTimeSystem mLifeTimeSystem;
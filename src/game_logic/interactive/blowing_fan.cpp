@@ -19,6 +19,7 @@
 #include "common/game_service_provider.hpp"
 #include "engine/visual_components.hpp"
 #include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -88,6 +89,7 @@ void BlowingFan::update(
   // Update attaching player
   if (mStep > 24 && playerInRange() && !s.mpPlayer->isDead()) {
     s.mpPlayer->beginBeingPushedByFan();
+    s.mpPlayerPerception->update(*s.mpPlayer);
     mIsPushingPlayer = true;
 
     if (
@@ -101,6 +103,7 @@ void BlowingFan::update(
 
   if (mIsPushingPlayer && (mStep < 25 || !playerInRange())) {
     s.mpPlayer->endBeingPushedByFan();
+    s.mpPlayerPerception->update(*s.mpPlayer);
     mIsPushingPlayer = false;
   }
 }
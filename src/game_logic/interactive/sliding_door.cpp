@@ -18,6 +18,7 @@
 
 #include "common/game_service_provider.hpp"
 #include "data/game_traits.hpp"
+#include "data/map.hpp"
 #include "data/unit_conversions.hpp"
 #include "engine/base_components.hpp"
 #include "engine/entity_tools.hpp"
@@ -47,6 +48,27 @@ bool playerInRange(
   return worldSpaceDoorRange.containsPoint(playerPos);
 }
 
+
+bool byIndex(const entityx::Entity lhs, const entityx::Entity rhs) {
+  return lhs.id().index() < rhs.id().index();
+}
+
+
+bool isAtRest(const components::HorizontalSlidingDoor& state) {
+  return
+    state.mState == components::HorizontalSlidingDoor::State::Closed &&
+    !state.mPlayerWasInRange &&
+    state.mCollisionHelper;
+}
+
+
+bool isAtRest(const components::VerticalSlidingDoor& state) {
+  return
+    state.mState == components::VerticalSlidingDoor::State::Closed &&
+    !state.mPlayerWasInRange &&
+    state.mSlideStep == 0;
+}
+
 }
 
 
@@ -146,13 +168,94 @@ int stepChangeForState(const State state) {
 }} // namespace vertical
 
 
+SlidingDoorSystem::DoorSet::DoorSet(
+  const data::map::Map& map,
+  const base::Rect<int>& range
+)
+  : mRange(range)
+  , mTriggerAreas(map.width(), map.height())
+{
+}
+
+
+void SlidingDoorSystem::DoorSet::add(entityx::Entity door) {
+  if (door.has_component<WorldPosition>()) {
+    mTriggerAreas.insert(door, mRange + *door.component<const WorldPosition>());
+  }
+
+  mBusyDoors.push_back(door);
+}
+
+
+void SlidingDoorSystem::DoorSet::remove(entityx::Entity door) {
+  mTriggerAreas.remove(door);
+  mBusyDoors.erase(
+    std::remove(mBusyDoors.begin(), mBusyDoors.end(), door),
+    mBusyDoors.end());
+}
+
+
+void SlidingDoorSystem::DoorSet::clear() {
+  mTriggerAreas.clear();
+  mBusyDoors.clear();
+}
+
+
+const std::vector<entityx::Entity>&
+  SlidingDoorSystem::DoorSet::doorsToUpdate(const base::Vector& playerPosition)
+{
+  mDoorsToUpdate = mBusyDoors;
+  for (
+    const auto door :
+    mTriggerAreas.entitiesNear(engine::components::BoundingBox{
+      playerPosition, {1, 1}})
+  ) {
+    mDoorsToUpdate.push_back(door);
+  }
+
+  std::sort(mDoorsToUpdate.begin(), mDoorsToUpdate.end(), byIndex);
+  mDoorsToUpdate.erase(
+    std::unique(mDoorsToUpdate.begin(), mDoorsToUpdate.end()),
+    mDoorsToUpdate.end());
+
+  mBusyDoors.clear();
+  return mDoorsToUpdate;
+}
+
+
 SlidingDoorSystem::SlidingDoorSystem(
   entityx::Entity playerEntity,
-  IGameServiceProvider* pServiceProvider
+  IGameServiceProvider* pServiceProvider,
+  const data::map::Map& map,
+  entityx::EntityManager& entities,
+  entityx::EventManager& events
 )
   : mPlayerEntity(playerEntity)
   , mpServiceProvider(pServiceProvider)
+  , mpEvents(&events)
+  , mHorizontalDoors(map, HORIZONTAL_DOOR_RANGE)
+  , mVerticalDoors(map, VERTICAL_DOOR_RANGE)
 {
+  using components::HorizontalSlidingDoor;
+  using components::VerticalSlidingDoor;
+
+  events.subscribe<entityx::ComponentAddedEvent<HorizontalSlidingDoor>>(
+    *this);
+  events.subscribe<entityx::ComponentRemovedEvent<HorizontalSlidingDoor>>(
+    *this);
+  events.subscribe<entityx::ComponentAddedEvent<VerticalSlidingDoor>>(*this);
+  events.subscribe<entityx::ComponentRemovedEvent<VerticalSlidingDoor>>(
+    *this);
+  events.subscribe<engine::events::ClearingAllEntities>(*this);
+
+  entities.each<HorizontalSlidingDoor>(
+    [this](entityx::Entity entity, const HorizontalSlidingDoor&) {
+      mHorizontalDoors.add(entity);
+    });
+  entities.each<VerticalSlidingDoor>(
+    [this](entityx::Entity entity, const VerticalSlidingDoor&) {
+      mVerticalDoors.add(entity);
+    });
 }
 
 
@@ -162,70 +265,139 @@ void SlidingDoorSystem::update(entityx::EntityManager& es) {
   using engine::components::BoundingBox;
   using engine::components::SolidBody;
   using components::HorizontalSlidingDoor;
-  es.each<WorldPosition, BoundingBox, Sprite, HorizontalSlidingDoor>(
-    [this, &playerPosition, &es](
-      entityx::Entity entity,
-      const WorldPosition& position,
-      BoundingBox& boundingBox,
-      Sprite& sprite,
-      HorizontalSlidingDoor& state
+
+  // A door at rest with the player out of range would stay as it is, so
+  // skipping it doesn't change anything.
+  for (auto entity : mHorizontalDoors.doorsToUpdate(playerPosition)) {
+    if (
+      !entity.has_component<WorldPosition>() ||
+      !entity.has_component<BoundingBox>() ||
+      !entity.has_component<Sprite>()
     ) {
-      if (!state.mCollisionHelper) {
-        auto collisionHelper = es.create();
-        collisionHelper.assign<BoundingBox>(BoundingBox{{}, {1, 1}});
-        collisionHelper.assign<WorldPosition>(position);
-        collisionHelper.assign<engine::components::Active>();
-        collisionHelper.assign<SolidBody>();
-        state.mCollisionHelper = collisionHelper;
-      }
+      continue;
+    }
+
+    const auto& position = *entity.component<const WorldPosition>();
+    auto& boundingBox = *entity.component<BoundingBox>();
+    auto& sprite = *entity.component<Sprite>();
+    auto& state = *entity.component<HorizontalSlidingDoor>();
+
+    if (!state.mCollisionHelper) {
+      auto collisionHelper = es.create();
+      collisionHelper.assign<BoundingBox>(BoundingBox{{}, {1, 1}});
+      collisionHelper.assign<WorldPosition>(position);
+      collisionHelper.assign<engine::components::Active>();
+      collisionHelper.assign<SolidBody>();
+      state.mCollisionHelper = collisionHelper;
+    }
+
+    const auto inRange =
+      playerInRange(playerPosition, position, HORIZONTAL_DOOR_RANGE);
+    const auto previousState = state.mState;
+    state.mState = horizontal::nextState(previousState, inRange);
+
+    const auto previousBoundingBox = boundingBox;
+    if (state.mState == horizontal::State::Closed) {
+      boundingBox.topLeft.x = 0;
+      boundingBox.size.width = 6;
+    } else {
+      boundingBox.topLeft.x = 5;
+      boundingBox.size.width = 1;
+    }
+
+    if (boundingBox != previousBoundingBox) {
+      mpEvents->emit(engine::events::SolidBodyChanged{entity});
+    }
+
+    const auto missingLeftEdgeCollision =
+      previousState == horizontal::State::Closed &&
+      state.mState == horizontal::State::HalfOpen;
+    engine::setTag<SolidBody>(
+      state.mCollisionHelper, !missingLeftEdgeCollision);
+
+    sprite.mFramesToRender[0] = static_cast<int>(state.mState);
+    updateSoundGeneration(inRange, state);
+
+    if (!isAtRest(state)) {
+      mHorizontalDoors.mBusyDoors.push_back(entity);
+    }
+  }
 
-      const auto inRange =
-        playerInRange(playerPosition, position, HORIZONTAL_DOOR_RANGE);
-      const auto previousState = state.mState;
-      state.mState = horizontal::nextState(previousState, inRange);
-
-      if (state.mState == horizontal::State::Closed) {
-        boundingBox.topLeft.x = 0;
-        boundingBox.size.width = 6;
-      } else {
-        boundingBox.topLeft.x = 5;
-        boundingBox.size.width = 1;
-      }
+  for (auto entity : mVerticalDoors.doorsToUpdate(playerPosition)) {
+    if (
+      !entity.has_component<WorldPosition>() ||
+      !entity.has_component<BoundingBox>()
+    ) {
+      continue;
+    }
+
+    const auto& position = *entity.component<const WorldPosition>();
+    auto& boundingBox = *entity.component<BoundingBox>();
+    auto& state = *entity.component<components::VerticalSlidingDoor>();
+
+    const auto inRange =
+      playerInRange(playerPosition, position, VERTICAL_DOOR_RANGE);
+    state.mState = vertical::nextState(state, inRange);
+
+    const auto stepChange = vertical::stepChangeForState(state.mState);
+    state.mSlideStep = std::clamp(state.mSlideStep + stepChange, 0, 7);
+
+    const auto previousBoundingBox = boundingBox;
+    if (state.mState == vertical::State::Closed) {
+      boundingBox.topLeft.y = 0;
+      boundingBox.size.height = 8;
+    } else {
+      boundingBox.topLeft.y = -7;
+      boundingBox.size.height = 1;
+    }
+
+    if (boundingBox != previousBoundingBox) {
+      mpEvents->emit(engine::events::SolidBodyChanged{entity});
+    }
+
+    updateSoundGeneration(inRange, state);
+
+    if (!isAtRest(state)) {
+      mVerticalDoors.mBusyDoors.push_back(entity);
+    }
+  }
+}
 
-      const auto missingLeftEdgeCollision =
-        previousState == horizontal::State::Closed &&
-        state.mState == horizontal::State::HalfOpen;
-      engine::setTag<SolidBody>(
-        state.mCollisionHelper, !missingLeftEdgeCollision);
 
-      sprite.mFramesToRender[0] = static_cast<int>(state.mState);
-      updateSoundGeneration(inRange, state);
-    });
+void SlidingDoorSystem::receive(
+  const entityx::ComponentAddedEvent<components::HorizontalSlidingDoor>&
+    event
+) {
+  mHorizontalDoors.add(event.entity);
+}
 
-  es.each<WorldPosition, BoundingBox, components::VerticalSlidingDoor>(
-    [this, &playerPosition](
-      entityx::Entity entity,
-      const WorldPosition& position,
-      BoundingBox& boundingBox,
-      components::VerticalSlidingDoor& state
-    ) {
-      const auto inRange =
-        playerInRange(playerPosition, position, VERTICAL_DOOR_RANGE);
-      state.mState = vertical::nextState(state, inRange);
-
-      const auto stepChange = vertical::stepChangeForState(state.mState);
-      state.mSlideStep = std::clamp(state.mSlideStep + stepChange, 0, 7);
-
-      if (state.mState == vertical::State::Closed) {
-        boundingBox.topLeft.y = 0;
-        boundingBox.size.height = 8;
-      } else {
-        boundingBox.topLeft.y = -7;
-        boundingBox.size.height = 1;
-      }
 
-      updateSoundGeneration(inRange, state);
-    });
+void SlidingDoorSystem::receive(
+  const entityx::ComponentRemovedEvent<components::HorizontalSlidingDoor>&
+    event
+) {
+  mHorizontalDoors.remove(event.entity);
+}
+
+
+void SlidingDoorSystem::receive(
+  const entityx::ComponentAddedEvent<components::VerticalSlidingDoor>& event
+) {
+  mVerticalDoors.add(event.entity);
+}
+
+
+void SlidingDoorSystem::receive(
+  const entityx::ComponentRemovedEvent<components::VerticalSlidingDoor>&
+    event
+) {
+  mVerticalDoors.remove(event.entity);
+}
+
+
+void SlidingDoorSystem::receive(const engine::events::ClearingAllEntities&) {
+  mHorizontalDoors.clear();
+  mVerticalDoors.clear();
 }
 
 
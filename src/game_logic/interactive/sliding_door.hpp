@@ -18,6 +18,8 @@
 
 #include "base/warnings.hpp"
 #include "engine/base_components.hpp"
+#include "engine/entity_grid.hpp"
+#include "engine/entity_tools.hpp"
 #include "engine/visual_components.hpp"
 #include "renderer/renderer.hpp"
 
@@ -25,7 +27,10 @@ RIGEL_DISABLE_WARNINGS
 #include <entityx/entityx.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <vector>
+
 namespace rigel { struct IGameServiceProvider; }
+namespace rigel::data::map { class Map; }
 
 
 namespace rigel::game_logic { namespace ai {
@@ -61,21 +66,74 @@ struct VerticalSlidingDoor {
 }
 
 
-class SlidingDoorSystem {
+/** Opens and closes doors as the player approaches and leaves them
+ *
+ * A door only needs updating while the player is within its range, or while
+ * it's still moving. The areas in which doors react to the player are kept
+ * in a spatial index, so finding the doors in range doesn't require going
+ * through all of them. Door positions are expected to be assigned before
+ * the door components. Doors never move, so the areas are computed once
+ * when a door is added. Only the bounding box changes as a door opens.
+ */
+class SlidingDoorSystem : public entityx::Receiver<SlidingDoorSystem> {
 public:
   SlidingDoorSystem(
     entityx::Entity playerEntity,
-    IGameServiceProvider* pServiceProvider);
+    IGameServiceProvider* pServiceProvider,
+    const data::map::Map& map,
+    entityx::EntityManager& entities,
+    entityx::EventManager& events);
 
   void update(entityx::EntityManager& es);
 
+  void receive(
+    const entityx::ComponentAddedEvent<components::HorizontalSlidingDoor>&
+      event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::HorizontalSlidingDoor>&
+      event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::VerticalSlidingDoor>&
+      event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::VerticalSlidingDoor>&
+      event);
+  void receive(const engine::events::ClearingAllEntities& event);
+
 private:
+  /** All doors of one kind */
+  struct DoorSet {
+    DoorSet(const data::map::Map& map, const base::Rect<int>& range);
+
+    void add(entityx::Entity door);
+    void remove(entityx::Entity door);
+    void clear();
+
+    /** Doors in range of the player, plus those which were still moving
+     *
+     * Ordered by entity index.
+     */
+    const std::vector<entityx::Entity>& doorsToUpdate(
+      const base::Vector& playerPosition);
+
+    base::Rect<int> mRange;
+    engine::EntityGrid mTriggerAreas;
+
+    // Doors which weren't at rest after the last update. Newly added doors
+    // start out in this list, so that they get updated at least once.
+    std::vector<entityx::Entity> mBusyDoors;
+    std::vector<entityx::Entity> mDoorsToUpdate;
+  };
+
   template<typename StateT>
   void updateSoundGeneration(const bool inRange, StateT& state);
 
 private:
   entityx::Entity mPlayerEntity;
   IGameServiceProvider* mpServiceProvider;
+  entityx::EventManager* mpEvents;
+  DoorSet mHorizontalDoors;
+  DoorSet mVerticalDoors;
 };
 
 }
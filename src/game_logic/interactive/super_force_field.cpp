@@ -28,6 +28,7 @@
 #include "game_logic/damage_components.hpp"
 #include "game_logic/entity_factory.hpp"
 #include "game_logic/player.hpp"
+#include "game_logic/player_perception.hpp"
 
 
 namespace rigel::game_logic::behaviors {
@@ -131,6 +132,8 @@ void SuperForceField::update(
       if (playerPos.x + 2 > position.x) {
         ++playerPos.x;
       }
+
+      s.mpPlayerPerception->update(*s.mpPlayer);
     }
   }
 }
@@ -784,7 +784,8 @@ void Player::updateMovement(
           ? worldBBox.top() - 1
           : worldBBox.bottom() + 1;
 
-        const auto canContinue = mpMap->attributes(attachX, nextY).isLadder();
+        const auto canContinue =
+          mpMap->hasFeature(attachX, nextY, data::map::TileFeature::Ladder);
 
         if (canContinue) {
           moveVertically(*mpCollisionChecker, mEntity, movement);
@@ -839,7 +840,10 @@ void Player::updateMovement(
           const auto result = moveHorizontally(
             *mpCollisionChecker, mEntity, orientationAsMovement);
           if (result != MovementResult::Failed) {
-            if (mpMap->attributes(testX, worldBBox.top() - 1).isClimbable()) {
+            if (mpMap->hasFeature(
+                  testX,
+                  worldBBox.top() - 1,
+                  data::map::TileFeature::Climbable)) {
               setVisualState(VisualState::MovingOnPipe);
             } else {
               startFallingDelayed();
@@ -948,24 +952,19 @@ void Player::updateLadderAttachment(const base::Vector& movementVector) {
   if (canAttachToLadder && wantsToAttach) {
     const auto worldBBox = engine::toWorldSpace(bbox, position);
 
-    std::optional<base::Vector> maybeLadderTouchPoint;
-    for (int i = 0; i < worldBBox.size.width; ++i) {
-      const auto attributes =
-        mpMap->attributes(worldBBox.left() + i, worldBBox.top());
-      if (attributes.isLadder()) {
-        maybeLadderTouchPoint =
-          base::Vector{worldBBox.left() + i, worldBBox.top()};
-        break;
-      }
-    }
+    const auto maybeLadderX = mpMap->findFeatureInRow(
+      worldBBox.top(),
+      worldBBox.left(),
+      worldBBox.right(),
+      data::map::TileFeature::Ladder);
 
-    if (maybeLadderTouchPoint) {
+    if (maybeLadderX) {
       mState = ClimbingLadder{};
       setVisualState(VisualState::ClimbingLadder);
 
       // snap player to ladder
       const auto playerCenterX = worldBBox.topLeft.x + worldBBox.size.width / 2;
-      const auto offsetToCenter = playerCenterX - maybeLadderTouchPoint->x;
+      const auto offsetToCenter = playerCenterX - *maybeLadderX;
       position.x -= offsetToCenter;
     }
   }
@@ -1152,22 +1151,17 @@ Player::VerticalMovementResult Player::moveVerticallyInAir(const int amount) {
       --worldBBox.topLeft.y;
     }
 
-    std::optional<base::Vector> maybeClimbableTouchPoint;
-    for (int i = 0; i < worldBBox.size.width; ++i) {
-      const auto attributes =
-        mpMap->attributes(worldBBox.left() + i, worldBBox.top());
-      if (attributes.isClimbable()) {
-        maybeClimbableTouchPoint =
-          base::Vector{worldBBox.left() + i, worldBBox.top()};
-        break;
-      }
-    }
+    const auto maybeClimbableX = mpMap->findFeatureInRow(
+      worldBBox.top(),
+      worldBBox.left(),
+      worldBBox.right(),
+      data::map::TileFeature::Climbable);
 
-    if (maybeClimbableTouchPoint) {
+    if (maybeClimbableX) {
       setVisualState(VisualState::HangingFromPipe);
       mState = OnPipe{};
       mpServiceProvider->playSound(data::SoundId::DukeAttachClimbable);
-      position().y = maybeClimbableTouchPoint->y + PLAYER_HEIGHT;
+      position().y = worldBBox.top() + PLAYER_HEIGHT;
       result.mAttachedToClimbable = true;
       break;
     }
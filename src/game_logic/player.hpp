@@ -245,6 +245,10 @@ public:
     return *mpPlayerModel;
   }
 
+  entityx::Entity entity() const {
+    return mEntity;
+  }
+
   void receive(const events::ElevatorAttachmentChanged& event);
 
   bool hasSpiderAt(const SpiderClingPosition position) const {
@@ -115,17 +115,21 @@ data::TutorialMessageId tutorialFor(const components::InteractableType type) {
 
 
 std::optional<base::Vector> findTeleporterTargetPosition(
-  ex::EntityManager& es,
+  const engine::EntitySlotList& interactables,
   ex::Entity sourceTeleporter
 ) {
-  ex::ComponentHandle<components::Interactable> interactable;
-  ex::ComponentHandle<WorldPosition> position;
-
+  // If there are more than two teleporters, the one with the highest entity
+  // index wins. This matches going through all entities in order and taking
+  // the last match, which is what older versions did.
   ex::Entity targetTeleporter;
-  for (auto entity : es.entities_with_components(interactable, position)) {
+  for (auto entity : interactables) {
     if (
-      interactable->mType == components::InteractableType::Teleporter &&
-      entity != sourceTeleporter
+      entity != sourceTeleporter &&
+      entity.has_component<WorldPosition>() &&
+      entity.component<const Interactable>()->mType ==
+        components::InteractableType::Teleporter &&
+      (!targetTeleporter ||
+        entity.id().index() > targetTeleporter.id().index())
     ) {
       targetTeleporter = entity;
     }
@@ -155,6 +159,8 @@ PlayerInteractionSystem::PlayerInteractionSystem(
   PlayerModel* pPlayerModel,
   IGameServiceProvider* pServices,
   EntityFactory* pEntityFactory,
+  const data::map::Map* pMap,
+  entityx::EntityManager& entities,
   entityx::EventManager* pEvents,
   const loader::ResourceLoader& resources
 )
@@ -165,8 +171,23 @@ PlayerInteractionSystem::PlayerInteractionSystem(
   , mpEvents(pEvents)
   , mLevelHints(loadHints(resources))
   , mSessionId(sessionId)
+  , mInteractables(pMap->width(), pMap->height())
+  , mCollectables(pMap->width(), pMap->height())
 {
+  entities.each<Interactable>([this](ex::Entity entity, const Interactable&) {
+    mInteractables.insert(entity);
+  });
+  entities.each<CollectableItem>(
+    [this](ex::Entity entity, const CollectableItem&) {
+      mCollectables.insert(entity);
+    });
+
   mpEvents->subscribe<rigel::events::CloakExpired>(*this);
+  mpEvents->subscribe<ex::ComponentAddedEvent<Interactable>>(*this);
+  mpEvents->subscribe<ex::ComponentRemovedEvent<Interactable>>(*this);
+  mpEvents->subscribe<ex::ComponentAddedEvent<CollectableItem>>(*this);
+  mpEvents->subscribe<ex::ComponentRemovedEvent<CollectableItem>>(*this);
+  mpEvents->subscribe<engine::events::ClearingAllEntities>(*this);
 }
 
 
@@ -202,33 +223,33 @@ void PlayerInteractionSystem::updatePlayerInteraction(
   };
 
 
-  auto performedInteraction = false;
-  es.each<Interactable, WorldPosition, BoundingBox>(
-    [&, this](
-      ex::Entity entity,
-      const Interactable& interactable,
-      const WorldPosition& pos,
-      const BoundingBox& bbox
+  for (auto entity : mInteractables.entitiesNear(worldSpacePlayerBounds)) {
+    if (
+      !entity.has_component<WorldPosition>() ||
+      !entity.has_component<BoundingBox>()
     ) {
-      if (performedInteraction) {
-        return;
-      }
+      continue;
+    }
 
-      const auto isHintMachine =
-        interactable.mType == InteractableType::HintMachine;
-      const auto playerHasHintGlobe =
-        mpPlayerModel->hasItem(data::InventoryItemType::SpecialHintGlobe);
-
-      const auto objectBounds = engine::toWorldSpace(bbox, pos);
-      if (isInRange(objectBounds, interactable.mType)) {
-        if (interactionWanted || (isHintMachine && playerHasHintGlobe)) {
-          performInteraction(es, entity, interactable.mType);
-          performedInteraction = true;
-        } else {
-          showTutorialMessage(tutorialFor(interactable.mType));
-        }
+    const auto& interactable = *entity.component<const Interactable>();
+    const auto& pos = *entity.component<const WorldPosition>();
+    const auto& bbox = *entity.component<const BoundingBox>();
+
+    const auto isHintMachine =
+      interactable.mType == InteractableType::HintMachine;
+    const auto playerHasHintGlobe =
+      mpPlayerModel->hasItem(data::InventoryItemType::SpecialHintGlobe);
+
+    const auto objectBounds = engine::toWorldSpace(bbox, pos);
+    if (isInRange(objectBounds, interactable.mType)) {
+      if (interactionWanted || (isHintMachine && playerHasHintGlobe)) {
+        performInteraction(es, entity, interactable.mType);
+        break;
+      } else {
+        showTutorialMessage(tutorialFor(interactable.mType));
       }
-    });
+    }
+  }
 }
 
 
@@ -237,80 +258,89 @@ void PlayerInteractionSystem::updateItemCollection(entityx::EntityManager& es) {
     return;
   }
 
-  es.each<CollectableItem, WorldPosition, BoundingBox>(
-    [this, &es](
-      ex::Entity entity,
-      const CollectableItem& collectable,
-      const WorldPosition& pos,
-      const BoundingBox& collisionRect
+  using namespace data;
+
+  const auto playerBBox = mpPlayer->worldSpaceHitBox();
+
+  for (auto entity : mCollectables.entitiesNear(playerBBox)) {
+    // Collecting an item can cause other entities to be destroyed
+    if (
+      !entity.valid() ||
+      !entity.has_component<CollectableItem>() ||
+      !entity.has_component<WorldPosition>() ||
+      !entity.has_component<BoundingBox>()
     ) {
-      using namespace data;
+      continue;
+    }
 
-      auto worldSpaceBbox = collisionRect;
-      worldSpaceBbox.topLeft +=
-        base::Vector{pos.x, pos.y - (worldSpaceBbox.size.height - 1)};
+    const auto& collectable = *entity.component<const CollectableItem>();
+    const auto& pos = *entity.component<const WorldPosition>();
+    const auto& collisionRect = *entity.component<const BoundingBox>();
 
-      auto playerBBox = mpPlayer->worldSpaceHitBox();
-      if (worldSpaceBbox.intersects(playerBBox)) {
-        std::optional<data::SoundId> soundToPlay;
+    auto worldSpaceBbox = collisionRect;
+    worldSpaceBbox.topLeft +=
+      base::Vector{pos.x, pos.y - (worldSpaceBbox.size.height - 1)};
 
-        const auto playerAtFullHealth = mpPlayerModel->isAtFullHealth();
-        if (auto maybeScore = givenScore(collectable, playerAtFullHealth)) {
-          const auto score = *maybeScore;
-          assert(score > 0);
-          mpPlayerModel->giveScore(score);
+    if (worldSpaceBbox.intersects(playerBBox)) {
+      std::optional<data::SoundId> soundToPlay;
 
-          soundToPlay = SoundId::ItemPickup;
+      const auto playerAtFullHealth = mpPlayerModel->isAtFullHealth();
+      if (auto maybeScore = givenScore(collectable, playerAtFullHealth)) {
+        const auto score = *maybeScore;
+        assert(score > 0);
+        mpPlayerModel->giveScore(score);
 
-          if (collectable.mSpawnScoreNumbers) {
-            spawnScoreNumbers(pos, score, *mpEntityFactory);
-          }
-        }
+        soundToPlay = SoundId::ItemPickup;
 
-        if (collectable.mGivenHealth) {
-          assert(*collectable.mGivenHealth > 0);
-          mpPlayerModel->giveHealth(*collectable.mGivenHealth);
-          soundToPlay = SoundId::HealthPickup;
+        if (collectable.mSpawnScoreNumbers) {
+          spawnScoreNumbers(pos, score, *mpEntityFactory);
         }
+      }
 
-        if (collectable.mGivenWeapon) {
-          mpPlayerModel->switchToWeapon(*collectable.mGivenWeapon);
-          soundToPlay = SoundId::WeaponPickup;
-        }
+      if (collectable.mGivenHealth) {
+        assert(*collectable.mGivenHealth > 0);
+        mpPlayerModel->giveHealth(*collectable.mGivenHealth);
+        soundToPlay = SoundId::HealthPickup;
+      }
 
-        if (collectable.mGivenItem) {
-          const auto itemType = *collectable.mGivenItem;
-          mpPlayerModel->giveItem(itemType);
+      if (collectable.mGivenWeapon) {
+        mpPlayerModel->switchToWeapon(*collectable.mGivenWeapon);
+        soundToPlay = SoundId::WeaponPickup;
+      }
 
-          soundToPlay = itemType == InventoryItemType::RapidFire ?
-            SoundId::WeaponPickup :
-            SoundId::ItemPickup;
+      if (collectable.mGivenItem) {
+        const auto itemType = *collectable.mGivenItem;
+        mpPlayerModel->giveItem(itemType);
 
-          if (itemType == InventoryItemType::SpecialHintGlobe) {
-            showMessage(data::Messages::FoundSpecialHintGlobe);
-          }
+        soundToPlay = itemType == InventoryItemType::RapidFire ?
+          SoundId::WeaponPickup :
+          SoundId::ItemPickup;
 
-          if (itemType == InventoryItemType::CloakingDevice) {
-            showMessage(data::Messages::FoundCloak);
-            mCloakPickupPosition = pos;
-          }
+        if (itemType == InventoryItemType::SpecialHintGlobe) {
+          showMessage(data::Messages::FoundSpecialHintGlobe);
         }
 
-        if (collectable.mShownTutorialMessage) {
-          showTutorialMessage(*collectable.mShownTutorialMessage);
+        if (itemType == InventoryItemType::CloakingDevice) {
+          showMessage(data::Messages::FoundCloak);
+          mCloakPickupPosition = pos;
         }
+      }
 
-        if (collectable.mGivenCollectableLetter) {
-          collectLetter(*collectable.mGivenCollectableLetter, pos);
-        }
+      if (collectable.mShownTutorialMessage) {
+        showTutorialMessage(*collectable.mShownTutorialMessage);
+      }
 
-        if (soundToPlay) {
-          mpServiceProvider->playSound(*soundToPlay);
-        }
+      if (collectable.mGivenCollectableLetter) {
+        collectLetter(*collectable.mGivenCollectableLetter, pos);
+      }
 
-        es.destroy(entity.id());
+      if (soundToPlay) {
+        mpServiceProvider->playSound(*soundToPlay);
       }
-    });
+
+      es.destroy(entity.id());
+    }
+  }
 }
 
 
@@ -321,6 +351,42 @@ void PlayerInteractionSystem::receive(const rigel::events::CloakExpired&) {
 }
 
 
+void PlayerInteractionSystem::receive(
+  const ex::ComponentAddedEvent<Interactable>& event
+) {
+  mInteractables.insert(event.entity);
+}
+
+
+void PlayerInteractionSystem::receive(
+  const ex::ComponentRemovedEvent<Interactable>& event
+) {
+  mInteractables.remove(event.entity);
+}
+
+
+void PlayerInteractionSystem::receive(
+  const ex::ComponentAddedEvent<CollectableItem>& event
+) {
+  mCollectables.insert(event.entity);
+}
+
+
+void PlayerInteractionSystem::receive(
+  const ex::ComponentRemovedEvent<CollectableItem>& event
+) {
+  mCollectables.remove(event.entity);
+}
+
+
+void PlayerInteractionSystem::receive(
+  const engine::events::ClearingAllEntities&
+) {
+  mInteractables.clear();
+  mCollectables.clear();
+}
+
+
 void PlayerInteractionSystem::showMessage(const std::string& text) {
   mpEvents->emit(rigel::events::PlayerMessage{text});
 }
@@ -340,7 +406,7 @@ void PlayerInteractionSystem::performInteraction(
 ) {
   switch (type) {
     case InteractableType::Teleporter:
-      activateTeleporter(es, interactable);
+      activateTeleporter(interactable);
       break;
 
     case InteractableType::ForceFieldCardReader:
@@ -359,13 +425,12 @@ void PlayerInteractionSystem::performInteraction(
 
 
 void PlayerInteractionSystem::activateTeleporter(
-  entityx::EntityManager& es,
   entityx::Entity interactable
 ) {
   mpServiceProvider->playSound(data::SoundId::Teleport);
 
   const auto maybeTargetPosition =
-    findTeleporterTargetPosition(es, interactable);
+    findTeleporterTargetPosition(mInteractables.entities(), interactable);
   if (maybeTargetPosition) {
     mpEvents->emit(rigel::events::PlayerTeleported{*maybeTargetPosition});
   } else {
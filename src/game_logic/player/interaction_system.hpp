@@ -22,6 +22,8 @@
 #include "data/player_model.hpp"
 #include "data/tutorial_messages.hpp"
 #include "engine/base_components.hpp"
+#include "engine/entity_grid.hpp"
+#include "engine/entity_tools.hpp"
 #include "game_logic/input.hpp"
 #include "game_logic/player/components.hpp"
 
@@ -36,6 +38,8 @@ namespace rigel {
 
   namespace data {
     class PlayerModel;
+
+    namespace map { class Map; }
   }
 
   namespace events {
@@ -44,6 +48,8 @@ namespace rigel {
 
   namespace game_logic {
     class EntityFactory;
+
+    namespace components { struct CollectableItem; }
   }
 
   namespace loader {
@@ -66,6 +72,8 @@ public:
     data::PlayerModel* pPlayerModel,
     IGameServiceProvider* pServices,
     EntityFactory* pEntityFactory,
+    const data::map::Map* pMap,
+    entityx::EntityManager& entities,
     entityx::EventManager* pEvents,
     const loader::ResourceLoader& resources);
 
@@ -76,6 +84,15 @@ public:
   void updateItemCollection(entityx::EntityManager& es);
 
   void receive(const rigel::events::CloakExpired& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::Interactable>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::Interactable>& event);
+  void receive(
+    const entityx::ComponentAddedEvent<components::CollectableItem>& event);
+  void receive(
+    const entityx::ComponentRemovedEvent<components::CollectableItem>& event);
+  void receive(const engine::events::ClearingAllEntities& event);
 
 private:
   void showMessage(const std::string& text);
@@ -86,9 +103,7 @@ private:
     entityx::Entity interactable,
     components::InteractableType type);
 
-  void activateTeleporter(
-    entityx::EntityManager& es,
-    entityx::Entity interactable);
+  void activateTeleporter(entityx::Entity interactable);
   void activateCardReader(
     entityx::EntityManager& es,
     entityx::Entity interactable);
@@ -110,6 +125,18 @@ private:
   data::LevelHints mLevelHints;
   data::GameSessionId mSessionId;
 
+  // Only a few interactables and collectables are ever close enough to the
+  // player to matter, these grids allow finding them without going through
+  // all entities.
+  //
+  // Interactables never move. Collectables which move, like falling items,
+  // have a MovingBody. Items released from a container only get a position
+  // after they have been inserted. So the grids' assumption that other
+  // entries stay in place holds. This includes restored snapshots, which
+  // assign positions and MovingBody before Interactable and CollectableItem.
+  engine::EntityGrid mInteractables;
+  engine::EntityGrid mCollectables;
+
   std::optional<base::Vector> mCloakPickupPosition;
 };
 
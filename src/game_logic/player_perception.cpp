@@ -0,0 +1,64 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "player_perception.hpp"
+
+#include "game_logic/player.hpp"
+#include "game_logic/player/components.hpp"
+
+#include <cstdlib>
+
+
+namespace rigel::game_logic {
+
+namespace {
+
+int sign(const int value) {
+  return (value > 0) - (value < 0);
+}
+
+}
+
+
+void PlayerPerception::update(const Player& player) {
+  mPosition = player.position();
+  mOrientedPosition = player.orientedPosition();
+  mHitBox = player.worldSpaceHitBox();
+  mOrientation = player.orientation();
+  mIsCloaked = player.isCloaked();
+  mIsCrouching = player.isCrouching();
+  mIsInRegularState = player.isInRegularState();
+}
+
+
+int PlayerPerception::centerToCenterDistanceX(
+  const base::Vector& position,
+  const int width
+) const {
+  const auto playerCenterX = mPosition.x + PLAYER_WIDTH/2;
+  const auto centerX = position.x + width/2;
+  return std::abs(playerCenterX - centerX);
+}
+
+
+base::Vector PlayerPerception::directionFrom(
+  const base::Vector& position
+) const {
+  return {sign(mPosition.x - position.x), sign(mPosition.y - position.y)};
+}
+
+}
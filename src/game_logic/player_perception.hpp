@@ -0,0 +1,59 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "engine/base_components.hpp"
+
+
+namespace rigel::game_logic {
+
+class Player;
+
+
+/** The player's state as seen by enemy A.I. during one update
+ *
+ * IngameSystems takes this snapshot once before running the A.I. systems,
+ * so that all enemies share a single set of player queries instead of
+ * going through the Player each time. Anything that changes the player
+ * during the A.I. pass, like moving, damaging, grabbing or releasing it,
+ * must call update() again afterwards. Otherwise, entities processed later
+ * during the same update would see a stale position or state.
+ */
+struct PlayerPerception {
+  void update(const Player& player);
+
+  /** Horizontal distance between the player's center and the center of an
+   * object with the given width at the given position
+   */
+  int centerToCenterDistanceX(const base::Vector& position, int width) const;
+
+  /** Direction from position to the player, as -1, 0 or 1 on each axis */
+  base::Vector directionFrom(const base::Vector& position) const;
+
+  base::Vector mPosition;
+  base::Vector mOrientedPosition;
+  engine::components::BoundingBox mHitBox;
+  engine::components::Orientation mOrientation =
+    engine::components::Orientation::Left;
+  bool mIsCloaked = false;
+  bool mIsCrouching = false;
+  bool mIsInRegularState = false;
+};
+
+}
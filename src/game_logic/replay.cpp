@@ -0,0 +1,237 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replay.hpp"
+
+#include "loader/file_utils.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+
+namespace rigel::game_logic {
+
+namespace {
+
+// File layout (all values little endian):
+//
+//   u32    magic
+//   u8     format version
+//   u8     episode
+//   u8     level
+//   u8     difficulty
+//   u8     has player position override
+//   s32    player position x
+//   s32    player position y
+//   u32    random generator state
+//   u32    number of ticks
+//   u16[]  packed tick data, see packTick()
+//   u8     has state hashes (since version 2)
+//   u32[]  entities, map, random generator and player model hash for each
+//          tick, if present
+constexpr auto REPLAY_MAGIC = std::uint32_t{0x50524752}; // "RGRP"
+constexpr auto REPLAY_FORMAT_VERSION = std::uint8_t{2};
+
+enum TickBits : std::uint16_t {
+  LEFT = 1 << 0,
+  RIGHT = 1 << 1,
+  UP = 1 << 2,
+  DOWN = 1 << 3,
+  INTERACT_PRESSED = 1 << 4,
+  INTERACT_TRIGGERED = 1 << 5,
+  JUMP_PRESSED = 1 << 6,
+  JUMP_TRIGGERED = 1 << 7,
+  FIRE_PRESSED = 1 << 8,
+  FIRE_TRIGGERED = 1 << 9,
+  END_OF_FRAME = 1 << 15
+};
+
+
+std::uint16_t packTick(const Replay::Tick& tick) {
+  const auto& input = tick.mInput;
+
+  auto bit = [](const bool value, const TickBits flag) -> std::uint16_t {
+    return value ? flag : 0;
+  };
+
+  return static_cast<std::uint16_t>(
+    bit(input.mLeft, LEFT) |
+    bit(input.mRight, RIGHT) |
+    bit(input.mUp, UP) |
+    bit(input.mDown, DOWN) |
+    bit(input.mInteract.mIsPressed, INTERACT_PRESSED) |
+    bit(input.mInteract.mWasTriggered, INTERACT_TRIGGERED) |
+    bit(input.mJump.mIsPressed, JUMP_PRESSED) |
+    bit(input.mJump.mWasTriggered, JUMP_TRIGGERED) |
+    bit(input.mFire.mIsPressed, FIRE_PRESSED) |
+    bit(input.mFire.mWasTriggered, FIRE_TRIGGERED) |
+    bit(tick.mEndOfFrame, END_OF_FRAME));
+}
+
+
+Replay::Tick unpackTick(const std::uint16_t packed) {
+  auto isSet = [packed](const TickBits flag) {
+    return (packed & flag) != 0;
+  };
+
+  Replay::Tick tick;
+  auto& input = tick.mInput;
+  input.mLeft = isSet(LEFT);
+  input.mRight = isSet(RIGHT);
+  input.mUp = isSet(UP);
+  input.mDown = isSet(DOWN);
+  input.mInteract = {isSet(INTERACT_PRESSED), isSet(INTERACT_TRIGGERED)};
+  input.mJump = {isSet(JUMP_PRESSED), isSet(JUMP_TRIGGERED)};
+  input.mFire = {isSet(FIRE_PRESSED), isSet(FIRE_TRIGGERED)};
+  tick.mEndOfFrame = isSet(END_OF_FRAME);
+  return tick;
+}
+
+
+class LeStreamWriter {
+public:
+  void writeU8(const std::uint8_t value) {
+    mBuffer.push_back(value);
+  }
+
+  void writeU16(const std::uint16_t value) {
+    writeU8(static_cast<std::uint8_t>(value & 0xFF));
+    writeU8(static_cast<std::uint8_t>(value >> 8));
+  }
+
+  void writeU32(const std::uint32_t value) {
+    writeU16(static_cast<std::uint16_t>(value & 0xFFFF));
+    writeU16(static_cast<std::uint16_t>(value >> 16));
+  }
+
+  void writeS32(const std::int32_t value) {
+    writeU32(static_cast<std::uint32_t>(value));
+  }
+
+  const loader::ByteBuffer& buffer() const {
+    return mBuffer;
+  }
+
+private:
+  loader::ByteBuffer mBuffer;
+};
+
+}
+
+
+void saveReplay(const Replay& replay, const std::string& fileName) {
+  LeStreamWriter writer;
+
+  writer.writeU32(REPLAY_MAGIC);
+  writer.writeU8(REPLAY_FORMAT_VERSION);
+  writer.writeU8(static_cast<std::uint8_t>(replay.mSessionId.mEpisode));
+  writer.writeU8(static_cast<std::uint8_t>(replay.mSessionId.mLevel));
+  writer.writeU8(static_cast<std::uint8_t>(replay.mSessionId.mDifficulty));
+
+  const auto position = replay.mPlayerPositionOverride.value_or(
+    base::Vector{});
+  writer.writeU8(replay.mPlayerPositionOverride.has_value());
+  writer.writeS32(position.x);
+  writer.writeS32(position.y);
+
+  writer.writeU32(static_cast<std::uint32_t>(replay.mRandomGeneratorState));
+  writer.writeU32(static_cast<std::uint32_t>(replay.mTicks.size()));
+  for (const auto& tick : replay.mTicks) {
+    writer.writeU16(packTick(tick));
+  }
+
+  const auto hasStateHashes =
+    !replay.mStateHashes.empty() &&
+    replay.mStateHashes.size() == replay.mTicks.size();
+  writer.writeU8(hasStateHashes);
+  if (hasStateHashes) {
+    for (const auto& hash : replay.mStateHashes) {
+      writer.writeU32(hash.mEntities);
+      writer.writeU32(hash.mMap);
+      writer.writeU32(hash.mRandomGenerator);
+      writer.writeU32(hash.mPlayer);
+    }
+  }
+
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open replay file for writing");
+  }
+
+  const auto& buffer = writer.buffer();
+  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write replay file");
+  }
+}
+
+
+Replay loadReplay(const std::string& fileName) {
+  const auto data = loader::loadFile(fileName);
+  loader::LeStreamReader reader(data);
+
+  if (reader.readU32() != REPLAY_MAGIC) {
+    throw std::runtime_error("Not a replay file");
+  }
+
+  const auto version = reader.readU8();
+  if (version < 1 || version > REPLAY_FORMAT_VERSION) {
+    throw std::runtime_error("Unsupported replay format version");
+  }
+
+  Replay replay;
+
+  const auto episode = reader.readU8();
+  const auto level = reader.readU8();
+  const auto difficulty = reader.readU8();
+  if (episode >= 4 || level >= 8 || difficulty > 2) {
+    throw std::runtime_error("Invalid session in replay file");
+  }
+
+  replay.mSessionId = data::GameSessionId{
+    episode, level, static_cast<data::Difficulty>(difficulty)};
+
+  const auto hasPositionOverride = reader.readU8() != 0;
+  const auto x = reader.readS32();
+  const auto y = reader.readS32();
+  if (hasPositionOverride) {
+    replay.mPlayerPositionOverride = base::Vector{x, y};
+  }
+
+  replay.mRandomGeneratorState = reader.readU32();
+
+  const auto numTicks = reader.readU32();
+  replay.mTicks.reserve(numTicks);
+  for (auto i = std::uint32_t{0}; i < numTicks; ++i) {
+    replay.mTicks.push_back(unpackTick(reader.readU16()));
+  }
+
+  if (version >= 2 && reader.readU8() != 0) {
+    replay.mStateHashes.reserve(numTicks);
+    for (auto i = std::uint32_t{0}; i < numTicks; ++i) {
+      StateHash hash;
+      hash.mEntities = reader.readU32();
+      hash.mMap = reader.readU32();
+      hash.mRandomGenerator = reader.readU32();
+      hash.mPlayer = reader.readU32();
+      replay.mStateHashes.push_back(hash);
+    }
+  }
+
+  return replay;
+}
+
+}
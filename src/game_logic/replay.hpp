@@ -0,0 +1,76 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "data/game_session_data.hpp"
+#include "game_logic/input.hpp"
+#include "game_logic/state_hash.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace rigel::game_logic {
+
+/** Everything needed to play back a recorded level session
+ *
+ * The game logic is fully deterministic, so starting a GameWorld with the
+ * same parameters and random generator state and then feeding it the same
+ * sequence of inputs reproduces the original session exactly.
+ *
+ * Besides the input for each game logic update, the frame structure needs
+ * to be recorded as well. GameWorld::processEndOfFrameActions() is only
+ * called once per frame, after all updates for the frame have run, and
+ * affects the outcome (e.g. when the player dies or teleports).
+ *
+ * Optionally, the StateHash after each tick is recorded as well, which
+ * allows verifying that playback does in fact reproduce the session.
+ */
+struct Replay {
+  struct Tick {
+    PlayerInput mInput;
+
+    // True if processEndOfFrameActions() was called after this tick
+    bool mEndOfFrame = false;
+  };
+
+  data::GameSessionId mSessionId;
+  std::optional<base::Vector> mPlayerPositionOverride;
+  std::size_t mRandomGeneratorState = 0;
+  std::vector<Tick> mTicks;
+
+  // Either empty, or one entry per tick
+  std::vector<StateHash> mStateHashes;
+};
+
+
+/** Write replay to a file in a compact binary format
+ *
+ * Throws an exception if the file can't be written.
+ */
+void saveReplay(const Replay& replay, const std::string& fileName);
+
+/** Load replay previously written by saveReplay()
+ *
+ * Throws an exception if the file can't be read or is invalid.
+ */
+Replay loadReplay(const std::string& fileName);
+
+}
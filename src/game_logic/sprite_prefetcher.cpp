@@ -0,0 +1,143 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "sprite_prefetcher.hpp"
+
+#include "base/tunables.hpp"
+#include "data/game_traits.hpp"
+#include "engine/base_components.hpp"
+#include "game_logic/effect_components.hpp"
+#include "game_logic/entity_factory.hpp"
+
+#include <algorithm>
+
+
+namespace rigel::game_logic {
+
+using engine::components::WorldPosition;
+using game_logic::components::DestructionEffects;
+
+
+namespace {
+
+// How far beyond the edge of the screen to look, in tiles. The camera moves
+// at most a few tiles per frame, so this leaves plenty of frames for
+// decoding and uploading before an entity becomes visible.
+constexpr auto LOOK_AHEAD_DISTANCE = 16;
+
+// Upper bound for the number of sprites uploaded per update. Effect sprites
+// usually only have a handful of frames, so this keeps the time spent on
+// uploads small.
+base::Tunable<int> gMaxSpriteUploadsPerUpdate{
+  "max-sprite-uploads-per-update",
+  "Upper bound for the number of prefetched sprites uploaded per logic "
+  "update. With 0, sprites are only uploaded once they are needed.",
+  2,
+  0,
+  64};
+
+}
+
+
+SpritePrefetcher::SpritePrefetcher(
+  EntityFactory* pEntityFactory,
+  const base::Vector* pCameraPosition,
+  const data::ViewPortSize& viewPortSize
+)
+  : mpEntityFactory(pEntityFactory)
+  , mpCameraPosition(pCameraPosition)
+  , mPreviousCameraPosition(*pCameraPosition)
+  , mViewPortSize(viewPortSize.mapViewPortSize())
+{
+}
+
+
+void SpritePrefetcher::update(entityx::EntityManager& es) {
+  if (!mCandidatesCollected) {
+    collectCandidates(es);
+    mCandidatesCollected = true;
+    mPreviousCameraPosition = *mpCameraPosition;
+  }
+
+  const auto region =
+    lookAheadRegion(*mpCameraPosition - mPreviousCameraPosition);
+  mPreviousCameraPosition = *mpCameraPosition;
+
+  const auto iFirstPrefetched = std::partition(
+    mCandidates.begin(),
+    mCandidates.end(),
+    [&](const Candidate& candidate) {
+      return !region.containsPoint(candidate.mPosition);
+    });
+
+  for (
+    auto iCandidate = iFirstPrefetched;
+    iCandidate != mCandidates.end();
+    ++iCandidate
+  ) {
+    mpEntityFactory->prefetchSprite(iCandidate->mActorId);
+  }
+
+  mCandidates.erase(iFirstPrefetched, mCandidates.end());
+
+  mpEntityFactory->uploadPrefetchedSprites(gMaxSpriteUploadsPerUpdate);
+}
+
+
+void SpritePrefetcher::collectCandidates(entityx::EntityManager& es) {
+  es.each<WorldPosition, DestructionEffects>(
+    [this](
+      entityx::Entity,
+      const WorldPosition& position,
+      const DestructionEffects& destructionEffects
+    ) {
+      for (const auto& spec : destructionEffects.mEffectSpecs) {
+        if (auto pSprite = std::get_if<effects::EffectSprite>(&spec.mEffect)) {
+          mCandidates.push_back(Candidate{position, pSprite->mActorId});
+        } else if (
+          auto pCascade = std::get_if<effects::SpriteCascade>(&spec.mEffect)
+        ) {
+          mCandidates.push_back(Candidate{position, pCascade->mActorId});
+        }
+      }
+    });
+}
+
+
+base::Rect<int> SpritePrefetcher::lookAheadRegion(
+  const base::Vector& cameraMovement
+) const {
+  auto region = base::Rect<int>{*mpCameraPosition, mViewPortSize};
+
+  if (cameraMovement.x > 0) {
+    region.size.width += LOOK_AHEAD_DISTANCE;
+  } else if (cameraMovement.x < 0) {
+    region.topLeft.x -= LOOK_AHEAD_DISTANCE;
+    region.size.width += LOOK_AHEAD_DISTANCE;
+  }
+
+  if (cameraMovement.y > 0) {
+    region.size.height += LOOK_AHEAD_DISTANCE;
+  } else if (cameraMovement.y < 0) {
+    region.topLeft.y -= LOOK_AHEAD_DISTANCE;
+    region.size.height += LOOK_AHEAD_DISTANCE;
+  }
+
+  return region;
+}
+
+}
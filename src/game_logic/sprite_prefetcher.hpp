@@ -0,0 +1,76 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "base/warnings.hpp"
+#include "data/actor_ids.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <vector>
+
+
+namespace rigel::data { struct ViewPortSize; }
+
+
+namespace rigel::game_logic {
+
+class EntityFactory;
+
+
+/** Prepares sprites for effects which entities ahead of the camera can spawn
+ *
+ * The sprites of all actors in a level are created while loading the level,
+ * but the sprites of effects spawned when destroying something (explosions,
+ * debris etc.) are only created once first needed. Decoding their images
+ * and uploading the textures can make that frame take noticeably longer.
+ *
+ * To avoid that, this looks at the area the camera is moving towards, and
+ * prefetches effect sprites of entities within it. Decoding happens on
+ * worker threads, and only a few sprites are uploaded per update.
+ */
+class SpritePrefetcher {
+public:
+  SpritePrefetcher(
+    EntityFactory* pEntityFactory,
+    const base::Vector* pCameraPosition,
+    const data::ViewPortSize& viewPortSize);
+
+  void update(entityx::EntityManager& es);
+
+private:
+  struct Candidate {
+    base::Vector mPosition;
+    data::ActorID mActorId;
+  };
+
+  void collectCandidates(entityx::EntityManager& es);
+  base::Rect<int> lookAheadRegion(const base::Vector& cameraMovement) const;
+
+  std::vector<Candidate> mCandidates;
+  EntityFactory* mpEntityFactory;
+  const base::Vector* mpCameraPosition;
+  base::Vector mPreviousCameraPosition;
+  base::Extents mViewPortSize;
+  bool mCandidatesCollected = false;
+};
+
+}
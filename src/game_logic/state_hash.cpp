@@ -0,0 +1,209 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "state_hash.hpp"
+
+#include "base/key_hasher.hpp"
+#include "data/map.hpp"
+#include "data/player_model.hpp"
+#include "engine/base_components.hpp"
+#include "engine/physical_components.hpp"
+#include "engine/random_number_generator.hpp"
+#include "engine/visual_components.hpp"
+#include "game_logic/damage_components.hpp"
+
+#include <cstring>
+
+
+namespace rigel::game_logic {
+
+namespace {
+
+std::uint32_t truncatedValue(const base::KeyHasher& hasher) {
+  const auto value = hasher.value();
+  return static_cast<std::uint32_t>(value ^ (value >> 32));
+}
+
+
+void addInt(base::KeyHasher& hasher, const int value) {
+  hasher.add(static_cast<std::uint32_t>(value));
+}
+
+
+void addFloat(base::KeyHasher& hasher, const float value) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  hasher.add(bits);
+}
+
+
+void addBool(base::KeyHasher& hasher, const bool value) {
+  hasher.add(std::uint8_t{value});
+}
+
+
+// Component family IDs are handed out in order of first use, which can be
+// different between runs. Components are therefore tested for individually,
+// instead of hashing the entity's component mask.
+template <typename C, typename Func>
+void addComponent(
+  base::KeyHasher& hasher,
+  entityx::Entity entity,
+  Func&& addContents
+) {
+  const auto hasComponent = entity.has_component<C>();
+  addBool(hasher, hasComponent);
+  if (hasComponent) {
+    addContents(*entity.component<const C>());
+  }
+}
+
+
+std::uint32_t hashEntities(entityx::EntityManager& es) {
+  using namespace engine::components;
+  using components::Shootable;
+
+  base::KeyHasher hasher;
+
+  for (auto entity : es.entities_for_debugging()) {
+    hasher.add(entity.id().id());
+
+    addComponent<WorldPosition>(hasher, entity, [&](const auto& position) {
+      addInt(hasher, position.x);
+      addInt(hasher, position.y);
+    });
+    addComponent<BoundingBox>(hasher, entity, [&](const auto& bbox) {
+      addInt(hasher, bbox.topLeft.x);
+      addInt(hasher, bbox.topLeft.y);
+      addInt(hasher, bbox.size.width);
+      addInt(hasher, bbox.size.height);
+    });
+    addComponent<MovingBody>(hasher, entity, [&](const auto& body) {
+      addFloat(hasher, body.mVelocity.x);
+      addFloat(hasher, body.mVelocity.y);
+      addBool(hasher, body.mGravityAffected);
+      addBool(hasher, body.mIgnoreCollisions);
+      addBool(hasher, body.mIsActive);
+    });
+    addComponent<Shootable>(hasher, entity, [&](const auto& shootable) {
+      addInt(hasher, shootable.mHealth);
+      addBool(hasher, shootable.mInvincible);
+    });
+    addComponent<Active>(hasher, entity, [&](const auto&) {});
+    addComponent<Sprite>(hasher, entity, [&](const auto& sprite) {
+      for (const auto frame : sprite.mFramesToRender) {
+        addInt(hasher, frame);
+      }
+      addBool(hasher, sprite.mShow);
+    });
+  }
+
+  return truncatedValue(hasher);
+}
+
+
+std::uint32_t hashMap(const data::map::Map& map) {
+  base::KeyHasher hasher;
+
+  addInt(hasher, map.width());
+  addInt(hasher, map.height());
+  for (auto layer = 0; layer < 2; ++layer) {
+    for (auto y = 0; y < map.height(); ++y) {
+      for (const auto tile : map.row(layer, y)) {
+        hasher.add(static_cast<std::uint32_t>(tile));
+      }
+    }
+  }
+
+  return truncatedValue(hasher);
+}
+
+
+std::uint32_t hashPlayerModel(const data::PlayerModel& playerModel) {
+  base::KeyHasher hasher;
+
+  addInt(hasher, playerModel.score());
+  addInt(hasher, playerModel.ammo());
+  addInt(hasher, static_cast<int>(playerModel.weapon()));
+  addInt(hasher, playerModel.health());
+
+  for (const auto item : playerModel.inventory()) {
+    addInt(hasher, static_cast<int>(item));
+  }
+  hasher.add(std::uint8_t{0xFF});
+
+  for (const auto letter : playerModel.collectedLetters()) {
+    addInt(hasher, static_cast<int>(letter));
+  }
+
+  return truncatedValue(hasher);
+}
+
+}
+
+
+std::string describeMismatch(
+  const StateHash& expected,
+  const StateHash& actual
+) {
+  std::string result;
+
+  auto check = [&](
+    const std::uint32_t lhs,
+    const std::uint32_t rhs,
+    const char* pName
+  ) {
+    if (lhs != rhs) {
+      if (!result.empty()) {
+        result += ", ";
+      }
+
+      result += pName;
+    }
+  };
+
+  check(expected.mEntities, actual.mEntities, "entities");
+  check(expected.mMap, actual.mMap, "map");
+  check(
+    expected.mRandomGenerator,
+    actual.mRandomGenerator,
+    "random number generator");
+  check(expected.mPlayer, actual.mPlayer, "player model");
+
+  return result;
+}
+
+
+StateHash StateHasher::hash(
+  entityx::EntityManager& es,
+  const data::map::Map& map,
+  const engine::RandomNumberGenerator& randomGenerator,
+  const data::PlayerModel& playerModel
+) {
+  if (mHashedMapRevision != map.changeRevision()) {
+    mMapHash = hashMap(map);
+    mHashedMapRevision = map.changeRevision();
+  }
+
+  return StateHash{
+    hashEntities(es),
+    mMapHash,
+    static_cast<std::uint32_t>(randomGenerator.state()),
+    hashPlayerModel(playerModel)};
+}
+
+}
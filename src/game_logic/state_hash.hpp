@@ -0,0 +1,92 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <entityx/entityx.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+
+namespace rigel::data { class PlayerModel; }
+namespace rigel::data::map { class Map; }
+namespace rigel::engine { class RandomNumberGenerator; }
+
+
+namespace rigel::game_logic {
+
+/** Fingerprint of the game world's state after a game logic update
+ *
+ * Recorded into replays and compared on playback, to verify that the game
+ * logic still produces exactly the same results. The state is split into
+ * parts, so that a mismatch tells which part diverged.
+ *
+ * Entities contribute their position, bounding box, velocity, health,
+ * activation state and sprite frames. Other component state isn't hashed
+ * directly, but will usually show up in one of these sooner or later.
+ */
+struct StateHash {
+  std::uint32_t mEntities = 0;
+  std::uint32_t mMap = 0;
+  std::uint32_t mRandomGenerator = 0;
+  std::uint32_t mPlayer = 0;
+
+  bool operator==(const StateHash& other) const {
+    return
+      mEntities == other.mEntities &&
+      mMap == other.mMap &&
+      mRandomGenerator == other.mRandomGenerator &&
+      mPlayer == other.mPlayer;
+  }
+
+  bool operator!=(const StateHash& other) const {
+    return !(*this == other);
+  }
+};
+
+
+/** Lists the parts which differ between the two hashes, e.g. "entities, map"
+ */
+std::string describeMismatch(
+  const StateHash& expected,
+  const StateHash& actual);
+
+
+/** Computes StateHashes
+ *
+ * Hashing the whole map on every update would be fairly expensive, so the
+ * map's hash is only recomputed when its change revision moves on.
+ */
+class StateHasher {
+public:
+  StateHash hash(
+    entityx::EntityManager& es,
+    const data::map::Map& map,
+    const engine::RandomNumberGenerator& randomGenerator,
+    const data::PlayerModel& playerModel);
+
+private:
+  std::optional<std::uint32_t> mHashedMapRevision;
+  std::uint32_t mMapHash = 0;
+};
+
+}
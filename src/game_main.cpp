@@ -18,22 +18,38 @@
 #include "game_main.ipp"
 
 #include "base/math_tools.hpp"
+#include "base/memory_accounting.hpp"
+#include "base/tunables.hpp"
 #include "data/duke_script.hpp"
 #include "data/game_traits.hpp"
+#include "engine/allocation_tracker.hpp"
+#include "engine/flight_recorder.hpp"
 #include "engine/timing.hpp"
+#include "engine/trace_recorder.hpp"
+#include "game_logic/replay.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "sdl_utils/error.hpp"
+#include "ui/audio_statistics_window.hpp"
+#include "ui/memory_statistics_window.hpp"
 #include "ui/imgui_integration.hpp"
+#include "ui/render_profiler_window.hpp"
+#include "ui/tunables_window.hpp"
 
 #include "game_session_mode.hpp"
 #include "intro_demo_loop_mode.hpp"
 #include "menu_mode.hpp"
+#include "replay_mode.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <imgui.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
 
 
 namespace rigel {
@@ -63,6 +79,21 @@ auto loadScripts(const loader::ResourceLoader& resources) {
 }
 
 
+/** Rough size of the script bundle, for memory accounting
+ *
+ * Counts the actions themselves, but not any text or other data they
+ * allocate separately.
+ */
+std::size_t approximateSizeInBytes(const loader::ScriptBundle& scripts) {
+  auto result = std::size_t{0};
+  for (const auto& [name, script] : scripts) {
+    result += name.size() + script.size() * sizeof(data::script::Action);
+  }
+
+  return result;
+}
+
+
 // The game's original 320x200 resolution would give us a 16:10 aspect ratio
 // when using square pixels, but monitors of the time had a 4:3 aspect ratio,
 // and that's what the game's graphics were designed for (very noticeable e.g.
@@ -72,9 +103,73 @@ auto loadScripts(const loader::ResourceLoader& resources) {
 const auto TARGET_ASPECT_RATIO = 4.0f / 3.0f;
 
 
-[[nodiscard]] auto setupSimpleUpscaling(renderer::Renderer* pRenderer) {
-  auto saved = renderer::Renderer::StateSaver{pRenderer};
+// Upper bound for waiting in Game::waitUntilNextUpdateIsNeeded(), so that
+// we don't rely on the game mode's idle time estimate too much
+const auto MAX_IDLE_TIME = engine::TimeDelta{1.0};
+
+const auto RENDER_STATS_DUMP_INTERVAL = engine::TimeDelta{1.0};
+
+
+base::Tunable<bool> gFlushBeforeUiWork{
+  "flush-before-ui-work",
+  "Hand the game mode's rendering to the GPU before building debug UI and "
+  "presenting, instead of only when swapping buffers.",
+  true};
+
+
+/** Alpha value for a screen fade which has been running for elapsedTime
+ *
+ * Returns std::nullopt once the fade is complete.
+ */
+std::optional<std::uint8_t> fadeAlpha(
+  const engine::TimeDelta elapsedTime,
+  const bool isFadeIn
+) {
+  const auto fastTicksElapsed = engine::timeToFastTicks(elapsedTime);
+  const auto fadeFactor = (fastTicksElapsed / 4.0) / 16.0;
+  if (fadeFactor >= 1.0) {
+    return std::nullopt;
+  }
+
+  const auto alpha = isFadeIn ? fadeFactor : 1.0 - fadeFactor;
+  return base::roundTo<std::uint8_t>(255.0 * alpha);
+}
+
+
+void printRenderStats(
+  std::ostream& stream,
+  const renderer::Renderer::FrameStatistics& stats
+) {
+  stream
+    << "Render stats: " << stats.mDrawCalls << " draw calls, "
+    << stats.mQuads << " quads, "
+    << stats.mPoints << " points, "
+    << stats.mCulledDraws << " culled, "
+    << stats.mTextureBinds << " texture binds, "
+    << stats.mBytesUploaded << " bytes uploaded\n";
+
+  stream << "  Batches by flush reason:";
+  auto pSeparator = " ";
+  for (auto i = std::size_t{0}; i < stats.mBatchesByFlushReason.size(); ++i) {
+    const auto reason = static_cast<renderer::Renderer::BatchFlushReason>(i);
+    stream
+      << pSeparator << renderer::batchFlushReasonName(reason) << ": "
+      << stats.mBatchesByFlushReason[i];
+    pSeparator = ", ";
+  }
+  stream << '\n';
+}
+
+
+/** Part of the window showing the original 320x200 screen */
+struct UpscaledScreenArea {
+  base::Point<float> mScale;
+  base::Vector mOffset;
+  base::Size<int> mSize;
+};
 
+
+UpscaledScreenArea upscaledScreenArea(const renderer::Renderer* pRenderer) {
   const auto [windowWidthInt, windowHeightInt] = pRenderer->windowSize();
   const auto windowWidth = float(windowWidthInt);
   const auto windowHeight = float(windowHeightInt);
@@ -89,33 +184,99 @@ const auto TARGET_ASPECT_RATIO = 4.0f / 3.0f;
   const auto widthScale = usableWidth / data::GameTraits::viewPortWidthPx;
   const auto heightScale = usableHeight / data::GameTraits::viewPortHeightPx;
 
-  pRenderer->setGlobalScale({widthScale, heightScale});
-
   const auto offsetX = (windowWidth - usableWidth) / 2.0f;
   const auto offsetY = (windowHeight - usableHeight) / 2.0f;
-  const auto offset = base::Vector{int(offsetX), int(offsetY)};
-  pRenderer->setGlobalTranslation(offset);
 
+  return UpscaledScreenArea{
+    {widthScale, heightScale},
+    base::Vector{int(offsetX), int(offsetY)},
+    {int(usableWidth), int(usableHeight)}};
+}
+
+
+[[nodiscard]] auto setupSimpleUpscaling(renderer::Renderer* pRenderer) {
+  auto saved = renderer::Renderer::StateSaver{pRenderer};
+
+  const auto area = upscaledScreenArea(pRenderer);
+  pRenderer->setGlobalScale(area.mScale);
+  pRenderer->setGlobalTranslation(area.mOffset);
+  pRenderer->setClipRect(base::Rect<int>{area.mOffset, area.mSize});
+
+  return saved;
+}
+
+
+/** Set up drawing into a native resolution composition target
+ *
+ * The target is wider than the original screen by the view port's extra
+ * width, with the original screen area centered in it, the same way a wider
+ * view extends to both sides of the screen when upscaling directly.
+ */
+[[nodiscard]] auto setupNativeComposition(
+  renderer::Renderer* pRenderer,
+  const data::ViewPortSize& viewPortSize
+) {
+  auto saved = renderer::Renderer::StateSaver{pRenderer};
+
+  const auto offset = base::Vector{viewPortSize.extraWidthPx() / 2, 0};
+  pRenderer->setGlobalScale({1.0f, 1.0f});
+  pRenderer->setGlobalTranslation(offset);
   pRenderer->setClipRect(base::Rect<int>{
-    offset, {int(usableWidth), int(usableHeight)}});
+    offset,
+    {data::GameTraits::viewPortWidthPx, data::GameTraits::viewPortHeightPx}});
 
   return saved;
 }
 
+
+/** Where to draw the native resolution composition target on screen */
+base::Rect<int> nativeCompositionDestRect(
+  const renderer::Renderer* pRenderer,
+  const data::ViewPortSize& viewPortSize
+) {
+  const auto area = upscaledScreenArea(pRenderer);
+  const auto compositionWidth =
+    data::GameTraits::viewPortWidthPx + viewPortSize.extraWidthPx();
+  const auto extraWidthOnEachSide = base::round(
+    viewPortSize.extraWidthPx() / 2 * area.mScale.x);
+
+  return base::Rect<int>{
+    {area.mOffset.x - extraWidthOnEachSide, area.mOffset.y},
+    {base::round(compositionWidth * area.mScale.x), area.mSize.height}};
+}
+
 }
 
 
 void gameMain(const StartupOptions& options, SDL_Window* pWindow) {
-  Game game(options.mGamePath, pWindow);
+  // Set before loading anything, so that eviction can take the budget into
+  // account right from the start
+  base::memory_accounting::setBudget(options.mMemoryBudget);
+
+  Game game(
+    options.mGamePath,
+    options.mAssetCacheDirectory,
+    options.mAudioSettings,
+    pWindow);
   game.run(options);
 }
 
 
-Game::Game(const std::string& gamePath, SDL_Window* pWindow)
+Game::Game(
+  const std::string& gamePath,
+  const std::optional<std::string>& maybeAssetCacheDirectory,
+  const engine::AudioSettings& audioSettings,
+  SDL_Window* pWindow
+)
   : mpWindow(pWindow)
+  , mResources(gamePath, maybeAssetCacheDirectory)
+  , mBackgroundLoading(gamePath, mResources)
   , mRenderer(pWindow)
-  , mResources(gamePath)
+  , mSoundSystem(audioSettings)
   , mIsShareWareVersion(true)
+  , mSpriteFactory(&mRenderer, &mResources.mActorImagePackage)
+  , mHudAssets(&mRenderer, mResources.mActorImagePackage)
+  , mFullScreenImages(&mRenderer, &mResources)
   , mRenderTarget(
       [&]() {
         int windowWidth = 0;
@@ -128,15 +289,73 @@ Game::Game(const std::string& gamePath, SDL_Window* pWindow)
   , mpCurrentGameMode(std::make_unique<NullGameMode>())
   , mIsRunning(true)
   , mIsMinimized(false)
-  , mUserProfile(loadOrCreateUserProfile(gamePath))
-  , mScriptRunner(&mResources, &mRenderer, &mUserProfile.mSaveSlots, this)
-  , mAllScripts(loadScripts(mResources))
+  , mUserProfile(mBackgroundLoading.mUserProfile.get())
+  , mScriptRunner(
+      &mResources,
+      &mRenderer,
+      &mFullScreenImages,
+      &mUserProfile.mSaveSlots,
+      this)
+  , mAllScripts(mBackgroundLoading.mScripts.get())
+  , mAllScriptsBytes(
+      base::memory_accounting::Category::Scripts,
+      approximateSizeInBytes(mAllScripts))
   , mUiSpriteSheet(
       renderer::OwningTexture{
-        &mRenderer, mResources.loadTiledFullscreenImage("STATUS.MNI")},
+        &mRenderer, mBackgroundLoading.mUiSpriteSheetImage.get()},
       &mRenderer)
   , mTextRenderer(&mUiSpriteSheet, &mRenderer, mResources)
 {
+  printStartupReport();
+}
+
+
+Game::BackgroundLoading::BackgroundLoading(
+  const std::string& gamePath,
+  const loader::ResourceLoader& resources
+) {
+  // The resource loader only reads from its in-memory copy of the game's
+  // data files here, which is safe to do from multiple threads.
+  auto timed = [](engine::TimeDelta& duration, auto func) {
+    return [&duration, func = std::move(func)]() {
+      const auto start = std::chrono::steady_clock::now();
+      auto result = func();
+      duration = std::chrono::duration<engine::TimeDelta>(
+        std::chrono::steady_clock::now() - start).count();
+      return result;
+    };
+  };
+
+  mUserProfile = std::async(
+    std::launch::async,
+    timed(mUserProfileTime, [gamePath]() {
+      return loadOrCreateUserProfile(gamePath);
+    }));
+  mScripts = std::async(
+    std::launch::async,
+    timed(mScriptsTime, [&resources]() { return loadScripts(resources); }));
+  mUiSpriteSheetImage = std::async(
+    std::launch::async,
+    timed(mUiSpriteSheetTime, [&resources]() {
+      return resources.loadTiledFullscreenImage("STATUS.MNI");
+    }));
+}
+
+
+void Game::printStartupReport() const {
+  auto toMs = [](const engine::TimeDelta seconds) {
+    return static_cast<int>(seconds * 1000.0);
+  };
+
+  const auto total = std::chrono::duration<engine::TimeDelta>(
+    std::chrono::steady_clock::now() - mStartupBegin).count();
+
+  std::cout
+    << "Startup took " << toMs(total) << " ms. Loaded in the background: "
+    << "user profile " << toMs(mBackgroundLoading.mUserProfileTime) << " ms, "
+    << "scripts " << toMs(mBackgroundLoading.mScriptsTime) << " ms, "
+    << "UI sprite sheet " << toMs(mBackgroundLoading.mUiSpriteSheetTime)
+    << " ms\n";
 }
 
 
@@ -144,11 +363,49 @@ void Game::run(const StartupOptions& startupOptions) {
   mRenderer.clear();
   mRenderer.swapBuffers();
 
-  data::forEachSoundId([this](const auto id) {
-    mSoundsById.emplace_back(mSoundSystem.addSound(mResources.loadSound(id)));
+  std::vector<engine::SoundSystem::SoundLoader> soundLoaders;
+  data::forEachSoundId([&](const auto id) {
+    soundLoaders.push_back([this, id]() { return mResources.loadSound(id); });
   });
+  mSoundsById = mSoundSystem.addSoundsAsync(std::move(soundLoaders));
 
   mMusicEnabled = startupOptions.mEnableMusic;
+  mViewPortSize = startupOptions.mViewPortSize;
+
+  if (startupOptions.mNativeResolutionComposition) {
+    mUseNativeComposition = true;
+    mRenderTarget = renderer::RenderTargetTexture{
+      &mRenderer,
+      static_cast<std::size_t>(
+        data::GameTraits::viewPortWidthPx + mViewPortSize.extraWidthPx()),
+      static_cast<std::size_t>(data::GameTraits::viewPortHeightPx)};
+  }
+  mGameSpeedMultiplier = startupOptions.mGameSpeedMultiplier;
+
+  if (startupOptions.mTraceFile) {
+    mTraceFile = *startupOptions.mTraceFile;
+    engine::traceRecorder().setEnabled(true);
+  }
+
+  if (startupOptions.mFlightRecorderPrefix) {
+    engine::flightRecorder().enable(*startupOptions.mFlightRecorderPrefix);
+  }
+
+  mDumpRenderStats = startupOptions.mDumpRenderStats;
+  mMeasureInputLatency = startupOptions.mMeasureInputLatency;
+
+  if (startupOptions.mMetricsLogFile) {
+    mpMetricsLog =
+      std::make_unique<engine::MetricsLog>(*startupOptions.mMetricsLogFile);
+  }
+
+  if (startupOptions.mFrameCaptureFile) {
+    mFrameCaptureFile = *startupOptions.mFrameCaptureFile;
+    mFrameCapture.startContinuousCapture(mFrameCaptureFile);
+  }
+
+  applyVsyncMode(startupOptions.mVsyncMode);
+  mFramePacer = engine::FramePacer{startupOptions.mTargetFrameRate};
 
   // Check if running registered version
   if (
@@ -158,14 +415,22 @@ void Game::run(const StartupOptions& startupOptions) {
     mIsShareWareVersion = false;
   }
 
-  if (startupOptions.mLevelToJumpTo)
+  if (startupOptions.mReplayFile)
+  {
+    mpNextGameMode = std::make_unique<ReplayMode>(
+      game_logic::loadReplay(*startupOptions.mReplayFile),
+      makeModeContext(),
+      startupOptions.mUnthrottledReplay);
+  }
+  else if (startupOptions.mLevelToJumpTo)
   {
     auto [episode, level] = *startupOptions.mLevelToJumpTo;
 
     mpNextGameMode = std::make_unique<GameSessionMode>(
       data::GameSessionId{episode, level, data::Difficulty::Medium},
       makeModeContext(),
-      startupOptions.mPlayerPosition);
+      startupOptions.mPlayerPosition,
+      startupOptions.mReplayRecordingFile);
   }
   else if (startupOptions.mSkipIntro)
   {
@@ -184,6 +449,105 @@ void Game::run(const StartupOptions& startupOptions) {
   mainLoop();
 
   mUserProfile.saveToDisk();
+
+  if (const auto underruns = mSoundSystem.underrunCount(); underruns > 0) {
+    std::cout
+      << "Audio: " << underruns << " buffer underruns detected with a buffer "
+      << "size of " << mSoundSystem.activeSettings().mBufferSize
+      << " samples at " << mSoundSystem.activeSettings().mSampleRate
+      << " Hz. Consider increasing the buffer size (--audio-buffer-size).\n";
+  }
+
+  if (startupOptions.mTraceFile) {
+    writeTraceFile();
+  }
+
+  if (startupOptions.mMemoryBudget || mDumpRenderStats) {
+    base::memory_accounting::printReport(std::cout);
+  }
+}
+
+
+void Game::applyVsyncMode(const VsyncMode mode) {
+  switch (mode) {
+    case VsyncMode::Off:
+      SDL_GL_SetSwapInterval(0);
+      break;
+
+    case VsyncMode::On:
+      SDL_GL_SetSwapInterval(1);
+      break;
+
+    case VsyncMode::Adaptive:
+      if (SDL_GL_SetSwapInterval(-1) != 0) {
+        std::cerr
+          << "WARNING: Adaptive vsync not supported, using regular vsync\n";
+        SDL_GL_SetSwapInterval(1);
+      }
+      break;
+  }
+}
+
+
+void Game::writeTraceFile() {
+  std::ofstream file(mTraceFile);
+  if (!file.is_open()) {
+    std::cerr << "WARNING: Failed to write trace file " << mTraceFile << '\n';
+    return;
+  }
+
+  engine::traceRecorder().writeChromeTrace(file);
+  std::cout << "Trace written to " << mTraceFile << '\n';
+}
+
+
+void Game::takeScreenshot() {
+  if (!mFrameCapture.isSupported()) {
+    std::cerr << "WARNING: Frame capture not supported\n";
+    return;
+  }
+
+  // Don't overwrite screenshots from previous runs
+  auto path = std::string{};
+  do {
+    path =
+      "screenshot_" + std::to_string(mNextScreenshotNumber++) + ".png";
+  } while (std::filesystem::exists(path));
+
+  mFrameCapture.requestScreenshot(path);
+  mNeedsPresentation = true;
+}
+
+
+void Game::toggleContinuousFrameCapture() {
+  if (!mFrameCapture.isSupported()) {
+    std::cerr << "WARNING: Frame capture not supported\n";
+    return;
+  }
+
+  if (mFrameCapture.isCapturingContinuously()) {
+    mFrameCapture.stopContinuousCapture();
+    std::cout
+      << "Frame capture written to " << mFrameCaptureFile << " ("
+      << mFrameCapture.droppedFrameCount() << " frames dropped so far)\n";
+  } else {
+    mFrameCapture.startContinuousCapture(mFrameCaptureFile);
+    std::cout << "Capturing frames to " << mFrameCaptureFile << '\n';
+  }
+}
+
+
+void Game::reportInputLatency() {
+  const auto latency = SDL_GetTicks() - *mLatencyProbeKeyPressTime;
+  mTotalMeasuredInputLatency += latency;
+  ++mNumInputLatencySamples;
+
+  std::cout << "Input latency: " << latency << " ms (average "
+    << mTotalMeasuredInputLatency / mNumInputLatencySamples << " ms over "
+    << mNumInputLatencySamples << " key presses)\n";
+
+  mLatencyProbeKeyPressTime = std::nullopt;
+  mLatencyProbeInputProcessed = false;
 }
 
 
@@ -208,51 +572,272 @@ void Game::mainLoop() {
   mLastTime = high_resolution_clock::now();
 
   for (;;) {
+    engine::TraceZone frameZone("Frame");
+    mFramePacer.beginFrame();
+
     const auto startOfFrame = high_resolution_clock::now();
     const auto elapsed =
       duration<entityx::TimeDelta>(startOfFrame - mLastTime).count();
     mLastTime = startOfFrame;
 
-    ui::imgui_integration::beginFrame(mpWindow);
-    ImGui::SetMouseCursor(ImGuiMouseCursor_None);
+    const auto contentVersionAtStart = mRenderer.contentVersion();
+    const auto wasMinimized = mIsMinimized;
 
     {
       RenderTargetBinder bindRenderTarget(mRenderTarget, &mRenderer);
-      auto saved = setupSimpleUpscaling(&mRenderer);
-
-      while (mIsMinimized && SDL_WaitEvent(&event)) {
-        handleEvent(event);
-      }
-      while (SDL_PollEvent(&event)) {
-        handleEvent(event);
+      auto saved = mUseNativeComposition
+        ? setupNativeComposition(&mRenderer, mViewPortSize)
+        : setupSimpleUpscaling(&mRenderer);
+
+      {
+        engine::TraceZone zone("Event polling");
+        if (mModeSwitchState == ModeSwitchState::None) {
+          while (mIsMinimized && SDL_WaitEvent(&event)) {
+            handleEvent(event);
+          }
+          while (SDL_PollEvent(&event)) {
+            handleEvent(event);
+          }
+        } else {
+          // Input is left in the queue until the new mode is fully shown, so
+          // that neither mode sees it mid-transition. Quitting still works.
+          SDL_PumpEvents();
+          if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_QUIT, SDL_QUIT) > 0) {
+            handleEvent(event);
+          }
+        }
       }
       if (!mIsRunning) {
         break;
       }
 
-      if (mpNextGameMode) {
-        fadeOutScreen();
-        mpCurrentGameMode = std::move(mpNextGameMode);
-        mpCurrentGameMode->updateAndRender(0);
-        fadeInScreen();
+      mSoundSystem.update();
+
+      // ImGui stays dormant unless some debug UI is shown. This needs to be
+      // decided after event handling, since that's where debug UI is
+      // toggled.
+      mIsDebugUiActive = isShowingDebugUi();
+      if (mIsDebugUiActive) {
+        ui::imgui_integration::beginFrame(mpWindow);
+        ImGui::SetMouseCursor(ImGuiMouseCursor_None);
+      }
+
+      engine::TraceZone zone("Mode update");
+      if (mpNextGameMode && mModeSwitchState == ModeSwitchState::None) {
+        startModeSwitch();
       }
 
-      mpCurrentGameMode->updateAndRender(elapsed);
+      if (mModeSwitchState != ModeSwitchState::None) {
+        updateModeSwitch(elapsed);
+      } else {
+        mpCurrentGameMode->updateAndRender(elapsed);
+      }
     }
 
-    mRenderer.clear();
-    mRenderTarget.render(&mRenderer, 0, 0);
-    mRenderer.submitBatch();
+    const auto renderTargetChanged =
+      mRenderer.contentVersion() != contentVersionAtStart;
+
+    if (renderTargetChanged && gFlushBeforeUiWork) {
+      engine::TraceZone zone("GPU flush");
+      mRenderer.flushCommands();
+    }
+
+    const auto afterRender = high_resolution_clock::now();
+    const auto innerRenderTime =
+      duration<engine::TimeDelta>(afterRender - startOfFrame).count();
 
     if (mShowFps) {
-      const auto afterRender = high_resolution_clock::now();
-      const auto innerRenderTime =
-        duration<engine::TimeDelta>(afterRender - startOfFrame).count();
-      mFpsDisplay.updateAndRender(elapsed, innerRenderTime);
+      mFpsDisplay.updateAndRender(
+        elapsed, innerRenderTime, mRenderer.lastFrameStatistics());
     }
 
-    ui::imgui_integration::endFrame();
-    mRenderer.swapBuffers();
+    if (mShowRenderProfiler) {
+      ui::showRenderProfilerWindow(mRenderer);
+    }
+
+    if (mShowAudioStatistics) {
+      ui::showAudioStatisticsWindow(mSoundSystem.statistics());
+    }
+
+    if (mShowMemoryStatistics) {
+      ui::showMemoryStatisticsWindow();
+    }
+
+    if (mShowTunables) {
+      ui::showTunablesWindow();
+    }
+
+    auto hasImGuiContent = false;
+    if (mIsDebugUiActive) {
+      engine::TraceZone zone("ImGui");
+      hasImGuiContent = ui::imgui_integration::endFrame();
+    }
+
+    // If nothing changed, what's on screen is still up to date, so we can
+    // skip presenting altogether. We only do that while the current mode is
+    // idling, though: Otherwise, the loop would spin without being throttled
+    // by vsync.
+    const auto needsPresentation = mNeedsPresentation ||
+      renderTargetChanged || hasImGuiContent || mShowFps || mpNextGameMode ||
+      mModeSwitchState != ModeSwitchState::None ||
+      mFrameCapture.hasPendingRequest() ||
+      !mpCurrentGameMode->timeUntilNextUpdate();
+
+    if (needsPresentation) {
+      {
+        engine::TraceZone zone("Frame capture");
+        mFrameCapture.capture(&mRenderer, mRenderTarget.renderTarget());
+      }
+
+      // Game modes rely on the render target's contents staying in place
+      // across frames, and fades need the last frame, so we can't render
+      // into the back buffer directly. Copying the whole render target is
+      // cheaper than drawing it, though.
+      {
+        engine::TraceZone zone("Render target blit");
+        mRenderer.clear();
+
+        // Blitting ignores color modulation, so we need to draw the render
+        // target as a regular quad while a mode switch fade is running.
+        // In native composition mode, drawing it is the upscaling pass.
+        if (mModeSwitchState != ModeSwitchState::None) {
+          mRenderer.setColorModulation({255, 255, 255, mAlphaMod});
+          drawRenderTarget();
+          mRenderer.setColorModulation({255, 255, 255, 255});
+        } else if (mUseNativeComposition) {
+          drawRenderTarget();
+        } else {
+          mRenderTarget.blit(&mRenderer);
+        }
+      }
+
+      if (hasImGuiContent) {
+        engine::TraceZone zone("ImGui rendering");
+        ui::imgui_integration::renderFrame();
+      }
+
+      {
+        engine::TraceZone zone("Swap buffers");
+        mRenderer.swapBuffers();
+      }
+
+      if (mLatencyProbeInputProcessed) {
+        reportInputLatency();
+      }
+
+      mNeedsPresentation = false;
+    }
+
+    // Time spent waiting for the next frame or, while minimized, for input
+    // doesn't count. Idling modes would trigger the flight recorder all the
+    // time otherwise.
+    if (engine::flightRecorder().isEnabled() && !wasMinimized) {
+      recordFrameForFlightRecorder(startOfFrame);
+    }
+
+    if (mpMetricsLog) {
+      logFrameMetrics(elapsed, innerRenderTime);
+    }
+
+    if (mDumpRenderStats) {
+      mTimeSinceLastStatsDump += elapsed;
+      if (mTimeSinceLastStatsDump >= RENDER_STATS_DUMP_INTERVAL) {
+        printRenderStats(std::cout, mRenderer.lastFrameStatistics());
+        engine::printFramePacingReport(
+          std::cout, mFramePacer.takeReport(), mFramePacer.frameBudgetMs());
+        engine::allocation_tracking::printScopeStatistics(std::cout);
+        base::memory_accounting::printReport(std::cout);
+        mTimeSinceLastStatsDump = 0.0;
+      }
+    }
+
+    {
+      engine::TraceZone zone("Frame pacing");
+      mFramePacer.waitForNextFrame();
+    }
+
+    waitUntilNextUpdateIsNeeded();
+  }
+}
+
+
+void Game::recordFrameForFlightRecorder(
+  const std::chrono::high_resolution_clock::time_point startOfFrame
+) {
+  using namespace std::chrono;
+
+  const auto now = high_resolution_clock::now();
+  const auto& renderStats = mRenderer.lastFrameStatistics();
+
+  auto& recorder = engine::traceRecorder();
+  const auto traceTime = engine::TraceRecorder::Clock::now();
+  recorder.addCounter("Draw calls", traceTime, renderStats.mDrawCalls);
+  recorder.addCounter(
+    "Bytes uploaded",
+    traceTime,
+    static_cast<std::int64_t>(renderStats.mBytesUploaded));
+
+  engine::flightRecorder().checkFrameTime(
+    duration<double, std::milli>(now - startOfFrame).count());
+}
+
+
+void Game::logFrameMetrics(
+  const engine::TimeDelta frameTime,
+  const engine::TimeDelta innerRenderTime
+) {
+  const auto& renderStats = mRenderer.lastFrameStatistics();
+  const auto& audioStats = mSoundSystem.statistics();
+  auto read = [](const std::atomic<std::uint64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+  };
+
+  engine::FrameMetrics metrics;
+  metrics.mFrameTimeMs = frameTime * 1000.0;
+  metrics.mRenderTimeMs = innerRenderTime * 1000.0;
+  metrics.mDrawCalls = renderStats.mDrawCalls;
+  metrics.mQuads = renderStats.mQuads;
+  metrics.mBytesUploaded = renderStats.mBytesUploaded;
+  metrics.mNumAudioCallbacks = read(audioStats.mNumCallbacks);
+  metrics.mTotalAudioCallbackTimeNs = read(audioStats.mTotalCallbackTimeNs);
+  metrics.mNumAudioUnderruns = read(audioStats.mNumUnderruns);
+  metrics.mNumAllocations =
+    engine::allocation_tracking::threadCounters().mNumAllocations;
+  metrics.mMemoryBytes = base::memory_accounting::totalBytes();
+  mpMetricsLog->addFrame(metrics);
+}
+
+
+bool Game::isShowingDebugUi() const {
+  return mShowFps || mShowRenderProfiler || mShowAudioStatistics ||
+    mShowMemoryStatistics || mShowTunables ||
+    mpCurrentGameMode->isShowingDebugUi();
+}
+
+
+void Game::waitUntilNextUpdateIsNeeded() {
+  // While showing a static screen, there's no point in rendering and
+  // presenting the same frame over and over. We wait for the next event
+  // instead, or until the mode's next animation step is due. Any event
+  // (including window exposure) causes a new frame to be presented, since
+  // the event is left in the queue for the main loop to handle.
+  if (
+    mShowFps || mShowRenderProfiler || mShowAudioStatistics ||
+    mShowMemoryStatistics || mShowTunables || mpNextGameMode ||
+    mModeSwitchState != ModeSwitchState::None
+  ) {
+    return;
+  }
+
+  const auto maybeIdleTime = mpCurrentGameMode->timeUntilNextUpdate();
+  if (!maybeIdleTime) {
+    return;
+  }
+
+  const auto idleTime = std::min(*maybeIdleTime, MAX_IDLE_TIME);
+  const auto timeoutMs = static_cast<int>(std::ceil(idleTime * 1000.0));
+  if (timeoutMs > 0) {
+    SDL_WaitEventTimeout(nullptr, timeoutMs);
   }
 }
 
@@ -266,19 +851,54 @@ GameMode::Context Game::makeModeContext() {
     &mAllScripts,
     &mTextRenderer,
     &mUiSpriteSheet,
-    &mUserProfile};
+    &mUserProfile,
+    &mSpriteFactory,
+    &mHudAssets,
+    &mFullScreenImages,
+    mViewPortSize,
+    mGameSpeedMultiplier};
 }
 
 
 void Game::handleEvent(const SDL_Event& event) {
-  if (ui::imgui_integration::handleEvent(event)) {
+  // While dormant, ImGui doesn't see any events. Otherwise, it would keep
+  // accumulating input like text and mouse wheel movement.
+  if (mIsDebugUiActive && ui::imgui_integration::handleEvent(event)) {
     return;
   }
 
+  if (
+    mMeasureInputLatency && event.type == SDL_KEYDOWN && !event.key.repeat &&
+    !mLatencyProbeKeyPressTime
+  ) {
+    mLatencyProbeKeyPressTime = event.key.timestamp;
+  }
+
   switch (event.type) {
     case SDL_KEYUP:
-      if (event.key.keysym.sym == SDLK_F6) {
+      if (event.key.keysym.sym == SDLK_F4) {
+        mShowTunables = !mShowTunables;
+      } else if (event.key.keysym.sym == SDLK_F6) {
         mShowFps = !mShowFps;
+      } else if (event.key.keysym.sym == SDLK_F7) {
+        mShowRenderProfiler = !mShowRenderProfiler;
+        mRenderer.gpuProfiler().setEnabled(mShowRenderProfiler);
+      } else if (event.key.keysym.sym == SDLK_F8) {
+        mShowAudioStatistics = !mShowAudioStatistics;
+      } else if (event.key.keysym.sym == SDLK_F9) {
+        // First press starts recording, subsequent ones write out what has
+        // been recorded so far
+        if (engine::traceRecorder().isEnabled()) {
+          writeTraceFile();
+        } else {
+          engine::traceRecorder().setEnabled(true);
+        }
+      } else if (event.key.keysym.sym == SDLK_F10) {
+        takeScreenshot();
+      } else if (event.key.keysym.sym == SDLK_F11) {
+        toggleContinuousFrameCapture();
+      } else if (event.key.keysym.sym == SDLK_F12) {
+        mShowMemoryStatistics = !mShowMemoryStatistics;
       }
       mpCurrentGameMode->handleEvent(event);
       break;
@@ -292,6 +912,12 @@ void Game::handleEvent(const SDL_Event& event) {
         mIsMinimized = true;
       } else if (event.window.event == SDL_WINDOWEVENT_RESTORED) {
         mIsMinimized = false;
+        mNeedsPresentation = true;
+      } else if (
+        event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+        event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED
+      ) {
+        mNeedsPresentation = true;
       }
       break;
 
@@ -302,6 +928,58 @@ void Game::handleEvent(const SDL_Event& event) {
 }
 
 
+void Game::startModeSwitch() {
+  mModeSwitchFadeTime = 0.0;
+
+  // The current mode might have faded out already by itself
+  if (mAlphaMod == 0) {
+    switchToNextMode();
+  } else {
+    mModeSwitchState = ModeSwitchState::FadingOut;
+  }
+}
+
+
+void Game::updateModeSwitch(const engine::TimeDelta elapsed) {
+  mModeSwitchFadeTime += elapsed;
+
+  const auto isFadeIn = mModeSwitchState == ModeSwitchState::FadingIn;
+  if (const auto maybeAlpha = fadeAlpha(mModeSwitchFadeTime, isFadeIn)) {
+    mAlphaMod = *maybeAlpha;
+    return;
+  }
+
+  if (isFadeIn) {
+    mAlphaMod = 255;
+    mModeSwitchState = ModeSwitchState::None;
+  } else {
+    mAlphaMod = 0;
+    switchToNextMode();
+  }
+}
+
+
+void Game::switchToNextMode() {
+  // Clear render canvas after a fade-out. We're drawing into the render
+  // target at this point already.
+  mRenderer.clear();
+
+  mpCurrentGameMode = std::move(mpNextGameMode);
+  mpCurrentGameMode->updateAndRender(0);
+
+  // A key press which caused the mode switch doesn't say anything about
+  // the new mode's latency
+  mLatencyProbeKeyPressTime = std::nullopt;
+  mLatencyProbeInputProcessed = false;
+
+  // The new mode might have faded in already by itself
+  mModeSwitchFadeTime = 0.0;
+  mModeSwitchState = mAlphaMod == 255
+    ? ModeSwitchState::None
+    : ModeSwitchState::FadingIn;
+}
+
+
 void Game::performScreenFadeBlocking(const bool doFadeIn) {
   using namespace std::chrono;
 
@@ -320,23 +998,16 @@ void Game::performScreenFadeBlocking(const bool doFadeIn) {
     mLastTime = now;
 
     elapsedTime += timeDelta;
-    const auto fastTicksElapsed = engine::timeToFastTicks(elapsedTime);
-    const auto fadeFactor = (fastTicksElapsed / 4.0) / 16.0;
-
-    if (fadeFactor < 1.0) {
-      const auto alpha = doFadeIn ? fadeFactor : 1.0 - fadeFactor;
-      mAlphaMod = base::roundTo<std::uint8_t>(255.0 * alpha);
-    } else {
-      mAlphaMod = doFadeIn ? 255 : 0;
-    }
+    const auto maybeAlpha = fadeAlpha(elapsedTime, doFadeIn);
+    mAlphaMod = maybeAlpha ? *maybeAlpha : (doFadeIn ? 255 : 0);
 
     mRenderer.clear();
 
     mRenderer.setColorModulation({255, 255, 255, mAlphaMod});
-    mRenderTarget.render(&mRenderer, 0, 0);
+    drawRenderTarget();
     mRenderer.swapBuffers();
 
-    if (fadeFactor >= 1.0) {
+    if (!maybeAlpha) {
       break;
     }
   }
@@ -345,6 +1016,16 @@ void Game::performScreenFadeBlocking(const bool doFadeIn) {
 }
 
 
+void Game::drawRenderTarget() {
+  if (mUseNativeComposition) {
+    mRenderTarget.renderScaled(
+      &mRenderer, nativeCompositionDestRect(&mRenderer, mViewPortSize));
+  } else {
+    mRenderTarget.render(&mRenderer, 0, 0);
+  }
+}
+
+
 void Game::fadeOutScreen() {
   performScreenFadeBlocking(false);
 
@@ -417,4 +1098,11 @@ void Game::scheduleGameQuit() {
   mIsRunning = false;
 }
 
+
+void Game::markInputProcessed() {
+  if (mLatencyProbeKeyPressTime) {
+    mLatencyProbeInputProcessed = true;
+  }
+}
+
 }
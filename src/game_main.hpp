@@ -18,11 +18,14 @@
 
 #include "base/warnings.hpp"
 #include "base/spatial_types.hpp"
+#include "data/game_traits.hpp"
+#include "engine/sound_system.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <SDL_video.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <utility>
@@ -30,12 +33,36 @@ RIGEL_RESTORE_WARNINGS
 
 namespace rigel {
 
+enum class VsyncMode {
+  Off,
+  On,
+  Adaptive
+};
+
+
 struct StartupOptions {
   std::string mGamePath;
   std::optional<std::pair<int, int>> mLevelToJumpTo;
   bool mSkipIntro = false;
   bool mEnableMusic = true;
   std::optional<base::Vector> mPlayerPosition;
+  std::optional<std::string> mReplayRecordingFile;
+  std::optional<std::string> mReplayFile;
+  bool mUnthrottledReplay = false;
+  std::optional<std::string> mTraceFile;
+  std::optional<std::string> mFrameCaptureFile;
+  std::optional<std::string> mMetricsLogFile;
+  std::optional<std::string> mFlightRecorderPrefix;
+  bool mDumpRenderStats = false;
+  engine::AudioSettings mAudioSettings;
+  std::optional<std::string> mAssetCacheDirectory;
+  VsyncMode mVsyncMode = VsyncMode::On;
+  std::optional<int> mTargetFrameRate;
+  data::ViewPortSize mViewPortSize;
+  int mGameSpeedMultiplier = 1;
+  bool mMeasureInputLatency = false;
+  bool mNativeResolutionComposition = false;
+  std::optional<std::int64_t> mMemoryBudget;
 };
 
 
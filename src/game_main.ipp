@@ -16,22 +16,30 @@
 
 #pragma once
 
+#include "base/memory_accounting.hpp"
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "common/game_mode.hpp"
 #include "common/game_service_provider.hpp"
 #include "common/user_profile.hpp"
+#include "engine/frame_pacer.hpp"
+#include "engine/metrics_log.hpp"
 #include "engine/sound_system.hpp"
 #include "engine/tiled_texture.hpp"
+#include "game_logic/entity_factory.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "loader/resource_loader.hpp"
+#include "renderer/frame_capture.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/texture.hpp"
 #include "ui/duke_script_runner.hpp"
 #include "ui/fps_display.hpp"
+#include "ui/full_screen_image_cache.hpp"
+#include "ui/hud_renderer.hpp"
 #include "ui/menu_element_renderer.hpp"
 
 #include <chrono>
+#include <future>
 #include <memory>
 #include <string>
 
@@ -41,7 +49,11 @@ namespace rigel {
 
 class Game : public IGameServiceProvider {
 public:
-  Game(const std::string& gamePath, SDL_Window* pWindow);
+  Game(
+    const std::string& gamePath,
+    const std::optional<std::string>& maybeAssetCacheDirectory,
+    const engine::AudioSettings& audioSettings,
+    SDL_Window* pWindow);
   Game(const Game&) = delete;
   Game& operator=(const Game&) = delete;
 
@@ -51,12 +63,30 @@ private:
   void showAntiPiracyScreen();
 
   void mainLoop();
+  bool isShowingDebugUi() const;
+  void recordFrameForFlightRecorder(
+    std::chrono::high_resolution_clock::time_point startOfFrame);
+  void logFrameMetrics(
+    engine::TimeDelta frameTime,
+    engine::TimeDelta innerRenderTime);
+  void waitUntilNextUpdateIsNeeded();
 
   GameMode::Context makeModeContext();
 
   void handleEvent(const SDL_Event& event);
 
+  void startModeSwitch();
+  void updateModeSwitch(engine::TimeDelta elapsed);
+  void switchToNextMode();
+
+  void applyVsyncMode(VsyncMode mode);
+
   void performScreenFadeBlocking(bool doFadeIn);
+  void drawRenderTarget();
+  void writeTraceFile();
+  void takeScreenshot();
+  void toggleContinuousFrameCapture();
+  void reportInputLatency();
 
   // IGameServiceProvider implementation
   void fadeOutScreen() override;
@@ -77,32 +107,115 @@ private:
     return mIsShareWareVersion;
   }
 
+  void markInputProcessed() override;
+
 private:
+  /** Loading work which doesn't need the renderer
+   *
+   * Started on worker threads as soon as mResources is available, so that
+   * it overlaps with setting up the renderer, which needs to happen on the
+   * main thread. Each job records how long it took, for the startup report.
+   */
+  struct BackgroundLoading {
+    BackgroundLoading(
+      const std::string& gamePath,
+      const loader::ResourceLoader& resources);
+
+    engine::TimeDelta mUserProfileTime = 0.0;
+    engine::TimeDelta mScriptsTime = 0.0;
+    engine::TimeDelta mUiSpriteSheetTime = 0.0;
+
+    std::future<UserProfile> mUserProfile;
+    std::future<loader::ScriptBundle> mScripts;
+    std::future<data::Image> mUiSpriteSheetImage;
+  };
+
+  void printStartupReport() const;
+
+  std::chrono::steady_clock::time_point mStartupBegin =
+    std::chrono::steady_clock::now();
   SDL_Window* mpWindow;
+  loader::ResourceLoader mResources;
+  BackgroundLoading mBackgroundLoading;
   renderer::Renderer mRenderer;
+
+  // Declared after mResources, since sounds are loaded in the background
+  // using mResources
   engine::SoundSystem mSoundSystem;
-  loader::ResourceLoader mResources;
   bool mIsShareWareVersion;
 
+  // Shared by all game worlds, so that sprites are kept across levels.
+  // Declared before the game modes, which hold on to some of its sprites.
+  game_logic::SpriteFactory mSpriteFactory;
+
+  // Same for the HUD's textures
+  ui::HudAssets mHudAssets;
+  ui::FullScreenImageCache mFullScreenImages;
+
+  // Window sized by default. With native resolution composition, it's the
+  // size of the original screen (plus extra view width) instead, and gets
+  // upscaled when drawn to the screen.
   renderer::RenderTargetTexture mRenderTarget;
+  bool mUseNativeComposition = false;
   std::uint8_t mAlphaMod = 255;
 
   std::unique_ptr<GameMode> mpCurrentGameMode;
   std::unique_ptr<GameMode> mpNextGameMode;
 
+  // Switching to the next game mode fades out the current one and fades in
+  // the new one. Unlike the fades requested by game modes themselves, this
+  // happens over multiple iterations of the main loop instead of blocking it.
+  enum class ModeSwitchState {
+    None,
+    FadingOut,
+    FadingIn
+  };
+
+  ModeSwitchState mModeSwitchState = ModeSwitchState::None;
+  engine::TimeDelta mModeSwitchFadeTime = 0.0;
+
   std::vector<engine::SoundSystem::SoundHandle> mSoundsById;
 
+  data::ViewPortSize mViewPortSize;
+  int mGameSpeedMultiplier = 1;
   bool mMusicEnabled = true;
   bool mShowFps = false;
+  bool mShowRenderProfiler = false;
+  bool mShowAudioStatistics = false;
+  bool mShowMemoryStatistics = false;
+  bool mShowTunables = false;
+  bool mIsDebugUiActive = false;
+  bool mDumpRenderStats = false;
+  engine::TimeDelta mTimeSinceLastStatsDump = 0.0;
+  std::string mTraceFile = "frame_trace.json";
+  std::string mFrameCaptureFile = "frame_capture.raw";
+  int mNextScreenshotNumber = 1;
+
+  // Input latency probe: Measures one key press at a time, from SDL's
+  // timestamp for the key down event until the first frame presented after
+  // a game mode has acted on it.
+  bool mMeasureInputLatency = false;
+  std::optional<std::uint32_t> mLatencyProbeKeyPressTime;
+  bool mLatencyProbeInputProcessed = false;
+  std::uint32_t mTotalMeasuredInputLatency = 0;
+  int mNumInputLatencySamples = 0;
 
   bool mIsRunning;
   bool mIsMinimized;
+
+  // Set when the window's contents need to be presented again even if the
+  // render target didn't change, e.g. after the window was uncovered
+  bool mNeedsPresentation = true;
   std::chrono::high_resolution_clock::time_point mLastTime;
+  engine::FramePacer mFramePacer{std::nullopt};
+  renderer::FrameCapture mFrameCapture;
+  std::unique_ptr<engine::MetricsLog> mpMetricsLog;
 
   UserProfile mUserProfile;
 
   ui::DukeScriptRunner mScriptRunner;
   loader::ScriptBundle mAllScripts;
+  base::memory_accounting::TrackedBytes mAllScriptsBytes;
   engine::TiledTexture mUiSpriteSheet;
   ui::MenuElementRenderer mTextRenderer;
   ui::FpsDisplay mFpsDisplay;
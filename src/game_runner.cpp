@@ -17,32 +17,42 @@
 #include "game_runner.hpp"
 
 #include "base/match.hpp"
+#include "base/tunables.hpp"
 #include "common/game_service_provider.hpp"
 #include "common/user_profile.hpp"
+#include "engine/trace_recorder.hpp"
 #include "game_logic/ingame_systems.hpp"
 #include "loader/resource_loader.hpp"
+#include "ui/logic_profiler_window.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
 
 
 namespace rigel {
 
 namespace {
 
-// Update game logic at 15 FPS. This is not exactly the speed at which the
-// game runs on period-appropriate hardware, but it's very close, and it nicely
-// fits into 60 FPS, giving us 4 render frames for 1 logic update.
-//
-// On a 486 with a fast graphics card, the game runs at roughly 15.5 FPS, with
-// a slower (non-VLB) graphics card, it's roughly 14 FPS. On a fast 386 (40 MHz),
-// it's roughly 13 FPS. With 15 FPS, the feel should therefore be very close to
-// playing the game on a 486 at the default game speed setting.
-constexpr auto GAME_LOGIC_UPDATE_DELAY = 1.0/15.0;
-
 constexpr auto SAVE_SLOT_NAME_ENTRY_POS_X = 14;
 constexpr auto SAVE_SLOT_NAME_ENTRY_START_POS_Y = 6;
 constexpr auto SAVE_SLOT_NAME_HEIGHT = 2;
 
 constexpr auto MAX_SAVE_SLOT_NAME_LENGTH = 18;
 
+// When running at uncapped speed, game logic runs for this long before a
+// frame is rendered, to keep the window responsive
+constexpr auto UNCAPPED_TIME_BUDGET_PER_FRAME = std::chrono::milliseconds{15};
+
+constexpr auto MAX_SPEED_MULTIPLIER_VIA_HOTKEY = 16;
+
+
+base::Tunable<bool> gInterpolateMotion{
+  "interpolate-motion",
+  "Draw the world in between logic updates, for smoother motion at high "
+  "frame rates. Also toggled by the I debug key.",
+  false};
+
 
 bool isNonRepeatKeyDown(const SDL_Event& event) {
   return event.type == SDL_KEYDOWN && event.key.repeat == 0;
@@ -71,7 +81,8 @@ GameRunner::GameRunner(
   const data::GameSessionId& sessionId,
   GameMode::Context context,
   const std::optional<base::Vector> playerPositionOverride,
-  const bool showWelcomeMessage
+  const bool showWelcomeMessage,
+  std::optional<data::map::LevelData> preloadedLevel
 )
   : mContext(context)
   , mSavedGame(createSavedGame(sessionId, *pPlayerModel))
@@ -80,9 +91,40 @@ GameRunner::GameRunner(
       sessionId,
       context,
       playerPositionOverride,
-      showWelcomeMessage)
+      showWelcomeMessage,
+      std::move(preloadedLevel))
 {
-  mStateStack.emplace(World{&mWorld});
+  mStateStack.emplace(World{
+    &mWorld, context.mpServiceProvider, context.mGameSpeedMultiplier});
+}
+
+
+GameRunner::~GameRunner() {
+  if (!mReplayRecording) {
+    return;
+  }
+
+  try {
+    game_logic::saveReplay(*mReplayRecording, mReplayFileName);
+  } catch (const std::exception& error) {
+    std::cerr << "WARNING: Failed to save replay: " << error.what() << '\n';
+  }
+}
+
+
+void GameRunner::startReplayRecording(
+  const std::string& fileName,
+  const std::optional<base::Vector>& playerPositionOverride
+) {
+  assert(std::holds_alternative<World>(mStateStack.top()));
+
+  mReplayRecording = game_logic::Replay{
+    mSavedGame.mSessionId,
+    playerPositionOverride,
+    mWorld.randomGeneratorState(),
+    {}};
+  mReplayFileName = fileName;
+  std::get<World>(mStateStack.top()).mpReplayRecording = &*mReplayRecording;
 }
 
 
@@ -311,26 +353,63 @@ void GameRunner::saveGame(const int slotIndex, std::string_view name) {
 
 void GameRunner::World::handleEvent(const SDL_Event& event) {
   handlePlayerInput(event);
+  handleQuickSaveKeys(event);
   handleDebugKeys(event);
 }
 
 
 void GameRunner::World::updateAndRender(const engine::TimeDelta dt) {
   updateWorld(dt);
-  mpWorld->render();
+
+  // When interpolating, we draw the world at the state in between the last
+  // two game logic updates which corresponds to the time that has passed
+  // since the last update. This lags behind by up to one update, but makes
+  // motion appear a lot smoother when running at a high frame rate.
+  const auto isUncapped =
+    mGameSpeedMultiplier == GameMode::UNCAPPED_GAME_SPEED;
+  const auto interpolationFactor =
+    gInterpolateMotion && !mSingleStepping && !isUncapped
+    ? float(mAccumulatedTime / GAME_LOGIC_UPDATE_DELAY)
+    : 1.0f;
+  mpWorld->updateRealTimeEffects(dt);
+  mpWorld->render(interpolationFactor);
 
   if (mShowDebugText) {
     mpWorld->showDebugText();
   }
 
+  if (mShowLogicProfiler) {
+    ui::showLogicProfilerWindow(mpWorld->mpSystems->profiler());
+  }
+
   mpWorld->processEndOfFrameActions();
+
+  if (mpReplayRecording && !mpReplayRecording->mTicks.empty()) {
+    mpReplayRecording->mTicks.back().mEndOfFrame = true;
+  }
 }
 
 
 void GameRunner::World::updateWorld(const engine::TimeDelta dt) {
+  // Logic ticks run on the main thread, in between rendering. Moving them to
+  // a thread of their own would need a copy of everything the renderer looks
+  // at: Systems, the HUD and the map renderer all draw straight from the
+  // entity manager and map data, which a tick modifies. Ticks also play
+  // sounds and read the player's input as fed in by handleEvent().
   auto update = [this]() {
+    engine::TraceZone zone("Game logic tick");
+
+    if (mpReplayRecording) {
+      mpReplayRecording->mTicks.push_back({mPlayerInput, false});
+    }
+
     mpWorld->updateGameLogic(mPlayerInput);
     mPlayerInput.resetTriggeredStates();
+    mpServiceProvider->markInputProcessed();
+
+    if (mpReplayRecording) {
+      mpReplayRecording->mStateHashes.push_back(mpWorld->computeStateHash());
+    }
   };
 
 
@@ -339,8 +418,16 @@ void GameRunner::World::updateWorld(const engine::TimeDelta dt) {
       update();
       mDoNextSingleStep = false;
     }
+  } else if (mGameSpeedMultiplier == GameMode::UNCAPPED_GAME_SPEED) {
+    using namespace std::chrono;
+
+    const auto frameDeadline =
+      steady_clock::now() + UNCAPPED_TIME_BUDGET_PER_FRAME;
+    do {
+      update();
+    } while (steady_clock::now() < frameDeadline);
   } else {
-    mAccumulatedTime += dt;
+    mAccumulatedTime += dt * mGameSpeedMultiplier;
     for (;
       mAccumulatedTime >= GAME_LOGIC_UPDATE_DELAY;
       mAccumulatedTime -= GAME_LOGIC_UPDATE_DELAY
@@ -399,6 +486,29 @@ void GameRunner::World::handlePlayerInput(const SDL_Event& event) {
 }
 
 
+void GameRunner::World::handleQuickSaveKeys(const SDL_Event& event) {
+  if (!isNonRepeatKeyDown(event)) {
+    return;
+  }
+
+  switch (event.key.keysym.sym) {
+    case SDLK_F5:
+      mpWorld->quickSave();
+      break;
+
+    case SDLK_F9:
+      // A replay only consists of the input for each tick, it can't
+      // represent jumping back in time.
+      if (mpWorld->canQuickLoad() && !mpReplayRecording) {
+        mpWorld->quickLoad();
+        mPlayerInput = {};
+        mAccumulatedTime = 0.0;
+      }
+      break;
+  }
+}
+
+
 void GameRunner::World::handleDebugKeys(const SDL_Event& event) {
   if (!isNonRepeatKeyDown(event)) {
     return;
@@ -422,10 +532,22 @@ void GameRunner::World::handleDebugKeys(const SDL_Event& event) {
       debuggingSystem.toggleGridDisplay();
       break;
 
+    case SDLK_i:
+      gInterpolateMotion.set(!gInterpolateMotion);
+      break;
+
+    case SDLK_l:
+      mShowLogicProfiler = !mShowLogicProfiler;
+      break;
+
     case SDLK_s:
       mSingleStepping = !mSingleStepping;
       break;
 
+    case SDLK_t:
+      cycleGameSpeed();
+      break;
+
     case SDLK_SPACE:
       if (mSingleStepping) {
         mDoNextSingleStep = true;
@@ -435,6 +557,26 @@ void GameRunner::World::handleDebugKeys(const SDL_Event& event) {
 }
 
 
+void GameRunner::World::cycleGameSpeed() {
+  // 1x, 2x, 4x, ..., uncapped, and back to 1x
+  if (mGameSpeedMultiplier == GameMode::UNCAPPED_GAME_SPEED) {
+    mGameSpeedMultiplier = 1;
+  } else if (mGameSpeedMultiplier >= MAX_SPEED_MULTIPLIER_VIA_HOTKEY) {
+    mGameSpeedMultiplier = GameMode::UNCAPPED_GAME_SPEED;
+  } else {
+    mGameSpeedMultiplier *= 2;
+  }
+
+  mAccumulatedTime = 0.0;
+
+  if (mGameSpeedMultiplier == GameMode::UNCAPPED_GAME_SPEED) {
+    std::cout << "Game speed: uncapped\n";
+  } else {
+    std::cout << "Game speed: " << mGameSpeedMultiplier << "x\n";
+  }
+}
+
+
 GameRunner::SavedGameNameEntry::SavedGameNameEntry(
   GameMode::Context context,
   const int slotIndex
@@ -23,6 +23,7 @@
 #include "data/saved_game.hpp"
 #include "game_logic/game_world.hpp"
 #include "game_logic/input.hpp"
+#include "game_logic/replay.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "ui/duke_script_runner.hpp"
 #include "ui/text_entry_widget.hpp"
@@ -38,6 +39,17 @@ RIGEL_RESTORE_WARNINGS
 
 namespace rigel {
 
+// Update game logic at 15 FPS. This is not exactly the speed at which the
+// game runs on period-appropriate hardware, but it's very close, and it nicely
+// fits into 60 FPS, giving us 4 render frames for 1 logic update.
+//
+// On a 486 with a fast graphics card, the game runs at roughly 15.5 FPS, with
+// a slower (non-VLB) graphics card, it's roughly 14 FPS. On a fast 386 (40 MHz),
+// it's roughly 13 FPS. With 15 FPS, the feel should therefore be very close to
+// playing the game on a 486 at the default game speed setting.
+constexpr auto GAME_LOGIC_UPDATE_DELAY = 1.0/15.0;
+
+
 class GameRunner : public entityx::Receiver<GameRunner> {
 public:
   GameRunner(
@@ -45,21 +57,40 @@ public:
     const data::GameSessionId& sessionId,
     GameMode::Context context,
     std::optional<base::Vector> playerPositionOverride = std::nullopt,
-    bool showWelcomeMessage = false);
+    bool showWelcomeMessage = false,
+    std::optional<data::map::LevelData> preloadedLevel = std::nullopt);
+  ~GameRunner();
+
+  /** Record all input from now on, and write it to a replay file
+   *
+   * Should be called right after construction. The replay is written when
+   * the GameRunner is destroyed. playerPositionOverride needs to match what
+   * was given to the constructor.
+   */
+  void startReplayRecording(
+    const std::string& fileName,
+    const std::optional<base::Vector>& playerPositionOverride);
 
   void handleEvent(const SDL_Event& event);
   void updateAndRender(engine::TimeDelta dt);
 
   bool levelFinished() const;
   bool gameQuit() const;
+  bool isShowingDebugUi() const;
   std::set<data::Bonus> achievedBonuses() const;
 
 private:
   using ExecutionResult = ui::DukeScriptRunner::ExecutionResult;
 
   struct World {
-    explicit World(game_logic::GameWorld* pWorld)
+    World(
+      game_logic::GameWorld* pWorld,
+      IGameServiceProvider* pServiceProvider,
+      const int gameSpeedMultiplier
+    )
       : mpWorld(pWorld)
+      , mpServiceProvider(pServiceProvider)
+      , mGameSpeedMultiplier(gameSpeedMultiplier)
     {
     }
 
@@ -68,12 +99,18 @@ private:
 
     void updateWorld(engine::TimeDelta dt);
     void handlePlayerInput(const SDL_Event& event);
+    void handleQuickSaveKeys(const SDL_Event& event);
     void handleDebugKeys(const SDL_Event& event);
+    void cycleGameSpeed();
 
     game_logic::GameWorld* mpWorld;
+    IGameServiceProvider* mpServiceProvider;
+    game_logic::Replay* mpReplayRecording = nullptr;
     game_logic::PlayerInput mPlayerInput;
     engine::TimeDelta mAccumulatedTime = 0.0;
+    int mGameSpeedMultiplier;
     bool mShowDebugText = false;
+    bool mShowLogicProfiler = false;
     bool mSingleStepping = false;
     bool mDoNextSingleStep = false;
   };
@@ -129,6 +166,8 @@ private:
   GameMode::Context mContext;
   data::SavedGame mSavedGame;
   game_logic::GameWorld mWorld;
+  std::optional<game_logic::Replay> mReplayRecording;
+  std::string mReplayFileName;
   std::stack<State, std::vector<State>> mStateStack;
   bool mGameWasQuit = false;
 };
@@ -144,6 +183,15 @@ inline bool GameRunner::gameQuit() const {
 }
 
 
+inline bool GameRunner::isShowingDebugUi() const {
+  if (const auto pWorld = std::get_if<World>(&mStateStack.top())) {
+    return pWorld->mShowDebugText || pWorld->mShowLogicProfiler;
+  }
+
+  return false;
+}
+
+
 inline std::set<data::Bonus> GameRunner::achievedBonuses() const {
   return mWorld.achievedBonuses();
 }
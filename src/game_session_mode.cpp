@@ -20,15 +20,19 @@
 #include "common/game_service_provider.hpp"
 #include "common/user_profile.hpp"
 #include "data/saved_game.hpp"
+#include "loader/level_loader.hpp"
 #include "ui/high_score_list.hpp"
 
+#include <iostream>
+
 
 namespace rigel {
 
 GameSessionMode::GameSessionMode(
   const data::GameSessionId& sessionId,
   Context context,
-  std::optional<base::Vector> playerPositionOverride
+  std::optional<base::Vector> playerPositionOverride,
+  std::optional<std::string> replayRecordingFile
 )
   : mCurrentStage(std::make_unique<GameRunner>(
       &mPlayerModel,
@@ -41,6 +45,10 @@ GameSessionMode::GameSessionMode(
   , mDifficulty(sessionId.mDifficulty)
   , mContext(context)
 {
+  if (replayRecordingFile) {
+    std::get<std::unique_ptr<GameRunner>>(mCurrentStage)
+      ->startReplayRecording(*replayRecordingFile, playerPositionOverride);
+  }
 }
 
 
@@ -124,6 +132,7 @@ void GameSessionMode::updateAndRender(engine::TimeDelta dt) {
           mContext.mpServiceProvider->fadeOutScreen();
           mCurrentStage = std::move(endScreens);
         } else {
+          startPreloadingNextLevel();
           fadeToNewStage(bonusScreen);
           mCurrentStage = std::move(bonusScreen);
         }
@@ -139,7 +148,10 @@ void GameSessionMode::updateAndRender(engine::TimeDelta dt) {
         auto pNextIngameMode = std::make_unique<GameRunner>(
           &mPlayerModel,
           data::GameSessionId{mEpisode, ++mCurrentLevelNr, mDifficulty},
-          mContext);
+          mContext,
+          std::nullopt,
+          false,
+          takePreloadedLevel());
         fadeToNewStage(*pNextIngameMode);
         mCurrentStage = std::move(pNextIngameMode);
       }
@@ -167,6 +179,28 @@ void GameSessionMode::updateAndRender(engine::TimeDelta dt) {
 }
 
 
+std::optional<engine::TimeDelta>
+  GameSessionMode::timeUntilNextUpdate() const
+{
+  if (std::holds_alternative<HighScoreListDisplay>(mCurrentStage)) {
+    return mContext.mpScriptRunner->timeUntilNextUpdate();
+  }
+
+  return std::nullopt;
+}
+
+
+bool GameSessionMode::isShowingDebugUi() const {
+  if (const auto ppRunner =
+    std::get_if<std::unique_ptr<GameRunner>>(&mCurrentStage)
+  ) {
+    return (*ppRunner)->isShowingDebugUi();
+  }
+
+  return false;
+}
+
+
 template<typename StageT>
 void GameSessionMode::fadeToNewStage(StageT& stage) {
   mContext.mpServiceProvider->fadeOutScreen();
@@ -175,6 +209,36 @@ void GameSessionMode::fadeToNewStage(StageT& stage) {
 }
 
 
+void GameSessionMode::startPreloadingNextLevel() {
+  // The level loader only reads from the resource loader, which is safe to
+  // do from multiple threads at once.
+  mNextLevelPreload = std::async(
+    std::launch::async,
+    [pResources = mContext.mpResources,
+     mapName = loader::levelFileName(mEpisode, mCurrentLevelNr + 1),
+     difficulty = mDifficulty]() {
+      return loader::loadLevel(mapName, *pResources, difficulty);
+    });
+}
+
+
+std::optional<data::map::LevelData> GameSessionMode::takePreloadedLevel() {
+  if (!mNextLevelPreload.valid()) {
+    return std::nullopt;
+  }
+
+  try {
+    return mNextLevelPreload.get();
+  } catch (const std::exception& error) {
+    // GameWorld will try loading the level again, and report the error
+    // if it happens again.
+    std::cerr << "WARNING: Preloading next level failed: " << error.what()
+      << '\n';
+    return std::nullopt;
+  }
+}
+
+
 void GameSessionMode::finishGameSession() {
   mContext.mpServiceProvider->stopMusic();
 
@@ -17,12 +17,16 @@
 #pragma once
 
 #include "common/game_mode.hpp"
+#include "data/map.hpp"
 #include "data/player_model.hpp"
 #include "ui/bonus_screen.hpp"
 #include "ui/episode_end_sequence.hpp"
 
 #include "game_runner.hpp"
 
+#include <future>
+#include <optional>
+#include <string>
 #include <variant>
 
 namespace rigel::data { struct SavedGame; }
@@ -32,19 +36,29 @@ namespace rigel {
 
 class GameSessionMode : public GameMode {
 public:
+  /** Start a new session at the given level
+   *
+   * If replayRecordingFile is given, a replay of the first level is
+   * recorded and written to that file.
+   */
   GameSessionMode(
     const data::GameSessionId& sessionId,
     Context context,
-    std::optional<base::Vector> playerPositionOverride = std::nullopt);
+    std::optional<base::Vector> playerPositionOverride = std::nullopt,
+    std::optional<std::string> replayRecordingFile = std::nullopt);
 
   GameSessionMode(const data::SavedGame& save, Context context);
 
   void handleEvent(const SDL_Event& event) override;
   void updateAndRender(engine::TimeDelta dt) override;
+  std::optional<engine::TimeDelta> timeUntilNextUpdate() const override;
+  bool isShowingDebugUi() const override;
 
 private:
   template<typename StageT>
   void fadeToNewStage(StageT& stage);
+  void startPreloadingNextLevel();
+  std::optional<data::map::LevelData> takePreloadedLevel();
   void finishGameSession();
   void enterHighScore(std::string_view name);
 
@@ -69,6 +83,10 @@ private:
   int mCurrentLevelNr;
   const data::Difficulty mDifficulty;
   Context mContext;
+
+  // Loads the next level while the bonus screen is shown. Declared last so
+  // that it's joined before anything else is destroyed.
+  std::future<data::map::LevelData> mNextLevelPreload;
 };
 
 }
@@ -42,6 +42,15 @@ void forwardEventToStage(
   stage.mpScriptRunner->handleEvent(event);
 }
 
+
+data::script::Script scriptOrEmpty(
+  const loader::ScriptBundle& scripts,
+  const std::string& name
+) {
+  const auto iScript = scripts.find(name);
+  return iScript != scripts.end() ? iScript->second : data::script::Script{};
+}
+
 }
 
 
@@ -52,18 +61,19 @@ IntroDemoLoopMode::IntroDemoLoopMode(
   : mpServiceProvider(context.mpServiceProvider)
   , mFirstRunIncludedStoryAnimation(isDuringGameStartup)
   , mpScriptRunner(context.mpScriptRunner)
-  , mScripts(context.mpResources->loadScriptBundle("TEXT.MNI"))
   , mCurrentStage(isDuringGameStartup ? 0 : 1)
 {
   mStages.emplace_back(ui::ApogeeLogo(context));
   mStages.emplace_back(ui::IntroMovie(context));
+
+  // Scripts are parsed once at startup and shared by all modes
   if (isDuringGameStartup) {
     mStages.emplace_back(ScriptExecutionStage{
       mpScriptRunner,
-      mScripts["&Story"]});
+      scriptOrEmpty(*context.mpScripts, "&Story")});
   }
 
-  auto creditsScript = mScripts["&Credits"];
+  auto creditsScript = scriptOrEmpty(*context.mpScripts, "&Credits");
   creditsScript.emplace_back(data::script::Delay{700});
   mStages.emplace_back(ScriptExecutionStage{
     mpScriptRunner,
@@ -78,7 +88,7 @@ IntroDemoLoopMode::IntroDemoLoopMode(
   // order info script commands if we're running the shareware version.
   auto orderInfoScript = data::script::Script{};
   if (context.mpServiceProvider->isShareWareVersion()) {
-    orderInfoScript = mScripts["Q_ORDER"];
+    orderInfoScript = scriptOrEmpty(*context.mpScripts, "Q_ORDER");
   }
   orderInfoScript.emplace_back(data::script::Delay{700});
   mStages.emplace_back(ScriptExecutionStage{
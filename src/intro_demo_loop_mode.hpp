@@ -52,7 +52,6 @@ private:
   bool mFirstRunIncludedStoryAnimation;
 
   ui::DukeScriptRunner* mpScriptRunner;
-  loader::ScriptBundle mScripts;
 
   std::vector<ModeStage> mStages;
   std::size_t mCurrentStage;
@@ -16,7 +16,7 @@
 
 #include "actor_image_package.hpp"
 
-#include "base/container_utils.hpp"
+#include "base/key_hasher.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
 #include "loader/cmp_file_package.hpp"
@@ -24,7 +24,15 @@
 #include "loader/file_utils.hpp"
 #include "loader/png_image.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string_view>
+#include <thread>
 #include <utility>
 
 
@@ -38,13 +46,132 @@ using data::GameTraits;
 namespace {
 
 
-std::string replacementImagePath(
-  const std::string& basePath,
-  const int id,
-  const int frame
+std::string toLower(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](const char ch) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+  });
+  return str;
+}
+
+
+bool consumePrefix(std::string_view& str, const std::string_view prefix) {
+  if (str.substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+
+  str.remove_prefix(prefix.size());
+  return true;
+}
+
+
+std::optional<int> consumeNumber(std::string_view& str) {
+  // More than 9 digits could overflow, we reject those names by leaving the
+  // remaining digits in place
+  constexpr auto MAX_DIGITS = std::size_t{9};
+
+  auto value = 0;
+  auto numDigits = std::size_t{0};
+  while (
+    numDigits < str.size() &&
+    numDigits < MAX_DIGITS &&
+    std::isdigit(static_cast<unsigned char>(str[numDigits]))
+  ) {
+    value = value * 10 + (str[numDigits] - '0');
+    ++numDigits;
+  }
+
+  if (numDigits == 0) {
+    return std::nullopt;
+  }
+
+  str.remove_prefix(numDigits);
+  return value;
+}
+
+
+/** Parse a (lower-case) file name of the form actor<ID>_frame<N>.png */
+std::optional<std::pair<int, int>> parseReplacementImageName(
+  std::string_view name
+) {
+  if (!consumePrefix(name, "actor")) {
+    return std::nullopt;
+  }
+
+  const auto maybeId = consumeNumber(name);
+  if (!maybeId || !consumePrefix(name, "_frame")) {
+    return std::nullopt;
+  }
+
+  const auto maybeFrame = consumeNumber(name);
+  if (!maybeFrame || name != ".png") {
+    return std::nullopt;
+  }
+
+  return std::pair{*maybeId, *maybeFrame};
+}
+
+
+std::map<std::pair<int, int>, std::string> scanReplacementImages(
+  const std::string& path
+) {
+  namespace fs = std::filesystem;
+
+  std::map<std::pair<int, int>, std::string> result;
+
+  std::error_code error;
+  if (!fs::is_directory(path, error)) {
+    return result;
+  }
+
+  for (
+    auto iEntry = fs::directory_iterator(path, error);
+    !error && iEntry != fs::directory_iterator();
+    iEntry.increment(error)
+  ) {
+    if (!iEntry->is_regular_file(error)) {
+      continue;
+    }
+
+    const auto maybeKey = parseReplacementImageName(
+      toLower(iEntry->path().filename().u8string()));
+    if (maybeKey) {
+      result.emplace(*maybeKey, iEntry->path().u8string());
+    }
+  }
+
+  if (error) {
+    std::cerr << "WARNING: Failed to scan asset replacements directory: "
+      << error.message() << '\n';
+  }
+
+  return result;
+}
+
+
+/** Hash the set of replacement images along with their modification times
+ *
+ * Cached actor frames include replacement images, so the cache needs to be
+ * invalidated when any of them change.
+ */
+std::uint64_t hashReplacementImages(
+  const std::map<std::pair<int, int>, std::string>& replacements
 ) {
-  return basePath + "/actor" + std::to_string(id) + "_frame" +
-    std::to_string(frame) + ".png";
+  namespace fs = std::filesystem;
+
+  base::KeyHasher hasher;
+  for (const auto& [key, path] : replacements) {
+    std::error_code error;
+    const auto size = fs::file_size(fs::u8path(path), error);
+    const auto modificationTime = fs::last_write_time(fs::u8path(path), error);
+
+    hasher.add(static_cast<std::uint32_t>(key.first));
+    hasher.add(static_cast<std::uint32_t>(key.second));
+    hasher.add(static_cast<std::uint64_t>(size));
+    hasher.add(static_cast<std::uint64_t>(
+      modificationTime.time_since_epoch().count()));
+  }
+
+  return hasher.value();
 }
 
 }
@@ -52,15 +179,27 @@ std::string replacementImagePath(
 
 ActorImagePackage::ActorImagePackage(
   const CMPFilePackage& filePackage,
-  std::optional<std::string> maybeImageReplacementsPath
+  std::optional<std::string> maybeImageReplacementsPath,
+  std::optional<std::string> maybeCacheDirectory
 )
-  : mImageData(filePackage.file("ACTORS.MNI"))
-  , mMaybeReplacementsPath(std::move(maybeImageReplacementsPath))
+  : mImageData(filePackage.fileView("ACTORS.MNI"))
 {
-  const auto actorInfoData = filePackage.file("ACTRINFO.MNI");
+  if (maybeImageReplacementsPath) {
+    mReplacementImagePaths = scanReplacementImages(*maybeImageReplacementsPath);
+  }
+
+  if (maybeCacheDirectory) {
+    base::KeyHasher hasher;
+    hasher.add(filePackage.contentHash());
+    hasher.add(hashReplacementImages(mReplacementImagePaths));
+    mMaybeImageCache.emplace(std::move(*maybeCacheDirectory), hasher.value());
+  }
+
+  const auto actorInfoData = filePackage.fileView("ACTRINFO.MNI");
 
   LeStreamReader actorInfoReader(actorInfoData);
   const auto numEntries = actorInfoReader.peekU16();
+  mHeadersById.resize(numEntries);
 
   for (uint16_t index=0; index<numEntries; ++index) {
     const auto offset = actorInfoReader.readU16();
@@ -86,32 +225,74 @@ ActorImagePackage::ActorImagePackage(
         ActorFrameHeader{drawOffset, size, imageDataOffset});
     }
 
-    if (!frameHeaders.empty()) {
-      mHeadersById.emplace(
-        ActorID(index),
-        ActorHeader{drawIndex, move(frameHeaders)});
-    }
+    mHeadersById[index] = ActorHeader{drawIndex, move(frameHeaders)};
   }
 }
 
 
-ActorData ActorImagePackage::loadActor(
+const ActorData& ActorImagePackage::loadActor(
   const ActorID id,
   const Palette16& palette
 ) const {
   // Font has to be loaded using loadFont()
   assert(id != data::ActorID::Menu_font_grayscale);
 
-  const auto it = mHeadersById.find(id);
-  if (it == mHeadersById.end()) {
-    throw invalid_argument("loadActor(): No actor at this ID " + std::to_string(static_cast<int>(id)));
+  const auto& actorHeader = header(id);
+  auto& actor = cachedActor(id, actorHeader, palette);
+
+  {
+    std::lock_guard lock(mCacheMutex);
+    if (actor.mNumDecodedFrames == actor.mData.mFrames.size()) {
+      return actor.mData;
+    }
+  }
+
+  // Decoding happens without holding the lock, so that multiple threads can
+  // decode different actors in parallel. If another thread finishes decoding
+  // the same actor first, we keep its result and drop ours.
+  auto images = decodeFrames(id, actorHeader, palette);
+
+  std::lock_guard lock(mCacheMutex);
+  for (std::size_t i = 0; i < images.size(); ++i) {
+    if (!actor.mIsFrameDecoded[i]) {
+      actor.mData.mFrames[i].mFrameImage = std::move(images[i]);
+      actor.mIsFrameDecoded[i] = true;
+      ++actor.mNumDecodedFrames;
+    }
   }
 
-  const auto& header = it->second;
-  return ActorData{
-    header.mDrawIndex,
-    loadFrameImages(id, header, palette)
-  };
+  return actor.mData;
+}
+
+
+const ActorData::Frame& ActorImagePackage::loadActorFrame(
+  const ActorID id,
+  const int frame,
+  const Palette16& palette
+) const {
+  assert(id != data::ActorID::Menu_font_grayscale);
+
+  const auto& actorHeader = header(id);
+  const auto& frameHeader = actorHeader.mFrames.at(frame);
+  auto& actor = cachedActor(id, actorHeader, palette);
+
+  {
+    std::lock_guard lock(mCacheMutex);
+    if (actor.mIsFrameDecoded[frame]) {
+      return actor.mData.mFrames[frame];
+    }
+  }
+
+  auto image = decodeFrame(id, frame, frameHeader, palette);
+
+  std::lock_guard lock(mCacheMutex);
+  if (!actor.mIsFrameDecoded[frame]) {
+    actor.mData.mFrames[frame].mFrameImage = std::move(image);
+    actor.mIsFrameDecoded[frame] = true;
+    ++actor.mNumDecodedFrames;
+  }
+
+  return actor.mData.mFrames[frame];
 }
 
 
@@ -119,33 +300,161 @@ base::Rect<int> ActorImagePackage::actorFrameRect(
   const data::ActorID id,
   const int frame
 ) const {
-  const auto it = mHeadersById.find(id);
-  if (it == mHeadersById.end()) {
-    throw invalid_argument("actorFrameRect(): No actor at this ID " + std::to_string(static_cast<int>(id)));
+  const auto& frameHeader = header(id).mFrames.at(frame);
+  return {frameHeader.mDrawOffset, frameHeader.mSizeInTiles};
+}
+
+
+bool ActorImagePackage::hasActor(const data::ActorID id) const {
+  const auto index = static_cast<std::size_t>(id);
+  return index < mHeadersById.size() && !mHeadersById[index].mFrames.empty();
+}
+
+
+auto ActorImagePackage::header(const data::ActorID id) const
+  -> const ActorHeader&
+{
+  if (!hasActor(id)) {
+    throw invalid_argument(
+      "No actor at this ID " + std::to_string(static_cast<int>(id)));
   }
 
-  const auto& frameHeader = it->second.mFrames.at(frame);
-  return {frameHeader.mDrawOffset, frameHeader.mSizeInTiles};
+  return mHeadersById[static_cast<std::size_t>(id)];
 }
 
 
-std::vector<ActorData::Frame> ActorImagePackage::loadFrameImages(
+auto ActorImagePackage::cachedActor(
   const data::ActorID id,
   const ActorHeader& header,
   const Palette16& palette
+) const -> CachedActor& {
+  const auto key = CacheKey{id, hashPalette(palette)};
+
+  std::lock_guard lock(mCacheMutex);
+  auto& pActor = mCachedActors[key];
+  if (!pActor) {
+    // Frames are filled in as they get decoded. Their draw offsets are known
+    // up front, so they can be set right away.
+    pActor = std::make_unique<CachedActor>();
+    pActor->mData.mDrawIndex = header.mDrawIndex;
+    for (const auto& frameHeader : header.mFrames) {
+      pActor->mData.mFrames.push_back(
+        ActorData::Frame{frameHeader.mDrawOffset, data::Image{0, 0}});
+    }
+    pActor->mIsFrameDecoded.resize(header.mFrames.size(), false);
+  }
+
+  return *pActor;
+}
+
+
+std::vector<data::Image> ActorImagePackage::decodeFrames(
+  const data::ActorID id,
+  const ActorHeader& header,
+  const Palette16& palette
+) const {
+  auto decodeImages = [&, this]() {
+    auto replacements = loadReplacementImages(id, header.mFrames.size());
+
+    std::vector<data::Image> images;
+    images.reserve(header.mFrames.size());
+    for (std::size_t frame = 0; frame < header.mFrames.size(); ++frame) {
+      if (replacements[frame]) {
+        images.push_back(std::move(*replacements[frame]));
+      } else {
+        images.push_back(loadImage(header.mFrames[frame], palette));
+      }
+    }
+
+    return images;
+  };
+
+  auto images = mMaybeImageCache
+    ? mMaybeImageCache->fetch(
+        makeImageCacheKey(
+          "actor" + std::to_string(static_cast<int>(id)), palette),
+        decodeImages)
+    : decodeImages();
+  if (images.size() != header.mFrames.size()) {
+    images = decodeImages();
+  }
+
+  return images;
+}
+
+
+data::Image ActorImagePackage::decodeFrame(
+  const data::ActorID id,
+  const int frame,
+  const ActorFrameHeader& frameHeader,
+  const Palette16& palette
+) const {
+  if (const auto pPath = replacementImagePath(id, frame)) {
+    if (auto maybeReplacement = loadPng(*pPath)) {
+      return std::move(*maybeReplacement);
+    }
+  }
+
+  return loadImage(frameHeader, palette);
+}
+
+
+const std::string* ActorImagePackage::replacementImagePath(
+  const data::ActorID id,
+  const int frame
 ) const {
-  return utils::transformed(
-    header.mFrames,
-    [&, this, frame = 0](const auto& frameHeader) mutable {
-      auto maybeReplacement = mMaybeReplacementsPath
-        ? loadPng(replacementImagePath(*mMaybeReplacementsPath, static_cast<int>(id), frame))
-        : std::nullopt;
-      ++frame;
+  const auto iPath =
+    mReplacementImagePaths.find({static_cast<int>(id), frame});
+  return iPath != mReplacementImagePaths.end() ? &iPath->second : nullptr;
+}
+
+
+auto ActorImagePackage::loadReplacementImages(
+  const data::ActorID id,
+  const std::size_t numFrames
+) const -> std::vector<std::optional<data::Image>> {
+  std::vector<const std::string*> paths;
+  std::vector<std::size_t> framesToLoad;
+  for (std::size_t frame = 0; frame < numFrames; ++frame) {
+    if (const auto pPath = replacementImagePath(id, int(frame))) {
+      paths.push_back(pPath);
+      framesToLoad.push_back(frame);
+    }
+  }
+
+  std::vector<std::optional<data::Image>> images(numFrames);
+  if (framesToLoad.empty()) {
+    return images;
+  }
+
+  // PNG decoding is much slower than decoding the original images, so it's
+  // worth spreading it across multiple threads
+  std::atomic<std::size_t> nextIndex{0};
+  auto loadImages = [&]() {
+    for (
+      auto index = nextIndex++;
+      index < framesToLoad.size();
+      index = nextIndex++
+    ) {
+      images[framesToLoad[index]] = loadPng(*paths[index]);
+    }
+  };
+
+  const auto numWorkers = std::clamp<std::size_t>(
+    std::thread::hardware_concurrency(), 1, framesToLoad.size());
+
+  std::vector<std::future<void>> workers;
+  for (std::size_t i = 1; i < numWorkers; ++i) {
+    workers.push_back(std::async(std::launch::async, loadImages));
+  }
+
+  loadImages();
+
+  for (auto& worker : workers) {
+    worker.get();
+  }
 
-      return ActorData::Frame{
-        frameHeader.mDrawOffset,
-        maybeReplacement ? *maybeReplacement : loadImage(frameHeader, palette)};
-    });
+  return images;
 }
 
 
@@ -164,7 +473,7 @@ data::Image ActorImagePackage::loadImage(
     throw invalid_argument("Not enough data");
   }
 
-  const auto dataStart = mImageData.cbegin() + frameHeader.mFileOffset;
+  const auto dataStart = mImageData.begin() + frameHeader.mFileOffset;
   return loadTiledImage(
     dataStart,
     dataStart + dataSize,
@@ -175,12 +484,16 @@ data::Image ActorImagePackage::loadImage(
 
 
 FontData ActorImagePackage::loadFont() const {
-  const auto it = mHeadersById.find(data::ActorID::Menu_font_grayscale);
-  if (it == mHeadersById.end() || it->second.mFrames.empty()) {
+  const auto fontIndex =
+    static_cast<std::size_t>(data::ActorID::Menu_font_grayscale);
+  if (
+    fontIndex >= mHeadersById.size() ||
+    mHeadersById[fontIndex].mFrames.empty()
+  ) {
     throw runtime_error("Font data missing");
   }
 
-  const auto& header = it->second;
+  const auto& header = mHeadersById[fontIndex];
   const auto sizeInTiles = header.mFrames.front().mSizeInTiles;
 
   FontData fontBitmaps;
@@ -195,7 +508,7 @@ FontData ActorImagePackage::loadFont() const {
       throw runtime_error("Not enough data");
     }
 
-    const auto dataStart = mImageData.cbegin() + frameHeader.mFileOffset;
+    const auto dataStart = mImageData.begin() + frameHeader.mFileOffset;
     auto characterBitmap = loadTiledFontBitmap(
       dataStart,
       dataStart + dataSize,
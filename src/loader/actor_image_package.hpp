@@ -20,11 +20,16 @@
 #include "data/actor_ids.hpp"
 #include "data/image.hpp"
 #include "loader/byte_buffer.hpp"
+#include "loader/image_cache.hpp"
 #include "loader/palette.hpp"
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -47,18 +52,64 @@ struct ActorData {
 using FontData = std::vector<data::Image>;
 
 
+/** Provides access to the actor and font images in ACTORS.MNI
+ *
+ * The image data is not copied, the package keeps referring to the data
+ * owned by the given CMPFilePackage. The latter must thus outlive the
+ * ActorImagePackage.
+ *
+ * If a replacements path is given, the directory is scanned once on
+ * construction, and all files named actor<ID>_frame<N>.png (ignoring case)
+ * are recorded in an index. Files are only opened for frames found in that
+ * index. When decoding all frames of an actor, its replacement images are
+ * loaded in parallel.
+ *
+ * Decoded actors are kept in memory for the lifetime of the package, one
+ * copy per palette they were requested with. If a cache directory is given,
+ * decoded actor frames are also stored there, for use by later runs of the
+ * game.
+ *
+ * All const member functions can be used from multiple threads
+ * concurrently.
+ */
 class ActorImagePackage {
 public:
   explicit ActorImagePackage(
     const CMPFilePackage& filePackage,
-    std::optional<std::string> maybeImageReplacementsPath = std::nullopt);
+    std::optional<std::string> maybeImageReplacementsPath = std::nullopt,
+    std::optional<std::string> maybeCacheDirectory = std::nullopt);
+
+  /** Decode all frames of the given actor
+   *
+   * The returned reference stays valid for the lifetime of the package.
+   */
+  const ActorData& loadActor(
+    data::ActorID id,
+    const Palette16& palette = INGAME_PALETTE) const;
 
-  ActorData loadActor(
+  /** Decode a single frame of the given actor
+   *
+   * Only the requested frame is decoded, unless it has been decoded before.
+   * The returned reference stays valid for the lifetime of the package.
+   */
+  const ActorData::Frame& loadActorFrame(
     data::ActorID id,
+    int frame,
     const Palette16& palette = INGAME_PALETTE) const;
 
   base::Rect<int> actorFrameRect(data::ActorID id, int frame) const;
 
+  bool hasActor(data::ActorID id) const;
+
+  /** Number of actor IDs in the package
+   *
+   * All valid IDs are below this value, but not every ID below it refers to
+   * an actor, see hasActor().
+   */
+  std::size_t numActorIds() const {
+    return mHeadersById.size();
+  }
+
   FontData loadFont() const;
 
 private:
@@ -73,20 +124,52 @@ private:
     std::vector<ActorFrameHeader> mFrames;
   };
 
-  std::vector<ActorData::Frame> loadFrameImages(
+  struct CachedActor {
+    ActorData mData;
+    std::vector<bool> mIsFrameDecoded;
+    std::size_t mNumDecodedFrames = 0;
+  };
+
+  const ActorHeader& header(data::ActorID id) const;
+  CachedActor& cachedActor(
     data::ActorID id,
     const ActorHeader& header,
     const Palette16& palette) const;
 
+  std::vector<data::Image> decodeFrames(
+    data::ActorID id,
+    const ActorHeader& header,
+    const Palette16& palette) const;
+  data::Image decodeFrame(
+    data::ActorID id,
+    int frame,
+    const ActorFrameHeader& frameHeader,
+    const Palette16& palette) const;
+  const std::string* replacementImagePath(data::ActorID id, int frame) const;
+  std::vector<std::optional<data::Image>> loadReplacementImages(
+    data::ActorID id,
+    std::size_t numFrames) const;
+
   data::Image loadImage(
     const ActorFrameHeader& frameHeader,
     const Palette16& palette
   ) const;
 
 private:
-  const ByteBuffer mImageData;
-  std::map<data::ActorID, ActorHeader> mHeadersById;
-  std::optional<std::string> mMaybeReplacementsPath;
+  const ByteBufferView mImageData;
+
+  /** Indexed by actor ID, unused IDs have no frames */
+  std::vector<ActorHeader> mHeadersById;
+  using ReplacementImageKey = std::pair<int, int>;
+
+  /** Maps (actor ID, frame) to replacement image paths */
+  std::map<ReplacementImageKey, std::string> mReplacementImagePaths;
+  std::optional<ImageCache> mMaybeImageCache;
+
+  using CacheKey = std::pair<data::ActorID, std::uint64_t>;
+
+  mutable std::mutex mCacheMutex;
+  mutable std::map<CacheKey, std::unique_ptr<CachedActor>> mCachedActors;
 };
 
 
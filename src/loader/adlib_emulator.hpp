@@ -27,8 +27,22 @@ namespace rigel::loader {
 
 class AdlibEmulator {
 public:
-  explicit AdlibEmulator(int sampleRate)
-    : mEmulator(sampleRate)
+  /** Trade-off between emulation cost and output quality
+   *
+   * In LowCpu mode, the emulator runs at half the output sample rate, and the
+   * samples in between are interpolated linearly. That roughly halves the
+   * cost of emulation, at the expense of high frequencies being attenuated
+   * and slightly aliased. Sample rates below 22050 Hz always use Accurate
+   * mode, since the internal rate would get too low otherwise.
+   */
+  enum class Mode {
+    Accurate,
+    LowCpu
+  };
+
+  explicit AdlibEmulator(int sampleRate, Mode mode = Mode::Accurate)
+    : mUpsample(mode == Mode::LowCpu && sampleRate >= 2 * MIN_INTERNAL_RATE)
+    , mEmulator(mUpsample ? sampleRate / 2 : sampleRate)
   {
     // This is normally done by the game to select the right type of wave forms.
     // It's not part of the IMF files.
@@ -39,10 +53,9 @@ public:
     mEmulator.WriteReg(reg, value);
   }
 
-  template<typename OutputIt>
   void render(
     std::size_t numSamples,
-    OutputIt destination,
+    std::int16_t* pDestination,
     const int volumeScale = 1
   ) {
     // DBOPL outputs 32 bit samples, but they never exceed the 16 bit range
@@ -50,27 +63,102 @@ public:
     // in the DosBox source). Still, this means we cannot render directly into
     // the output buffer.
 
+    if (mUpsample) {
+      renderUpsampled(numSamples, pDestination, volumeScale);
+      return;
+    }
+
     while (numSamples > 0) {
       const auto samplesForIteration = std::min(mTempBuffer.size(), numSamples);
 
       mEmulator.GenerateBlock2(
         static_cast<DBOPL::Bitu>(samplesForIteration), mTempBuffer.data());
-      destination = std::transform(
-        mTempBuffer.cbegin(),
-        mTempBuffer.cbegin() + samplesForIteration,
-        destination,
-        [volumeScale](const auto sample32Bit) {
-          return static_cast<std::int16_t>(
-            std::clamp(sample32Bit * volumeScale, -16384, 16384));
-        });
+      convertSamples(
+        mTempBuffer.data(), pDestination, samplesForIteration, volumeScale);
 
+      pDestination += samplesForIteration;
       numSamples -= samplesForIteration;
     }
   }
 
 private:
+  static constexpr auto MIN_INTERNAL_RATE = 11025;
+
+  void renderUpsampled(
+    std::size_t numSamples,
+    std::int16_t* pDestination,
+    const int volumeScale
+  ) {
+    // Each emulated sample yields two output samples, the first of which is
+    // interpolated from the previous emulated one. With an odd number of
+    // output samples requested, the second one is left over for the next
+    // call.
+    if (mHasLeftoverSample && numSamples > 0) {
+      convertSamples(&mLeftoverSample, pDestination, 1, volumeScale);
+      mHasLeftoverSample = false;
+      ++pDestination;
+      --numSamples;
+    }
+
+    while (numSamples > 0) {
+      const auto samplesToEmulate =
+        std::min(mTempBuffer.size(), (numSamples + 1) / 2);
+
+      mEmulator.GenerateBlock2(
+        static_cast<DBOPL::Bitu>(samplesToEmulate), mTempBuffer.data());
+
+      for (std::size_t i = 0; i < samplesToEmulate; ++i) {
+        const auto sample = mTempBuffer[i];
+        mUpsampleBuffer[2 * i] = (mPreviousSample + sample) / 2;
+        mUpsampleBuffer[2 * i + 1] = sample;
+        mPreviousSample = sample;
+      }
+
+      const auto samplesProduced = samplesToEmulate * 2;
+      const auto samplesForIteration = std::min(samplesProduced, numSamples);
+      convertSamples(
+        mUpsampleBuffer.data(),
+        pDestination,
+        samplesForIteration,
+        volumeScale);
+
+      if (samplesForIteration < samplesProduced) {
+        mLeftoverSample = mUpsampleBuffer[samplesProduced - 1];
+        mHasLeftoverSample = true;
+      }
+
+      pDestination += samplesForIteration;
+      numSamples -= samplesForIteration;
+    }
+  }
+
+  /** Scale, clamp and narrow 32 bit samples to 16 bit
+   *
+   * Kept as a plain loop over two arrays of different types, so that the
+   * compiler knows they can't alias and turns it into packed multiply,
+   * min/max and pack instructions.
+   */
+  static void convertSamples(
+    const std::int32_t* pSource,
+    std::int16_t* pDestination,
+    const std::size_t count,
+    const int volumeScale
+  ) {
+    for (std::size_t i = 0; i < count; ++i) {
+      pDestination[i] = static_cast<std::int16_t>(
+        std::clamp(pSource[i] * volumeScale, -16384, 16384));
+    }
+  }
+
+  bool mUpsample;
   DBOPL::Chip mEmulator;
-  std::array<std::int32_t, 256> mTempBuffer;
+  std::array<std::int32_t, 1024> mTempBuffer;
+
+  // LowCpu mode only
+  std::array<std::int32_t, 2048> mUpsampleBuffer;
+  std::int32_t mPreviousSample = 0;
+  std::int32_t mLeftoverSample = 0;
+  bool mHasLeftoverSample = false;
 };
 
 }
@@ -45,7 +45,7 @@ struct AudioDictEntry {
 };
 
 
-std::vector<AudioDictEntry> readAudioDict(const ByteBuffer& data) {
+std::vector<AudioDictEntry> readAudioDict(const ByteBufferView data) {
   const auto numOffsets = data.size() / sizeof(uint32_t);
 
   vector<AudioDictEntry> dict;
@@ -89,16 +89,16 @@ AudioPackage::AdlibSound::AdlibSound(LeStreamReader& reader) {
 
 
 AudioPackage::AudioPackage(const CMPFilePackage& filePackage) {
-  const auto audioDict = readAudioDict(filePackage.file("AUDIOHED.MNI"));
+  const auto audioDict = readAudioDict(filePackage.fileView("AUDIOHED.MNI"));
   if (audioDict.size() < 68u) {
     throw std::invalid_argument("Corrupt Duke Nukem II AUDIOT/AUDIOHED");
   }
 
-  const auto bundledAudioData = filePackage.file("AUDIOT.MNI");
+  const auto bundledAudioData = filePackage.fileView("AUDIOT.MNI");
   for (auto i=34u; i<68u; ++i) {
     const auto& dictEntry = audioDict[i];
 
-    const auto soundStartIter = bundledAudioData.cbegin() + dictEntry.mOffset;
+    const auto soundStartIter = bundledAudioData.begin() + dictEntry.mOffset;
     LeStreamReader reader(soundStartIter, soundStartIter + dictEntry.mSize);
     mSounds.emplace_back(reader);
   }
@@ -141,9 +141,10 @@ data::AudioBuffer AudioPackage::renderAdlibSound(
   const auto octaveBits = static_cast<uint8_t>((sound.mOctave & 7) << 2);
 
   const auto samplesPerTick = sampleRate / ADLIB_SOUND_RATE;
-  vector<data::Sample> renderedSamples;
-  renderedSamples.reserve(sound.mSoundData.size() * samplesPerTick);
+  vector<data::Sample> renderedSamples(
+    sound.mSoundData.size() * samplesPerTick);
 
+  auto pDestination = renderedSamples.data();
   for (const auto byte : sound.mSoundData) {
     if (byte == 0) {
       emulator.writeRegister(0xB0, 0);
@@ -152,7 +153,8 @@ data::AudioBuffer AudioPackage::renderAdlibSound(
       emulator.writeRegister(0xB0, 0x20 | octaveBits);
     }
 
-    emulator.render(samplesPerTick, back_inserter(renderedSamples), 2);
+    emulator.render(samplesPerTick, pDestination, 2);
+    pDestination += samplesPerTick;
   }
 
   return {sampleRate, renderedSamples};
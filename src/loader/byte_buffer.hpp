@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -27,4 +28,35 @@ using ByteBuferIter = ByteBuffer::iterator;
 using ByteBufferCIter = ByteBuffer::const_iterator;
 
 
+/** Non-owning view of a range of bytes within a ByteBuffer */
+struct ByteBufferView {
+  ByteBufferView(const ByteBufferCIter begin, const ByteBufferCIter end)
+    : mBegin(begin)
+    , mEnd(end)
+  {
+  }
+
+  // implicit on purpose
+  ByteBufferView(const ByteBuffer& buffer) // NOLINT
+    : ByteBufferView(buffer.cbegin(), buffer.cend())
+  {
+  }
+
+  ByteBufferCIter begin() const {
+    return mBegin;
+  }
+
+  ByteBufferCIter end() const {
+    return mEnd;
+  }
+
+  std::size_t size() const {
+    return static_cast<std::size_t>(mEnd - mBegin);
+  }
+
+  ByteBufferCIter mBegin;
+  ByteBufferCIter mEnd;
+};
+
+
 }
@@ -16,6 +16,7 @@
 
 #include "cmp_file_package.hpp"
 
+#include "base/key_hasher.hpp"
 #include "loader/file_utils.hpp"
 
 #include <algorithm>
@@ -31,23 +32,51 @@ using namespace std;
 
 namespace {
 
-std::string normalizedFileName(const std::string& fileName) {
+char toUpper(const char ch) {
+  return static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+}
+
+
+std::string normalizedFileName(const std::string_view fileName) {
   std::string normalized(fileName);
   std::transform(
-    normalized.begin(),
-    normalized.end(),
-    normalized.begin(),
-    [](const auto ch) {
-      return static_cast<char>(std::toupper(ch));
-    });
+    normalized.begin(), normalized.end(), normalized.begin(), toUpper);
   return normalized;
 }
 
+
+/** Compare a normalized name to a name of arbitrary case */
+int compareFileNames(
+  const std::string_view normalizedName,
+  const std::string_view name
+) {
+  const auto commonLength = std::min(normalizedName.size(), name.size());
+  for (std::size_t i = 0; i < commonLength; ++i) {
+    const auto ch = toUpper(name[i]);
+    if (normalizedName[i] != ch) {
+      return normalizedName[i] < ch ? -1 : 1;
+    }
+  }
+
+  if (normalizedName.size() == name.size()) {
+    return 0;
+  }
+
+  return normalizedName.size() < name.size() ? -1 : 1;
+}
+
 }
 
 
 CMPFilePackage::CMPFilePackage(const string& filePath)
   : mFileData(loadFile(filePath))
+  , mTrackedBytes(
+      base::memory_accounting::Category::FilePackage, mFileData.size())
+  , mContentHash([this]() {
+      base::KeyHasher hasher;
+      hasher.addBytes(mFileData.cbegin(), mFileData.cend());
+      return hasher.value();
+    }())
 {
   LeStreamReader dictReader(mFileData.cbegin(), mFileData.cend());
 
@@ -63,53 +92,73 @@ CMPFilePackage::CMPFilePackage(const string& filePath)
       throw invalid_argument("Malformed dictionary in CMP file");
     }
 
-    mFileDict.emplace(
-      normalizedFileName(fileName),
-      DictEntry(fileOffset, fileSize));
+    mFileDict.push_back(
+      DictEntry{normalizedFileName(fileName), fileOffset, fileSize});
   }
+
+  // If a name appears more than once, the first entry wins
+  std::stable_sort(
+    mFileDict.begin(),
+    mFileDict.end(),
+    [](const DictEntry& lhs, const DictEntry& rhs) {
+      return lhs.mName < rhs.mName;
+    });
+  mFileDict.erase(
+    std::unique(
+      mFileDict.begin(),
+      mFileDict.end(),
+      [](const DictEntry& lhs, const DictEntry& rhs) {
+        return lhs.mName == rhs.mName;
+      }),
+    mFileDict.end());
+}
+
+
+ByteBuffer CMPFilePackage::file(const std::string_view name) const {
+  const auto view = fileView(name);
+  return ByteBuffer(view.begin(), view.end());
 }
 
 
-ByteBuffer CMPFilePackage::file(const std::string& name) const {
-  const auto it = findFileEntry(name);
-  if (it == mFileDict.end()) {
+ByteBufferView CMPFilePackage::fileView(const std::string_view name) const {
+  const auto pEntry = findFileEntry(name);
+  if (!pEntry) {
     throw invalid_argument(
       string("No such file in CMP: ") + normalizedFileName(name));
   }
 
-  const auto& fileHeader = it->second;
-  const auto fileStart = mFileData.begin() + fileHeader.fileOffset;
-  return ByteBuffer(fileStart, fileStart + fileHeader.fileSize);
+  const auto fileStart = mFileData.cbegin() + pEntry->mFileOffset;
+  return ByteBufferView(fileStart, fileStart + pEntry->mFileSize);
 }
 
 
-std::string CMPFilePackage::fileAsText(const std::string& name) const {
-  const auto bytes = file(name);
-  const auto pBytesAsChars = reinterpret_cast<const char*>(bytes.data());
-  return std::string(pBytesAsChars, pBytesAsChars + bytes.size());
+std::string CMPFilePackage::fileAsText(const std::string_view name) const {
+  const auto bytes = fileView(name);
+  return std::string(bytes.begin(), bytes.end());
 }
 
 
-bool CMPFilePackage::hasFile(const std::string& name) const {
-  return findFileEntry(name) != mFileDict.end();
+bool CMPFilePackage::hasFile(const std::string_view name) const {
+  return findFileEntry(name) != nullptr;
 }
 
 
-CMPFilePackage::FileDict::const_iterator CMPFilePackage::findFileEntry(
-  const std::string& name
+const CMPFilePackage::DictEntry* CMPFilePackage::findFileEntry(
+  const std::string_view name
 ) const {
-  return mFileDict.find(normalizedFileName(name));
-}
+  const auto iEntry = std::lower_bound(
+    mFileDict.begin(),
+    mFileDict.end(),
+    name,
+    [](const DictEntry& entry, const std::string_view name) {
+      return compareFileNames(entry.mName, name) < 0;
+    });
 
+  if (iEntry != mFileDict.end() && compareFileNames(iEntry->mName, name) == 0) {
+    return &*iEntry;
+  }
 
-CMPFilePackage::DictEntry::DictEntry(
-  const uint32_t fileOffset_,
-  const uint32_t fileSize_
-)
-  : fileOffset(fileOffset_)
-  , fileSize(fileSize_)
-{
+  return nullptr;
 }
 
-
 }
@@ -16,43 +16,60 @@
 
 #pragma once
 
+#include "base/memory_accounting.hpp"
 #include "loader/byte_buffer.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 
 namespace rigel::loader {
 
-
+/** Provides access to the files contained in a Duke Nukem II CMP archive
+ *
+ * File names are case-insensitive. The directory is built once when opening
+ * the package, as a flat list sorted by name, so looking up a file doesn't
+ * allocate.
+ */
 class CMPFilePackage {
 public:
   explicit CMPFilePackage(const std::string& filePath);
 
-  ByteBuffer file(const std::string& name) const;
-  std::string fileAsText(const std::string& name) const;
+  ByteBuffer file(std::string_view name) const;
+
+  /** Like file(), but without making a copy
+   *
+   * The view stays valid for as long as the package exists.
+   */
+  ByteBufferView fileView(std::string_view name) const;
+  std::string fileAsText(std::string_view name) const;
 
-  bool hasFile(const std::string& name) const;
+  bool hasFile(std::string_view name) const;
+
+  /** Hash of the entire package's contents, computed when opening it */
+  std::uint64_t contentHash() const {
+    return mContentHash;
+  }
 
 private:
   struct DictEntry {
-    DictEntry(std::uint32_t fileOffset, std::uint32_t fileSize);
-    DictEntry(const DictEntry&) = default;
-    DictEntry(DictEntry&&) = default;
-
-    const std::uint32_t fileOffset = 0;
-    const std::uint32_t fileSize = 0;
+    std::string mName;
+    std::uint32_t mFileOffset;
+    std::uint32_t mFileSize;
   };
 
-  using FileDict = std::unordered_map<std::string, DictEntry>;
-
-  FileDict::const_iterator findFileEntry(const std::string& name) const;
+  const DictEntry* findFileEntry(std::string_view name) const;
 
 private:
   std::vector<std::uint8_t> mFileData;
-  FileDict mFileDict;
+  base::memory_accounting::TrackedBytes mTrackedBytes;
+
+  /** Sorted by name, all names in upper case */
+  std::vector<DictEntry> mFileDict;
+  std::uint64_t mContentHash;
 };
 
 
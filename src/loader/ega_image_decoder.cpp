@@ -16,10 +16,8 @@
 
 #include "ega_image_decoder.hpp"
 
-#include "base/container_utils.hpp"
 #include "base/math_tools.hpp"
 #include "data/unit_conversions.hpp"
-#include "loader/bitwise_iter.hpp"
 #include "loader/file_utils.hpp"
 
 #include <array>
@@ -36,9 +34,6 @@ using data::tilesToPixels;
 
 namespace {
 
-using PalettizedPixelBuffer = std::vector<std::uint8_t>;
-
-
 size_t inferHeight(
   const ByteBufferCIter begin,
   const ByteBufferCIter end,
@@ -51,109 +46,59 @@ size_t inferHeight(
 }
 
 
-/** Decode EGA mask plane
+/** Lookup table for converting one byte of a bit plane into 8 pixels
  *
- * Pre-conditions:
- *   source and target can be advanced pixelCount times.
+ * Entry n is a 64-bit value whose i-th byte (counting from the least
+ * significant one) is 1 if bit i of n is set, counting from the most
+ * significant bit. EGA data stores the leftmost pixel in the most significant
+ * bit, so shifting an entry left by the plane index and ORing together the
+ * entries for all planes yields 8 palette indices at once - one per byte,
+ * in pixel order.
  */
-template<typename SourceIter, typename TargetIter>
-SourceIter readEgaMaskPlane(
-  SourceIter source,
-  TargetIter target,
-  const size_t pixelCount
-) {
-  for (size_t i = 0; i < pixelCount; ++i) {
-    *target++ = *source++;
-  }
-
-  return source;
-}
-
-/** Decode EGA color data (4 planes)
- *
- * Pre-conditions:
- *   target points to zero-initialized buffer of bytes.
- *   target can be advanced pixelCount times.
- *   source can be advanced pixelCount*4 times.
- */
-template<typename SourceIter, typename TargetIter>
-SourceIter readEgaColorData(
-  SourceIter source,
-  TargetIter target,
-  const size_t pixelCount
-) {
-  for (auto plane = 0u; plane < GameTraits::egaPlanes; ++plane) {
-    auto targetIterForPlane = target;
-
-    for (auto pixel = 0u; pixel < pixelCount; ++pixel) {
-      const auto planeBit = *source++;
-      *targetIterForPlane++ |= planeBit << plane;
+constexpr auto PLANE_BYTE_TO_PIXELS = []() {
+  std::array<std::uint64_t, 256> table{};
+  for (auto value = 0u; value < table.size(); ++value) {
+    for (auto bit = 0u; bit < GameTraits::pixelsPerEgaByte; ++bit) {
+      if (value & (0x80u >> bit)) {
+        table[value] |= std::uint64_t{1} << (bit * 8);
+      }
     }
   }
-
-  return source;
-}
+  return table;
+}();
 
 
-/** Decode EGA monochromatic data (1 plane)
- *
- * Pre-conditions:
- *   target points to buffer of Pixels.
- *   target can be advanced pixelCount times.
- *   source can be advanced pixelCount times.
- */
-template<typename SourceIter, typename TargetIter>
-SourceIter readEgaMonochromeData(
-  SourceIter source,
-  TargetIter target,
-  const size_t pixelCount
-) {
-  for (size_t i = 0; i < pixelCount; ++i) {
-    const auto pixelPresent = *source++ != 0;
-    *target++ = pixelPresent ?
-      data::Pixel{255, 255, 255, 255} :
-      data::Pixel{0, 0, 0, 255};
-  }
-
-  return source;
+std::uint8_t pixelAt(const std::uint64_t pixels, const std::size_t index) {
+  return static_cast<std::uint8_t>(pixels >> (index * 8));
 }
 
 
-/** Apply mask to decoded pixels
- *
- * Pre-conditions:
- *   pixels points to buffer of Pixels.
- *   maskValues points to buffer of bools.
- *   pixels can be advanced pixelCount times.
- *   maskValues can be advanced pixelCount times.
- */
-template<typename MaskIter, typename PixelBufferIter>
-void applyEgaMask(
-  MaskIter maskValues,
-  PixelBufferIter pixels,
-  const size_t pixelCount
+/** Decode the 4 color planes for 8 pixels into palette indices */
+std::uint64_t decodeEgaColorBytes(
+  const std::uint8_t plane0,
+  const std::uint8_t plane1,
+  const std::uint8_t plane2,
+  const std::uint8_t plane3
 ) {
-  for (size_t i = 0; i < pixelCount; ++i, ++pixels) {
-    const auto maskActive = *maskValues++;
-    if (maskActive) {
-      pixels->a = 0;
-    }
-  }
+  return
+    PLANE_BYTE_TO_PIXELS[plane0] |
+    (PLANE_BYTE_TO_PIXELS[plane1] << 1) |
+    (PLANE_BYTE_TO_PIXELS[plane2] << 2) |
+    (PLANE_BYTE_TO_PIXELS[plane3] << 3);
 }
 
 
-template<typename Callable>
-data::PixelBuffer decodeTiledEgaData(
-  const ByteBufferCIter dataIter,
+template<typename Buffer, typename Callable>
+Buffer decodeTiledEgaData(
+  ByteBufferCIter dataIter,
   const std::size_t widthInTiles,
   const std::size_t heightInTiles,
   Callable decodeRow
 ) {
   const auto targetBufferStride = tilesToPixels(widthInTiles);
-  PixelBuffer pixels(
+  Buffer pixels(
     widthInTiles * heightInTiles * GameTraits::tileSizeSquared);
 
-  BitWiseIterator<ByteBufferCIter> bitsIter(dataIter);
   for (auto row=0u; row<heightInTiles; ++row) {
     for (auto col=0u; col<widthInTiles; ++col) {
       for (size_t rowInTile=0u; rowInTile<GameTraits::tileSize; ++rowInTile) {
@@ -161,7 +106,7 @@ data::PixelBuffer decodeTiledEgaData(
           (tilesToPixels(row) + rowInTile)*targetBufferStride;
         const auto targetPixelIter = pixels.begin() + insertStart;
 
-        bitsIter = decodeRow(bitsIter, targetPixelIter);
+        dataIter = decodeRow(dataIter, targetPixelIter);
       }
     }
   }
@@ -179,63 +124,89 @@ data::PixelBuffer decodeSimplePlanarEgaBuffer(
 ) {
   const auto numBytes = distance(begin, end);
   assert(numBytes > 0);
-  const auto numPixels =
-    static_cast<size_t>(numBytes / GameTraits::egaPlanes) *
-    GameTraits::pixelsPerEgaByte;
-
-  BitWiseIterator<ByteBufferCIter> bitsIter(begin);
-  PalettizedPixelBuffer indexedPixels(numPixels, 0);
-  readEgaColorData(bitsIter, indexedPixels.begin(), numPixels);
+  const auto bytesPerPlane =
+    static_cast<size_t>(numBytes / GameTraits::egaPlanes);
+  const auto numPixels = bytesPerPlane * GameTraits::pixelsPerEgaByte;
+
+  // The planes are stored one after another, each one covering the whole
+  // image
+  const auto plane0 = begin;
+  const auto plane1 = plane0 + bytesPerPlane;
+  const auto plane2 = plane1 + bytesPerPlane;
+  const auto plane3 = plane2 + bytesPerPlane;
+
+  PixelBuffer pixels;
+  pixels.reserve(numPixels);
+  for (size_t i = 0; i < bytesPerPlane; ++i) {
+    const auto indices =
+      decodeEgaColorBytes(plane0[i], plane1[i], plane2[i], plane3[i]);
+    for (size_t pixel = 0; pixel < GameTraits::pixelsPerEgaByte; ++pixel) {
+      pixels.push_back(palette[pixelAt(indices, pixel)]);
+    }
+  }
 
-  return utils::transformed(indexedPixels,
-    [&palette](const auto colorIndex) {
-      return palette[colorIndex];
-    });
+  return pixels;
 }
 
 
-data::Image loadTiledImage(
+data::IndexedImage loadTiledIndexedImage(
   const ByteBufferCIter begin,
   const ByteBufferCIter end,
-  std::size_t widthInTiles,
-  const Palette16& palette,
+  const std::size_t widthInTiles,
   const data::TileImageType type
 ) {
+  using data::IndexedImage;
+
   const auto heightInTiles =
     inferHeight(begin, end, widthInTiles, GameTraits::bytesPerTile(type));
 
-  auto pixels = decodeTiledEgaData(begin, widthInTiles, heightInTiles,
-    [&palette, type](auto sourceBitsIter, const auto targetPixelIter) {
-      const auto isMasked = type == data::TileImageType::Masked;
-      array<bool, GameTraits::tileSize> pixelMask;
-      if (isMasked) {
-        sourceBitsIter = readEgaMaskPlane(
-          sourceBitsIter, pixelMask.begin(), GameTraits::tileSize);
+  const auto isMasked = type == data::TileImageType::Masked;
+  auto indices = decodeTiledEgaData<data::IndexBuffer>(
+    begin,
+    widthInTiles,
+    heightInTiles,
+    [isMasked](auto sourceIter, const auto targetIndexIter) {
+      // Each row of a tile is made up of one byte per plane, with the
+      // optional mask plane coming first
+      const auto mask = isMasked
+        ? PLANE_BYTE_TO_PIXELS[*sourceIter++]
+        : std::uint64_t{0};
+      const auto indices = decodeEgaColorBytes(
+        sourceIter[0], sourceIter[1], sourceIter[2], sourceIter[3]);
+      sourceIter += GameTraits::egaPlanes;
+
+      // The mask has a 1 in each byte which is masked out, so shifting it
+      // into place yields the transparency flags for all 8 pixels
+      const auto flaggedIndices = indices | (mask << 4);
+
+      for (auto i=0u; i<GameTraits::pixelsPerEgaByte; ++i) {
+        *(targetIndexIter + i) = pixelAt(flaggedIndices, i);
       }
 
-      array<uint8_t, GameTraits::tileSize> indexedPixels;
-      indexedPixels.fill(0);
-      sourceBitsIter = readEgaColorData(
-        sourceBitsIter, indexedPixels.begin(), GameTraits::tileSize);
-
-      for (auto i=0; i<GameTraits::tileSize; ++i) {
-        *(targetPixelIter + i) = palette[indexedPixels[i]];
-      }
-
-      if (isMasked) {
-        applyEgaMask(pixelMask.begin(), targetPixelIter, GameTraits::tileSize);
-      }
-
-      return sourceBitsIter;
+      return sourceIter;
     });
 
-  return data::Image(
-    std::move(pixels),
+  static_assert(IndexedImage::TRANSPARENCY_FLAG == 1 << 4);
+
+  return IndexedImage(
+    std::move(indices),
     tilesToPixels(widthInTiles),
     tilesToPixels(heightInTiles));
 }
 
 
+data::Image loadTiledImage(
+  const ByteBufferCIter begin,
+  const ByteBufferCIter end,
+  const std::size_t widthInTiles,
+  const Palette16& palette,
+  const data::TileImageType type
+) {
+  return loadTiledIndexedImage(begin, end, widthInTiles, type)
+    .toRgba(palette);
+}
+
+
 data::Image loadTiledFontBitmap(
   const ByteBufferCIter begin,
   const ByteBufferCIter end,
@@ -244,15 +215,24 @@ data::Image loadTiledFontBitmap(
   const auto heightInTiles =
     inferHeight(begin, end, widthInTiles, GameTraits::bytesPerFontTile());
 
-  auto pixels = decodeTiledEgaData(begin, widthInTiles, heightInTiles,
-    [](auto sourceBitsIter, const auto targetPixelIter) {
-      array<bool, GameTraits::tileSize> pixelMask;
-      sourceBitsIter = readEgaMaskPlane(sourceBitsIter, pixelMask.begin(), GameTraits::tileSize);
+  auto pixels = decodeTiledEgaData<PixelBuffer>(
+    begin,
+    widthInTiles,
+    heightInTiles,
+    [](auto sourceIter, const auto targetPixelIter) {
+      const auto mask = PLANE_BYTE_TO_PIXELS[*sourceIter++];
+      const auto color = PLANE_BYTE_TO_PIXELS[*sourceIter++];
+
+      for (auto i=0u; i<GameTraits::pixelsPerEgaByte; ++i) {
+        *(targetPixelIter + i) = pixelAt(color, i) ?
+          data::Pixel{255, 255, 255, 255} :
+          data::Pixel{0, 0, 0, 255};
+        if (pixelAt(mask, i)) {
+          (targetPixelIter + i)->a = 0;
+        }
+      }
 
-      sourceBitsIter = readEgaMonochromeData(
-        sourceBitsIter, targetPixelIter, GameTraits::tileSize);
-      applyEgaMask(pixelMask.begin(), targetPixelIter, GameTraits::tileSize);
-      return sourceBitsIter;
+      return sourceIter;
     });
 
   return data::Image(
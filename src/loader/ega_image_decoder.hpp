@@ -20,6 +20,7 @@
 #include "loader/palette.hpp"
 #include "data/game_traits.hpp"
 #include "data/image.hpp"
+#include "data/indexed_image.hpp"
 
 
 namespace rigel::loader {
@@ -30,6 +31,26 @@ data::PixelBuffer decodeSimplePlanarEgaBuffer(
   const Palette16& palette);
 
 
+/** Decode tiled EGA data into palette indices
+ *
+ * For masked data, masked out pixels get IndexedImage::TRANSPARENCY_FLAG.
+ */
+data::IndexedImage loadTiledIndexedImage(
+  ByteBufferCIter begin,
+  ByteBufferCIter end,
+  std::size_t widthInTiles,
+  data::TileImageType type);
+
+
+inline data::IndexedImage loadTiledIndexedImage(
+  const ByteBufferView data,
+  const std::size_t widthInTiles,
+  const data::TileImageType type = data::TileImageType::Unmasked
+) {
+  return loadTiledIndexedImage(data.begin(), data.end(), widthInTiles, type);
+}
+
+
 data::Image loadTiledImage(
   ByteBufferCIter begin,
   ByteBufferCIter end,
@@ -39,14 +60,14 @@ data::Image loadTiledImage(
 
 
 inline data::Image loadTiledImage(
-  const ByteBuffer& data,
+  const ByteBufferView data,
   std::size_t widthInTiles,
   const Palette16& palette,
   const data::TileImageType type = data::TileImageType::Unmasked
 ) {
   return loadTiledImage(
-    data.cbegin(),
-    data.cend(),
+    data.begin(),
+    data.end(),
     widthInTiles,
     palette,
     type);
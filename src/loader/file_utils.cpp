@@ -48,8 +48,8 @@ ByteBuffer loadFile(const string& fileName) {
 }
 
 
-LeStreamReader::LeStreamReader(const ByteBuffer& data)
-  : LeStreamReader(data.cbegin(), data.cend())
+LeStreamReader::LeStreamReader(const ByteBufferView data)
+  : LeStreamReader(data.begin(), data.end())
 {
 }
 
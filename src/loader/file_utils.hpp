@@ -37,7 +37,7 @@ ByteBuffer loadFile(const std::string& fileName);
  */
 class LeStreamReader {
 public:
-  explicit LeStreamReader(const ByteBuffer& data);
+  explicit LeStreamReader(ByteBufferView data);
   LeStreamReader(ByteBufferCIter begin, ByteBufferCIter end);
 
   std::uint8_t readU8();
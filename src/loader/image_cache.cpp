@@ -0,0 +1,182 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "image_cache.hpp"
+
+#include "base/key_hasher.hpp"
+#include "loader/file_utils.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+
+namespace rigel::loader {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+const auto CACHE_FILE_MAGIC = std::uint32_t{0x31434952}; // "RIC1"
+
+// Guards against treating a broken header as a request to allocate huge
+// amounts of memory
+const auto MAX_IMAGE_DIMENSION = std::uint32_t{16384};
+
+static_assert(sizeof(data::Pixel) == 4);
+
+
+void writeU32(std::vector<std::uint8_t>& buffer, const std::uint32_t value) {
+  for (auto shift = 0; shift < 32; shift += 8) {
+    buffer.push_back(static_cast<std::uint8_t>((value >> shift) & 0xFF));
+  }
+}
+
+}
+
+
+ImageCache::ImageCache(std::string directory, const std::uint64_t sourceHash)
+  : mDirectory(std::move(directory))
+  , mSourceHash(sourceHash)
+{
+}
+
+
+std::optional<std::vector<data::Image>> ImageCache::load(
+  const std::uint64_t key
+) const {
+  const auto path = entryPath(key);
+
+  std::error_code error;
+  if (!fs::exists(fs::u8path(path), error)) {
+    return std::nullopt;
+  }
+
+  try {
+    const auto buffer = loadFile(path);
+    LeStreamReader reader(buffer);
+
+    if (reader.readU32() != CACHE_FILE_MAGIC) {
+      return std::nullopt;
+    }
+
+    const auto numImages = reader.readU32();
+    std::vector<data::Image> images;
+    images.reserve(std::min(numImages, std::uint32_t{1024}));
+
+    for (auto i = std::uint32_t{0}; i < numImages; ++i) {
+      const auto width = reader.readU32();
+      const auto height = reader.readU32();
+      if (width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return std::nullopt;
+      }
+
+      // The pixels are stored as raw RGBA bytes, which is also the in-memory
+      // layout of data::Pixel. That allows copying them in one go.
+      const auto numPixels = std::size_t{width} * height;
+      const auto numBytes = numPixels * sizeof(data::Pixel);
+      const auto iPixelData = reader.currentIter();
+      if (std::size_t(buffer.cend() - iPixelData) < numBytes) {
+        return std::nullopt;
+      }
+
+      const auto pPixels = reinterpret_cast<const data::Pixel*>(&*iPixelData);
+      images.emplace_back(
+        data::PixelBuffer{pPixels, pPixels + numPixels}, width, height);
+      reader.skipBytes(numBytes);
+    }
+
+    return images;
+  } catch (const std::exception&) {
+    // Treat broken cache files like missing ones
+    return std::nullopt;
+  }
+}
+
+
+void ImageCache::save(
+  const std::uint64_t key,
+  const std::vector<data::Image>& images
+) const {
+  std::vector<std::uint8_t> buffer;
+  writeU32(buffer, CACHE_FILE_MAGIC);
+  writeU32(buffer, static_cast<std::uint32_t>(images.size()));
+  for (const auto& image : images) {
+    writeU32(buffer, static_cast<std::uint32_t>(image.width()));
+    writeU32(buffer, static_cast<std::uint32_t>(image.height()));
+
+    const auto& pixels = image.pixelData();
+    const auto pBytes = reinterpret_cast<const std::uint8_t*>(pixels.data());
+    buffer.insert(
+      buffer.end(), pBytes, pBytes + pixels.size() * sizeof(data::Pixel));
+  }
+
+  const auto filePath = fs::u8path(entryPath(key));
+  std::error_code error;
+  fs::create_directories(filePath.parent_path(), error);
+
+  // Write to a temporary file first, so that an interrupted write doesn't
+  // leave a truncated cache entry behind. Assets can be decoded on multiple
+  // threads, so the temporary file's name needs to be unique per thread.
+  auto tempPath = filePath;
+  tempPath += ".tmp" +
+    std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  {
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "WARNING: Failed to write image cache file\n";
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  }
+
+  fs::rename(tempPath, filePath, error);
+  if (error) {
+    std::cerr << "WARNING: Failed to write image cache file\n";
+    fs::remove(tempPath, error);
+  }
+}
+
+
+std::string ImageCache::entryPath(const std::uint64_t key) const {
+  std::stringstream fileName;
+  fileName
+    << std::hex << std::setfill('0')
+    << std::setw(16) << mSourceHash << '_'
+    << std::setw(16) << key << ".img";
+  return (fs::u8path(mDirectory) / fileName.str()).u8string();
+}
+
+
+std::uint64_t makeImageCacheKey(
+  const std::string_view assetName,
+  const Palette16& palette
+) {
+  base::KeyHasher hasher;
+  hasher.add(assetName);
+  hasher.add(hashPalette(palette));
+  return hasher.value();
+}
+
+}
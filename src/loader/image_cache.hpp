@@ -0,0 +1,81 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "data/image.hpp"
+#include "loader/palette.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace rigel::loader {
+
+/** On-disk cache of decoded images
+ *
+ * Each entry holds a list of images, stored as raw RGBA pixels. Entries are
+ * identified by a key, which needs to cover everything that influences the
+ * decoding result for a particular asset, like its file name and palette.
+ * On top of that, the source hash given on construction is part of all
+ * entries' names. It identifies the game data and any other inputs shared by
+ * all assets, so that changing these invalidates the whole cache.
+ *
+ * Failing to read or write cache entries is not an error, the affected
+ * images are decoded from the original data instead.
+ */
+class ImageCache {
+public:
+  ImageCache(std::string directory, std::uint64_t sourceHash);
+
+  /** Return the cached images for key, decoding and caching them if needed
+   *
+   * decode() is invoked on a cache miss, and must return a
+   * std::vector<data::Image>.
+   */
+  template <typename DecodeFunc>
+  std::vector<data::Image> fetch(std::uint64_t key, DecodeFunc decode) const {
+    if (auto maybeImages = load(key)) {
+      return std::move(*maybeImages);
+    }
+
+    auto images = decode();
+    save(key, images);
+    return images;
+  }
+
+  std::optional<std::vector<data::Image>> load(std::uint64_t key) const;
+  void save(std::uint64_t key, const std::vector<data::Image>& images) const;
+
+private:
+  std::string entryPath(std::uint64_t key) const;
+
+  std::string mDirectory;
+  std::uint64_t mSourceHash;
+};
+
+
+/** Make a cache key for an asset which is decoded using the given palette */
+std::uint64_t makeImageCacheKey(
+  std::string_view assetName,
+  const Palette16& palette);
+
+}
@@ -0,0 +1,256 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "level_cache.hpp"
+
+#include "base/key_hasher.hpp"
+#include "data/game_traits.hpp"
+#include "loader/file_utils.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+
+namespace rigel::loader {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Needs to change whenever the entry layout or the preprocessing done by
+// loadLevel() changes, since that invalidates existing entries
+const auto CACHE_FILE_MAGIC = std::uint32_t{0x31434C52}; // "RLC1"
+
+// Guards against treating a broken entry as a request to allocate huge
+// amounts of memory
+const auto MAX_NUM_TILES =
+  static_cast<std::uint32_t>(data::GameTraits::mapDataWords);
+const auto MAX_STRING_LENGTH = std::uint32_t{256};
+
+
+void writeU32(std::vector<std::uint8_t>& buffer, const std::uint32_t value) {
+  for (auto shift = 0; shift < 32; shift += 8) {
+    buffer.push_back(static_cast<std::uint8_t>((value >> shift) & 0xFF));
+  }
+}
+
+
+void writeS32(std::vector<std::uint8_t>& buffer, const std::int32_t value) {
+  writeU32(buffer, static_cast<std::uint32_t>(value));
+}
+
+
+void writeString(std::vector<std::uint8_t>& buffer, const std::string& str) {
+  writeU32(buffer, static_cast<std::uint32_t>(str.size()));
+  buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+
+std::string readString(LeStreamReader& reader) {
+  const auto length = reader.readU32();
+  if (length > MAX_STRING_LENGTH) {
+    throw std::runtime_error("Invalid string length");
+  }
+
+  return readFixedSizeString(reader, length);
+}
+
+
+void writeLayer(
+  std::vector<std::uint8_t>& buffer,
+  const std::vector<data::map::TileIndex>& tiles
+) {
+  for (const auto index : tiles) {
+    buffer.push_back(static_cast<std::uint8_t>(index & 0xFF));
+    buffer.push_back(static_cast<std::uint8_t>((index >> 8) & 0xFF));
+  }
+}
+
+
+std::vector<data::map::TileIndex> readLayer(
+  LeStreamReader& reader,
+  const std::size_t numTiles
+) {
+  std::vector<data::map::TileIndex> tiles;
+  tiles.reserve(numTiles);
+  for (std::size_t i = 0; i < numTiles; ++i) {
+    tiles.push_back(reader.readU16());
+  }
+
+  return tiles;
+}
+
+}
+
+
+LevelCache::LevelCache(std::string directory)
+  : mDirectory(std::move(directory))
+{
+}
+
+
+std::optional<PreprocessedLevel> LevelCache::load(
+  const std::uint64_t key
+) const {
+  const auto path = entryPath(key);
+
+  std::error_code error;
+  if (!fs::exists(fs::u8path(path), error)) {
+    return std::nullopt;
+  }
+
+  try {
+    const auto buffer = loadFile(path);
+    LeStreamReader reader(buffer);
+
+    if (reader.readU32() != CACHE_FILE_MAGIC) {
+      return std::nullopt;
+    }
+
+    PreprocessedLevel level;
+    level.mCZoneName = readString(reader);
+    level.mBackdropName = readString(reader);
+    level.mMusicFile = readString(reader);
+    level.mFlags = static_cast<std::uint8_t>(reader.readU32());
+    level.mAlternativeBackdropNumber =
+      static_cast<std::uint8_t>(reader.readU32());
+
+    const auto width = reader.readU32();
+    const auto height = reader.readU32();
+    if (width == 0 || height > MAX_NUM_TILES / width) {
+      return std::nullopt;
+    }
+
+    level.mWidth = static_cast<int>(width);
+    level.mHeight = static_cast<int>(height);
+
+    const auto numTiles = std::size_t{width} * height;
+    level.mSolidLayer = readLayer(reader, numTiles);
+    level.mMaskedLayer = readLayer(reader, numTiles);
+
+    const auto numActors = reader.readU32();
+    if (numActors > numTiles) {
+      return std::nullopt;
+    }
+
+    level.mActors.reserve(numActors);
+    for (auto i = std::uint32_t{0}; i < numActors; ++i) {
+      auto& actor = level.mActors.emplace_back();
+      actor.mID = static_cast<data::ActorID>(reader.readU32());
+      actor.mPosition.x = reader.readS32();
+      actor.mPosition.y = reader.readS32();
+
+      if (reader.readU32() != 0) {
+        base::Rect<int> area;
+        area.topLeft.x = reader.readS32();
+        area.topLeft.y = reader.readS32();
+        area.size.width = reader.readS32();
+        area.size.height = reader.readS32();
+        actor.mAssignedArea = area;
+      }
+    }
+
+    return level;
+  } catch (const std::exception&) {
+    // Treat broken cache files like missing ones
+    return std::nullopt;
+  }
+}
+
+
+void LevelCache::save(
+  const std::uint64_t key,
+  const PreprocessedLevel& level
+) const {
+  std::vector<std::uint8_t> buffer;
+  writeU32(buffer, CACHE_FILE_MAGIC);
+  writeString(buffer, level.mCZoneName);
+  writeString(buffer, level.mBackdropName);
+  writeString(buffer, level.mMusicFile);
+  writeU32(buffer, level.mFlags);
+  writeU32(buffer, level.mAlternativeBackdropNumber);
+  writeU32(buffer, static_cast<std::uint32_t>(level.mWidth));
+  writeU32(buffer, static_cast<std::uint32_t>(level.mHeight));
+  writeLayer(buffer, level.mSolidLayer);
+  writeLayer(buffer, level.mMaskedLayer);
+
+  writeU32(buffer, static_cast<std::uint32_t>(level.mActors.size()));
+  for (const auto& actor : level.mActors) {
+    writeU32(buffer, static_cast<std::uint32_t>(actor.mID));
+    writeS32(buffer, actor.mPosition.x);
+    writeS32(buffer, actor.mPosition.y);
+
+    writeU32(buffer, actor.mAssignedArea ? 1 : 0);
+    if (actor.mAssignedArea) {
+      writeS32(buffer, actor.mAssignedArea->topLeft.x);
+      writeS32(buffer, actor.mAssignedArea->topLeft.y);
+      writeS32(buffer, actor.mAssignedArea->size.width);
+      writeS32(buffer, actor.mAssignedArea->size.height);
+    }
+  }
+
+  const auto filePath = fs::u8path(entryPath(key));
+  std::error_code error;
+  fs::create_directories(filePath.parent_path(), error);
+
+  // Write to a temporary file first, so that an interrupted write doesn't
+  // leave a truncated cache entry behind
+  auto tempPath = filePath;
+  tempPath += ".tmp" +
+    std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  {
+    std::ofstream file(tempPath, std::ios::binary);
+    if (!file.is_open()) {
+      std::cerr << "WARNING: Failed to write level cache file\n";
+      return;
+    }
+
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+  }
+
+  fs::rename(tempPath, filePath, error);
+  if (error) {
+    std::cerr << "WARNING: Failed to write level cache file\n";
+    fs::remove(tempPath, error);
+  }
+}
+
+
+std::string LevelCache::entryPath(const std::uint64_t key) const {
+  std::stringstream fileName;
+  fileName << std::hex << std::setfill('0') << std::setw(16) << key << ".lvl";
+  return (fs::u8path(mDirectory) / fileName.str()).u8string();
+}
+
+
+std::uint64_t makeLevelCacheKey(
+  const ByteBufferView levelFile,
+  const data::Difficulty difficulty
+) {
+  base::KeyHasher hasher;
+  hasher.addBytes(levelFile.begin(), levelFile.end());
+  hasher.add(static_cast<std::uint8_t>(difficulty));
+  return hasher.value();
+}
+
+}
@@ -0,0 +1,100 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "data/game_session_data.hpp"
+#include "data/map.hpp"
+#include "loader/byte_buffer.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace rigel::loader {
+
+/** Everything loadLevel() derives from the level file itself
+ *
+ * That's the header fields, the decoded tiles of both map layers, and the
+ * actor list after applying the difficulty and resolving assigned areas.
+ * Images and tile attributes come from other files, and aren't part of it.
+ */
+struct PreprocessedLevel {
+  std::string mCZoneName;
+  std::string mBackdropName;
+  std::string mMusicFile;
+  std::uint8_t mFlags = 0;
+  std::uint8_t mAlternativeBackdropNumber = 0;
+
+  int mWidth = 0;
+  int mHeight = 0;
+
+  // Row-major, width * height entries each
+  std::vector<data::map::TileIndex> mSolidLayer;
+  std::vector<data::map::TileIndex> mMaskedLayer;
+
+  std::vector<data::map::LevelData::Actor> mActors;
+};
+
+
+/** On-disk cache of preprocessed levels
+ *
+ * Entries are stored as a flat sequence of fixed-size little-endian fields,
+ * with the tile layers as plain arrays, so that loading one is a single
+ * file read followed by a few bounds-checked copies. Entries are named
+ * after the key, which covers the level file's contents and the difficulty
+ * (see makeLevelCacheKey()). Changing the level file therefore simply leads
+ * to a new entry.
+ *
+ * Like with the ImageCache, failing to read or write entries is not an
+ * error, the level is parsed from the original file instead.
+ */
+class LevelCache {
+public:
+  explicit LevelCache(std::string directory);
+
+  /** Return the cached level for key, parsing and caching it if needed
+   *
+   * parse() is invoked on a cache miss, and must return a PreprocessedLevel.
+   */
+  template <typename ParseFunc>
+  PreprocessedLevel fetch(std::uint64_t key, ParseFunc parse) const {
+    if (auto maybeLevel = load(key)) {
+      return std::move(*maybeLevel);
+    }
+
+    auto level = parse();
+    save(key, level);
+    return level;
+  }
+
+  std::optional<PreprocessedLevel> load(std::uint64_t key) const;
+  void save(std::uint64_t key, const PreprocessedLevel& level) const;
+
+private:
+  std::string entryPath(std::uint64_t key) const;
+
+  std::string mDirectory;
+};
+
+
+std::uint64_t makeLevelCacheKey(
+  ByteBufferView levelFile,
+  data::Difficulty difficulty);
+
+}
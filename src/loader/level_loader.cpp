@@ -18,16 +18,21 @@
 
 #include "base/container_utils.hpp"
 #include "base/grid.hpp"
-#include "base/math_tools.hpp"
 #include "data/game_traits.hpp"
 #include "data/unit_conversions.hpp"
 #include "loader/bitwise_iter.hpp"
 #include "loader/file_utils.hpp"
+#include "loader/level_cache.hpp"
 #include "loader/resource_loader.hpp"
 #include "loader/rle_compression.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <fstream>
+#include <future>
 #include <string>
+#include <thread>
 #include <type_traits>
 
 
@@ -57,6 +62,8 @@ namespace {
 
 using ActorList = std::vector<LevelData::Actor>;
 
+const auto MAX_ACTOR_PREFETCH_THREADS = std::size_t{4};
+
 
 string stripSpaces(string str) {
   const auto it = str.find(' ');
@@ -92,7 +99,7 @@ struct LevelHeader {
   {
   }
 
-  bool flagBitSet(const uint8_t bitMask) {
+  bool flagBitSet(const uint8_t bitMask) const {
     return (flags & bitMask) != 0;
   }
 
@@ -112,21 +119,9 @@ ByteBuffer readExtraMaskedTileBits(const LeStreamReader& levelReader) {
   extraInfoReader.skipBytes(GameTraits::mapDataWords * sizeof(uint16_t));
   const auto extraInfoSize = extraInfoReader.readU16();
 
-  LeStreamReader rleReader(
+  return decompressRle(ByteBufferView{
     extraInfoReader.currentIter(),
-    extraInfoReader.currentIter() + extraInfoSize);
-
-  ByteBuffer maskedTileOffsets;
-  // The uncompressed masked tile extra bits contain 2 bits for each tile, so
-  // we need one byte to represent 4 tiles.
-  maskedTileOffsets.reserve(
-    base::integerDivCeil<size_t>(GameTraits::mapDataWords, 4u));
-
-  decompressRle(rleReader, [&maskedTileOffsets](const auto decoded) {
-    maskedTileOffsets.push_back(decoded);
-  });
-
-  return maskedTileOffsets;
+    extraInfoReader.currentIter() + extraInfoSize});
 }
 
 
@@ -143,8 +138,12 @@ string backdropNameFromNumber(const uint8_t backdropNumber) {
  * Takes a linear list of actor descriptions, and puts them into a 2d grid.
  * This is useful since some meta actors have spatial relations to others.
  */
-auto makeActorGrid(const data::map::Map& map, const ActorList& actors) {
-  base::Grid<const LevelData::Actor*> actorGrid(map.width(), map.height());
+auto makeActorGrid(
+  const int width,
+  const int height,
+  const ActorList& actors
+) {
+  base::Grid<const LevelData::Actor*> actorGrid(width, height);
 
   for (const auto& actor : actors) {
     actorGrid.setValueAt(actor.mPosition.x, actor.mPosition.y, &actor);
@@ -155,8 +154,8 @@ auto makeActorGrid(const data::map::Map& map, const ActorList& actors) {
 
 class ActorGrid {
 public:
-  ActorGrid(const data::map::Map& map, const ActorList& actors)
-    : mActorGrid(makeActorGrid(map, actors))
+  ActorGrid(const int width, const int height, const ActorList& actors)
+    : mActorGrid(makeActorGrid(width, height, actors))
   {
   }
 
@@ -222,15 +221,16 @@ private:
  * the list (difficulty markers and section markers).
  */
 ActorList preProcessActorDescriptions(
-  const data::map::Map& map,
+  const int width,
+  const int height,
   const ActorList& originalActors,
   const Difficulty chosenDifficulty
 ) {
   ActorList actors;
 
-  ActorGrid grid(map, originalActors);
-  for (int row=0; row<map.height(); ++row) {
-    for (int col=0; col<map.width(); ++col) {
+  ActorGrid grid(width, height, originalActors);
+  for (int row=0; row<height; ++row) {
+    for (int col=0; col<width; ++col) {
       if (!grid.hasActorAt(col, row)) {
         continue;
       }
@@ -292,16 +292,17 @@ ActorList preProcessActorDescriptions(
   return actors;
 }
 
-}
-
 
-LevelData loadLevel(
-  const string& mapName,
-  const ResourceLoader& resources,
+/** Parse the level file and preprocess its actors
+ *
+ * Covers everything that only depends on the level file itself, which is
+ * what the LevelCache stores.
+ */
+PreprocessedLevel parseLevel(
+  const ByteBufferView levelFile,
   const Difficulty chosenDifficulty
 ) {
-  const auto levelData = resources.mFilePackage.file(mapName);
-  LeStreamReader levelReader(levelData);
+  LeStreamReader levelReader(levelFile);
 
   LevelHeader header(levelReader);
   ActorList actors;
@@ -311,11 +312,8 @@ LevelData loadLevel(
     actors.emplace_back(LevelData::Actor{position, static_cast<ActorID>(type), std::nullopt});
   }
 
-  auto tileSet = resources.loadCZone(header.CZone);
-
   const auto width = static_cast<int>(levelReader.readU16());
   const auto height = static_cast<int>(GameTraits::mapHeightForWidth(width));
-  data::map::Map map(width, height, std::move(tileSet.mAttributes));
 
   const auto maskedTileOffsets = readExtraMaskedTileBits(levelReader);
   auto lookupExtraMaskedTileBits = [&maskedTileOffsets, width, height](
@@ -332,11 +330,23 @@ LevelData loadLevel(
     return static_cast<uint8_t>(extraBits << 5);
   };
 
+  PreprocessedLevel level;
+  level.mCZoneName = header.CZone;
+  level.mBackdropName = header.backdrop;
+  level.mMusicFile = header.music;
+  level.mFlags = header.flags;
+  level.mAlternativeBackdropNumber = header.alternativeBackdropNumber;
+  level.mWidth = width;
+  level.mHeight = height;
+  level.mSolidLayer.resize(size_t(width) * height, 0);
+  level.mMaskedLayer.resize(size_t(width) * height, 0);
+
   LeStreamReader tileDataReader(
     levelReader.currentIter(),
     levelReader.currentIter() + width*height*sizeof(uint16_t));
+  auto tileIndex = size_t{0};
   for (int y=0; y<height; ++y) {
-    for (int x=0; x<width; ++x) {
+    for (int x=0; x<width; ++x, ++tileIndex) {
       const auto tileSpec = tileDataReader.readU16();
 
       if (tileSpec & 0x8000) {
@@ -349,23 +359,132 @@ LevelData loadLevel(
         maskedIndex |= lookupExtraMaskedTileBits(x, y);
         maskedIndex += GameTraits::CZone::numSolidTiles;
 
-        map.setTileAt(0, x, y, solidIndex);
-        map.setTileAt(1, x, y, maskedIndex);
+        level.mSolidLayer[tileIndex] = solidIndex;
+        level.mMaskedLayer[tileIndex] = maskedIndex;
       } else {
-        const auto index = convertTileIndex(tileSpec);
-        map.setTileAt(0, x, y, index);
+        level.mSolidLayer[tileIndex] = convertTileIndex(tileSpec);
+      }
+    }
+  }
+
+  level.mActors =
+    preProcessActorDescriptions(width, height, actors, chosenDifficulty);
+  return level;
+}
+
+}
+
+
+std::string levelFileName(const int episode, const int level) {
+  assert(episode >=0 && episode < data::NUM_EPISODES);
+  assert(level >=0 && level < data::NUM_LEVELS_PER_EPISODE);
+
+  static const char EPISODE_PREFIXES[] = {'L', 'M', 'N', 'O'};
+
+  std::string fileName;
+  fileName += EPISODE_PREFIXES[episode];
+  fileName += std::to_string(level + 1);
+  fileName += ".MNI";
+  return fileName;
+}
+
+
+LevelData loadLevel(
+  const string& mapName,
+  const ResourceLoader& resources,
+  const Difficulty chosenDifficulty
+) {
+  const auto levelFile = resources.mFilePackage.fileView(mapName);
+  auto parse = [&]() { return parseLevel(levelFile, chosenDifficulty); };
+  auto level = resources.levelCache()
+    ? resources.levelCache()->fetch(
+        makeLevelCacheKey(levelFile, chosenDifficulty), parse)
+    : parse();
+
+  auto flagBitSet = [&level](const uint8_t bitMask) {
+    return (level.mFlags & bitMask) != 0;
+  };
+
+  // Decoding the tile set, backdrops and actor images takes up most of the
+  // time needed for loading a level. These don't depend on each other or on
+  // the map data, so they run on worker threads while the map is built
+  // here.
+  auto tileSetImage = std::async(std::launch::async, [&]() {
+    return resources.loadCZoneTiles(level.mCZoneName);
+  });
+  auto backdropImage = std::async(std::launch::async, [&]() {
+    return resources.loadTiledFullscreenImage(level.mBackdropName);
+  });
+  auto alternativeBackdropImage = std::async(
+    std::launch::async, [&]() -> std::optional<data::Image> {
+      if (flagBitSet(0x40) || flagBitSet(0x80)) {
+        return resources.loadTiledFullscreenImage(
+          backdropNameFromNumber(level.mAlternativeBackdropNumber));
+      }
+
+      return std::nullopt;
+    });
+
+  // The decoded actor images end up in the ActorImagePackage's cache, where
+  // the entity factory picks them up when creating the level's entities.
+  std::vector<ActorID> actorsToPrefetch;
+  for (const auto& actor : level.mActors) {
+    if (resources.mActorImagePackage.hasActor(actor.mID)) {
+      actorsToPrefetch.push_back(actor.mID);
+    }
+  }
+  std::sort(actorsToPrefetch.begin(), actorsToPrefetch.end());
+  actorsToPrefetch.erase(
+    std::unique(actorsToPrefetch.begin(), actorsToPrefetch.end()),
+    actorsToPrefetch.end());
+
+  std::atomic<std::size_t> nextActorIndex{0};
+  auto prefetchActors = [&]() {
+    for (
+      auto index = nextActorIndex++;
+      index < actorsToPrefetch.size();
+      index = nextActorIndex++
+    ) {
+      resources.mActorImagePackage.loadActor(actorsToPrefetch[index]);
+    }
+  };
+
+  const auto numPrefetchWorkers = std::clamp(
+    static_cast<std::size_t>(std::thread::hardware_concurrency()) / 2,
+    std::size_t{1},
+    MAX_ACTOR_PREFETCH_THREADS);
+  std::vector<std::future<void>> actorPrefetchers;
+  for (std::size_t i = 0; i < numPrefetchWorkers; ++i) {
+    actorPrefetchers.push_back(
+      std::async(std::launch::async, prefetchActors));
+  }
+
+  data::map::Map map(
+    level.mWidth,
+    level.mHeight,
+    resources.loadCZoneAttributes(level.mCZoneName));
+
+  // Masked tiles are always placed after the solid ones in the tile set, so
+  // an index of 0 means there's nothing on the masked layer
+  auto tileIndex = std::size_t{0};
+  for (int y=0; y<level.mHeight; ++y) {
+    for (int x=0; x<level.mWidth; ++x, ++tileIndex) {
+      map.setTileAt(0, x, y, level.mSolidLayer[tileIndex]);
+
+      if (const auto maskedIndex = level.mMaskedLayer[tileIndex]) {
+        map.setTileAt(1, x, y, maskedIndex);
       }
     }
   }
 
   auto scrollMode = BackdropScrollMode::None;
-  if (header.flagBitSet(0x1)) {
+  if (flagBitSet(0x1)) {
     scrollMode = BackdropScrollMode::ParallaxBoth;
-  } else if (header.flagBitSet(0x2)) {
+  } else if (flagBitSet(0x2)) {
     scrollMode = BackdropScrollMode::ParallaxHorizontal;
-  } else if (header.flagBitSet(0x8)) {
+  } else if (flagBitSet(0x8)) {
     scrollMode = BackdropScrollMode::AutoHorizontal;
-  } else if (header.flagBitSet(0x10)) {
+  } else if (flagBitSet(0x10)) {
     scrollMode = BackdropScrollMode::AutoVertical;
   }
   auto backdropSwitchCondition = BackdropSwitchCondition::None;
@@ -373,32 +492,29 @@ LevelData loadLevel(
     scrollMode != BackdropScrollMode::AutoHorizontal &&
     scrollMode != BackdropScrollMode::AutoVertical
   ) {
-    if (header.flagBitSet(0x40)) {
+    if (flagBitSet(0x40)) {
       backdropSwitchCondition = BackdropSwitchCondition::OnReactorDestruction;
     }
-    else if (header.flagBitSet(0x80)) {
+    else if (flagBitSet(0x80)) {
       backdropSwitchCondition = BackdropSwitchCondition::OnTeleportation;
     }
   }
 
-  auto backdropImage = resources.loadTiledFullscreenImage(header.backdrop);
-  std::optional<data::Image> alternativeBackdropImage;
-  if (header.flagBitSet(0x40) || header.flagBitSet(0x80)) {
-    alternativeBackdropImage = resources.loadTiledFullscreenImage(
-      backdropNameFromNumber(header.alternativeBackdropNumber));
+  for (auto& prefetcher : actorPrefetchers) {
+    // Re-throws any exception raised during decoding
+    prefetcher.get();
   }
-  auto actorDescriptions =
-      preProcessActorDescriptions(map, actors, chosenDifficulty);
+
   return LevelData{
-    std::move(tileSet.mTiles),
-    std::move(backdropImage),
-    std::move(alternativeBackdropImage),
+    tileSetImage.get(),
+    backdropImage.get(),
+    alternativeBackdropImage.get(),
     std::move(map),
-    std::move(actorDescriptions),
+    std::move(level.mActors),
     scrollMode,
     backdropSwitchCondition,
-    header.flagBitSet(0x20),
-    header.music
+    flagBitSet(0x20),
+    std::move(level.mMusicFile)
   };
 }
 
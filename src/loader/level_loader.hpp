@@ -30,6 +30,10 @@ namespace rigel::loader {
 class ResourceLoader;
 
 
+/** Name of the map file for the given (zero-based) episode and level */
+std::string levelFileName(int episode, int level);
+
+
 data::map::LevelData loadLevel(
   const std::string& mapName,
   const ResourceLoader& resources,
@@ -202,7 +202,7 @@ vector<data::MovieFrame> readAnimationFrames(
 }
 
 
-data::Movie loadMovie(const ByteBuffer& file) {
+data::Movie loadMovie(const ByteBufferView file) {
   LeStreamReader reader(file);
 
   const auto fileSize = reader.readU32();
@@ -22,7 +22,7 @@
 
 namespace rigel::loader {
 
-data::Movie loadMovie(const ByteBuffer& file);
+data::Movie loadMovie(ByteBufferView file);
 
 
 }
@@ -0,0 +1,459 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "msgpack.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+
+namespace rigel::loader {
+
+using namespace std;
+
+namespace {
+
+const auto OUT_OF_DATA_ERROR_MSG = "Not enough data in MessagePack buffer";
+
+
+[[noreturn]] void throwTypeMismatch(const char* pExpectedType) {
+  throw runtime_error(
+    string("Unexpected value in MessagePack data, expected ") +
+    pExpectedType);
+}
+
+
+template <typename T>
+T fromBits(const std::uint64_t bits) {
+  using BitsType = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+  const auto sizedBits = static_cast<BitsType>(bits);
+
+  T result;
+  std::memcpy(&result, &sizedBits, sizeof(T));
+  return result;
+}
+
+}
+
+
+void MsgPackWriter::writeNil() {
+  mBuffer.push_back(0xC0);
+}
+
+
+void MsgPackWriter::writeBool(const bool value) {
+  mBuffer.push_back(value ? 0xC3 : 0xC2);
+}
+
+
+void MsgPackWriter::writeInt(const std::int64_t value) {
+  if (value >= 0) {
+    const auto unsignedValue = static_cast<uint64_t>(value);
+
+    if (unsignedValue < 128) {
+      mBuffer.push_back(static_cast<uint8_t>(unsignedValue));
+    } else if (unsignedValue <= numeric_limits<uint8_t>::max()) {
+      mBuffer.push_back(0xCC);
+      writeBigEndian(unsignedValue, 1);
+    } else if (unsignedValue <= numeric_limits<uint16_t>::max()) {
+      mBuffer.push_back(0xCD);
+      writeBigEndian(unsignedValue, 2);
+    } else if (unsignedValue <= numeric_limits<uint32_t>::max()) {
+      mBuffer.push_back(0xCE);
+      writeBigEndian(unsignedValue, 4);
+    } else {
+      mBuffer.push_back(0xCF);
+      writeBigEndian(unsignedValue, 8);
+    }
+  } else {
+    const auto bits = static_cast<uint64_t>(value);
+
+    if (value >= -32) {
+      mBuffer.push_back(static_cast<uint8_t>(bits));
+    } else if (value >= numeric_limits<int8_t>::min()) {
+      mBuffer.push_back(0xD0);
+      writeBigEndian(bits, 1);
+    } else if (value >= numeric_limits<int16_t>::min()) {
+      mBuffer.push_back(0xD1);
+      writeBigEndian(bits, 2);
+    } else if (value >= numeric_limits<int32_t>::min()) {
+      mBuffer.push_back(0xD2);
+      writeBigEndian(bits, 4);
+    } else {
+      mBuffer.push_back(0xD3);
+      writeBigEndian(bits, 8);
+    }
+  }
+}
+
+
+void MsgPackWriter::writeString(const std::string_view value) {
+  const auto size = value.size();
+  if (size <= 31) {
+    mBuffer.push_back(static_cast<uint8_t>(0xA0 | size));
+  } else if (size <= numeric_limits<uint8_t>::max()) {
+    mBuffer.push_back(0xD9);
+    writeBigEndian(size, 1);
+  } else if (size <= numeric_limits<uint16_t>::max()) {
+    mBuffer.push_back(0xDA);
+    writeBigEndian(size, 2);
+  } else {
+    mBuffer.push_back(0xDB);
+    writeBigEndian(size, 4);
+  }
+
+  mBuffer.insert(mBuffer.end(), value.begin(), value.end());
+}
+
+
+void MsgPackWriter::beginArray(const std::size_t numElements) {
+  if (numElements <= 15) {
+    mBuffer.push_back(static_cast<uint8_t>(0x90 | numElements));
+  } else if (numElements <= numeric_limits<uint16_t>::max()) {
+    mBuffer.push_back(0xDC);
+    writeBigEndian(numElements, 2);
+  } else {
+    mBuffer.push_back(0xDD);
+    writeBigEndian(numElements, 4);
+  }
+}
+
+
+void MsgPackWriter::beginMap(const std::size_t numEntries) {
+  if (numEntries <= 15) {
+    mBuffer.push_back(static_cast<uint8_t>(0x80 | numEntries));
+  } else if (numEntries <= numeric_limits<uint16_t>::max()) {
+    mBuffer.push_back(0xDE);
+    writeBigEndian(numEntries, 2);
+  } else {
+    mBuffer.push_back(0xDF);
+    writeBigEndian(numEntries, 4);
+  }
+}
+
+
+void MsgPackWriter::writeBigEndian(
+  const std::uint64_t value,
+  const int numBytes
+) {
+  for (auto i = numBytes - 1; i >= 0; --i) {
+    mBuffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+
+MsgPackReader::MsgPackReader(const ByteBufferView data)
+  : mCurrentByteIter(data.begin())
+  , mDataEnd(data.end())
+{
+}
+
+
+MsgPackReader::Type MsgPackReader::peekType() const {
+  if (mCurrentByteIter == mDataEnd) {
+    throw runtime_error(OUT_OF_DATA_ERROR_MSG);
+  }
+
+  const auto marker = *mCurrentByteIter;
+  if (marker <= 0x7F || marker >= 0xE0) {
+    return Type::Integer;
+  }
+
+  if (marker <= 0x8F) {
+    return Type::Map;
+  }
+
+  if (marker <= 0x9F) {
+    return Type::Array;
+  }
+
+  if (marker <= 0xBF) {
+    return Type::String;
+  }
+
+  switch (marker) {
+    case 0xC0:
+      return Type::Nil;
+
+    case 0xC2:
+    case 0xC3:
+      return Type::Bool;
+
+    case 0xC4:
+    case 0xC5:
+    case 0xC6:
+      return Type::Binary;
+
+    case 0xC7:
+    case 0xC8:
+    case 0xC9:
+    case 0xD4:
+    case 0xD5:
+    case 0xD6:
+    case 0xD7:
+    case 0xD8:
+      return Type::Extension;
+
+    case 0xCA:
+    case 0xCB:
+      return Type::Float;
+
+    case 0xCC:
+    case 0xCD:
+    case 0xCE:
+    case 0xCF:
+    case 0xD0:
+    case 0xD1:
+    case 0xD2:
+    case 0xD3:
+      return Type::Integer;
+
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+      return Type::String;
+
+    case 0xDC:
+    case 0xDD:
+      return Type::Array;
+
+    case 0xDE:
+    case 0xDF:
+      return Type::Map;
+
+    default:
+      throw runtime_error("Invalid marker in MessagePack data");
+  }
+}
+
+
+void MsgPackReader::readNil() {
+  if (peekType() != Type::Nil) {
+    throwTypeMismatch("nil");
+  }
+
+  readByte();
+}
+
+
+bool MsgPackReader::readBool() {
+  if (peekType() != Type::Bool) {
+    throwTypeMismatch("boolean");
+  }
+
+  return readByte() == 0xC3;
+}
+
+
+std::int64_t MsgPackReader::readInt() {
+  const auto type = peekType();
+  if (type == Type::Bool) {
+    return readBool() ? 1 : 0;
+  }
+
+  if (type == Type::Float) {
+    return static_cast<int64_t>(readFloat(readByte()));
+  }
+
+  if (type != Type::Integer) {
+    throwTypeMismatch("number");
+  }
+
+  const auto marker = readByte();
+  if (marker <= 0x7F) {
+    return marker;
+  }
+
+  if (marker >= 0xE0) {
+    return static_cast<int8_t>(marker);
+  }
+
+  switch (marker) {
+    case 0xCC: return static_cast<int64_t>(readBigEndian(1));
+    case 0xCD: return static_cast<int64_t>(readBigEndian(2));
+    case 0xCE: return static_cast<int64_t>(readBigEndian(4));
+    case 0xCF: return static_cast<int64_t>(readBigEndian(8));
+    case 0xD0: return static_cast<int8_t>(readBigEndian(1));
+    case 0xD1: return static_cast<int16_t>(readBigEndian(2));
+    case 0xD2: return static_cast<int32_t>(readBigEndian(4));
+    default: return static_cast<int64_t>(readBigEndian(8));
+  }
+}
+
+
+std::string MsgPackReader::readString() {
+  if (peekType() != Type::String) {
+    throwTypeMismatch("string");
+  }
+
+  const auto marker = readByte();
+  const auto size = [&]() -> std::size_t {
+    switch (marker) {
+      case 0xD9: return readBigEndian(1);
+      case 0xDA: return readBigEndian(2);
+      case 0xDB: return readBigEndian(4);
+      default: return marker & 0x1F;
+    }
+  }();
+
+  if (static_cast<std::size_t>(mDataEnd - mCurrentByteIter) < size) {
+    throw runtime_error(OUT_OF_DATA_ERROR_MSG);
+  }
+
+  std::string result(mCurrentByteIter, mCurrentByteIter + size);
+  mCurrentByteIter += size;
+  return result;
+}
+
+
+std::size_t MsgPackReader::readArraySize() {
+  if (peekType() != Type::Array) {
+    throwTypeMismatch("array");
+  }
+
+  const auto marker = readByte();
+  switch (marker) {
+    case 0xDC: return readBigEndian(2);
+    case 0xDD: return readBigEndian(4);
+    default: return marker & 0x0F;
+  }
+}
+
+
+std::size_t MsgPackReader::readMapSize() {
+  if (peekType() != Type::Map) {
+    throwTypeMismatch("map");
+  }
+
+  const auto marker = readByte();
+  switch (marker) {
+    case 0xDE: return readBigEndian(2);
+    case 0xDF: return readBigEndian(4);
+    default: return marker & 0x0F;
+  }
+}
+
+
+void MsgPackReader::skipValue() {
+  // Instead of recursing into nested arrays and maps, we keep count of how
+  // many values are still left to skip
+  std::uint64_t numValuesToSkip = 1;
+
+  auto skipBytes = [this](const std::uint64_t count) {
+    if (static_cast<std::uint64_t>(mDataEnd - mCurrentByteIter) < count) {
+      throw runtime_error(OUT_OF_DATA_ERROR_MSG);
+    }
+
+    mCurrentByteIter += count;
+  };
+
+  while (numValuesToSkip > 0) {
+    --numValuesToSkip;
+
+    switch (peekType()) {
+      case Type::Array:
+        numValuesToSkip += readArraySize();
+        break;
+
+      case Type::Map:
+        numValuesToSkip += 2 * readMapSize();
+        break;
+
+      case Type::String:
+        {
+          const auto marker = readByte();
+          switch (marker) {
+            case 0xD9: skipBytes(readBigEndian(1)); break;
+            case 0xDA: skipBytes(readBigEndian(2)); break;
+            case 0xDB: skipBytes(readBigEndian(4)); break;
+            default: skipBytes(marker & 0x1F); break;
+          }
+        }
+        break;
+
+      case Type::Binary:
+        {
+          const auto marker = readByte();
+          skipBytes(readBigEndian(1 << (marker - 0xC4)));
+        }
+        break;
+
+      case Type::Extension:
+        {
+          const auto marker = readByte();
+          if (marker >= 0xD4) {
+            // fixext: type byte plus 1, 2, 4, 8 or 16 bytes of data
+            skipBytes(1 + (1 << (marker - 0xD4)));
+          } else {
+            const auto size = readBigEndian(1 << (marker - 0xC7));
+            skipBytes(1 + size);
+          }
+        }
+        break;
+
+      case Type::Nil:
+        readNil();
+        break;
+
+      case Type::Bool:
+      case Type::Integer:
+      case Type::Float:
+        readInt();
+        break;
+    }
+  }
+}
+
+
+bool MsgPackReader::hasData() const {
+  return mCurrentByteIter != mDataEnd;
+}
+
+
+std::uint8_t MsgPackReader::readByte() {
+  if (mCurrentByteIter == mDataEnd) {
+    throw runtime_error(OUT_OF_DATA_ERROR_MSG);
+  }
+
+  return *mCurrentByteIter++;
+}
+
+
+std::uint64_t MsgPackReader::readBigEndian(const int numBytes) {
+  if (mDataEnd - mCurrentByteIter < numBytes) {
+    throw runtime_error(OUT_OF_DATA_ERROR_MSG);
+  }
+
+  std::uint64_t result = 0;
+  for (auto i = 0; i < numBytes; ++i) {
+    result = (result << 8) | *mCurrentByteIter++;
+  }
+
+  return result;
+}
+
+
+double MsgPackReader::readFloat(const std::uint8_t marker) {
+  if (marker == 0xCA) {
+    return fromBits<float>(readBigEndian(4));
+  }
+
+  return fromBits<double>(readBigEndian(8));
+}
+
+}
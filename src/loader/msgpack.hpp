@@ -0,0 +1,118 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "loader/byte_buffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+
+namespace rigel::loader {
+
+/** Streaming MessagePack encoder
+ *
+ * Values are appended to the buffer as they are written, without building
+ * up a document in memory first. Arrays and maps are written by announcing
+ * the number of elements, followed by the elements themselves (for maps,
+ * alternating keys and values).
+ *
+ * Uses the same encodings as nlohmann::json::to_msgpack(), i.e. the
+ * smallest one that can represent a given value, so that the output is
+ * identical for the same sequence of values.
+ */
+class MsgPackWriter {
+public:
+  void writeNil();
+  void writeBool(bool value);
+  void writeInt(std::int64_t value);
+  void writeString(std::string_view value);
+  void beginArray(std::size_t numElements);
+  void beginMap(std::size_t numEntries);
+
+  ByteBuffer takeBuffer() {
+    return std::move(mBuffer);
+  }
+
+private:
+  void writeBigEndian(std::uint64_t value, int numBytes);
+
+  ByteBuffer mBuffer;
+};
+
+
+/** Streaming MessagePack decoder
+ *
+ * Counterpart to MsgPackWriter, reads values in the order they appear in
+ * the data. All readX() methods throw if the next value is not of the
+ * requested type, or if there is not enough data left.
+ */
+class MsgPackReader {
+public:
+  enum class Type {
+    Nil,
+    Bool,
+    Integer,
+    Float,
+    String,
+    Binary,
+    Array,
+    Map,
+    Extension
+  };
+
+  explicit MsgPackReader(ByteBufferView data);
+
+  Type peekType() const;
+
+  void readNil();
+  bool readBool();
+
+  /** Read an integer
+   *
+   * Like nlohmann::json's conversion to int, this also accepts floating
+   * point values (which are truncated) and booleans.
+   */
+  std::int64_t readInt();
+
+  std::string readString();
+
+  /** Read the header of an array, returns the number of elements */
+  std::size_t readArraySize();
+
+  /** Read the header of a map, returns the number of key/value pairs */
+  std::size_t readMapSize();
+
+  /** Skip the next value, including all nested values */
+  void skipValue();
+
+  bool hasData() const;
+
+private:
+  std::uint8_t readByte();
+  std::uint64_t readBigEndian(int numBytes);
+  double readFloat(std::uint8_t marker);
+
+  ByteBufferCIter mCurrentByteIter;
+  const ByteBufferCIter mDataEnd;
+};
+
+}
@@ -32,7 +32,7 @@ data::ImfCommand readCommand(LeStreamReader& reader) {
 
 }
 
-data::Song loadSong(const ByteBuffer& imfData) {
+data::Song loadSong(const ByteBufferView imfData) {
   data::Song song;
 
   LeStreamReader reader(imfData);
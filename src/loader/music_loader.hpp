@@ -22,6 +22,6 @@
 
 namespace rigel::loader {
 
-data::Song loadSong(const ByteBuffer& imfData);
+data::Song loadSong(ByteBufferView imfData);
 
 }
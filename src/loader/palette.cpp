@@ -16,6 +16,7 @@
 
 #include "palette.hpp"
 
+#include "base/key_hasher.hpp"
 #include "base/warnings.hpp"
 #include "loader/file_utils.hpp"
 
@@ -108,4 +109,17 @@ Palette256 load6bitPalette256(
   });
 }
 
+
+std::uint64_t hashPalette(const Palette16& palette) {
+  base::KeyHasher hasher;
+  for (const auto& color : palette) {
+    hasher.add(color.r);
+    hasher.add(color.g);
+    hasher.add(color.b);
+    hasher.add(color.a);
+  }
+
+  return hasher.value();
+}
+
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "data/image.hpp"
+#include "data/indexed_image.hpp"
 #include "loader/byte_buffer.hpp"
 
 #include <array>
@@ -25,7 +26,7 @@
 
 namespace rigel::loader {
 
-using Palette16 = std::array<data::Pixel, 16>;
+using Palette16 = data::Palette16;
 using Palette256 = std::array<data::Pixel, 256>;
 
 
@@ -38,13 +39,17 @@ Palette16 load6bitPalette16(ByteBufferCIter begin, ByteBufferCIter end);
 Palette256 load6bitPalette256(ByteBufferCIter begin, ByteBufferCIter end);
 
 
-inline Palette16 load6bitPalette16(const ByteBuffer& buffer) {
-  return load6bitPalette16(buffer.cbegin(), buffer.cend());
+/** Hash of the palette's colors, for use in cache keys */
+std::uint64_t hashPalette(const Palette16& palette);
+
+
+inline Palette16 load6bitPalette16(const ByteBufferView buffer) {
+  return load6bitPalette16(buffer.begin(), buffer.end());
 }
 
 
-inline Palette256 load6bitPalette256(const ByteBuffer& buffer) {
-  return load6bitPalette256(buffer.cbegin(), buffer.cend());
+inline Palette256 load6bitPalette256(const ByteBufferView buffer) {
+  return load6bitPalette256(buffer.begin(), buffer.end());
 }
 
 }
@@ -45,6 +45,26 @@ const auto FULL_SCREEN_IMAGE_DATA_SIZE =
   (GameTraits::viewPortWidthPx * GameTraits::viewPortHeightPx) /
   (GameTraits::pixelsPerEgaByte / GameTraits::egaPlanes);
 
+
+template <typename DecodeFunc>
+data::Image fetchImage(
+  const std::optional<ImageCache>& maybeCache,
+  const std::string& name,
+  const Palette16& palette,
+  DecodeFunc decode
+) {
+  if (!maybeCache) {
+    return decode();
+  }
+
+  auto images = maybeCache->fetch(makeImageCacheKey(name, palette), [&]() {
+    std::vector<data::Image> result;
+    result.push_back(decode());
+    return result;
+  });
+  return images.size() == 1 ? std::move(images.front()) : decode();
+}
+
 }
 
 // When loading assets, the game will first check if a file with an expected
@@ -65,12 +85,23 @@ const auto FULL_SCREEN_IMAGE_DATA_SIZE =
 const auto ASSET_REPLACEMENTS_PATH = "asset_replacements";
 
 
-ResourceLoader::ResourceLoader(const std::string& gamePath)
+ResourceLoader::ResourceLoader(
+  const std::string& gamePath,
+  const std::optional<std::string>& maybeImageCacheDirectory
+)
   : mFilePackage(gamePath + "NUKEM2.CMP")
-  , mActorImagePackage(mFilePackage, gamePath + "/" + ASSET_REPLACEMENTS_PATH)
+  , mActorImagePackage(
+      mFilePackage,
+      gamePath + "/" + ASSET_REPLACEMENTS_PATH,
+      maybeImageCacheDirectory)
   , mGamePath(gamePath)
   , mAdlibSoundsPackage(mFilePackage)
 {
+  if (maybeImageCacheDirectory) {
+    mMaybeImageCache.emplace(
+      *maybeImageCacheDirectory, mFilePackage.contentHash());
+    mMaybeLevelCache.emplace(*maybeImageCacheDirectory);
+  }
 }
 
 
@@ -85,10 +116,18 @@ data::Image ResourceLoader::loadTiledFullscreenImage(
   const std::string& name,
   const Palette16& overridePalette
 ) const {
-  return loadTiledImage(
-    mFilePackage.file(name),
+  return fetchImage(mMaybeImageCache, name, overridePalette, [&]() {
+    return loadTiledFullscreenIndexedImage(name).toRgba(overridePalette);
+  });
+}
+
+
+data::IndexedImage ResourceLoader::loadTiledFullscreenIndexedImage(
+  const std::string& name
+) const {
+  return loadTiledIndexedImage(
+    mFilePackage.fileView(name),
     data::GameTraits::viewPortWidthTiles,
-    overridePalette,
     data::TileImageType::Unmasked);
 }
 
@@ -96,15 +135,15 @@ data::Image ResourceLoader::loadTiledFullscreenImage(
 data::Image ResourceLoader::loadStandaloneFullscreenImage(
   const std::string& name
 ) const {
-  const auto& data = mFilePackage.file(name);
-  const auto paletteStart = data.cbegin() + FULL_SCREEN_IMAGE_DATA_SIZE;
+  const auto data = mFilePackage.fileView(name);
+  const auto paletteStart = data.begin() + FULL_SCREEN_IMAGE_DATA_SIZE;
   const auto palette = load6bitPalette16(
     paletteStart,
-    data.cend());
+    data.end());
 
   auto pixels = decodeSimplePlanarEgaBuffer(
-    data.cbegin(),
-    data.cbegin() + FULL_SCREEN_IMAGE_DATA_SIZE,
+    data.begin(),
+    data.begin() + FULL_SCREEN_IMAGE_DATA_SIZE,
     palette);
   return data::Image(
     std::move(pixels),
@@ -121,13 +160,13 @@ data::Image ResourceLoader::loadAntiPiracyImage() const {
   // then defines the pixel data in linear format.
   //
   // See http://www.shikadi.net/moddingwiki/Duke_Nukem_II_Full-screen_Images
-  const auto& data = mFilePackage.file(ANTI_PIRACY_SCREEN_FILENAME);
-  const auto iImageStart = cbegin(data) + 256*3;
-  const auto palette = load6bitPalette256(cbegin(data), iImageStart);
+  const auto data = mFilePackage.fileView(ANTI_PIRACY_SCREEN_FILENAME);
+  const auto iImageStart = data.begin() + 256*3;
+  const auto palette = load6bitPalette256(data.begin(), iImageStart);
 
   data::PixelBuffer pixels;
   pixels.reserve(GameTraits::viewPortWidthPx * GameTraits::viewPortHeightPx);
-  transform(iImageStart, cend(data), back_inserter(pixels),
+  transform(iImageStart, data.end(), back_inserter(pixels),
     [&palette](const auto indexedPixel) { return palette[indexedPixel]; });
   return data::Image(
     move(pixels),
@@ -139,20 +178,26 @@ data::Image ResourceLoader::loadAntiPiracyImage() const {
 loader::Palette16 ResourceLoader::loadPaletteFromFullScreenImage(
   const std::string& imageName
 ) const {
-  const auto& data = mFilePackage.file(imageName);
-  const auto paletteStart = data.cbegin() + FULL_SCREEN_IMAGE_DATA_SIZE;
-  return load6bitPalette16(paletteStart, data.cend());
+  const auto data = mFilePackage.fileView(imageName);
+  const auto paletteStart = data.begin() + FULL_SCREEN_IMAGE_DATA_SIZE;
+  return load6bitPalette16(paletteStart, data.end());
 }
 
 
 TileSet ResourceLoader::loadCZone(const std::string& name) const {
+  return {loadCZoneTiles(name), loadCZoneAttributes(name)};
+}
+
+
+data::map::TileAttributeDict ResourceLoader::loadCZoneAttributes(
+  const std::string& name
+) const {
   using namespace data;
   using namespace map;
-  using T = data::TileImageType;
 
-  const auto& data = mFilePackage.file(name);
+  const auto data = mFilePackage.fileView(name);
   LeStreamReader attributeReader(
-    data.cbegin(), data.cbegin() + GameTraits::CZone::attributeBytesTotal);
+    data.begin(), data.begin() + GameTraits::CZone::attributeBytesTotal);
 
   vector<uint16_t> attributes;
   attributes.reserve(GameTraits::CZone::numTilesTotal);
@@ -164,34 +209,49 @@ TileSet ResourceLoader::loadCZone(const std::string& name) const {
     }
   }
 
-  Image fullImage(
+  return TileAttributeDict{move(attributes)};
+}
+
+
+data::Image ResourceLoader::loadCZoneTiles(const std::string& name) const {
+  return fetchImage(mMaybeImageCache, name, INGAME_PALETTE, [&]() {
+    return loadCZoneIndexedTiles(name).toRgba(INGAME_PALETTE);
+  });
+}
+
+
+data::IndexedImage ResourceLoader::loadCZoneIndexedTiles(
+  const std::string& name
+) const {
+  using T = data::TileImageType;
+
+  const auto data = mFilePackage.fileView(name);
+
+  data::IndexedImage fullImage(
     tilesToPixels(GameTraits::CZone::tileSetImageWidth),
     tilesToPixels(GameTraits::CZone::tileSetImageHeight));
 
   const auto tilesBegin =
-    data.cbegin() + GameTraits::CZone::attributeBytesTotal;
-  const auto maskedTilesBegin =
-    tilesBegin + GameTraits::CZone::numSolidTiles*GameTraits::CZone::tileBytes;
+    data.begin() + GameTraits::CZone::attributeBytesTotal;
+  const auto maskedTilesBegin = tilesBegin +
+    GameTraits::CZone::numSolidTiles*GameTraits::CZone::tileBytes;
 
-  const auto solidTilesImage = loadTiledImage(
+  const auto solidTilesImage = loadTiledIndexedImage(
     tilesBegin,
     maskedTilesBegin,
     GameTraits::CZone::tileSetImageWidth,
-    INGAME_PALETTE,
     T::Unmasked);
-  const auto maskedTilesImage = loadTiledImage(
+  const auto maskedTilesImage = loadTiledIndexedImage(
     maskedTilesBegin,
-    data.cend(),
+    data.end(),
     GameTraits::CZone::tileSetImageWidth,
-    INGAME_PALETTE,
     T::Masked);
   fullImage.insertImage(0, 0, solidTilesImage);
   fullImage.insertImage(
     0,
     tilesToPixels(GameTraits::CZone::solidTilesImageHeight),
     maskedTilesImage);
-
-  return {move(fullImage), TileAttributeDict{move(attributes)}};
+  return fullImage;
 }
 
 
@@ -201,7 +261,7 @@ data::Movie ResourceLoader::loadMovie(const std::string& name) const {
 
 
 data::Song ResourceLoader::loadMusic(const std::string& name) const {
-  return loader::loadSong(mFilePackage.file(name));
+  return loader::loadSong(mFilePackage.fileView(name));
 }
 
 
@@ -233,7 +293,7 @@ data::AudioBuffer ResourceLoader::loadSound(const data::SoundId id) const {
 
 
 data::AudioBuffer ResourceLoader::loadSound(const std::string& name) const {
-  return loader::decodeVoc(mFilePackage.file(name));
+  return loader::decodeVoc(mFilePackage.fileView(name));
 }
 
 
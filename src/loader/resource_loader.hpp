@@ -18,6 +18,7 @@
 
 #include "data/audio_buffer.hpp"
 #include "data/image.hpp"
+#include "data/indexed_image.hpp"
 #include "data/movie.hpp"
 #include "data/song.hpp"
 #include "data/sound_ids.hpp"
@@ -26,8 +27,11 @@
 #include "loader/audio_package.hpp"
 #include "loader/duke_script_loader.hpp"
 #include "loader/cmp_file_package.hpp"
+#include "loader/image_cache.hpp"
+#include "loader/level_cache.hpp"
 #include "loader/palette.hpp"
 
+#include <optional>
 #include <string>
 
 
@@ -41,20 +45,55 @@ struct TileSet {
 
 class ResourceLoader {
 public:
-  explicit ResourceLoader(const std::string& gamePath);
+  /** Open the game data in gamePath
+   *
+   * If a cache directory is given, decoded tile sets, backdrops and actor
+   * frames are stored there, so that later runs can skip decoding them.
+   * The same goes for preprocessed levels, see LevelCache.
+   */
+  explicit ResourceLoader(
+    const std::string& gamePath,
+    const std::optional<std::string>& maybeImageCacheDirectory = std::nullopt);
 
   data::Image loadTiledFullscreenImage(const std::string& name) const;
   data::Image loadTiledFullscreenImage(
     const std::string& name,
     const Palette16& overridePalette) const;
 
+  /** Load a tiled fullscreen image without applying a palette
+   *
+   * The result can be turned into RGBA using any palette later on, without
+   * decoding the image again. Doesn't use the image cache, which only holds
+   * RGBA images.
+   */
+  data::IndexedImage loadTiledFullscreenIndexedImage(
+    const std::string& name) const;
+
   data::Image loadStandaloneFullscreenImage(const std::string& name) const;
+
+  /** Read only the palette stored in a tiled fullscreen image
+   *
+   * Reads the 48 palette bytes straight from the file package, without
+   * copying or decoding the image. Cheap enough to call on every image
+   * switch, no caching needed.
+   */
   loader::Palette16 loadPaletteFromFullScreenImage(
     const std::string& imageName) const;
 
   data::Image loadAntiPiracyImage() const;
 
   TileSet loadCZone(const std::string& name) const;
+
+  /** Load only the tile attributes of a CZone file, which is cheap */
+  data::map::TileAttributeDict loadCZoneAttributes(
+    const std::string& name) const;
+
+  /** Load only the tile set image of a CZone file */
+  data::Image loadCZoneTiles(const std::string& name) const;
+
+  /** Load only the tile set image of a CZone file, as palette indices */
+  data::IndexedImage loadCZoneIndexedTiles(const std::string& name) const;
+
   data::Movie loadMovie(const std::string& name) const;
   data::Song loadMusic(const std::string& name) const;
 
@@ -64,12 +103,19 @@ public:
 
   ScriptBundle loadScriptBundle(const std::string& fileName) const;
 
+  /** The level cache, or nullptr if running without a cache directory */
+  const LevelCache* levelCache() const {
+    return mMaybeLevelCache ? &*mMaybeLevelCache : nullptr;
+  }
+
   loader::CMPFilePackage mFilePackage;
   loader::ActorImagePackage mActorImagePackage;
 
 private:
   std::string mGamePath;
   loader::AudioPackage mAdlibSoundsPackage;
+  std::optional<ImageCache> mMaybeImageCache;
+  std::optional<LevelCache> mMaybeLevelCache;
 };
 
 }
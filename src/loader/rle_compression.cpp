@@ -0,0 +1,115 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "rle_compression.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace rigel::loader {
+
+namespace {
+
+const char* TRUNCATED_DATA_ERROR_MSG = "RLE data ends prematurely";
+const char* OUTPUT_TOO_SMALL_ERROR_MSG = "Not enough room for RLE output";
+
+
+/** Number of input bytes following the given marker */
+std::size_t payloadSize(const std::int8_t marker) {
+  return marker > 0 ? 1u : static_cast<std::size_t>(-marker);
+}
+
+
+/** Number of output bytes produced by the given marker */
+std::size_t runLength(const std::int8_t marker) {
+  return static_cast<std::size_t>(marker > 0 ? marker : -marker);
+}
+
+
+template <typename Callable>
+void forEachRleWord(const ByteBufferView data, Callable callback) {
+  auto iCurrent = data.begin();
+  const auto iEnd = data.end();
+
+  for (;;) {
+    if (iCurrent == iEnd) {
+      throw std::runtime_error(TRUNCATED_DATA_ERROR_MSG);
+    }
+
+    const auto marker = static_cast<std::int8_t>(*iCurrent++);
+    if (marker == 0) {
+      break;
+    }
+
+    const auto numPayloadBytes = payloadSize(marker);
+    if (static_cast<std::size_t>(iEnd - iCurrent) < numPayloadBytes) {
+      throw std::runtime_error(TRUNCATED_DATA_ERROR_MSG);
+    }
+
+    // Payload is never empty, so dereferencing is fine here
+    callback(marker, &*iCurrent);
+    iCurrent += numPayloadBytes;
+  }
+}
+
+}
+
+
+std::size_t decompressedRleSize(const ByteBufferView data) {
+  auto size = std::size_t{0};
+  forEachRleWord(data, [&](const std::int8_t marker, const std::uint8_t*) {
+    size += runLength(marker);
+  });
+
+  return size;
+}
+
+
+std::size_t decompressRle(
+  const ByteBufferView data,
+  std::uint8_t* const pOutput,
+  const std::size_t outputSize
+) {
+  auto bytesWritten = std::size_t{0};
+  forEachRleWord(data,
+    [&](const std::int8_t marker, const std::uint8_t* pPayload) {
+      const auto length = runLength(marker);
+      if (outputSize - bytesWritten < length) {
+        throw std::runtime_error(OUTPUT_TOO_SMALL_ERROR_MSG);
+      }
+
+      if (marker > 0) {
+        std::memset(pOutput + bytesWritten, *pPayload, length);
+      } else {
+        std::memcpy(pOutput + bytesWritten, pPayload, length);
+      }
+
+      bytesWritten += length;
+    });
+
+  return bytesWritten;
+}
+
+
+ByteBuffer decompressRle(const ByteBufferView data) {
+  ByteBuffer result(decompressedRleSize(data));
+  decompressRle(data, result.data(), result.size());
+  return result;
+}
+
+}
@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include "loader/byte_buffer.hpp"
 #include "loader/file_utils.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 
 
@@ -75,4 +78,33 @@ void decompressRle(
 }
 
 
+/** Number of bytes produced by decompressing data
+ *
+ * Data is assumed to be terminated by a 0 marker, like for the callback-based
+ * decompressRle() above. Throws if data ends before the terminating marker,
+ * or in the middle of an RLE word.
+ */
+std::size_t decompressedRleSize(ByteBufferView data);
+
+
+/** Decompress RLE data with terminating 0 marker into preallocated memory
+ *
+ * Writes whole runs at once instead of going through a callback for each byte.
+ * Throws if data is truncated, or if the output doesn't have enough room for
+ * the decompressed data. Returns the number of bytes written.
+ */
+std::size_t decompressRle(
+  ByteBufferView data,
+  std::uint8_t* pOutput,
+  std::size_t outputSize);
+
+
+/** Decompress RLE data with terminating 0 marker into a new buffer
+ *
+ * Determines the size of the output up front, so that only a single
+ * allocation is needed.
+ */
+ByteBuffer decompressRle(ByteBufferView data);
+
+
 }
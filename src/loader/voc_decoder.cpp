@@ -20,10 +20,11 @@
 #include "loader/file_utils.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
-#include <iterator>
 #include <optional>
+#include <stdexcept>
 
 
 /* Decoder for the Creative Voice File (VOC) format
@@ -104,37 +105,6 @@ int determineSampleRate(const std::uint8_t frequencyDivisor) {
 }
 
 
-std::size_t calculateUncompressedSampleCount(
-  const CodecType codec,
-  const std::size_t encodedSize
-) {
-  switch (codec) {
-    case CodecType::Unsigned8BitPcm:
-    case CodecType::Signed16BitPcm:
-      return encodedSize;
-
-    // For the three ADPCM variants, each source byte decodes to N samples.
-    // In addition, the first byte is a single Unsigned 8-bit sample.
-    case CodecType::Adpcm4Bits:
-      return 2 * (encodedSize-1) + 1;
-
-    case CodecType::Adpcm2_6Bits:
-      return 3 * (encodedSize-1) + 1;
-
-    case CodecType::Adpcm2Bits:
-      return 4  * (encodedSize-1) + 1;
-
-    default:
-      break;
-  }
-
-  // We should not end up here, since unsupported codecs will throw an
-  // exception earlier on.
-  assert(false);
-  return 0;
-}
-
-
 bool readAndValidateVocHeader(LeStreamReader& reader) {
   const auto signatureText = readFixedSizeString(reader, 19);
   if (signatureText != "Creative Voice File") {
@@ -167,6 +137,92 @@ std::int16_t unsigned8BitSampleToSigned16Bit(const std::uint8_t sample) {
 }
 
 
+/** Collects decoded samples and passes them on to a sink in chunks */
+class ChunkedOutput {
+public:
+  /** Output iterator adapter, for use with the decoding functions below */
+  class Iterator {
+  public:
+    explicit Iterator(ChunkedOutput* pOutput)
+      : mpOutput(pOutput)
+    {
+    }
+
+    Iterator& operator*() {
+      return *this;
+    }
+
+    Iterator& operator++() {
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      return *this;
+    }
+
+    Iterator& operator=(const std::int16_t sample) {
+      mpOutput->push(sample);
+      return *this;
+    }
+
+  private:
+    ChunkedOutput* mpOutput;
+  };
+
+  explicit ChunkedOutput(const VocChunkSink& sink)
+    : mSink(sink)
+  {
+  }
+
+  void setSampleRate(const int sampleRate) {
+    mSampleRate = sampleRate;
+  }
+
+  Iterator iterator() {
+    return Iterator{this};
+  }
+
+  void push(const std::int16_t sample) {
+    mBuffer[mCount++] = sample;
+    if (mCount == mBuffer.size()) {
+      flush();
+    }
+  }
+
+  void pushSilence(std::size_t count) {
+    while (count > 0) {
+      const auto countForIteration = std::min(count, mBuffer.size() - mCount);
+      std::fill_n(mBuffer.begin() + mCount, countForIteration, data::Sample{0});
+      mCount += countForIteration;
+      count -= countForIteration;
+
+      if (mCount == mBuffer.size()) {
+        flush();
+      }
+    }
+  }
+
+  void flush() {
+    if (mCount > 0) {
+      mSink(mSampleRate, mBuffer.data(), mCount);
+      mTotalCount += mCount;
+      mCount = 0;
+    }
+  }
+
+  std::size_t totalCount() const {
+    return mTotalCount + mCount;
+  }
+
+private:
+  const VocChunkSink& mSink;
+  std::array<data::Sample, 1024> mBuffer;
+  std::size_t mCount = 0;
+  std::size_t mTotalCount = 0;
+  int mSampleRate = 0;
+};
+
+
 template<AdpcmType codec>
 class AdpcmDecoderHelper {
 public:
@@ -285,13 +341,13 @@ void decodeAudio(
 }
 
 
-data::AudioBuffer decodeVoc(const ByteBuffer& data) {
-  LeStreamReader reader(data);
+void decodeVocStreaming(const ByteBufferView data, const VocChunkSink& sink) {
+  LeStreamReader reader(data.begin(), data.end());
   if (!readAndValidateVocHeader(reader)) {
     throw std::invalid_argument("Invalid VOC file header");
   }
 
-  std::vector<data::Sample> decodedSamples;
+  ChunkedOutput output(sink);
   std::optional<int> sampleRate;
 
   while (reader.hasData()) {
@@ -316,18 +372,16 @@ data::AudioBuffer decodeVoc(const ByteBuffer& data) {
               "Multiple sample rates in single VOC file aren't supported");
           } else if (!sampleRate) {
             sampleRate = newSampleRate;
+            output.setSampleRate(newSampleRate);
           }
 
           const auto codecType = determineCodecType(chunkReader.readU8());
           const auto encodedAudioSize = chunkSize - sizeof(std::uint8_t) * 2;
-          decodedSamples.reserve(
-            decodedSamples.size() +
-            calculateUncompressedSampleCount(codecType, encodedAudioSize));
           decodeAudio(
             chunkReader,
             encodedAudioSize,
             codecType,
-            std::back_inserter(decodedSamples));
+            output.iterator());
         }
         break;
 
@@ -344,9 +398,10 @@ data::AudioBuffer decodeVoc(const ByteBuffer& data) {
               numSilentSamples * factor);
           } else if (!sampleRate) {
             sampleRate = silenceSampleRate;
+            output.setSampleRate(silenceSampleRate);
           }
 
-          decodedSamples.resize(decodedSamples.size() + numSilentSamples, 0);
+          output.pushSilence(numSilentSamples);
         }
         break;
 
@@ -363,11 +418,25 @@ data::AudioBuffer decodeVoc(const ByteBuffer& data) {
     reader.skipBytes(chunkSize);
   }
 
-  if (!sampleRate || decodedSamples.empty()) {
+  if (!sampleRate || output.totalCount() == 0) {
     throw std::invalid_argument("VOC file didn't contain data");
   }
 
-  return {*sampleRate, std::move(decodedSamples)};
+  output.flush();
+}
+
+
+data::AudioBuffer decodeVoc(const ByteBufferView data) {
+  data::AudioBuffer result{0, {}};
+
+  decodeVocStreaming(
+    data,
+    [&](const int sampleRate, const data::Sample* pSamples, std::size_t count) {
+      result.mSampleRate = sampleRate;
+      result.mSamples.insert(result.mSamples.end(), pSamples, pSamples + count);
+    });
+
+  return result;
 }
 
 
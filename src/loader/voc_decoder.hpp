@@ -19,9 +19,28 @@
 #include "data/audio_buffer.hpp"
 #include "loader/byte_buffer.hpp"
 
+#include <cstddef>
+#include <functional>
+
 
 namespace rigel::loader {
 
-data::AudioBuffer decodeVoc(const ByteBuffer& data);
+/** Receives decoded audio from decodeVocStreaming()
+ *
+ * The sample rate is the same for all chunks of a file.
+ */
+using VocChunkSink = std::function<
+  void(int sampleRate, const data::Sample* pSamples, std::size_t count)>;
+
+
+/** Decode VOC file, handing out the result in chunks of limited size
+ *
+ * Decoding happens into a small fixed-size buffer, which is passed to sink
+ * whenever it's full, and once more at the end. No memory is allocated.
+ */
+void decodeVocStreaming(ByteBufferView data, const VocChunkSink& sink);
+
+
+data::AudioBuffer decodeVoc(ByteBufferView data);
 
 }
@@ -14,7 +14,12 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "base/tunables.hpp"
 #include "base/warnings.hpp"
+#include "common/game_mode.hpp"
+#include "data/game_session_data.hpp"
+#include "loader/level_loader.hpp"
+#include "loader/resource_loader.hpp"
 #include "renderer/opengl.hpp"
 #include "sdl_utils/error.hpp"
 #include "sdl_utils/ptr.hpp"
@@ -29,9 +34,18 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 
 using namespace rigel;
@@ -55,6 +69,24 @@ namespace {
 const auto DEFAULT_RESOLUTION_X = 1920;
 const auto DEFAULT_RESOLUTION_Y = 1080;
 
+// Enough to cover a 32:9 display at the original game's vertical resolution
+const auto MAX_VIEW_WIDTH_TILES = 96;
+const auto MAX_GAME_SPEED_MULTIPLIER = 16;
+
+const char* const MOVIE_FILES[] = {
+  "NUKEM2.F1", "NUKEM2.F2", "NUKEM2.F3", "NUKEM2.F4", "NUKEM2.F5"};
+
+const char* const SCRIPT_FILES[] = {"TEXT.MNI", "OPTIONS.MNI", "ORDERTXT.MNI"};
+
+// Songs which aren't referenced by any level
+const char* const NON_LEVEL_SONGS[] = {
+  "CALM.IMF",
+  "DUKEIIA.IMF",
+  "FANFAREA.IMF",
+  "NEVRENDA.IMF",
+  "OPNGATEA.IMF",
+  "RANGEA.IMF"};
+
 
 template <typename Callback>
 class CallOnDestruction {
@@ -96,7 +128,7 @@ SDL_Window* createWindow() {
 #else
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
 #endif
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
@@ -130,6 +162,216 @@ void showBanner() {
 }
 
 
+struct AssetCheck {
+  string mName;
+
+  /** Loads the asset, returns the size of the decoded data in bytes */
+  function<size_t()> mLoad;
+};
+
+
+struct AssetCheckResult {
+  double mDecodeTime = 0.0;
+  size_t mDecodedSize = 0;
+  optional<string> mError;
+};
+
+
+size_t imageBytes(const data::Image& image) {
+  return image.pixelData().size() * sizeof(data::Pixel);
+}
+
+
+size_t audioBytes(const data::AudioBuffer& buffer) {
+  return buffer.mSamples.size() * sizeof(data::Sample);
+}
+
+
+/** Run all checks, spread across as many threads as there are cores
+ *
+ * Results are in the same order as the checks.
+ */
+vector<AssetCheckResult> runAssetChecks(const vector<AssetCheck>& checks) {
+  vector<AssetCheckResult> results(checks.size());
+  atomic<size_t> nextIndex{0};
+
+  auto work = [&]() {
+    for (
+      auto index = nextIndex++;
+      index < checks.size();
+      index = nextIndex++
+    ) {
+      auto& result = results[index];
+
+      const auto startTime = chrono::steady_clock::now();
+      try {
+        result.mDecodedSize = checks[index].mLoad();
+      } catch (const std::exception& ex) {
+        result.mError = ex.what();
+      } catch (...) {
+        result.mError = "Unknown error";
+      }
+
+      result.mDecodeTime = chrono::duration<double>(
+        chrono::steady_clock::now() - startTime).count();
+    }
+  };
+
+  const auto numThreads = clamp(
+    static_cast<size_t>(thread::hardware_concurrency()),
+    size_t{1},
+    max(checks.size(), size_t{1}));
+
+  vector<future<void>> workers;
+  for (auto i = size_t{0}; i < numThreads; ++i) {
+    workers.push_back(async(launch::async, work));
+  }
+
+  for (auto& worker : workers) {
+    worker.get();
+  }
+
+  return results;
+}
+
+
+/** Print results, returns the number of failed checks */
+int reportAssetChecks(
+  const vector<AssetCheck>& checks,
+  const vector<AssetCheckResult>& results
+) {
+  auto numFailures = 0;
+
+  for (auto i = size_t{0}; i < checks.size(); ++i) {
+    const auto& result = results[i];
+
+    cout
+      << (result.mError ? "FAIL  " : "OK    ")
+      << left << setw(24) << checks[i].mName << right
+      << fixed << setprecision(2) << setw(9) << result.mDecodeTime * 1000.0
+      << " ms";
+
+    if (result.mError) {
+      cout << "  " << *result.mError << '\n';
+      ++numFailures;
+    } else {
+      cout << setw(12) << result.mDecodedSize << " bytes\n";
+    }
+  }
+
+  return numFailures;
+}
+
+
+/** Load all of the game's assets, report problems and timings
+ *
+ * Meant for checking a set of game data files (e.g. a mod) without having
+ * to play through the whole game, and as a benchmark for asset loading.
+ * Returns the process exit code.
+ *
+ * Levels are loaded first. That covers their tile sets and backdrops, and
+ * tells us which songs they use. Everything else is checked afterwards.
+ */
+int validateAssets(const string& gamePath) {
+  const auto startTime = chrono::steady_clock::now();
+
+  loader::ResourceLoader resources(gamePath);
+
+  vector<AssetCheck> levelChecks;
+  vector<string> songs(begin(NON_LEVEL_SONGS), end(NON_LEVEL_SONGS));
+  vector<string> levelSongs;
+
+  for (auto episode = 0; episode < data::NUM_EPISODES; ++episode) {
+    for (auto level = 0; level < data::NUM_LEVELS_PER_EPISODE; ++level) {
+      const auto mapName = loader::levelFileName(episode, level);
+      if (resources.mFilePackage.hasFile(mapName)) {
+        levelChecks.push_back(AssetCheck{mapName, {}});
+      }
+    }
+  }
+
+  // Each check writes to its own slot, so no synchronization is needed
+  levelSongs.resize(levelChecks.size());
+  for (auto i = size_t{0}; i < levelChecks.size(); ++i) {
+    levelChecks[i].mLoad = [&, i, mapName = levelChecks[i].mName]() {
+      const auto levelData =
+        loader::loadLevel(mapName, resources, data::Difficulty::Hard);
+      levelSongs[i] = levelData.mMusicFile;
+
+      return
+        imageBytes(levelData.mTileSetImage) +
+        imageBytes(levelData.mBackdropImage) +
+        (levelData.mSecondaryBackdropImage
+          ? imageBytes(*levelData.mSecondaryBackdropImage)
+          : 0);
+    };
+  }
+
+  const auto levelResults = runAssetChecks(levelChecks);
+
+  for (const auto& song : levelSongs) {
+    const auto isNew = find(songs.begin(), songs.end(), song) == songs.end();
+    if (!song.empty() && isNew) {
+      songs.push_back(song);
+    }
+  }
+
+  vector<AssetCheck> checks;
+
+  for (const auto& song : songs) {
+    checks.push_back(AssetCheck{song, [&resources, song]() {
+      return resources.loadMusic(song).size() * sizeof(data::ImfCommand);
+    }});
+  }
+
+  for (const auto pMovieFile : MOVIE_FILES) {
+    checks.push_back(AssetCheck{pMovieFile, [&resources, pMovieFile]() {
+      const auto movie = resources.loadMovie(pMovieFile);
+
+      auto size = imageBytes(movie.mBaseImage);
+      for (const auto& frame : movie.mFrames) {
+        size += imageBytes(frame.mReplacementImage);
+      }
+
+      return size;
+    }});
+  }
+
+  for (const auto pScriptFile : SCRIPT_FILES) {
+    checks.push_back(AssetCheck{pScriptFile, [&resources, pScriptFile]() {
+      auto size = size_t{0};
+      const auto bundle = resources.loadScriptBundle(pScriptFile);
+      for (const auto& [name, script] : bundle) {
+        size += script.size() * sizeof(data::script::Action);
+      }
+
+      return size;
+    }});
+  }
+
+  data::forEachSoundId([&](const data::SoundId id) {
+    const auto name = "Sound " + to_string(static_cast<int>(id));
+    checks.push_back(AssetCheck{name, [&resources, id]() {
+      return audioBytes(resources.loadSound(id));
+    }});
+  });
+
+  const auto results = runAssetChecks(checks);
+
+  const auto numFailures =
+    reportAssetChecks(levelChecks, levelResults) +
+    reportAssetChecks(checks, results);
+
+  const auto elapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - startTime).count();
+  cout
+    << '\n' << levelChecks.size() + checks.size() << " assets checked, "
+    << numFailures << " failed, in " << elapsed << " s\n";
+
+  return numFailures == 0 ? 0 : 1;
+}
+
+
 void initAndRunGame(const StartupOptions& config) {
   sdl_utils::check(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO));
   auto sdlGuard = defer([]() { SDL_Quit(); });
@@ -173,10 +415,111 @@ int main(int argc, char** argv) {
     ("no-music",
      po::bool_switch(&disableMusic),
      "Disable music playback")
+    ("dump-render-stats",
+     po::bool_switch(&config.mDumpRenderStats),
+     "Periodically print renderer statistics to the console")
+    ("native-composition",
+     po::bool_switch(&config.mNativeResolutionComposition),
+     "Draw everything at the game's native resolution, and upscale the\n"
+     "result to the window size once per frame")
+    ("measure-input-latency",
+     po::bool_switch(&config.mMeasureInputLatency),
+     "Print the time from each key press to the first presented frame\n"
+     "showing its effect in-game")
     ("player-pos",
      po::value<string>(),
      "Specify position to place the player at (to be used in conjunction with\n"
      "'play-level')")
+    ("record-replay",
+     po::value<string>(),
+     "Record a replay of the first level played and write it to the given\n"
+     "file (to be used in conjunction with 'play-level')")
+    ("replay",
+     po::value<string>(),
+     "Play back the given replay file, then quit")
+    ("trace-file",
+     po::value<string>(),
+     "Record a timeline of main loop, game logic and audio activity, and\n"
+     "write it to the given file in Chrome trace format on exit. F9 writes\n"
+     "the trace at any time (to frame_trace.json if this option isn't\n"
+     "given, in which case the first press starts recording).")
+    ("capture-frames",
+     po::value<string>(),
+     "Write every presented frame to the given file as raw RGBA data. F11\n"
+     "toggles frame capture at any time (to frame_capture.raw if this\n"
+     "option isn't given), F10 saves a screenshot.")
+    ("metrics-log",
+     po::value<string>(),
+     "Append per-second performance statistics (frame and render times,\n"
+     "draw calls, audio callback times, allocations, memory usage) to the\n"
+     "given CSV file. The file is rotated once it reaches 16 MiB.")
+    ("flight-recorder",
+     po::value<string>(),
+     "Keep recording a timeline like --trace-file does, and write the last\n"
+     "few seconds of it to <arg>_<n>.json whenever a frame or logic tick\n"
+     "exceeds its budget. Budgets are set via the slow-frame-budget-ms and\n"
+     "slow-tick-budget-ms tunables.")
+    ("audio-sample-rate",
+     po::value<int>(&config.mAudioSettings.mSampleRate),
+     "Sample rate to use for audio output, in Hz (default: 44100)")
+    ("audio-buffer-size",
+     po::value<int>(&config.mAudioSettings.mBufferSize),
+     "Size of the audio buffer in samples, must be a power of 2. Smaller\n"
+     "values reduce latency, but might cause crackling on slow machines\n"
+     "(default: 512)")
+    ("low-cpu-music",
+     po::bool_switch(&config.mAudioSettings.mLowCpuMusicEmulation),
+     "Emulate the AdLib music at half the output sample rate and\n"
+     "interpolate in between. Roughly halves the CPU time needed for music,\n"
+     "at the cost of some accuracy. Pre-rendered music (see --audio-cache)\n"
+     "is not affected.")
+    ("audio-device",
+     po::value<string>(),
+     "Name of the audio output device to use (default: system default)")
+    ("audio-cache",
+     po::value<string>(),
+     "Store pre-rendered music in the given directory. Avoids the cost of\n"
+     "AdLib emulation during music playback.")
+    ("asset-cache",
+     po::value<string>(),
+     "Store decoded tile sets, backdrops and actor images in the given\n"
+     "directory, to make loading faster on subsequent runs")
+    ("vsync",
+     po::value<string>(),
+     "Vsync mode: 'on', 'off', or 'adaptive'. Adaptive vsync doesn't wait\n"
+     "for the display when a frame took too long, and falls back to 'on'\n"
+     "if not supported by the driver (default: on)")
+    ("target-fps",
+     po::value<int>(),
+     "Limit the frame rate to the given value. Mostly useful with vsync\n"
+     "disabled or on variable refresh rate displays, to avoid rendering\n"
+     "more frames than needed")
+    ("view-width",
+     po::value<int>(),
+     "Width of the in-game view in tiles, for wide-screen displays. Shows\n"
+     "more of the map than the original game's 32 tiles. Can't be combined\n"
+     "with recording or playing back replays")
+    ("memory-budget",
+     po::value<int>(),
+     "Memory budget for assets in MiB (CPU and GPU combined). When it's\n"
+     "exceeded, cached data which can be recreated is released early. F12\n"
+     "shows current usage, a report is printed on exit.")
+    ("game-speed",
+     po::value<string>(),
+     "Run in-game logic faster than normal, by the given factor (1 to 16),\n"
+     "or as fast as possible with 'max'. Useful for testing and\n"
+     "benchmarking. T cycles through speeds while in-game.")
+    ("unthrottled",
+     po::bool_switch(&config.mUnthrottledReplay),
+     "Play back replay as fast as possible instead of in real time")
+    ("set",
+     po::value<vector<string>>(),
+     "Change a tunable, given as name=value. Can be given multiple times.\n"
+     "Tunables switch performance features on and off for comparing them,\n"
+     "F4 shows all of them and allows changing them while running.")
+    ("validate-assets",
+     "Load all levels, movies, songs, sounds and scripts, report decoding\n"
+     "time and any errors, then exit. Useful for checking mods.")
     ("game-path",
      po::value<string>(&config.mGamePath),
      "Path to original game's installation. Can also be given as positional "
@@ -247,10 +590,146 @@ int main(int argc, char** argv) {
       config.mPlayerPosition = position;
     }
 
+    if (options.count("record-replay")) {
+      if (!options.count("play-level")) {
+        throw invalid_argument(
+          "This option requires also using the play-level option");
+      }
+
+      config.mReplayRecordingFile = options["record-replay"].as<string>();
+    }
+
+    if (options.count("trace-file")) {
+      config.mTraceFile = options["trace-file"].as<string>();
+    }
+
+    if (options.count("capture-frames")) {
+      config.mFrameCaptureFile = options["capture-frames"].as<string>();
+    }
+
+    if (options.count("metrics-log")) {
+      config.mMetricsLogFile = options["metrics-log"].as<string>();
+    }
+
+    if (options.count("flight-recorder")) {
+      config.mFlightRecorderPrefix = options["flight-recorder"].as<string>();
+    }
+
+    {
+      const auto bufferSize = config.mAudioSettings.mBufferSize;
+      const auto isPowerOfTwo = (bufferSize & (bufferSize - 1)) == 0;
+      if (bufferSize < 64 || bufferSize > 8192 || !isPowerOfTwo) {
+        throw invalid_argument(
+          "Audio buffer size must be a power of 2 between 64 and 8192");
+      }
+
+      const auto sampleRate = config.mAudioSettings.mSampleRate;
+      if (sampleRate < 8000 || sampleRate > 192000) {
+        throw invalid_argument(
+          "Audio sample rate must be between 8000 and 192000 Hz");
+      }
+    }
+
+    if (options.count("audio-device")) {
+      config.mAudioSettings.mDeviceName = options["audio-device"].as<string>();
+    }
+
+    if (options.count("audio-cache")) {
+      config.mAudioSettings.mCacheDirectory =
+        options["audio-cache"].as<string>();
+    }
+
+    if (options.count("asset-cache")) {
+      config.mAssetCacheDirectory = options["asset-cache"].as<string>();
+    }
+
+    if (options.count("vsync")) {
+      const auto vsyncMode = options["vsync"].as<string>();
+      if (vsyncMode == "on") {
+        config.mVsyncMode = VsyncMode::On;
+      } else if (vsyncMode == "off") {
+        config.mVsyncMode = VsyncMode::Off;
+      } else if (vsyncMode == "adaptive") {
+        config.mVsyncMode = VsyncMode::Adaptive;
+      } else {
+        throw invalid_argument(string("Invalid vsync mode: ") + vsyncMode);
+      }
+    }
+
+    if (options.count("target-fps")) {
+      const auto targetFps = options["target-fps"].as<int>();
+      if (targetFps < 1 || targetFps > 1000) {
+        throw invalid_argument("Target FPS must be between 1 and 1000");
+      }
+
+      config.mTargetFrameRate = targetFps;
+    }
+
+    if (options.count("memory-budget")) {
+      const auto budgetMb = options["memory-budget"].as<int>();
+      if (budgetMb < 1) {
+        throw invalid_argument("Memory budget must be at least 1 MiB");
+      }
+
+      config.mMemoryBudget = std::int64_t{budgetMb} * 1024 * 1024;
+    }
+
+    if (options.count("game-speed")) {
+      const auto gameSpeed = options["game-speed"].as<string>();
+      if (gameSpeed == "max") {
+        config.mGameSpeedMultiplier = GameMode::UNCAPPED_GAME_SPEED;
+      } else {
+        const auto multiplier = std::stoi(gameSpeed);
+        if (multiplier < 1 || multiplier > MAX_GAME_SPEED_MULTIPLIER) {
+          throw invalid_argument(
+            "Game speed must be between 1 and " +
+            to_string(MAX_GAME_SPEED_MULTIPLIER) + ", or 'max'");
+        }
+
+        config.mGameSpeedMultiplier = multiplier;
+      }
+    }
+
+    if (options.count("replay")) {
+      config.mReplayFile = options["replay"].as<string>();
+    }
+
+    if (options.count("view-width")) {
+      // The view's size affects which entities are active and how the
+      // camera moves, so replays only work with the original size.
+      if (options.count("replay") || options.count("record-replay")) {
+        throw invalid_argument(
+          "View width can't be changed when using replays");
+      }
+
+      const auto viewWidth = options["view-width"].as<int>();
+      if (
+        viewWidth < data::GameTraits::mapViewPortWidthTiles ||
+        viewWidth > MAX_VIEW_WIDTH_TILES
+      ) {
+        throw invalid_argument(
+          "View width must be between " +
+          to_string(data::GameTraits::mapViewPortWidthTiles) + " and " +
+          to_string(MAX_VIEW_WIDTH_TILES));
+      }
+
+      config.mViewPortSize.mMapWidthTiles = viewWidth;
+    }
+
+    if (options.count("set")) {
+      for (const auto& assignment : options["set"].as<vector<string>>()) {
+        base::applyTunableSetting(assignment);
+      }
+    }
+
     if (!config.mGamePath.empty() && config.mGamePath.back() != '/') {
       config.mGamePath += "/";
     }
 
+    if (options.count("validate-assets")) {
+      return validateAssets(config.mGamePath);
+    }
+
     initAndRunGame(config);
   }
   catch (const po::error& err)
@@ -83,6 +83,11 @@ void MenuMode::updateAndRender(engine::TimeDelta dt) {
 }
 
 
+std::optional<engine::TimeDelta> MenuMode::timeUntilNextUpdate() const {
+  return mContext.mpScriptRunner->timeUntilNextUpdate();
+}
+
+
 void MenuMode::enterMainMenu() {
   mChosenEpisodeForNewGame = 0;
 
@@ -142,7 +147,8 @@ void MenuMode::navigateToNextMenu(
               auto showCreditsScript = mContext.mpScripts->at("&Credits");
               showCreditsScript.emplace_back(data::script::WaitForUserInput{});
 
-              mContext.mpScriptRunner->executeScript(showCreditsScript);
+              mContext.mpScriptRunner->executeScript(
+                std::move(showCreditsScript));
               mMenuState = MenuState::ShowCredits;
             }
             break;
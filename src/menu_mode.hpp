@@ -30,6 +30,7 @@ public:
 
   void handleEvent(const SDL_Event& event) override;
   void updateAndRender(engine::TimeDelta dt) override;
+  std::optional<engine::TimeDelta> timeUntilNextUpdate() const override;
 
 private:
   enum class MenuState {
@@ -0,0 +1,203 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "draw_command_recording.hpp"
+
+#include <algorithm>
+#include <ostream>
+#include <tuple>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+const char* typeName(const DrawCommand::Type type) {
+  using Type = DrawCommand::Type;
+
+  switch (type) {
+    case Type::Texture: return "texture";
+    case Type::Rectangle: return "rectangle";
+    case Type::Line: return "line";
+    case Type::Point: return "point";
+    case Type::WaterEffect: return "water";
+    case Type::TileMap: return "tile_map";
+    case Type::RenderTargetBlit: return "blit";
+    case Type::Clear: return "clear";
+  }
+
+  return "unknown";
+}
+
+
+void writeRect(std::ostream& stream, const base::Rect<int>& rect) {
+  stream
+    << rect.topLeft.x << ',' << rect.topLeft.y << ' '
+    << rect.size.width << 'x' << rect.size.height;
+}
+
+
+void writeColor(std::ostream& stream, const base::Color& color) {
+  stream
+    << int(color.r) << ',' << int(color.g) << ','
+    << int(color.b) << ',' << int(color.a);
+}
+
+}
+
+
+bool DrawCommand::operator==(const DrawCommand& other) const {
+  auto asTuple = [](const DrawCommand& command) {
+    return std::tie(
+      command.mType,
+      command.mTexture,
+      command.mSourceRect,
+      command.mDestRect,
+      command.mColor,
+      command.mTileMapLayers,
+      command.mFastAnimOffset,
+      command.mSlowAnimOffset,
+      command.mDrawForeground,
+      command.mSurfaceAnimationStep,
+      command.mColorModulation,
+      command.mOverlayColor,
+      command.mClipRect,
+      command.mGlobalTranslation,
+      command.mGlobalScale,
+      command.mRenderTarget);
+  };
+
+  return asTuple(*this) == asTuple(other);
+}
+
+
+std::ostream& operator<<(std::ostream& stream, const DrawCommand& command) {
+  using Type = DrawCommand::Type;
+
+  stream << typeName(command.mType);
+
+  switch (command.mType) {
+    case Type::Texture:
+    case Type::WaterEffect:
+    case Type::TileMap:
+    case Type::RenderTargetBlit:
+      stream << " tex=" << command.mTexture << " src=";
+      writeRect(stream, command.mSourceRect);
+      break;
+
+    default:
+      break;
+  }
+
+  if (command.mType != Type::Clear) {
+    stream << " dst=";
+    writeRect(stream, command.mDestRect);
+  }
+
+  switch (command.mType) {
+    case Type::Rectangle:
+    case Type::Line:
+    case Type::Point:
+    case Type::Clear:
+      stream << " color=";
+      writeColor(stream, command.mColor);
+      break;
+
+    case Type::TileMap:
+      stream
+        << " layers=" << command.mTileMapLayers[0] << ','
+        << command.mTileMapLayers[1]
+        << " anim=" << command.mFastAnimOffset << ','
+        << command.mSlowAnimOffset
+        << " fg=" << command.mDrawForeground;
+      break;
+
+    case Type::WaterEffect:
+      stream
+        << " surface=" << command.mSurfaceAnimationStep.value_or(-1);
+      break;
+
+    default:
+      break;
+  }
+
+  stream << " mod=";
+  writeColor(stream, command.mColorModulation);
+  stream << " overlay=";
+  writeColor(stream, command.mOverlayColor);
+
+  if (command.mClipRect) {
+    stream << " clip=";
+    writeRect(stream, *command.mClipRect);
+  }
+
+  stream
+    << " translate=" << command.mGlobalTranslation.x << ','
+    << command.mGlobalTranslation.y
+    << " scale=" << command.mGlobalScale.x << ',' << command.mGlobalScale.y
+    << " target=" << command.mRenderTarget;
+
+  return stream;
+}
+
+
+void writeRecording(
+  std::ostream& stream,
+  const DrawCommandRecording& recording
+) {
+  for (const auto& command : recording.mCommands) {
+    stream << command << '\n';
+  }
+
+  std::array<std::size_t, Renderer::NUM_BATCH_FLUSH_REASONS> batchesByReason{};
+  std::size_t numVertices = 0;
+  for (const auto& batch : recording.mBatches) {
+    ++batchesByReason[static_cast<std::size_t>(batch.mReason)];
+    numVertices += batch.mNumVertices;
+  }
+
+  stream
+    << recording.mBatches.size() << " batches, " << numVertices
+    << " vertices\n";
+  for (auto i = std::size_t{0}; i < batchesByReason.size(); ++i) {
+    if (batchesByReason[i] > 0) {
+      stream
+        << "  "
+        << batchFlushReasonName(static_cast<Renderer::BatchFlushReason>(i))
+        << ": " << batchesByReason[i] << '\n';
+    }
+  }
+}
+
+
+std::optional<std::size_t> firstDifferingCommand(
+  const DrawCommandRecording& lhs,
+  const DrawCommandRecording& rhs
+) {
+  const auto [iLhs, iRhs] = std::mismatch(
+    lhs.mCommands.begin(),
+    lhs.mCommands.end(),
+    rhs.mCommands.begin(),
+    rhs.mCommands.end());
+
+  if (iLhs == lhs.mCommands.end() && iRhs == rhs.mCommands.end()) {
+    return std::nullopt;
+  }
+
+  return static_cast<std::size_t>(iLhs - lhs.mCommands.begin());
+}
+
+}
@@ -0,0 +1,145 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/color.hpp"
+#include "base/spatial_types.hpp"
+#include "renderer/opengl.hpp"
+#include "renderer/renderer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <vector>
+
+
+namespace rigel::renderer {
+
+/** A draw request received by the Renderer, with the state it was made in
+ *
+ * Commands describe what is drawn, independently of how the renderer batches
+ * it. Two recordings with the same commands therefore produce the same image,
+ * even if the draw calls issued to the GPU differ.
+ */
+struct DrawCommand {
+  enum class Type {
+    Texture,
+    Rectangle,
+    Line,
+    Point,
+    WaterEffect,
+    TileMap,
+    RenderTargetBlit,
+    Clear
+  };
+
+  Type mType = Type::Texture;
+
+  /** Texture that's drawn from, or render target that's blitted */
+  GLuint mTexture = 0;
+  base::Rect<int> mSourceRect;
+
+  /** Area that's drawn to
+   *
+   * For lines and points, topLeft holds the start position and size the
+   * offset to the end position.
+   */
+  base::Rect<int> mDestRect;
+
+  /** Draw color for rectangles, lines and points, clear color for Clear */
+  base::Color mColor;
+
+  // Tile maps only. The source rect holds the map area in pixels.
+  std::array<GLuint, 2> mTileMapLayers{};
+  int mFastAnimOffset = 0;
+  int mSlowAnimOffset = 0;
+  bool mDrawForeground = false;
+
+  // Water effect only
+  std::optional<int> mSurfaceAnimationStep;
+
+  // Renderer state at the time of the request
+  base::Color mColorModulation;
+  base::Color mOverlayColor;
+  std::optional<base::Rect<int>> mClipRect;
+  base::Vector mGlobalTranslation;
+  base::Point<float> mGlobalScale;
+  GLuint mRenderTarget = 0;
+
+  bool operator==(const DrawCommand& other) const;
+  bool operator!=(const DrawCommand& other) const {
+    return !(*this == other);
+  }
+};
+
+
+/** Everything drawn while attached to a Renderer
+ *
+ * See Renderer::setDrawCommandRecording(). Besides the draw commands, the
+ * resulting batches (i.e., GPU draw calls) are recorded as well, which makes
+ * it possible to check the effect of batching changes.
+ *
+ * When mSkipGpuDrawing is set, the renderer does all its CPU side work
+ * including batching, but doesn't issue draw, clear or blit calls to the
+ * GPU. Resources like textures are still created, so a GL context is needed
+ * nevertheless.
+ */
+struct DrawCommandRecording {
+  struct Batch {
+    Renderer::BatchFlushReason mReason;
+    std::size_t mNumVertices;
+  };
+
+  DrawCommandRecording() = default;
+  explicit DrawCommandRecording(const bool skipGpuDrawing)
+    : mSkipGpuDrawing(skipGpuDrawing)
+  {
+  }
+
+  void clear() {
+    mCommands.clear();
+    mBatches.clear();
+  }
+
+  std::vector<DrawCommand> mCommands;
+  std::vector<Batch> mBatches;
+  bool mSkipGpuDrawing = false;
+};
+
+
+/** Write command in a human readable one-line format
+ *
+ * Meant for golden output files, and for diagnosing mismatches.
+ */
+std::ostream& operator<<(std::ostream& stream, const DrawCommand& command);
+
+/** Write all commands, one per line, followed by a summary of the batches */
+void writeRecording(
+  std::ostream& stream,
+  const DrawCommandRecording& recording);
+
+/** Index of the first command that differs between the two recordings
+ *
+ * Returns std::nullopt if both recordings contain the same commands. If one
+ * is a prefix of the other, the prefix length is returned.
+ */
+std::optional<std::size_t> firstDifferingCommand(
+  const DrawCommandRecording& lhs,
+  const DrawCommandRecording& rhs);
+
+}
@@ -0,0 +1,424 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "frame_capture.hpp"
+
+#include "data/image.hpp"
+#include "loader/png_image.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+// Limits how many continuously captured frames can wait for the worker
+// thread. At full HD, this is about 130 MB worth of pixels.
+constexpr auto MAX_QUEUED_FRAMES = 16;
+
+#ifndef RIGEL_USE_GL_ES
+constexpr auto FENCE_WAIT_TIMEOUT_NS = GLuint64{1'000'000};
+#endif
+
+
+data::PixelBuffer flippedVertically(
+  const data::PixelBuffer& pixels,
+  const base::Size<int> size
+) {
+  const auto width = std::size_t(size.width);
+  const auto height = std::size_t(size.height);
+
+  data::PixelBuffer result(pixels.size());
+  for (auto y = std::size_t{0}; y < height; ++y) {
+    std::copy_n(
+      pixels.begin() + (height - y - 1) * width,
+      width,
+      result.begin() + y * width);
+  }
+
+  return result;
+}
+
+}
+
+
+/** Worker thread which writes captured frames to disk
+ *
+ * Jobs are processed in the order in which they were submitted. Pending
+ * jobs are always finished before shutting down.
+ */
+class FrameCapture::Writer {
+public:
+  struct Job {
+    enum class Type {
+      SavePng,
+      OpenRawFile,
+      AppendRawFrame,
+      CloseRawFile
+    };
+
+    Type mType;
+    std::string mPath;
+
+    // Bottom row first, as read back from GL
+    data::PixelBuffer mPixels;
+    base::Size<int> mSize;
+  };
+
+  Writer()
+    : mThread([this]() { run(); })
+  {
+  }
+
+  ~Writer() {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+      mShutDownRequested = true;
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+  }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  void submit(Job job) {
+    {
+      std::lock_guard<std::mutex> guard(mMutex);
+
+      if (job.mType == Job::Type::AppendRawFrame) {
+        if (mNumQueuedFrames >= MAX_QUEUED_FRAMES) {
+          ++mNumDroppedFrames;
+          return;
+        }
+
+        ++mNumQueuedFrames;
+      }
+
+      mJobs.push_back(std::move(job));
+    }
+
+    mCondition.notify_one();
+  }
+
+  int droppedFrameCount() {
+    std::lock_guard<std::mutex> guard(mMutex);
+    return mNumDroppedFrames;
+  }
+
+private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;) {
+      mCondition.wait(
+        lock, [this]() { return !mJobs.empty() || mShutDownRequested; });
+
+      if (mJobs.empty()) {
+        return;
+      }
+
+      auto job = std::move(mJobs.front());
+      mJobs.pop_front();
+
+      lock.unlock();
+      process(job);
+      lock.lock();
+
+      if (job.mType == Job::Type::AppendRawFrame) {
+        --mNumQueuedFrames;
+      }
+    }
+  }
+
+  void process(const Job& job) {
+    switch (job.mType) {
+      case Job::Type::SavePng:
+        loader::savePng(
+          job.mPath,
+          data::Image{
+            flippedVertically(job.mPixels, job.mSize),
+            std::size_t(job.mSize.width),
+            std::size_t(job.mSize.height)});
+        std::cout << "Screenshot saved to " << job.mPath << '\n';
+        break;
+
+      case Job::Type::OpenRawFile:
+        mRawFile.open(job.mPath, std::ios::binary | std::ios::trunc);
+        if (!mRawFile.is_open()) {
+          std::cerr
+            << "WARNING: Failed to open frame capture file " << job.mPath
+            << '\n';
+        }
+        break;
+
+      case Job::Type::AppendRawFrame:
+        if (mRawFile.is_open()) {
+          const auto pixels = flippedVertically(job.mPixels, job.mSize);
+          const std::uint32_t header[] = {
+            std::uint32_t(job.mSize.width), std::uint32_t(job.mSize.height)};
+          mRawFile.write(
+            reinterpret_cast<const char*>(header), sizeof(header));
+          mRawFile.write(
+            reinterpret_cast<const char*>(pixels.data()),
+            std::streamsize(pixels.size() * sizeof(data::Pixel)));
+        }
+        break;
+
+      case Job::Type::CloseRawFile:
+        mRawFile.close();
+        break;
+    }
+  }
+
+  // Only accessed by the worker thread
+  std::ofstream mRawFile;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<Job> mJobs;
+  int mNumQueuedFrames = 0;
+  int mNumDroppedFrames = 0;
+  bool mShutDownRequested = false;
+
+  // Must come last, the thread accesses the other members
+  std::thread mThread;
+};
+
+
+FrameCapture::FrameCapture()
+#ifdef RIGEL_USE_GL_ES
+  : mIsSupported(false)
+#else
+  : mIsSupported(true)
+#endif
+{
+}
+
+
+FrameCapture::~FrameCapture() {
+  if (!mpWriter) {
+    return;
+  }
+
+  finishAllReadbacks();
+  stopContinuousCapture();
+
+  for (auto& readback : mReadbacks) {
+    if (readback.mBuffer) {
+      glDeleteBuffers(1, &readback.mBuffer);
+    }
+  }
+}
+
+
+void FrameCapture::requestScreenshot(const std::string& path) {
+  if (mIsSupported) {
+    mPendingScreenshotPath = path;
+  }
+}
+
+
+void FrameCapture::startContinuousCapture(const std::string& path) {
+  if (!mIsSupported) {
+    return;
+  }
+
+  stopContinuousCapture();
+
+  if (!mpWriter) {
+    mpWriter = std::make_unique<Writer>();
+  }
+
+  mpWriter->submit({Writer::Job::Type::OpenRawFile, path, {}, {}});
+  mIsCapturingContinuously = true;
+}
+
+
+void FrameCapture::stopContinuousCapture() {
+  if (!mIsCapturingContinuously) {
+    return;
+  }
+
+  // Frames still in flight belong to the file that's about to be closed
+  finishAllReadbacks();
+
+  mpWriter->submit({Writer::Job::Type::CloseRawFile, {}, {}, {}});
+  mIsCapturingContinuously = false;
+}
+
+
+int FrameCapture::droppedFrameCount() const {
+  return mpWriter ? mpWriter->droppedFrameCount() : 0;
+}
+
+
+void FrameCapture::capture(
+  Renderer* pRenderer,
+  const Renderer::RenderTarget& source
+) {
+  auto& previousReadback =
+    mReadbacks[(mCurrentReadback + 1) % NUM_READBACK_BUFFERS];
+  finishReadback(previousReadback);
+
+  if (!hasPendingRequest()) {
+    return;
+  }
+
+  if (!mpWriter) {
+    mpWriter = std::make_unique<Writer>();
+  }
+
+  pRenderer->submitBatch();
+
+  auto& readback = mReadbacks[mCurrentReadback];
+  readback.mScreenshotPath = std::exchange(mPendingScreenshotPath, {});
+  readback.mAppendToRawFile = mIsCapturingContinuously;
+  startReadback(readback, source);
+
+  // Reading from the render target changed the read framebuffer binding
+  glBindFramebuffer(
+    GL_READ_FRAMEBUFFER, pRenderer->currentRenderTarget().mFbo);
+
+  mCurrentReadback = (mCurrentReadback + 1) % NUM_READBACK_BUFFERS;
+}
+
+
+void FrameCapture::startReadback(
+  Readback& readback,
+  const Renderer::RenderTarget& source
+) {
+#ifndef RIGEL_USE_GL_ES
+  assert(!readback.mIsPending);
+
+  if (!readback.mBuffer) {
+    glGenBuffers(1, &readback.mBuffer);
+  }
+
+  const auto numBytes =
+    std::size_t(source.mSize.width) * std::size_t(source.mSize.height) *
+    sizeof(data::Pixel);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source.mFbo);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.mBuffer);
+  glBufferData(
+    GL_PIXEL_PACK_BUFFER, GLsizeiptr(numBytes), nullptr, GL_STREAM_READ);
+  glReadPixels(
+    0,
+    0,
+    source.mSize.width,
+    source.mSize.height,
+    GL_RGBA,
+    GL_UNSIGNED_BYTE,
+    nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.mSize = source.mSize;
+  readback.mIsPending = true;
+#else
+  static_cast<void>(readback);
+  static_cast<void>(source);
+#endif
+}
+
+
+void FrameCapture::finishReadback(Readback& readback) {
+#ifndef RIGEL_USE_GL_ES
+  if (!readback.mIsPending) {
+    return;
+  }
+
+  for (;;) {
+    const auto result = glClientWaitSync(
+      readback.mFence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT_NS);
+    if (result != GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+  }
+
+  glDeleteSync(readback.mFence);
+  readback.mFence = nullptr;
+  readback.mIsPending = false;
+
+  const auto numPixels =
+    std::size_t(readback.mSize.width) * std::size_t(readback.mSize.height);
+  const auto numBytes = numPixels * sizeof(data::Pixel);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.mBuffer);
+  const auto pMapped = glMapBufferRange(
+    GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(numBytes), GL_MAP_READ_BIT);
+
+  data::PixelBuffer pixels(numPixels);
+  if (pMapped) {
+    std::memcpy(pixels.data(), pMapped, numBytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (!pMapped) {
+    std::cerr << "WARNING: Failed to read back captured frame\n";
+    return;
+  }
+
+  if (readback.mAppendToRawFile) {
+    // If there's also a screenshot for this frame, it needs the pixels too
+    auto rawFramePixels = readback.mScreenshotPath
+      ? pixels
+      : std::move(pixels);
+    mpWriter->submit({
+      Writer::Job::Type::AppendRawFrame,
+      {},
+      std::move(rawFramePixels),
+      readback.mSize});
+  }
+
+  if (readback.mScreenshotPath) {
+    mpWriter->submit({
+      Writer::Job::Type::SavePng,
+      std::move(*readback.mScreenshotPath),
+      std::move(pixels),
+      readback.mSize});
+    readback.mScreenshotPath.reset();
+  }
+#else
+  static_cast<void>(readback);
+#endif
+}
+
+
+void FrameCapture::finishAllReadbacks() {
+  // Oldest first, so that frames are written in order
+  for (auto i = 1; i <= NUM_READBACK_BUFFERS; ++i) {
+    finishReadback(
+      mReadbacks[(mCurrentReadback + i) % NUM_READBACK_BUFFERS]);
+  }
+}
+
+}
@@ -0,0 +1,115 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "renderer/opengl.hpp"
+#include "renderer/renderer.hpp"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+
+
+namespace rigel::renderer {
+
+/** Reads back rendered frames and writes them to disk in the background
+ *
+ * Frames are read into pixel buffer objects, double-buffered: The data for
+ * a frame is only mapped when the next frame is captured, by which time the
+ * GPU is normally done with it, so the CPU doesn't have to wait for the
+ * readback to finish. Row flipping and file writing happen on a worker
+ * thread.
+ *
+ * There are two kinds of captures. Screenshots are saved as PNG files.
+ * Continuous capture appends every captured frame to a single file, in
+ * a simple raw format: For each frame, the width and height as 32-bit
+ * unsigned integers in host byte order, followed by the RGBA pixels, top
+ * row first. If the worker thread falls behind, continuous capture drops
+ * frames instead of blocking the main thread. Screenshots are never dropped.
+ *
+ * Pixel buffer objects aren't available on OpenGL ES 2.0. Capturing does
+ * nothing there.
+ */
+class FrameCapture {
+public:
+  FrameCapture();
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  bool isSupported() const {
+    return mIsSupported;
+  }
+
+  /** Save the next captured frame as PNG file at the given path */
+  void requestScreenshot(const std::string& path);
+
+  void startContinuousCapture(const std::string& path);
+  void stopContinuousCapture();
+
+  bool isCapturingContinuously() const {
+    return mIsCapturingContinuously;
+  }
+
+  /** Number of continuously captured frames dropped so far */
+  int droppedFrameCount() const;
+
+  /** True if the next call to capture() would read back a frame */
+  bool hasPendingRequest() const {
+    return mPendingScreenshotPath || mIsCapturingContinuously;
+  }
+
+  /** Read back the given render target's contents, if requested
+   *
+   * Also hands over the previous call's frame to the worker thread. Should
+   * be called at most once per frame, with the render target fully drawn.
+   * Submits the renderer's current batch first.
+   */
+  void capture(Renderer* pRenderer, const Renderer::RenderTarget& source);
+
+private:
+  static constexpr auto NUM_READBACK_BUFFERS = 2;
+
+  struct Readback {
+    GLuint mBuffer = 0;
+#ifndef RIGEL_USE_GL_ES
+    GLsync mFence = nullptr;
+#endif
+    base::Size<int> mSize;
+    std::optional<std::string> mScreenshotPath;
+    bool mAppendToRawFile = false;
+    bool mIsPending = false;
+  };
+
+  class Writer;
+
+  void startReadback(Readback& readback, const Renderer::RenderTarget& source);
+  void finishReadback(Readback& readback);
+  void finishAllReadbacks();
+
+  std::array<Readback, NUM_READBACK_BUFFERS> mReadbacks;
+  std::optional<std::string> mPendingScreenshotPath;
+  std::unique_ptr<Writer> mpWriter;
+  int mCurrentReadback = 0;
+  bool mIsSupported;
+  bool mIsCapturingContinuously = false;
+};
+
+}
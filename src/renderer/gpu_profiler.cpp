@@ -0,0 +1,173 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "gpu_profiler.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <SDL_video.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+// Part of GL 3.3 and ARB_timer_query, which our GL loader doesn't cover
+constexpr auto GL_TIME_ELAPSED_QUERY = GLenum{0x88BF};
+
+
+bool timerQueriesSupported() {
+#ifdef RIGEL_USE_GL_ES
+  return false;
+#else
+  GLint majorVersion = 0;
+  GLint minorVersion = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+  glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+  const auto isGl33OrNewer =
+    majorVersion > 3 || (majorVersion == 3 && minorVersion >= 3);
+  return isGl33OrNewer || SDL_GL_ExtensionSupported("GL_ARB_timer_query");
+#endif
+}
+
+}
+
+
+GpuProfiler::GpuProfiler()
+  : mIsSupported(timerQueriesSupported())
+{
+}
+
+
+GpuProfiler::~GpuProfiler() {
+  deleteQueries();
+}
+
+
+void GpuProfiler::setEnabled(const bool enabled) {
+  if (!mIsSupported || enabled == mIsEnabled) {
+    return;
+  }
+
+  if (!enabled) {
+    endSection();
+
+    for (auto& frame : mFrames) {
+      frame.mSectionNames.clear();
+    }
+    mLastResults.clear();
+  }
+
+  mIsEnabled = enabled;
+}
+
+
+void GpuProfiler::beginSection(const char* pName) {
+  if (!mIsEnabled) {
+    return;
+  }
+
+  endSection();
+
+  auto& frame = mFrames[mCurrentFrame];
+  const auto queryIndex = frame.mSectionNames.size();
+  if (queryIndex == frame.mQueries.size()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    frame.mQueries.push_back(query);
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED_QUERY, frame.mQueries[queryIndex]);
+  frame.mSectionNames.push_back(pName);
+  mSectionActive = true;
+}
+
+
+void GpuProfiler::endSection() {
+  if (mSectionActive) {
+    glEndQuery(GL_TIME_ELAPSED_QUERY);
+    mSectionActive = false;
+  }
+}
+
+
+void GpuProfiler::nextFrame() {
+  if (!mIsEnabled) {
+    return;
+  }
+
+  endSection();
+
+  mCurrentFrame = (mCurrentFrame + 1) % NUM_FRAMES;
+  collectResults(mFrames[mCurrentFrame]);
+}
+
+
+void GpuProfiler::collectResults(FrameQueries& frame) {
+  const auto numSections = frame.mSectionNames.size();
+  if (numSections == 0) {
+    return;
+  }
+
+  // Queries finish in order, so if the last one is available, all the others
+  // are as well
+  GLuint isAvailable = GL_FALSE;
+  glGetQueryObjectuiv(
+    frame.mQueries[numSections - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+
+  if (isAvailable) {
+    mLastResults.clear();
+
+    for (auto i = std::size_t{0}; i < numSections; ++i) {
+      GLuint elapsedNs = 0;
+      glGetQueryObjectuiv(frame.mQueries[i], GL_QUERY_RESULT, &elapsedNs);
+      const auto elapsedMs = elapsedNs / 1'000'000.0;
+
+      const auto pName = frame.mSectionNames[i];
+      const auto iExisting = std::find_if(
+        mLastResults.begin(),
+        mLastResults.end(),
+        [pName](const SectionTiming& timing) {
+          return std::strcmp(timing.mpName, pName) == 0;
+        });
+
+      if (iExisting != mLastResults.end()) {
+        iExisting->mTimeMs += elapsedMs;
+      } else {
+        mLastResults.push_back(SectionTiming{pName, elapsedMs});
+      }
+    }
+  }
+
+  frame.mSectionNames.clear();
+}
+
+
+void GpuProfiler::deleteQueries() {
+  for (auto& frame : mFrames) {
+    if (!frame.mQueries.empty()) {
+      glDeleteQueries(GLsizei(frame.mQueries.size()), frame.mQueries.data());
+      frame.mQueries.clear();
+    }
+  }
+}
+
+}
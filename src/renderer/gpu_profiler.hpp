@@ -0,0 +1,102 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "renderer/opengl.hpp"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+
+namespace rigel::renderer {
+
+/** Measures GPU time spent on named sections of a frame
+ *
+ * Uses GL_TIME_ELAPSED queries, one per section. To avoid stalling the CPU
+ * while waiting for the GPU, the queries are double-buffered: Results for a
+ * frame are read back at the end of the following frame, right before its
+ * queries are reused. If the GPU hasn't finished by then, that frame's
+ * results are dropped and the previous ones are kept.
+ *
+ * Sections can't be nested, beginning a new section ends the current one.
+ * A section name can be used several times per frame, the times are summed
+ * up in that case. Names must be string literals, or otherwise outlive the
+ * profiler.
+ *
+ * Timer queries need GL 3.3 or ARB_timer_query, and aren't available on
+ * OpenGL ES 2.0. If not supported, all functions do nothing and there are
+ * no results.
+ */
+class GpuProfiler {
+public:
+  struct SectionTiming {
+    const char* mpName;
+    double mTimeMs;
+  };
+
+  GpuProfiler();
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  bool isSupported() const {
+    return mIsSupported;
+  }
+
+  void setEnabled(bool enabled);
+  bool isEnabled() const {
+    return mIsEnabled;
+  }
+
+  void beginSection(const char* pName);
+  void endSection();
+
+  /** Should be called once per frame, after the frame's last draw call. */
+  void nextFrame();
+
+  /** Section times of the most recent frame with available results
+   *
+   * Sections appear in the order in which they were first begun during
+   * the frame.
+   */
+  const std::vector<SectionTiming>& lastResults() const {
+    return mLastResults;
+  }
+
+private:
+  static constexpr auto NUM_FRAMES = 2;
+
+  struct FrameQueries {
+    std::vector<GLuint> mQueries;
+    std::vector<const char*> mSectionNames;
+  };
+
+  void collectResults(FrameQueries& frame);
+  void deleteQueries();
+
+  std::array<FrameQueries, NUM_FRAMES> mFrames;
+  std::vector<SectionTiming> mLastResults;
+  int mCurrentFrame = 0;
+  bool mIsSupported = false;
+  bool mIsEnabled = false;
+  bool mSectionActive = false;
+};
+
+}
@@ -20,10 +20,107 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL_video.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <atomic>
+#include <cstddef>
 #include <stdexcept>
+#include <vector>
 
 
-void rigel::renderer::loadGlFunctions() {
+namespace rigel::renderer {
+
+namespace {
+
+#ifndef RIGEL_USE_GL_ES
+BufferStorageFunction gpBufferStorage = nullptr;
+#endif
+
+
+template <typename Result, typename... Args>
+struct NullFunction {
+  static Result APIENTRY call(Args...) {
+    return Result();
+  }
+};
+
+
+template <typename Result, typename... Args>
+void setToNullFunction(Result (APIENTRYP& pFunction)(Args...)) {
+  pFunction = &NullFunction<Result, Args...>::call;
+}
+
+
+GLuint nextObjectName() {
+  // 0 is reserved, and means "no object" in most places
+  static std::atomic<GLuint> nextName{1};
+  return nextName++;
+}
+
+
+void APIENTRY nullGenNames(const GLsizei count, GLuint* pNames) {
+  for (auto i = 0; i < count; ++i) {
+    pNames[i] = nextObjectName();
+  }
+}
+
+
+GLuint APIENTRY nullCreateShader(GLenum) {
+  return nextObjectName();
+}
+
+
+GLuint APIENTRY nullCreateProgram() {
+  return nextObjectName();
+}
+
+
+void APIENTRY nullGetObjectiv(GLuint, const GLenum name, GLint* pValue) {
+  const auto isStatus = name == GL_COMPILE_STATUS || name == GL_LINK_STATUS;
+  *pValue = isStatus ? GL_TRUE : 0;
+}
+
+
+void APIENTRY nullGetIntegerv(GLenum, GLint* pValue) {
+  *pValue = 0;
+}
+
+
+void APIENTRY nullGetQueryObjectuiv(GLuint, GLenum, GLuint* pValue) {
+  *pValue = 0;
+}
+
+
+void* APIENTRY nullMapBufferRange(
+  GLenum,
+  GLintptr,
+  const GLsizeiptr length,
+  GLbitfield
+) {
+  // Mapped data is never looked at, so all mappings made by a thread can
+  // share the same memory. Buffers are unmapped before they are mapped again,
+  // except for persistent mappings, which aren't available without
+  // glBufferStorage.
+  thread_local std::vector<std::byte> mappedMemory;
+  if (mappedMemory.size() < static_cast<std::size_t>(length)) {
+    mappedMemory.resize(static_cast<std::size_t>(length));
+  }
+
+  return mappedMemory.data();
+}
+
+
+GLboolean APIENTRY nullUnmapBuffer(GLenum) {
+  return GL_TRUE;
+}
+
+
+GLenum APIENTRY nullClientWaitSync(GLsync, GLbitfield, GLuint64) {
+  return GL_ALREADY_SIGNALED;
+}
+
+}
+
+
+void loadGlFunctions() {
   int result = 0;
 #ifdef RIGEL_USE_GL_ES
   result = gladLoadGLES2Loader(SDL_GL_GetProcAddress);
@@ -34,4 +131,108 @@ void rigel::renderer::loadGlFunctions() {
   if (!result) {
     throw std::runtime_error("Failed to load OpenGL function pointers");
   }
+
+#ifndef RIGEL_USE_GL_ES
+  const auto hasBufferStorage =
+    GLVersion.major > 4 ||
+    (GLVersion.major == 4 && GLVersion.minor >= 4) ||
+    SDL_GL_ExtensionSupported("GL_ARB_buffer_storage");
+  if (hasBufferStorage) {
+    gpBufferStorage = reinterpret_cast<BufferStorageFunction>(
+      SDL_GL_GetProcAddress("glBufferStorage"));
+  }
+#endif
+}
+
+
+void loadNullGlFunctions() {
+  setToNullFunction(glad_glActiveTexture);
+  setToNullFunction(glad_glAttachShader);
+  setToNullFunction(glad_glBeginQuery);
+  setToNullFunction(glad_glBindAttribLocation);
+  setToNullFunction(glad_glBindBuffer);
+  setToNullFunction(glad_glBindFramebuffer);
+  setToNullFunction(glad_glBindTexture);
+  setToNullFunction(glad_glBindVertexArray);
+  setToNullFunction(glad_glBlendFunc);
+  setToNullFunction(glad_glBlitFramebuffer);
+  setToNullFunction(glad_glBufferData);
+  setToNullFunction(glad_glBufferSubData);
+  setToNullFunction(glad_glClear);
+  setToNullFunction(glad_glClearColor);
+  setToNullFunction(glad_glCompileShader);
+  setToNullFunction(glad_glDeleteBuffers);
+  setToNullFunction(glad_glDeleteFramebuffers);
+  setToNullFunction(glad_glDeleteProgram);
+  setToNullFunction(glad_glDeleteQueries);
+  setToNullFunction(glad_glDeleteShader);
+  setToNullFunction(glad_glDeleteSync);
+  setToNullFunction(glad_glDeleteTextures);
+  setToNullFunction(glad_glDeleteVertexArrays);
+  setToNullFunction(glad_glDisable);
+  setToNullFunction(glad_glDisableVertexAttribArray);
+  setToNullFunction(glad_glDrawArrays);
+  setToNullFunction(glad_glDrawArraysInstanced);
+  setToNullFunction(glad_glDrawElements);
+  setToNullFunction(glad_glDrawElementsBaseVertex);
+  setToNullFunction(glad_glEnable);
+  setToNullFunction(glad_glEnableVertexAttribArray);
+  setToNullFunction(glad_glEndQuery);
+  setToNullFunction(glad_glFenceSync);
+  setToNullFunction(glad_glFlush);
+  setToNullFunction(glad_glFramebufferTexture2D);
+  setToNullFunction(glad_glGetActiveUniform);
+  setToNullFunction(glad_glGetProgramInfoLog);
+  setToNullFunction(glad_glGetShaderInfoLog);
+  setToNullFunction(glad_glGetUniformLocation);
+  setToNullFunction(glad_glLinkProgram);
+  setToNullFunction(glad_glPixelStorei);
+  setToNullFunction(glad_glPointSize);
+  setToNullFunction(glad_glReadPixels);
+  setToNullFunction(glad_glScissor);
+  setToNullFunction(glad_glShaderSource);
+  setToNullFunction(glad_glTexBuffer);
+  setToNullFunction(glad_glTexImage2D);
+  setToNullFunction(glad_glTexParameteri);
+  setToNullFunction(glad_glTexSubImage2D);
+  setToNullFunction(glad_glUniform1f);
+  setToNullFunction(glad_glUniform1fv);
+  setToNullFunction(glad_glUniform1i);
+  setToNullFunction(glad_glUniform2fv);
+  setToNullFunction(glad_glUniform3fv);
+  setToNullFunction(glad_glUniform4fv);
+  setToNullFunction(glad_glUniformMatrix4fv);
+  setToNullFunction(glad_glUseProgram);
+  setToNullFunction(glad_glVertexAttribPointer);
+  setToNullFunction(glad_glViewport);
+
+  glad_glGenBuffers = nullGenNames;
+  glad_glGenFramebuffers = nullGenNames;
+  glad_glGenQueries = nullGenNames;
+  glad_glGenTextures = nullGenNames;
+  glad_glGenVertexArrays = nullGenNames;
+  glad_glCreateShader = nullCreateShader;
+  glad_glCreateProgram = nullCreateProgram;
+  glad_glGetShaderiv = nullGetObjectiv;
+  glad_glGetProgramiv = nullGetObjectiv;
+  glad_glGetIntegerv = nullGetIntegerv;
+  glad_glGetQueryObjectuiv = nullGetQueryObjectuiv;
+  glad_glMapBufferRange = nullMapBufferRange;
+  glad_glUnmapBuffer = nullUnmapBuffer;
+  glad_glClientWaitSync = nullClientWaitSync;
+
+#ifndef RIGEL_USE_GL_ES
+  gpBufferStorage = nullptr;
+#endif
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+BufferStorageFunction bufferStorageFunction() {
+  return gpBufferStorage;
+}
+
+#endif
+
 }
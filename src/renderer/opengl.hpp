@@ -32,4 +32,33 @@ namespace rigel::renderer {
 
 void loadGlFunctions();
 
+/** Set up all GL functions used by the renderer to do nothing
+ *
+ * For running without any GL context, e.g. in headless simulations. Object
+ * names are still handed out and buffers can be mapped, so that the renderer
+ * and textures can be created as usual, but nothing is ever drawn and any
+ * data read back is meaningless. Can be used from multiple threads
+ * concurrently, and without a window (see Renderer).
+ */
+void loadNullGlFunctions();
+
+
+#ifndef RIGEL_USE_GL_ES
+
+// Our GL loader only covers GL 3.2 core, so we look up glBufferStorage
+// (GL 4.4, or ARB_buffer_storage) ourselves, see bufferStorageFunction().
+using BufferStorageFunction =
+  void (APIENTRYP)(GLenum, GLsizeiptr, const void*, GLbitfield);
+
+constexpr auto MAP_PERSISTENT_BIT = GLbitfield{0x0040};
+constexpr auto MAP_COHERENT_BIT = GLbitfield{0x0080};
+
+/** glBufferStorage, or nullptr if the GL context doesn't support it
+ *
+ * Only valid after loadGlFunctions().
+ */
+BufferStorageFunction bufferStorageFunction();
+
+#endif
+
 }
@@ -0,0 +1,150 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+// Sort key layout:
+//
+//  63      48 47              16 15      8 7       0
+// [  layer   | sequence number  |  effect  | unused ]
+//
+// The sequence number keeps recording order within a layer. Sorting by
+// texture instead would reorder overlapping sprites.
+constexpr auto LAYER_SHIFT = 48;
+constexpr auto SEQUENCE_SHIFT = 16;
+constexpr auto EFFECT_SHIFT = 8;
+
+constexpr auto MAX_EFFECTS = std::size_t{256};
+
+
+std::uint64_t makeSortKey(
+  const std::uint16_t layer,
+  const std::uint32_t sequenceNumber,
+  const std::uint64_t effectIndex
+) {
+  return
+    (std::uint64_t{layer} << LAYER_SHIFT) |
+    (std::uint64_t{sequenceNumber} << SEQUENCE_SHIFT) |
+    (effectIndex << EFFECT_SHIFT);
+}
+
+
+std::uint64_t effectFromKey(const std::uint64_t sortKey) {
+  return (sortKey >> EFFECT_SHIFT) & 0xFF;
+}
+
+}
+
+
+RenderQueue::RenderQueue(Renderer* pRenderer)
+  : mpRenderer(pRenderer)
+{
+}
+
+
+void RenderQueue::drawTexture(
+  const std::uint16_t layer,
+  const Renderer::TextureData& textureData,
+  const base::Rect<int>& sourceRect,
+  const base::Rect<int>& destRect,
+  const base::Color& overlayColor,
+  const base::Color& colorModulation
+) {
+  const auto effect = effectIndex(overlayColor, colorModulation);
+  mCommands.push_back(DrawCommand{
+    makeSortKey(layer, mNextSequenceNumber++, effect),
+    textureData,
+    sourceRect,
+    destRect});
+}
+
+
+void RenderQueue::submit() {
+  if (mCommands.empty()) {
+    return;
+  }
+
+  std::stable_sort(
+    std::begin(mCommands),
+    std::end(mCommands),
+    [](const DrawCommand& lhs, const DrawCommand& rhs) {
+      return lhs.mSortKey < rhs.mSortKey;
+    });
+
+  auto currentEffect = std::uint64_t{MAX_EFFECTS};
+  for (const auto& command : mCommands) {
+    // Adjacent commands with the same effect share a single state change.
+    // The renderer keeps drawing into the same batch as long as the texture
+    // stays the same as well.
+    const auto effectIndex = effectFromKey(command.mSortKey);
+    if (effectIndex != currentEffect) {
+      const auto& effect = mEffects[effectIndex];
+      mpRenderer->setOverlayColor(effect.mOverlayColor);
+      mpRenderer->setColorModulation(effect.mColorModulation);
+      currentEffect = effectIndex;
+    }
+
+    mpRenderer->drawTexture(
+      command.mTextureData, command.mSourceRect, command.mDestRect);
+  }
+
+  mpRenderer->setOverlayColor({});
+  mpRenderer->setColorModulation({255, 255, 255, 255});
+
+  mCommands.clear();
+  mEffects.clear();
+  mNextSequenceNumber = 0;
+}
+
+
+std::uint64_t RenderQueue::effectIndex(
+  const base::Color& overlayColor,
+  const base::Color& colorModulation
+) {
+  // There are usually only a handful of distinct effects in use, so a linear
+  // search is good enough here.
+  const auto iEffect = std::find_if(
+    std::begin(mEffects),
+    std::end(mEffects),
+    [&](const Effect& effect) {
+      return
+        effect.mOverlayColor == overlayColor &&
+        effect.mColorModulation == colorModulation;
+    });
+  if (iEffect != std::end(mEffects)) {
+    return std::uint64_t(std::distance(std::begin(mEffects), iEffect));
+  }
+
+  if (mEffects.size() == MAX_EFFECTS) {
+    // Out of effect slots. Everything recorded so far can be drawn without
+    // affecting the order of anything recorded afterwards, so flush.
+    submit();
+  }
+
+  mEffects.push_back(Effect{overlayColor, colorModulation});
+  return mEffects.size() - 1;
+}
+
+}
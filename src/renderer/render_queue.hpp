@@ -0,0 +1,93 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "base/color.hpp"
+#include "base/spatial_types.hpp"
+#include "renderer/renderer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+namespace rigel::renderer {
+
+/** Records textured draw commands and submits them in an optimized order
+ *
+ * Every change of texture, overlay color or color modulation forces the
+ * Renderer to submit a batch. The queue assigns each command a 64-bit sort
+ * key made up of (from most to least significant) the layer, a sequence
+ * number and the color effect. On submit(), commands are sorted by that key
+ * and runs of adjacent commands sharing the same texture and effect are
+ * drawn with a single state change.
+ *
+ * Commands are never reordered within a layer. Sprites with the same draw
+ * order can overlap, and a multi-slot sprite's frames can sit on different
+ * atlas pages, so drawing them in any other order than they were recorded
+ * in would be visible on screen.
+ *
+ * Submission needs to happen explicitly, since anything drawn directly via
+ * the Renderer in between would otherwise end up in the wrong order.
+ */
+class RenderQueue {
+public:
+  explicit RenderQueue(Renderer* pRenderer);
+
+  void drawTexture(
+    std::uint16_t layer,
+    const Renderer::TextureData& textureData,
+    const base::Rect<int>& sourceRect,
+    const base::Rect<int>& destRect,
+    const base::Color& overlayColor = {},
+    const base::Color& colorModulation = {255, 255, 255, 255});
+
+  /** Sort all recorded commands and draw them using the Renderer
+   *
+   * Overlay color and color modulation are reset to their defaults
+   * afterwards.
+   */
+  void submit();
+
+  bool empty() const {
+    return mCommands.empty();
+  }
+
+private:
+  struct Effect {
+    base::Color mOverlayColor;
+    base::Color mColorModulation;
+  };
+
+  struct DrawCommand {
+    std::uint64_t mSortKey;
+    Renderer::TextureData mTextureData;
+    base::Rect<int> mSourceRect;
+    base::Rect<int> mDestRect;
+  };
+
+  std::uint64_t effectIndex(
+    const base::Color& overlayColor,
+    const base::Color& colorModulation);
+
+  Renderer* mpRenderer;
+  std::vector<DrawCommand> mCommands;
+  std::uint32_t mNextSequenceNumber = 0;
+  std::vector<Effect> mEffects;
+};
+
+}
@@ -16,7 +16,10 @@
 
 #include "renderer.hpp"
 
+#include "base/container_utils.hpp"
+#include "base/tunables.hpp"
 #include "data/game_traits.hpp"
+#include "renderer/draw_command_recording.hpp"
 #include "loader/palette.hpp"
 
 RIGEL_DISABLE_WARNINGS
@@ -25,6 +28,9 @@ RIGEL_RESTORE_WARNINGS
 
 #include <array>
 #include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
 
 
 namespace rigel::renderer {
@@ -33,12 +39,90 @@ namespace {
 
 const GLushort QUAD_INDICES[] = { 0, 1, 2, 2, 3, 1 };
 
+constexpr auto VERTICES_PER_QUAD = std::size_t{4};
+constexpr auto INDICES_PER_QUAD = std::size(QUAD_INDICES);
+
+// Batches are drawn using a static index buffer, which is filled with
+// QUAD_INDICES repeated for this many quads. With 4 vertices per quad, this is
+// the largest batch size that can still be addressed with 16-bit indices.
+constexpr auto MAX_QUADS_PER_BATCH = std::size_t{16384};
+
+// x, y, r, g, b, a - used for points and lines
+constexpr auto SOLID_COLOR_VERTEX_SIZE = std::size_t{6};
+
+
+// Upper limits for render targets kept around for reuse, see
+// Renderer::releaseRenderTargetTexture()
+constexpr auto MAX_POOLED_RENDER_TARGETS = std::size_t{8};
+constexpr auto MAX_POOLED_RENDER_TARGET_BYTES = std::size_t{64 * 1024 * 1024};
+
+
+// Size of the per-frame regions in the streaming vertex buffer.
+// A frame's worth of data should normally fit comfortably, see
+// StreamingBuffer for what happens if it doesn't.
+constexpr auto STREAM_VBO_REGION_SIZE = std::size_t{1024 * 1024};
+
+
+#ifndef RIGEL_USE_GL_ES
+
+// left, top, right, bottom for both the destination and the source rect,
+// the texture slot (padded to a full texel), the overlay color and the color
+// modulation
+constexpr auto FLOATS_PER_SPRITE_INSTANCE = std::size_t{20};
+
+// The instance buffer is accessed as a texture of RGBA32F texels. GL 3.x only
+// guarantees 64k texels for buffer textures, so all regions together should
+// stay below that.
+constexpr auto INSTANCE_BUFFER_TEXEL_SIZE = 4 * sizeof(float);
+constexpr auto INSTANCE_BUFFER_REGION_SIZE = std::size_t{256 * 1024};
+
+// Sprite batches are limited to what fits into one region of the instance
+// buffer, so that the buffer never needs to grow beyond the texel limit
+constexpr auto MAX_SPRITE_INSTANCES_PER_BATCH =
+  INSTANCE_BUFFER_REGION_SIZE / (sizeof(float) * FLOATS_PER_SPRITE_INSTANCE);
+
+constexpr auto INSTANCE_DATA_TEXTURE_UNIT = 2;
+constexpr auto TILE_MAP_LAYER0_TEXTURE_UNIT = 3;
+constexpr auto TILE_MAP_LAYER1_TEXTURE_UNIT = 4;
+
+// Sprite batches can use multiple textures at once, each slot corresponds to
+// one of these texture units. The first one is the regular texture unit 0.
+constexpr std::array<int, Renderer::MAX_BATCH_TEXTURES> BATCH_TEXTURE_UNITS{
+  0, 7, 8, 9};
+
+// velocity x, initial offset index
+constexpr auto PARTICLE_VERTEX_SIZE = std::size_t{2};
+constexpr auto PARTICLE_GROUP_DATA_SIZE =
+  PARTICLES_PER_GROUP * PARTICLE_VERTEX_SIZE;
+
+#endif
+
 
 constexpr auto WATER_MASK_WIDTH = 8;
 constexpr auto WATER_MASK_HEIGHT = 8;
 constexpr auto WATER_NUM_MASKS = 5;
 constexpr auto WATER_MASK_INDEX_FILLED = 4;
 
+constexpr auto WATER_REMAP_TABLE_LEVELS = 16;
+constexpr auto WATER_MASK_TEXTURE_UNIT = 1;
+constexpr auto WATER_REMAP_TABLE_TEXTURE_UNIT = 5;
+
+// The palette texture holds the 16 palette colors, followed by a fully
+// transparent entry which is used for transparent pixels in indexed textures.
+constexpr auto PALETTE_TEXTURE_UNIT = 6;
+constexpr auto PALETTE_TEXTURE_SIZE = 17;
+constexpr auto TRANSPARENT_COLOR_INDEX = std::uint8_t{16};
+
+// GL ES 2.0 has no single-channel red format, so we use alpha-only textures
+// there. The channel to read in the shader is given by INDEX_CHANNEL.
+#ifdef RIGEL_USE_GL_ES
+constexpr auto INDEXED_TEXTURE_INTERNAL_FORMAT = GLint(GL_ALPHA);
+constexpr auto INDEXED_TEXTURE_FORMAT = GLenum(GL_ALPHA);
+#else
+constexpr auto INDEXED_TEXTURE_INTERNAL_FORMAT = GLint(GL_R8);
+constexpr auto INDEXED_TEXTURE_FORMAT = GLenum(GL_RED);
+#endif
+
 
 #ifdef RIGEL_USE_GL_ES
 
@@ -52,6 +136,7 @@ const auto SHADER_PREAMBLE = R"shd(
 #define OUTPUT_COLOR gl_FragColor
 #define OUTPUT_COLOR_DECLARATION
 #define SET_POINT_SIZE(size) gl_PointSize = size;
+#define INDEX_CHANNEL a
 )shd";
 
 #else
@@ -66,11 +151,39 @@ const auto SHADER_PREAMBLE = R"shd(
 #define OUTPUT_COLOR outputColor
 #define OUTPUT_COLOR_DECLARATION out vec4 outputColor;
 #define SET_POINT_SIZE
+#define INDEX_CHANNEL r
 )shd";
 
 #endif
 
 
+base::Tunable<bool> gUsePlainShaderPermutations{
+  "plain-shader-permutations",
+  "Draw sprites without color effects using shaders which leave out "
+  "color modulation and overlay.",
+  true};
+
+
+/** Preamble for a shader permutation
+ *
+ * Shader sources can check for permutation defines using #ifdef. These need
+ * to come after the preamble, since that starts with the #version directive.
+ */
+std::string withDefines(
+  const char* preamble,
+  std::initializer_list<const char*> defines
+) {
+  std::string result{preamble};
+  for (const auto define : defines) {
+    result += "#define ";
+    result += define;
+    result += '\n';
+  }
+
+  return result;
+}
+
+
 const auto VERTEX_SOURCE = R"shd(
 ATTRIBUTE vec2 position;
 ATTRIBUTE vec2 texCoord;
@@ -85,23 +198,152 @@ void main() {
 }
 )shd";
 
+
+#ifndef RIGEL_USE_GL_ES
+
+// Each sprite is one instance, described by five texels in the instance data
+// buffer texture: The destination rect and the source rect in texture
+// coordinates, both as (left, top, right, bottom), the texture slot to
+// sample from, and the overlay color and color modulation to apply. The quad's
+// corners are derived from gl_VertexID, drawn as a triangle strip in the same
+// vertex order that fillVertexData() uses.
+const auto VERTEX_SOURCE_INSTANCED = R"shd(
+OUT vec2 texCoordFrag;
+flat OUT int textureSlotFrag;
+flat OUT vec4 overlayColorFrag;
+flat OUT vec4 colorModulationFrag;
+
+uniform mat4 transform;
+uniform samplerBuffer instanceData;
+uniform int instanceOffset;
+
+void main() {
+  int baseTexel = instanceOffset + gl_InstanceID * 5;
+  vec4 destRect = texelFetch(instanceData, baseTexel);
+  vec4 texRect = texelFetch(instanceData, baseTexel + 1);
+  float textureSlot = texelFetch(instanceData, baseTexel + 2).x;
+  overlayColorFrag = texelFetch(instanceData, baseTexel + 3);
+  colorModulationFrag = texelFetch(instanceData, baseTexel + 4);
+
+  vec2 corner = vec2(float(gl_VertexID / 2), float(1 - gl_VertexID % 2));
+  vec2 position = mix(destRect.xy, destRect.zw, corner);
+  vec2 texCoord = mix(texRect.xy, texRect.zw, corner);
+
+  gl_Position = transform * vec4(position, 0.0, 1.0);
+  texCoordFrag = vec2(texCoord.x, 1.0 - texCoord.y);
+  textureSlotFrag = int(textureSlot);
+}
+)shd";
+
+
+// Same as FRAGMENT_SOURCE, but samples from one of several textures, and
+// takes the colors from the instance data instead of uniforms. GLSL 1.50 only
+// allows indexing sampler arrays with constants, hence the branches. The slot
+// is the same for the whole sprite, and our textures have no mip maps, so
+// sampling within the branches is fine.
+const auto FRAGMENT_SOURCE_MULTI_TEXTURE = R"shd(
+OUTPUT_COLOR_DECLARATION
+
+IN vec2 texCoordFrag;
+flat IN int textureSlotFrag;
+flat IN vec4 overlayColorFrag;
+flat IN vec4 colorModulationFrag;
+
+uniform sampler2D textureData0;
+uniform sampler2D textureData1;
+uniform sampler2D textureData2;
+uniform sampler2D textureData3;
+
+vec4 lookUpTexel() {
+  if (textureSlotFrag == 0) {
+    return textureLod(textureData0, texCoordFrag, 0.0);
+  } else if (textureSlotFrag == 1) {
+    return textureLod(textureData1, texCoordFrag, 0.0);
+  } else if (textureSlotFrag == 2) {
+    return textureLod(textureData2, texCoordFrag, 0.0);
+  }
+
+  return textureLod(textureData3, texCoordFrag, 0.0);
+}
+
+void main() {
+  vec4 baseColor = lookUpTexel();
+  vec4 modulated = baseColor * colorModulationFrag;
+  float targetAlpha = modulated.a;
+
+  OUTPUT_COLOR = vec4(
+    mix(modulated.rgb, overlayColorFrag.rgb, overlayColorFrag.a),
+    targetAlpha);
+}
+)shd";
+
+#endif
+
 const auto FRAGMENT_SOURCE = R"shd(
 OUTPUT_COLOR_DECLARATION
 
 IN vec2 texCoordFrag;
 
 uniform sampler2D textureData;
+
+#ifndef PLAIN_TEXTURED
 uniform vec4 overlayColor;
 
 uniform vec4 colorModulation;
+#endif
 
 void main() {
   vec4 baseColor = TEXTURE_LOOKUP(textureData, texCoordFrag);
+
+#ifdef PLAIN_TEXTURED
+  OUTPUT_COLOR = baseColor;
+#else
+  vec4 modulated = baseColor * colorModulation;
+  float targetAlpha = modulated.a;
+
+  OUTPUT_COLOR =
+    vec4(mix(modulated.rgb, overlayColor.rgb, overlayColor.a), targetAlpha);
+#endif
+}
+)shd";
+
+// Same as FRAGMENT_SOURCE, but the texture holds palette indices which are
+// turned into colors using the palette texture.
+//
+// Both have a PLAIN_TEXTURED permutation, which leaves out the overlay color
+// and color modulation. It's used while these are set to values which
+// don't change the texture's colors, which is the case for most draws.
+const auto FRAGMENT_SOURCE_INDEXED = R"shd(
+OUTPUT_COLOR_DECLARATION
+
+IN vec2 texCoordFrag;
+
+uniform sampler2D textureData;
+uniform sampler2D paletteData;
+
+#ifndef PLAIN_TEXTURED
+uniform vec4 overlayColor;
+
+uniform vec4 colorModulation;
+#endif
+
+const float PALETTE_SIZE = 17.0;
+
+void main() {
+  vec4 indexTexel = TEXTURE_LOOKUP(textureData, texCoordFrag);
+  float index = floor(indexTexel.INDEX_CHANNEL * 255.0 + 0.5);
+  vec4 baseColor = TEXTURE_LOOKUP(
+    paletteData, vec2((index + 0.5) / PALETTE_SIZE, 0.5));
+
+#ifdef PLAIN_TEXTURED
+  OUTPUT_COLOR = baseColor;
+#else
   vec4 modulated = baseColor * colorModulation;
   float targetAlpha = modulated.a;
 
   OUTPUT_COLOR =
     vec4(mix(modulated.rgb, overlayColor.rgb, overlayColor.a), targetAlpha);
+#endif
 }
 )shd";
 
@@ -157,19 +399,19 @@ IN vec2 texCoordMaskFrag;
 
 uniform sampler2D textureData;
 uniform sampler2D maskData;
-uniform vec3 palette[16];
+uniform sampler2D remapTable;
 
 
+// The remap table has 16 entries per color channel, laid out as
+// 256 (red * 16 + green) x 16 (blue) texels.
 vec4 applyWaterEffect(vec4 color) {
-  int index = 0;
-  for (int i = 0; i < 16; ++i) {
-    if (color.rgb == palette[i]) {
-      index = i;
-    }
-  }
+  vec3 quantized = floor(color.rgb * 15.0 + 0.5);
+  vec2 tableCoord = vec2(
+    (quantized.r * 16.0 + quantized.g + 0.5) / 256.0,
+    (quantized.b + 0.5) / 16.0);
 
-  int adjustedIndex = (index & 0x3) | 0x8;
-  return vec4(palette[adjustedIndex], color.a);
+  // The table is uploaded top-down, so no flipping is needed here
+  return vec4(TEXTURE_LOOKUP(remapTable, tableCoord).rgb, color.a);
 }
 
 void main() {
@@ -181,6 +423,125 @@ void main() {
 )shd";
 
 
+#ifndef RIGEL_USE_GL_ES
+
+const auto VERTEX_SOURCE_TILE_MAP = R"shd(
+ATTRIBUTE vec2 position;
+ATTRIBUTE vec2 mapPosition;
+
+OUT vec2 mapPositionFrag;
+
+uniform mat4 transform;
+
+void main() {
+  gl_Position = transform * vec4(position, 0.0, 1.0);
+  mapPositionFrag = mapPosition;
+}
+)shd";
+
+const auto FRAGMENT_SOURCE_TILE_MAP = R"shd(
+OUTPUT_COLOR_DECLARATION
+
+IN vec2 mapPositionFrag;
+
+uniform sampler2D tileSetData;
+uniform usampler2D layer0Data;
+uniform usampler2D layer1Data;
+
+uniform bool drawForeground;
+uniform int fastAnimOffset;
+uniform int slowAnimOffset;
+
+const int TILE_SIZE = 8;
+
+const uint INDEX_MASK = 0x07FFu;
+const uint FOREGROUND_FLAG = 0x2000u;
+const uint ANIMATED_FLAG = 0x4000u;
+const uint FAST_ANIMATION_FLAG = 0x8000u;
+
+
+vec4 tileColor(usampler2D layerData, ivec2 tilePos, ivec2 pixelInTile) {
+  uint texel = texelFetch(layerData, tilePos, 0).r;
+  int index = int(texel & INDEX_MASK);
+  bool isForeground = (texel & FOREGROUND_FLAG) != 0u;
+
+  if (index == 0 || isForeground != drawForeground) {
+    return vec4(0.0);
+  }
+
+  if ((texel & ANIMATED_FLAG) != 0u) {
+    index += (texel & FAST_ANIMATION_FLAG) != 0u
+      ? fastAnimOffset
+      : slowAnimOffset;
+  }
+
+  ivec2 tileSetSize = textureSize(tileSetData, 0);
+  int tilesPerRow = tileSetSize.x / TILE_SIZE;
+  ivec2 tileSetPos =
+    ivec2(index % tilesPerRow, index / tilesPerRow) * TILE_SIZE +
+    pixelInTile;
+
+  // The tile set is stored top-down, like all textures created from images
+  return texelFetch(tileSetData, tileSetPos, 0);
+}
+
+void main() {
+  ivec2 mapPixel = ivec2(floor(mapPositionFrag));
+  ivec2 tilePos = mapPixel / TILE_SIZE;
+  ivec2 pixelInTile = mapPixel - tilePos * TILE_SIZE;
+
+  ivec2 mapSize = textureSize(layer0Data, 0);
+  if (any(lessThan(tilePos, ivec2(0))) ||
+      any(greaterThanEqual(tilePos, mapSize))) {
+    discard;
+  }
+
+  // Tile set pixels are either fully opaque or fully transparent, so the
+  // second layer either completely covers the first one or not at all.
+  vec4 color0 = tileColor(layer0Data, tilePos, pixelInTile);
+  vec4 color1 = tileColor(layer1Data, tilePos, pixelInTile);
+  vec4 color = color1.a > 0.0 ? color1 : color0;
+
+  if (color.a == 0.0) {
+    discard;
+  }
+
+  OUTPUT_COLOR = color;
+}
+)shd";
+
+// The table size must match MAX_PARTICLE_MOVEMENT_TABLE_SIZE
+const auto VERTEX_SOURCE_PARTICLES = R"shd(
+ATTRIBUTE float velocityX;
+ATTRIBUTE float initialOffsetIndex;
+
+uniform mat4 transform;
+uniform vec2 origin;
+uniform int framesElapsed;
+uniform float movementTable[64];
+
+void main() {
+  int index = int(initialOffsetIndex);
+  vec2 offset = vec2(
+    velocityX * float(framesElapsed),
+    movementTable[index + framesElapsed] - movementTable[index]);
+  gl_Position = transform * vec4(origin + offset, 0.0, 1.0);
+}
+)shd";
+
+const auto FRAGMENT_SOURCE_PARTICLES = R"shd(
+OUTPUT_COLOR_DECLARATION
+
+uniform vec4 color;
+
+void main() {
+  OUTPUT_COLOR = color;
+}
+)shd";
+
+#endif
+
+
 void* toAttribOffset(std::uintptr_t offset) {
   return reinterpret_cast<void*>(offset);
 }
@@ -257,6 +618,29 @@ void fillVertexPositions(
 }
 
 
+void setDefaultTextureParameters() {
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+
+/** Adjust a vertical texture coordinate to the texture's row order
+ *
+ * The vertex shaders flip texture coordinates vertically, which matches
+ * render targets: OpenGL stores those bottom-up. Textures created from images
+ * are uploaded top-down as is, though, so we pre-flip their coordinates to
+ * cancel out the flip done by the shader.
+ */
+float flipTexCoordIfNeeded(
+  const float v,
+  const Renderer::TextureData& textureData
+) {
+  return textureData.mIsTopDown ? 1.0f - v : v;
+}
+
+
 template <typename Iter>
 void fillTexCoords(
   const base::Rect<int>& rect,
@@ -276,14 +660,96 @@ void fillTexCoords(
 
   const auto left = texOffset.x;
   const auto right = texScale.x + texOffset.x;
-  const auto top = texOffset.y;
-  const auto bottom = texScale.y + texOffset.y;
+  const auto top = flipTexCoordIfNeeded(texOffset.y, textureData);
+  const auto bottom =
+    flipTexCoordIfNeeded(texScale.y + texOffset.y, textureData);
 
   fillVertexData(
     left, right, top, bottom, std::forward<Iter>(destIter), offset, stride);
 }
 
 
+std::vector<GLushort> createQuadIndices() {
+  std::vector<GLushort> indices;
+  indices.reserve(MAX_QUADS_PER_BATCH * INDICES_PER_QUAD);
+
+  for (std::size_t quad = 0; quad < MAX_QUADS_PER_BATCH; ++quad) {
+    const auto baseIndex = quad * VERTICES_PER_QUAD;
+    for (const auto index : QUAD_INDICES) {
+      indices.push_back(static_cast<GLushort>(baseIndex + index));
+    }
+  }
+
+  return indices;
+}
+
+
+std::vector<std::uint8_t> toIndexData(
+  const data::Image& image,
+  const loader::Palette16& palette
+) {
+  auto toIndex = [&palette](const data::Pixel& pixel) {
+    if (pixel.a == 0) {
+      return TRANSPARENT_COLOR_INDEX;
+    }
+
+    const auto iColor = std::find(palette.begin(), palette.end(), pixel);
+    assert(iColor != palette.end());
+    return iColor != palette.end()
+      ? static_cast<std::uint8_t>(std::distance(palette.begin(), iColor))
+      : std::uint8_t{0};
+  };
+
+  return utils::transformed(image.pixelData(), toIndex);
+}
+
+
+data::Image createPaletteImage(const loader::Palette16& palette) {
+  auto pixels = data::PixelBuffer{palette.begin(), palette.end()};
+  pixels.push_back(base::Color{0, 0, 0, 0});
+
+  return data::Image{
+    move(pixels),
+    static_cast<size_t>(PALETTE_TEXTURE_SIZE),
+    static_cast<size_t>(1)};
+}
+
+
+int quantizeForWaterRemapTable(const std::uint8_t value) {
+  // Must match the quantization done in FRAGMENT_SOURCE_WATER_EFFECT
+  return (value * (WATER_REMAP_TABLE_LEVELS - 1) + 127) / 255;
+}
+
+
+data::Image createWaterRemapTableImage() {
+  using loader::INGAME_PALETTE;
+
+  // The water effect maps each palette index i to (i & 0x3) | 0x8, i.e.
+  // to one of 4 darker colors. Instead of searching for the index in the
+  // shader, we precompute the mapping for all (quantized) colors.
+  //
+  // Colors which aren't part of the palette are treated like index 0.
+  constexpr auto LEVELS = WATER_REMAP_TABLE_LEVELS;
+  auto pixels = data::PixelBuffer{
+    LEVELS * LEVELS * LEVELS, INGAME_PALETTE[0x8]};
+
+  for (std::size_t index = 0; index < INGAME_PALETTE.size(); ++index) {
+    const auto& color = INGAME_PALETTE[index];
+    const auto r = quantizeForWaterRemapTable(color.r);
+    const auto g = quantizeForWaterRemapTable(color.g);
+    const auto b = quantizeForWaterRemapTable(color.b);
+
+    pixels[(r * LEVELS + g) + b * LEVELS * LEVELS] =
+      INGAME_PALETTE[(index & 0x3) | 0x8];
+  }
+
+  return data::Image{
+    move(pixels),
+    static_cast<size_t>(LEVELS * LEVELS),
+    static_cast<size_t>(LEVELS)};
+}
+
+
 data::Image createWaterSurfaceAnimImage() {
   auto pixels = data::PixelBuffer{
     WATER_MASK_WIDTH * WATER_MASK_HEIGHT * WATER_NUM_MASKS,
@@ -331,16 +797,59 @@ data::Image createWaterSurfaceAnimImage() {
     static_cast<size_t>(WATER_MASK_HEIGHT * WATER_NUM_MASKS)};
 }
 
+
+DrawCommand makeDrawCommand(
+  const DrawCommand::Type type,
+  const base::Rect<int>& destRect,
+  const GLuint texture = 0,
+  const base::Rect<int>& sourceRect = {},
+  const base::Color& color = {}
+) {
+  DrawCommand command;
+  command.mType = type;
+  command.mTexture = texture;
+  command.mSourceRect = sourceRect;
+  command.mDestRect = destRect;
+  command.mColor = color;
+  return command;
+}
+
 }
 
 
 Renderer::Renderer(SDL_Window* pWindow)
   : mpWindow(pWindow)
+  , mStreamVbo(GL_ARRAY_BUFFER, STREAM_VBO_REGION_SIZE)
+#ifndef RIGEL_USE_GL_ES
+  , mInstanceBuffer(GL_TEXTURE_BUFFER, INSTANCE_BUFFER_REGION_SIZE)
+#endif
   , mTexturedQuadShader(
       SHADER_PREAMBLE,
+#ifdef RIGEL_USE_GL_ES
+      VERTEX_SOURCE,
+      FRAGMENT_SOURCE,
+#else
+      VERTEX_SOURCE_INSTANCED,
+      FRAGMENT_SOURCE_MULTI_TEXTURE,
+#endif
+      {"position", "texCoord"})
+#ifdef RIGEL_USE_GL_ES
+  , mPlainTexturedQuadShader(
+      withDefines(SHADER_PREAMBLE, {"PLAIN_TEXTURED"}).c_str(),
       VERTEX_SOURCE,
       FRAGMENT_SOURCE,
       {"position", "texCoord"})
+#endif
+  , mIndexedQuadShader(
+      SHADER_PREAMBLE,
+      VERTEX_SOURCE,
+      FRAGMENT_SOURCE_INDEXED,
+      {"position", "texCoord"})
+  , mPlainIndexedQuadShader(
+      withDefines(SHADER_PREAMBLE, {"PLAIN_TEXTURED"}).c_str(),
+      VERTEX_SOURCE,
+      FRAGMENT_SOURCE_INDEXED,
+      {"position", "texCoord"})
   , mSolidColorShader(
       SHADER_PREAMBLE,
       VERTEX_SOURCE_SOLID,
@@ -351,9 +860,22 @@ Renderer::Renderer(SDL_Window* pWindow)
       VERTEX_SOURCE_WATER_EFFECT,
       FRAGMENT_SOURCE_WATER_EFFECT,
       {"position", "texCoord", "texCoordMask"})
+#ifndef RIGEL_USE_GL_ES
+  , mTileMapShader(
+      SHADER_PREAMBLE,
+      VERTEX_SOURCE_TILE_MAP,
+      FRAGMENT_SOURCE_TILE_MAP,
+      {"position", "mapPosition"})
+  , mParticleShader(
+      SHADER_PREAMBLE,
+      VERTEX_SOURCE_PARTICLES,
+      FRAGMENT_SOURCE_PARTICLES,
+      {"velocityX", "initialOffsetIndex"})
+#endif
   , mLastUsedShader(0)
   , mLastUsedTexture(0)
   , mRenderMode(RenderMode::SpriteBatch)
+  , mCurrentPalette(loader::INGAME_PALETTE)
   , mCurrentFbo(0)
   , mWindowSize(
       [&]() {
@@ -374,39 +896,102 @@ Renderer::Renderer(SDL_Window* pWindow)
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   SDL_GL_SetSwapInterval(1);
 
-  // Setup a VBO for streaming data to the GPU, stays bound all the time
-  glGenBuffers(1, &mStreamVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, mStreamVbo);
-  glGenBuffers(1, &mStreamEbo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mStreamEbo);
+#ifndef RIGEL_USE_GL_ES
+  // The core profile requires a bound VAO for everything involving vertex
+  // array state, see setUpVertexArrays() for the actual layouts.
+  mVertexArrays[static_cast<std::size_t>(mRenderMode)].bind();
+#endif
+
+  // The streaming VBO has been bound on construction, and stays bound all the
+  // time. Same for the quad index buffer, which never changes after this.
+  const auto quadIndices = createQuadIndices();
+  glGenBuffers(1, &mQuadIndicesEbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadIndicesEbo);
+  glBufferData(
+    GL_ELEMENT_ARRAY_BUFFER,
+    sizeof(GLushort) * quadIndices.size(),
+    quadIndices.data(),
+    GL_STATIC_DRAW);
 
+#ifdef RIGEL_USE_GL_ES
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
+#endif
 
   // One-time setup for water effect shader
   useShaderIfChanged(mWaterEffectShader);
-  array<glm::vec3, 16> palette;
-  transform(
-    begin(loader::INGAME_PALETTE),
-    end(loader::INGAME_PALETTE),
-    begin(palette),
-    [](const base::Color& color) {
-      return glm::vec3{color.r, color.g, color.b} / 255.0f;
-    });
-  mWaterEffectShader.setUniform("palette", palette);
   mWaterEffectShader.setUniform("textureData", 0);
-  mWaterEffectShader.setUniform("maskData", 1);
+  mWaterEffectShader.setUniform("maskData", WATER_MASK_TEXTURE_UNIT);
+  mWaterEffectShader.setUniform(
+    "remapTable", WATER_REMAP_TABLE_TEXTURE_UNIT);
 
   mWaterSurfaceAnimTexture = createTexture(createWaterSurfaceAnimImage());
+  mWaterRemapTableTexture = createTexture(createWaterRemapTableImage());
 
-  glActiveTexture(GL_TEXTURE1);
+  glActiveTexture(GL_TEXTURE0 + WATER_MASK_TEXTURE_UNIT);
   glBindTexture(GL_TEXTURE_2D, mWaterSurfaceAnimTexture.mHandle);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glActiveTexture(GL_TEXTURE0 + WATER_REMAP_TABLE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, mWaterRemapTableTexture.mHandle);
+  glActiveTexture(GL_TEXTURE0);
+
+  // One-time setup for indexed textured quad shader
+  useShaderIfChanged(mIndexedQuadShader);
+  mIndexedQuadShader.setUniform("textureData", 0);
+  mIndexedQuadShader.setUniform("paletteData", PALETTE_TEXTURE_UNIT);
+  useShaderIfChanged(mPlainIndexedQuadShader);
+  mPlainIndexedQuadShader.setUniform("textureData", 0);
+  mPlainIndexedQuadShader.setUniform("paletteData", PALETTE_TEXTURE_UNIT);
+
+  mPaletteTexture = createTexture(createPaletteImage(mCurrentPalette));
+
+  glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, mPaletteTexture.mHandle);
   glActiveTexture(GL_TEXTURE0);
 
   // One-time setup for textured quad shader
   useShaderIfChanged(mTexturedQuadShader);
+
+#ifdef RIGEL_USE_GL_ES
   mTexturedQuadShader.setUniform("textureData", 0);
+  useShaderIfChanged(mPlainTexturedQuadShader);
+  mPlainTexturedQuadShader.setUniform("textureData", 0);
+#else
+  mTexturedQuadShader.setUniform("textureData0", BATCH_TEXTURE_UNITS[0]);
+  mTexturedQuadShader.setUniform("textureData1", BATCH_TEXTURE_UNITS[1]);
+  mTexturedQuadShader.setUniform("textureData2", BATCH_TEXTURE_UNITS[2]);
+  mTexturedQuadShader.setUniform("textureData3", BATCH_TEXTURE_UNITS[3]);
+  mTexturedQuadShader.setUniform("instanceData", INSTANCE_DATA_TEXTURE_UNIT);
+
+  glGenTextures(1, &mInstanceBufferTexture);
+  glActiveTexture(GL_TEXTURE0 + INSTANCE_DATA_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, mInstanceBufferTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mInstanceBuffer.handle());
+  glActiveTexture(GL_TEXTURE0);
+
+  // One-time setup for tile map shader
+  useShaderIfChanged(mTileMapShader);
+  mTileMapShader.setUniform("tileSetData", 0);
+  mTileMapShader.setUniform("layer0Data", TILE_MAP_LAYER0_TEXTURE_UNIT);
+  mTileMapShader.setUniform("layer1Data", TILE_MAP_LAYER1_TEXTURE_UNIT);
+
+  // Storage for particle groups. Groups are handed out lowest id first.
+  mParticleData.resize(MAX_PARTICLE_GROUPS * PARTICLE_GROUP_DATA_SIZE);
+  for (auto id = int(MAX_PARTICLE_GROUPS) - 1; id >= 0; --id) {
+    mFreeParticleGroups.push_back(id);
+  }
+
+  glGenBuffers(1, &mParticleVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, mParticleVbo);
+  glBufferData(
+    GL_ARRAY_BUFFER,
+    sizeof(std::int16_t) * mParticleData.size(),
+    nullptr,
+    GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, mStreamVbo.handle());
+
+  setUpVertexArrays();
+#endif
 
   // Remaining setup
   onRenderTargetChanged();
@@ -416,8 +1001,19 @@ Renderer::Renderer(SDL_Window* pWindow)
 
 
 Renderer::~Renderer() {
-  glDeleteBuffers(1, &mStreamVbo);
+#ifndef RIGEL_USE_GL_ES
+  glDeleteTextures(1, &mInstanceBufferTexture);
+  glDeleteBuffers(1, &mParticleVbo);
+#endif
+  glDeleteBuffers(1, &mQuadIndicesEbo);
   glDeleteTextures(1, &mWaterSurfaceAnimTexture.mHandle);
+  glDeleteTextures(1, &mWaterRemapTableTexture.mHandle);
+  glDeleteTextures(1, &mPaletteTexture.mHandle);
+
+  for (const auto& entry : mRenderTargetPool) {
+    glDeleteFramebuffers(1, &entry.mHandles.fbo);
+    glDeleteTextures(1, &entry.mHandles.texture);
+  }
 }
 
 
@@ -426,45 +1022,106 @@ base::Rect<int> Renderer::fullScreenRect() const {
 }
 
 
+// The overlay color and color modulation are shared by the regular and the
+// indexed sprite shader. They are applied to whichever of the two is
+// current, and to the other one once we switch to it (see updateShaders()).
+//
+// On desktop GL, regular sprites carry their colors in the instance data, so
+// changing colors doesn't require submitting the batch for those.
 void Renderer::setOverlayColor(const base::Color& color) {
   if (color != mLastOverlayColor) {
-    submitBatch();
+    if (usesColorUniforms()) {
+      flushBatch(BatchFlushReason::UniformChange);
+    }
 
-    setRenderModeIfChanged(RenderMode::SpriteBatch);
-    mTexturedQuadShader.setUniform("overlayColor", toGlColor(color));
     mLastOverlayColor = color;
+    updateShaders();
   }
 }
 
 
 void Renderer::setColorModulation(const base::Color& colorModulation) {
   if (colorModulation != mLastColorModulation) {
-    submitBatch();
+    if (usesColorUniforms()) {
+      flushBatch(BatchFlushReason::UniformChange);
+    }
 
-    setRenderModeIfChanged(RenderMode::SpriteBatch);
-    mTexturedQuadShader.setUniform(
-      "colorModulation", toGlColor(colorModulation));
     mLastColorModulation = colorModulation;
+    updateShaders();
   }
 }
 
 
-void Renderer::drawTexture(
-  const TextureData& textureData,
-  const base::Rect<int>& sourceRect,
-  const base::Rect<int>& destRect
-) {
-  if (!isVisible(destRect)) {
-    return;
-  }
-
-  setRenderModeIfChanged(RenderMode::SpriteBatch);
+bool Renderer::colorsAreIdentity() const {
+  return gUsePlainShaderPermutations &&
+    mLastColorModulation == base::Color{255, 255, 255, 255} &&
+    mLastOverlayColor.a == 0;
+}
 
-  if (textureData.mHandle != mLastUsedTexture) {
-    submitBatch();
 
-    glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
+bool Renderer::usesColorUniforms() const {
+#ifdef RIGEL_USE_GL_ES
+  return
+    mRenderMode == RenderMode::SpriteBatch ||
+    mRenderMode == RenderMode::IndexedSpriteBatch;
+#else
+  return mRenderMode == RenderMode::IndexedSpriteBatch;
+#endif
+}
+
+
+void Renderer::setPalette(const loader::Palette16& palette) {
+  if (palette != mCurrentPalette) {
+    // Pending indexed draws need to use the previous palette
+    flushBatch(BatchFlushReason::UniformChange);
+
+    mCurrentPalette = palette;
+    updateTextureRegion(mPaletteTexture, {0, 0}, createPaletteImage(palette));
+  }
+}
+
+
+void Renderer::drawTexture(
+  const TextureData& textureData,
+  const base::Rect<int>& sourceRect,
+  const base::Rect<int>& destRect
+) {
+  if (!isVisible(destRect)) {
+    return;
+  }
+
+  if (isRecording()) {
+    record(makeDrawCommand(
+      DrawCommand::Type::Texture,
+      destRect,
+      textureData.mHandle,
+      sourceRect));
+  }
+
+  setRenderModeIfChanged(
+    textureData.mIsIndexed
+      ? RenderMode::IndexedSpriteBatch
+      : RenderMode::SpriteBatch);
+
+#ifndef RIGEL_USE_GL_ES
+  // Only regular sprites are instanced, indexed ones are rare enough that
+  // they simply use the regular vertex path.
+  if (!textureData.mIsIndexed) {
+    batchSpriteInstance(
+      textureData,
+      batchTextureSlot(textureData.mHandle),
+      sourceRect,
+      destRect);
+    return;
+  }
+#endif
+
+  if (textureData.mHandle != mLastUsedTexture) {
+    flushBatch(BatchFlushReason::TextureChange);
+
+    glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
     mLastUsedTexture = textureData.mHandle;
+    ++mCurrentFrameStatistics.mTextureBinds;
   }
 
   // x, y, tex_u, tex_v
@@ -472,56 +1129,255 @@ void Renderer::drawTexture(
   fillVertexPositions(destRect, std::begin(vertices), 0, 4);
   fillTexCoords(sourceRect, textureData, std::begin(vertices), 2, 4);
 
-  batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 4u);
+  batchQuadVertices(std::cbegin(vertices), std::cend(vertices));
 }
 
 
+void Renderer::drawTextures(
+  const TextureData& textureData,
+  const base::ArrayView<TexturedQuad> quads
+) {
+#ifndef RIGEL_USE_GL_ES
+  if (!textureData.mIsIndexed) {
+    // Same as drawTexture(), but the render mode and texture slot only need
+    // to be determined once
+    auto textureSlot = std::optional<int>{};
+
+    for (const auto& quad : quads) {
+      if (!isVisible(quad.mDestRect)) {
+        continue;
+      }
+
+      if (isRecording()) {
+        record(makeDrawCommand(
+          DrawCommand::Type::Texture,
+          quad.mDestRect,
+          textureData.mHandle,
+          quad.mSourceRect));
+      }
+
+      if (!textureSlot) {
+        setRenderModeIfChanged(RenderMode::SpriteBatch);
+        textureSlot = batchTextureSlot(textureData.mHandle);
+      }
+
+      batchSpriteInstance(
+        textureData, *textureSlot, quad.mSourceRect, quad.mDestRect);
+    }
+
+    return;
+  }
+#endif
+
+  for (const auto& quad : quads) {
+    drawTexture(textureData, quad.mSourceRect, quad.mDestRect);
+  }
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void Renderer::batchSpriteInstance(
+  const TextureData& textureData,
+  const int textureSlot,
+  const base::Rect<int>& sourceRect,
+  const base::Rect<int>& destRect
+) {
+  // Texture slots stay valid across batches ended this way, see
+  // batchTextureSlot()
+  if (mNumBatchedQuads == MAX_SPRITE_INSTANCES_PER_BATCH) {
+    flushBatch(BatchFlushReason::BatchFull);
+  }
+
+  const auto texWidth = float(textureData.mWidth);
+  const auto texHeight = float(textureData.mHeight);
+  const auto overlayColor = toGlColor(mLastOverlayColor);
+  const auto colorModulation = toGlColor(mLastColorModulation);
+
+  const GLfloat instance[FLOATS_PER_SPRITE_INSTANCE] = {
+    float(destRect.left()),
+    float(destRect.top()),
+    float(destRect.left() + destRect.size.width),
+    float(destRect.top() + destRect.size.height),
+    sourceRect.left() / texWidth,
+    flipTexCoordIfNeeded(sourceRect.top() / texHeight, textureData),
+    (sourceRect.left() + sourceRect.size.width) / texWidth,
+    flipTexCoordIfNeeded(
+      (sourceRect.top() + sourceRect.size.height) / texHeight, textureData),
+    float(textureSlot),
+    0.0f,
+    0.0f,
+    0.0f,
+    overlayColor.r,
+    overlayColor.g,
+    overlayColor.b,
+    overlayColor.a,
+    colorModulation.r,
+    colorModulation.g,
+    colorModulation.b,
+    colorModulation.a
+  };
+
+  batchQuadVertices(std::cbegin(instance), std::cend(instance));
+}
+
+
+int Renderer::batchTextureSlot(const GLuint handle) {
+  // Slot 0 is texture unit 0, so it's whatever texture is currently bound
+  // there as far as the rest of the renderer is concerned
+  if (handle == mLastUsedTexture) {
+    return 0;
+  }
+
+  for (std::size_t i = 0; i < mNumExtraBatchTextures; ++i) {
+    if (mExtraBatchTextures[i] == handle) {
+      return int(i + 1);
+    }
+  }
+
+  auto& stats = mCurrentFrameStatistics;
+
+  if (mNumExtraBatchTextures + 1 < MAX_BATCH_TEXTURES) {
+    const auto slot = mNumExtraBatchTextures + 1;
+    glActiveTexture(GL_TEXTURE0 + BATCH_TEXTURE_UNITS[slot]);
+    glBindTexture(GL_TEXTURE_2D, handle);
+    glActiveTexture(GL_TEXTURE0);
+
+    mExtraBatchTextures[mNumExtraBatchTextures] = handle;
+    ++mNumExtraBatchTextures;
+    ++stats.mTextureBinds;
+    return int(slot);
+  }
+
+  // All slots are taken, start over with a new batch
+  flushBatch(BatchFlushReason::TextureChange);
+
+  glBindTexture(GL_TEXTURE_2D, handle);
+  mLastUsedTexture = handle;
+  mNumExtraBatchTextures = 0;
+  ++stats.mTextureBinds;
+  return 0;
+}
+
+#endif
+
+
 void Renderer::submitBatch() {
+  flushBatch(BatchFlushReason::Explicit);
+}
+
+
+void Renderer::flushBatch(const BatchFlushReason reason) {
   if (mBatchData.empty()) {
     return;
   }
 
-  auto submitBatchedQuads = [this]() {
-    glBufferData(
-      GL_ARRAY_BUFFER,
-      sizeof(float) * mBatchData.size(),
-      mBatchData.data(),
-      GL_STREAM_DRAW);
-    glBufferData(
-      GL_ELEMENT_ARRAY_BUFFER,
-      sizeof(GLushort) * mBatchIndices.size(),
-      mBatchIndices.data(),
-      GL_STREAM_DRAW);
+  auto& stats = mCurrentFrameStatistics;
+  ++stats.mBatchesByFlushReason[static_cast<std::size_t>(reason)];
+  countUpload(sizeof(float) * mBatchData.size());
+
+  const auto drawOnGpu = !isSkippingGpuDrawing();
+
+  auto submitBatchedQuads = [&]() {
+    if (!drawOnGpu) {
+      return;
+    }
+
+    const auto firstVertex = uploadBatchVertices();
+#ifdef RIGEL_USE_GL_ES
+    static_cast<void>(firstVertex);
     glDrawElements(
       GL_TRIANGLES,
-      GLsizei(mBatchIndices.size()),
+      GLsizei(mNumBatchedQuads * INDICES_PER_QUAD),
       GL_UNSIGNED_SHORT,
       nullptr);
+#else
+    glDrawElementsBaseVertex(
+      GL_TRIANGLES,
+      GLsizei(mNumBatchedQuads * INDICES_PER_QUAD),
+      GL_UNSIGNED_SHORT,
+      nullptr,
+      firstVertex);
+#endif
   };
 
+  const auto numSolidColorVertices =
+    mBatchData.size() / SOLID_COLOR_VERTEX_SIZE;
+  auto numVertices = mNumBatchedQuads * VERTICES_PER_QUAD;
+  stats.mQuads += int(mNumBatchedQuads);
+
   switch (mRenderMode) {
     case RenderMode::SpriteBatch:
+#ifdef RIGEL_USE_GL_ES
+      submitBatchedQuads();
+#else
+      if (drawOnGpu) {
+        submitSpriteInstances();
+      }
+#endif
+      break;
+
+    case RenderMode::IndexedSpriteBatch:
     case RenderMode::WaterEffect:
+#ifndef RIGEL_USE_GL_ES
+    case RenderMode::TileMap:
+#endif
       submitBatchedQuads();
       break;
 
     case RenderMode::Points:
-      glBufferData(
-        GL_ARRAY_BUFFER,
-        sizeof(float) * mBatchData.size(),
-        mBatchData.data(),
-        GL_STREAM_DRAW);
-      glDrawArrays(GL_POINTS, 0, GLsizei(mBatchData.size() / 6));
+      if (drawOnGpu) {
+        const auto firstVertex = uploadBatchVertices();
+        glDrawArrays(
+          GL_POINTS, firstVertex, GLsizei(numSolidColorVertices));
+      }
+      numVertices = numSolidColorVertices;
+      stats.mPoints += int(numSolidColorVertices);
       break;
 
     case RenderMode::NonTexturedRender:
-      // No batching yet for NonTexturedRender
-      assert(false);
+      // Rectangles are batched as 4 individual lines, so everything can be
+      // drawn using a single GL_LINES draw call
+      if (drawOnGpu) {
+        const auto firstVertex = uploadBatchVertices();
+        glDrawArrays(GL_LINES, firstVertex, GLsizei(numSolidColorVertices));
+      }
+      numVertices = numSolidColorVertices;
       break;
+
+#ifndef RIGEL_USE_GL_ES
+    case RenderMode::ParticleGroup:
+      // Drawn right away by drawParticleGroup(), never batched
+      break;
+#endif
+  }
+
+  ++stats.mDrawCalls;
+  stats.mVerticesDrawn += numVertices;
+  ++mContentVersion;
+
+  if (isRecording()) {
+    mpRecording->mBatches.push_back({reason, numVertices});
   }
 
   mBatchData.clear();
-  mBatchIndices.clear();
+  mNumBatchedQuads = 0;
+}
+
+
+void Renderer::beginGpuTimerSection(const char* pName) {
+  if (mGpuProfiler.isEnabled()) {
+    submitBatch();
+    mGpuProfiler.beginSection(pName);
+  }
+}
+
+
+void Renderer::endGpuTimerSection() {
+  if (mGpuProfiler.isEnabled()) {
+    submitBatch();
+    mGpuProfiler.endSection();
+  }
 }
 
 
@@ -529,12 +1385,15 @@ void Renderer::drawRectangle(
   const base::Rect<int>& rect,
   const base::Color& color
 ) {
-  // Note: No batching for now, drawRectangle is only used for debugging at
-  // the moment
   if (!isVisible(rect)) {
     return;
   }
 
+  if (isRecording()) {
+    record(makeDrawCommand(
+      DrawCommand::Type::Rectangle, rect, 0, {}, color));
+  }
+
   setRenderModeIfChanged(RenderMode::NonTexturedRender);
 
   const auto left = float(rect.left());
@@ -546,13 +1405,19 @@ void Renderer::drawRectangle(
   float vertices[] = {
     left, top, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
     left, bottom, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
+
+    left, bottom, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
+    right, bottom, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
+
     right, bottom, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
+    right, top, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
+
     right, top, colorVec.r, colorVec.g, colorVec.b, colorVec.a,
     left, top, colorVec.r, colorVec.g, colorVec.b, colorVec.a
   };
 
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-  glDrawArrays(GL_LINE_STRIP, 0, 5);
+  mBatchData.insert(
+    std::end(mBatchData), std::cbegin(vertices), std::cend(vertices));
 }
 
 
@@ -563,8 +1428,11 @@ void Renderer::drawLine(
   const int y2,
   const base::Color& color
 ) {
-  // Note: No batching for now, drawLine is only used for debugging at the
-  // moment
+  if (isRecording()) {
+    const auto lineRect = base::Rect<int>{{x1, y1}, {x2 - x1, y2 - y1}};
+    record(makeDrawCommand(DrawCommand::Type::Line, lineRect, 0, {}, color));
+  }
+
   setRenderModeIfChanged(RenderMode::NonTexturedRender);
 
   const auto colorVec = toGlColor(color);
@@ -574,8 +1442,44 @@ void Renderer::drawLine(
     float(x2), float(y2), colorVec.r, colorVec.g, colorVec.b, colorVec.a
   };
 
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
-  glDrawArrays(GL_LINE_STRIP, 0, 2);
+  mBatchData.insert(
+    std::end(mBatchData), std::cbegin(vertices), std::cend(vertices));
+}
+
+
+void Renderer::drawLines(
+  const base::ArrayView<base::Vector> endPoints,
+  const base::Color& color
+) {
+  assert(endPoints.size() % 2 == 0);
+
+  if (endPoints.empty()) {
+    return;
+  }
+
+  if (isRecording()) {
+    for (auto i = 0u; i < endPoints.size(); i += 2) {
+      const auto start = endPoints[i];
+      const auto end = endPoints[i + 1];
+      const auto lineRect =
+        base::Rect<int>{start, {end.x - start.x, end.y - start.y}};
+      record(makeDrawCommand(DrawCommand::Type::Line, lineRect, 0, {}, color));
+    }
+  }
+
+  setRenderModeIfChanged(RenderMode::NonTexturedRender);
+
+  const auto colorVec = toGlColor(color);
+
+  mBatchData.reserve(mBatchData.size() + endPoints.size() * 6);
+  for (const auto& point : endPoints) {
+    const float vertex[] = {
+      float(point.x), float(point.y),
+      colorVec.r, colorVec.g, colorVec.b, colorVec.a
+    };
+    mBatchData.insert(
+      std::end(mBatchData), std::cbegin(vertex), std::cend(vertex));
+  }
 }
 
 
@@ -588,6 +1492,11 @@ void Renderer::drawPoint(
     return;
   }
 
+  if (isRecording()) {
+    record(makeDrawCommand(
+      DrawCommand::Type::Point, {position, {0, 0}}, 0, {}, color));
+  }
+
   setRenderModeIfChanged(RenderMode::Points);
 
   float vertices[] = {
@@ -603,6 +1512,38 @@ void Renderer::drawPoint(
 }
 
 
+void Renderer::drawPoints(
+  const base::ArrayView<base::Vector> positions,
+  const base::Color& color
+) {
+  const auto& visibleRect = fullScreenRect();
+
+  const auto r = color.r / 255.0f;
+  const auto g = color.g / 255.0f;
+  const auto b = color.b / 255.0f;
+  const auto a = color.a / 255.0f;
+
+  for (const auto& position : positions) {
+    if (!visibleRect.containsPoint(position)) {
+      continue;
+    }
+
+    if (isRecording()) {
+      record(makeDrawCommand(
+        DrawCommand::Type::Point, {position, {0, 0}}, 0, {}, color));
+    }
+
+    // Cheap when the mode doesn't change, so no need to hoist it out of the
+    // loop. Doing it for visible points only matches drawPoint().
+    setRenderModeIfChanged(RenderMode::Points);
+
+    float vertices[] = {float(position.x), float(position.y), r, g, b, a};
+    mBatchData.insert(
+      std::end(mBatchData), std::cbegin(vertices), std::cend(vertices));
+  }
+}
+
+
 void Renderer::drawWaterEffect(
   const base::Rect<int>& area,
   TextureData textureData,
@@ -618,6 +1559,13 @@ void Renderer::drawWaterEffect(
     return;
   }
 
+  if (isRecording()) {
+    auto command = makeDrawCommand(
+      DrawCommand::Type::WaterEffect, area, textureData.mHandle, area);
+    command.mSurfaceAnimationStep = surfaceAnimationStep;
+    record(command);
+  }
+
   const auto areaWidth = area.size.width;
   auto drawWater = [&, this](
     const base::Rect<int>& destRect,
@@ -636,15 +1584,16 @@ void Renderer::drawWaterEffect(
     fillTexCoords(
       animSourceRect, mWaterSurfaceAnimTexture, std::begin(vertices), 4, 6);
 
-    batchQuadVertices(std::cbegin(vertices), std::cend(vertices), 6);
+    batchQuadVertices(std::cbegin(vertices), std::cend(vertices));
   };
 
   setRenderModeIfChanged(RenderMode::WaterEffect);
 
   if (mLastUsedTexture != textureData.mHandle) {
-    submitBatch();
+    flushBatch(BatchFlushReason::TextureChange);
     glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
     mLastUsedTexture = textureData.mHandle;
+    ++mCurrentFrameStatistics.mTextureBinds;
   }
 
   if (surfaceAnimationStep) {
@@ -666,10 +1615,227 @@ void Renderer::drawWaterEffect(
 }
 
 
+void Renderer::blitRenderTarget(
+  const RenderTarget& source,
+  const TextureData& sourceTexture
+) {
+  assert(source.mSize == mCurrentFramebufferSize);
+
+#ifdef RIGEL_USE_GL_ES
+  const auto fullRect = base::Rect<int>{{0, 0}, source.mSize};
+  drawTexture(sourceTexture, fullRect, fullRect);
+#else
+  static_cast<void>(sourceTexture);
+
+  submitBatch();
+
+  const auto width = source.mSize.width;
+  const auto height = source.mSize.height;
+
+  if (isRecording()) {
+    const auto fullRect = base::Rect<int>{{0, 0}, source.mSize};
+    record(makeDrawCommand(
+      DrawCommand::Type::RenderTargetBlit, fullRect, source.mFbo, fullRect));
+  }
+
+  if (isSkippingGpuDrawing()) {
+    return;
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source.mFbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCurrentFbo);
+  glBlitFramebuffer(
+    0, 0, width, height,
+    0, 0, width, height,
+    GL_COLOR_BUFFER_BIT,
+    GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFbo);
+  ++mContentVersion;
+#endif
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void Renderer::drawTileMap(
+  const base::Rect<int>& destRect,
+  const TileMapParams& params
+) {
+  if (!isVisible(destRect)) {
+    return;
+  }
+
+  if (isRecording()) {
+    auto command = makeDrawCommand(
+      DrawCommand::Type::TileMap,
+      destRect,
+      params.mTileSet.mHandle,
+      {params.mMapOffsetPx, destRect.size});
+    command.mTileMapLayers = {
+      params.mLayers[0].mHandle, params.mLayers[1].mHandle};
+    command.mFastAnimOffset = params.mFastAnimOffset;
+    command.mSlowAnimOffset = params.mSlowAnimOffset;
+    command.mDrawForeground = params.mDrawForeground;
+    record(command);
+  }
+
+  setRenderModeIfChanged(RenderMode::TileMap);
+
+  if (mLastUsedTexture != params.mTileSet.mHandle) {
+    glBindTexture(GL_TEXTURE_2D, params.mTileSet.mHandle);
+    mLastUsedTexture = params.mTileSet.mHandle;
+    ++mCurrentFrameStatistics.mTextureBinds;
+  }
+
+  glActiveTexture(GL_TEXTURE0 + TILE_MAP_LAYER0_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, params.mLayers[0].mHandle);
+  glActiveTexture(GL_TEXTURE0 + TILE_MAP_LAYER1_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_2D, params.mLayers[1].mHandle);
+  glActiveTexture(GL_TEXTURE0);
+  mCurrentFrameStatistics.mTextureBinds += 2;
+
+  mTileMapShader.setUniform("drawForeground", params.mDrawForeground ? 1 : 0);
+  mTileMapShader.setUniform("fastAnimOffset", params.mFastAnimOffset);
+  mTileMapShader.setUniform("slowAnimOffset", params.mSlowAnimOffset);
+
+  const auto mapLeft = float(params.mMapOffsetPx.x);
+  const auto mapTop = float(params.mMapOffsetPx.y);
+
+  // x, y, map_x, map_y
+  GLfloat vertices[4 * (2 + 2)];
+  fillVertexPositions(destRect, std::begin(vertices), 0, 4);
+  fillVertexData(
+    mapLeft,
+    mapLeft + destRect.size.width,
+    mapTop,
+    mapTop + destRect.size.height,
+    std::begin(vertices),
+    2,
+    4);
+
+  // The uniforms are specific to this draw, so submit right away
+  batchQuadVertices(std::cbegin(vertices), std::cend(vertices));
+  flushBatch(BatchFlushReason::UniformChange);
+}
+
+
+void Renderer::setParticleMovementTable(
+  const base::ArrayView<std::int16_t> table
+) {
+  assert(table.size() <= MAX_PARTICLE_MOVEMENT_TABLE_SIZE);
+
+  mParticleMovementTable.fill(0.0f);
+  std::copy(table.begin(), table.end(), mParticleMovementTable.begin());
+
+  if (mRenderMode == RenderMode::ParticleGroup) {
+    mParticleShader.setUniform("movementTable", mParticleMovementTable);
+  }
+}
+
+
+std::optional<int> Renderer::createParticleGroup(
+  const base::ArrayView<std::int16_t> velocitiesX,
+  const base::ArrayView<std::int16_t> initialOffsetIndices
+) {
+  assert(velocitiesX.size() == PARTICLES_PER_GROUP);
+  assert(initialOffsetIndices.size() == PARTICLES_PER_GROUP);
+
+  if (mFreeParticleGroups.empty()) {
+    return std::nullopt;
+  }
+
+  const auto id = mFreeParticleGroups.back();
+  mFreeParticleGroups.pop_back();
+
+  const auto offset = id * PARTICLE_GROUP_DATA_SIZE;
+  for (auto i = std::size_t{0}; i < PARTICLES_PER_GROUP; ++i) {
+    mParticleData[offset + i * PARTICLE_VERTEX_SIZE] =
+      velocitiesX[std::uint32_t(i)];
+    mParticleData[offset + i * PARTICLE_VERTEX_SIZE + 1] =
+      initialOffsetIndices[std::uint32_t(i)];
+  }
+
+  const auto numBytes = sizeof(std::int16_t) * PARTICLE_GROUP_DATA_SIZE;
+  glBindBuffer(GL_ARRAY_BUFFER, mParticleVbo);
+  glBufferSubData(
+    GL_ARRAY_BUFFER,
+    sizeof(std::int16_t) * offset,
+    numBytes,
+    mParticleData.data() + offset);
+  glBindBuffer(GL_ARRAY_BUFFER, mStreamVbo.handle());
+  countUpload(numBytes);
+
+  return id;
+}
+
+
+void Renderer::destroyParticleGroup(const int id) {
+  assert(id >= 0 && id < int(MAX_PARTICLE_GROUPS));
+  mFreeParticleGroups.push_back(id);
+}
+
+
+void Renderer::drawParticleGroup(
+  const int id,
+  const base::Vector& origin,
+  const int framesElapsed,
+  const base::Color& color
+) {
+  const auto offset = id * PARTICLE_GROUP_DATA_SIZE;
+
+  if (isRecording()) {
+    const auto& visibleRect = fullScreenRect();
+
+    for (auto i = std::size_t{0}; i < PARTICLES_PER_GROUP; ++i) {
+      const auto velocityX = mParticleData[offset + i * PARTICLE_VERTEX_SIZE];
+      const auto index = mParticleData[offset + i * PARTICLE_VERTEX_SIZE + 1];
+      const auto position = origin + base::Vector{
+        velocityX * framesElapsed,
+        int(mParticleMovementTable[index + framesElapsed]) -
+          int(mParticleMovementTable[index])};
+
+      if (visibleRect.containsPoint(position)) {
+        record(makeDrawCommand(
+          DrawCommand::Type::Point, {position, {0, 0}}, 0, {}, color));
+      }
+    }
+  }
+
+  setRenderModeIfChanged(RenderMode::ParticleGroup);
+
+  mParticleShader.setUniform("origin", glm::vec2{origin.x, origin.y});
+  mParticleShader.setUniform("framesElapsed", framesElapsed);
+  mParticleShader.setUniform("color", toGlColor(color));
+
+  if (!isSkippingGpuDrawing()) {
+    glDrawArrays(
+      GL_POINTS,
+      GLint(offset / PARTICLE_VERTEX_SIZE),
+      GLsizei(PARTICLES_PER_GROUP));
+  }
+
+  // The uniforms are specific to this draw, so it counts as its own batch
+  auto& stats = mCurrentFrameStatistics;
+  ++stats.mBatchesByFlushReason[
+    static_cast<std::size_t>(BatchFlushReason::UniformChange)];
+  ++stats.mDrawCalls;
+  stats.mPoints += int(PARTICLES_PER_GROUP);
+  stats.mVerticesDrawn += PARTICLES_PER_GROUP;
+  ++mContentVersion;
+
+  if (isRecording()) {
+    mpRecording->mBatches.push_back(
+      {BatchFlushReason::UniformChange, PARTICLES_PER_GROUP});
+  }
+}
+
+#endif
+
+
 void Renderer::setGlobalTranslation(const base::Vector& translation) {
   const auto glTranslation = glm::vec2{translation.x, translation.y};
   if (glTranslation != mGlobalTranslation) {
-    submitBatch();
+    flushBatch(BatchFlushReason::TransformChange);
 
     mGlobalTranslation = glTranslation;
     updateProjectionMatrix();
@@ -687,7 +1853,7 @@ base::Vector Renderer::globalTranslation() const {
 void Renderer::setGlobalScale(const base::Point<float>& scale) {
   const auto glScale = glm::vec2{scale.x, scale.y};
   if (glScale != mGlobalScale) {
-    submitBatch();
+    flushBatch(BatchFlushReason::TransformChange);
 
     mGlobalScale = glScale;
     glPointSize(std::min(scale.x, scale.y));
@@ -732,7 +1898,7 @@ void Renderer::setRenderTarget(const RenderTarget& target) {
     return;
   }
 
-  submitBatch();
+  flushBatch(BatchFlushReason::RenderTargetChange);
 
   if (!target.isDefault()) {
     mCurrentFramebufferSize = target.mSize;
@@ -748,52 +1914,80 @@ void Renderer::setRenderTarget(const RenderTarget& target) {
 
 
 void Renderer::swapBuffers() {
-  submitBatch();
+  flushBatch(BatchFlushReason::EndOfFrame);
+  mGpuProfiler.nextFrame();
   SDL_GL_SwapWindow(mpWindow);
+
+  mLastFrameStatistics = mCurrentFrameStatistics;
+  mCurrentFrameStatistics = {};
+
+  mStreamVbo.nextFrame();
+#ifndef RIGEL_USE_GL_ES
+  mInstanceBuffer.nextFrame();
+
+  // Textures might have been deleted in the meantime, and their handles
+  // reused. Starting from scratch each frame keeps us from relying on stale
+  // bindings for too long.
+  mNumExtraBatchTextures = 0;
+#endif
+}
+
+
+void Renderer::flushCommands() {
+  submitBatch();
+
+  if (!isSkippingGpuDrawing()) {
+    glFlush();
+  }
 }
 
 
 void Renderer::clear(const base::Color& clearColor) {
+  if (isRecording()) {
+    record(makeDrawCommand(
+      DrawCommand::Type::Clear, fullScreenRect(), 0, {}, clearColor));
+  }
+
+  if (isSkippingGpuDrawing()) {
+    return;
+  }
+
   const auto glColor = toGlColor(clearColor);
   glClearColor(glColor.r, glColor.g, glColor.b, glColor.a);
   glClear(GL_COLOR_BUFFER_BIT);
+  ++mContentVersion;
 }
 
 
 template <typename VertexIter>
 void Renderer::batchQuadVertices(
   VertexIter&& dataBegin,
-  VertexIter&& dataEnd,
-  const std::size_t attributesPerVertex
+  VertexIter&& dataEnd
 ) {
   using namespace std;
 
-  const auto currentIndex = GLushort(mBatchData.size() / attributesPerVertex);
-
-  GLushort indices[6];
-  transform(
-    cbegin(QUAD_INDICES),
-    cend(QUAD_INDICES),
-    begin(indices),
-    [&](const GLushort index) -> GLushort {
-      return index + currentIndex;
-    });
+  if (mNumBatchedQuads == MAX_QUADS_PER_BATCH) {
+    flushBatch(BatchFlushReason::BatchFull);
+  }
 
-  // TODO: Limit maximum batch size
   mBatchData.insert(
     mBatchData.end(),
     forward<VertexIter>(dataBegin),
     forward<VertexIter>(dataEnd));
-  mBatchIndices.insert(mBatchIndices.end(), cbegin(indices), cend(indices));
+  ++mNumBatchedQuads;
 }
 
 
 void Renderer::setRenderModeIfChanged(const RenderMode mode) {
   if (mRenderMode != mode) {
-    submitBatch();
+    flushBatch(BatchFlushReason::RenderModeChange);
 
     mRenderMode = mode;
     updateShaders();
+
+#ifndef RIGEL_USE_GL_ES
+    mVertexArrays[static_cast<std::size_t>(mode)].bind();
+#endif
   }
 }
 
@@ -801,72 +1995,232 @@ void Renderer::setRenderModeIfChanged(const RenderMode mode) {
 void Renderer::updateShaders() {
   switch (mRenderMode) {
     case RenderMode::SpriteBatch:
+#ifdef RIGEL_USE_GL_ES
+      if (colorsAreIdentity()) {
+        useShaderIfChanged(mPlainTexturedQuadShader);
+        mPlainTexturedQuadShader.setUniform("transform", mProjectionMatrix);
+        break;
+      }
+#endif
+
       useShaderIfChanged(mTexturedQuadShader);
       mTexturedQuadShader.setUniform("transform", mProjectionMatrix);
+#ifdef RIGEL_USE_GL_ES
+      mTexturedQuadShader.setUniform(
+        "overlayColor", toGlColor(mLastOverlayColor));
+      mTexturedQuadShader.setUniform(
+        "colorModulation", toGlColor(mLastColorModulation));
+#endif
+      break;
+
+    case RenderMode::IndexedSpriteBatch:
+      if (colorsAreIdentity()) {
+        useShaderIfChanged(mPlainIndexedQuadShader);
+        mPlainIndexedQuadShader.setUniform("transform", mProjectionMatrix);
+        break;
+      }
+
+      useShaderIfChanged(mIndexedQuadShader);
+      mIndexedQuadShader.setUniform("transform", mProjectionMatrix);
+      mIndexedQuadShader.setUniform(
+        "overlayColor", toGlColor(mLastOverlayColor));
+      mIndexedQuadShader.setUniform(
+        "colorModulation", toGlColor(mLastColorModulation));
+      break;
+
+    case RenderMode::Points:
+    case RenderMode::NonTexturedRender:
+      useShaderIfChanged(mSolidColorShader);
+      mSolidColorShader.setUniform("transform", mProjectionMatrix);
+      break;
+
+    case RenderMode::WaterEffect:
+      useShaderIfChanged(mWaterEffectShader);
+      mWaterEffectShader.setUniform("transform", mProjectionMatrix);
+      break;
+
+#ifndef RIGEL_USE_GL_ES
+    case RenderMode::TileMap:
+      useShaderIfChanged(mTileMapShader);
+      mTileMapShader.setUniform("transform", mProjectionMatrix);
+      break;
+
+    case RenderMode::ParticleGroup:
+      useShaderIfChanged(mParticleShader);
+      mParticleShader.setUniform("transform", mProjectionMatrix);
+      mParticleShader.setUniform(
+        "movementTable", mParticleMovementTable);
+      break;
+#endif
+  }
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void Renderer::submitSpriteInstances() {
+  const auto offset = mInstanceBuffer.upload(
+    mBatchData.data(), sizeof(float) * mBatchData.size());
+  mTexturedQuadShader.setUniform(
+    "instanceOffset", int(offset / INSTANCE_BUFFER_TEXEL_SIZE));
+
+  glDrawArraysInstanced(
+    GL_TRIANGLE_STRIP,
+    0,
+    GLsizei(VERTICES_PER_QUAD),
+    GLsizei(mNumBatchedQuads));
+}
+
+#endif
+
+
+GLint Renderer::uploadBatchVertices() {
+  const auto floatsPerVertex =
+    mRenderMode == RenderMode::Points ||
+    mRenderMode == RenderMode::NonTexturedRender ||
+    mRenderMode == RenderMode::WaterEffect
+    ? std::size_t{6}
+    : std::size_t{4};
+  const auto vertexSize = sizeof(float) * floatsPerVertex;
+
+  const auto offset = mStreamVbo.upload(
+    mBatchData.data(), sizeof(float) * mBatchData.size(), vertexSize);
+
+#ifdef RIGEL_USE_GL_ES
+  // Without VAOs and base vertex support, we need to point the attributes
+  // at the freshly uploaded data instead
+  setVertexLayout(mRenderMode, offset);
+  return 0;
+#else
+  if (mStreamVbo.handle() != mVertexArraysVbo) {
+    setUpVertexArrays();
+  }
+
+  return GLint(offset / vertexSize);
+#endif
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void Renderer::setUpVertexArrays() {
+  mVertexArraysVbo = mStreamVbo.handle();
+
+  for (auto i = std::size_t{0}; i < NUM_RENDER_MODES; ++i) {
+    const auto mode = static_cast<RenderMode>(i);
+
+    mVertexArrays[i].bind();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mQuadIndicesEbo);
+
+    // The instanced shader doesn't use any vertex attributes, so we must not
+    // have any arrays enabled which might point past the end of the VBO.
+    if (mode != RenderMode::SpriteBatch) {
+      setVertexLayout(mode, 0);
+    }
+  }
+
+  mVertexArrays[static_cast<std::size_t>(mRenderMode)].bind();
+}
+
+#endif
+
+
+void Renderer::setVertexLayout(
+  const RenderMode mode,
+  const std::size_t baseOffset
+) {
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+
+  switch (mode) {
+    case RenderMode::SpriteBatch:
+    case RenderMode::IndexedSpriteBatch:
+#ifndef RIGEL_USE_GL_ES
+    case RenderMode::TileMap:
+#endif
       glVertexAttribPointer(
         0,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 4,
-        toAttribOffset(0));
+        toAttribOffset(baseOffset));
       glVertexAttribPointer(
         1,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 4,
-        toAttribOffset(2 * sizeof(float)));
+        toAttribOffset(baseOffset + 2 * sizeof(float)));
       glDisableVertexAttribArray(2);
       break;
 
     case RenderMode::Points:
     case RenderMode::NonTexturedRender:
-      useShaderIfChanged(mSolidColorShader);
-      mSolidColorShader.setUniform("transform", mProjectionMatrix);
       glVertexAttribPointer(
         0,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 6,
-        toAttribOffset(0));
+        toAttribOffset(baseOffset));
       glVertexAttribPointer(
         1,
         4,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 6,
-        toAttribOffset(2 * sizeof(float)));
+        toAttribOffset(baseOffset + 2 * sizeof(float)));
       glDisableVertexAttribArray(2);
       break;
 
     case RenderMode::WaterEffect:
-      useShaderIfChanged(mWaterEffectShader);
-      mWaterEffectShader.setUniform("transform", mProjectionMatrix);
       glVertexAttribPointer(
         0,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 6,
-        toAttribOffset(0));
+        toAttribOffset(baseOffset));
       glVertexAttribPointer(
         1,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 6,
-        toAttribOffset(2 * sizeof(float)));
+        toAttribOffset(baseOffset + 2 * sizeof(float)));
       glVertexAttribPointer(
         2,
         2,
         GL_FLOAT,
         GL_FALSE,
         sizeof(float) * 6,
-        toAttribOffset(4 * sizeof(float)));
+        toAttribOffset(baseOffset + 4 * sizeof(float)));
       glEnableVertexAttribArray(2);
       break;
+
+#ifndef RIGEL_USE_GL_ES
+    case RenderMode::ParticleGroup:
+      // Uses its own static VBO instead of the streaming one, groups are
+      // selected via the first vertex in drawParticleGroup()
+      {
+        constexpr auto stride = sizeof(std::int16_t) * PARTICLE_VERTEX_SIZE;
+
+        glBindBuffer(GL_ARRAY_BUFFER, mParticleVbo);
+        glVertexAttribPointer(
+          0, 1, GL_SHORT, GL_FALSE, stride, toAttribOffset(baseOffset));
+        glVertexAttribPointer(
+          1,
+          1,
+          GL_SHORT,
+          GL_FALSE,
+          stride,
+          toAttribOffset(baseOffset + sizeof(std::int16_t)));
+        glDisableVertexAttribArray(2);
+        glBindBuffer(GL_ARRAY_BUFFER, mStreamVbo.handle());
+      }
+      break;
+#endif
   }
 }
 
@@ -875,8 +2229,24 @@ Renderer::RenderTargetHandles Renderer::createRenderTargetTexture(
   const int width,
   const int height
 ) {
-  const auto textureHandle =
-    createGlTexture(GLsizei(width), GLsizei(height), nullptr);
+  const auto size = base::Size<int>{width, height};
+
+  // Prefer the most recently released target, it's the least likely to be
+  // evicted from the pool next
+  const auto iPooled = std::find_if(
+    mRenderTargetPool.rbegin(),
+    mRenderTargetPool.rend(),
+    [&](const PooledRenderTarget& entry) { return entry.mSize == size; });
+  if (iPooled != mRenderTargetPool.rend()) {
+    const auto handles = iPooled->mHandles;
+    mRenderTargetPool.erase(std::next(iPooled).base());
+    mPooledRenderTargetBytes.resize(
+      mPooledRenderTargetBytes.size() - std::size_t(width) * height * 4);
+    return handles;
+  }
+
+  const auto textureHandle = createGlTexture(
+    GLsizei(width), GLsizei(height), GL_RGBA, GL_RGBA, nullptr);
   glBindTexture(GL_TEXTURE_2D, textureHandle);
 
   GLuint fboHandle;
@@ -896,54 +2266,248 @@ Renderer::RenderTargetHandles Renderer::createRenderTargetTexture(
 }
 
 
-auto Renderer::createTexture(const data::Image& image) -> TextureData {
-  // OpenGL wants pixel data in bottom-up format, so transform it accordingly
-  std::vector<std::uint8_t> pixelData;
-  pixelData.resize(image.width() * image.height() * 4);
-  for (std::size_t y = 0; y < image.height(); ++y) {
-    const auto sourceRow = image.height() - (y + 1);
-    const auto yOffsetSource = image.width() * sourceRow;
-    const auto yOffset = y * image.width() * 4;
-
-    for (std::size_t x = 0; x < image.width(); ++x) {
-      const auto& pixel = image.pixelData()[x + yOffsetSource];
-      pixelData[x*4 +     yOffset] = pixel.r;
-      pixelData[x*4 + 1 + yOffset] = pixel.g;
-      pixelData[x*4 + 2 + yOffset] = pixel.b;
-      pixelData[x*4 + 3 + yOffset] = pixel.a;
+void Renderer::releaseRenderTargetTexture(
+  const RenderTargetHandles& handles,
+  const int width,
+  const int height
+) {
+  mRenderTargetPool.push_back({handles, {width, height}});
+  trimRenderTargetPool();
+}
+
+
+void Renderer::trimRenderTargetPool() {
+  auto pooledBytes = [this]() {
+    auto result = std::size_t{0};
+    for (const auto& entry : mRenderTargetPool) {
+      result += std::size_t(entry.mSize.width) * entry.mSize.height * 4;
     }
+
+    return result;
+  };
+
+  // Pooled targets are the first thing to go when we're over the memory
+  // budget, since they can always be recreated
+  while (
+    mRenderTargetPool.size() > MAX_POOLED_RENDER_TARGETS ||
+    (!mRenderTargetPool.empty() &&
+     (pooledBytes() > MAX_POOLED_RENDER_TARGET_BYTES ||
+      base::memory_accounting::isOverBudget()))
+  ) {
+    const auto& oldest = mRenderTargetPool.front();
+    glDeleteFramebuffers(1, &oldest.mHandles.fbo);
+    glDeleteTextures(1, &oldest.mHandles.texture);
+    mRenderTargetPool.erase(mRenderTargetPool.begin());
+    mPooledRenderTargetBytes.resize(pooledBytes());
   }
 
+  mPooledRenderTargetBytes.resize(pooledBytes());
+}
+
+
+auto Renderer::createTexture(const data::Image& image) -> TextureData {
+  static_assert(sizeof(data::Pixel) == 4);
+
+  // data::Image already holds tightly packed RGBA8 pixels, so we can
+  // upload them as is. The resulting texture is stored top-down.
   auto handle = createGlTexture(
     GLsizei(image.width()),
     GLsizei(image.height()),
-    pixelData.data());
-  return {int(image.width()), int(image.height()), handle};
+    GL_RGBA,
+    GL_RGBA,
+    image.pixelData().data());
+  countUpload(image.pixelData().size() * sizeof(data::Pixel));
+  return {int(image.width()), int(image.height()), handle, false, true};
 }
 
 
-GLuint Renderer::createGlTexture(
-  const GLsizei width,
-  const GLsizei height,
-  const GLvoid* const pData
+auto Renderer::createTextures(base::ArrayView<data::Image> images)
+  -> std::vector<TextureData>
+{
+  std::vector<GLuint> handles(images.size(), 0);
+  glGenTextures(GLsizei(handles.size()), handles.data());
+
+  std::vector<TextureData> result;
+  result.reserve(images.size());
+
+  for (std::size_t i = 0; i < images.size(); ++i) {
+    const auto& image = images[i];
+
+    glBindTexture(GL_TEXTURE_2D, handles[i]);
+    setDefaultTextureParameters();
+    glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_RGBA,
+      GLsizei(image.width()),
+      GLsizei(image.height()),
+      0,
+      GL_RGBA,
+      GL_UNSIGNED_BYTE,
+      image.pixelData().data());
+    countUpload(image.pixelData().size() * sizeof(data::Pixel));
+
+    result.emplace_back(
+      int(image.width()), int(image.height()), handles[i], false, true);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+
+  return result;
+}
+
+
+auto Renderer::createIndexedTexture(
+  const data::Image& image,
+  const loader::Palette16& palette
+) -> TextureData {
+  const auto indexData = toIndexData(image, palette);
+
+  // Rows are tightly packed single bytes
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  auto handle = createGlTexture(
+    GLsizei(image.width()),
+    GLsizei(image.height()),
+    INDEXED_TEXTURE_INTERNAL_FORMAT,
+    INDEXED_TEXTURE_FORMAT,
+    indexData.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  countUpload(indexData.size());
+
+  return {int(image.width()), int(image.height()), handle, true, true};
+}
+
+
+void Renderer::updateTextureRegion(
+  const TextureData& textureData,
+  const base::Vector& position,
+  const data::Image& image
 ) {
+  assert(
+    position.x >= 0 &&
+    position.y >= 0 &&
+    position.x + int(image.width()) <= textureData.mWidth &&
+    position.y + int(image.height()) <= textureData.mHeight);
+
+  // Render targets are stored bottom-up, we can't copy images into those
+  // without flipping them first
+  assert(textureData.mIsTopDown);
+
+  glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
+  glTexSubImage2D(
+    GL_TEXTURE_2D,
+    0,
+    position.x,
+    position.y,
+    GLsizei(image.width()),
+    GLsizei(image.height()),
+    GL_RGBA,
+    GL_UNSIGNED_BYTE,
+    image.pixelData().data());
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+
+  countUpload(image.pixelData().size() * sizeof(data::Pixel));
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void Renderer::enableTextureRepeat(const TextureData& textureData) {
+  glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+}
+
+
+auto Renderer::createTileMapTexture(
+  const int width,
+  const int height,
+  const std::uint16_t* pData
+) -> TextureData {
   GLuint handle = 0;
   glGenTextures(1, &handle);
 
+  // Integer textures can't be filtered, so nearest sampling is required
   glBindTexture(GL_TEXTURE_2D, handle);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+  // Rows are tightly packed 16-bit values
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
   glTexImage2D(
     GL_TEXTURE_2D,
     0,
-    GL_RGBA,
+    GL_R16UI,
     width,
     height,
     0,
-    GL_RGBA,
+    GL_RED_INTEGER,
+    GL_UNSIGNED_SHORT,
+    pData);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+
+  countUpload(sizeof(std::uint16_t) * width * height);
+
+  return {width, height, handle};
+}
+
+
+void Renderer::updateTileMapTexture(
+  const TextureData& textureData,
+  const base::Rect<int>& region,
+  const std::uint16_t* pData
+) {
+  // A draw call using the texture might still be pending
+  submitBatch();
+
+  glBindTexture(GL_TEXTURE_2D, textureData.mHandle);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexSubImage2D(
+    GL_TEXTURE_2D,
+    0,
+    region.topLeft.x,
+    region.topLeft.y,
+    region.size.width,
+    region.size.height,
+    GL_RED_INTEGER,
+    GL_UNSIGNED_SHORT,
+    pData);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
+
+  countUpload(
+    sizeof(std::uint16_t) * region.size.width * region.size.height);
+}
+
+#endif
+
+
+GLuint Renderer::createGlTexture(
+  const GLsizei width,
+  const GLsizei height,
+  const GLint internalFormat,
+  const GLenum format,
+  const GLvoid* const pData
+) {
+  GLuint handle = 0;
+  glGenTextures(1, &handle);
+
+  glBindTexture(GL_TEXTURE_2D, handle);
+  setDefaultTextureParameters();
+
+  glTexImage2D(
+    GL_TEXTURE_2D,
+    0,
+    internalFormat,
+    width,
+    height,
+    0,
+    format,
     GL_UNSIGNED_BYTE,
     pData);
   glBindTexture(GL_TEXTURE_2D, mLastUsedTexture);
@@ -953,6 +2517,35 @@ GLuint Renderer::createGlTexture(
 
 
 
+void Renderer::setDrawCommandRecording(DrawCommandRecording* pRecording) {
+  // Anything drawn so far belongs to the previous recording (if any)
+  submitBatch();
+  mpRecording = pRecording;
+}
+
+
+bool Renderer::isSkippingGpuDrawing() const {
+  return mpRecording && mpRecording->mSkipGpuDrawing;
+}
+
+
+void Renderer::record(DrawCommand command) {
+  command.mColorModulation = mLastColorModulation;
+  command.mOverlayColor = mLastOverlayColor;
+  command.mClipRect = mClipRect;
+  command.mGlobalTranslation = globalTranslation();
+  command.mGlobalScale = globalScale();
+  command.mRenderTarget = mCurrentFbo;
+
+  mpRecording->mCommands.push_back(command);
+}
+
+
+void Renderer::countUpload(const std::size_t numBytes) {
+  mCurrentFrameStatistics.mBytesUploaded += numBytes;
+}
+
+
 void Renderer::useShaderIfChanged(Shader& shader) {
   if (shader.handle() != mLastUsedShader) {
     shader.use();
@@ -961,12 +2554,52 @@ void Renderer::useShaderIfChanged(Shader& shader) {
 }
 
 
-bool Renderer::isVisible(const base::Rect<int>& rect) const {
-  return rect.intersects(fullScreenRect());
+bool Renderer::isVisible(const base::Rect<int>& rect) {
+  // The rect is given in local coordinates, which the vertex shader
+  // transforms into framebuffer coordinates using the global translation and
+  // scale. Anything outside of the clip rect is discarded by the scissor test,
+  // so it doesn't need to be drawn either.
+  const auto x1 = mGlobalTranslation.x + rect.left() * mGlobalScale.x;
+  const auto x2 = x1 + rect.size.width * mGlobalScale.x;
+  const auto y1 = mGlobalTranslation.y + rect.top() * mGlobalScale.y;
+  const auto y2 = y1 + rect.size.height * mGlobalScale.y;
+
+  auto visibleArea = fullScreenRect();
+  if (mClipRect) {
+    const auto left = std::max(visibleArea.left(), mClipRect->left());
+    const auto top = std::max(visibleArea.top(), mClipRect->top());
+    const auto right = std::min(
+      visibleArea.left() + visibleArea.size.width,
+      mClipRect->left() + mClipRect->size.width);
+    const auto bottom = std::min(
+      visibleArea.top() + visibleArea.size.height,
+      mClipRect->top() + mClipRect->size.height);
+    visibleArea = {{left, top}, {right - left, bottom - top}};
+  }
+
+  const auto isVisible =
+    rect.size.width > 0 &&
+    rect.size.height > 0 &&
+    std::max(x1, x2) > visibleArea.left() &&
+    std::min(x1, x2) < visibleArea.left() + visibleArea.size.width &&
+    std::max(y1, y2) > visibleArea.top() &&
+    std::min(y1, y2) < visibleArea.top() + visibleArea.size.height;
+
+  if (!isVisible) {
+    ++mCurrentFrameStatistics.mCulledDraws;
+  }
+
+  return isVisible;
 }
 
 
 void Renderer::onRenderTargetChanged() {
+#ifndef RIGEL_USE_GL_ES
+  // The new render target's texture might still be bound to one of the
+  // extra slots. It must not be sampled while drawing into it.
+  mNumExtraBatchTextures = 0;
+#endif
+
   glBindFramebuffer(GL_FRAMEBUFFER, mCurrentFbo);
   glViewport(0, 0, mCurrentFramebufferSize.width, mCurrentFramebufferSize.height);
 
@@ -992,4 +2625,37 @@ void Renderer::updateProjectionMatrix() {
   updateShaders();
 }
 
+
+const char* batchFlushReasonName(const Renderer::BatchFlushReason reason) {
+  using R = Renderer::BatchFlushReason;
+
+  switch (reason) {
+    case R::Explicit:
+      return "Explicit";
+
+    case R::TextureChange:
+      return "Texture change";
+
+    case R::RenderModeChange:
+      return "Render mode change";
+
+    case R::UniformChange:
+      return "Uniform change";
+
+    case R::TransformChange:
+      return "Transform change";
+
+    case R::RenderTargetChange:
+      return "Render target change";
+
+    case R::BatchFull:
+      return "Batch full";
+
+    case R::EndOfFrame:
+      return "End of frame";
+  }
+
+  return "Unknown";
+}
+
 }
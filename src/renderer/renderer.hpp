@@ -16,25 +16,52 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
 #include "base/color.hpp"
+#include "base/memory_accounting.hpp"
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "data/image.hpp"
+#include "loader/palette.hpp"
+#include "renderer/gpu_profiler.hpp"
 #include "renderer/opengl.hpp"
 #include "renderer/shader.hpp"
+#include "renderer/streaming_buffer.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <glm/mat4x4.hpp>
 #include <SDL_video.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <tuple>
+#include <vector>
 
 
 namespace rigel::renderer {
 
+struct DrawCommand;
+struct DrawCommandRecording;
+
+
+#ifndef RIGEL_USE_GL_ES
+
+// Layout of a texel in a tile map texture, see Renderer::drawTileMap()
+constexpr auto TILE_MAP_INDEX_MASK = std::uint16_t{0x07FF};
+constexpr auto TILE_MAP_FOREGROUND_FLAG = std::uint16_t{1 << 13};
+constexpr auto TILE_MAP_ANIMATED_FLAG = std::uint16_t{1 << 14};
+constexpr auto TILE_MAP_FAST_ANIMATION_FLAG = std::uint16_t{1 << 15};
+
+// Limits for GPU side particle groups, see Renderer::createParticleGroup()
+constexpr auto PARTICLES_PER_GROUP = std::size_t{64};
+constexpr auto MAX_PARTICLE_GROUPS = std::size_t{128};
+constexpr auto MAX_PARTICLE_MOVEMENT_TABLE_SIZE = std::size_t{64};
+
+#endif
+
+
 class Renderer {
 public:
   // TODO: Re-evaluate how render targets work
@@ -64,16 +91,33 @@ public:
 
   struct TextureData {
     TextureData() = default;
-    TextureData(const int width, const int height, const GLuint handle)
+    TextureData(
+      const int width,
+      const int height,
+      const GLuint handle,
+      const bool isIndexed = false,
+      const bool isTopDown = false)
       : mWidth(width)
       , mHeight(height)
       , mHandle(handle)
+      , mIsIndexed(isIndexed)
+      , mIsTopDown(isTopDown)
     {
     }
 
     int mWidth = 0;
     int mHeight = 0;
     GLuint mHandle = 0;
+
+    /** Texture holds palette indices, see createIndexedTexture() */
+    bool mIsIndexed = false;
+
+    /** Rows are stored top-down, like in data::Image
+     *
+     * This is the case for all textures created from images. Render targets
+     * are stored bottom-up instead, since that's how OpenGL renders them.
+     */
+    bool mIsTopDown = false;
   };
 
   struct RenderTargetHandles {
@@ -81,6 +125,55 @@ public:
     GLuint fbo;
   };
 
+  /** Why a batch was submitted, see FrameStatistics */
+  enum class BatchFlushReason {
+    Explicit,
+    TextureChange,
+    RenderModeChange,
+    UniformChange,
+    TransformChange,
+    RenderTargetChange,
+    BatchFull,
+    EndOfFrame
+  };
+
+  static constexpr auto NUM_BATCH_FLUSH_REASONS =
+    static_cast<std::size_t>(BatchFlushReason::EndOfFrame) + 1;
+
+  /** Counters for the work done in a frame, see lastFrameStatistics() */
+  struct FrameStatistics {
+    /** Submitted batches, indexed by BatchFlushReason
+     *
+     * Each batch results in exactly one draw call, so these add up to
+     * mDrawCalls.
+     */
+    std::array<int, NUM_BATCH_FLUSH_REASONS> mBatchesByFlushReason{};
+
+    int mDrawCalls = 0;
+    int mTextureBinds = 0;
+    int mQuads = 0;
+    int mPoints = 0;
+
+    /** Draw requests which were skipped since they were off screen */
+    int mCulledDraws = 0;
+
+    std::size_t mVerticesDrawn = 0;
+
+    /** Vertex, instance and texture data sent to the GPU */
+    std::size_t mBytesUploaded = 0;
+  };
+
+#ifndef RIGEL_USE_GL_ES
+  struct TileMapParams {
+    TextureData mTileSet;
+    std::array<TextureData, 2> mLayers;
+    base::Vector mMapOffsetPx;
+    int mFastAnimOffset = 0;
+    int mSlowAnimOffset = 0;
+    bool mDrawForeground = false;
+  };
+#endif
+
 
   class StateSaver {
   public:
@@ -135,6 +228,31 @@ public:
   };
 
 
+  /** Measures GPU time for everything drawn during the scope's lifetime
+   *
+   * See GpuProfiler. Scopes must not be nested.
+   */
+  class GpuTimerScope {
+  public:
+    GpuTimerScope(Renderer* pRenderer, const char* pName)
+      : mpRenderer(pRenderer)
+    {
+      mpRenderer->beginGpuTimerSection(pName);
+    }
+
+    ~GpuTimerScope() {
+      mpRenderer->endGpuTimerSection();
+    }
+
+    GpuTimerScope(const GpuTimerScope&) = delete;
+    GpuTimerScope& operator=(const GpuTimerScope&) = delete;
+
+  private:
+    Renderer* mpRenderer;
+  };
+
+
+  /** pWindow may be null when using loadNullGlFunctions() */
   explicit Renderer(SDL_Window* pWindow);
   ~Renderer();
 
@@ -146,11 +264,30 @@ public:
   void setOverlayColor(const base::Color& color);
   void setColorModulation(const base::Color& colorModulation);
 
+  /** Set the palette used for drawing indexed textures
+   *
+   * Changing the palette only updates a small lookup texture, so all
+   * indexed textures change their colors without needing to be re-created.
+   */
+  void setPalette(const loader::Palette16& palette);
+
   void drawTexture(
     const TextureData& textureData,
     const base::Rect<int>& pSourceRect,
     const base::Rect<int>& pDestRect);
 
+  struct TexturedQuad {
+    base::Rect<int> mSourceRect;
+    base::Rect<int> mDestRect;
+  };
+
+  /** Draw many parts of the same texture, same result as calling
+   * drawTexture() for each of them
+   */
+  void drawTextures(
+    const TextureData& textureData,
+    base::ArrayView<TexturedQuad> quads);
+
   void drawRectangle(
     const base::Rect<int>& rect,
     const base::Color& color);
@@ -170,14 +307,102 @@ public:
     int y2,
     const base::Color& color);
 
+  /** Draw many lines of the same color, same result as calling drawLine()
+   * for each of them
+   *
+   * endPoints holds the start and end point of each line, one after the
+   * other.
+   */
+  void drawLines(
+    base::ArrayView<base::Vector> endPoints,
+    const base::Color& color);
+
 
   void drawPoint(const base::Vector& position, const base::Color& color);
 
+  /** Draw many points of the same color, same result as calling drawPoint()
+   * for each of them
+   */
+  void drawPoints(
+    base::ArrayView<base::Vector> positions,
+    const base::Color& color);
+
+#ifndef RIGEL_USE_GL_ES
+  /** Set the vertical offsets used for drawing particle groups
+   *
+   * At most MAX_PARTICLE_MOVEMENT_TABLE_SIZE entries.
+   */
+  void setParticleMovementTable(base::ArrayView<std::int16_t> table);
+
+  /** Upload the static data for a group of PARTICLES_PER_GROUP particles
+   *
+   * Particles move on a fixed trajectory, which is computed on the GPU by
+   * drawParticleGroup(). So after creating a group, drawing it doesn't
+   * require any vertex uploads. The returned id must be released using
+   * destroyParticleGroup() once the group isn't needed anymore. If
+   * MAX_PARTICLE_GROUPS groups exist already, nothing is returned.
+   */
+  std::optional<int> createParticleGroup(
+    base::ArrayView<std::int16_t> velocitiesX,
+    base::ArrayView<std::int16_t> initialOffsetIndices);
+
+  void destroyParticleGroup(int id);
+
+  /** Draw all particles of a group as points
+   *
+   * Particle i is drawn at:
+   *
+   *   origin + (velocitiesX[i] * framesElapsed,
+   *             table[initialOffsetIndices[i] + framesElapsed] -
+   *             table[initialOffsetIndices[i]])
+   *
+   * Recorded as the individual points, exactly like drawPoint() would
+   * record them.
+   */
+  void drawParticleGroup(
+    int id,
+    const base::Vector& origin,
+    int framesElapsed,
+    const base::Color& color);
+#endif
+
+  /** Copy a render target's contents into the current render target
+   *
+   * The source must have the same size as the current render target. On
+   * desktop GL, this is done using glBlitFramebuffer(), which skips the
+   * shader and blending work needed for drawing a textured quad. Global
+   * translation, scale and color modulation don't apply to the copy.
+   * GL ES 2.0 doesn't support blits, so the source texture is drawn as a
+   * regular quad there.
+   */
+  void blitRenderTarget(
+    const RenderTarget& source,
+    const TextureData& sourceTexture);
+
   void drawWaterEffect(
     const base::Rect<int>& area,
     TextureData unprocessedScreen,
     std::optional<int> surfaceAnimationStep);
 
+#ifndef RIGEL_USE_GL_ES
+  /** Draw both layers of a tile map section with a single quad
+   *
+   * Each layer is given as a tile map texture (see createTileMapTexture()),
+   * holding one texel per map tile. A texel contains the tile index in the
+   * bits given by TILE_MAP_INDEX_MASK, plus the TILE_MAP_..._FLAG bits.
+   * Tile index 0 is treated as transparent.
+   *
+   * The fragment shader looks up the tile for each pixel of destRect,
+   * applies the animation offset for animated tiles, and draws only tiles
+   * whose foreground flag matches mDrawForeground. mMapOffsetPx gives the
+   * position within the map (in pixels) that appears at destRect's top-left
+   * corner.
+   */
+  void drawTileMap(
+    const base::Rect<int>& destRect,
+    const TileMapParams& params);
+#endif
+
   void setGlobalTranslation(const base::Vector& translation);
   base::Vector globalTranslation() const;
 
@@ -195,71 +420,304 @@ public:
 
   void submitBatch();
 
+  /** Submit the current batch and make the driver start executing it
+   *
+   * Doesn't wait for the GPU. Meant for handing over a finished part of the
+   * frame early, so that the GPU can work on it while the CPU prepares the
+   * rest of the frame.
+   */
+  void flushCommands();
+
+  /** Start measuring GPU time for a section of the frame
+   *
+   * Submits the current batch first, so that previously drawn things aren't
+   * attributed to the new section. Does nothing unless GPU profiling has been
+   * enabled via gpuProfiler().
+   */
+  void beginGpuTimerSection(const char* pName);
+  void endGpuTimerSection();
+
+  GpuProfiler& gpuProfiler() {
+    return mGpuProfiler;
+  }
+
+  const GpuProfiler& gpuProfiler() const {
+    return mGpuProfiler;
+  }
+
+  /** Counters for the most recently completed frame
+   *
+   * A frame ends with each call to swapBuffers().
+   */
+  const FrameStatistics& lastFrameStatistics() const {
+    return mLastFrameStatistics;
+  }
+
+  /** Counter which changes whenever anything is drawn, cleared or blitted
+   *
+   * Comparing two values tells whether any framebuffer could have been
+   * modified in between. Pending batches only count once submitted.
+   */
+  std::uint64_t contentVersion() const {
+    return mContentVersion;
+  }
+
+  /** Record everything that's drawn into the given recording
+   *
+   * Pass nullptr to stop recording. The recording must stay alive until
+   * then. See DrawCommandRecording.
+   */
+  void setDrawCommandRecording(DrawCommandRecording* pRecording);
+
+  /** Create a texture from the given image
+   *
+   * The image's pixels are uploaded as is, without any intermediate copy.
+   */
   TextureData createTexture(const data::Image& image);
 
+  /** Create one texture per image, like calling createTexture() repeatedly
+   *
+   * Generates all texture handles at once and saves redundant state
+   * changes in between the uploads.
+   */
+  std::vector<TextureData> createTextures(base::ArrayView<data::Image> images);
+
+  /** Create a texture holding one 8-bit palette index per pixel
+   *
+   * Each pixel of the image is mapped to the index of the matching color in
+   * the given palette, fully transparent pixels are kept transparent. When
+   * drawn, the texture's colors are taken from the palette given to
+   * setPalette(). This needs a quarter of the memory of a regular texture.
+   */
+  TextureData createIndexedTexture(
+    const data::Image& image,
+    const loader::Palette16& palette);
+
+  /** Replace part of an existing texture's contents with the given image
+   *
+   * The position refers to the top-left corner of the region to update,
+   * using the same coordinate system as source rects given to drawTexture().
+   */
+  void updateTextureRegion(
+    const TextureData& textureData,
+    const base::Vector& position,
+    const data::Image& image);
+
+#ifndef RIGEL_USE_GL_ES
+  /** Make the texture repeat when sampled outside of its bounds
+   *
+   * Afterwards, source rects given to drawTexture() may extend past the
+   * texture's edges, the texture then wraps around. Not available on GL ES,
+   * since GL ES 2.0 only supports repeating for power-of-two sized textures.
+   */
+  void enableTextureRepeat(const TextureData& textureData);
+
+  /** Create a texture holding one unsigned 16-bit integer per texel
+   *
+   * Unlike regular textures, the data is stored top-down, i.e. the first
+   * row of pData ends up at texel row 0.
+   */
+  TextureData createTileMapTexture(
+    int width,
+    int height,
+    const std::uint16_t* pData);
+
+  void updateTileMapTexture(
+    const TextureData& textureData,
+    const base::Rect<int>& region,
+    const std::uint16_t* pData);
+#endif
+
   // TODO: Revisit the render target API and its use in RenderTargetTexture,
   // there should be a nicer way to do this.
+
+  /** Create a render target, or reuse a previously released one
+   *
+   * Render targets given back via releaseRenderTargetTexture() are kept in
+   * a pool, and handed out again for requests of the same size. Like with
+   * a newly created one, the contents of a reused render target are
+   * undefined.
+   */
   RenderTargetHandles createRenderTargetTexture(
     int width,
     int height);
 
+  /** Return a render target to the pool, see createRenderTargetTexture()
+   *
+   * The pool's size is bounded. If it grows too large, the render targets
+   * which have been released the longest time ago are deleted.
+   */
+  void releaseRenderTargetTexture(
+    const RenderTargetHandles& handles,
+    int width,
+    int height);
+
 private:
-  class DummyVao {
+  enum class RenderMode {
+    SpriteBatch,
+    IndexedSpriteBatch,
+    NonTexturedRender,
+    Points,
+    WaterEffect,
+#ifndef RIGEL_USE_GL_ES
+    TileMap,
+    ParticleGroup
+#endif
+  };
+
 #ifndef RIGEL_USE_GL_ES
+public:
+  /** Number of textures a single sprite batch can draw from */
+  static constexpr auto MAX_BATCH_TEXTURES = std::size_t{4};
+
+private:
+  static constexpr auto NUM_RENDER_MODES =
+    static_cast<std::size_t>(RenderMode::ParticleGroup) + 1;
+
+  /** Vertex array object holding the vertex layout of one render mode
+   *
+   * Attribute pointers refer to the start of the respective buffer. Draw
+   * calls select their data via the first vertex (base vertex) instead of
+   * re-specifying the pointers, so a mode switch only needs a bind.
+   */
+  class VertexArray {
   public:
-    DummyVao() {
-      glGenVertexArrays(1, &mVao);
-      glBindVertexArray(mVao);
+    VertexArray() {
+      glGenVertexArrays(1, &mHandle);
     }
 
-    ~DummyVao() {
-      glDeleteVertexArrays(1, &mVao);
+    ~VertexArray() {
+      glDeleteVertexArrays(1, &mHandle);
     }
 
-    DummyVao(const DummyVao&) = delete;
-    DummyVao& operator=(const DummyVao&) = delete;
+    VertexArray(const VertexArray&) = delete;
+    VertexArray& operator=(const VertexArray&) = delete;
 
-  private:
-    GLuint mVao;
-#endif
-  };
+    void bind() const {
+      glBindVertexArray(mHandle);
+    }
 
-  enum class RenderMode {
-    SpriteBatch,
-    NonTexturedRender,
-    Points,
-    WaterEffect
+  private:
+    GLuint mHandle = 0;
   };
+#endif
 
   template <typename VertexIter>
   void batchQuadVertices(
     VertexIter&& dataBegin,
-    VertexIter&& dataEnd,
-    const std::size_t attributesPerVertex);
+    VertexIter&& dataEnd);
+
+  /** Check if rect overlaps the visible part of the current framebuffer
+   *
+   * The rect is given in local coordinates, i.e. the global translation and
+   * scale are applied before testing. If a clip rect is set, only the area
+   * inside of it is considered visible.
+   *
+   * Counts culled draws in the frame statistics, so it should only be used
+   * for deciding whether to draw something.
+   */
+  bool isVisible(const base::Rect<int>& rect);
+
+  void flushBatch(BatchFlushReason reason);
+  void countUpload(std::size_t numBytes);
+
+  bool isRecording() const {
+    return mpRecording != nullptr;
+  }
+
+  bool isSkippingGpuDrawing() const;
 
-  bool isVisible(const base::Rect<int>& rect) const;
+  /** Fill in the current state, and add command to the recording */
+  void record(DrawCommand command);
 
   void useShaderIfChanged(Shader& shader);
   void setRenderModeIfChanged(RenderMode mode);
   void updateShaders();
+  void setVertexLayout(RenderMode mode, std::size_t baseOffset);
+  GLint uploadBatchVertices();
+#ifndef RIGEL_USE_GL_ES
+  void setUpVertexArrays();
+  void submitSpriteInstances();
+
+  void batchSpriteInstance(
+    const TextureData& textureData,
+    int textureSlot,
+    const base::Rect<int>& sourceRect,
+    const base::Rect<int>& destRect);
+
+  /** Make texture available to the current sprite batch, return its slot
+   *
+   * Flushes the batch if all slots are taken already.
+   */
+  int batchTextureSlot(GLuint handle);
+#endif
+  /** True if the current render mode's shader takes colors from uniforms */
+  bool usesColorUniforms() const;
+
+  /** True if overlay color and color modulation leave colors unchanged */
+  bool colorsAreIdentity() const;
+
   void onRenderTargetChanged();
   void updateProjectionMatrix();
 
   GLuint createGlTexture(
     GLsizei width,
     GLsizei height,
+    GLint internalFormat,
+    GLenum format,
     const GLvoid* const pData);
 
+  struct PooledRenderTarget {
+    RenderTargetHandles mHandles;
+    base::Size<int> mSize;
+  };
+
+  void trimRenderTargetPool();
+
 private:
   SDL_Window* mpWindow;
 
-  DummyVao mDummyVao;
-  GLuint mStreamVbo;
-  GLuint mStreamEbo;
+#ifndef RIGEL_USE_GL_ES
+  std::array<VertexArray, NUM_RENDER_MODES> mVertexArrays;
+
+  // The streaming VBO the vertex arrays were set up with. It can be
+  // replaced when growing, see StreamingBuffer.
+  GLuint mVertexArraysVbo = 0;
+#endif
+  StreamingBuffer mStreamVbo;
+  GLuint mQuadIndicesEbo;
+
+#ifndef RIGEL_USE_GL_ES
+  // On desktop GL, sprites are drawn using instancing. Per-sprite data is
+  // read from this buffer via a buffer texture.
+  StreamingBuffer mInstanceBuffer;
+  GLuint mInstanceBufferTexture = 0;
+
+  // Textures bound to the batch texture units besides unit 0, see
+  // batchTextureSlot()
+  std::array<GLuint, MAX_BATCH_TEXTURES - 1> mExtraBatchTextures{};
+  std::size_t mNumExtraBatchTextures = 0;
+
+  // Static data for particle groups, see createParticleGroup(). A CPU side
+  // copy is kept for draw command recording.
+  GLuint mParticleVbo = 0;
+  std::vector<std::int16_t> mParticleData;
+  std::vector<int> mFreeParticleGroups;
+  std::array<float, MAX_PARTICLE_MOVEMENT_TABLE_SIZE> mParticleMovementTable{};
+#endif
 
   Shader mTexturedQuadShader;
+#ifdef RIGEL_USE_GL_ES
+  Shader mPlainTexturedQuadShader;
+#endif
+  Shader mIndexedQuadShader;
+  Shader mPlainIndexedQuadShader;
   Shader mSolidColorShader;
   Shader mWaterEffectShader;
+#ifndef RIGEL_USE_GL_ES
+  Shader mTileMapShader;
+  Shader mParticleShader;
+#endif
 
   GLuint mLastUsedShader;
   GLuint mLastUsedTexture;
@@ -269,9 +727,17 @@ private:
   RenderMode mRenderMode;
 
   std::vector<GLfloat> mBatchData;
-  std::vector<GLushort> mBatchIndices;
+  std::size_t mNumBatchedQuads = 0;
+
+  // Least recently released first
+  std::vector<PooledRenderTarget> mRenderTargetPool;
+  base::memory_accounting::TrackedBytes mPooledRenderTargetBytes{
+    base::memory_accounting::Category::PooledRenderTargets, 0};
 
   TextureData mWaterSurfaceAnimTexture;
+  TextureData mWaterRemapTableTexture;
+  TextureData mPaletteTexture;
+  loader::Palette16 mCurrentPalette;
 
   GLuint mCurrentFbo;
   base::Size<int> mWindowSize;
@@ -281,6 +747,16 @@ private:
   std::optional<base::Rect<int>> mClipRect;
   glm::vec2 mGlobalTranslation;
   glm::vec2 mGlobalScale;
+
+  GpuProfiler mGpuProfiler;
+  FrameStatistics mCurrentFrameStatistics;
+  FrameStatistics mLastFrameStatistics;
+  std::uint64_t mContentVersion = 0;
+
+  DrawCommandRecording* mpRecording = nullptr;
 };
 
+
+const char* batchFlushReasonName(Renderer::BatchFlushReason reason);
+
 }
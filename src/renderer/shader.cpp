@@ -100,6 +100,8 @@ Shader::Shader(
         "Shader program linking failed, but could not get info log");
     }
   }
+
+  queryUniforms();
 }
 
 
@@ -108,14 +110,41 @@ void Shader::use() {
 }
 
 
-GLint Shader::location(const std::string& name) const {
-  auto it = mLocationCache.find(name);
-  if (it == mLocationCache.end()) {
-    const auto location = glGetUniformLocation(mProgram.mHandle, name.c_str());
-    std::tie(it, std::ignore) = mLocationCache.emplace(name, location);
-  }
+void Shader::queryUniforms() {
+  GLint numUniforms = 0;
+  glGetProgramiv(mProgram.mHandle, GL_ACTIVE_UNIFORMS, &numUniforms);
+
+  GLint maxNameLength = 0;
+  glGetProgramiv(
+    mProgram.mHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+  std::unique_ptr<char[]> nameBuffer(new char[maxNameLength + 1]);
+  for (GLint i = 0; i < numUniforms; ++i) {
+    GLsizei nameLength = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(
+      mProgram.mHandle,
+      GLuint(i),
+      maxNameLength + 1,
+      &nameLength,
+      &size,
+      &type,
+      nameBuffer.get());
+
+    auto name = std::string{nameBuffer.get(), std::size_t(nameLength)};
+
+    // Arrays are reported as "name[0]", but we want to address them
+    // using just their name
+    const auto arraySuffixPos = name.find('[');
+    if (arraySuffixPos != std::string::npos) {
+      name.erase(arraySuffixPos);
+    }
 
-  return it->second;
+    const auto location =
+      glGetUniformLocation(mProgram.mHandle, nameBuffer.get());
+    mUniforms.push_back(Uniform{std::move(name), location, {}});
+  }
 }
 
 }
@@ -24,9 +24,14 @@ RIGEL_DISABLE_WARNINGS
 #include <glm/mat4x4.hpp>
 RIGEL_RESTORE_WARNINGS
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <initializer_list>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 
 namespace rigel::renderer {
@@ -73,52 +78,83 @@ public:
 
   void use();
 
-  void setUniform(const std::string& name, const glm::mat4& matrix) {
-    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(matrix));
+  // Note: The shader must be in use when setting uniforms. Setting a uniform
+  // to the value it already has doesn't cause any GL calls.
+
+  void setUniform(std::string_view name, const glm::mat4& matrix) {
+    if (const auto location = locationIfChanged(name, matrix); location != -1) {
+      glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
+    }
+  }
+
+  void setUniform(std::string_view name, const glm::vec2& vec2) {
+    if (const auto location = locationIfChanged(name, vec2); location != -1) {
+      glUniform2fv(location, 1, glm::value_ptr(vec2));
+    }
   }
 
-  void setUniform(const std::string& name, const glm::vec2& vec2) {
-    glUniform2fv(location(name), 1, glm::value_ptr(vec2));
+  void setUniform(std::string_view name, const glm::vec3& vec3) {
+    if (const auto location = locationIfChanged(name, vec3); location != -1) {
+      glUniform3fv(location, 1, glm::value_ptr(vec3));
+    }
   }
 
-  void setUniform(const std::string& name, const glm::vec3& vec3) {
-    glUniform3fv(location(name), 1, glm::value_ptr(vec3));
+  void setUniform(std::string_view name, const glm::vec4& vec4) {
+    if (const auto location = locationIfChanged(name, vec4); location != -1) {
+      glUniform4fv(location, 1, glm::value_ptr(vec4));
+    }
   }
 
-  void setUniform(const std::string& name, const glm::vec4& vec4) {
-    glUniform4fv(location(name), 1, glm::value_ptr(vec4));
+  template <std::size_t N>
+  void setUniform(
+    std::string_view name,
+    const std::array<float, N>& values
+  ) {
+    if (const auto location = locationIfChanged(name, values); location != -1) {
+      glUniform1fv(location, N, values.data());
+    }
   }
 
   template <std::size_t N>
   void setUniform(
-    const std::string& name,
+    std::string_view name,
     const std::array<glm::vec2, N>& values
   ) {
-    glUniform3fv(location(name), N, glm::value_ptr(values.front()));
+    if (const auto location = locationIfChanged(name, values); location != -1) {
+      glUniform2fv(location, N, glm::value_ptr(values.front()));
+    }
   }
 
   template <std::size_t N>
   void setUniform(
-    const std::string& name,
+    std::string_view name,
     const std::array<glm::vec3, N>& values
   ) {
-    glUniform3fv(location(name), N, glm::value_ptr(values.front()));
+    if (const auto location = locationIfChanged(name, values); location != -1) {
+      glUniform3fv(location, N, glm::value_ptr(values.front()));
+    }
   }
 
   template <std::size_t N>
   void setUniform(
-    const std::string& name,
+    std::string_view name,
     const std::array<glm::vec4, N>& values
   ) {
-    glUniform3fv(location(name), N, glm::value_ptr(values.front()));
+    if (const auto location = locationIfChanged(name, values); location != -1) {
+      glUniform4fv(location, N, glm::value_ptr(values.front()));
+    }
   }
 
-  void setUniform(const std::string& name, const int value) {
-    glUniform1i(location(name), value);
+  void setUniform(std::string_view name, const int value) {
+    if (const auto location = locationIfChanged(name, value); location != -1) {
+      glUniform1i(location, value);
+    }
   }
 
-  void setUniform(const std::string& name, const float value) {
-    glUniform1f(location(name), value);
+  void setUniform(std::string_view name, const float value) {
+    if (const auto location = locationIfChanged(name, value); location != -1) {
+      glUniform1f(location, value);
+    }
   }
 
   GLuint handle() {
@@ -126,11 +162,51 @@ public:
   }
 
 private:
-  GLint location(const std::string& name) const;
+  struct Uniform {
+    std::string mName;
+    GLint mLocation;
+
+    // Raw bytes of the most recently set value, empty if not set yet
+    std::vector<std::uint8_t> mLastValue;
+  };
+
+  void queryUniforms();
+
+  /** Returns the uniform's location, or -1 if the uniform doesn't need to be
+   * set - either because the shader has no such (active) uniform, or
+   * because it already has the given value.
+   */
+  template <typename T>
+  GLint locationIfChanged(const std::string_view name, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    const auto iUniform = std::find_if(
+      mUniforms.begin(),
+      mUniforms.end(),
+      [&](const Uniform& uniform) { return uniform.mName == name; });
+    if (iUniform == mUniforms.end()) {
+      return -1;
+    }
+
+    const auto pBytes = reinterpret_cast<const std::uint8_t*>(&value);
+    auto& lastValue = iUniform->mLastValue;
+    const auto isUnchanged =
+      lastValue.size() == sizeof(T) &&
+      std::equal(pBytes, pBytes + sizeof(T), lastValue.begin());
+    if (isUnchanged) {
+      return -1;
+    }
+
+    lastValue.assign(pBytes, pBytes + sizeof(T));
+    return iUniform->mLocation;
+  }
 
 private:
   GlHandleWrapper mProgram;
-  mutable std::unordered_map<std::string, GLint> mLocationCache;
+
+  // Filled once after linking. There are only a handful of uniforms per
+  // shader, so a linear search is faster than hashing the name.
+  std::vector<Uniform> mUniforms;
 };
 
 }
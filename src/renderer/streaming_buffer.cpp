@@ -0,0 +1,271 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "streaming_buffer.hpp"
+
+#include "base/tunables.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+// Keep all uploads aligned, so that vertex attributes always start at a
+// properly aligned address
+constexpr auto UPLOAD_ALIGNMENT = std::size_t{16};
+
+#ifndef RIGEL_USE_GL_ES
+constexpr auto FENCE_WAIT_TIMEOUT_NS = GLuint64{1'000'000};
+
+constexpr auto PERSISTENT_MAPPING_FLAGS =
+  GL_MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+
+
+base::Tunable<bool> gUsePersistentMapping{
+  "persistent-buffer-mapping",
+  "Map streaming buffers persistently if the GL context supports it. "
+  "Only takes effect at startup.",
+  true};
+#endif
+
+
+std::size_t alignedSize(const std::size_t size) {
+  return (size + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+}
+
+
+std::size_t roundUpToMultiple(const std::size_t value, const std::size_t n) {
+  return (value + n - 1) / n * n;
+}
+
+}
+
+
+StreamingBuffer::StreamingBuffer(
+  const GLenum target,
+  const std::size_t regionSize
+)
+  : mTarget(target)
+  , mRegionSize(alignedSize(regionSize))
+{
+  glGenBuffers(1, &mHandle);
+  glBindBuffer(mTarget, mHandle);
+
+#ifndef RIGEL_USE_GL_ES
+  if (gUsePersistentMapping && bufferStorageFunction()) {
+    createPersistentStorage();
+    return;
+  }
+#endif
+
+  orphanStorage();
+}
+
+
+StreamingBuffer::~StreamingBuffer() {
+#ifndef RIGEL_USE_GL_ES
+  if (mpPersistentMapping) {
+    releasePersistentStorage();
+  } else {
+    deleteFences();
+  }
+#endif
+
+  glDeleteBuffers(1, &mHandle);
+}
+
+
+std::size_t StreamingBuffer::upload(
+  const void* pData,
+  const std::size_t size,
+  const std::size_t elementSize
+) {
+  const auto alignment = std::lcm(UPLOAD_ALIGNMENT, elementSize);
+  const auto regionStart = [this]() {
+    return mCurrentRegion * mRegionSize;
+  };
+  const auto nextOffset = [&]() {
+    return roundUpToMultiple(regionStart() + mOffsetInRegion, alignment);
+  };
+
+  if (size + alignment > mRegionSize) {
+    // Doesn't fit at all, grow the buffer. This should only happen very
+    // rarely, if ever.
+    mRegionSize = alignedSize(size + alignment);
+    mOffsetInRegion = 0;
+
+#ifndef RIGEL_USE_GL_ES
+    if (mpPersistentMapping) {
+      releasePersistentStorage();
+      glDeleteBuffers(1, &mHandle);
+
+      glGenBuffers(1, &mHandle);
+      glBindBuffer(mTarget, mHandle);
+      createPersistentStorage();
+    } else {
+      orphanStorage();
+    }
+#else
+    orphanStorage();
+#endif
+  } else if (nextOffset() + size > regionStart() + mRegionSize) {
+#ifndef RIGEL_USE_GL_ES
+    if (mpPersistentMapping) {
+      advanceRegion();
+    } else {
+      // The current region is used up. Instead of waiting for the GPU, we
+      // let the driver give us fresh storage. All previously issued draw
+      // calls keep using the old storage.
+      mOffsetInRegion = 0;
+      orphanStorage();
+    }
+#else
+    mOffsetInRegion = 0;
+    orphanStorage();
+#endif
+  }
+
+  const auto offset = nextOffset();
+
+#ifdef RIGEL_USE_GL_ES
+  glBufferSubData(mTarget, GLintptr(offset), GLsizeiptr(size), pData);
+#else
+  if (mpPersistentMapping) {
+    // The mapping is coherent, so the data is visible to the GPU for all
+    // draw calls issued from now on
+    std::memcpy(mpPersistentMapping + offset, pData, size);
+  } else {
+    auto pDestination = glMapBufferRange(
+      mTarget,
+      GLintptr(offset),
+      GLsizeiptr(size),
+      GL_MAP_WRITE_BIT |
+        GL_MAP_INVALIDATE_RANGE_BIT |
+        GL_MAP_UNSYNCHRONIZED_BIT);
+    assert(pDestination);
+    std::memcpy(pDestination, pData, size);
+    glUnmapBuffer(mTarget);
+  }
+#endif
+
+  mOffsetInRegion = offset - regionStart() + alignedSize(size);
+  return offset;
+}
+
+
+void StreamingBuffer::nextFrame() {
+#ifdef RIGEL_USE_GL_ES
+  mCurrentRegion = (mCurrentRegion + 1) % NUM_REGIONS;
+  mOffsetInRegion = 0;
+  orphanStorage();
+#else
+  advanceRegion();
+#endif
+}
+
+
+void StreamingBuffer::orphanStorage() {
+  glBufferData(
+    mTarget,
+    GLsizeiptr(mRegionSize * NUM_REGIONS),
+    nullptr,
+    GL_STREAM_DRAW);
+
+#ifndef RIGEL_USE_GL_ES
+  // Fresh storage means there's nothing left to wait for
+  deleteFences();
+#endif
+}
+
+
+void StreamingBuffer::advanceRegion() {
+#ifndef RIGEL_USE_GL_ES
+  auto& fence = mFences[mCurrentRegion];
+  if (fence) {
+    glDeleteSync(fence);
+  }
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  mCurrentRegion = (mCurrentRegion + 1) % NUM_REGIONS;
+  mOffsetInRegion = 0;
+  waitForRegion(mCurrentRegion);
+#endif
+}
+
+
+void StreamingBuffer::waitForRegion(const int index) {
+#ifndef RIGEL_USE_GL_ES
+  auto& fence = mFences[index];
+  if (!fence) {
+    return;
+  }
+
+  for (;;) {
+    const auto result = glClientWaitSync(
+      fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT_NS);
+    if (result != GL_TIMEOUT_EXPIRED) {
+      break;
+    }
+  }
+
+  glDeleteSync(fence);
+  fence = nullptr;
+#endif
+}
+
+
+#ifndef RIGEL_USE_GL_ES
+
+void StreamingBuffer::createPersistentStorage() {
+  const auto totalSize = GLsizeiptr(mRegionSize * NUM_REGIONS);
+
+  bufferStorageFunction()(
+    mTarget, totalSize, nullptr, PERSISTENT_MAPPING_FLAGS);
+  mpPersistentMapping = static_cast<std::byte*>(glMapBufferRange(
+    mTarget, 0, totalSize, PERSISTENT_MAPPING_FLAGS));
+  assert(mpPersistentMapping);
+
+  mCurrentRegion = 0;
+  mOffsetInRegion = 0;
+}
+
+
+void StreamingBuffer::releasePersistentStorage() {
+  glBindBuffer(mTarget, mHandle);
+  glUnmapBuffer(mTarget);
+  mpPersistentMapping = nullptr;
+
+  deleteFences();
+}
+
+
+void StreamingBuffer::deleteFences() {
+  for (auto& fence : mFences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+}
+
+#endif
+
+}
@@ -0,0 +1,102 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "renderer/opengl.hpp"
+
+#include <array>
+#include <cstddef>
+
+
+namespace rigel::renderer {
+
+/** Ring buffer for streaming per-frame vertex/index data to the GPU
+ *
+ * The buffer's storage is split into a fixed number of regions, one region
+ * is used per frame. Data is written into the current region at increasing
+ * offsets, so that no draw call issued earlier in the frame is affected by
+ * later uploads. On desktop GL, unsynchronized buffer mapping is used for
+ * writing, with a fence per region to make sure the GPU is done reading
+ * from a region before it's written to again.
+ *
+ * If the GL context supports glBufferStorage, the whole buffer is instead
+ * mapped once, persistently, and uploads are plain memory copies. This
+ * avoids a map/unmap pair per upload, which is expensive on some drivers.
+ * Persistent storage can't be orphaned, so running out of space in a region
+ * moves on to the next one early, waiting for its fence if needed. Growing
+ * the buffer replaces the buffer object, changing handle().
+ *
+ * OpenGL ES 2.0 doesn't offer buffer mapping or fences, so we fall back to
+ * glBufferSubData there, orphaning the buffer's storage once per frame
+ * instead of on every upload.
+ *
+ * The buffer is bound to its target on construction and is expected to stay
+ * bound.
+ */
+class StreamingBuffer {
+public:
+  StreamingBuffer(GLenum target, std::size_t regionSize);
+  ~StreamingBuffer();
+
+  StreamingBuffer(const StreamingBuffer&) = delete;
+  StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+  /** Copy data into the buffer
+   *
+   * Returns the byte offset into the buffer at which the data was placed,
+   * for use in glVertexAttribPointer/glDrawElements. The offset is
+   * a multiple of elementSize, so that the data can also be addressed by
+   * element index, e.g. as the first vertex of a draw call.
+   */
+  std::size_t upload(
+    const void* pData,
+    std::size_t size,
+    std::size_t elementSize = 1);
+
+  /** Advance to the next region. Should be called once per frame. */
+  void nextFrame();
+
+  GLuint handle() const {
+    return mHandle;
+  }
+
+private:
+  static constexpr auto NUM_REGIONS = 3;
+
+  void orphanStorage();
+  void advanceRegion();
+  void waitForRegion(int index);
+
+#ifndef RIGEL_USE_GL_ES
+  void createPersistentStorage();
+  void releasePersistentStorage();
+  void deleteFences();
+#endif
+
+  GLuint mHandle = 0;
+  GLenum mTarget;
+  std::size_t mRegionSize;
+  std::size_t mOffsetInRegion = 0;
+  int mCurrentRegion = 0;
+
+#ifndef RIGEL_USE_GL_ES
+  std::array<GLsync, NUM_REGIONS> mFences{};
+  std::byte* mpPersistentMapping = nullptr;
+#endif
+};
+
+}
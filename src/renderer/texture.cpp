@@ -17,12 +17,24 @@
 #include "texture.hpp"
 
 #include <cassert>
+#include <utility>
 
 
 namespace rigel::renderer {
 
 using data::Image;
 using detail::TextureBase;
+namespace memory = base::memory_accounting;
+
+
+namespace {
+
+std::size_t textureSizeInBytes(const Renderer::TextureData& data) {
+  const auto bytesPerPixel = data.mIsIndexed ? 1 : 4;
+  return std::size_t(data.mWidth) * data.mHeight * bytesPerPixel;
+}
+
+}
 
 
 void TextureBase::render(
@@ -79,22 +91,93 @@ void TextureBase::render(
 
 
 OwningTexture::OwningTexture(renderer::Renderer* pRenderer, const Image& image)
-  : TextureBase(pRenderer->createTexture(image))
+  : OwningTexture(pRenderer->createTexture(image))
+{
+}
+
+
+OwningTexture::OwningTexture(
+  renderer::Renderer* pRenderer,
+  const Image& image,
+  const loader::Palette16& palette
+)
+  : OwningTexture(pRenderer->createIndexedTexture(image, palette))
+{
+}
+
+
+OwningTexture::OwningTexture(
+  Renderer::TextureData data,
+  const memory::Category category
+)
+  : TextureBase(data)
+  , mTrackedBytes(category, textureSizeInBytes(data))
 {
 }
 
 
+std::vector<OwningTexture> OwningTexture::createMany(
+  renderer::Renderer* pRenderer,
+  base::ArrayView<Image> images
+) {
+  std::vector<OwningTexture> result;
+  result.reserve(images.size());
+
+  for (const auto& data : pRenderer->createTextures(images)) {
+    result.push_back(OwningTexture{data});
+  }
+
+  return result;
+}
+
+
 OwningTexture::~OwningTexture() {
   glDeleteTextures(1, &mData.mHandle);
 }
 
 
+#ifndef RIGEL_USE_GL_ES
+
+TileMapTexture::TileMapTexture(
+  renderer::Renderer* pRenderer,
+  const int width,
+  const int height,
+  const std::uint16_t* pData
+)
+  : mData(pRenderer->createTileMapTexture(width, height, pData))
+  , mTrackedBytes(
+      memory::Category::Textures,
+      sizeof(std::uint16_t) * width * height)
+{
+}
+
+
+TileMapTexture::~TileMapTexture() {
+  glDeleteTextures(1, &mData.mHandle);
+}
+
+
+TileMapTexture& TileMapTexture::operator=(TileMapTexture&& other) noexcept {
+  if (&other != this) {
+    glDeleteTextures(1, &mData.mHandle);
+    mData = other.mData;
+    mTrackedBytes = std::move(other.mTrackedBytes);
+    other.mData.mHandle = 0;
+  }
+
+  return *this;
+}
+
+#endif
+
+
 RenderTargetTexture::RenderTargetTexture(
   renderer::Renderer* pRenderer,
   const std::size_t width,
   const std::size_t height
 )
   : RenderTargetTexture(
+      pRenderer,
       pRenderer->createRenderTargetTexture(int(width), int(height)),
       static_cast<int>(width),
       static_cast<int>(height))
@@ -103,18 +186,68 @@ RenderTargetTexture::RenderTargetTexture(
 
 
 RenderTargetTexture::RenderTargetTexture(
+  renderer::Renderer* pRenderer,
   const Renderer::RenderTargetHandles& handles,
   const int width,
   const int height
 )
-  : OwningTexture({width, height, handles.texture})
+  : OwningTexture(
+      {width, height, handles.texture}, memory::Category::RenderTargets)
   , mFboHandle(handles.fbo)
+  , mpRenderer(pRenderer)
+{
+}
+
+
+RenderTargetTexture::RenderTargetTexture(RenderTargetTexture&& other) noexcept
+  : OwningTexture(std::move(other))
+  , mFboHandle(std::exchange(other.mFboHandle, 0))
+  , mpRenderer(other.mpRenderer)
 {
 }
 
 
+RenderTargetTexture& RenderTargetTexture::operator=(
+  RenderTargetTexture&& other
+) noexcept {
+  if (&other != this) {
+    release();
+    OwningTexture::operator=(std::move(other));
+    mFboHandle = std::exchange(other.mFboHandle, 0);
+    mpRenderer = other.mpRenderer;
+  }
+
+  return *this;
+}
+
+
 RenderTargetTexture::~RenderTargetTexture() {
-  glDeleteFramebuffers(1, &mFboHandle);
+  release();
+}
+
+
+void RenderTargetTexture::release() {
+  if (mData.mHandle) {
+    // The renderer accounts for pooled render targets itself
+    mTrackedBytes.resize(0);
+
+    mpRenderer->releaseRenderTargetTexture(
+      {mData.mHandle, mFboHandle}, mData.mWidth, mData.mHeight);
+
+    // Keeps OwningTexture from deleting the texture
+    mData.mHandle = 0;
+    mFboHandle = 0;
+  }
+}
+
+
+void RenderTargetTexture::blit(renderer::Renderer* pRenderer) const {
+  pRenderer->blitRenderTarget(renderTarget(), mData);
+}
+
+
+Renderer::RenderTarget RenderTargetTexture::renderTarget() const {
+  return {base::Size<int>{mData.mWidth, mData.mHeight}, mFboHandle};
 }
 
 
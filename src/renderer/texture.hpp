@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "base/array_view.hpp"
+#include "base/memory_accounting.hpp"
 #include "base/spatial_types.hpp"
 #include "base/warnings.hpp"
 #include "data/image.hpp"
@@ -23,6 +25,9 @@
 #include "renderer/opengl.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 
 namespace rigel::renderer {
@@ -105,10 +110,22 @@ class OwningTexture : public detail::TextureBase {
 public:
   OwningTexture() = default;
   OwningTexture(Renderer* renderer, const data::Image& image);
+
+  /** Create an indexed texture, see Renderer::createIndexedTexture() */
+  OwningTexture(
+    Renderer* renderer,
+    const data::Image& image,
+    const loader::Palette16& palette);
   ~OwningTexture();
 
+  /** Create one texture per image, see Renderer::createTextures() */
+  static std::vector<OwningTexture> createMany(
+    Renderer* renderer,
+    base::ArrayView<data::Image> images);
+
   OwningTexture(OwningTexture&& other) noexcept
     : TextureBase(other.mData)
+    , mTrackedBytes(std::move(other.mTrackedBytes))
   {
     other.mData.mHandle = 0;
   }
@@ -118,6 +135,7 @@ public:
 
   OwningTexture& operator=(OwningTexture&& other) noexcept {
     mData = other.mData;
+    mTrackedBytes = std::move(other.mTrackedBytes);
     other.mData.mHandle = 0;
     return *this;
   }
@@ -125,10 +143,12 @@ public:
   friend class NonOwningTexture;
 
 protected:
-  explicit OwningTexture(Renderer::TextureData data)
-    : TextureBase(data)
-  {
-  }
+  explicit OwningTexture(
+    Renderer::TextureData data,
+    base::memory_accounting::Category category =
+      base::memory_accounting::Category::Textures);
+
+  base::memory_accounting::TrackedBytes mTrackedBytes;
 };
 
 
@@ -152,10 +172,52 @@ public:
 };
 
 
+#ifndef RIGEL_USE_GL_ES
+
+/** Owning wrapper for textures created by Renderer::createTileMapTexture()
+ *
+ * The ownership semantics are the same as for OwningTexture.
+ */
+class TileMapTexture {
+public:
+  TileMapTexture() = default;
+  TileMapTexture(
+    Renderer* pRenderer,
+    int width,
+    int height,
+    const std::uint16_t* pData);
+  ~TileMapTexture();
+
+  TileMapTexture(TileMapTexture&& other) noexcept
+    : mData(other.mData)
+    , mTrackedBytes(std::move(other.mTrackedBytes))
+  {
+    other.mData.mHandle = 0;
+  }
+
+  TileMapTexture(const TileMapTexture&) = delete;
+  TileMapTexture& operator=(const TileMapTexture&) = delete;
+
+  TileMapTexture& operator=(TileMapTexture&& other) noexcept;
+
+  Renderer::TextureData data() const {
+    return mData;
+  }
+
+private:
+  Renderer::TextureData mData;
+  base::memory_accounting::TrackedBytes mTrackedBytes;
+};
+
+#endif
+
+
 /** Utility class for render target type textures
  *
  * It manages life-time like OwningTexture, but creates a SDL_Texture with an
- * access type of SDL_TEXTUREACCESS_TARGET.
+ * access type of SDL_TEXTUREACCESS_TARGET. Instead of being deleted, the
+ * texture is returned to the renderer's render target pool on destruction
+ * (see Renderer::createRenderTargetTexture()).
  *
  * It also offers a RAII helper class for safe binding/unbinding of the
  * render target.
@@ -214,18 +276,30 @@ public:
     std::size_t height);
   ~RenderTargetTexture();
 
-  // TODO: Remove these once we have VS 2019 on CI
-  RenderTargetTexture(RenderTargetTexture&&) = default;
-  RenderTargetTexture& operator=(RenderTargetTexture&&) = default;
+  RenderTargetTexture(RenderTargetTexture&& other) noexcept;
+  RenderTargetTexture& operator=(RenderTargetTexture&& other) noexcept;
+
+  /** Copy contents into the current render target
+   *
+   * See Renderer::blitRenderTarget().
+   */
+  void blit(Renderer* pRenderer) const;
+
+  Renderer::RenderTarget renderTarget() const;
 
 private:
   RenderTargetTexture(
+    Renderer* pRenderer,
     const Renderer::RenderTargetHandles& handles,
     int width,
     int height);
 
+  /** Hand the texture and FBO back to the renderer's pool */
+  void release();
+
 private:
   GLuint mFboHandle;
+  Renderer* mpRenderer;
 };
 
 
@@ -0,0 +1,170 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <optional>
+
+
+namespace rigel::renderer {
+
+namespace {
+
+// RGBA, 8 bits per channel
+constexpr auto BYTES_PER_PIXEL = std::size_t{4};
+
+
+// Empty space between images in a page. With non-integer scale factors,
+// sampling at the edge of an image might otherwise pick up pixels from
+// a neighboring image.
+constexpr auto PADDING = 1;
+
+}
+
+
+void AtlasTexture::render(
+  Renderer* pRenderer,
+  const base::Vector& position
+) const {
+  render(pRenderer, position.x, position.y);
+}
+
+
+void AtlasTexture::render(
+  Renderer* pRenderer,
+  const int x,
+  const int y
+) const {
+  renderScaled(pRenderer, {{x, y}, mRectInPage.size});
+}
+
+
+void AtlasTexture::renderScaled(
+  Renderer* pRenderer,
+  const base::Rect<int>& destRect
+) const {
+  pRenderer->drawTexture(mPageData, mRectInPage, destRect);
+}
+
+
+TextureAtlas::Page::Page(
+  Renderer* pRenderer,
+  const int width,
+  const int height
+)
+  : mTexture(
+      pRenderer,
+      data::Image{static_cast<size_t>(width), static_cast<size_t>(height)})
+{
+}
+
+
+TextureAtlas::TextureAtlas(Renderer* pRenderer, const int pageSize)
+  : mpRenderer(pRenderer)
+  , mPageSize(pageSize)
+{
+}
+
+
+AtlasTexture TextureAtlas::insert(const data::Image& image) {
+  const auto imageSize = base::Extents{
+    static_cast<int>(image.width()),
+    static_cast<int>(image.height())};
+  const auto paddedWidth = imageSize.width + PADDING;
+  const auto paddedHeight = imageSize.height + PADDING;
+
+  auto tryPlace = [&](Page& page) -> std::optional<base::Vector> {
+    auto position = page.mShelfPosition;
+    auto shelfHeight = page.mShelfHeight;
+
+    if (position.x + paddedWidth > page.mTexture.width()) {
+      position = {0, position.y + shelfHeight};
+      shelfHeight = 0;
+    }
+
+    if (position.y + paddedHeight > page.mTexture.height()) {
+      return std::nullopt;
+    }
+
+    page.mShelfPosition = {position.x + paddedWidth, position.y};
+    page.mShelfHeight = std::max(shelfHeight, paddedHeight);
+    return position;
+  };
+
+  auto insertAt = [&](const Page& page, const base::Vector& position) {
+    const auto pageData = page.mTexture.data();
+    mpRenderer->updateTextureRegion(pageData, position, image);
+    return AtlasTexture{pageData, {position, imageSize}};
+  };
+
+
+  if (paddedWidth > mPageSize || paddedHeight > mPageSize) {
+    auto& page = addPage(imageSize.width, imageSize.height);
+    page.mShelfPosition = {0, imageSize.height};
+    return insertAt(page, {0, 0});
+  }
+
+  // Pages whose images are all gone have been freed, forget about them
+  mPages.erase(
+    std::remove_if(
+      mPages.begin(),
+      mPages.end(),
+      [](const std::weak_ptr<Page>& pPage) { return pPage.expired(); }),
+    mPages.end());
+
+  for (const auto& pWeakPage : mPages) {
+    auto pPage = pWeakPage.lock();
+    if (const auto position = tryPlace(*pPage)) {
+      mpLastUsedPage = std::move(pPage);
+      return insertAt(*mpLastUsedPage, *position);
+    }
+  }
+
+  auto& page = addPage(mPageSize, mPageSize);
+  return insertAt(page, *tryPlace(page));
+}
+
+
+std::size_t TextureAtlas::numPages() const {
+  return static_cast<std::size_t>(std::count_if(
+    mPages.begin(),
+    mPages.end(),
+    [](const std::weak_ptr<Page>& pPage) { return !pPage.expired(); }));
+}
+
+
+std::size_t TextureAtlas::textureMemoryUsed() const {
+  auto result = std::size_t{0};
+  for (const auto& pWeakPage : mPages) {
+    if (const auto pPage = pWeakPage.lock()) {
+      result += BYTES_PER_PIXEL *
+        static_cast<std::size_t>(pPage->mTexture.width()) *
+        static_cast<std::size_t>(pPage->mTexture.height());
+    }
+  }
+
+  return result;
+}
+
+
+TextureAtlas::Page& TextureAtlas::addPage(const int width, const int height) {
+  mpLastUsedPage = std::make_shared<Page>(mpRenderer, width, height);
+  mPages.push_back(mpLastUsedPage);
+  return *mpLastUsedPage;
+}
+
+}
@@ -0,0 +1,142 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base/spatial_types.hpp"
+#include "data/image.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/texture.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace rigel::renderer {
+
+/** Non-owning reference to an image stored in a TextureAtlas
+ *
+ * Offers the same rendering interface as the regular texture classes, but
+ * only renders the part of the atlas page which contains the image.
+ * Like NonOwningTexture, it's only valid as long as the TextureAtlas it was
+ * obtained from is alive.
+ */
+class AtlasTexture {
+public:
+  AtlasTexture() = default;
+  AtlasTexture(
+    const Renderer::TextureData& pageData,
+    const base::Rect<int>& rectInPage)
+    : mPageData(pageData)
+    , mRectInPage(rectInPage)
+  {
+  }
+
+  /** Render entire image at given position */
+  void render(Renderer* pRenderer, const base::Vector& position) const;
+
+  /** Render entire image at given position */
+  void render(Renderer* pRenderer, int x, int y) const;
+
+  /** Render entire image scaled to fill the given rectangle */
+  void renderScaled(
+    Renderer* pRenderer,
+    const base::Rect<int>& destRect) const;
+
+  int width() const {
+    return mRectInPage.size.width;
+  }
+
+  int height() const {
+    return mRectInPage.size.height;
+  }
+
+  base::Extents extents() const {
+    return mRectInPage.size;
+  }
+
+  const Renderer::TextureData& pageData() const {
+    return mPageData;
+  }
+
+  const base::Rect<int>& rectInPage() const {
+    return mRectInPage;
+  }
+
+private:
+  Renderer::TextureData mPageData;
+  base::Rect<int> mRectInPage;
+};
+
+
+/** Packs many small images into a few large textures
+ *
+ * The renderer needs to submit a batch whenever the texture changes, so
+ * drawing many sprites which each use their own texture results in one draw
+ * call per sprite. Storing the images in a shared texture allows them to be
+ * drawn in a single batch.
+ *
+ * Images are placed into pages using simple shelf packing: They are put next
+ * to each other in rows, and a new row is started once the current one is
+ * full. When a page is full, a new one is created. Images which are larger
+ * than the page size get a page of their own.
+ *
+ * Pages are reference counted. Apart from the page used by the most recent
+ * insert(), the atlas itself only keeps weak references to its pages. Users
+ * keep the pages holding their images alive via PageRefs. Once all images
+ * on a page are no longer needed, its texture is freed. There is no way to
+ * reuse the space taken by individual images, though.
+ */
+class TextureAtlas {
+public:
+  static constexpr auto DEFAULT_PAGE_SIZE = 1024;
+
+  using PageRef = std::shared_ptr<const void>;
+
+  explicit TextureAtlas(
+    Renderer* pRenderer,
+    int pageSize = DEFAULT_PAGE_SIZE);
+
+  AtlasTexture insert(const data::Image& image);
+
+  /** Reference to the page holding the image added by the last insert() */
+  PageRef lastUsedPage() const {
+    return mpLastUsedPage;
+  }
+
+  std::size_t numPages() const;
+
+  /** Combined size of the textures of all live pages, in bytes */
+  std::size_t textureMemoryUsed() const;
+
+private:
+  struct Page {
+    Page(Renderer* pRenderer, int width, int height);
+
+    OwningTexture mTexture;
+    base::Vector mShelfPosition;
+    int mShelfHeight = 0;
+  };
+
+  Page& addPage(int width, int height);
+
+  Renderer* mpRenderer;
+  std::vector<std::weak_ptr<Page>> mPages;
+  std::shared_ptr<Page> mpLastUsedPage;
+  int mPageSize;
+};
+
+}
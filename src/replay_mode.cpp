@@ -0,0 +1,157 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replay_mode.hpp"
+
+#include "common/game_service_provider.hpp"
+
+#include "game_runner.hpp"
+
+#include <iostream>
+
+
+namespace rigel {
+
+namespace {
+
+// In unthrottled mode, game logic runs for this long before a frame is
+// presented, to keep the window responsive
+constexpr auto UNTHROTTLED_TIME_BUDGET_PER_FRAME =
+  std::chrono::milliseconds{15};
+
+}
+
+
+ReplayMode::ReplayMode(
+  game_logic::Replay replay,
+  Context context,
+  const bool unthrottled
+)
+  : mReplay(std::move(replay))
+  , mpServiceProvider(context.mpServiceProvider)
+  , mWorld(
+      &mPlayerModel,
+      mReplay.mSessionId,
+      context,
+      mReplay.mPlayerPositionOverride,
+      true /* show welcome message, like GameSessionMode */)
+  , mUnthrottled(unthrottled)
+{
+  mWorld.setRandomGeneratorState(mReplay.mRandomGeneratorState);
+}
+
+
+void ReplayMode::handleEvent(const SDL_Event& event) {
+  if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) {
+    mpServiceProvider->scheduleGameQuit();
+  }
+}
+
+
+void ReplayMode::updateAndRender(const engine::TimeDelta dt) {
+  using namespace std::chrono;
+
+  if (!mStarted) {
+    mStartTime = steady_clock::now();
+    mStarted = true;
+  }
+
+  if (mUnthrottled) {
+    const auto frameDeadline =
+      steady_clock::now() + UNTHROTTLED_TIME_BUDGET_PER_FRAME;
+    while (!finished() && steady_clock::now() < frameDeadline) {
+      runNextTick();
+    }
+  } else {
+    mAccumulatedTime += dt;
+    for (;
+      !finished() && mAccumulatedTime >= GAME_LOGIC_UPDATE_DELAY;
+      mAccumulatedTime -= GAME_LOGIC_UPDATE_DELAY
+    ) {
+      runNextTick();
+    }
+  }
+
+  mWorld.updateRealTimeEffects(dt);
+  mWorld.render();
+
+  if (finished() && !mFinished) {
+    onFinished();
+  }
+}
+
+
+bool ReplayMode::finished() const {
+  return mNextTick >= mReplay.mTicks.size();
+}
+
+
+void ReplayMode::runNextTick() {
+  const auto& tick = mReplay.mTicks[mNextTick];
+  ++mNextTick;
+
+  mWorld.updateGameLogic(tick.mInput);
+  verifyStateHash(mNextTick - 1);
+
+  if (tick.mEndOfFrame) {
+    mWorld.processEndOfFrameActions();
+  }
+}
+
+
+void ReplayMode::verifyStateHash(const std::size_t tickIndex) {
+  // Once diverged, all following ticks will most likely differ as well,
+  // so only the first mismatch is of interest.
+  if (tickIndex >= mReplay.mStateHashes.size() || mFirstDivergingTick) {
+    return;
+  }
+
+  const auto& expected = mReplay.mStateHashes[tickIndex];
+  const auto actual = mWorld.computeStateHash();
+  if (actual != expected) {
+    mFirstDivergingTick = tickIndex;
+    std::cerr
+      << "WARNING: Replay diverged at tick " << tickIndex << ", mismatch in: "
+      << game_logic::describeMismatch(expected, actual) << '\n';
+  }
+}
+
+
+void ReplayMode::onFinished() {
+  using namespace std::chrono;
+
+  mFinished = true;
+
+  const auto elapsed =
+    duration<double>(steady_clock::now() - mStartTime).count();
+  std::cout
+    << "Replay finished: " << mReplay.mTicks.size() << " ticks in "
+    << elapsed << " s\n";
+
+  if (!mReplay.mStateHashes.empty()) {
+    if (mFirstDivergingTick) {
+      std::cout
+        << "State verification FAILED, first diverging tick: "
+        << *mFirstDivergingTick << '\n';
+    } else {
+      std::cout << "State verification passed for all ticks\n";
+    }
+  }
+
+  mpServiceProvider->scheduleGameQuit();
+}
+
+}
@@ -0,0 +1,72 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common/game_mode.hpp"
+#include "data/player_model.hpp"
+#include "game_logic/game_world.hpp"
+#include "game_logic/replay.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+
+namespace rigel {
+
+/** Plays back a recorded replay
+ *
+ * Creates a game world in the same state as the recorded one, and feeds it
+ * the recorded input. Playback runs either in real time, or as fast as
+ * possible while still presenting a frame now and then. Once all input has
+ * been consumed, the time taken is printed and the game quits. Pressing
+ * Escape quits early.
+ *
+ * If the replay contains state hashes, the world's state is compared to
+ * them after each tick, and the first divergence is reported.
+ */
+class ReplayMode : public GameMode {
+public:
+  ReplayMode(
+    game_logic::Replay replay,
+    Context context,
+    bool unthrottled);
+
+  void handleEvent(const SDL_Event& event) override;
+  void updateAndRender(engine::TimeDelta dt) override;
+
+private:
+  bool finished() const;
+  void runNextTick();
+  void verifyStateHash(std::size_t tickIndex);
+  void onFinished();
+
+private:
+  game_logic::Replay mReplay;
+  IGameServiceProvider* mpServiceProvider;
+  data::PlayerModel mPlayerModel;
+  game_logic::GameWorld mWorld;
+  std::size_t mNextTick = 0;
+  std::optional<std::size_t> mFirstDivergingTick;
+  engine::TimeDelta mAccumulatedTime = 0.0;
+  std::chrono::steady_clock::time_point mStartTime;
+  bool mUnthrottled;
+  bool mStarted = false;
+  bool mFinished = false;
+};
+
+}
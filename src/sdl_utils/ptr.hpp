@@ -20,7 +20,6 @@
 
 RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
-#include <SDL_mixer.h>
 RIGEL_RESTORE_WARNINGS
 
 #include <memory>
@@ -42,11 +41,6 @@ struct DeleterFor<SDL_Window> {
   static auto deleter() { return &SDL_DestroyWindow; }
 };
 
-template<>
-struct DeleterFor<Mix_Chunk> {
-  static auto deleter() { return &Mix_FreeChunk; }
-};
-
 template<typename SDLType>
 auto deleterFor() {
   return DeleterFor<SDLType>::deleter();
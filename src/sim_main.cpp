@@ -0,0 +1,682 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* Headless simulation driver
+ *
+ * Runs a level's game logic as fast as possible, without presenting anything
+ * on screen and without audio output. Player input is taken from a simple
+ * script file. Meant for soak tests and automated playthroughs.
+ *
+ * No window or GL context is created. The game world still loads its
+ * graphics through the renderer, but all GL functions are replaced by ones
+ * that do nothing (see renderer::loadNullGlFunctions()), so neither a GPU nor
+ * a display is needed.
+ *
+ * Alternatively, a replay recorded by the game (see the --record-replay
+ * option) can be played back.
+ *
+ * For each run, throughput, the 99th percentile and maximum tick time, the
+ * peak number of entities and the number of heap allocations per tick are
+ * reported, followed by the process' peak resident set size. Passing
+ * multiple replays gives these numbers for each of the replayed levels.
+ *
+ * Multiple runs can be simulated in parallel (see --threads). The game data
+ * is loaded only once, the level is loaded once per thread. Every run then
+ * plays on its own copy of its thread's level, since copies of a map must
+ * not be shared across threads. Since game worlds create textures, each
+ * thread has its own renderer.
+ *
+ * Input script format: One step per line, consisting of a number of game
+ * logic ticks followed by the buttons to hold down during these ticks.
+ * Available buttons are left, right, up, down, jump and fire. Empty lines and
+ * lines starting with '#' are ignored. Example:
+ *
+ *   # Walk right for 2 seconds, then jump
+ *   30 right
+ *   1 right jump
+ */
+
+#include "base/warnings.hpp"
+#include "common/game_mode.hpp"
+#include "common/game_service_provider.hpp"
+#include "data/game_traits.hpp"
+#include "engine/allocation_tracker.hpp"
+#include "engine/tiled_texture.hpp"
+#include "game_logic/entity_factory.hpp"
+#include "game_logic/game_world.hpp"
+#include "game_logic/input.hpp"
+#include "game_logic/replay.hpp"
+#include "loader/level_loader.hpp"
+#include "loader/resource_loader.hpp"
+#include "renderer/opengl.hpp"
+#include "renderer/renderer.hpp"
+#include "ui/full_screen_image_cache.hpp"
+#include "ui/menu_element_renderer.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <boost/program_options.hpp>
+#include <SDL.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/resource.h>
+#endif
+
+
+using namespace rigel;
+using namespace std;
+
+namespace po = boost::program_options;
+
+
+// The engine's allocation tracking replaces operator new already when
+// enabled. Otherwise, we do our own minimal counting, so that allocations
+// per tick are always reported.
+#ifndef RIGEL_ENABLE_ALLOCATION_TRACKING
+
+namespace {
+
+thread_local std::uint64_t tAllocationCount = 0;
+
+}
+
+
+void* operator new(const std::size_t size) {
+  ++tAllocationCount;
+  if (auto pMemory = std::malloc(size == 0 ? 1 : size)) {
+    return pMemory;
+  }
+
+  throw std::bad_alloc{};
+}
+
+
+void operator delete(void* pMemory) noexcept {
+  std::free(pMemory);
+}
+
+
+void operator delete(void* pMemory, std::size_t) noexcept {
+  std::free(pMemory);
+}
+
+#endif
+
+
+namespace {
+
+/** Number of allocations made by the calling thread so far */
+std::uint64_t threadAllocationCount() {
+#ifdef RIGEL_ENABLE_ALLOCATION_TRACKING
+  return engine::allocation_tracking::threadCounters().mNumAllocations;
+#else
+  return tAllocationCount;
+#endif
+}
+
+
+std::optional<long> peakResidentSetSizeKb() {
+#if defined(__unix__) || defined(__APPLE__)
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return std::nullopt;
+  }
+
+  #if defined(__APPLE__)
+    // macOS reports bytes, Linux kilobytes
+    return usage.ru_maxrss / 1024;
+  #else
+    return usage.ru_maxrss;
+  #endif
+#else
+  return std::nullopt;
+#endif
+}
+
+
+struct SimulationOptions {
+  string mGamePath;
+  data::GameSessionId mSessionId{0, 0, data::Difficulty::Medium};
+  string mInputScriptFile;
+  vector<string> mReplayFiles;
+  int mMaxTicks = 15 * 60 * 10;
+  int mNumRuns = 1;
+  int mNumThreads = 1;
+};
+
+
+struct InputStep {
+  int mNumTicks = 0;
+  game_logic::PlayerInput mInput;
+};
+
+
+/** Service provider which discards all requests */
+struct NullServiceProvider : public IGameServiceProvider {
+  explicit NullServiceProvider(const bool isShareWareVersion)
+    : mIsShareWareVersion(isShareWareVersion)
+  {
+  }
+
+  void fadeOutScreen() override {}
+  void fadeInScreen() override {}
+  void playSound(data::SoundId) override {}
+  void stopSound(data::SoundId) override {}
+  void playMusic(const std::string&) override {}
+  void stopMusic() override {}
+  void scheduleNewGameStart(int, data::Difficulty) override {}
+  void scheduleStartFromSavedGame(const data::SavedGame&) override {}
+  void scheduleEnterMainMenu() override {}
+  void scheduleGameQuit() override {}
+
+  bool isShareWareVersion() const override {
+    return mIsShareWareVersion;
+  }
+
+  bool mIsShareWareVersion;
+};
+
+
+vector<InputStep> loadInputScript(const string& fileName) {
+  ifstream file(fileName);
+  if (!file.is_open()) {
+    throw runtime_error("Can't open input script: " + fileName);
+  }
+
+  vector<InputStep> steps;
+
+  string line;
+  for (auto lineNumber = 1; getline(file, line); ++lineNumber) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    istringstream lineStream(line);
+    InputStep step;
+    if (!(lineStream >> step.mNumTicks) || step.mNumTicks < 0) {
+      throw runtime_error(
+        "Invalid tick count in input script line " + to_string(lineNumber));
+    }
+
+    string button;
+    while (lineStream >> button) {
+      auto& input = step.mInput;
+      if (button == "left") {
+        input.mLeft = true;
+      } else if (button == "right") {
+        input.mRight = true;
+      } else if (button == "up") {
+        input.mUp = true;
+        input.mInteract.mIsPressed = true;
+      } else if (button == "down") {
+        input.mDown = true;
+      } else if (button == "jump") {
+        input.mJump.mIsPressed = true;
+      } else if (button == "fire") {
+        input.mFire.mIsPressed = true;
+      } else {
+        throw runtime_error(
+          "Unknown button '" + button + "' in input script line " +
+          to_string(lineNumber));
+      }
+    }
+
+    steps.push_back(step);
+  }
+
+  return steps;
+}
+
+
+/** Produces the input for each game logic tick according to a script
+ *
+ * Buttons which aren't held down in the previous step are reported as
+ * triggered at the start of a step, like a key press would be.
+ */
+class ScriptedInput {
+public:
+  explicit ScriptedInput(const vector<InputStep>& steps)
+    : mpSteps(&steps)
+  {
+  }
+
+  game_logic::PlayerInput next() {
+    while (
+      mCurrentStep < mpSteps->size() &&
+      mTicksInStep >= (*mpSteps)[mCurrentStep].mNumTicks
+    ) {
+      ++mCurrentStep;
+      mTicksInStep = 0;
+    }
+
+    if (mCurrentStep >= mpSteps->size()) {
+      mPrevious = {};
+      return mPrevious;
+    }
+
+    auto input = (*mpSteps)[mCurrentStep].mInput;
+
+    auto updateTrigger = [](
+      game_logic::Button& button,
+      const game_logic::Button& previous
+    ) {
+      button.mWasTriggered = button.mIsPressed && !previous.mIsPressed;
+    };
+
+    updateTrigger(input.mInteract, mPrevious.mInteract);
+    updateTrigger(input.mJump, mPrevious.mJump);
+    updateTrigger(input.mFire, mPrevious.mFire);
+
+    ++mTicksInStep;
+    mPrevious = input;
+    return input;
+  }
+
+private:
+  const vector<InputStep>* mpSteps;
+  std::size_t mCurrentStep = 0;
+  int mTicksInStep = 0;
+  game_logic::PlayerInput mPrevious;
+};
+
+
+struct RunResult {
+  int mNumTicks = 0;
+  double mElapsedTime = 0.0;
+  double mP99TickTimeMs = 0.0;
+  double mMaxTickTimeMs = 0.0;
+  std::size_t mPeakEntityCount = 0;
+  double mAllocationsPerTick = 0.0;
+  bool mLevelFinished = false;
+};
+
+
+/** A level to simulate, either with a replay or with the input script */
+struct Workload {
+  string mName;
+  data::GameSessionId mSessionId;
+  std::optional<game_logic::Replay> mReplay;
+
+  /** One copy of the level per worker thread, indexed by worker */
+  vector<data::map::LevelData> mLevels;
+};
+
+
+/** Everything the runs have in common, loaded only once and shared by all
+ * worker threads
+ */
+struct SharedSimulationData {
+  const loader::ResourceLoader* mpResources;
+  const vector<InputStep>* mpSteps;
+  const vector<Workload>* mpWorkloads;
+  bool mIsShareWareVersion;
+};
+
+
+RunResult simulateRun(
+  const SharedSimulationData& shared,
+  const Workload& workload,
+  const int workerIndex,
+  const SimulationOptions& options,
+  GameMode::Context context
+) {
+  const auto pReplay = workload.mReplay ? &*workload.mReplay : nullptr;
+
+  data::PlayerModel playerModel;
+  game_logic::GameWorld world(
+    &playerModel,
+    workload.mSessionId,
+    context,
+    pReplay ? pReplay->mPlayerPositionOverride : std::nullopt,
+    pReplay != nullptr,
+    workload.mLevels[workerIndex]);
+  ScriptedInput input(*shared.mpSteps);
+
+  auto maxTicks = options.mMaxTicks;
+  if (pReplay) {
+    world.setRandomGeneratorState(pReplay->mRandomGeneratorState);
+    maxTicks = std::min(maxTicks, int(pReplay->mTicks.size()));
+  }
+
+  vector<double> tickTimesMs;
+  tickTimesMs.reserve(maxTicks);
+  auto peakEntityCount = world.entityCount();
+
+  const auto allocationsAtStart = threadAllocationCount();
+  const auto startTime = chrono::steady_clock::now();
+
+  auto ticks = 0;
+  for (; ticks < maxTicks && !world.levelFinished(); ++ticks) {
+    const auto tickStartTime = chrono::steady_clock::now();
+
+    if (pReplay) {
+      const auto& tick = pReplay->mTicks[ticks];
+      world.updateGameLogic(tick.mInput);
+      if (tick.mEndOfFrame) {
+        world.processEndOfFrameActions();
+      }
+    } else {
+      world.updateGameLogic(input.next());
+      world.processEndOfFrameActions();
+    }
+
+    tickTimesMs.push_back(chrono::duration<double, milli>(
+      chrono::steady_clock::now() - tickStartTime).count());
+    peakEntityCount = std::max(peakEntityCount, world.entityCount());
+  }
+
+  const auto elapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - startTime).count();
+  const auto numAllocations = threadAllocationCount() - allocationsAtStart;
+
+  RunResult result;
+  result.mNumTicks = ticks;
+  result.mElapsedTime = elapsed;
+  result.mPeakEntityCount = peakEntityCount;
+  result.mLevelFinished = world.levelFinished();
+
+  if (!tickTimesMs.empty()) {
+    sort(tickTimesMs.begin(), tickTimesMs.end());
+    result.mP99TickTimeMs = tickTimesMs[(tickTimesMs.size() - 1) * 99 / 100];
+    result.mMaxTickTimeMs = tickTimesMs.back();
+    result.mAllocationsPerTick =
+      static_cast<double>(numAllocations) / tickTimesMs.size();
+  }
+
+  return result;
+}
+
+
+/** Run simulations on the calling thread until all runs have been taken
+ *
+ * Each thread has its own renderer and UI resources, since the game world
+ * needs them for creating textures.
+ */
+void runSimulationWorker(
+  const SharedSimulationData& shared,
+  const SimulationOptions& options,
+  const int workerIndex,
+  std::atomic<int>& nextRun,
+  vector<RunResult>& results
+) {
+  const auto& resources = *shared.mpResources;
+
+  renderer::Renderer renderer(nullptr);
+  NullServiceProvider serviceProvider(shared.mIsShareWareVersion);
+
+  engine::TiledTexture uiSpriteSheet(
+    renderer::OwningTexture{
+      &renderer, resources.loadTiledFullscreenImage("STATUS.MNI")},
+    &renderer);
+  ui::MenuElementRenderer textRenderer(&uiSpriteSheet, &renderer, resources);
+  game_logic::SpriteFactory spriteFactory(
+    &renderer, &resources.mActorImagePackage);
+  ui::HudAssets hudAssets(&renderer, resources.mActorImagePackage);
+  ui::FullScreenImageCache fullScreenImages(&renderer, &resources);
+
+  GameMode::Context context{
+    &resources,
+    &renderer,
+    &serviceProvider,
+    nullptr,
+    nullptr,
+    &textRenderer,
+    &uiSpriteSheet,
+    nullptr,
+    &spriteFactory,
+    &hudAssets,
+    &fullScreenImages,
+    data::ViewPortSize{}};
+
+  // Runs are numbered consecutively across workloads
+  const auto& workloads = *shared.mpWorkloads;
+  const auto numRunsTotal =
+    static_cast<int>(workloads.size()) * options.mNumRuns;
+  for (
+    auto run = nextRun++;
+    run < numRunsTotal;
+    run = nextRun++
+  ) {
+    const auto& workload = workloads[run / options.mNumRuns];
+    results[run] = simulateRun(shared, workload, workerIndex, options, context);
+  }
+}
+
+
+void runSimulation(const SimulationOptions& options) {
+  const auto numRunsTotal = options.mNumRuns *
+    std::max(static_cast<int>(options.mReplayFiles.size()), 1);
+  const auto numThreads = std::min(options.mNumThreads, numRunsTotal);
+
+  // Nothing is ever drawn, so there's no need for a window or GL context
+  renderer::loadNullGlFunctions();
+
+  const auto steps = options.mInputScriptFile.empty()
+    ? vector<InputStep>{}
+    : loadInputScript(options.mInputScriptFile);
+
+  loader::ResourceLoader resources(options.mGamePath);
+  const auto isShareWareVersion =
+    !resources.mFilePackage.hasFile("LCR.MNI") ||
+    !resources.mFilePackage.hasFile("O1.MNI");
+
+  // Each world gets its own copy of the level, since the map is modified
+  // during gameplay. Copies of a map share their tile data until modified,
+  // which is only safe within a single thread, so each worker gets its own
+  // separately loaded level to copy from.
+  auto makeWorkload = [&](
+    string name,
+    const data::GameSessionId& sessionId,
+    std::optional<game_logic::Replay> maybeReplay
+  ) {
+    vector<data::map::LevelData> levels;
+    levels.reserve(numThreads);
+    for (auto i = 0; i < numThreads; ++i) {
+      levels.push_back(loader::loadLevel(
+        loader::levelFileName(sessionId.mEpisode, sessionId.mLevel),
+        resources,
+        sessionId.mDifficulty));
+    }
+
+    return Workload{
+      std::move(name),
+      sessionId,
+      std::move(maybeReplay),
+      std::move(levels)};
+  };
+
+  vector<Workload> workloads;
+  if (options.mReplayFiles.empty()) {
+    workloads.push_back(makeWorkload(
+      loader::levelFileName(
+        options.mSessionId.mEpisode, options.mSessionId.mLevel),
+      options.mSessionId,
+      std::nullopt));
+  } else {
+    for (const auto& replayFile : options.mReplayFiles) {
+      auto replay = game_logic::loadReplay(replayFile);
+      const auto sessionId = replay.mSessionId;
+      workloads.push_back(
+        makeWorkload(replayFile, sessionId, std::move(replay)));
+    }
+  }
+
+  const auto shared = SharedSimulationData{
+    &resources,
+    &steps,
+    &workloads,
+    isShareWareVersion};
+
+  std::atomic<int> nextRun{0};
+  vector<RunResult> results(workloads.size() * options.mNumRuns);
+
+  const auto startTime = chrono::steady_clock::now();
+
+  vector<future<void>> workers;
+  for (auto i = 0; i < numThreads; ++i) {
+    workers.push_back(async(launch::async, [&, i]() {
+      runSimulationWorker(shared, options, i, nextRun, results);
+    }));
+  }
+
+  for (auto& worker : workers) {
+    // Re-throws any exception raised by the worker
+    worker.get();
+  }
+
+  const auto totalElapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - startTime).count();
+
+  auto totalTicks = std::int64_t{0};
+  for (auto run = 0; run < int(results.size()); ++run) {
+    const auto& result = results[run];
+    totalTicks += result.mNumTicks;
+
+    cout
+      << workloads[run / options.mNumRuns].mName
+      << ", run " << run % options.mNumRuns + 1 << ": "
+      << result.mNumTicks << " ticks in " << result.mElapsedTime << " s ("
+      << (result.mElapsedTime > 0.0
+        ? result.mNumTicks / result.mElapsedTime : 0.0)
+      << " ticks/s), p99 tick " << result.mP99TickTimeMs
+      << " ms, max tick " << result.mMaxTickTimeMs
+      << " ms, peak entities " << result.mPeakEntityCount
+      << ", allocations/tick " << result.mAllocationsPerTick
+      << ", level "
+      << (result.mLevelFinished ? "finished" : "not finished") << '\n';
+  }
+
+  if (results.size() > 1) {
+    cout
+      << "Total: " << totalTicks << " ticks in " << totalElapsed
+      << " s on " << numThreads << " thread(s) ("
+      << (totalElapsed > 0.0 ? totalTicks / totalElapsed : 0.0)
+      << " ticks/s)\n";
+  }
+
+  if (const auto peakRss = peakResidentSetSizeKb()) {
+    cout << "Peak RSS: " << *peakRss << " KB\n";
+  }
+}
+
+}
+
+
+int main(int argc, char** argv) {
+  SimulationOptions options;
+
+  po::options_description optionsDescription("Options");
+  optionsDescription.add_options()
+    ("help,h", "Show command line help message")
+    ("level,l",
+     po::value<string>()->default_value("L1"),
+     "Map to simulate, e.g. L1")
+    ("input-script,i",
+     po::value<string>(&options.mInputScriptFile),
+     "File describing player input. Without it, the player stays idle")
+    ("replay",
+     po::value<vector<string>>(&options.mReplayFiles),
+     "Play back a recorded replay instead. The level is taken from the "
+     "replay in that case. Can be given multiple times, to measure a whole "
+     "set of levels in one go")
+    ("max-ticks,t",
+     po::value<int>(&options.mMaxTicks)->default_value(options.mMaxTicks),
+     "Stop each run after this many game logic updates, unless the level is "
+     "finished before")
+    ("runs,r",
+     po::value<int>(&options.mNumRuns)->default_value(options.mNumRuns),
+     "Number of times to play through the level")
+    ("threads,j",
+     po::value<int>(&options.mNumThreads)->default_value(options.mNumThreads),
+     "Number of runs to simulate in parallel. Each thread gets its own "
+     "game world and GL context, while the game data is shared")
+    ("game-path",
+     po::value<string>(&options.mGamePath),
+     "Path to original game's installation. Can also be given as positional "
+     "argument.");
+
+  po::positional_options_description positionalArgsDescription;
+  positionalArgsDescription.add("game-path", -1);
+
+  try
+  {
+    po::variables_map variables;
+    po::store(
+      po::command_line_parser(argc, argv)
+        .options(optionsDescription)
+        .positional(positionalArgsDescription)
+        .run(),
+      variables);
+    po::notify(variables);
+
+    if (variables.count("help")) {
+      cout << optionsDescription << '\n';
+      return 0;
+    }
+
+    const auto levelName = variables["level"].as<string>();
+    if (levelName.size() != 2) {
+      throw invalid_argument("Invalid level name");
+    }
+
+    const auto episode = static_cast<int>(levelName[0] - 'L');
+    const auto level = static_cast<int>(levelName[1] - '0') - 1;
+    if (episode < 0 || episode >= 4 || level < 0 || level >= 8) {
+      throw invalid_argument(string("Invalid level name: ") + levelName);
+    }
+    options.mSessionId = {episode, level, data::Difficulty::Medium};
+
+    if (options.mNumRuns < 1 || options.mNumThreads < 1) {
+      throw invalid_argument("Number of runs and threads must be at least 1");
+    }
+
+    if (!options.mGamePath.empty() && options.mGamePath.back() != '/') {
+      options.mGamePath += "/";
+    }
+
+    runSimulation(options);
+  }
+  catch (const po::error& err)
+  {
+    cerr << "ERROR: " << err.what() << "\n\n";
+    cerr << optionsDescription << '\n';
+    return -1;
+  }
+  catch (const std::exception& ex)
+  {
+    cerr << "ERROR: " << ex.what() << '\n';
+    return -2;
+  }
+
+  return 0;
+}
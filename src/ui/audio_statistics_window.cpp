@@ -0,0 +1,103 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "audio_statistics_window.hpp"
+
+#include "base/warnings.hpp"
+#include "engine/audio_statistics.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <imgui.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+
+
+namespace rigel::ui {
+
+namespace {
+
+double toMs(const std::uint64_t nanoseconds) {
+  return double(nanoseconds) / 1'000'000.0;
+}
+
+
+std::uint64_t read(const std::atomic<std::uint64_t>& counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}
+
+
+void showAudioStatisticsWindow(const engine::AudioStatistics& statistics) {
+  using Stats = engine::AudioStatistics;
+
+  ImGui::SetNextWindowPos({0, 320}, ImGuiCond_FirstUseEver);
+  ImGui::Begin(
+    "Audio statistics",
+    nullptr,
+    ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+  const auto numCallbacks = read(statistics.mNumCallbacks);
+  const auto totalCallbackTime = read(statistics.mTotalCallbackTimeNs);
+  ImGui::Text("Callbacks: %llu", (unsigned long long)numCallbacks);
+  ImGui::Text(
+    "Avg. callback time: %6.3f ms",
+    numCallbacks > 0 ? toMs(totalCallbackTime) / numCallbacks : 0.0);
+  ImGui::Text(
+    "Max. callback time: %6.3f ms",
+    toMs(read(statistics.mMaxCallbackTimeNs)));
+  ImGui::Text(
+    "Underruns: %llu", (unsigned long long)read(statistics.mNumUnderruns));
+
+  ImGui::Separator();
+
+  ImGui::TextUnformatted("Callback durations");
+  for (auto i = std::size_t{0}; i < Stats::NUM_DURATION_BUCKETS; ++i) {
+    const auto count = read(statistics.mCallbackDurationHistogram[i]);
+    if (i < Stats::DURATION_BUCKET_LIMITS_US.size()) {
+      ImGui::Text(
+        "  < %5lld us  %llu",
+        (long long)Stats::DURATION_BUCKET_LIMITS_US[i],
+        (unsigned long long)count);
+    } else {
+      ImGui::Text(
+        "  >=%5lld us  %llu",
+        (long long)Stats::DURATION_BUCKET_LIMITS_US.back(),
+        (unsigned long long)count);
+    }
+  }
+
+  ImGui::Separator();
+
+  const auto emulatedSamples = read(statistics.mEmulatedSamples);
+  ImGui::Text(
+    "Emulation time per sample: %6.1f ns",
+    emulatedSamples > 0
+      ? double(read(statistics.mEmulationTimeNs)) / emulatedSamples
+      : 0.0);
+  ImGui::Text(
+    "Last music switch latency: %6.3f ms",
+    toMs(read(statistics.mLastSongSwitchLatencyNs)));
+  ImGui::Text(
+    "Max. music switch latency: %6.3f ms",
+    toMs(read(statistics.mMaxSongSwitchLatencyNs)));
+
+  ImGui::End();
+}
+
+}
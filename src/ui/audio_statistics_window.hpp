@@ -0,0 +1,34 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+namespace rigel::engine {
+  struct AudioStatistics;
+}
+
+namespace rigel::ui {
+
+/** Show an ImGui window with the audio thread's performance counters
+ *
+ * Shows a histogram of audio callback durations, the time spent emulating
+ * the AdLib per sample, music switch latency and the number of underruns.
+ */
+void showAudioStatisticsWindow(const engine::AudioStatistics& statistics);
+
+}
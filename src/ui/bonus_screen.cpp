@@ -19,7 +19,6 @@
 #include "common/game_service_provider.hpp"
 #include "engine/timing.hpp"
 #include "loader/resource_loader.hpp"
-#include "ui/utils.hpp"
 
 
 namespace rigel::ui {
@@ -81,10 +80,7 @@ BonusScreen::BonusScreen(
 )
   : mState(scoreBeforeAddingBonuses)
   , mpRenderer(context.mpRenderer)
-  , mBackgroundTexture(ui::fullScreenImageAsTexture(
-      context.mpRenderer,
-      *context.mpResources,
-      "BONUSSCN.MNI"))
+  , mpBackgroundTexture(context.mpFullScreenImages->get("BONUSSCN.MNI"))
   , mpTextRenderer(context.mpUiRenderer)
 {
   context.mpServiceProvider->playMusic("OPNGATEA.IMF");
@@ -110,7 +106,7 @@ BonusScreen::BonusScreen(
 void BonusScreen::updateAndRender(engine::TimeDelta dt) {
   updateSequence(dt);
 
-  mBackgroundTexture.render(mpRenderer, 0, 0);
+  mpBackgroundTexture->render(mpRenderer, 0, 0);
   mpTextRenderer->drawBonusScreenText(6, 8, "SCORE");
   mpTextRenderer->drawBonusScreenText(6, 17, mState.mRunningText);
 
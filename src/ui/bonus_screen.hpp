@@ -19,6 +19,7 @@
 #include "common/game_mode.hpp"
 #include "data/bonus.hpp"
 #include "engine/timing.hpp"
+#include "ui/full_screen_image_cache.hpp"
 #include "ui/menu_element_renderer.hpp"
 
 #include <functional>
@@ -72,7 +73,7 @@ private:
   std::size_t mNextEvent = 0;
 
   renderer::Renderer* mpRenderer;
-  renderer::OwningTexture mBackgroundTexture;
+  FullScreenImageCache::Handle mpBackgroundTexture;
   ui::MenuElementRenderer* mpTextRenderer;
 };
 
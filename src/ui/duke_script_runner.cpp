@@ -25,7 +25,8 @@
 #include "engine/tiled_texture.hpp"
 #include "engine/timing.hpp"
 #include "loader/resource_loader.hpp"
-#include "ui/utils.hpp"
+
+#include <algorithm>
 
 
 namespace rigel::ui {
@@ -39,6 +40,7 @@ using ExecutionResultOptional =
 namespace {
 
 const auto NUM_NEWS_REPORTER_STATES = 4;
+const auto NEWS_REPORTER_TICKS_PER_FRAME = 25;
 
 const auto KEY_BINDINGS_START_X = 26;
 const auto KEY_BINDINGS_START_Y = 7;
@@ -55,16 +57,32 @@ const auto INITIAL_SKILL_SELECTION = 1;
 const auto INITIAL_GAME_SPEED = 3;
 
 
+// Palette with a distinct color for each index. Images loaded using it can be
+// turned into indexed textures unambiguously, even if the palette they are
+// later drawn with contains the same color more than once.
+loader::Palette16 makeIndexPalette() {
+  loader::Palette16 palette;
+  for (auto i = 0u; i < palette.size(); ++i) {
+    palette[i] = data::Pixel{static_cast<std::uint8_t>(i), 0, 0, 255};
+  }
+
+  return palette;
+}
+
+
+// The sprite sheet is stored as an indexed texture, so that palette changes
+// only require updating the renderer's palette (see updatePalette()).
 auto makeSpriteSheet(
   renderer::Renderer* pRenderer,
-  const loader::ResourceLoader& resourceLoader,
-  const loader::Palette16& palette
+  const loader::ResourceLoader& resourceLoader
 ) {
+  const auto indexPalette = makeIndexPalette();
   return engine::TiledTexture{
     renderer::OwningTexture{
       pRenderer,
-      resourceLoader.loadTiledFullscreenImage(
-        "STATUS.MNI", palette)},
+      resourceLoader.loadTiledFullscreenIndexedImage("STATUS.MNI")
+        .toRgba(indexPalette),
+      indexPalette},
     pRenderer};
 }
 
@@ -74,19 +92,23 @@ auto makeSpriteSheet(
 DukeScriptRunner::DukeScriptRunner(
   loader::ResourceLoader* pResourceLoader,
   renderer::Renderer* pRenderer,
+  FullScreenImageCache* pFullScreenImages,
   const data::SaveSlotArray* pSaveSlots,
   IGameServiceProvider* pServiceProvider
 )
   : mpResourceBundle(pResourceLoader)
   , mCurrentPalette(loader::INGAME_PALETTE)
   , mpRenderer(pRenderer)
+  , mpFullScreenImages(pFullScreenImages)
   , mpSaveSlots(pSaveSlots)
   , mpServices(pServiceProvider)
   , mUiSpriteSheetRenderer(
-      makeSpriteSheet(pRenderer, *pResourceLoader, mCurrentPalette))
+      makeSpriteSheet(pRenderer, *pResourceLoader))
   , mMenuElementRenderer(&mUiSpriteSheetRenderer, pRenderer, *pResourceLoader)
   , mProgramCounter(0u)
 {
+  mpRenderer->setPalette(mCurrentPalette);
+
   // Default menu pre-selections at game start
   mPersistentMenuSelections.emplace(SKILL_LEVEL_SLOT, INITIAL_SKILL_SELECTION);
   mPersistentMenuSelections.emplace(GAME_SPEED_SLOT, INITIAL_GAME_SPEED);
@@ -105,8 +127,14 @@ void DukeScriptRunner::executeScript(const data::script::Script& script) {
 }
 
 
+void DukeScriptRunner::executeScript(data::script::Script&& script) {
+  mOwnedScript = std::move(script);
+  executeScript(mOwnedScript);
+}
+
+
 void DukeScriptRunner::startExecution(const data::script::Script& script) {
-  mCurrentInstructions = script;
+  mpCurrentInstructions = &script;
   mProgramCounter = 0u;
   mState = State::ExecutingScript;
 
@@ -256,6 +284,45 @@ void DukeScriptRunner::updateAndRender(engine::TimeDelta dt) {
 }
 
 
+std::optional<engine::TimeDelta>
+  DukeScriptRunner::timeUntilNextUpdate() const
+{
+  if (!isInWaitState() || mFadeInBeforeNextWaitStateScheduled) {
+    return std::nullopt;
+  }
+
+  auto result = std::numeric_limits<engine::TimeDelta>::max();
+
+  if (mMenuSelectionIndicatorState) {
+    result = std::min(
+      result,
+      MenuElementRenderer::timeUntilNextSelectionIndicatorFrame(
+        mMenuSelectionIndicatorState->mElapsedTime));
+  }
+
+  if (mDelayState) {
+    result = std::min(
+      result,
+      engine::slowTicksToTime(mDelayState->mTicksToWait) -
+        mDelayState->mElapsedTime);
+  }
+
+  if (mNewsReporterAnimationState) {
+    const auto& state = *mNewsReporterAnimationState;
+    const auto elapsedFrames = static_cast<int>(
+      engine::timeToFastTicks(state.mElapsedTime) /
+      NEWS_REPORTER_TICKS_PER_FRAME);
+    const auto nextFrameTicks =
+      (elapsedFrames + 1) * NEWS_REPORTER_TICKS_PER_FRAME;
+    result = std::min(
+      result,
+      engine::fastTicksToTime(nextFrameTicks) - state.mElapsedTime);
+  }
+
+  return std::max(result, 0.0);
+}
+
+
 void DukeScriptRunner::displayCheckBoxes(const CheckBoxesState& state) {
   const auto xPos = state.mPosX;
 
@@ -285,7 +352,7 @@ void DukeScriptRunner::animateNewsReporter(
   state.mElapsedTime += timeDelta;
   const auto elapsedTicks = engine::timeToFastTicks(state.mElapsedTime);
 
-  const auto elapsedFrames = elapsedTicks / 25.0;
+  const auto elapsedFrames = elapsedTicks / NEWS_REPORTER_TICKS_PER_FRAME;
   const auto numFramesAlreadyTalked = static_cast<int>(elapsedFrames);
 
   if (numFramesAlreadyTalked < state.mTalkDuration) {
@@ -329,14 +396,14 @@ void DukeScriptRunner::drawBigText(
 void DukeScriptRunner::interpretNextAction() {
   using namespace data::script;
 
-  if (mProgramCounter >= mCurrentInstructions.size()) {
+  if (mProgramCounter >= mpCurrentInstructions->size()) {
     mState = State::FinishedExecution;
     hideMenuSelectionIndicator();
     return;
   }
 
   base::match(
-    mCurrentInstructions[mProgramCounter++],
+    (*mpCurrentInstructions)[mProgramCounter++],
 
     [this](const AnimateNewsReporter& action) {
       mNewsReporterAnimationState = NewsReporterState{action.talkDuration};
@@ -365,11 +432,7 @@ void DukeScriptRunner::interpretNextAction() {
       updatePalette(
         mpResourceBundle->loadPaletteFromFullScreenImage(showImage.image));
 
-      const auto imageTexture = fullScreenImageAsTexture(
-        mpRenderer,
-        *mpResourceBundle,
-        showImage.image);
-      imageTexture.render(mpRenderer, 0, 0);
+      mpFullScreenImages->get(showImage.image)->render(mpRenderer, 0, 0);
       mpRenderer->submitBatch();
     },
 
@@ -404,7 +467,7 @@ void DukeScriptRunner::interpretNextAction() {
 
     [this](const SetPalette& action) {
       updatePalette(loader::load6bitPalette16(
-        mpResourceBundle->mFilePackage.file(action.paletteFile)));
+        mpResourceBundle->mFilePackage.fileView(action.paletteFile)));
     },
 
     [this](const SetupCheckBoxes& action) {
@@ -461,13 +524,11 @@ void DukeScriptRunner::interpretNextAction() {
     },
 
     [this](const std::shared_ptr<PagesDefinition>& pDefinition) {
-      const auto& definition = *pDefinition;
-
       mPagerState = PagerState{
-        definition.pages,
+        pDefinition,
         PagingMode::Menu,
         0,
-        static_cast<int>(definition.pages.size() - 1)
+        static_cast<int>(pDefinition->pages.size() - 1)
       };
 
       if (mCurrentPersistentSelectionSlot) {
@@ -508,24 +569,29 @@ void DukeScriptRunner::drawSprite(
   const int x,
   const int y
 ) {
-  const auto actorData =
-    mpResourceBundle->mActorImagePackage.loadActor(id, mCurrentPalette);
-  const auto& frameData = actorData.mFrames.at(frame);
-  const auto& image = frameData.mFrameImage;
-
-  const auto spriteHeightTiles =
-    data::pixelsToTiles(
-      static_cast<int>(image.height()));
-  const auto pos = base::Vector{x - 1, y};
-  const auto topLeft = pos - base::Vector(0, spriteHeightTiles - 1);
-
-  const auto topLeftPx = data::tileVectorToPixelVector(topLeft);
-  const auto drawOffsetPx =
-    data::tileVectorToPixelVector(frameData.mDrawOffset);
+  // Scripts tend to draw the same few sprites over and over, e.g. for
+  // animations. Textures are therefore kept around until the palette changes,
+  // and the actor data is only looked at when creating them.
+  auto iSprite = mSpriteTextures.find({id, frame});
+  if (iSprite == mSpriteTextures.end()) {
+    const auto& frameData = mpResourceBundle->mActorImagePackage.loadActorFrame(
+      id, frame, mCurrentPalette);
+    const auto& image = frameData.mFrameImage;
+
+    const auto spriteHeightTiles =
+      data::pixelsToTiles(static_cast<int>(image.height()));
+    const auto drawOffsetPx = data::tileVectorToPixelVector(
+      frameData.mDrawOffset - base::Vector{1, spriteHeightTiles - 1});
+
+    iSprite = mSpriteTextures.emplace(
+      SpriteTextureKey{id, frame},
+      CachedSprite{renderer::OwningTexture{mpRenderer, image}, drawOffsetPx}
+    ).first;
+  }
 
-  renderer::OwningTexture spriteTexture(mpRenderer, image);
-  spriteTexture.render(mpRenderer, topLeftPx + drawOffsetPx);
-  mpRenderer->submitBatch();
+  const auto& sprite = iSprite->second;
+  const auto posPx = data::tileVectorToPixelVector({x, y});
+  sprite.mTexture.render(mpRenderer, posPx + sprite.mDrawOffsetPx);
 }
 
 
@@ -564,7 +630,7 @@ void DukeScriptRunner::onPageChanged(PagerState& state) {
 
 
 void DukeScriptRunner::executeCurrentPageScript(PagerState& state) {
-  startExecution(state.mPageScripts[state.mCurrentPageIndex]);
+  startExecution(state.mpPages->pages[state.mCurrentPageIndex]);
 }
 
 
@@ -651,14 +717,14 @@ void DukeScriptRunner::drawCurrentKeyBindings() {
 
 
 void DukeScriptRunner::updatePalette(const loader::Palette16& palette) {
-  // TODO think about optimizing this maybe, to only update if actually
-  // changed, e.g. if (palette != mCurrentPalette) or maybe have a
-  // 'paletteSource' string (name of palette file or fullscreen image file),
-  // which can be compared to determine if update needed.
+  if (palette != mCurrentPalette) {
+    // Pending draw calls might still refer to the textures
+    mpRenderer->submitBatch();
+    mSpriteTextures.clear();
+  }
 
   mCurrentPalette = palette;
-  mUiSpriteSheetRenderer =
-    makeSpriteSheet(mpRenderer, *mpResourceBundle, mCurrentPalette);
+  mpRenderer->setPalette(mCurrentPalette);
 }
 
 
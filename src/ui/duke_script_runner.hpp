@@ -24,10 +24,15 @@
 #include "engine/timing.hpp"
 #include "loader/palette.hpp"
 #include "renderer/texture.hpp"
+#include "ui/full_screen_image_cache.hpp"
 #include "ui/menu_element_renderer.hpp"
 
 #include <cstddef>
+#include <limits>
+#include <map>
+#include <memory>
 #include <optional>
+#include <utility>
 
 
 namespace rigel::ui {
@@ -48,10 +53,19 @@ public:
   DukeScriptRunner(
     loader::ResourceLoader* pResourceLoader,
     renderer::Renderer* pRenderer,
+    FullScreenImageCache* pFullScreenImages,
     const data::SaveSlotArray* pSaveSlots,
     IGameServiceProvider* pServiceProvider);
 
+  /** Start executing the given script
+   *
+   * The script is not copied, so it needs to stay alive until execution has
+   * finished or another script is started. For temporary scripts, use the
+   * overload taking an rvalue reference, which keeps the script alive as
+   * long as needed.
+   */
   void executeScript(const data::script::Script& script);
+  void executeScript(data::script::Script&& script);
 
   bool hasFinishedExecution() const;
   std::optional<ExecutionResult> result() const;
@@ -59,6 +73,16 @@ public:
   void updateAndRender(engine::TimeDelta dt);
   void handleEvent(const SDL_Event& event);
 
+  /** Time until updateAndRender() would change what's on screen
+   *
+   * While waiting for user input, most script pages are static, apart from
+   * some timed animations. This returns how long the runner can go without
+   * being updated, assuming no input arrives in the meantime. If nothing is
+   * animating, the result is std::numeric_limits<>::max(). Returns nothing
+   * when the runner needs to be updated every frame.
+   */
+  std::optional<engine::TimeDelta> timeUntilNextUpdate() const;
+
 private:
   enum class State {
     ReadyToExecute,
@@ -105,7 +129,7 @@ private:
   };
 
   struct PagerState {
-    std::vector<data::script::Script> mPageScripts;
+    std::shared_ptr<const data::script::PagesDefinition> mpPages;
     PagingMode mMode;
     int mCurrentPageIndex;
     int mMaxPageIndex;
@@ -164,13 +188,25 @@ private:
   const loader::ResourceLoader* mpResourceBundle;
   loader::Palette16 mCurrentPalette;
   renderer::Renderer* mpRenderer;
+  FullScreenImageCache* mpFullScreenImages;
   const data::SaveSlotArray* mpSaveSlots;
   IGameServiceProvider* mpServices;
   engine::TiledTexture mUiSpriteSheetRenderer;
   MenuElementRenderer mMenuElementRenderer;
 
+  struct CachedSprite {
+    renderer::OwningTexture mTexture;
+    base::Vector mDrawOffsetPx;
+  };
+
+  using SpriteTextureKey = std::pair<data::ActorID, int>;
+  std::map<SpriteTextureKey, CachedSprite> mSpriteTextures;
+
 
-  data::script::Script mCurrentInstructions;
+  // Points either into the script given to executeScript(), or into one of
+  // the pages of the current PagerState
+  const data::script::Script* mpCurrentInstructions = nullptr;
+  data::script::Script mOwnedScript;
   std::size_t mProgramCounter;
   State mState = State::ReadyToExecute;
 
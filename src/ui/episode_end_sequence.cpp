@@ -19,7 +19,7 @@
 #include "base/container_utils.hpp"
 #include "common/game_service_provider.hpp"
 #include "engine/timing.hpp"
-#include "ui/utils.hpp"
+#include "loader/resource_loader.hpp"
 
 
 namespace rigel::ui {
@@ -53,10 +53,16 @@ std::vector<renderer::OwningTexture> loadImagesForEpisode(
   const int episode
 ) {
   auto createTextures = [&context](const auto& imageFilenames) {
-    return utils::transformed(imageFilenames, [&](const char* imageFilename) {
-      return ui::fullScreenImageAsTexture(
-        context.mpRenderer, *context.mpResources, imageFilename);
-    });
+    const auto images =
+      utils::transformed(imageFilenames, [&](const char* imageFilename) {
+        return context.mpResources->loadStandaloneFullscreenImage(
+          imageFilename);
+      });
+
+    return renderer::OwningTexture::createMany(
+      context.mpRenderer,
+      base::ArrayView<data::Image>{
+        images.data(), static_cast<std::uint32_t>(images.size())});
   };
 
   switch (episode) {
@@ -37,7 +37,8 @@ const auto FILTER_WEIGHT = 0.9f;
 
 void FpsDisplay::updateAndRender(
   const engine::TimeDelta totalElapsed,
-  const engine::TimeDelta renderingElapsed
+  const engine::TimeDelta renderingElapsed,
+  const renderer::Renderer::FrameStatistics& renderStats
 ) {
   mPreFilteredFrameTime = base::lerp(
     static_cast<float>(totalElapsed), mPreFilteredFrameTime, PRE_FILTER_WEIGHT);
@@ -55,6 +56,15 @@ void FpsDisplay::updateAndRender(
 
   const auto reportString = statsReport.str();
   drawText(reportString, 0, 0, {255, 255, 255, 255});
+
+  std::stringstream renderStatsReport;
+  renderStatsReport
+    << renderStats.mDrawCalls << " draw calls, "
+    << renderStats.mQuads << " quads, "
+    << renderStats.mCulledDraws << " culled, "
+    << renderStats.mBytesUploaded / 1024 << " KiB uploaded";
+
+  drawText(renderStatsReport.str(), 0, 16, {255, 255, 255, 255});
 }
 
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "engine/timing.hpp"
+#include "renderer/renderer.hpp"
 
 
 namespace rigel::ui {
@@ -25,7 +26,8 @@ class FpsDisplay {
 public:
   void updateAndRender(
     engine::TimeDelta totalElapsed,
-    engine::TimeDelta renderingElapsed);
+    engine::TimeDelta renderingElapsed,
+    const renderer::Renderer::FrameStatistics& renderStats);
 
 private:
   float mPreFilteredFrameTime = 0.0f;
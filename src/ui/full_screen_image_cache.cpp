@@ -0,0 +1,104 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "full_screen_image_cache.hpp"
+
+#include "base/memory_accounting.hpp"
+#include "engine/trace_recorder.hpp"
+#include "loader/resource_loader.hpp"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace rigel::ui {
+
+FullScreenImageCache::FullScreenImageCache(
+  renderer::Renderer* pRenderer,
+  const loader::ResourceLoader* pResources
+)
+  : mpRenderer(pRenderer)
+  , mpResources(pResources)
+{
+}
+
+
+auto FullScreenImageCache::get(const std::string& imageName) -> Handle {
+  if (base::memory_accounting::isOverBudget()) {
+    releaseUnused();
+  }
+
+  auto& pCachedTexture = mTextures[imageName];
+  auto pTexture = pCachedTexture.lock();
+  if (!pTexture) {
+    pTexture = std::make_shared<const renderer::OwningTexture>(
+      mpRenderer, mpResources->loadStandaloneFullscreenImage(imageName));
+    pCachedTexture = pTexture;
+  }
+
+  retain(imageName, pTexture);
+  return pTexture;
+}
+
+
+void FullScreenImageCache::releaseUnused() {
+  if (!mRetainedTextures.empty() && engine::traceRecorder().isEnabled()) {
+    engine::traceRecorder().addInstant(
+      "Full screen image eviction", engine::TraceRecorder::Clock::now());
+  }
+
+  mRetainedTextures.clear();
+
+  for (auto it = mTextures.begin(); it != mTextures.end();) {
+    if (it->second.expired()) {
+      it = mTextures.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+
+std::size_t FullScreenImageCache::numCachedTextures() const {
+  return std::count_if(
+    mTextures.begin(), mTextures.end(), [](const auto& entry) {
+      return !entry.second.expired();
+    });
+}
+
+
+void FullScreenImageCache::retain(
+  const std::string& imageName,
+  Handle pTexture
+) {
+  const auto it = std::find_if(
+    mRetainedTextures.begin(),
+    mRetainedTextures.end(),
+    [&](const auto& entry) { return entry.first == imageName; });
+
+  if (it != mRetainedTextures.end()) {
+    mRetainedTextures.splice(
+      mRetainedTextures.begin(), mRetainedTextures, it);
+    return;
+  }
+
+  mRetainedTextures.emplace_front(imageName, std::move(pTexture));
+  if (mRetainedTextures.size() > NUM_RETAINED_TEXTURES) {
+    mRetainedTextures.pop_back();
+  }
+}
+
+}
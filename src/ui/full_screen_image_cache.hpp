@@ -0,0 +1,77 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "renderer/texture.hpp"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+namespace rigel::loader {
+  class ResourceLoader;
+}
+
+namespace rigel::ui {
+
+/** Shares textures for standalone full screen images
+ *
+ * Menus, story screens and the bonus screen show the same handful of
+ * full screen images over and over. Instead of decoding and uploading them
+ * each time, users get a shared handle from this cache. A texture stays
+ * alive as long as any handle refers to it. The most recently released
+ * textures are kept around a little longer, so that going back and forth
+ * between two screens doesn't reload anything.
+ *
+ * Those retained textures are dropped when the asset memory budget is
+ * exceeded, see base/memory_accounting.hpp.
+ */
+class FullScreenImageCache {
+public:
+  using Handle = std::shared_ptr<const renderer::OwningTexture>;
+
+  static constexpr auto NUM_RETAINED_TEXTURES = std::size_t{4};
+
+  FullScreenImageCache(
+    renderer::Renderer* pRenderer,
+    const loader::ResourceLoader* pResources);
+
+  /** Return texture for the given image, loading it if necessary */
+  Handle get(const std::string& imageName);
+
+  /** Drop textures which are only kept alive by the cache itself */
+  void releaseUnused();
+
+  std::size_t numCachedTextures() const;
+
+private:
+  void retain(const std::string& imageName, Handle pTexture);
+
+  renderer::Renderer* mpRenderer;
+  const loader::ResourceLoader* mpResources;
+
+  std::unordered_map<std::string, std::weak_ptr<const renderer::OwningTexture>>
+    mTextures;
+
+  // Most recently used first
+  std::list<std::pair<std::string, Handle>> mRetainedTextures;
+};
+
+}
@@ -61,13 +61,8 @@ void setupHighScoreListDisplay(GameMode::Context& context, const int episode) {
     context.mpServiceProvider->fadeInScreen();
   }
 
-  {
-    auto awaitInput = data::script::Script{
-      data::script::WaitForUserInput{}
-    };
-
-    context.mpScriptRunner->executeScript(awaitInput);
-  }
+  context.mpScriptRunner->executeScript(
+    data::script::Script{data::script::WaitForUserInput{}});
 }
 
 ui::TextEntryWidget setupHighScoreNameEntry(GameMode::Context& context) {
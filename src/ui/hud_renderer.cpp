@@ -113,14 +113,21 @@ OwningTexture actorToTexture(
 }
 
 
+OwningTexture hudFrameTexture(
+  renderer::Renderer* pRenderer,
+  const loader::ActorImagePackage& imagePack,
+  const int frame
+) {
+  const auto& data = imagePack.loadActor(ActorID::HUD_frame_background);
+  return OwningTexture(pRenderer, data.mFrames[frame].mFrameImage);
 }
 
 
-HudRenderer::InventoryItemTextureMap HudRenderer::makeInventoryItemTextureMap(
+HudAssets::InventoryItemTextureMap makeInventoryItemTextureMap(
   renderer::Renderer* pRenderer,
   const loader::ActorImagePackage& imagePack
 ) {
-  InventoryItemTextureMap map;
+  HudAssets::InventoryItemTextureMap map;
 
   map.emplace(
     InventoryItemType::CircuitBoard,
@@ -141,12 +148,11 @@ HudRenderer::InventoryItemTextureMap HudRenderer::makeInventoryItemTextureMap(
 }
 
 
-HudRenderer::CollectedLetterIndicatorMap
-HudRenderer::makeCollectedLetterTextureMap(
+HudAssets::CollectedLetterIndicatorMap makeCollectedLetterTextureMap(
   renderer::Renderer* pRenderer,
   const loader::ActorImagePackage& imagePack
 ) {
-  CollectedLetterIndicatorMap map;
+  HudAssets::CollectedLetterIndicatorMap map;
 
   const auto rightScreenEdge = GameTraits::inGameViewPortSize.width;
   const auto bottomScreenEdge = GameTraits::inGameViewPortSize.height;
@@ -158,48 +164,45 @@ HudRenderer::makeCollectedLetterTextureMap(
   const base::Vector letterSize{GameTraits::tileSize, 0};
   map.emplace(
     CollectableLetterType::N,
-    CollectedLetterIndicator{
+    HudAssets::CollectedLetterIndicator{
       actorToTexture(pRenderer, imagePack.loadActor(ActorID::Letter_collection_indicator_N)),
       letterDrawStart});
   map.emplace(
     CollectableLetterType::U,
-    CollectedLetterIndicator{
+    HudAssets::CollectedLetterIndicator{
       actorToTexture(pRenderer, imagePack.loadActor(ActorID::Letter_collection_indicator_U)),
       letterDrawStart});
   map.emplace(
     CollectableLetterType::K,
-    CollectedLetterIndicator{
+    HudAssets::CollectedLetterIndicator{
       actorToTexture(pRenderer, imagePack.loadActor(ActorID::Letter_collection_indicator_K)),
       letterDrawStart + letterSize * 1});
   map.emplace(
     CollectableLetterType::E,
-    CollectedLetterIndicator{
+    HudAssets::CollectedLetterIndicator{
       actorToTexture(pRenderer, imagePack.loadActor(ActorID::Letter_collection_indicator_E)),
       letterDrawStart + letterSize * 2});
   map.emplace(
     CollectableLetterType::M,
-    CollectedLetterIndicator{
+    HudAssets::CollectedLetterIndicator{
       actorToTexture(pRenderer, imagePack.loadActor(ActorID::Letter_collection_indicator_M)),
       letterDrawStart + letterSize * 3});
   return map;
 }
 
+}
 
-HudRenderer::HudRenderer(
-  data::PlayerModel* pPlayerModel,
-  const int levelNumber,
+
+HudAssets::HudAssets(
   renderer::Renderer* pRenderer,
-  const loader::ResourceLoader& bundle,
-  engine::TiledTexture* pStatusSpriteSheet
+  const loader::ActorImagePackage& imagePack
 )
-  : HudRenderer(
-      pPlayerModel,
-      levelNumber,
-      pRenderer,
-      bundle.mActorImagePackage.loadActor(ActorID::HUD_frame_background),
-      makeInventoryItemTextureMap(pRenderer, bundle.mActorImagePackage),
-      makeCollectedLetterTextureMap(pRenderer, bundle.mActorImagePackage),
-      pStatusSpriteSheet)
+  : mTopRightTexture(hudFrameTexture(pRenderer, imagePack, 0))
+  , mBottomLeftTexture(hudFrameTexture(pRenderer, imagePack, 1))
+  , mBottomRightTexture(hudFrameTexture(pRenderer, imagePack, 2))
+  , mInventoryTexturesByType(makeInventoryItemTextureMap(pRenderer, imagePack))
+  , mCollectedLetterIndicatorsByType(
+      makeCollectedLetterTextureMap(pRenderer, imagePack))
 {
 }
 
@@ -208,20 +211,20 @@ HudRenderer::HudRenderer(
   data::PlayerModel* pPlayerModel,
   const int levelNumber,
   renderer::Renderer* pRenderer,
-  const loader::ActorData& actorData,
-  InventoryItemTextureMap&& inventoryItemTextures,
-  CollectedLetterIndicatorMap&& collectedLetterTextures,
-  engine::TiledTexture* pStatusSpriteSheet
+  const HudAssets* pAssets,
+  engine::TiledTexture* pStatusSpriteSheet,
+  const data::ViewPortSize& viewPortSize
 )
   : mpPlayerModel(pPlayerModel)
   , mLevelNumber(levelNumber)
   , mpRenderer(pRenderer)
-  , mTopRightTexture(mpRenderer, actorData.mFrames[0].mFrameImage)
-  , mBottomLeftTexture(mpRenderer, actorData.mFrames[1].mFrameImage)
-  , mBottomRightTexture(mpRenderer, actorData.mFrames[2].mFrameImage)
-  , mInventoryTexturesByType(std::move(inventoryItemTextures))
-  , mCollectedLetterIndicatorsByType(std::move(collectedLetterTextures))
+  , mpAssets(pAssets)
   , mpStatusSpriteSheetRenderer(pStatusSpriteSheet)
+  , mHudTexture(
+      mpRenderer,
+      GameTraits::inGameViewPortSize.width,
+      GameTraits::inGameViewPortSize.height)
+  , mExtraWidthPx(viewPortSize.extraWidthPx())
 {
 }
 
@@ -232,21 +235,91 @@ void HudRenderer::updateAnimation() {
 
 
 void HudRenderer::render() {
+  if (!mHudTextureIsValid || !displayedStateIsCurrent()) {
+    updateDisplayedState();
+
+    renderer::RenderTargetTexture::Binder bindTarget(mHudTexture, mpRenderer);
+    mpRenderer->clear({0, 0, 0, 0});
+    drawHud();
+
+    mHudTextureIsValid = true;
+  }
+
+  if (mExtraWidthPx == 0) {
+    mHudTexture.render(mpRenderer, 0, 0);
+    return;
+  }
+
+  // The right hand side panel starts where the map view ends in the
+  // original game
+  const auto splitX = GameTraits::mapViewPortWidthTiles * GameTraits::tileSize;
+  const auto hudHeight = GameTraits::inGameViewPortSize.height;
+  mHudTexture.render(mpRenderer, {0, 0}, {{0, 0}, {splitX, hudHeight}});
+  mHudTexture.render(
+    mpRenderer,
+    {splitX + mExtraWidthPx, 0},
+    {{splitX, 0}, {GameTraits::inGameViewPortSize.width - splitX, hudHeight}});
+
+  // The bottom left part of the frame continues seamlessly into the bottom
+  // right one, so its last column is plain background
+  const auto barHeight = mpAssets->mBottomLeftTexture.height();
+  mpRenderer->drawTexture(
+    mpAssets->mBottomLeftTexture.data(),
+    {{mpAssets->mBottomLeftTexture.width() - 1, 0}, {1, barHeight}},
+    {{splitX, hudHeight - barHeight}, {mExtraWidthPx, barHeight}});
+}
+
+
+int HudRenderer::healthAnimationStep() const {
+  // The health bar is only animated when the player has 1 point of health
+  // left, see drawHealthBar()
+  return mpPlayerModel->health() <= 1 ? int(mElapsedFrames % 9) : 0;
+}
+
+
+bool HudRenderer::displayedStateIsCurrent() const {
+  const auto& state = mDisplayedState;
+  return
+    state.mScore == mpPlayerModel->score() &&
+    state.mAmmo == mpPlayerModel->ammo() &&
+    state.mMaxAmmo == mpPlayerModel->currentMaxAmmo() &&
+    state.mHealth == mpPlayerModel->health() &&
+    state.mHealthAnimationStep == healthAnimationStep() &&
+    state.mWeapon == mpPlayerModel->weapon() &&
+    state.mInventory == mpPlayerModel->inventory() &&
+    state.mCollectedLetters == mpPlayerModel->collectedLetters();
+}
+
+
+void HudRenderer::updateDisplayedState() {
+  auto& state = mDisplayedState;
+  state.mScore = mpPlayerModel->score();
+  state.mAmmo = mpPlayerModel->ammo();
+  state.mMaxAmmo = mpPlayerModel->currentMaxAmmo();
+  state.mHealth = mpPlayerModel->health();
+  state.mHealthAnimationStep = healthAnimationStep();
+  state.mWeapon = mpPlayerModel->weapon();
+  state.mInventory = mpPlayerModel->inventory();
+  state.mCollectedLetters = mpPlayerModel->collectedLetters();
+}
+
+
+void HudRenderer::drawHud() const {
   // Hud background
   // --------------------------------------------------------------------------
   const auto maxX = GameTraits::inGameViewPortSize.width;
-  mBottomLeftTexture.render(
+  mpAssets->mBottomLeftTexture.render(
     mpRenderer,
     0,
-    GameTraits::inGameViewPortSize.height - mBottomLeftTexture.height());
+    GameTraits::inGameViewPortSize.height - mpAssets->mBottomLeftTexture.height());
 
-  mBottomRightTexture.render(
+  mpAssets->mBottomRightTexture.render(
     mpRenderer,
-    mBottomLeftTexture.width(),
-    GameTraits::inGameViewPortSize.height - mBottomRightTexture.height());
+    mpAssets->mBottomLeftTexture.width(),
+    GameTraits::inGameViewPortSize.height - mpAssets->mBottomRightTexture.height());
 
-  const auto topRightTexturePosX = maxX - mTopRightTexture.width();
-  mTopRightTexture.render(mpRenderer, topRightTexturePosX, 0);
+  const auto topRightTexturePosX = maxX - mpAssets->mTopRightTexture.width();
+  mpAssets->mTopRightTexture.render(mpRenderer, topRightTexturePosX, 0);
 
   // Inventory
   // --------------------------------------------------------------------------
@@ -261,8 +334,8 @@ void HudRenderer::render() {
         const auto drawPos =
           inventoryStartPos + base::Vector{col, row} * GameTraits::tileSize*2;
 
-        const auto textureIt = mInventoryTexturesByType.find(itemType);
-        assert(textureIt != mInventoryTexturesByType.end());
+        const auto textureIt = mpAssets->mInventoryTexturesByType.find(itemType);
+        assert(textureIt != mpAssets->mInventoryTexturesByType.end());
         textureIt->second.render(mpRenderer, drawPos);
       }
     }
@@ -311,8 +384,8 @@ void HudRenderer::drawHealthBar() const {
 
 void HudRenderer::drawCollectedLetters() const {
   for (const auto letter : mpPlayerModel->collectedLetters()) {
-    const auto it = mCollectedLetterIndicatorsByType.find(letter);
-    assert(it != mCollectedLetterIndicatorsByType.end());
+    const auto it = mpAssets->mCollectedLetterIndicatorsByType.find(letter);
+    assert(it != mpAssets->mCollectedLetterIndicatorsByType.end());
     it->second.mTexture.render(mpRenderer, it->second.mPxPosition);
   }
 }
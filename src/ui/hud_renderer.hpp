@@ -16,12 +16,14 @@
 
 #pragma once
 
+#include "data/game_traits.hpp"
 #include "data/player_model.hpp"
 #include "engine/tiled_texture.hpp"
 #include "renderer/texture.hpp"
 
 #include <cstdint>
 #include <unordered_map>
+#include <vector>
 
 
 namespace rigel {
@@ -40,19 +42,16 @@ namespace loader {
 
 namespace ui {
 
-class HudRenderer {
-public:
-  HudRenderer(
-    data::PlayerModel* pPlayerModel,
-    int levelNumber,
+/** Textures used by the HUD which don't depend on the current level
+ *
+ * Created once per game session and shared by all HudRenderers, so that
+ * starting a level doesn't need to upload these again.
+ */
+struct HudAssets {
+  HudAssets(
     renderer::Renderer* pRenderer,
-    const loader::ResourceLoader& bundle,
-    engine::TiledTexture* pStatusSpriteSheetRenderer);
-
-  void updateAnimation();
-  void render();
+    const loader::ActorImagePackage& imagePack);
 
-private:
   struct CollectedLetterIndicator {
     renderer::OwningTexture mTexture;
     base::Vector mPxPosition;
@@ -63,23 +62,55 @@ private:
   using CollectedLetterIndicatorMap =
     std::unordered_map<data::CollectableLetterType, CollectedLetterIndicator>;
 
+  renderer::OwningTexture mTopRightTexture;
+  renderer::OwningTexture mBottomLeftTexture;
+  renderer::OwningTexture mBottomRightTexture;
+  InventoryItemTextureMap mInventoryTexturesByType;
+  CollectedLetterIndicatorMap mCollectedLetterIndicatorsByType;
+};
+
+
+/** Draws the ingame HUD
+ *
+ * The HUD is composed into a render target, which is only redrawn when
+ * any of the displayed player state (or the low health animation) changes.
+ * Otherwise, rendering just draws the render target's contents.
+ *
+ * The HUD is always composed at the original game's size. For a wider view,
+ * the right hand side panel is drawn further to the right, and the bottom
+ * bar is stretched to close the gap.
+ */
+class HudRenderer {
+public:
   HudRenderer(
     data::PlayerModel* pPlayerModel,
     int levelNumber,
     renderer::Renderer* pRenderer,
-    const loader::ActorData& actorData,
-    InventoryItemTextureMap&& inventoryItemTextures,
-    CollectedLetterIndicatorMap&& collectedLetterTextures,
-    engine::TiledTexture* pStatusSpriteSheetRenderer);
+    const HudAssets* pAssets,
+    engine::TiledTexture* pStatusSpriteSheetRenderer,
+    const data::ViewPortSize& viewPortSize);
 
-  static InventoryItemTextureMap makeInventoryItemTextureMap(
-    renderer::Renderer* pRenderer,
-    const loader::ActorImagePackage& imagePack);
+  void updateAnimation();
+  void render();
 
-  static CollectedLetterIndicatorMap makeCollectedLetterTextureMap(
-    renderer::Renderer* pRenderer,
-    const loader::ActorImagePackage& imagePack);
+private:
+  /** State of everything shown by the HUD as of the last redraw */
+  struct DisplayedState {
+    std::vector<data::InventoryItemType> mInventory;
+    std::vector<data::CollectableLetterType> mCollectedLetters;
+    int mScore = 0;
+    int mAmmo = 0;
+    int mMaxAmmo = 0;
+    int mHealth = 0;
+    int mHealthAnimationStep = 0;
+    data::WeaponType mWeapon = data::WeaponType::Normal;
+  };
 
+  int healthAnimationStep() const;
+  bool displayedStateIsCurrent() const;
+  void updateDisplayedState();
+
+  void drawHud() const;
   void drawHealthBar() const;
   void drawCollectedLetters() const;
 
@@ -89,12 +120,13 @@ private:
 
   std::uint32_t mElapsedFrames = 0;
 
-  renderer::OwningTexture mTopRightTexture;
-  renderer::OwningTexture mBottomLeftTexture;
-  renderer::OwningTexture mBottomRightTexture;
-  InventoryItemTextureMap mInventoryTexturesByType;
-  CollectedLetterIndicatorMap mCollectedLetterIndicatorsByType;
+  const HudAssets* mpAssets;
   engine::TiledTexture* mpStatusSpriteSheetRenderer;
+
+  renderer::RenderTargetTexture mHudTexture;
+  DisplayedState mDisplayedState;
+  int mExtraWidthPx;
+  bool mHudTextureIsValid = false;
 };
 
 }}
@@ -85,8 +85,13 @@ void beginFrame(SDL_Window* pWindow) {
 }
 
 
-void endFrame() {
+bool endFrame() {
   ImGui::Render();
+  return ImGui::GetDrawData()->TotalVtxCount > 0;
+}
+
+
+void renderFrame() {
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -30,6 +30,12 @@ void shutdown();
 
 bool handleEvent(const SDL_Event& event);
 void beginFrame(SDL_Window* pWindow);
-void endFrame();
+
+/** Finish the current frame, return true if there's anything to draw
+ *
+ * The frame's contents are drawn by the next call to renderFrame().
+ */
+bool endFrame();
+void renderFrame();
 
 }
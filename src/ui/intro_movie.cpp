@@ -62,133 +62,147 @@ using data::SoundId;
 
 
 IntroMovie::PlaybackConfigList IntroMovie::createConfigurations(
-  const loader::ResourceLoader& resources
-){
-  return {
-    // Neo LA - the future
-    {
-      resources.loadMovie("NUKEM2.F2"),
-      70,
-      6,
-      nullptr
-    },
-
-    // Focus on Duke shooting at range
-    {
-      resources.loadMovie("NUKEM2.F1"),
-      14,
-      10,
-      [pServiceProvider = mpServiceProvider](const int frame) {
-        if (frame == 0) {
-          pServiceProvider->playSound(SoundId::IntroGunShot);
-        }
-
-        return std::nullopt;
+  const loader::ResourceLoader* pResources,
+  IGameServiceProvider* pServiceProvider
+) {
+  // Each movie is decoded on its own worker thread. This only reads files,
+  // which is safe to do while the main thread keeps using the resource
+  // loader. The frame callbacks are only invoked on the main thread, during
+  // playback.
+  auto loadMovie = [pResources](const char* name) {
+    return std::async(std::launch::async, [pResources, name]() {
+      return pResources->loadMovie(name);
+    }).share();
+  };
+
+  PlaybackConfigList configs;
+
+  // Neo LA - the future
+  configs.push_back({
+    loadMovie("NUKEM2.F2"),
+    70,
+    6,
+    nullptr
+  });
+
+  // Focus on Duke shooting at range
+  configs.push_back({
+    loadMovie("NUKEM2.F1"),
+    14,
+    10,
+    [pServiceProvider](const int frame) {
+      if (frame == 0) {
+        pServiceProvider->playSound(SoundId::IntroGunShot);
       }
-    },
-
-    // Focus on target being hit
-    {
-      resources.loadMovie("NUKEM2.F3"),
-      23,
-      2,
-      [pServiceProvider = mpServiceProvider](const int frame) {
-        if (frame == 0 || frame == 3 || frame == 6) {
-          pServiceProvider->playSound(SoundId::IntroGunShotLow);
-        }
-
-        return std::nullopt;
+
+      return std::nullopt;
+    }
+  });
+
+  // Focus on target being hit
+  configs.push_back({
+    loadMovie("NUKEM2.F3"),
+    23,
+    2,
+    [pServiceProvider](const int frame) {
+      if (frame == 0 || frame == 3 || frame == 6) {
+        pServiceProvider->playSound(SoundId::IntroGunShotLow);
       }
-    },
-
-    // Remainder of shooting range scene
-    {
-      resources.loadMovie("NUKEM2.F4"),
-      46,
-      1,
-      [pServiceProvider = mpServiceProvider](const int frame) {
-        std::optional<int> newFrameDelay = std::nullopt;
-
-        switch (frame) {
-          case 0:
-            pServiceProvider->playSound(SoundId::IntroEmptyShellsFalling);
-            break;
-
-          case 7:
-            pServiceProvider->playSound(SoundId::IntroTargetMovingCloser);
-            break;
-
-          case 23:
-            // 2 second freeze frame on smiling Duke
-            newFrameDelay = 560;
-            break;
-
-          case 24:
-            newFrameDelay = 46;
-            break;
-
-          case 31:
-            // 2 second freeze frame on target (now up close)
-            pServiceProvider->stopSound(SoundId::IntroTargetMovingCloser);
-            pServiceProvider->playSound(SoundId::IntroTargetStopsMoving);
-            newFrameDelay = 560;
-            break;
-
-          case 32:
-            // 1 second freeze frame on Duke looking at target
-            newFrameDelay = 280;
-            break;
-
-          case 33:
-            pServiceProvider->playSound(SoundId::IntroDukeSpeaks1);
-            newFrameDelay = 56;
-            break;
-
-          case 37:
-            pServiceProvider->playSound(SoundId::IntroDukeSpeaks2);
-            break;
-
-          case 39:
-            // 1 second freeze frame on Duke after he spoke
-            newFrameDelay = 280;
-            break;
-
-          case 40:
-            // Begin logo text slide in
-            newFrameDelay = 16;
-            break;
-
-          case 49:
-            // 1st logo text smash, 1 second freeze
-            pServiceProvider->playSound(SoundId::BigExplosion);
-            newFrameDelay = 280;
-            break;
-
-          case 50:
-            // Begin 2nd phase logo slide in (letters "II")
-            newFrameDelay = 16;
-            break;
-
-          case 55:
-            // Show logo for 4 seconds
-            pServiceProvider->playSound(SoundId::BigExplosion);
-            newFrameDelay = 1120;
-            break;
-        }
-
-        return newFrameDelay;
+
+      return std::nullopt;
+    }
+  });
+
+  // Remainder of shooting range scene
+  configs.push_back({
+    loadMovie("NUKEM2.F4"),
+    46,
+    1,
+    [pServiceProvider](const int frame) {
+      std::optional<int> newFrameDelay = std::nullopt;
+
+      switch (frame) {
+        case 0:
+          pServiceProvider->playSound(SoundId::IntroEmptyShellsFalling);
+          break;
+
+        case 7:
+          pServiceProvider->playSound(SoundId::IntroTargetMovingCloser);
+          break;
+
+        case 23:
+          // 2 second freeze frame on smiling Duke
+          newFrameDelay = 560;
+          break;
+
+        case 24:
+          newFrameDelay = 46;
+          break;
+
+        case 31:
+          // 2 second freeze frame on target (now up close)
+          pServiceProvider->stopSound(SoundId::IntroTargetMovingCloser);
+          pServiceProvider->playSound(SoundId::IntroTargetStopsMoving);
+          newFrameDelay = 560;
+          break;
+
+        case 32:
+          // 1 second freeze frame on Duke looking at target
+          newFrameDelay = 280;
+          break;
+
+        case 33:
+          pServiceProvider->playSound(SoundId::IntroDukeSpeaks1);
+          newFrameDelay = 56;
+          break;
+
+        case 37:
+          pServiceProvider->playSound(SoundId::IntroDukeSpeaks2);
+          break;
+
+        case 39:
+          // 1 second freeze frame on Duke after he spoke
+          newFrameDelay = 280;
+          break;
+
+        case 40:
+          // Begin logo text slide in
+          newFrameDelay = 16;
+          break;
+
+        case 49:
+          // 1st logo text smash, 1 second freeze
+          pServiceProvider->playSound(SoundId::BigExplosion);
+          newFrameDelay = 280;
+          break;
+
+        case 50:
+          // Begin 2nd phase logo slide in (letters "II")
+          newFrameDelay = 16;
+          break;
+
+        case 55:
+          // Show logo for 4 seconds
+          pServiceProvider->playSound(SoundId::BigExplosion);
+          newFrameDelay = 1120;
+          break;
       }
+
+      return newFrameDelay;
     }
-  };
+  });
+
+  return configs;
 }
 
 
 IntroMovie::IntroMovie(GameMode::Context context)
   : mpServiceProvider(context.mpServiceProvider)
   , mMoviePlayer(context.mpRenderer)
+  , mMovieConfigurations(
+      createConfigurations(context.mpResources, mpServiceProvider))
   , mCurrentConfiguration(0u)
 {
-  mMovieConfigurations = createConfigurations(*context.mpResources);
 }
 
 
@@ -224,9 +238,11 @@ bool IntroMovie::isFinished() const {
 
 
 void IntroMovie::startNextMovie() {
+  // Waits for the movie to finish decoding, if necessary. The future keeps
+  // the decoded movie around for subsequent runs through the intro.
   const auto& config = mMovieConfigurations[mCurrentConfiguration];
   mMoviePlayer.playMovie(
-    config.mMovie,
+    config.mMovie.get(),
     config.mFrameDelay,
     config.mRepetitions,
     config.mFrameCallback);
@@ -21,11 +21,20 @@
 #include "ui/movie_player.hpp"
 
 #include <cstddef>
+#include <future>
 #include <vector>
 
 
 namespace rigel::ui {
 
+/** Plays the intro movie sequence
+ *
+ * The movies are decoded on worker threads, one per movie, starting at
+ * construction. This way, a mode can construct the stage up front without
+ * delaying whatever it shows first. Each movie is only waited for when it's
+ * about to be played, so the later ones can keep decoding while the first
+ * one is already showing.
+ */
 class IntroMovie {
 public:
   explicit IntroMovie(GameMode::Context context);
@@ -40,7 +49,7 @@ private:
   void startNextMovie();
 
   struct PlaybackConfig {
-    data::Movie mMovie;
+    std::shared_future<data::Movie> mMovie;
 
     const int mFrameDelay;
     const int mRepetitions;
@@ -49,8 +58,9 @@ private:
 
   using PlaybackConfigList = std::vector<PlaybackConfig>;
 
-  PlaybackConfigList createConfigurations(
-    const loader::ResourceLoader& resources);
+  static PlaybackConfigList createConfigurations(
+    const loader::ResourceLoader* pResources,
+    IGameServiceProvider* pServiceProvider);
 
 private:
   IGameServiceProvider* mpServiceProvider;
@@ -0,0 +1,123 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logic_profiler_window.hpp"
+
+#include "base/warnings.hpp"
+#include "engine/logic_profiler.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <imgui.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <fstream>
+
+
+namespace rigel::ui {
+
+namespace {
+
+const auto TRACE_FILE_NAME = "logic_profile_trace.json";
+
+}
+
+
+void showLogicProfilerWindow(const engine::LogicProfiler& profiler) {
+  ImGui::SetNextWindowPos({0, 320}, ImGuiCond_FirstUseEver);
+  ImGui::Begin(
+    "Logic profiler",
+    nullptr,
+    ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+  if (!engine::LogicProfiler::isEnabledInBuild()) {
+    ImGui::TextUnformatted(
+      "Not available, build with LOGIC_PROFILER enabled");
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Text(
+    "Last %zu ticks, %zu entities",
+    profiler.numRecordedTicks(),
+    profiler.lastEntityCount());
+  ImGui::Separator();
+
+  ImGui::Text(
+    "%-20s %7s %7s %7s %7s", "Section (ms)", "min", "p50", "p99", "max");
+
+  auto totalMedianMs = 0.0;
+  for (const auto& section : profiler.statistics()) {
+    ImGui::Text(
+      "%-20s %7.3f %7.3f %7.3f %7.3f",
+      section.mpName,
+      section.mMinMs,
+      section.mMedianMs,
+      section.mP99Ms,
+      section.mMaxMs);
+    totalMedianMs += section.mMedianMs;
+  }
+
+  ImGui::Text("%-20s %15.3f", "Sum of medians", totalMedianMs);
+
+  const auto collisionStatistics = profiler.collisionStatistics();
+  if (
+    !collisionStatistics.empty() &&
+    ImGui::CollapsingHeader("Collision queries (mean per tick)")
+  ) {
+    const auto numTicks = static_cast<double>(profiler.numRecordedTicks());
+    auto perTick = [numTicks](const std::uint64_t count) {
+      return static_cast<double>(count) / numTicks;
+    };
+
+    ImGui::Text(
+      "%-20s %7s %7s %7s %7s %7s %8s %8s",
+      "Section",
+      "ground",
+      "ceiling",
+      "left",
+      "right",
+      "sweeps",
+      "tiles",
+      "bodies");
+
+    for (const auto& section : collisionStatistics) {
+      const auto& total = section.mTotal;
+      ImGui::Text(
+        "%-20s %7.1f %7.1f %7.1f %7.1f %7.1f %8.1f %8.1f",
+        section.mpName,
+        perTick(total.mNumGroundTests),
+        perTick(total.mNumCeilingTests),
+        perTick(total.mNumLeftWallTests),
+        perTick(total.mNumRightWallTests),
+        perTick(total.mNumSweeps),
+        perTick(total.mNumTilesExamined),
+        perTick(total.mNumSolidBodiesVisited));
+    }
+  }
+
+  ImGui::Separator();
+  if (ImGui::Button("Write Chrome trace")) {
+    std::ofstream file(TRACE_FILE_NAME);
+    profiler.writeChromeTrace(file);
+  }
+  ImGui::SameLine();
+  ImGui::TextUnformatted(TRACE_FILE_NAME);
+
+  ImGui::End();
+}
+
+}
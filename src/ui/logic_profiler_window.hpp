@@ -0,0 +1,32 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+
+namespace rigel::engine {
+  class LogicProfiler;
+}
+
+namespace rigel::ui {
+
+/** Show an ImGui window with per-section game logic timings
+ *
+ * Offers a button to write the recorded history to a Chrome trace file.
+ */
+void showLogicProfilerWindow(const engine::LogicProfiler& profiler);
+
+}
@@ -0,0 +1,84 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memory_statistics_window.hpp"
+
+#include "base/memory_accounting.hpp"
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <imgui.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+
+
+namespace rigel::ui {
+
+namespace {
+
+double toMegaBytes(const std::int64_t numBytes) {
+  return double(numBytes) / (1024.0 * 1024.0);
+}
+
+}
+
+
+void showMemoryStatisticsWindow() {
+  namespace memory = base::memory_accounting;
+
+  ImGui::SetNextWindowPos({0, 560}, ImGuiCond_FirstUseEver);
+  ImGui::Begin(
+    "Memory usage",
+    nullptr,
+    ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+  ImGui::Columns(3);
+  ImGui::TextUnformatted("Category");
+  ImGui::NextColumn();
+  ImGui::TextUnformatted("Current (MiB)");
+  ImGui::NextColumn();
+  ImGui::TextUnformatted("Peak (MiB)");
+  ImGui::NextColumn();
+  ImGui::Separator();
+
+  for (auto i = 0; i < memory::NUM_CATEGORIES; ++i) {
+    const auto category = static_cast<memory::Category>(i);
+    const auto usage = memory::usage(category);
+
+    ImGui::Text(
+      "%s %s",
+      memory::isGpuMemory(category) ? "GPU" : "CPU",
+      memory::categoryName(category));
+    ImGui::NextColumn();
+    ImGui::Text("%8.2f", toMegaBytes(usage.mCurrentBytes));
+    ImGui::NextColumn();
+    ImGui::Text("%8.2f", toMegaBytes(usage.mPeakBytes));
+    ImGui::NextColumn();
+  }
+
+  ImGui::Columns(1);
+  ImGui::Separator();
+  ImGui::Text("Total: %8.2f MiB", toMegaBytes(memory::totalBytes()));
+  if (memory::isOverBudget()) {
+    ImGui::TextColored({1.0f, 0.3f, 0.3f, 1.0f}, "Over budget");
+  }
+
+  ImGui::End();
+}
+
+}
@@ -23,12 +23,10 @@
 #include "engine/timing.hpp"
 #include "loader/resource_loader.hpp"
 
-RIGEL_DISABLE_WARNINGS
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/split.hpp>
-RIGEL_RESTORE_WARNINGS
-
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <stdexcept>
 
 
@@ -147,6 +145,86 @@ constexpr auto CURSOR_ANIM_DELAY = 5;
 constexpr auto NUM_CURSOR_ANIM_STATES = 4;
 
 
+constexpr auto NON_RENDERABLE_CHAR = -1;
+
+
+/** Build a table mapping each byte value to a glyph index
+ *
+ * Doing the mapping once up front means that drawing text only needs a
+ * single lookup per character.
+ */
+template <typename MappingFunc>
+constexpr std::array<int, 256> makeGlyphTable(MappingFunc mapping) {
+  std::array<int, 256> table{};
+  for (auto ch = 0; ch < 256; ++ch) {
+    table[ch] = mapping(ch);
+  }
+
+  return table;
+}
+
+
+constexpr auto MENU_FONT_GLYPHS = makeGlyphTable([](const int ch) {
+  if (ch < 62) {
+    return 21*40 + (ch - 22);
+  } else if (ch <= 90) {
+    return 22*40 + (ch - 62);
+  } else if (ch >= 97 && ch < 108) {
+    return 22*40 + (ch - 68);
+  } else if (ch >= 108 && ch <= 122) {
+    return 23*40 + 17 + (ch - 108);
+  }
+
+  return NON_RENDERABLE_CHAR;
+});
+
+
+constexpr auto SMALL_WHITE_FONT_GLYPHS = makeGlyphTable([](const int ch) {
+  if (ch == 44) {
+    return 24*40 + 17 + 6;
+  } else if (ch == 46) {
+    return 24*40 + 17 + 7;
+  } else if (ch == 33) {
+    return 24*40 + 17 + 8;
+  } else if (ch == 63) {
+    return 24*40 + 17 + 9;
+  } else if (ch >= 65 && ch <= 84) {
+    return 6*40 + 20 + (ch - 65);
+  } else if (ch >= 85 && ch <= 90) {
+    return 24*40 + 17 + (ch - 85);
+  }
+
+  return NON_RENDERABLE_CHAR;
+});
+
+
+constexpr auto BIG_FONT_GLYPHS = makeGlyphTable([](const int ch) {
+  if (ch >= 65 && ch <= 90) {
+    return ch - 65;
+  } else if (ch >= 48 && ch <= 57) {
+    return ch - 48 + 26;
+  } else if (ch >= 97 && ch <= 122) {
+    return ch - 97 + 41;
+  } else if (ch == 63) {
+    return 36;
+  } else if (ch == 44) {
+    return 37;
+  } else if (ch == 46) {
+    return 38;
+  } else if (ch == 33) {
+    return 39;
+  }
+
+  // Big block
+  return 40;
+});
+
+
+int glyphIndex(const std::array<int, 256>& table, const char ch) {
+  return table[static_cast<std::uint8_t>(ch)];
+}
+
+
 renderer::OwningTexture createFontTexture(
   const loader::FontData& font,
   renderer::Renderer* pRenderer
@@ -187,110 +265,76 @@ MenuElementRenderer::MenuElementRenderer(
 
 
 void MenuElementRenderer::drawText(
-  int x,
-  int y,
-  const std::string& text
+  const int x,
+  const int y,
+  const std::string_view text
 ) const {
-  for (auto i=0u; i<text.size(); ++i) {
-    const auto ch = static_cast<uint8_t>(text[i]);
+  drawGlyphs(x, y, text, MENU_FONT_GLYPHS);
+}
 
-    int spriteSheetIndex = 0;
-    if (ch < 62) {
-      spriteSheetIndex = 21*40 + (ch - 22);
-    } else if (ch <= 90) {
-      spriteSheetIndex = 22*40 + (ch - 62);
-    } else if (ch >= 97 && ch < 108) {
-      spriteSheetIndex = 22*40 + (ch - 68);
-    } else if (ch >= 108 && ch <= 122) {
-      spriteSheetIndex = 23*40 + 17 + (ch - 108);
-    } else {
-      // Skip non-renderable chars
-      continue;
-    }
 
-    mpSpriteSheet->renderTile(spriteSheetIndex, x + i, y);
-  }
+void MenuElementRenderer::drawSmallWhiteText(
+  const int x,
+  const int y,
+  const std::string_view text
+) const {
+  drawGlyphs(x, y, text, SMALL_WHITE_FONT_GLYPHS);
 }
 
 
-void MenuElementRenderer::drawSmallWhiteText(
-  int x,
-  int y,
-  const std::string& text
+void MenuElementRenderer::drawGlyphs(
+  const int x,
+  const int y,
+  const std::string_view text,
+  const std::array<int, 256>& glyphTable
 ) const {
-  for (auto i=0u; i<text.size(); ++i) {
-    const auto ch = static_cast<uint8_t>(text[i]);
+  mTileDrawBuffer.clear();
 
-    int spriteSheetIndex = 0;
-    if (ch == 44) {
-      spriteSheetIndex = 24*40 + 17 + 6;
-    } else if (ch == 46) {
-      spriteSheetIndex = 24*40 + 17 + 7;
-    } else if (ch == 33) {
-      spriteSheetIndex = 24*40 + 17 + 8;
-    } else if (ch == 63) {
-      spriteSheetIndex = 24*40 + 17 + 9;
-    } else if (ch >= 65 && ch <= 84) {
-      spriteSheetIndex = 6*40 + 20 + (ch - 65);
-    } else if (ch >= 85 && ch <= 90) {
-      spriteSheetIndex = 24*40 + 17 + (ch - 85);
-    } else {
-      // Skip non-renderable chars
-      continue;
+  for (auto i=0u; i<text.size(); ++i) {
+    const auto spriteSheetIndex = glyphIndex(glyphTable, text[i]);
+    if (spriteSheetIndex != NON_RENDERABLE_CHAR) {
+      mTileDrawBuffer.push_back({spriteSheetIndex, {x + int(i), y}});
     }
-
-    mpSpriteSheet->renderTile(spriteSheetIndex, x + i, y);
   }
+
+  mpSpriteSheet->renderTiles(
+    {mTileDrawBuffer.data(),
+     base::ArrayView<engine::TiledTexture::TileDraw>::size_type(
+       mTileDrawBuffer.size())});
 }
 
 
 void MenuElementRenderer::drawMultiLineText(
   const int x,
   const int y,
-  const std::string& text
+  const std::string_view text
 ) const {
-  namespace ba = boost::algorithm;
+  auto remainingText = text;
+  for (auto lineY = y; ; ++lineY) {
+    const auto lineEnd = remainingText.find('\n');
+    drawText(x, lineY, remainingText.substr(0, lineEnd));
 
-  std::vector<std::string> lines;
-  ba::split(lines, text, ba::is_any_of("\n"));
-  for (int i = 0; i < int(lines.size()); ++i) {
-    drawText(x, y + i, lines[i]);
+    if (lineEnd == std::string_view::npos) {
+      break;
+    }
+
+    remainingText.remove_prefix(lineEnd + 1);
   }
 }
 
 
 void MenuElementRenderer::drawBigText(
-  int x,
-  int y,
-  const std::string& text,
+  const int x,
+  const int y,
+  const std::string_view text,
   const base::Color& color
 ) const {
   mpRenderer->setColorModulation(color);
 
   for (auto i=0u; i<text.size(); ++i) {
-    const auto ch = static_cast<uint8_t>(text[i]);
-
-    int index = 0;
-    if (ch >= 65 && ch <= 90) {
-      index = ch - 65;
-    } else if (ch >= 48 && ch <= 57) {
-      index = ch - 48 + 26;
-    } else if (ch >= 97 && ch <= 122) {
-      index = ch - 97 + 41;
-    } else if (ch == 63) {
-      index = 36;
-    } else if (ch == 44) {
-      index = 37;
-    } else if (ch == 46) {
-      index = 38;
-    } else if (ch == 33) {
-      index = 39;
-    } else {
-      index = 40;
-    }
-
     const auto position = static_cast<int>(i);
-    mBigTextTexture.renderTileSlice(index, {x + position, y-1});
+    mBigTextTexture.renderTileSlice(
+      glyphIndex(BIG_FONT_GLYPHS, text[i]), {x + position, y-1});
   }
 
   mpRenderer->setColorModulation(base::Color{255, 255, 255, 255});
@@ -303,16 +347,25 @@ void MenuElementRenderer::drawMessageBox(
   int width,
   int height
 ) const {
+  // All rows go into a single batch, which makes the whole box a single
+  // draw call
+  mTileDrawBuffer.clear();
+
   // Top border
-  drawMessageBoxRow(x, y, width, 0, 1, 2);
+  addMessageBoxRow(x, y, width, 0, 1, 2);
 
   // Body with left and right borders
   for (int row = 1; row < height - 1; ++row) {
-    drawMessageBoxRow(x, y + row, width, 7, 8, 3);
+    addMessageBoxRow(x, y + row, width, 7, 8, 3);
   }
 
   // Bottom border
-  drawMessageBoxRow(x, y + height - 1, width, 6, 5, 4);
+  addMessageBoxRow(x, y + height - 1, width, 6, 5, 4);
+
+  mpSpriteSheet->renderTiles(
+    {mTileDrawBuffer.data(),
+     base::ArrayView<engine::TiledTexture::TileDraw>::size_type(
+       mTileDrawBuffer.size())});
 }
 
 
@@ -390,6 +443,19 @@ void MenuElementRenderer::drawSelectionIndicator(
 }
 
 
+engine::TimeDelta MenuElementRenderer::timeUntilNextSelectionIndicatorFrame(
+  const engine::TimeDelta elapsedTime
+) {
+  // drawSelectionIndicator() rounds to the nearest animation step, so the
+  // frame changes half-way between two steps
+  const auto animTicks =
+    engine::timeToSlowTicks(elapsedTime) / MENU_INDICATOR_ANIM_DELAY;
+  const auto nextFrameChange = std::floor(animTicks + 0.5) + 0.5;
+  return (nextFrameChange - animTicks) *
+    engine::slowTicksToTime(MENU_INDICATOR_ANIM_DELAY);
+}
+
+
 void MenuElementRenderer::drawSelectionIndicator(
   const int x,
   const int y,
@@ -416,7 +482,7 @@ void MenuElementRenderer::drawTextEntryCursor(
 }
 
 
-void MenuElementRenderer::drawMessageBoxRow(
+void MenuElementRenderer::addMessageBoxRow(
   const int x,
   const int y,
   const int width,
@@ -426,14 +492,14 @@ void MenuElementRenderer::drawMessageBoxRow(
 ) const {
   const auto baseIndex = 4*40;
 
-  mpSpriteSheet->renderTile(baseIndex + leftIndex, x, y);
+  mTileDrawBuffer.push_back({baseIndex + leftIndex, {x, y}});
 
   const auto untilX = x + width - 1;
   for (int col = x + 1; col < untilX; ++col) {
-    mpSpriteSheet->renderTile(baseIndex + middleIndex, col, y);
+    mTileDrawBuffer.push_back({baseIndex + middleIndex, {col, y}});
   }
 
-  mpSpriteSheet->renderTile(baseIndex + rightIndex, x + width - 1, y);
+  mTileDrawBuffer.push_back({baseIndex + rightIndex, {x + width - 1, y}});
 }
 
 }
@@ -27,8 +27,11 @@ RIGEL_DISABLE_WARNINGS
 #include <SDL.h>
 RIGEL_RESTORE_WARNINGS
 
+#include <array>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
 namespace rigel::loader {
@@ -48,13 +51,13 @@ public:
 
   // Stateless API
   // --------------------------------------------------------------------------
-  void drawText(int x, int y, const std::string& text) const;
-  void drawSmallWhiteText(int x, int y, const std::string& text) const;
-  void drawMultiLineText(int x, int y, const std::string& text) const;
+  void drawText(int x, int y, std::string_view text) const;
+  void drawSmallWhiteText(int x, int y, std::string_view text) const;
+  void drawMultiLineText(int x, int y, std::string_view text) const;
   void drawBigText(
     int x,
     int y,
-    const std::string& text,
+    std::string_view text,
     const base::Color& color) const;
   void drawMessageBox(int x, int y, int width, int height) const;
 
@@ -76,6 +79,13 @@ public:
    */
   void drawSelectionIndicator(int x, int y, engine::TimeDelta elapsedTime) const;
 
+  /** Time until the selection indicator changes to its next animation frame.
+   *
+   * elapsedTime has the same meaning as for drawSelectionIndicator().
+   */
+  static engine::TimeDelta timeUntilNextSelectionIndicatorFrame(
+    engine::TimeDelta elapsedTime);
+
   /** Draws a black rectangle at given position.
    *
    * Meant to erase a previously drawn menu selection indicator.
@@ -85,7 +95,7 @@ public:
 private:
   void drawTextEntryCursor(int x, int y, int state) const;
   void drawSelectionIndicator(int x, int y, int state) const;
-  void drawMessageBoxRow(
+  void addMessageBoxRow(
     int x,
     int y,
     int width,
@@ -94,9 +104,17 @@ private:
     int rightIndex) const;
 
 private:
+  void drawGlyphs(
+    int x,
+    int y,
+    std::string_view text,
+    const std::array<int, 256>& glyphTable) const;
+
   renderer::Renderer* mpRenderer;
   engine::TiledTexture* mpSpriteSheet;
   engine::TiledTexture mBigTextTexture;
+
+  mutable std::vector<engine::TiledTexture::TileDraw> mTileDrawBuffer;
 };
 
 }
@@ -16,11 +16,11 @@
 
 #include "movie_player.hpp"
 
-#include "base/container_utils.hpp"
 #include "engine/timing.hpp"
-#include "utility"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 
 
 namespace rigel::ui {
@@ -28,6 +28,22 @@ namespace rigel::ui {
 using engine::fastTicksToTime;
 
 
+namespace {
+
+data::Image createFrameImage(const data::Movie& movie) {
+  auto width = std::size_t{0};
+  auto height = std::size_t{0};
+  for (const auto& frame : movie.mFrames) {
+    width = std::max(width, frame.mReplacementImage.width());
+    height = std::max(height, frame.mReplacementImage.height());
+  }
+
+  return data::Image{width, height};
+}
+
+}
+
+
 MoviePlayer::MoviePlayer(renderer::Renderer* pRenderer)
   : mpRenderer(pRenderer)
 {
@@ -42,16 +58,12 @@ void MoviePlayer::playMovie(
 ) {
   assert(frameDelayInFastTicks >= 1);
 
+  assert(!movie.mFrames.empty());
+
+  mpMovie = &movie;
   mBaseImage = renderer::OwningTexture(mpRenderer, movie.mBaseImage);
-  mAnimationFrames = utils::transformed(movie.mFrames,
-    [this](const auto& frame) {
-      auto texture =
-        renderer::OwningTexture(mpRenderer, frame.mReplacementImage);
-      return FrameData{
-      std::move(texture),
-        frame.mStartRow
-      };
-    });
+  mFrameImage = renderer::OwningTexture(mpRenderer, createFrameImage(movie));
+  mFrameInTexture = std::nullopt;
 
   mFrameCallback = std::move(frameCallback);
   mCurrentFrame = 0;
@@ -86,7 +98,7 @@ void MoviePlayer::updateAndRender(const engine::TimeDelta timeDelta) {
       // We render one frame less during the last repetition, since the first
       // (full) image is to be counted as if it was the first frame.
       const auto framesToRenderThisRepetition =
-        static_cast<int>(mAnimationFrames.size()) -
+        static_cast<int>(mpMovie->mFrames.size()) -
           (repetitionsRemaining == 1 ? 1 : 0);
 
       if (mCurrentFrame >= framesToRenderThisRepetition) {
@@ -95,18 +107,34 @@ void MoviePlayer::updateAndRender(const engine::TimeDelta timeDelta) {
       }
     } else {
       // Repeat forever
-      mCurrentFrame %= mAnimationFrames.size();
+      mCurrentFrame %= mpMovie->mFrames.size();
     }
 
     const int frameNrIncludingFirstImage =
-      (mCurrentFrame + 1) % mAnimationFrames.size();
+      (mCurrentFrame + 1) % mpMovie->mFrames.size();
     invokeFrameCallbackIfPresent(frameNrIncludingFirstImage);
   }
 
-  {
-    const auto& frameData = mAnimationFrames[mCurrentFrame];
-    frameData.mImage.render(mpRenderer, 0, frameData.mStartRow);
+  renderCurrentFrame();
+}
+
+
+void MoviePlayer::renderCurrentFrame() {
+  const auto& frame = mpMovie->mFrames[mCurrentFrame];
+  const auto& image = frame.mReplacementImage;
+
+  if (mFrameInTexture != mCurrentFrame) {
+    // Make sure that draw calls still referring to the previous frame's
+    // contents are done before we overwrite it
+    mpRenderer->submitBatch();
+    mpRenderer->updateTextureRegion(mFrameImage.data(), {0, 0}, image);
+    mFrameInTexture = mCurrentFrame;
   }
+
+  mFrameImage.render(
+    mpRenderer,
+    {0, frame.mStartRow},
+    {{0, 0}, {int(image.width()), int(image.height())}});
 }
 
 
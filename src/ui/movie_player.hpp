@@ -22,7 +22,6 @@
 
 #include <functional>
 #include <optional>
-#include <vector>
 
 
 namespace rigel::ui {
@@ -37,6 +36,12 @@ public:
 
   explicit MoviePlayer(renderer::Renderer* pRenderer);
 
+  /** Start playing the given movie
+   *
+   * Animation frames are uploaded to the GPU one at a time while playing,
+   * so the movie needs to stay alive until playback has finished or
+   * another movie is started.
+   */
   void playMovie(
     const data::Movie& movie,
     int frameDelayInFastTicks,
@@ -49,17 +54,18 @@ public:
   bool hasCompletedPlayback() const;
 
 private:
-  struct FrameData {
-    renderer::OwningTexture mImage;
-    int mStartRow;
-  };
-
   void invokeFrameCallbackIfPresent(int whichFrame);
+  void renderCurrentFrame();
 
 private:
   renderer::Renderer* mpRenderer;
+  const data::Movie* mpMovie = nullptr;
   renderer::OwningTexture mBaseImage;
-  std::vector<FrameData> mAnimationFrames;
+
+  // Holds the most recently shown animation frame, big enough for the
+  // largest frame of the movie
+  renderer::OwningTexture mFrameImage;
+  std::optional<int> mFrameInTexture;
   FrameCallbackFunc mFrameCallback = nullptr;
 
   bool mHasShownFirstFrame = false;
@@ -0,0 +1,75 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "render_profiler_window.hpp"
+
+#include "base/warnings.hpp"
+#include "renderer/renderer.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <imgui.h>
+RIGEL_RESTORE_WARNINGS
+
+
+namespace rigel::ui {
+
+void showRenderProfilerWindow(const renderer::Renderer& renderer) {
+  ImGui::SetNextWindowPos({0, 48}, ImGuiCond_FirstUseEver);
+  ImGui::Begin(
+    "Render profiler",
+    nullptr,
+    ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+  const auto& stats = renderer.lastFrameStatistics();
+  ImGui::Text("Draw calls: %d", stats.mDrawCalls);
+  ImGui::Text("Texture binds: %d", stats.mTextureBinds);
+  ImGui::Text("Quads: %d", stats.mQuads);
+  ImGui::Text("Points: %d", stats.mPoints);
+  ImGui::Text("Culled: %d", stats.mCulledDraws);
+  ImGui::Text("Vertices: %zu", stats.mVerticesDrawn);
+  ImGui::Text("Bytes uploaded: %zu", stats.mBytesUploaded);
+
+  ImGui::Separator();
+
+  ImGui::TextUnformatted("Batches by flush reason");
+  for (auto i = std::size_t{0}; i < stats.mBatchesByFlushReason.size(); ++i) {
+    const auto reason = static_cast<renderer::Renderer::BatchFlushReason>(i);
+    ImGui::Text(
+      "  %-20s %d",
+      renderer::batchFlushReasonName(reason),
+      stats.mBatchesByFlushReason[i]);
+  }
+
+  ImGui::Separator();
+
+  const auto& profiler = renderer.gpuProfiler();
+  if (!profiler.isSupported()) {
+    ImGui::TextUnformatted("GPU timer queries not supported");
+  } else {
+    auto totalTimeMs = 0.0;
+    for (const auto& section : profiler.lastResults()) {
+      ImGui::Text("%-18s %6.3f ms", section.mpName, section.mTimeMs);
+      totalTimeMs += section.mTimeMs;
+    }
+
+    ImGui::Text("%-18s %6.3f ms", "Total (measured)", totalTimeMs);
+  }
+
+  ImGui::End();
+}
+
+}
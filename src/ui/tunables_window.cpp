@@ -0,0 +1,73 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tunables_window.hpp"
+
+#include "base/tunables.hpp"
+#include "base/warnings.hpp"
+
+RIGEL_DISABLE_WARNINGS
+#include <imgui.h>
+RIGEL_RESTORE_WARNINGS
+
+#include <variant>
+
+
+namespace rigel::ui {
+
+namespace {
+
+void showEditor(base::Tunable<bool>& tunable) {
+  auto value = tunable.value();
+  if (ImGui::Checkbox(tunable.name(), &value)) {
+    tunable.set(value);
+  }
+}
+
+
+void showEditor(base::Tunable<int>& tunable) {
+  auto value = tunable.value();
+  if (ImGui::InputInt(tunable.name(), &value)) {
+    tunable.set(value);
+  }
+}
+
+}
+
+
+void showTunablesWindow() {
+  ImGui::SetNextWindowPos({400, 0}, ImGuiCond_FirstUseEver);
+  ImGui::Begin(
+    "Tunables",
+    nullptr,
+    ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+  for (const auto& tunable : base::allTunables()) {
+    std::visit(
+      [](auto* pTunable) {
+        showEditor(*pTunable);
+        if (ImGui::IsItemHovered()) {
+          ImGui::SetTooltip("%s", pTunable->description());
+        }
+      },
+      tunable);
+  }
+
+  ImGui::End();
+}
+
+}
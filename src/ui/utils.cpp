@@ -17,7 +17,6 @@
 #include "utils.hpp"
 
 #include "base/warnings.hpp"
-#include "loader/resource_loader.hpp"
 
 RIGEL_DISABLE_WARNINGS
 #include <imgui.h>
@@ -37,17 +36,6 @@ RIGEL_RESTORE_WARNINGS
 }
 
 
-renderer::OwningTexture fullScreenImageAsTexture(
-  renderer::Renderer* pRenderer,
-  const loader::ResourceLoader& resources,
-  const std::string& imageName
-) {
-  return renderer::OwningTexture(
-    pRenderer,
-    resources.loadStandaloneFullscreenImage(imageName));
-}
-
-
 void drawText(
   const std::string_view text,
   const int x,
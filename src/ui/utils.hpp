@@ -17,23 +17,12 @@
 #pragma once
 
 #include "base/color.hpp"
-#include "renderer/texture.hpp"
 
 #include <string_view>
 
 
-namespace rigel::loader {
-  class ResourceLoader;
-}
-
 namespace rigel::ui {
 
-renderer::OwningTexture fullScreenImageAsTexture(
-  renderer::Renderer* pRenderer,
-  const loader::ResourceLoader& resources,
-  const std::string& imageName);
-
-
 void drawText(std::string_view text, int x, int y, const base::Color& color);
 
 }
@@ -0,0 +1,154 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/base_components.hpp>
+#include <engine/entity_tools.hpp>
+#include <game_logic/actor_tag_counter.hpp>
+#include <game_logic/entity_snapshot.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <optional>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using namespace game_logic;
+using game_logic::components::ActorTag;
+
+namespace ex = entityx;
+
+
+namespace {
+
+constexpr auto NUM_TYPES = static_cast<int>(ActorTag::Type::FireBomb) + 1;
+
+
+int countReference(ex::EntityManager& es, const ActorTag::Type type) {
+  auto count = 0;
+  es.each<ActorTag>([&](ex::Entity, const ActorTag& tag) {
+    if (tag.mType == type) {
+      ++count;
+    }
+  });
+
+  return count;
+}
+
+
+void checkCounts(const ActorTagCounter& counter, ex::EntityManager& es) {
+  for (auto i = 0; i < NUM_TYPES; ++i) {
+    const auto type = static_cast<ActorTag::Type>(i);
+    CHECK(counter.count(type) == countReference(es, type));
+  }
+}
+
+
+std::vector<ex::Entity> allEntities(ex::EntityManager& es) {
+  std::vector<ex::Entity> result;
+  for (auto entity : es.entities_for_debugging()) {
+    result.push_back(entity);
+  }
+
+  return result;
+}
+
+}
+
+
+TEST_CASE("Actor tag counts match counting all tagged entities") {
+  std::mt19937 randomGenerator{321};
+  const auto pick = [&](const int count) {
+    return std::uniform_int_distribution<int>{0, count - 1}(randomGenerator);
+  };
+  const auto randomTag = [&]() {
+    return ActorTag{static_cast<ActorTag::Type>(pick(NUM_TYPES)), pick(100)};
+  };
+
+  ex::EntityX entityx;
+  auto& es = entityx.entities;
+  ActorTagCounter counter{entityx.events};
+  std::optional<EntitySnapshot> snapshot;
+
+  checkCounts(counter, es);
+
+  for (auto step = 0; step < 2000; ++step) {
+    auto entities = allEntities(es);
+    auto randomEntity = [&]() {
+      return entities[pick(static_cast<int>(entities.size()))];
+    };
+
+    switch (pick(10)) {
+      case 0:
+      case 1:
+      case 2:
+        {
+          auto entity = es.create();
+          entity.assign<engine::components::WorldPosition>(
+            pick(100), pick(100));
+          if (pick(4) != 0) {
+            entity.assign<ActorTag>(randomTag());
+          }
+        }
+        break;
+
+      case 3:
+        if (!entities.empty()) {
+          auto entity = randomEntity();
+          if (entity.has_component<ActorTag>()) {
+            entity.remove<ActorTag>();
+          } else {
+            entity.assign<ActorTag>(randomTag());
+          }
+        }
+        break;
+
+      case 4:
+      case 5:
+        if (!entities.empty()) {
+          randomEntity().destroy();
+        }
+        break;
+
+      case 6:
+        snapshot = EntitySnapshot::capture(es);
+        REQUIRE(snapshot);
+        break;
+
+      case 7:
+        if (snapshot && pick(5) == 0) {
+          snapshot->restore(es, entityx.events);
+        }
+        break;
+
+      case 8:
+        if (pick(20) == 0) {
+          engine::clearAllEntities(es, entityx.events);
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    checkCounts(counter, es);
+  }
+}
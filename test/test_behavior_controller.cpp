@@ -0,0 +1,125 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <game_logic/behavior_controller.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <array>
+#include <vector>
+
+
+using namespace rigel;
+using namespace game_logic;
+using game_logic::components::BehaviorController;
+
+
+namespace {
+
+struct SmallBehavior {
+  void update(GlobalDependencies&, GlobalState&, bool, entityx::Entity) {
+  }
+
+  int mValue = 0;
+};
+
+
+struct LargeBehavior {
+  void update(GlobalDependencies&, GlobalState&, bool, entityx::Entity) {
+  }
+
+  std::array<int, 64> mPadding{};
+  int mValue = 0;
+};
+
+
+template <typename T>
+void testCopyAndMove() {
+  auto behavior = T{};
+  behavior.mValue = 42;
+  BehaviorController controller{behavior};
+
+  SECTION("Copies are independent") {
+    auto copy = controller;
+    copy.get<T>().mValue = 7;
+
+    CHECK(controller.get<T>().mValue == 42);
+    CHECK(copy.get<T>().mValue == 7);
+  }
+
+  SECTION("Moving leaves the source empty") {
+    auto target = std::move(controller);
+
+    CHECK(target.get<T>().mValue == 42);
+    CHECK(controller.isEmpty());
+
+    SECTION("Moved-from controller can be copied") {
+      auto copy = controller;
+      CHECK(copy.isEmpty());
+
+      BehaviorController assigned{SmallBehavior{}};
+      assigned = controller;
+      CHECK(assigned.isEmpty());
+    }
+
+    SECTION("Moved-from controller can be moved") {
+      auto movedAgain = std::move(controller);
+      CHECK(movedAgain.isEmpty());
+
+      BehaviorController assigned{LargeBehavior{}};
+      assigned = std::move(movedAgain);
+      CHECK(assigned.isEmpty());
+    }
+
+    SECTION("Moved-from controller can be assigned to") {
+      controller = target;
+      CHECK(controller.get<T>().mValue == 42);
+      CHECK(target.get<T>().mValue == 42);
+    }
+  }
+
+  SECTION("Moved-from controllers survive container reallocation") {
+    std::vector<BehaviorController> controllers;
+    controllers.push_back(controller);
+    controllers.push_back(std::move(controller));
+    auto taken = std::move(controllers.front());
+
+    for (int i = 0; i < 16; ++i) {
+      controllers.push_back(controllers.front());
+    }
+
+    CHECK(taken.get<T>().mValue == 42);
+    CHECK(controllers.front().isEmpty());
+    CHECK(controllers[1].get<T>().mValue == 42);
+    CHECK(controllers.back().isEmpty());
+  }
+}
+
+}
+
+
+TEST_CASE("Inline behavior controllers can be copied and moved") {
+  testCopyAndMove<SmallBehavior>();
+}
+
+
+TEST_CASE("Heap-allocated behavior controllers can be copied and moved") {
+  testCopyAndMove<LargeBehavior>();
+}
@@ -0,0 +1,434 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/spatial_types_printing.hpp>
+#include <base/warnings.hpp>
+#include <data/map.hpp>
+#include <engine/collision_checker.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/movement.hpp>
+#include <engine/physical_components.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+using data::map::Map;
+using data::map::SolidEdge;
+using data::map::TileAttributeDict;
+using data::map::TileIndex;
+
+
+namespace ex = entityx;
+
+
+namespace {
+
+constexpr auto MAP_WIDTH = 100;
+constexpr auto MAP_HEIGHT = 60;
+constexpr auto NUM_TILE_TYPES = 8;
+
+
+Map makeRandomMap(std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> collisionBits{0, 0xF};
+
+  // Tile 0 is always empty
+  std::vector<std::uint16_t> bitPacks{0};
+  for (auto i = 1; i < NUM_TILE_TYPES; ++i) {
+    bitPacks.push_back(static_cast<std::uint16_t>(
+      collisionBits(randomGenerator)));
+  }
+
+  Map map{MAP_WIDTH, MAP_HEIGHT, TileAttributeDict{bitPacks}};
+
+  // Mostly empty, so that solid bodies make a difference for most tests
+  std::uniform_int_distribution<int> tile{
+    -8 * NUM_TILE_TYPES, NUM_TILE_TYPES - 1};
+  for (auto y = 0; y < MAP_HEIGHT; ++y) {
+    for (auto x = 0; x < MAP_WIDTH; ++x) {
+      map.setTileAt(
+        0, x, y, static_cast<TileIndex>(std::max(tile(randomGenerator), 0)));
+    }
+  }
+
+  return map;
+}
+
+
+BoundingBox randomBbox(std::mt19937& randomGenerator) {
+  // Reaches past the map's edges on all sides
+  std::uniform_int_distribution<int> x{-20, MAP_WIDTH + 20};
+  std::uniform_int_distribution<int> y{-20, MAP_HEIGHT + 20};
+  std::uniform_int_distribution<int> size{1, 24};
+  return BoundingBox{
+    {x(randomGenerator), y(randomGenerator)},
+    {size(randomGenerator), size(randomGenerator)}};
+}
+
+
+WorldPosition randomPosition(std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> x{-20, MAP_WIDTH + 20};
+  std::uniform_int_distribution<int> y{-20, MAP_HEIGHT + 20};
+  return WorldPosition{x(randomGenerator), y(randomGenerator)};
+}
+
+
+// Works like CollisionChecker did before it had a grid: Test every solid
+// body, then every tile in the span
+bool isSpanSolidReference(
+  const Map& map,
+  ex::EntityManager& entities,
+  const BoundingBox& span,
+  const SolidEdge edge
+) {
+  auto hitsSolidBody = false;
+  entities.each<SolidBody, BoundingBox, WorldPosition>(
+    [&](
+      ex::Entity,
+      const SolidBody&,
+      const BoundingBox& bbox,
+      const WorldPosition& position
+    ) {
+      hitsSolidBody =
+        hitsSolidBody || toWorldSpace(bbox, position).intersects(span);
+    });
+
+  if (hitsSolidBody) {
+    return true;
+  }
+
+  for (auto y = span.top(); y <= span.bottom(); ++y) {
+    for (auto x = span.left(); x <= span.right(); ++x) {
+      if (map.collisionData(x, y).isSolidOn(edge)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
+BoundingBox rowAt(const BoundingBox& bbox, const int y) {
+  return BoundingBox{{bbox.left(), y}, {bbox.size.width, 1}};
+}
+
+
+BoundingBox columnAt(const BoundingBox& bbox, const int x) {
+  return BoundingBox{{x, bbox.top()}, {1, bbox.size.height}};
+}
+
+
+void checkCollisionTests(
+  const CollisionChecker& checker,
+  const Map& map,
+  ex::EntityManager& entities,
+  std::mt19937& randomGenerator
+) {
+  for (auto i = 0; i < 200; ++i) {
+    const auto bbox = randomBbox(randomGenerator);
+
+    CHECK(checker.isOnSolidGround(bbox) == isSpanSolidReference(
+      map, entities, rowAt(bbox, bbox.bottom() + 1), SolidEdge::top()));
+    CHECK(checker.isTouchingCeiling(bbox) == isSpanSolidReference(
+      map, entities, rowAt(bbox, bbox.top() - 1), SolidEdge::bottom()));
+    CHECK(checker.isTouchingLeftWall(bbox) == isSpanSolidReference(
+      map, entities, columnAt(bbox, bbox.left() - 1), SolidEdge::right()));
+    CHECK(checker.isTouchingRightWall(bbox) == isSpanSolidReference(
+      map, entities, columnAt(bbox, bbox.right() + 1), SolidEdge::left()));
+  }
+}
+
+
+ex::Entity createSolidBody(
+  ex::EntityManager& entities,
+  std::mt19937& randomGenerator
+) {
+  std::uniform_int_distribution<int> percentage{0, 99};
+
+  auto entity = entities.create();
+  entity.assign<BoundingBox>(BoundingBox{
+    {0, 0}, randomBbox(randomGenerator).size});
+
+  // Some bodies only get a position once they are already in the grid
+  if (percentage(randomGenerator) < 80) {
+    entity.assign<WorldPosition>(randomPosition(randomGenerator));
+  }
+
+  if (percentage(randomGenerator) < 30) {
+    entity.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, false});
+  }
+
+  entity.assign<SolidBody>();
+  return entity;
+}
+
+
+// Bodies with a MovingBody are moved without telling the collision checker,
+// the others are followed by a SolidBodyChanged event
+void modifyRandomBody(
+  std::vector<ex::Entity>& bodies,
+  ex::EntityManager& entities,
+  ex::EventManager& eventManager,
+  std::mt19937& randomGenerator
+) {
+  std::uniform_int_distribution<int> action{0, 6};
+  std::uniform_int_distribution<std::size_t> pick{0, bodies.size() - 1};
+
+  const auto index = pick(randomGenerator);
+  auto entity = bodies[index];
+  auto bodyChanged = true;
+
+  switch (action(randomGenerator)) {
+    case 0:
+      if (entity.has_component<WorldPosition>()) {
+        *entity.component<WorldPosition>() = randomPosition(randomGenerator);
+      } else {
+        entity.assign<WorldPosition>(randomPosition(randomGenerator));
+      }
+      break;
+
+    case 1:
+      entity.component<BoundingBox>()->size =
+        randomBbox(randomGenerator).size;
+      break;
+
+    case 2:
+      if (entity.has_component<WorldPosition>()) {
+        entity.remove<WorldPosition>();
+      }
+      break;
+
+    case 3:
+      bodyChanged = false;
+      if (entity.has_component<SolidBody>()) {
+        entity.remove<SolidBody>();
+      } else {
+        entity.assign<SolidBody>();
+      }
+      break;
+
+    case 4:
+      bodyChanged = false;
+      entity.destroy();
+      bodies.erase(bodies.begin() + index);
+      break;
+
+    case 5:
+      bodyChanged = false;
+      bodies.push_back(createSolidBody(entities, randomGenerator));
+      break;
+
+    case 6:
+      // From now on, the body gets moved without telling the checker
+      bodyChanged = false;
+      if (!entity.has_component<MovingBody>()) {
+        entity.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, false});
+      }
+      break;
+  }
+
+  if (bodyChanged && !entity.has_component<MovingBody>()) {
+    eventManager.emit(events::SolidBodyChanged{entity});
+  }
+}
+
+
+using BlockingTest =
+  bool (CollisionChecker::*)(const BoundingBox&) const;
+
+
+// Works like engine::move() did before there were sweeps: Test for a
+// collision before each unit of movement
+int freeDistanceReference(
+  const CollisionChecker& checker,
+  BoundingBox bbox,
+  const int maxDistance,
+  const base::Vector& step,
+  const BlockingTest isBlocked
+) {
+  auto distance = 0;
+  while (distance < maxDistance && !(checker.*isBlocked)(bbox)) {
+    bbox.topLeft += step;
+    ++distance;
+  }
+
+  return distance;
+}
+
+
+MovementResult expectedMovementResult(
+  const int distanceMoved,
+  const int amount
+) {
+  if (distanceMoved == 0 && amount != 0) {
+    return MovementResult::Failed;
+  }
+
+  return distanceMoved == std::abs(amount)
+    ? MovementResult::Completed
+    : MovementResult::MovedPartially;
+}
+
+}
+
+
+TEST_CASE("Solid body grid gives the same results as testing all bodies") {
+  std::mt19937 randomGenerator{1234};
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+  const auto map = makeRandomMap(randomGenerator);
+
+  // Some bodies exist before the collision checker is created, the rest are
+  // added later
+  std::vector<ex::Entity> bodies;
+  for (auto i = 0; i < 50; ++i) {
+    bodies.push_back(createSolidBody(entities, randomGenerator));
+  }
+
+  CollisionChecker checker{&map, entities, entityx.events};
+
+  for (auto i = 0; i < 50; ++i) {
+    bodies.push_back(createSolidBody(entities, randomGenerator));
+  }
+
+  SECTION("Unmodified bodies") {
+    checkCollisionTests(checker, map, entities, randomGenerator);
+  }
+
+  SECTION("Moving, resizing, adding and removing bodies") {
+    for (auto round = 0; round < 50; ++round) {
+      for (auto i = 0; i < 10 && !bodies.empty(); ++i) {
+        modifyRandomBody(bodies, entities, entityx.events, randomGenerator);
+      }
+
+      checkCollisionTests(checker, map, entities, randomGenerator);
+    }
+  }
+
+  SECTION("After clearing all entities") {
+    clearAllEntities(entities, entityx.events);
+    bodies.clear();
+    checkCollisionTests(checker, map, entities, randomGenerator);
+
+    for (auto i = 0; i < 20; ++i) {
+      bodies.push_back(createSolidBody(entities, randomGenerator));
+    }
+
+    checkCollisionTests(checker, map, entities, randomGenerator);
+  }
+}
+
+
+TEST_CASE("Sweeps give the same results as moving one unit at a time") {
+  std::mt19937 randomGenerator{5678};
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+  const auto map = makeRandomMap(randomGenerator);
+
+  for (auto i = 0; i < 100; ++i) {
+    createSolidBody(entities, randomGenerator);
+  }
+
+  CollisionChecker checker{&map, entities, entityx.events};
+
+  const BlockingTest isTouchingLeftWall = &CollisionChecker::isTouchingLeftWall;
+  const BlockingTest isTouchingRightWall =
+    &CollisionChecker::isTouchingRightWall;
+  const BlockingTest isTouchingCeiling = &CollisionChecker::isTouchingCeiling;
+  const BlockingTest isOnSolidGround = &CollisionChecker::isOnSolidGround;
+
+  std::uniform_int_distribution<int> distance{0, 40};
+
+  SECTION("Free distance") {
+    for (auto i = 0; i < 2000; ++i) {
+      const auto bbox = randomBbox(randomGenerator);
+      const auto maxDistance = distance(randomGenerator);
+
+      CHECK(checker.freeDistanceLeft(bbox, maxDistance) ==
+        freeDistanceReference(
+          checker, bbox, maxDistance, {-1, 0}, isTouchingLeftWall));
+      CHECK(checker.freeDistanceRight(bbox, maxDistance) ==
+        freeDistanceReference(
+          checker, bbox, maxDistance, {1, 0}, isTouchingRightWall));
+      CHECK(checker.freeDistanceUp(bbox, maxDistance) ==
+        freeDistanceReference(
+          checker, bbox, maxDistance, {0, -1}, isTouchingCeiling));
+      CHECK(checker.freeDistanceDown(bbox, maxDistance) ==
+        freeDistanceReference(
+          checker, bbox, maxDistance, {0, 1}, isOnSolidGround));
+    }
+  }
+
+  SECTION("Moving entities") {
+    std::uniform_int_distribution<int> amount{-40, 40};
+
+    auto entity = entities.create();
+    entity.assign<BoundingBox>(BoundingBox{});
+    entity.assign<WorldPosition>();
+    auto& bbox = *entity.component<BoundingBox>();
+    auto& position = *entity.component<WorldPosition>();
+
+    for (auto i = 0; i < 1000; ++i) {
+      bbox.size = randomBbox(randomGenerator).size;
+      position = randomPosition(randomGenerator);
+
+      const auto worldSpaceBbox = toWorldSpace(bbox, position);
+      const auto horizontalAmount = amount(randomGenerator);
+      const auto expectedHorizontalDistance = freeDistanceReference(
+        checker,
+        worldSpaceBbox,
+        std::abs(horizontalAmount),
+        {horizontalAmount < 0 ? -1 : 1, 0},
+        horizontalAmount < 0 ? isTouchingLeftWall : isTouchingRightWall);
+      const auto expectedX = position.x + (horizontalAmount < 0
+        ? -expectedHorizontalDistance
+        : expectedHorizontalDistance);
+
+      CHECK(moveHorizontally(checker, entity, horizontalAmount) ==
+        expectedMovementResult(expectedHorizontalDistance, horizontalAmount));
+      CHECK(position.x == expectedX);
+
+      const auto movedBbox = toWorldSpace(bbox, position);
+      const auto verticalAmount = amount(randomGenerator);
+      const auto expectedVerticalDistance = freeDistanceReference(
+        checker,
+        movedBbox,
+        std::abs(verticalAmount),
+        {0, verticalAmount < 0 ? -1 : 1},
+        verticalAmount < 0 ? isTouchingCeiling : isOnSolidGround);
+      const auto expectedY = position.y + (verticalAmount < 0
+        ? -expectedVerticalDistance
+        : expectedVerticalDistance);
+
+      CHECK(moveVertically(checker, entity, verticalAmount) ==
+        expectedMovementResult(expectedVerticalDistance, verticalAmount));
+      CHECK(position.y == expectedY);
+    }
+  }
+}
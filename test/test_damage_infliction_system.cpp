@@ -0,0 +1,333 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils.hpp"
+
+#include <base/warnings.hpp>
+#include <data/player_model.hpp>
+#include <engine/base_components.hpp>
+#include <engine/physical_components.hpp>
+#include <game_logic/damage_components.hpp>
+#include <game_logic/damage_infliction_system.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine::components;
+using namespace game_logic;
+using namespace game_logic::components;
+
+
+namespace ex = entityx;
+
+
+namespace {
+
+// Works like DamageInflictionSystem did before it had a broad phase: Test
+// each inflictor against all shootables, in entity order
+class ReferenceDamageInflictionSystem {
+public:
+  ReferenceDamageInflictionSystem(
+    data::PlayerModel* pPlayerModel,
+    ex::EventManager* pEvents
+  )
+    : mpPlayerModel(pPlayerModel)
+    , mpEvents(pEvents)
+  {
+  }
+
+  void update(ex::EntityManager& es) {
+    es.each<DamageInflicting, WorldPosition, BoundingBox>(
+      [this, &es](
+        ex::Entity inflictorEntity,
+        DamageInflicting& damage,
+        const WorldPosition& inflictorPosition,
+        const BoundingBox& bbox
+      ) {
+        const auto inflictorBbox =
+          engine::toWorldSpace(bbox, inflictorPosition);
+
+        ex::ComponentHandle<Shootable> shootable;
+        ex::ComponentHandle<WorldPosition> shootablePos;
+        ex::ComponentHandle<BoundingBox> shootableBboxLocal;
+        for (auto shootableEntity : es.entities_with_components(
+          shootable, shootablePos, shootableBboxLocal)
+        ) {
+          const auto shootableBbox =
+            engine::toWorldSpace(*shootableBboxLocal, *shootablePos);
+
+          const auto shootableOnScreen =
+            shootableEntity.has_component<Active>() &&
+            shootableEntity.component<Active>()->mIsOnScreen;
+
+          if (
+            shootableBbox.intersects(inflictorBbox) &&
+            !shootable->mInvincible &&
+            (shootableOnScreen || shootable->mCanBeHitWhenOffscreen)
+          ) {
+            const auto destroyOnContact = damage.mDestroyOnContact ||
+              shootable->mAlwaysConsumeInflictor;
+            inflictDamage(
+              inflictorEntity, damage, shootableEntity, *shootable);
+            if (destroyOnContact) {
+              break;
+            }
+          }
+        }
+      });
+  }
+
+private:
+  void inflictDamage(
+    ex::Entity inflictorEntity,
+    DamageInflicting& damage,
+    ex::Entity shootableEntity,
+    Shootable& shootable
+  ) {
+    const auto inflictorVelocity = inflictorEntity.has_component<MovingBody>()
+      ? inflictorEntity.component<MovingBody>()->mVelocity
+      : base::Point<float>{};
+    if (damage.mDestroyOnContact || shootable.mAlwaysConsumeInflictor) {
+      inflictorEntity.destroy();
+    } else {
+      damage.mHasCausedDamage = true;
+    }
+
+    shootable.mHealth -= damage.mAmount;
+    if (shootable.mHealth <= 0) {
+      mpEvents->emit(
+        events::ShootableKilled{shootableEntity, inflictorVelocity});
+      mpPlayerModel->giveScore(shootable.mGivenScore);
+
+      if (shootable.mDestroyWhenKilled) {
+        shootableEntity.destroy();
+      } else {
+        shootableEntity.remove<Shootable>();
+      }
+    } else {
+      mpEvents->emit(
+        events::ShootableDamaged{shootableEntity, inflictorVelocity});
+    }
+  }
+
+  data::PlayerModel* mpPlayerModel;
+  ex::EventManager* mpEvents;
+};
+
+
+ex::Entity createShootable(
+  ex::EntityManager& entities,
+  const WorldPosition& position,
+  std::mt19937& randomGenerator
+) {
+  std::uniform_int_distribution<int> percentage{0, 99};
+  std::uniform_int_distribution<int> width{1, 12};
+  std::uniform_int_distribution<int> height{1, 6};
+  std::uniform_int_distribution<int> health{1, 4};
+
+  auto entity = entities.create();
+  entity.assign<WorldPosition>(position);
+  entity.assign<BoundingBox>(BoundingBox{
+    {0, 0}, {width(randomGenerator), height(randomGenerator)}});
+
+  Shootable shootable{health(randomGenerator), percentage(randomGenerator)};
+  shootable.mInvincible = percentage(randomGenerator) < 10;
+  shootable.mDestroyWhenKilled = percentage(randomGenerator) < 70;
+  shootable.mAlwaysConsumeInflictor = percentage(randomGenerator) < 10;
+  shootable.mCanBeHitWhenOffscreen = percentage(randomGenerator) < 30;
+  entity.assign<Shootable>(shootable);
+
+  if (percentage(randomGenerator) < 90) {
+    entity.assign<Active>(Active{percentage(randomGenerator) < 80});
+  }
+
+  return entity;
+}
+
+
+void populateWorld(ex::EntityManager& entities, const unsigned seed) {
+  std::mt19937 randomGenerator{seed};
+  std::uniform_int_distribution<int> percentage{0, 99};
+  std::uniform_int_distribution<int> x{0, 80};
+  std::uniform_int_distribution<int> y{0, 30};
+  std::uniform_int_distribution<int> size{1, 3};
+  std::uniform_int_distribution<int> amount{1, 2};
+  std::uniform_real_distribution<float> velocity{-2.0f, 2.0f};
+
+  for (auto i = 0; i < 100; ++i) {
+    const auto position = WorldPosition{x(randomGenerator), y(randomGenerator)};
+
+    if (percentage(randomGenerator) < 60) {
+      createShootable(entities, position, randomGenerator);
+    } else {
+      auto entity = entities.create();
+      entity.assign<WorldPosition>(position);
+      entity.assign<BoundingBox>(BoundingBox{
+        {0, 0}, {size(randomGenerator), size(randomGenerator)}});
+      entity.assign<DamageInflicting>(DamageInflicting{
+        amount(randomGenerator), percentage(randomGenerator) < 50});
+      entity.assign<MovingBody>(MovingBody{
+        {velocity(randomGenerator), 0.0f}, false});
+    }
+  }
+}
+
+
+/** Reacts to hits, like enemies and containers do, and records them
+ *
+ * Damaged shootables are moved or resized, some killed ones drop a new
+ * shootable in their place.
+ */
+struct HitReactions : public ex::Receiver<HitReactions> {
+  HitReactions(ex::EntityManager& entities, ex::EventManager& events)
+    : mpEntities(&entities)
+    , mRandomGenerator(42)
+  {
+    events.subscribe<events::ShootableDamaged>(*this);
+    events.subscribe<events::ShootableKilled>(*this);
+  }
+
+  void receive(const events::ShootableDamaged& event) {
+    auto entity = event.mEntity;
+    record(false, entity, event.mInflictorVelocity);
+
+    switch (entity.id().index() % 3) {
+      case 0:
+        entity.component<WorldPosition>()->x += 3;
+        break;
+
+      case 1:
+        entity.component<BoundingBox>()->size.width += 2;
+        break;
+    }
+  }
+
+  void receive(const events::ShootableKilled& event) {
+    auto entity = event.mEntity;
+    record(true, entity, event.mInflictorVelocity);
+
+    if (entity.id().index() % 2 == 0) {
+      createShootable(
+        *mpEntities,
+        *entity.component<WorldPosition>(),
+        mRandomGenerator);
+    }
+  }
+
+  void record(
+    const bool killed,
+    ex::Entity entity,
+    const base::Point<float>& velocity
+  ) {
+    mLog.emplace_back(killed, entity.id().id(), velocity.x);
+  }
+
+  ex::EntityManager* mpEntities;
+  std::mt19937 mRandomGenerator;
+  std::vector<std::tuple<bool, std::uint64_t, float>> mLog;
+};
+
+
+struct EntityState {
+  bool operator==(const EntityState& other) const {
+    return
+      std::tie(mId, mPosition, mBbox, mHealth, mHasCausedDamage) ==
+      std::tie(
+        other.mId,
+        other.mPosition,
+        other.mBbox,
+        other.mHealth,
+        other.mHasCausedDamage);
+  }
+
+  std::uint64_t mId;
+  WorldPosition mPosition;
+  BoundingBox mBbox;
+  int mHealth;
+  bool mHasCausedDamage;
+};
+
+
+std::vector<EntityState> worldState(ex::EntityManager& entities) {
+  std::vector<EntityState> result;
+  for (auto entity : entities.entities_for_debugging()) {
+    result.push_back(EntityState{
+      entity.id().id(),
+      *entity.component<WorldPosition>(),
+      *entity.component<BoundingBox>(),
+      entity.has_component<Shootable>()
+        ? entity.component<Shootable>()->mHealth
+        : -1,
+      entity.has_component<DamageInflicting>() &&
+        entity.component<DamageInflicting>()->mHasCausedDamage});
+  }
+
+  return result;
+}
+
+
+void moveInflictors(ex::EntityManager& entities) {
+  entities.each<DamageInflicting, WorldPosition>(
+    [](ex::Entity, const DamageInflicting&, WorldPosition& position) {
+      position.x += 2;
+    });
+}
+
+}
+
+
+TEST_CASE("Shootable broad phase gives the same results as testing all") {
+  for (auto seed = 0u; seed < 100u; ++seed) {
+    ex::EntityX entityx;
+    data::PlayerModel playerModel;
+    MockServiceProvider mockServiceProvider;
+    DamageInflictionSystem damageInflictionSystem{
+      &playerModel, &mockServiceProvider, &entityx.events};
+    HitReactions reactions{entityx.entities, entityx.events};
+    populateWorld(entityx.entities, seed);
+
+    ex::EntityX referenceEntityx;
+    data::PlayerModel referencePlayerModel;
+    ReferenceDamageInflictionSystem referenceSystem{
+      &referencePlayerModel, &referenceEntityx.events};
+    HitReactions referenceReactions{
+      referenceEntityx.entities, referenceEntityx.events};
+    populateWorld(referenceEntityx.entities, seed);
+
+    for (auto round = 0; round < 4; ++round) {
+      damageInflictionSystem.update(entityx.entities);
+      referenceSystem.update(referenceEntityx.entities);
+
+      CHECK(reactions.mLog == referenceReactions.mLog);
+      CHECK(playerModel.score() == referencePlayerModel.score());
+      CHECK(
+        worldState(entityx.entities) ==
+        worldState(referenceEntityx.entities));
+
+      moveInflictors(entityx.entities);
+      moveInflictors(referenceEntityx.entities);
+    }
+  }
+}
@@ -0,0 +1,342 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <data/game_traits.hpp>
+#include <data/map.hpp>
+#include <engine/base_components.hpp>
+#include <engine/entity_activation_system.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/physical_components.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+using engine::EntityActivationSystem;
+using Policy = ActivationSettings::Policy;
+
+namespace ex = entityx;
+
+
+namespace {
+
+constexpr auto MAP_WIDTH = 200;
+constexpr auto MAP_HEIGHT = 100;
+
+
+/** The activation system's original implementation
+ *
+ * Examines every entity on each update.
+ */
+void referenceMarkActiveEntities(
+  ex::EntityManager& es,
+  const base::Vector& cameraPosition,
+  const data::ViewPortSize& viewPortSize
+) {
+  const BoundingBox activeRegionBox{
+    cameraPosition, viewPortSize.mapViewPortSize()};
+
+  es.each<WorldPosition, BoundingBox>([&activeRegionBox](
+    ex::Entity entity,
+    const WorldPosition& position,
+    const BoundingBox& bbox
+  ) {
+    const auto worldSpaceBbox = toWorldSpace(bbox, position);
+    const auto inActiveRegion = worldSpaceBbox.intersects(activeRegionBox);
+
+    auto active = inActiveRegion;
+    if (entity.has_component<ActivationSettings>()) {
+      auto& settings = *entity.component<ActivationSettings>();
+      if (settings.mPolicy == Policy::Always) {
+        active = true;
+      } else if (settings.mPolicy == Policy::AlwaysAfterFirstActivation) {
+        settings.mHasBeenActivated =
+          settings.mHasBeenActivated || inActiveRegion;
+        active = settings.mHasBeenActivated;
+      }
+    }
+
+    setTag<Active>(entity, active);
+    if (active) {
+      entity.component<Active>()->mIsOnScreen = inActiveRegion;
+    }
+  });
+}
+
+
+using EntityState = std::tuple<
+  std::uint32_t,
+  bool,
+  std::optional<bool>,
+  std::optional<bool>>;
+
+
+std::vector<EntityState> worldState(ex::EntityManager& es) {
+  std::vector<EntityState> result;
+  for (auto entity : es.entities_for_debugging()) {
+    result.emplace_back(
+      entity.id().index(),
+      entity.has_component<Active>(),
+      entity.has_component<Active>()
+        ? std::optional<bool>{entity.component<const Active>()->mIsOnScreen}
+        : std::nullopt,
+      entity.has_component<ActivationSettings>()
+        ? std::optional<bool>{
+            entity.component<const ActivationSettings>()->mHasBeenActivated}
+        : std::nullopt);
+  }
+
+  return result;
+}
+
+
+struct World {
+  ex::EntityX mEntityx;
+  base::Vector mCameraPosition{0, 0};
+};
+
+
+/** Moves the camera around and creates, moves and changes entities
+ *
+ * With the same seed, identical worlds get the same modifications.
+ */
+class RandomModifications {
+public:
+  explicit RandomModifications(const unsigned seed)
+    : mRandomGenerator(seed)
+  {
+  }
+
+  void createRandomEntity(World& world) {
+    auto entity = world.mEntityx.entities.create();
+    entity.assign<WorldPosition>(randomPosition());
+    entity.assign<BoundingBox>(
+      BoundingBox{{0, 0}, {pick(20) + 1, pick(20) + 1}});
+
+    switch (pick(6)) {
+      case 0:
+        entity.assign<ActivationSettings>(Policy::Always);
+        break;
+
+      case 1:
+        entity.assign<ActivationSettings>(Policy::AlwaysAfterFirstActivation);
+        break;
+
+      case 2:
+        entity.assign<ActivationSettings>(Policy::WhenOnScreen);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  void moveCamera(World& world) {
+    if (pick(30) == 0) {
+      world.mCameraPosition = {pick(MAP_WIDTH), pick(MAP_HEIGHT)};
+    } else {
+      world.mCameraPosition += base::Vector{pick(5) - 2, pick(5) - 2};
+    }
+  }
+
+  /** Changes which the activation system notices on the next update */
+  void apply(World& world) {
+    auto entities = allEntities(world.mEntityx.entities);
+    if (entities.empty()) {
+      createRandomEntity(world);
+      return;
+    }
+
+    auto entity = entities[pick(static_cast<int>(entities.size()))];
+
+    switch (pick(8)) {
+      case 0:
+        createRandomEntity(world);
+        break;
+
+      case 1:
+        entity.destroy();
+        break;
+
+      case 2:
+        // Active entities can be moved directly at any time
+        if (entity.has_component<Active>()) {
+          *entity.component<WorldPosition>() = randomPosition();
+        }
+        break;
+
+      case 3:
+        // So can any entity, by assigning a new position
+        entity.remove<WorldPosition>();
+        entity.assign<WorldPosition>(randomPosition());
+        break;
+
+      case 4:
+        entity.remove<BoundingBox>();
+        entity.assign<BoundingBox>(
+          BoundingBox{{0, 0}, {pick(20) + 1, pick(20) + 1}});
+        break;
+
+      case 5:
+        if (!entity.has_component<ActivationSettings>()) {
+          entity.assign<ActivationSettings>(
+            pick(2) == 0 ? Policy::Always : Policy::AlwaysAfterFirstActivation);
+        }
+        break;
+
+      case 6:
+        // Removing Active happens e.g. when an entity is about to be
+        // destroyed, or when taking it out of the game temporarily
+        if (entity.has_component<Active>()) {
+          entity.remove<Active>();
+        }
+        break;
+
+      default:
+        moveCamera(world);
+        break;
+    }
+  }
+
+  /** Moves inactive entities without telling the activation system */
+  void moveInactiveEntities(World& world) {
+    for (auto entity : allEntities(world.mEntityx.entities)) {
+      if (!entity.has_component<Active>() && pick(10) == 0) {
+        *entity.component<WorldPosition>() = randomPosition();
+      }
+    }
+  }
+
+private:
+  int pick(const int count) {
+    return std::uniform_int_distribution<int>{0, count - 1}(
+      mRandomGenerator);
+  }
+
+  WorldPosition randomPosition() {
+    // Some entities are placed outside of the map
+    return {pick(MAP_WIDTH + 40) - 20, pick(MAP_HEIGHT + 40) - 20};
+  }
+
+  static std::vector<ex::Entity> allEntities(ex::EntityManager& es) {
+    std::vector<ex::Entity> result;
+    es.each<WorldPosition, BoundingBox>(
+      [&](ex::Entity entity, const WorldPosition&, const BoundingBox&) {
+        result.push_back(entity);
+      });
+    return result;
+  }
+
+  std::mt19937 mRandomGenerator;
+};
+
+
+struct TestSetup {
+  explicit TestSetup(const unsigned seed)
+    : mReferenceModifications(seed)
+    , mModifications(seed)
+    , mMap(MAP_WIDTH, MAP_HEIGHT, data::map::TileAttributeDict{{0x0}})
+  {
+    // Most entities exist before the system is created
+    for (auto i = 0; i < 200; ++i) {
+      mReferenceModifications.createRandomEntity(mReferenceWorld);
+      mModifications.createRandomEntity(mWorld);
+    }
+
+    mpSystem.emplace(mMap, mViewPortSize, mWorld.mEntityx.events);
+  }
+
+  void update() {
+    referenceMarkActiveEntities(
+      mReferenceWorld.mEntityx.entities,
+      mReferenceWorld.mCameraPosition,
+      mViewPortSize);
+    mpSystem->update(mWorld.mEntityx.entities, mWorld.mCameraPosition);
+  }
+
+  bool statesMatch() {
+    return
+      worldState(mWorld.mEntityx.entities) ==
+      worldState(mReferenceWorld.mEntityx.entities);
+  }
+
+  World mReferenceWorld;
+  World mWorld;
+  RandomModifications mReferenceModifications;
+  RandomModifications mModifications;
+  data::map::Map mMap;
+  data::ViewPortSize mViewPortSize;
+  std::optional<EntityActivationSystem> mpSystem;
+};
+
+}
+
+
+TEST_CASE("Entity activation is the same as when examining all entities") {
+  for (auto seed = 0u; seed < 3u; ++seed) {
+    TestSetup setup{seed};
+
+    for (auto tick = 0; tick < 200; ++tick) {
+      for (auto i = 0; i < 4; ++i) {
+        setup.mReferenceModifications.apply(setup.mReferenceWorld);
+        setup.mModifications.apply(setup.mWorld);
+      }
+
+      setup.update();
+      REQUIRE(setup.statesMatch());
+    }
+  }
+}
+
+
+TEST_CASE("Inactive entities moved directly are activated with a delay") {
+  for (auto seed = 0u; seed < 3u; ++seed) {
+    TestSetup setup{seed};
+
+    for (auto round = 0; round < 30; ++round) {
+      setup.mReferenceModifications.moveCamera(setup.mReferenceWorld);
+      setup.mModifications.moveCamera(setup.mWorld);
+      setup.mReferenceModifications.moveInactiveEntities(
+        setup.mReferenceWorld);
+      setup.mModifications.moveInactiveEntities(setup.mWorld);
+
+      // With the camera standing still, all moved entities have been noticed
+      // after this many updates
+      for (
+        auto i = 0;
+        i < EntityActivationSystem::SECTOR_CHECK_INTERVAL;
+        ++i
+      ) {
+        setup.update();
+      }
+
+      REQUIRE(setup.statesMatch());
+    }
+  }
+}
@@ -0,0 +1,279 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/base_components.hpp>
+#include <engine/entity_grid.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/physical_components.hpp>
+#include <game_logic/collectable_components.hpp>
+#include <game_logic/entity_snapshot.hpp>
+#include <game_logic/player/components.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+using game_logic::EntitySnapshot;
+using game_logic::components::CollectableItem;
+using game_logic::components::Interactable;
+using game_logic::components::InteractableType;
+
+namespace ex = entityx;
+
+
+namespace {
+
+constexpr auto MAP_WIDTH = 100;
+constexpr auto MAP_HEIGHT = 60;
+
+
+BoundingBox randomArea(std::mt19937& randomGenerator) {
+  // Reaches past the map's edges on all sides
+  std::uniform_int_distribution<int> x{-20, MAP_WIDTH + 20};
+  std::uniform_int_distribution<int> y{-20, MAP_HEIGHT + 20};
+  std::uniform_int_distribution<int> size{1, 24};
+  return BoundingBox{
+    {x(randomGenerator), y(randomGenerator)},
+    {size(randomGenerator), size(randomGenerator)}};
+}
+
+
+WorldPosition randomPosition(std::mt19937& randomGenerator) {
+  const auto area = randomArea(randomGenerator);
+  return WorldPosition{area.left(), area.top()};
+}
+
+
+bool byIndex(const ex::Entity lhs, const ex::Entity rhs) {
+  return lhs.id().index() < rhs.id().index();
+}
+
+
+/** Checks a query result against the entities' current areas
+ *
+ * Every entity intersecting the area must be in the result, in index order.
+ * The result may contain more entities than that.
+ */
+bool isQueryResultComplete(
+  const std::vector<ex::Entity>& result,
+  const BoundingBox& area,
+  const std::vector<std::pair<ex::Entity, BoundingBox>>& expectedAreas
+) {
+  if (!std::is_sorted(result.begin(), result.end(), byIndex)) {
+    return false;
+  }
+
+  return std::all_of(
+    expectedAreas.begin(), expectedAreas.end(), [&](const auto& entry) {
+      return
+        !entry.second.intersects(area) ||
+        std::find(result.begin(), result.end(), entry.first) != result.end();
+    });
+}
+
+
+/** Keeps grids up to date the same way PlayerInteractionSystem does */
+class InteractionGrids : public ex::Receiver<InteractionGrids> {
+public:
+  explicit InteractionGrids(ex::EventManager& eventManager)
+    : mInteractables(MAP_WIDTH, MAP_HEIGHT)
+    , mCollectables(MAP_WIDTH, MAP_HEIGHT)
+  {
+    eventManager.subscribe<ex::ComponentAddedEvent<Interactable>>(*this);
+    eventManager.subscribe<ex::ComponentRemovedEvent<Interactable>>(*this);
+    eventManager.subscribe<ex::ComponentAddedEvent<CollectableItem>>(*this);
+    eventManager.subscribe<ex::ComponentRemovedEvent<CollectableItem>>(*this);
+    eventManager.subscribe<events::ClearingAllEntities>(*this);
+  }
+
+  void receive(const ex::ComponentAddedEvent<Interactable>& event) {
+    mInteractables.insert(event.entity);
+  }
+
+  void receive(const ex::ComponentRemovedEvent<Interactable>& event) {
+    mInteractables.remove(event.entity);
+  }
+
+  void receive(const ex::ComponentAddedEvent<CollectableItem>& event) {
+    mCollectables.insert(event.entity);
+  }
+
+  void receive(const ex::ComponentRemovedEvent<CollectableItem>& event) {
+    mCollectables.remove(event.entity);
+  }
+
+  void receive(const events::ClearingAllEntities&) {
+    mInteractables.clear();
+    mCollectables.clear();
+  }
+
+  EntityGrid mInteractables;
+  EntityGrid mCollectables;
+};
+
+
+bool isFoundAtCurrentPosition(EntityGrid& grid, ex::Entity entity) {
+  const auto area = toWorldSpace(
+    *entity.component<const BoundingBox>(),
+    *entity.component<const WorldPosition>());
+  const auto& result = grid.entitiesNear(area);
+  return std::find(result.begin(), result.end(), entity) != result.end();
+}
+
+}
+
+
+TEST_CASE("Entity grid finds all entities near an area") {
+  std::mt19937 randomGenerator{1234};
+  std::uniform_int_distribution<int> percentage{0, 99};
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+  EntityGrid grid{MAP_WIDTH, MAP_HEIGHT};
+
+  // Entities with a MovingBody, and those which get a position after being
+  // inserted, are moved around the map. The others stay in place.
+  std::vector<ex::Entity> movingEntities;
+  std::vector<ex::Entity> allEntities;
+  std::vector<std::pair<ex::Entity, BoundingBox>> fixedAreas;
+
+  for (auto i = 0; i < 100; ++i) {
+    auto entity = entities.create();
+    entity.assign<BoundingBox>(
+      BoundingBox{{0, 0}, randomArea(randomGenerator).size});
+
+    const auto kind = percentage(randomGenerator);
+    if (kind < 20) {
+      const auto area = randomArea(randomGenerator);
+      entity.assign<WorldPosition>(randomPosition(randomGenerator));
+      entity.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, false});
+      grid.insert(entity, area);
+      fixedAreas.emplace_back(entity, area);
+      continue;
+    }
+
+    if (kind < 50) {
+      entity.assign<WorldPosition>(randomPosition(randomGenerator));
+      entity.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, false});
+      grid.insert(entity);
+      movingEntities.push_back(entity);
+    } else if (kind < 65) {
+      grid.insert(entity);
+      entity.assign<WorldPosition>(randomPosition(randomGenerator));
+      movingEntities.push_back(entity);
+    } else {
+      entity.assign<WorldPosition>(randomPosition(randomGenerator));
+      grid.insert(entity);
+    }
+
+    allEntities.push_back(entity);
+  }
+
+  for (auto round = 0; round < 50; ++round) {
+    for (auto i = 0; i < 10; ++i) {
+      std::uniform_int_distribution<std::size_t> pick{
+        0, movingEntities.size() - 1};
+      *movingEntities[pick(randomGenerator)].component<WorldPosition>() =
+        randomPosition(randomGenerator);
+    }
+
+    // Entities with a fixed area are found there, no matter where they are
+    auto expectedAreas = fixedAreas;
+    for (auto entity : allEntities) {
+      expectedAreas.emplace_back(entity, toWorldSpace(
+        *entity.component<const BoundingBox>(),
+        *entity.component<const WorldPosition>()));
+    }
+
+    for (auto i = 0; i < 20; ++i) {
+      const auto area = randomArea(randomGenerator);
+      REQUIRE(isQueryResultComplete(
+        grid.entitiesNear(area), area, expectedAreas));
+    }
+  }
+}
+
+
+TEST_CASE("Interactables and collectables are found where they are") {
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+  InteractionGrids grids{entityx.events};
+
+  // The entities are set up in the same order as in entity_configuration.ipp
+  // and item_container.cpp
+  auto keyHole = entities.create();
+  keyHole.assign<WorldPosition>(10, 20);
+  keyHole.assign<Interactable>(InteractableType::KeyHole);
+  keyHole.assign<BoundingBox>(BoundingBox{{0, 0}, {1, 1}});
+
+  auto hintMachine = entities.create();
+  hintMachine.assign<WorldPosition>(80, 50);
+  hintMachine.assign<Interactable>(InteractableType::HintMachine);
+  hintMachine.assign<BoundingBox>(BoundingBox{{0, 0}, {4, 3}});
+
+  auto bonusGlobe = entities.create();
+  bonusGlobe.assign<WorldPosition>(30, 10);
+  bonusGlobe.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 2}});
+  bonusGlobe.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, true});
+  bonusGlobe.assign<CollectableItem>();
+
+  auto releasedItem = entities.create();
+  releasedItem.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 2}});
+  releasedItem.assign<MovingBody>(MovingBody{{0.0f, 0.0f}, true});
+  releasedItem.assign<CollectableItem>();
+  releasedItem.assign<WorldPosition>(50, 20);
+
+  auto checkEntitiesAreFound = [&]() {
+    CHECK(isFoundAtCurrentPosition(grids.mInteractables, keyHole));
+    CHECK(isFoundAtCurrentPosition(grids.mInteractables, hintMachine));
+
+    // Collectables fall, and move in other ways than before each query, so
+    // the grid needs to follow them.
+    for (auto i = 0; i < 20; ++i) {
+      bonusGlobe.component<WorldPosition>()->y += 2;
+      releasedItem.component<WorldPosition>()->x += 3;
+
+      CHECK(isFoundAtCurrentPosition(grids.mCollectables, bonusGlobe));
+      CHECK(isFoundAtCurrentPosition(grids.mCollectables, releasedItem));
+    }
+  };
+
+  SECTION("After creation") {
+    checkEntitiesAreFound();
+  }
+
+  SECTION("After restoring a snapshot") {
+    const auto snapshot = EntitySnapshot::capture(entities);
+    REQUIRE(snapshot);
+
+    snapshot->restore(entities, entityx.events);
+    REQUIRE(grids.mInteractables.entities().size() == 2);
+    REQUIRE(grids.mCollectables.entities().size() == 2);
+
+    checkEntitiesAreFound();
+  }
+}
@@ -0,0 +1,205 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/entity_slot_list.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using engine::EntitySlotList;
+
+
+namespace ex = entityx;
+
+
+namespace {
+
+// Entities in list order, with gaps, as a plain vector. Looking up an
+// entity's position is done by linear search.
+std::optional<std::size_t> indexOfReference(
+  const std::vector<ex::Entity>& reference,
+  const ex::Entity entity
+) {
+  const auto iEntity = std::find_if(
+    reference.begin(), reference.end(), [&](const ex::Entity& candidate) {
+      return candidate.valid() && candidate.id() == entity.id();
+    });
+
+  if (iEntity == reference.end()) {
+    return std::nullopt;
+  }
+
+  return static_cast<std::size_t>(iEntity - reference.begin());
+}
+
+
+void checkMatchesReference(
+  const EntitySlotList& list,
+  const std::vector<ex::Entity>& reference,
+  const std::vector<ex::Entity>& allEntitiesEverCreated
+) {
+  REQUIRE(list.size() == reference.size());
+  CHECK(list.empty() == reference.empty());
+  CHECK(std::equal(list.begin(), list.end(), reference.begin()));
+
+  for (const auto& entity : allEntitiesEverCreated) {
+    const auto expectedIndex = indexOfReference(reference, entity);
+    CHECK(list.indexOf(entity) == expectedIndex);
+    CHECK(list.contains(entity) == expectedIndex.has_value());
+  }
+}
+
+
+void testRandomOperations(const bool keepOrder) {
+  std::mt19937 randomGenerator{keepOrder ? 1u : 2u};
+  std::uniform_int_distribution<int> action{0, 9};
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  EntitySlotList list;
+  std::vector<ex::Entity> reference;
+
+  // Entity handles stay around after their entity is destroyed, to check
+  // that entities reusing an index aren't mistaken for them
+  std::vector<ex::Entity> allEntitiesEverCreated;
+  std::vector<ex::Entity> liveEntities;
+
+  for (auto i = 0; i < 20; ++i) {
+    liveEntities.push_back(entities.create());
+    allEntitiesEverCreated.push_back(liveEntities.back());
+  }
+
+  const auto pick = [&](const std::size_t size) {
+    return std::uniform_int_distribution<std::size_t>{0, size - 1}(
+      randomGenerator);
+  };
+
+  for (auto step = 0; step < 500; ++step) {
+    switch (action(randomGenerator)) {
+      case 0:
+      case 1:
+      case 2:
+      case 3:
+        if (!liveEntities.empty()) {
+          const auto entity = liveEntities[pick(liveEntities.size())];
+          const auto isContained =
+            indexOfReference(reference, entity).has_value();
+          CHECK(list.insert(entity) == !isContained);
+          if (!isContained) {
+            reference.push_back(entity);
+          }
+        }
+        break;
+
+      case 4:
+      case 5:
+      case 6:
+        if (!reference.empty()) {
+          const auto index = pick(reference.size());
+          if (!reference[index].valid()) {
+            break;
+          }
+
+          if (keepOrder) {
+            list.removeAtKeepingOrder(index);
+            reference[index] = ex::Entity{};
+          } else {
+            list.removeAt(index);
+            reference[index] = reference.back();
+            reference.pop_back();
+          }
+        }
+        break;
+
+      case 7:
+        // Destroy an entity that's not in the list, and create a new one
+        // which is likely to reuse its index
+        if (!liveEntities.empty()) {
+          const auto index = pick(liveEntities.size());
+          auto entity = liveEntities[index];
+          if (!indexOfReference(reference, entity)) {
+            entity.destroy();
+            liveEntities[index] = entities.create();
+            allEntitiesEverCreated.push_back(liveEntities[index]);
+          }
+        }
+        break;
+
+      case 8:
+        liveEntities.push_back(entities.create());
+        allEntitiesEverCreated.push_back(liveEntities.back());
+        break;
+
+      case 9:
+        if (pick(20) == 0) {
+          list.clear();
+          reference.clear();
+        }
+        break;
+    }
+
+    checkMatchesReference(list, reference, allEntitiesEverCreated);
+  }
+}
+
+}
+
+
+TEST_CASE("Entity slot list matches a plain list of entities") {
+  SECTION("Removing by swapping with the last entity") {
+    testRandomOperations(false);
+  }
+
+  SECTION("Removing while keeping the order intact") {
+    testRandomOperations(true);
+  }
+
+  SECTION("Removing with both methods") {
+    ex::EntityX entityx;
+    EntitySlotList list;
+
+    const auto a = entityx.entities.create();
+    const auto b = entityx.entities.create();
+    const auto c = entityx.entities.create();
+    list.insert(a);
+    list.insert(b);
+    list.insert(c);
+
+    list.removeAtKeepingOrder(2);
+    list.removeAt(0);
+
+    REQUIRE(list.size() == 2);
+    CHECK(!list[0].valid());
+    CHECK(list[1] == b);
+    CHECK(!list.contains(a));
+    CHECK(list.indexOf(b) == std::optional<std::size_t>{1});
+    CHECK(!list.contains(c));
+
+    list.insert(a);
+    CHECK(list.indexOf(a) == std::optional<std::size_t>{2});
+  }
+}
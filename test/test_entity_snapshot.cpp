@@ -0,0 +1,198 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/base_components.hpp>
+#include <game_logic/entity_snapshot.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine::components;
+
+using game_logic::EntitySnapshot;
+
+namespace ex = entityx;
+
+
+namespace {
+
+/** Creates and destroys entities in random order
+ *
+ * Leaves behind entities with various versions, and a free list that's
+ * not sorted by index.
+ */
+void shuffleEntities(
+  ex::EntityManager& es,
+  std::mt19937& randomGenerator,
+  const int numRounds
+) {
+  std::vector<ex::Entity> aliveEntities;
+  for (auto round = 0; round < numRounds; ++round) {
+    const auto numToCreate =
+      std::uniform_int_distribution<int>{0, 12}(randomGenerator);
+    for (auto i = 0; i < numToCreate; ++i) {
+      auto entity = es.create();
+      entity.assign<WorldPosition>(round, i);
+      aliveEntities.push_back(entity);
+    }
+
+    std::shuffle(begin(aliveEntities), end(aliveEntities), randomGenerator);
+
+    const auto numToDestroy = std::uniform_int_distribution<std::size_t>{
+      0, aliveEntities.size()}(randomGenerator);
+    for (std::size_t i = 0; i < numToDestroy; ++i) {
+      aliveEntities.back().destroy();
+      aliveEntities.pop_back();
+    }
+  }
+}
+
+
+std::vector<ex::Entity::Id> allIds(ex::EntityManager& es) {
+  std::vector<ex::Entity::Id> result;
+  for (auto entity : es.entities_for_debugging()) {
+    result.push_back(entity.id());
+  }
+
+  return result;
+}
+
+
+std::vector<ex::Entity::Id> createEntities(
+  ex::EntityManager& es,
+  const std::size_t count
+) {
+  std::vector<ex::Entity::Id> result;
+  for (std::size_t i = 0; i < count; ++i) {
+    result.push_back(es.create().id());
+  }
+
+  return result;
+}
+
+}
+
+
+TEST_CASE("Entities created after restoring a snapshot get the same IDs") {
+  // Captures a snapshot of a randomly built world, and remembers which IDs
+  // entities created afterwards get. Then calls restoreSnapshot, which is
+  // expected to leave es in the state captured by the snapshot.
+  auto checkIdsMatch = [](auto restoreSnapshot) {
+    for (const auto seed : {1u, 2u, 3u, 4u, 5u}) {
+      INFO(seed);
+
+      std::mt19937 randomGenerator{seed};
+
+      ex::EventManager events;
+      ex::EntityManager es{events};
+      shuffleEntities(es, randomGenerator, 40);
+      REQUIRE(es.size() < es.capacity());
+
+      const auto snapshot = EntitySnapshot::capture(es);
+      REQUIRE(snapshot);
+
+      // Creates more entities than there are unused indices, to also cover
+      // entities getting new indices
+      const auto numToCreate = es.capacity() - es.size() + 5;
+      const auto idsBeforeCreating = allIds(es);
+      const auto expectedIds = createEntities(es, numToCreate);
+
+      auto& restoredEs =
+        restoreSnapshot(*snapshot, es, events, randomGenerator);
+
+      CHECK(allIds(restoredEs) == idsBeforeCreating);
+      CHECK(createEntities(restoredEs, numToCreate) == expectedIds);
+    }
+  };
+
+  SECTION("Restoring into the same entity manager") {
+    checkIdsMatch([](
+      const EntitySnapshot& snapshot,
+      ex::EntityManager& es,
+      ex::EventManager& events,
+      std::mt19937&
+    ) -> ex::EntityManager& {
+      snapshot.restore(es, events);
+      return es;
+    });
+  }
+
+  SECTION("Restoring into an entity manager with a different history") {
+    ex::EventManager otherEvents;
+    ex::EntityManager otherEs{otherEvents};
+
+    checkIdsMatch([&](
+      const EntitySnapshot& snapshot,
+      ex::EntityManager&,
+      ex::EventManager&,
+      std::mt19937& randomGenerator
+    ) -> ex::EntityManager& {
+      shuffleEntities(otherEs, randomGenerator, 10);
+      snapshot.restore(otherEs, otherEvents);
+      return otherEs;
+    });
+  }
+
+  SECTION("Restoring several times") {
+    checkIdsMatch([](
+      const EntitySnapshot& snapshot,
+      ex::EntityManager& es,
+      ex::EventManager& events,
+      std::mt19937& randomGenerator
+    ) -> ex::EntityManager& {
+      snapshot.restore(es, events);
+      shuffleEntities(es, randomGenerator, 10);
+      snapshot.restore(es, events);
+      return es;
+    });
+  }
+}
+
+
+TEST_CASE("Restoring a snapshot restores components") {
+  std::mt19937 randomGenerator{42};
+
+  ex::EventManager events;
+  ex::EntityManager es{events};
+  shuffleEntities(es, randomGenerator, 20);
+
+  std::vector<std::pair<ex::Entity::Id, WorldPosition>> expected;
+  es.each<WorldPosition>([&](ex::Entity entity, const WorldPosition& pos) {
+    expected.emplace_back(entity.id(), pos);
+  });
+
+  const auto snapshot = EntitySnapshot::capture(es);
+  REQUIRE(snapshot);
+
+  shuffleEntities(es, randomGenerator, 20);
+  snapshot->restore(es, events);
+
+  std::vector<std::pair<ex::Entity::Id, WorldPosition>> actual;
+  es.each<WorldPosition>([&](ex::Entity entity, const WorldPosition& pos) {
+    actual.emplace_back(entity.id(), pos);
+  });
+
+  CHECK(actual == expected);
+}
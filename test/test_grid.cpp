@@ -0,0 +1,113 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/grid.hpp>
+#include <base/warnings.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+using namespace rigel;
+using namespace base;
+
+
+TEST_CASE("Grid of flags") {
+  Grid<bool> grid{70, 3};
+
+  SECTION("All cells start out unset") {
+    for (auto y = 0u; y < grid.height(); ++y) {
+      for (auto x = 0u; x < grid.width(); ++x) {
+        REQUIRE(!grid.valueAt(x, y));
+      }
+    }
+  }
+
+  SECTION("Individual cells can be set and cleared") {
+    grid.setValueAt(0, 0, true);
+    grid.setValueAt(64, 1, true);
+    grid.setValueAt(69, 2, true);
+
+    CHECK(grid.valueAt(0, 0));
+    CHECK(grid.valueAt(64, 1));
+    CHECK(grid.valueAt(69, 2));
+    CHECK(!grid.valueAt(1, 0));
+    CHECK(!grid.valueAt(64, 0));
+
+    grid.setValueAt(64, 1, false);
+    CHECK(!grid.valueAt(64, 1));
+  }
+
+  SECTION("Out of range access gives default") {
+    CHECK(grid.valueAtWithDefault(70, 0, true));
+    CHECK(!grid.valueAtWithDefault(0, 3, false));
+  }
+
+  SECTION("Rows are word aligned") {
+    grid.setValueAt(65, 1, true);
+
+    const auto words = grid.rowWords(1);
+    REQUIRE(words.size() == 2);
+    CHECK(words[0] == 0);
+    CHECK(words[1] == 0b10);
+  }
+
+  SECTION("Filling a rectangle spanning multiple words") {
+    grid.fill({{60, 1}, {8, 2}}, true);
+
+    for (auto y = 0u; y < grid.height(); ++y) {
+      for (auto x = 0u; x < grid.width(); ++x) {
+        const auto isInside = x >= 60 && x < 68 && y >= 1;
+        REQUIRE(grid.valueAt(x, y) == isInside);
+      }
+    }
+
+    grid.fill({{62, 2}, {2, 1}}, false);
+    CHECK(grid.valueAt(61, 2));
+    CHECK(!grid.valueAt(62, 2));
+    CHECK(!grid.valueAt(63, 2));
+    CHECK(grid.valueAt(64, 2));
+  }
+
+  SECTION("Filling is clipped to the grid") {
+    grid.fill({{-5, -5}, {100, 100}}, true);
+
+    const auto words = grid.rowWords(0);
+    CHECK(words[0] == ~std::uint64_t{0});
+    CHECK(words[1] == 0b111111);
+  }
+
+  SECTION("Combining grids") {
+    Grid<bool> other{70, 3};
+    grid.setValueAt(3, 0, true);
+    grid.setValueAt(66, 2, true);
+    other.setValueAt(66, 2, true);
+    other.setValueAt(10, 1, true);
+
+    auto combined = grid;
+    combined |= other;
+    CHECK(combined.valueAt(3, 0));
+    CHECK(combined.valueAt(66, 2));
+    CHECK(combined.valueAt(10, 1));
+
+    combined = grid;
+    combined &= other;
+    CHECK(!combined.valueAt(3, 0));
+    CHECK(combined.valueAt(66, 2));
+    CHECK(!combined.valueAt(10, 1));
+  }
+}
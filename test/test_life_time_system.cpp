@@ -0,0 +1,268 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/life_time_system.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <optional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+namespace ex = entityx;
+
+using Condition = AutoDestroy::Condition;
+
+
+namespace {
+
+// The life time system's original implementation: Visits all AutoDestroy
+// entities on each update, and counts down their frames to live
+void referenceLifeTimeUpdate(ex::EntityManager& es) {
+  es.each<AutoDestroy>([](
+    ex::Entity entity,
+    AutoDestroy& autoDestroyProperties
+  ) {
+    const auto flags = autoDestroyProperties.mConditionFlags;
+
+    const auto conditionIsSet = [&flags](const Condition condition) {
+      const auto conditionValue = static_cast<int>(condition);
+      return (flags & conditionValue) != 0;
+    };
+
+    const auto hasTimeout = conditionIsSet(Condition::OnTimeoutElapsed);
+    if (hasTimeout) {
+      --autoDestroyProperties.mFramesToLive;
+    }
+
+    const auto mustDestroy =
+      (conditionIsSet(Condition::OnWorldCollision) &&
+        entity.has_component<CollidedWithWorld>()) ||
+      (conditionIsSet(Condition::OnLeavingActiveRegion) &&
+        !entity.has_component<Active>()) ||
+      (hasTimeout && autoDestroyProperties.mFramesToLive < 0);
+
+    if (mustDestroy) {
+      entity.destroy();
+    }
+  });
+}
+
+
+struct EntityState {
+  bool operator==(const EntityState& rhs) const {
+    return
+      std::tie(
+        mId, mConditionFlags, mFramesToLive, mIsActive, mHasCollided) ==
+      std::tie(
+        rhs.mId,
+        rhs.mConditionFlags,
+        rhs.mFramesToLive,
+        rhs.mIsActive,
+        rhs.mHasCollided);
+  }
+
+  std::uint64_t mId;
+  std::optional<int> mConditionFlags;
+  std::optional<int> mFramesToLive;
+  bool mIsActive;
+  bool mHasCollided;
+};
+
+
+std::vector<EntityState> worldState(
+  ex::EntityManager& es,
+  const bool includeFramesToLive
+) {
+  std::vector<EntityState> result;
+  for (auto entity : es.entities_for_debugging()) {
+    auto state = EntityState{
+      entity.id().id(),
+      std::nullopt,
+      std::nullopt,
+      entity.has_component<Active>(),
+      entity.has_component<CollidedWithWorld>()};
+
+    if (entity.has_component<AutoDestroy>()) {
+      const auto& autoDestroy = *entity.component<const AutoDestroy>();
+      state.mConditionFlags = autoDestroy.mConditionFlags;
+      if (
+        includeFramesToLive &&
+        (autoDestroy.mConditionFlags &
+          static_cast<int>(Condition::OnTimeoutElapsed))
+      ) {
+        state.mFramesToLive = autoDestroy.mFramesToLive;
+      }
+    }
+
+    result.push_back(state);
+  }
+
+  return result;
+}
+
+
+std::vector<ex::Entity> allEntities(ex::EntityManager& es) {
+  std::vector<ex::Entity> result;
+  for (auto entity : es.entities_for_debugging()) {
+    result.push_back(entity);
+  }
+
+  return result;
+}
+
+
+/** Makes random modifications to a world
+ *
+ * Stands in for the other systems, which give out AutoDestroy components
+ * and toggle the components that the other conditions depend on. With the
+ * same seed, identical worlds get the same modifications.
+ */
+class RandomModifications {
+public:
+  explicit RandomModifications(const unsigned seed)
+    : mRandomGenerator(seed)
+  {
+  }
+
+  void apply(ex::EntityManager& es) {
+    const auto numNewEntities = pick(4);
+    for (auto i = 0; i < numNewEntities; ++i) {
+      auto entity = es.create();
+      if (pick(4) != 0) {
+        entity.assign<Active>();
+      }
+
+      if (pick(10) == 0) {
+        entity.assign<CollidedWithWorld>();
+      }
+
+      if (pick(4) != 0) {
+        entity.assign<AutoDestroy>(randomAutoDestroy());
+      }
+    }
+
+    auto entities = allEntities(es);
+    if (entities.empty()) {
+      return;
+    }
+
+    const auto numChanges = pick(6);
+    for (auto i = 0; i < numChanges; ++i) {
+      auto entity = entities[pick(static_cast<int>(entities.size()))];
+      if (!entity.valid()) {
+        continue;
+      }
+
+      switch (pick(5)) {
+        case 0:
+          if (entity.has_component<Active>()) {
+            entity.remove<Active>();
+          } else {
+            entity.assign<Active>();
+          }
+          break;
+
+        case 1:
+          if (entity.has_component<CollidedWithWorld>()) {
+            entity.remove<CollidedWithWorld>();
+          } else {
+            entity.assign<CollidedWithWorld>();
+          }
+          break;
+
+        case 2:
+          if (entity.has_component<AutoDestroy>()) {
+            entity.remove<AutoDestroy>();
+          }
+          break;
+
+        case 3:
+          if (entity.has_component<AutoDestroy>()) {
+            entity.remove<AutoDestroy>();
+          }
+          entity.assign<AutoDestroy>(randomAutoDestroy());
+          break;
+
+        case 4:
+          entity.destroy();
+          break;
+      }
+    }
+  }
+
+private:
+  int pick(const int count) {
+    return std::uniform_int_distribution<int>{0, count - 1}(
+      mRandomGenerator);
+  }
+
+  AutoDestroy randomAutoDestroy() {
+    // Some timeouts go around the timer wheel several times
+    auto autoDestroy =
+      AutoDestroy::afterTimeout(pick(10) == 0 ? pick(800) : pick(30) - 2);
+    autoDestroy.mConditionFlags = pick(8);
+    return autoDestroy;
+  }
+
+  std::mt19937 mRandomGenerator;
+};
+
+}
+
+
+TEST_CASE("Life time system matches counting down each entity's timeout") {
+  for (auto seed = 0u; seed < 10u; ++seed) {
+    ex::EntityX referenceWorld;
+    ex::EntityX world;
+    RandomModifications referenceModifications{seed};
+    RandomModifications modifications{seed};
+
+    // Some entities exist before the system is created
+    referenceModifications.apply(referenceWorld.entities);
+    modifications.apply(world.entities);
+
+    LifeTimeSystem lifeTimeSystem{world.entities, world.events};
+
+    for (auto round = 0; round < 400; ++round) {
+      referenceModifications.apply(referenceWorld.entities);
+      modifications.apply(world.entities);
+
+      referenceLifeTimeUpdate(referenceWorld.entities);
+      lifeTimeSystem.update();
+
+      // The remaining frames to live are only written on request
+      const auto includeFramesToLive = round % 50 == 0;
+      if (includeFramesToLive) {
+        lifeTimeSystem.writeRemainingFramesToLive();
+      }
+
+      REQUIRE(
+        worldState(world.entities, includeFramesToLive) ==
+        worldState(referenceWorld.entities, includeFramesToLive));
+    }
+  }
+}
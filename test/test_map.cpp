@@ -0,0 +1,574 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <data/map.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace rigel;
+using namespace data::map;
+
+
+namespace {
+
+constexpr auto NUM_TILE_TYPES = 16;
+
+// Collision bits, plus the bits for conveyor belts, ladders and climbables
+constexpr auto ATTRIBUTE_BITS_USED = std::uint16_t{0x438F};
+
+
+TileAttributeDict makeAttributes(std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> bits{0, 0xFFFF};
+
+  // Tile 0 is always empty
+  std::vector<std::uint16_t> bitPacks{0};
+  for (auto i = 1; i < NUM_TILE_TYPES; ++i) {
+    bitPacks.push_back(
+      static_cast<std::uint16_t>(bits(randomGenerator) & ATTRIBUTE_BITS_USED));
+  }
+
+  return TileAttributeDict{bitPacks};
+}
+
+
+void setRandomTile(Map& map, std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> layer{0, 1};
+  std::uniform_int_distribution<int> x{0, map.width() - 1};
+  std::uniform_int_distribution<int> y{0, map.height() - 1};
+
+  // Empty tiles are more common than any other, so that there are
+  // non-composite tiles on both layers
+  std::uniform_int_distribution<int> tile{-NUM_TILE_TYPES, NUM_TILE_TYPES - 1};
+  map.setTileAt(
+    layer(randomGenerator),
+    x(randomGenerator),
+    y(randomGenerator),
+    static_cast<TileIndex>(std::max(tile(randomGenerator), 0)));
+}
+
+
+Map makeRandomMap(
+  const int width,
+  const int height,
+  std::mt19937& randomGenerator
+) {
+  Map map{width, height, makeAttributes(randomGenerator)};
+  for (auto i = 0; i < width * height; ++i) {
+    setRandomTile(map, randomGenerator);
+  }
+
+  return map;
+}
+
+
+bool isAnyTileSolidReference(
+  const Map& map,
+  const int startX,
+  const int startY,
+  const int endX,
+  const int endY,
+  const SolidEdge edge
+) {
+  for (auto y = startY; y <= endY; ++y) {
+    for (auto x = startX; x <= endX; ++x) {
+      if (map.collisionData(x, y).isSolidOn(edge)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+
+bool hasFeatureReference(
+  const Map& map,
+  const int x,
+  const int y,
+  const TileFeature feature
+) {
+  const auto attributes = map.attributes(x, y);
+  switch (feature) {
+    case TileFeature::ConveyorBeltLeft:
+      return attributes.isConveyorBeltLeft();
+
+    case TileFeature::ConveyorBeltRight:
+      return attributes.isConveyorBeltRight();
+
+    case TileFeature::Ladder:
+      return attributes.isLadder();
+
+    case TileFeature::Climbable:
+      return attributes.isClimbable();
+  }
+
+  return false;
+}
+
+
+std::optional<int> findFeatureInRowReference(
+  const Map& map,
+  const int y,
+  const int startX,
+  const int endX,
+  const TileFeature feature
+) {
+  for (auto x = startX; x <= endX; ++x) {
+    if (hasFeatureReference(map, x, y, feature)) {
+      return x;
+    }
+  }
+
+  return std::nullopt;
+}
+
+
+std::uint16_t combinedAttributesReference(
+  const Map& map,
+  const int y,
+  const int startX,
+  const int endX
+) {
+  auto result = std::uint16_t{0};
+  for (auto x = startX; x <= endX; ++x) {
+    result |= map.attributes(x, y).bitPack();
+  }
+
+  return result;
+}
+
+
+constexpr TileFeature ALL_FEATURES[] = {
+  TileFeature::ConveyorBeltLeft,
+  TileFeature::ConveyorBeltRight,
+  TileFeature::Ladder,
+  TileFeature::Climbable
+};
+
+
+std::vector<TileIndex> allTiles(const Map& map) {
+  std::vector<TileIndex> tiles;
+  for (auto layer = 0; layer < 2; ++layer) {
+    for (auto y = 0; y < map.height(); ++y) {
+      for (auto x = 0; x < map.width(); ++x) {
+        tiles.push_back(map.tileAt(layer, x, y));
+      }
+    }
+  }
+
+  return tiles;
+}
+
+
+/** Compare all span queries against per-tile lookups, for random spans
+ * which may extend past the map's edges
+ */
+void checkSpanQueries(const Map& map, std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> x{-3, map.width() + 2};
+  std::uniform_int_distribution<int> y{-3, map.height() + 2};
+  std::uniform_int_distribution<int> length{0, 140};
+
+  for (auto i = 0; i < 2000; ++i) {
+    const auto row = y(randomGenerator);
+    const auto column = x(randomGenerator);
+    const auto startX = x(randomGenerator);
+    const auto endX = startX + length(randomGenerator) - 1;
+    const auto startY = y(randomGenerator);
+    const auto endY = startY + length(randomGenerator) - 1;
+
+    for (const auto edge : {SolidEdge::top(), SolidEdge::bottom()}) {
+      REQUIRE(
+        map.isAnyTileSolidInRow(row, startX, endX, edge) ==
+        isAnyTileSolidReference(map, startX, row, endX, row, edge));
+    }
+
+    for (const auto edge : {SolidEdge::left(), SolidEdge::right()}) {
+      REQUIRE(
+        map.isAnyTileSolidInColumn(column, startY, endY, edge) ==
+        isAnyTileSolidReference(map, column, startY, column, endY, edge));
+    }
+
+    for (const auto feature : ALL_FEATURES) {
+      REQUIRE(
+        map.hasFeature(column, row, feature) ==
+        hasFeatureReference(map, column, row, feature));
+      REQUIRE(
+        map.findFeatureInRow(row, startX, endX, feature) ==
+        findFeatureInRowReference(map, row, startX, endX, feature));
+    }
+
+    REQUIRE(
+      map.combinedAttributesInRow(row, startX, endX).bitPack() ==
+      combinedAttributesReference(map, row, startX, endX));
+  }
+}
+
+
+void testSpanQueries(const int width) {
+  std::mt19937 randomGenerator{1234};
+  auto map = makeRandomMap(width, 70, randomGenerator);
+
+  SECTION("For the initial map") {
+    checkSpanQueries(map, randomGenerator);
+  }
+
+  SECTION("After modifying tiles") {
+    for (auto i = 0; i < 500; ++i) {
+      setRandomTile(map, randomGenerator);
+    }
+
+    checkSpanQueries(map, randomGenerator);
+  }
+
+  SECTION("After clearing a section") {
+    map.clearSection(5, 5, 30, 20);
+    checkSpanQueries(map, randomGenerator);
+  }
+
+  SECTION("For a modified copy, and the original it was made from") {
+    const auto originalTiles = allTiles(map);
+
+    auto copy = map;
+    for (auto i = 0; i < 500; ++i) {
+      setRandomTile(copy, randomGenerator);
+    }
+
+    checkSpanQueries(copy, randomGenerator);
+    checkSpanQueries(map, randomGenerator);
+    CHECK(allTiles(map) == originalTiles);
+  }
+}
+
+
+/** Copy of a map's tiles, kept up to date via the change journal
+ *
+ * Works like the renderer's copy of the map on the GPU would.
+ */
+class MapMirror {
+public:
+  explicit MapMirror(const Map& map)
+    : mTiles(allTiles(map))
+    , mSyncedRevision(map.changeRevision())
+  {
+  }
+
+  /** Bring the copy up to date. Returns false if a full copy was needed */
+  bool sync(const Map& map) {
+    const auto hadJournal = map.forEachChangeSince(
+      mSyncedRevision,
+      [&](const base::Rect<int>& section) {
+        for (auto layer = 0; layer < 2; ++layer) {
+          map.forEachTileInRect(layer, section,
+            [&](const int x, const int y, const TileIndex tile) {
+              mTiles[layer * map.width() * map.height() + y * map.width() + x] =
+                tile;
+            });
+        }
+      });
+
+    if (!hadJournal) {
+      mTiles = allTiles(map);
+    }
+
+    mSyncedRevision = map.changeRevision();
+    return hadJournal;
+  }
+
+  const std::vector<TileIndex>& tiles() const {
+    return mTiles;
+  }
+
+private:
+  std::vector<TileIndex> mTiles;
+  std::uint32_t mSyncedRevision;
+};
+
+
+void makeRandomChanges(Map& map, std::mt19937& randomGenerator) {
+  std::uniform_int_distribution<int> kind{0, 9};
+  std::uniform_int_distribution<int> count{0, 40};
+
+  switch (kind(randomGenerator)) {
+    case 0:
+      {
+        std::uniform_int_distribution<int> x{0, map.width() - 10};
+        std::uniform_int_distribution<int> y{0, map.height() - 10};
+        std::uniform_int_distribution<int> size{1, 10};
+        map.clearSection(
+          x(randomGenerator),
+          y(randomGenerator),
+          size(randomGenerator),
+          size(randomGenerator));
+      }
+      break;
+
+    case 1:
+      // Enough scattered changes to overflow the journal
+      for (auto i = 0; i < 1000; ++i) {
+        setRandomTile(map, randomGenerator);
+      }
+      break;
+
+    default:
+      for (auto i = count(randomGenerator); i > 0; --i) {
+        setRandomTile(map, randomGenerator);
+      }
+      break;
+  }
+}
+
+}
+
+
+TEST_CASE("Map span queries match per-tile lookups") {
+  // Both a width which isn't a multiple of the bit plane word size and one
+  // which is
+  SECTION("Width not a multiple of 64") {
+    testSpanQueries(150);
+  }
+
+  SECTION("Width a multiple of 64") {
+    testSpanQueries(128);
+  }
+}
+
+
+TEST_CASE("Map change journal covers all modified tiles") {
+  std::mt19937 randomGenerator{5678};
+  auto map = makeRandomMap(100, 60, randomGenerator);
+
+  SECTION("Each modification increments the revision") {
+    const auto initialRevision = map.changeRevision();
+    map.setTileAt(0, 3, 4, 1);
+    map.setTileAt(1, 3, 4, 0);
+    CHECK(map.changeRevision() == initialRevision + 2);
+
+    map.clearSection(10, 10, 3, 2);
+    CHECK(map.changeRevision() == initialRevision + 14);
+  }
+
+  SECTION("Nothing is reported without modifications") {
+    auto numSections = 0;
+    CHECK(map.forEachChangeSince(
+      map.changeRevision(), [&](const base::Rect<int>&) { ++numSections; }));
+    CHECK(numSections == 0);
+  }
+
+  SECTION("Changes are reported again for the same revision") {
+    const auto revision = map.changeRevision();
+    map.setTileAt(0, 20, 30, 5);
+
+    std::vector<base::Rect<int>> first;
+    std::vector<base::Rect<int>> second;
+    map.forEachChangeSince(
+      revision, [&](const base::Rect<int>& rect) { first.push_back(rect); });
+    map.forEachChangeSince(
+      revision, [&](const base::Rect<int>& rect) { second.push_back(rect); });
+
+    REQUIRE(first.size() == 1);
+    CHECK(first == second);
+    CHECK(first[0].containsPoint({20, 30}));
+  }
+
+  SECTION("Changes merged with an already reported one are reported") {
+    MapMirror mirror{map};
+
+    for (auto x = 10; x < 20; ++x) {
+      map.setTileAt(0, x, 5, static_cast<TileIndex>(map.tileAt(0, x, 5) + 1));
+      mirror.sync(map);
+      CHECK(mirror.tiles() == allTiles(map));
+    }
+  }
+
+  SECTION("A journal that is too short is reported") {
+    const auto revision = map.changeRevision();
+
+    // Every other tile in every other row, so that no changes are merged
+    for (auto y = 0; y < map.height(); y += 2) {
+      for (auto x = 0; x < map.width(); x += 2) {
+        map.setTileAt(0, x, y, 1);
+      }
+    }
+
+    auto numSections = 0;
+    CHECK(!map.forEachChangeSince(
+      revision, [&](const base::Rect<int>&) { ++numSections; }));
+    CHECK(numSections == 0);
+  }
+
+  SECTION("Reported sections contain all tiles modified after the revision") {
+    struct Modification {
+      base::Vector mPosition;
+      std::uint32_t mRevision;
+    };
+
+    // Spread out, so that no changes are merged and old journal entries
+    // need to be dropped
+    std::vector<Modification> modifications;
+    for (auto i = 0; i < 600; ++i) {
+      const auto position = base::Vector{(i % 50) * 2, (i / 50) * 2};
+      const auto revision = map.changeRevision();
+      map.setTileAt(1, position.x, position.y, 7);
+      modifications.push_back(Modification{position, revision});
+    }
+
+    auto numRevisionsInJournal = 0;
+    for (const auto& start : modifications) {
+      std::vector<bool> isReported(map.width() * map.height(), false);
+      const auto hadJournal = map.forEachChangeSince(
+        start.mRevision,
+        [&](const base::Rect<int>& section) {
+          map.forEachTileInRect(0, section, [&](int x, int y, TileIndex) {
+            isReported[x + y * map.width()] = true;
+          });
+        });
+
+      if (!hadJournal) {
+        continue;
+      }
+
+      ++numRevisionsInJournal;
+      for (const auto& modification : modifications) {
+        if (modification.mRevision >= start.mRevision) {
+          const auto& pos = modification.mPosition;
+          CHECK(isReported[pos.x + pos.y * map.width()]);
+        }
+      }
+    }
+
+    CHECK(numRevisionsInJournal > 0);
+    CHECK(numRevisionsInJournal < 600);
+  }
+
+  SECTION("Copies that are synced at different rates stay up to date") {
+    std::vector<MapMirror> mirrors(3, MapMirror{map});
+    auto numFullCopies = 0;
+
+    for (auto round = 0; round < 100; ++round) {
+      makeRandomChanges(map, randomGenerator);
+
+      for (auto i = 0; i < 3; ++i) {
+        // The first mirror is synced after each round, the other ones
+        // less often
+        if (round % (i * 3 + 1) == 0) {
+          if (!mirrors[i].sync(map)) {
+            ++numFullCopies;
+          }
+
+          CHECK(mirrors[i].tiles() == allTiles(map));
+        }
+      }
+    }
+
+    // Most syncs should be done via the journal
+    CHECK(numFullCopies > 0);
+    CHECK(numFullCopies < 50);
+  }
+}
+
+
+TEST_CASE("Map restore point") {
+  std::mt19937 randomGenerator{9876};
+  auto map = makeRandomMap(100, 60, randomGenerator);
+  map.setRestorePoint();
+  const auto tilesAtRestorePoint = allTiles(map);
+
+  SECTION("Reverting undoes all modifications") {
+    for (auto i = 0; i < 20; ++i) {
+      makeRandomChanges(map, randomGenerator);
+    }
+    REQUIRE(allTiles(map) != tilesAtRestorePoint);
+
+    map.revertToRestorePoint();
+    CHECK(allTiles(map) == tilesAtRestorePoint);
+    checkSpanQueries(map, randomGenerator);
+  }
+
+  SECTION("The restore point stays in place after reverting") {
+    for (auto round = 0; round < 3; ++round) {
+      for (auto i = 0; i < 5; ++i) {
+        makeRandomChanges(map, randomGenerator);
+      }
+
+      map.revertToRestorePoint();
+      CHECK(allTiles(map) == tilesAtRestorePoint);
+    }
+  }
+
+  SECTION("Setting a new restore point replaces the previous one") {
+    makeRandomChanges(map, randomGenerator);
+    map.setRestorePoint();
+    const auto tilesAtSecondRestorePoint = allTiles(map);
+
+    makeRandomChanges(map, randomGenerator);
+    map.setTileAt(0, 1, 1, 3);
+    map.revertToRestorePoint();
+    CHECK(allTiles(map) == tilesAtSecondRestorePoint);
+  }
+
+  SECTION("Reverted tiles show up in the change journal") {
+    MapMirror mirror{map};
+
+    map.setTileAt(0, 1, 1, 3);
+    map.clearSection(40, 20, 10, 10);
+    mirror.sync(map);
+
+    map.revertToRestorePoint();
+    CHECK(mirror.sync(map));
+    CHECK(mirror.tiles() == tilesAtRestorePoint);
+  }
+
+  SECTION("Restoring from a copy") {
+    for (auto i = 0; i < 5; ++i) {
+      makeRandomChanges(map, randomGenerator);
+    }
+
+    const auto copy = map;
+    const auto tilesOfCopy = allTiles(copy);
+    MapMirror mirror{map};
+
+    for (auto i = 0; i < 5; ++i) {
+      makeRandomChanges(map, randomGenerator);
+    }
+
+    map.restoreTilesFrom(copy);
+    CHECK(allTiles(map) == tilesOfCopy);
+    checkSpanQueries(map, randomGenerator);
+
+    mirror.sync(map);
+    CHECK(mirror.tiles() == tilesOfCopy);
+
+    // Modifying the map afterwards leaves the copy alone, and the copy's
+    // restore point is taken over
+    for (auto i = 0; i < 5; ++i) {
+      makeRandomChanges(map, randomGenerator);
+    }
+    CHECK(allTiles(copy) == tilesOfCopy);
+
+    map.revertToRestorePoint();
+    CHECK(allTiles(map) == tilesAtRestorePoint);
+    checkSpanQueries(map, randomGenerator);
+  }
+}
@@ -0,0 +1,463 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <loader/msgpack.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+#include <nlohmann/json.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+using namespace rigel;
+using namespace loader;
+
+using json = nlohmann::json;
+
+
+namespace {
+
+using Limits64 = std::numeric_limits<std::int64_t>;
+
+
+struct IntEncoding {
+  std::int64_t mValue;
+  std::uint8_t mExpectedMarker;
+  std::size_t mExpectedSize;
+};
+
+
+// Values on both sides of each boundary between encodings
+const IntEncoding INT_ENCODINGS[] = {
+  {0, 0x00, 1},
+  {127, 0x7F, 1},
+  {128, 0xCC, 2},
+  {255, 0xCC, 2},
+  {256, 0xCD, 3},
+  {65535, 0xCD, 3},
+  {65536, 0xCE, 5},
+  {4294967295, 0xCE, 5},
+  {4294967296, 0xCF, 9},
+  {Limits64::max(), 0xCF, 9},
+  {-1, 0xFF, 1},
+  {-32, 0xE0, 1},
+  {-33, 0xD0, 2},
+  {-128, 0xD0, 2},
+  {-129, 0xD1, 3},
+  {-32768, 0xD1, 3},
+  {-32769, 0xD2, 5},
+  {-2147483648LL, 0xD2, 5},
+  {-2147483649LL, 0xD3, 9},
+  {Limits64::min(), 0xD3, 9},
+};
+
+
+// Sizes on both sides of each boundary between string/array/map encodings
+const std::size_t STRING_SIZES[] = {0, 31, 32, 255, 256, 65535, 65536};
+const std::size_t CONTAINER_SIZES[] = {0, 15, 16, 65535, 65536};
+
+
+std::string makeKey(const std::size_t index) {
+  // Zero padded, so that nlohmann::json's sorting by key keeps the order
+  auto key = std::to_string(index);
+  return std::string(6 - key.size(), '0') + key;
+}
+
+
+/** Writes a document with nested containers of all kinds
+ *
+ * Map keys are in alphabetical order, like in nlohmann::json.
+ */
+ByteBuffer writeNestedDocument() {
+  MsgPackWriter writer;
+  writer.beginMap(3);
+  writer.writeString("a");
+  writer.beginArray(3);
+  writer.writeInt(-200);
+  writer.writeNil();
+  writer.beginMap(1);
+  writer.writeString("inner");
+  writer.beginArray(2);
+  writer.writeBool(true);
+  writer.writeString(std::string(40, 'x'));
+  writer.writeString("b");
+  writer.beginMap(0);
+  writer.writeString("c");
+  writer.writeInt(70000);
+  return writer.takeBuffer();
+}
+
+
+json nestedDocument() {
+  return json{
+    {"a",
+     json::array(
+       {-200, nullptr, {{"inner", {true, std::string(40, 'x')}}}})},
+    {"b", json::object()},
+    {"c", 70000}};
+}
+
+
+ByteBuffer concat(ByteBuffer first, const ByteBuffer& second) {
+  first.insert(first.end(), second.begin(), second.end());
+  return first;
+}
+
+}
+
+
+TEST_CASE("MsgPackWriter uses the same encodings as nlohmann::json") {
+  SECTION("Integers") {
+    for (const auto& encoding : INT_ENCODINGS) {
+      MsgPackWriter writer;
+      writer.writeInt(encoding.mValue);
+      const auto buffer = writer.takeBuffer();
+
+      INFO(encoding.mValue);
+      CHECK(buffer == json::to_msgpack(json(encoding.mValue)));
+      REQUIRE(buffer.size() == encoding.mExpectedSize);
+      CHECK(buffer[0] == encoding.mExpectedMarker);
+    }
+  }
+
+  SECTION("Nil and booleans") {
+    MsgPackWriter writer;
+    writer.beginArray(3);
+    writer.writeNil();
+    writer.writeBool(false);
+    writer.writeBool(true);
+    const auto expected = ByteBuffer{0x93, 0xC0, 0xC2, 0xC3};
+    CHECK(writer.takeBuffer() == expected);
+  }
+
+  SECTION("Strings") {
+    for (const auto size : STRING_SIZES) {
+      const auto value = std::string(size, 'x');
+
+      MsgPackWriter writer;
+      writer.writeString(value);
+
+      INFO(size);
+      CHECK(writer.takeBuffer() == json::to_msgpack(json(value)));
+    }
+  }
+
+  SECTION("Arrays") {
+    for (const auto size : CONTAINER_SIZES) {
+      MsgPackWriter writer;
+      writer.beginArray(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        writer.writeNil();
+      }
+
+      INFO(size);
+      CHECK(
+        writer.takeBuffer() ==
+        json::to_msgpack(json(std::vector<std::nullptr_t>(size, nullptr))));
+    }
+  }
+
+  SECTION("Maps") {
+    for (const auto size : CONTAINER_SIZES) {
+      MsgPackWriter writer;
+      auto expected = json::object();
+
+      writer.beginMap(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        writer.writeString(makeKey(i));
+        writer.writeInt(static_cast<std::int64_t>(i));
+        expected[makeKey(i)] = i;
+      }
+
+      INFO(size);
+      CHECK(writer.takeBuffer() == json::to_msgpack(expected));
+    }
+  }
+
+  SECTION("Nested containers") {
+    CHECK(writeNestedDocument() == json::to_msgpack(nestedDocument()));
+  }
+}
+
+
+TEST_CASE("MsgPackReader reads what MsgPackWriter wrote") {
+  SECTION("Integers") {
+    MsgPackWriter writer;
+    for (const auto& encoding : INT_ENCODINGS) {
+      writer.writeInt(encoding.mValue);
+    }
+
+    const auto buffer = writer.takeBuffer();
+    MsgPackReader reader{buffer};
+    for (const auto& encoding : INT_ENCODINGS) {
+      REQUIRE(reader.peekType() == MsgPackReader::Type::Integer);
+      CHECK(reader.readInt() == encoding.mValue);
+    }
+
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("Nil and booleans") {
+    MsgPackWriter writer;
+    writer.writeNil();
+    writer.writeBool(false);
+    writer.writeBool(true);
+
+    const auto buffer = writer.takeBuffer();
+    MsgPackReader reader{buffer};
+    CHECK(reader.peekType() == MsgPackReader::Type::Nil);
+    reader.readNil();
+    CHECK(reader.peekType() == MsgPackReader::Type::Bool);
+    CHECK(reader.readBool() == false);
+    CHECK(reader.readBool() == true);
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("Strings") {
+    MsgPackWriter writer;
+    for (const auto size : STRING_SIZES) {
+      writer.writeString(std::string(size, 'x'));
+    }
+
+    const auto buffer = writer.takeBuffer();
+    MsgPackReader reader{buffer};
+    for (const auto size : STRING_SIZES) {
+      REQUIRE(reader.peekType() == MsgPackReader::Type::String);
+      CHECK(reader.readString() == std::string(size, 'x'));
+    }
+
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("Arrays and maps") {
+    MsgPackWriter writer;
+    for (const auto size : CONTAINER_SIZES) {
+      writer.beginArray(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        writer.writeInt(static_cast<std::int64_t>(i));
+      }
+
+      writer.beginMap(size);
+      for (std::size_t i = 0; i < size; ++i) {
+        writer.writeString(makeKey(i));
+        writer.writeNil();
+      }
+    }
+
+    const auto buffer = writer.takeBuffer();
+    MsgPackReader reader{buffer};
+    for (const auto size : CONTAINER_SIZES) {
+      REQUIRE(reader.peekType() == MsgPackReader::Type::Array);
+      REQUIRE(reader.readArraySize() == size);
+      for (std::size_t i = 0; i < size; ++i) {
+        REQUIRE(reader.readInt() == static_cast<std::int64_t>(i));
+      }
+
+      REQUIRE(reader.peekType() == MsgPackReader::Type::Map);
+      REQUIRE(reader.readMapSize() == size);
+      for (std::size_t i = 0; i < size; ++i) {
+        REQUIRE(reader.readString() == makeKey(i));
+        reader.readNil();
+      }
+    }
+
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("Nested containers") {
+    const auto buffer = writeNestedDocument();
+    CHECK(json::from_msgpack(buffer) == nestedDocument());
+
+    MsgPackReader reader{buffer};
+    REQUIRE(reader.readMapSize() == 3);
+    CHECK(reader.readString() == "a");
+    REQUIRE(reader.readArraySize() == 3);
+    CHECK(reader.readInt() == -200);
+    reader.readNil();
+    REQUIRE(reader.readMapSize() == 1);
+    CHECK(reader.readString() == "inner");
+    REQUIRE(reader.readArraySize() == 2);
+    CHECK(reader.readBool() == true);
+    CHECK(reader.readString() == std::string(40, 'x'));
+    CHECK(reader.readString() == "b");
+    CHECK(reader.readMapSize() == 0);
+    CHECK(reader.readString() == "c");
+    CHECK(reader.readInt() == 70000);
+    CHECK(!reader.hasData());
+  }
+}
+
+
+TEST_CASE("MsgPackReader converts floats and booleans to integers") {
+  SECTION("64 bit floats are truncated") {
+    const auto buffer = concat(
+      json::to_msgpack(json(2.75)), json::to_msgpack(json(-2.75)));
+    REQUIRE(buffer[0] == 0xCB);
+
+    MsgPackReader reader{buffer};
+    CHECK(reader.peekType() == MsgPackReader::Type::Float);
+    CHECK(reader.readInt() == 2);
+    CHECK(reader.readInt() == -2);
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("32 bit floats are truncated") {
+    // 2.75f and -100.5f
+    const auto buffer = ByteBuffer{
+      0xCA, 0x40, 0x30, 0x00, 0x00,
+      0xCA, 0xC2, 0xC9, 0x00, 0x00};
+
+    MsgPackReader reader{buffer};
+    CHECK(reader.peekType() == MsgPackReader::Type::Float);
+    CHECK(reader.readInt() == 2);
+    CHECK(reader.readInt() == -100);
+    CHECK(!reader.hasData());
+  }
+
+  SECTION("Booleans") {
+    const auto buffer = ByteBuffer{0xC2, 0xC3};
+
+    MsgPackReader reader{buffer};
+    CHECK(reader.readInt() == 0);
+    CHECK(reader.readInt() == 1);
+  }
+
+  SECTION("Other types are rejected") {
+    const auto buffer = json::to_msgpack(json("12"));
+
+    MsgPackReader reader{buffer};
+    CHECK_THROWS(reader.readInt());
+  }
+}
+
+
+TEST_CASE("MsgPackReader skips values") {
+  // Each value is followed by the integer 42, to check that skipping stops
+  // at the right place
+  auto checkSkipsValue = [](const ByteBuffer& value) {
+    const auto buffer = concat(value, ByteBuffer{42});
+
+    MsgPackReader reader{buffer};
+    reader.skipValue();
+    CHECK(reader.readInt() == 42);
+    CHECK(!reader.hasData());
+  };
+
+  SECTION("Scalars and strings") {
+    for (const auto& encoding : INT_ENCODINGS) {
+      checkSkipsValue(json::to_msgpack(json(encoding.mValue)));
+    }
+
+    for (const auto size : STRING_SIZES) {
+      checkSkipsValue(json::to_msgpack(json(std::string(size, 'x'))));
+    }
+
+    checkSkipsValue(json::to_msgpack(json(nullptr)));
+    checkSkipsValue(json::to_msgpack(json(true)));
+    checkSkipsValue(json::to_msgpack(json(2.75)));
+    checkSkipsValue(ByteBuffer{0xCA, 0x40, 0x30, 0x00, 0x00});
+  }
+
+  SECTION("Nested arrays and maps") {
+    checkSkipsValue(writeNestedDocument());
+    checkSkipsValue(json::to_msgpack(json{
+      {"x", {{"y", {{"z", json::array({1, json::array({2, 3})})}}}}},
+      {"list", std::vector<int>(20, 7)}}));
+  }
+
+  SECTION("Binary values") {
+    checkSkipsValue(ByteBuffer{0xC4, 0x00});
+    checkSkipsValue(ByteBuffer{0xC4, 0x03, 0x2A, 0x2A, 0x2A});
+    checkSkipsValue(ByteBuffer{0xC5, 0x00, 0x02, 0xC0, 0xC0});
+    checkSkipsValue(ByteBuffer{0xC6, 0x00, 0x00, 0x00, 0x01, 0x93});
+  }
+
+  SECTION("Extension values") {
+    // fixext 1, 2, 4, 8 and 16: marker, type, data
+    for (std::uint8_t i = 0; i < 5; ++i) {
+      auto value = ByteBuffer{static_cast<std::uint8_t>(0xD4 + i), 0x05};
+      value.resize(value.size() + (std::size_t{1} << i), 0xC1);
+      checkSkipsValue(value);
+    }
+
+    // ext 8, 16 and 32: marker, size, type, data
+    checkSkipsValue(ByteBuffer{0xC7, 0x02, 0x05, 0xC1, 0xC1});
+    checkSkipsValue(ByteBuffer{0xC8, 0x00, 0x01, 0x05, 0xC1});
+    checkSkipsValue(ByteBuffer{0xC9, 0x00, 0x00, 0x00, 0x00, 0x05});
+  }
+
+  SECTION("Binary and extension values nested in a map") {
+    checkSkipsValue(ByteBuffer{
+      0x82,
+      0xA1, 'b', 0xC4, 0x02, 0x92, 0xC0,
+      0xA1, 'e', 0x91, 0xD5, 0x01, 0x81, 0xC0});
+  }
+}
+
+
+TEST_CASE("MsgPackReader throws on truncated data") {
+  SECTION("Empty buffer") {
+    const auto buffer = ByteBuffer{};
+
+    MsgPackReader reader{buffer};
+    CHECK(!reader.hasData());
+    CHECK_THROWS(reader.peekType());
+    CHECK_THROWS(reader.readInt());
+    CHECK_THROWS(reader.skipValue());
+  }
+
+  SECTION("Reading a truncated value") {
+    auto checkThrows = [](const ByteBuffer& buffer, auto read) {
+      MsgPackReader reader{buffer};
+      CHECK_THROWS(read(reader));
+    };
+
+    checkThrows(ByteBuffer{0xCD, 0x01}, [](auto& r) { r.readInt(); });
+    checkThrows(ByteBuffer{0xD3, 0x80, 0x00}, [](auto& r) { r.readInt(); });
+    checkThrows(ByteBuffer{0xCB, 0x40, 0x06}, [](auto& r) { r.readInt(); });
+    checkThrows(ByteBuffer{0xA5, 'a', 'b'}, [](auto& r) { r.readString(); });
+    checkThrows(ByteBuffer{0xD9}, [](auto& r) { r.readString(); });
+    checkThrows(ByteBuffer{0xDA, 0x01, 'a'}, [](auto& r) { r.readString(); });
+    checkThrows(ByteBuffer{0xDC, 0x00}, [](auto& r) { r.readArraySize(); });
+    checkThrows(ByteBuffer{0xDF, 0x00}, [](auto& r) { r.readMapSize(); });
+  }
+
+  SECTION("Skipping any prefix of a complete document") {
+    // An array holding the nested document, a bin 16 and an ext 16 value
+    const auto wrapped = concat(
+      concat(ByteBuffer{0x93}, writeNestedDocument()),
+      ByteBuffer{0xC5, 0x00, 0x02, 0xC0, 0xC0, 0xC8, 0x00, 0x01, 0x05, 0xC1});
+
+    for (std::size_t size = 0; size < wrapped.size(); ++size) {
+      const auto prefix = ByteBuffer(wrapped.begin(), wrapped.begin() + size);
+
+      INFO(size);
+      MsgPackReader reader{prefix};
+      CHECK_THROWS(reader.skipValue());
+    }
+
+    MsgPackReader reader{wrapped};
+    reader.skipValue();
+    CHECK(!reader.hasData());
+  }
+}
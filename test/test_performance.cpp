@@ -0,0 +1,202 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <catch.hpp>
+#include "utils.hpp"
+
+#include <data/map.hpp>
+#include <data/player_model.hpp>
+#include <engine/allocation_tracker.hpp>
+#include <engine/base_components.hpp>
+#include <engine/collision_checker.hpp>
+#include <engine/physical_components.hpp>
+#include <engine/physics_system.hpp>
+#include <game_logic/damage_components.hpp>
+#include <game_logic/damage_infliction_system.hpp>
+
+#include <cstdint>
+#include <optional>
+
+
+// Performance tests run fixed workloads and check how much work was done,
+// in terms of counted operations instead of time, so that the results don't
+// depend on the machine. They are hidden by default, run them by passing
+// [performance] to the test executable.
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+using namespace game_logic;
+using namespace game_logic::components;
+
+namespace ex = entityx;
+
+
+namespace {
+
+/** Counts allocations made by the calling thread during the given function
+ *
+ * Returns nothing unless allocation tracking is enabled in the build.
+ */
+template <typename Func>
+std::optional<std::uint64_t> countAllocations(Func&& func) {
+  namespace tracking = allocation_tracking;
+
+  const auto before = tracking::threadCounters();
+  func();
+  const auto after = tracking::threadCounters();
+
+  if (!tracking::isEnabledInBuild()) {
+    return std::nullopt;
+  }
+
+  return (after - before).mNumAllocations;
+}
+
+}
+
+
+TEST_CASE("Physics system workload", "[.][performance]") {
+  constexpr auto NUM_MOVING_BODIES = 256;
+  constexpr auto NUM_SOLID_BODIES = 256;
+  constexpr auto NUM_WARM_UP_UPDATES = 10;
+  constexpr auto NUM_UPDATES = 120;
+
+  // Solid body tests only look at bodies in nearby grid cells. Looking at
+  // every solid body instead would be NUM_SOLID_BODIES per test.
+  constexpr auto MAX_AVG_SOLID_BODIES_PER_TEST = 32;
+  constexpr auto MAX_AVG_TESTS_PER_BODY_UPDATE = 16;
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  data::map::Map map{256, 128, data::map::TileAttributeDict{{0x0, 0xF}}};
+
+  // Floor
+  for (int x = 0; x < map.width(); ++x) {
+    map.setTileAt(0, x, 120, 1);
+  }
+
+  // Platforms spread across the map, in rows which are further apart than
+  // a grid cell
+  for (int i = 0; i < NUM_SOLID_BODIES; ++i) {
+    auto platform = entities.create();
+    platform.assign<WorldPosition>((i % 64) * 4, 20 + (i / 64) * 24);
+    platform.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 1}});
+    platform.assign<SolidBody>();
+  }
+
+  CollisionChecker collisionChecker{&map, entities, entityx.events};
+  PhysicsSystem physicsSystem{&collisionChecker, &map, &entityx.events};
+
+  for (int i = 0; i < NUM_MOVING_BODIES; ++i) {
+    auto body = entities.create();
+    body.assign<WorldPosition>((i * 7) % 250, 2 + (i % 8) * 12);
+    body.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 2}});
+    body.assign<MovingBody>(MovingBody{{(i % 3) - 1.0f, 0.0f}, true});
+    body.assign<Active>();
+  }
+
+  for (int i = 0; i < NUM_WARM_UP_UPDATES; ++i) {
+    physicsSystem.update(entities);
+  }
+
+  const auto statsBefore = collisionChecker.statistics();
+  const auto numAllocations = countAllocations([&]() {
+    for (int i = 0; i < NUM_UPDATES; ++i) {
+      physicsSystem.update(entities);
+    }
+  });
+  const auto& statsAfter = collisionChecker.statistics();
+
+  const auto numTests =
+    statsAfter.mNumSolidBodyTests - statsBefore.mNumSolidBodyTests;
+  const auto numBodiesVisited =
+    statsAfter.mNumSolidBodiesVisited - statsBefore.mNumSolidBodiesVisited;
+
+  CHECK(numTests > 0);
+  CHECK(
+    numTests <=
+    std::uint64_t{NUM_MOVING_BODIES} * NUM_UPDATES *
+      MAX_AVG_TESTS_PER_BODY_UPDATE);
+  CHECK(numBodiesVisited <= numTests * MAX_AVG_SOLID_BODIES_PER_TEST);
+
+  if (numAllocations) {
+    // Once up and running, updates shouldn't need to allocate
+    CHECK(*numAllocations <= std::uint64_t{NUM_UPDATES});
+  }
+}
+
+
+TEST_CASE("Damage infliction workload", "[.][performance]") {
+  constexpr auto NUM_SHOOTABLES = 512;
+  constexpr auto NUM_ROUNDS = 16;
+
+  // Shootables are indexed by their left edge, so each projectile should
+  // only look at the few which are close to it. Looking at all of them
+  // instead would be NUM_SHOOTABLES per projectile.
+  constexpr auto MAX_AVG_SHOOTABLES_PER_INFLICTOR = 4;
+
+  ex::EntityX entityx;
+  auto& entities = entityx.entities;
+
+  data::PlayerModel playerModel;
+  MockServiceProvider mockServiceProvider;
+  DamageInflictionSystem damageInflictionSystem{
+    &playerModel, &mockServiceProvider, &entityx.events};
+
+  for (int i = 0; i < NUM_SHOOTABLES; ++i) {
+    auto shootable = entities.create();
+    shootable.assign<WorldPosition>(i * 4, 10);
+    shootable.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 2}});
+    shootable.assign<Shootable>(Shootable{1'000'000});
+    shootable.assign<Active>();
+  }
+
+  auto hitCount = 0;
+  for (int round = 0; round < NUM_ROUNDS; ++round) {
+    // One projectile next to each shootable: every other one hits it, the
+    // others are in the gap between two shootables
+    for (int i = 0; i < NUM_SHOOTABLES * 2; ++i) {
+      auto projectile = entities.create();
+      projectile.assign<WorldPosition>(i * 2, 9);
+      projectile.assign<BoundingBox>(BoundingBox{{0, 0}, {1, 1}});
+      projectile.assign<DamageInflicting>(DamageInflicting{1, true});
+    }
+
+    damageInflictionSystem.update(entities);
+
+    entities.each<DamageInflicting>([&](ex::Entity entity, DamageInflicting&) {
+      entity.destroy();
+    });
+
+    hitCount += NUM_SHOOTABLES;
+  }
+
+  auto totalDamage = 0;
+  entities.each<Shootable>([&](ex::Entity, const Shootable& shootable) {
+    totalDamage += 1'000'000 - shootable.mHealth;
+  });
+  CHECK(totalDamage == hitCount);
+
+  const auto& stats = damageInflictionSystem.statistics();
+  CHECK(stats.mNumInflictors == std::uint64_t{NUM_SHOOTABLES} * 2 * NUM_ROUNDS);
+  CHECK(stats.mNumIndexRebuilds == std::uint64_t{NUM_ROUNDS});
+  CHECK(
+    stats.mNumShootablesVisited <=
+    stats.mNumInflictors * MAX_AVG_SHOOTABLES_PER_INFLICTOR);
+}
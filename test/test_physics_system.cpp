@@ -19,6 +19,7 @@
 
 #include <data/map.hpp>
 #include <engine/collision_checker.hpp>
+#include <engine/entity_tools.hpp>
 #include <engine/physical_components.hpp>
 #include <engine/physics_system.hpp>
 #include <engine/timing.hpp>
@@ -195,6 +196,7 @@ TEST_CASE("Physics system works as expected") {
       solidBody.component<BoundingBox>()->topLeft.y = 3;
       solidBody.component<BoundingBox>()->size.height = 6;
       *solidBody.component<WorldPosition>() = {7,96};
+      entityx.events.emit(events::SolidBodyChanged{solidBody});
 
       runOneFrame();
       CHECK(position.y == 90);
@@ -221,6 +223,28 @@ TEST_CASE("Physics system works as expected") {
       CHECK(position.y == 7);
     }
 
+    SECTION("Solid bodies are dropped when clearing all entities") {
+      clearAllEntities(entities, entityx.events);
+
+      auto newObject = entities.create();
+      newObject.assign<BoundingBox>(BoundingBox{{0, 0}, {2, 2}});
+      newObject.assign<MovingBody>(MovingBody{{0.0f, 2.0f}, false});
+      newObject.assign<WorldPosition>(WorldPosition{0, 4});
+      newObject.assign<Active>();
+      auto& newPosition = *newObject.component<WorldPosition>();
+
+      runOneFrame();
+      CHECK(newPosition.y == 6);
+
+      auto newSolidBody = entities.create();
+      newSolidBody.assign<BoundingBox>(BoundingBox{{0, 0}, {4, 3}});
+      newSolidBody.assign<WorldPosition>(0, 10);
+      newSolidBody.assign<SolidBody>();
+
+      runOneFrame();
+      CHECK(newPosition.y == 7);
+    }
+
     SECTION("Upward") {
       position.y = 11;
       body.mVelocity.y = -2.0f;
@@ -251,6 +275,7 @@ TEST_CASE("Physics system works as expected") {
 
     SECTION("Right") {
       solidBody.component<WorldPosition>()->x = 3;
+      entityx.events.emit(events::SolidBodyChanged{solidBody});
       position.x = 0;
       position.y = 8;
       body.mVelocity.x = 2.0f;
@@ -264,6 +289,24 @@ TEST_CASE("Physics system works as expected") {
       CHECK(position.x == 1);
     }
 
+    SECTION("Collision detection can be disabled") {
+      solidBody.component<WorldPosition>()->x = 3;
+      entityx.events.emit(events::SolidBodyChanged{solidBody});
+      position.x = 0;
+      position.y = 8;
+      body.mVelocity.x = 2.0f;
+      body.mGravityAffected = false;
+      body.mDetectCollisions = false;
+
+      runOneFrame();
+      CHECK(position.x == 2);
+      CHECK(body.mVelocity.x == 2.0f);
+      CHECK(!physicalObject.has_component<CollidedWithWorld>());
+
+      runOneFrame();
+      CHECK(position.x == 4);
+    }
+
     SECTION("SolidBody doesn't collide with itself") {
       solidBody.assign<MovingBody>(base::Point<float>{0, 2.0f}, false);
       solidBody.assign<Active>();
@@ -0,0 +1,119 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/random_number_generator.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <stdexcept>
+#include <vector>
+
+using namespace rigel;
+using namespace engine;
+
+
+namespace {
+
+std::vector<int> generateNumbers(RandomNumberGenerator& generator) {
+  std::vector<int> numbers;
+  for (auto i = std::size_t{0}; i < RANDOM_NUMBER_TABLE.size(); ++i) {
+    numbers.push_back(generator.gen());
+  }
+
+  return numbers;
+}
+
+}
+
+
+TEST_CASE("Default random number generator") {
+  RandomNumberGenerator generator;
+
+  SECTION("Produces the random number table in order, like the original") {
+    // The original game starts at the table's second entry
+    for (auto i = std::size_t{1}; i < RANDOM_NUMBER_TABLE.size(); ++i) {
+      REQUIRE(generator.gen() == RANDOM_NUMBER_TABLE[i]);
+    }
+
+    for (auto i = std::size_t{0}; i < RANDOM_NUMBER_TABLE.size(); ++i) {
+      REQUIRE(generator.gen() == RANDOM_NUMBER_TABLE[i]);
+    }
+  }
+
+  SECTION("Restoring the state repeats the sequence") {
+    generator.gen();
+    generator.gen();
+    const auto state = generator.state();
+    const auto expected = generateNumbers(generator);
+
+    generator.setState(state);
+    CHECK(generateNumbers(generator) == expected);
+  }
+}
+
+
+TEST_CASE("Random number streams") {
+  SECTION("Streams with the same seed and ID produce the same numbers") {
+    auto first = RandomNumberGenerator::stream(42, 7);
+    auto second = RandomNumberGenerator::stream(42, 7);
+
+    CHECK(generateNumbers(first) == generateNumbers(second));
+  }
+
+  SECTION("Streams with different IDs produce different numbers") {
+    std::vector<std::vector<int>> sequences;
+    for (auto id = 0u; id < RandomNumberGenerator::NUM_STREAMS; ++id) {
+      auto stream = RandomNumberGenerator::stream(42, id);
+      sequences.push_back(generateNumbers(stream));
+    }
+
+    for (auto i = std::size_t{0}; i < sequences.size(); ++i) {
+      for (auto j = i + 1; j < sequences.size(); ++j) {
+        REQUIRE(sequences[i] != sequences[j]);
+      }
+    }
+  }
+
+  SECTION("Streams with different seeds produce different numbers") {
+    auto first = RandomNumberGenerator::stream(1, 3);
+    auto second = RandomNumberGenerator::stream(2, 3);
+
+    CHECK(generateNumbers(first) != generateNumbers(second));
+  }
+
+  SECTION("Streams don't affect the default generator") {
+    RandomNumberGenerator generator;
+    auto stream = RandomNumberGenerator::stream(42, 0);
+    stream.gen();
+
+    CHECK(generator.gen() == RANDOM_NUMBER_TABLE[1]);
+  }
+
+  SECTION("Stream IDs must be less than NUM_STREAMS") {
+    const auto lastId = RandomNumberGenerator::NUM_STREAMS - 1;
+    CHECK_NOTHROW(RandomNumberGenerator::stream(1, lastId));
+    CHECK_THROWS_AS(
+      RandomNumberGenerator::stream(1, lastId + 1),
+      const std::invalid_argument&);
+    CHECK_THROWS_AS(
+      RandomNumberGenerator::stream(1, 0xFFFFFFFFu),
+      const std::invalid_argument&);
+  }
+}
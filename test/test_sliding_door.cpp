@@ -0,0 +1,521 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <data/map.hpp>
+#include <engine/base_components.hpp>
+#include <engine/collision_checker.hpp>
+#include <engine/entity_tools.hpp>
+#include <engine/physical_components.hpp>
+#include <game_logic/interactive/sliding_door.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include "utils.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine::components;
+using game_logic::ai::SlidingDoorSystem;
+using game_logic::ai::components::HorizontalSlidingDoor;
+using game_logic::ai::components::VerticalSlidingDoor;
+
+namespace ex = entityx;
+
+
+namespace {
+
+const auto HORIZONTAL_DOOR_RANGE = base::Rect<int>{{-2, -2}, {8, 9}};
+const auto VERTICAL_DOOR_RANGE = base::Rect<int>{{-8, -6}, {15, 7}};
+
+
+struct SoundCountingServiceProvider : public MockServiceProvider {
+  void playSound(const data::SoundId id) override {
+    MockServiceProvider::playSound(id);
+    ++mNumSoundsPlayed;
+  }
+
+  int mNumSoundsPlayed = 0;
+};
+
+
+/** The sliding door system's original implementation
+ *
+ * Runs each door's state machine on every update, no matter where the
+ * player is.
+ */
+class ReferenceSlidingDoorSystem {
+public:
+  ReferenceSlidingDoorSystem(
+    ex::Entity playerEntity,
+    IGameServiceProvider* pServiceProvider
+  )
+    : mPlayerEntity(playerEntity)
+    , mpServiceProvider(pServiceProvider)
+  {
+  }
+
+  void update(ex::EntityManager& es) {
+    const auto& playerPosition = *mPlayerEntity.component<WorldPosition>();
+
+    es.each<WorldPosition, BoundingBox, Sprite, HorizontalSlidingDoor>(
+      [&](
+        ex::Entity,
+        const WorldPosition& position,
+        BoundingBox& boundingBox,
+        Sprite& sprite,
+        HorizontalSlidingDoor& state
+      ) {
+        using State = HorizontalSlidingDoor::State;
+
+        if (!state.mCollisionHelper) {
+          auto collisionHelper = es.create();
+          collisionHelper.assign<BoundingBox>(BoundingBox{{}, {1, 1}});
+          collisionHelper.assign<WorldPosition>(position);
+          collisionHelper.assign<Active>();
+          collisionHelper.assign<SolidBody>();
+          state.mCollisionHelper = collisionHelper;
+        }
+
+        const auto inRange =
+          (HORIZONTAL_DOOR_RANGE + position).containsPoint(playerPosition);
+        const auto previousState = state.mState;
+        switch (previousState) {
+          case State::Closed:
+            if (inRange) {
+              state.mState = State::HalfOpen;
+            }
+            break;
+
+          case State::HalfOpen:
+            state.mState = inRange ? State::Open : State::Closed;
+            break;
+
+          case State::Open:
+            if (!inRange) {
+              state.mState = State::HalfOpen;
+            }
+            break;
+        }
+
+        if (state.mState == State::Closed) {
+          boundingBox.topLeft.x = 0;
+          boundingBox.size.width = 6;
+        } else {
+          boundingBox.topLeft.x = 5;
+          boundingBox.size.width = 1;
+        }
+
+        const auto missingLeftEdgeCollision =
+          previousState == State::Closed && state.mState == State::HalfOpen;
+        engine::setTag<SolidBody>(
+          state.mCollisionHelper, !missingLeftEdgeCollision);
+
+        sprite.mFramesToRender[0] = static_cast<int>(state.mState);
+        updateSoundGeneration(inRange, state);
+      });
+
+    es.each<WorldPosition, BoundingBox, VerticalSlidingDoor>(
+      [&](
+        ex::Entity,
+        const WorldPosition& position,
+        BoundingBox& boundingBox,
+        VerticalSlidingDoor& state
+      ) {
+        using State = VerticalSlidingDoor::State;
+
+        const auto inRange =
+          (VERTICAL_DOOR_RANGE + position).containsPoint(playerPosition);
+        switch (state.mState) {
+          case State::Closed:
+            if (inRange) {
+              state.mState = State::Opening;
+            }
+            break;
+
+          case State::Opening:
+            if (!inRange) {
+              state.mState = State::Closing;
+            } else if (state.mSlideStep >= 7) {
+              state.mState = State::Open;
+            }
+            break;
+
+          case State::Closing:
+            if (inRange) {
+              state.mState = State::Opening;
+            } else if (state.mSlideStep <= 0) {
+              state.mState = State::Closed;
+            }
+            break;
+
+          case State::Open:
+            if (!inRange) {
+              state.mState = State::Closing;
+            }
+            break;
+        }
+
+        const auto stepChange = state.mState == State::Opening ? 1
+          : state.mState == State::Closing ? -1
+          : 0;
+        state.mSlideStep = std::clamp(state.mSlideStep + stepChange, 0, 7);
+
+        if (state.mState == State::Closed) {
+          boundingBox.topLeft.y = 0;
+          boundingBox.size.height = 8;
+        } else {
+          boundingBox.topLeft.y = -7;
+          boundingBox.size.height = 1;
+        }
+
+        updateSoundGeneration(inRange, state);
+      });
+  }
+
+private:
+  template<typename StateT>
+  void updateSoundGeneration(const bool inRange, StateT& state) {
+    if (inRange != state.mPlayerWasInRange) {
+      mpServiceProvider->playSound(data::SoundId::SlidingDoor);
+      state.mPlayerWasInRange = inRange;
+    }
+  }
+
+  ex::Entity mPlayerEntity;
+  IGameServiceProvider* mpServiceProvider;
+};
+
+
+struct EntityState {
+  bool operator==(const EntityState& rhs) const {
+    return
+      std::tie(
+        mId,
+        mPosition,
+        mBoundingBox,
+        mIsSolid,
+        mFrame,
+        mHorizontalDoorState,
+        mVerticalDoorState) ==
+      std::tie(
+        rhs.mId,
+        rhs.mPosition,
+        rhs.mBoundingBox,
+        rhs.mIsSolid,
+        rhs.mFrame,
+        rhs.mHorizontalDoorState,
+        rhs.mVerticalDoorState);
+  }
+
+  std::uint64_t mId;
+  std::optional<WorldPosition> mPosition;
+  std::optional<BoundingBox> mBoundingBox;
+  bool mIsSolid;
+  std::optional<int> mFrame;
+  std::optional<std::tuple<HorizontalSlidingDoor::State, bool, std::uint64_t>>
+    mHorizontalDoorState;
+  std::optional<std::tuple<VerticalSlidingDoor::State, bool, int>>
+    mVerticalDoorState;
+};
+
+
+template <typename T>
+std::optional<T> optionalComponent(ex::Entity entity) {
+  if (entity.has_component<T>()) {
+    return *entity.component<const T>();
+  }
+
+  return std::nullopt;
+}
+
+
+std::vector<EntityState> worldState(ex::EntityManager& es) {
+  std::vector<EntityState> result;
+  for (auto entity : es.entities_for_debugging()) {
+    auto state = EntityState{
+      entity.id().id(),
+      optionalComponent<WorldPosition>(entity),
+      optionalComponent<BoundingBox>(entity),
+      entity.has_component<SolidBody>(),
+      std::nullopt,
+      std::nullopt,
+      std::nullopt};
+
+    if (entity.has_component<Sprite>()) {
+      const auto& frames = entity.component<const Sprite>()->mFramesToRender;
+      if (!frames.empty()) {
+        state.mFrame = frames[0];
+      }
+    }
+
+    if (entity.has_component<HorizontalSlidingDoor>()) {
+      const auto& door = *entity.component<const HorizontalSlidingDoor>();
+      state.mHorizontalDoorState = std::make_tuple(
+        door.mState,
+        door.mPlayerWasInRange,
+        door.mCollisionHelper ? door.mCollisionHelper.id().id() : 0);
+    }
+
+    if (entity.has_component<VerticalSlidingDoor>()) {
+      const auto& door = *entity.component<const VerticalSlidingDoor>();
+      state.mVerticalDoorState =
+        std::make_tuple(door.mState, door.mPlayerWasInRange, door.mSlideStep);
+    }
+
+    result.push_back(state);
+  }
+
+  return result;
+}
+
+
+// Doors change their bounding box without having a MovingBody, so the
+// collision checker only sees that if the system tells it. Tests the rows
+// around each solid body against all bodies.
+bool collisionCheckerIsUpToDate(
+  const engine::CollisionChecker& checker,
+  const data::map::Map& map,
+  ex::EntityManager& es
+) {
+  std::vector<BoundingBox> solidAreas;
+  es.each<WorldPosition, BoundingBox, SolidBody>(
+    [&](
+      ex::Entity,
+      const WorldPosition& position,
+      const BoundingBox& bbox,
+      const SolidBody&
+    ) {
+      solidAreas.push_back(engine::toWorldSpace(bbox, position));
+    });
+
+  const auto mapRight = static_cast<int>(map.width()) - 1;
+  for (const auto& area : solidAreas) {
+    // Wide enough to cover the extent of a closed door while it's open
+    const auto left = std::max(area.left() - 6, 0);
+    const auto right = std::min(area.right() + 6, mapRight);
+    if (left > right) {
+      continue;
+    }
+
+    for (auto y = area.top() - 8; y <= area.bottom() + 8; ++y) {
+      const auto span = BoundingBox{{left, y}, {right - left + 1, 1}};
+      const auto expected = std::any_of(
+        solidAreas.begin(), solidAreas.end(), [&](const BoundingBox& other) {
+          return other.intersects(span);
+        });
+
+      auto rowAboveSpan = span;
+      rowAboveSpan.topLeft.y -= 1;
+      if (checker.isOnSolidGround(rowAboveSpan) != expected) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+class World {
+public:
+  World()
+    : mMap(60, 40, data::map::TileAttributeDict{{0x0}})
+    , mPlayer(mEntityx.entities.create())
+  {
+    mPlayer.assign<WorldPosition>(30, 20);
+  }
+
+  ex::Entity createDoor(const bool isHorizontal, const WorldPosition& pos) {
+    auto door = mEntityx.entities.create();
+    door.assign<WorldPosition>(pos);
+    assignDoorComponents(door, isHorizontal);
+    return door;
+  }
+
+  void assignDoorComponents(ex::Entity door, const bool isHorizontal) {
+    if (isHorizontal) {
+      door.assign<HorizontalSlidingDoor>();
+      door.assign<BoundingBox>(BoundingBox{{0, 0}, {6, 1}});
+      door.assign<Sprite>(nullptr, engine::FramesToRender{0});
+    } else {
+      door.assign<VerticalSlidingDoor>();
+      door.assign<BoundingBox>(BoundingBox{{0, 0}, {1, 8}});
+    }
+
+    door.assign<SolidBody>();
+  }
+
+  ex::EntityX mEntityx;
+  data::map::Map mMap;
+  ex::Entity mPlayer;
+  SoundCountingServiceProvider mServiceProvider;
+};
+
+
+/** Moves the player around and adds and removes doors
+ *
+ * With the same seed, identical worlds get the same modifications.
+ */
+class RandomModifications {
+public:
+  explicit RandomModifications(const unsigned seed)
+    : mRandomGenerator(seed)
+  {
+  }
+
+  void createRandomDoor(World& world) {
+    // Some doors are close enough to the map's edges for their range to
+    // extend past them
+    world.createDoor(
+      pick(2) == 0,
+      {pick(world.mMap.width() + 4) - 2, pick(world.mMap.height() + 4) - 2});
+  }
+
+  void apply(World& world) {
+    auto& playerPosition = *world.mPlayer.component<WorldPosition>();
+    auto doors = allDoors(world.mEntityx.entities);
+
+    switch (pick(40)) {
+      case 0:
+        // Jump to a random position, which might be outside of the map
+        playerPosition = {
+          pick(world.mMap.width() + 20) - 10,
+          pick(world.mMap.height() + 20) - 10};
+        break;
+
+      case 1:
+        if (!doors.empty()) {
+          // Jump right next to a door
+          const auto door = doors[pick(static_cast<int>(doors.size()))];
+          playerPosition =
+            *door.component<const WorldPosition>() +
+            base::Vector{pick(20) - 10, pick(14) - 7};
+        }
+        break;
+
+      case 2:
+        createRandomDoor(world);
+        break;
+
+      case 3:
+        if (!doors.empty()) {
+          doors[pick(static_cast<int>(doors.size()))].destroy();
+        }
+        break;
+
+      case 4:
+        if (!doors.empty()) {
+          // Reset the door's state by giving it new components
+          auto door = doors[pick(static_cast<int>(doors.size()))];
+          const auto isHorizontal = door.has_component<HorizontalSlidingDoor>();
+          door.remove<BoundingBox>();
+          door.remove<SolidBody>();
+          if (isHorizontal) {
+            door.remove<HorizontalSlidingDoor>();
+            door.remove<Sprite>();
+          } else {
+            door.remove<VerticalSlidingDoor>();
+          }
+
+          world.assignDoorComponents(door, pick(2) == 0);
+        }
+        break;
+
+      default:
+        // Most of the time, walk around
+        playerPosition += base::Vector{pick(3) - 1, pick(3) - 1};
+        break;
+    }
+  }
+
+private:
+  int pick(const int count) {
+    return std::uniform_int_distribution<int>{0, count - 1}(
+      mRandomGenerator);
+  }
+
+  static std::vector<ex::Entity> allDoors(ex::EntityManager& es) {
+    std::vector<ex::Entity> result;
+    for (auto entity : es.entities_for_debugging()) {
+      if (
+        entity.has_component<HorizontalSlidingDoor>() ||
+        entity.has_component<VerticalSlidingDoor>()
+      ) {
+        result.push_back(entity);
+      }
+    }
+
+    return result;
+  }
+
+  std::mt19937 mRandomGenerator;
+};
+
+}
+
+
+TEST_CASE("Sliding doors behave the same as when updating all of them") {
+  for (auto seed = 0u; seed < 5u; ++seed) {
+    World referenceWorld;
+    World world;
+    RandomModifications referenceModifications{seed};
+    RandomModifications modifications{seed};
+
+    // Most doors exist before the system is created
+    for (auto i = 0; i < 30; ++i) {
+      referenceModifications.createRandomDoor(referenceWorld);
+      modifications.createRandomDoor(world);
+    }
+
+    ReferenceSlidingDoorSystem referenceSystem{
+      referenceWorld.mPlayer, &referenceWorld.mServiceProvider};
+    SlidingDoorSystem system{
+      world.mPlayer,
+      &world.mServiceProvider,
+      world.mMap,
+      world.mEntityx.entities,
+      world.mEntityx.events};
+    engine::CollisionChecker checker{
+      &world.mMap, world.mEntityx.entities, world.mEntityx.events};
+
+    for (auto tick = 0; tick < 400; ++tick) {
+      referenceModifications.apply(referenceWorld);
+      modifications.apply(world);
+
+      referenceSystem.update(referenceWorld.mEntityx.entities);
+      system.update(world.mEntityx.entities);
+
+      REQUIRE(
+        worldState(world.mEntityx.entities) ==
+        worldState(referenceWorld.mEntityx.entities));
+      REQUIRE(
+        world.mServiceProvider.mNumSoundsPlayed ==
+        referenceWorld.mServiceProvider.mNumSoundsPlayed);
+      REQUIRE(collisionCheckerIsUpToDate(
+        checker, world.mMap, world.mEntityx.entities));
+    }
+  }
+}
@@ -0,0 +1,390 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <engine/sprite_draw_list.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+
+using namespace rigel;
+using namespace engine;
+using namespace engine::components;
+
+namespace ex = entityx;
+
+
+namespace {
+
+using SpriteEntityView = SpriteDrawList::SpriteEntityView;
+
+
+std::tuple<bool, int> sortKey(ex::Entity entity) {
+  const auto drawOrder = entity.has_component<OverrideDrawOrder>()
+    ? entity.component<const OverrideDrawOrder>()->mDrawOrder
+    : entity.component<const Sprite>()->mpDrawData->mDrawOrder;
+  return {entity.has_component<DrawTopMost>(), drawOrder};
+}
+
+
+bool isDrawable(ex::Entity entity) {
+  return
+    entity.valid() &&
+    entity.has_component<Sprite>() &&
+    entity.has_component<WorldPosition>();
+}
+
+
+void stableSortByKey(std::vector<ex::Entity>& entities) {
+  std::stable_sort(
+    entities.begin(),
+    entities.end(),
+    [](ex::Entity lhs, ex::Entity rhs) {
+      return sortKey(lhs) < sortKey(rhs);
+    });
+}
+
+
+// Draw list kept as a plain vector of entities, updated by linear search
+// and std::stable_sort
+class ReferenceDrawList {
+public:
+  void update(ex::EntityManager& es) {
+    mEntities.erase(
+      std::remove_if(mEntities.begin(), mEntities.end(),
+        [](ex::Entity entity) { return !isDrawable(entity); }),
+      mEntities.end());
+
+    es.each<Sprite, WorldPosition>(
+      [&](ex::Entity entity, const Sprite&, const WorldPosition&) {
+        const auto isListed = std::find(
+          mEntities.begin(), mEntities.end(), entity) != mEntities.end();
+        if (!isListed) {
+          mEntities.push_back(entity);
+        }
+      });
+
+    stableSortByKey(mEntities);
+  }
+
+  const std::vector<ex::Entity>& entities() const {
+    return mEntities;
+  }
+
+private:
+  std::vector<ex::Entity> mEntities;
+};
+
+
+std::vector<ex::Entity> listedEntities(const SpriteDrawList& list) {
+  std::vector<ex::Entity> result;
+  for (const auto& entry : list.entries()) {
+    result.push_back(entry.mEntity);
+  }
+
+  return result;
+}
+
+
+void checkEntriesAreCurrent(const SpriteDrawList& list) {
+  for (const auto& entry : list.entries()) {
+    REQUIRE(isDrawable(entry.mEntity));
+    CHECK(
+      std::make_tuple(entry.mDrawTopMost, entry.mDrawOrder) ==
+      sortKey(entry.mEntity));
+  }
+}
+
+
+struct DrawOrderRange {
+  int mMin;
+  int mMax;
+};
+
+
+class RandomSprites {
+public:
+  RandomSprites(
+    const unsigned seed,
+    const DrawOrderRange& range,
+    ex::EntityManager& es
+  )
+    : mRandomGenerator(seed)
+    , mRange(range)
+    , mEntities(es)
+  {
+    for (auto i = 0; i < 4; ++i) {
+      mDrawData[i].mDrawOrder = randomDrawOrder();
+    }
+  }
+
+  int pick(const int count) {
+    return std::uniform_int_distribution<int>{0, count - 1}(
+      mRandomGenerator);
+  }
+
+  int randomDrawOrder() {
+    // Use only a few distinct values most of the time, to get many sprites
+    // with equal draw order
+    if (pick(2) == 0) {
+      return mRange.mMin + pick(4);
+    }
+
+    return std::uniform_int_distribution<int>{mRange.mMin, mRange.mMax}(
+      mRandomGenerator);
+  }
+
+  void giveSprite(ex::Entity entity) {
+    entity.assign<Sprite>(&mDrawData[pick(4)], FramesToRender{});
+  }
+
+  ex::Entity create() {
+    auto entity = mEntities.create();
+    if (pick(10) < 8) {
+      giveSprite(entity);
+    }
+
+    if (pick(10) < 9) {
+      entity.assign<WorldPosition>(pick(32), pick(32));
+    }
+
+    if (pick(10) < 2) {
+      entity.assign<OverrideDrawOrder>(randomDrawOrder());
+    }
+
+    if (pick(10) < 2) {
+      entity.assign<DrawTopMost>();
+    }
+
+    return entity;
+  }
+
+  void modify(ex::Entity entity) {
+    switch (pick(6)) {
+      case 0:
+        entity.destroy();
+        break;
+
+      case 1:
+        if (entity.has_component<Sprite>()) {
+          entity.remove<Sprite>();
+        } else {
+          giveSprite(entity);
+        }
+        break;
+
+      case 2:
+        if (entity.has_component<WorldPosition>()) {
+          entity.remove<WorldPosition>();
+        } else {
+          entity.assign<WorldPosition>(0, 0);
+        }
+        break;
+
+      case 3:
+        if (entity.has_component<OverrideDrawOrder>()) {
+          entity.remove<OverrideDrawOrder>();
+        } else {
+          entity.assign<OverrideDrawOrder>(randomDrawOrder());
+        }
+        break;
+
+      case 4:
+        if (entity.has_component<DrawTopMost>()) {
+          entity.remove<DrawTopMost>();
+        } else {
+          entity.assign<DrawTopMost>();
+        }
+        break;
+
+      case 5:
+        // Changing the sprite's draw data doesn't emit any events
+        if (entity.has_component<Sprite>()) {
+          entity.component<Sprite>()->mpDrawData = &mDrawData[pick(4)];
+        }
+        break;
+    }
+  }
+
+private:
+  std::mt19937 mRandomGenerator;
+  DrawOrderRange mRange;
+  ex::EntityManager& mEntities;
+  SpriteDrawData mDrawData[4];
+};
+
+
+void testRandomChanges(const unsigned seed, const DrawOrderRange& range) {
+  ex::EntityX entityx;
+  auto& es = entityx.entities;
+  SpriteEntityView spriteEntities{entityx.events};
+  RandomSprites sprites{seed, range, es};
+
+  SpriteDrawList list;
+  ReferenceDrawList reference;
+
+  std::vector<ex::Entity> liveEntities;
+  for (auto i = 0; i < 40; ++i) {
+    liveEntities.push_back(sprites.create());
+  }
+
+  for (auto round = 0; round < 40; ++round) {
+    list.update(spriteEntities, es);
+    reference.update(es);
+
+    CHECK(listedEntities(list) == reference.entities());
+    checkEntriesAreCurrent(list);
+
+    const auto numChanges = sprites.pick(10);
+    for (auto i = 0; i < numChanges; ++i) {
+      if (sprites.pick(3) == 0) {
+        liveEntities.push_back(sprites.create());
+        continue;
+      }
+
+      if (liveEntities.empty()) {
+        continue;
+      }
+
+      const auto index = sprites.pick(static_cast<int>(liveEntities.size()));
+      sprites.modify(liveEntities[index]);
+      if (!liveEntities[index].valid()) {
+        liveEntities.erase(liveEntities.begin() + index);
+      }
+    }
+  }
+}
+
+
+void setDrawOrder(ex::Entity entity, const int drawOrder) {
+  if (entity.has_component<OverrideDrawOrder>()) {
+    entity.remove<OverrideDrawOrder>();
+  }
+
+  entity.assign<OverrideDrawOrder>(drawOrder);
+}
+
+
+// Gives all sprites new random sort keys, covering the given range exactly
+void assignRandomSortKeys(
+  std::vector<ex::Entity>& entities,
+  const DrawOrderRange& range,
+  std::mt19937& randomGenerator
+) {
+  std::uniform_int_distribution<int> drawOrder{range.mMin, range.mMax};
+  std::uniform_int_distribution<int> zeroToNine{0, 9};
+
+  for (auto& entity : entities) {
+    setDrawOrder(entity, drawOrder(randomGenerator));
+
+    const auto shouldBeTopMost = zeroToNine(randomGenerator) < 2;
+    if (shouldBeTopMost && !entity.has_component<DrawTopMost>()) {
+      entity.assign<DrawTopMost>();
+    } else if (!shouldBeTopMost && entity.has_component<DrawTopMost>()) {
+      entity.remove<DrawTopMost>();
+    }
+  }
+
+  setDrawOrder(entities.front(), range.mMin);
+  setDrawOrder(entities.back(), range.mMax);
+}
+
+
+void testSortOrder(const DrawOrderRange& range) {
+  std::mt19937 randomGenerator{42};
+
+  ex::EntityX entityx;
+  auto& es = entityx.entities;
+  SpriteEntityView spriteEntities{entityx.events};
+  SpriteDrawData drawData;
+
+  std::vector<ex::Entity> entities;
+  for (auto i = 0; i < 300; ++i) {
+    auto entity = es.create();
+    entity.assign<Sprite>(&drawData, FramesToRender{});
+    entity.assign<WorldPosition>(0, 0);
+    entities.push_back(entity);
+  }
+
+  assignRandomSortKeys(entities, range, randomGenerator);
+
+  // Initially, sprites with equal keys are drawn in entity index order
+  SpriteDrawList list;
+  list.update(spriteEntities, es);
+
+  auto expected = entities;
+  stableSortByKey(expected);
+  CHECK(listedEntities(list) == expected);
+  checkEntriesAreCurrent(list);
+
+  // After that, they keep the order from the previous update
+  for (auto round = 0; round < 5; ++round) {
+    assignRandomSortKeys(entities, range, randomGenerator);
+    list.update(spriteEntities, es);
+
+    stableSortByKey(expected);
+    CHECK(listedEntities(list) == expected);
+    checkEntriesAreCurrent(list);
+  }
+}
+
+}
+
+
+TEST_CASE("Sprite draw list matches a stable sorted list of entities") {
+  SECTION("Small draw order range") {
+    for (auto seed = 0u; seed < 20u; ++seed) {
+      testRandomChanges(seed, {-20, 300});
+    }
+  }
+
+  SECTION("Draw order range too large for the counting sort") {
+    for (auto seed = 0u; seed < 20u; ++seed) {
+      testRandomChanges(seed, {-10000, 10000});
+    }
+  }
+}
+
+
+TEST_CASE("Sprite draw list is sorted like std::stable_sort") {
+  SECTION("All sprites have the same draw order") {
+    testSortOrder({7, 7});
+  }
+
+  SECTION("Small draw order range") {
+    testSortOrder({-3, 12});
+  }
+
+  SECTION("Largest range handled by the counting sort") {
+    testSortOrder({-2000, 2095});
+  }
+
+  SECTION("Smallest range handled by std::stable_sort") {
+    testSortOrder({-2000, 2096});
+  }
+
+  SECTION("Very large draw order range") {
+    testSortOrder({-1000000, 1000000});
+  }
+}
@@ -0,0 +1,116 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/static_vector.hpp>
+#include <base/warnings.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+using namespace rigel;
+using namespace base;
+
+
+TEST_CASE("Static vector") {
+  using Vector = StaticVector<int, 4>;
+
+  static_assert(std::is_trivially_copyable_v<Vector>);
+  static_assert(Vector::capacity() == 4);
+
+  SECTION("Starts out empty") {
+    Vector vector;
+    CHECK(vector.empty());
+    CHECK(vector.size() == 0);
+    CHECK(vector.begin() == vector.end());
+  }
+
+  SECTION("Elements can be added and removed") {
+    Vector vector;
+    vector.push_back(1);
+    vector.push_back(2);
+    vector.push_back(3);
+
+    CHECK(vector.size() == 3);
+    CHECK(vector[0] == 1);
+    CHECK(vector[2] == 3);
+    CHECK(vector.back() == 3);
+
+    vector.pop_back();
+    CHECK(vector.size() == 2);
+    CHECK(vector.back() == 2);
+
+    vector.clear();
+    CHECK(vector.empty());
+  }
+
+  SECTION("Can be constructed from a list or a range") {
+    const Vector fromList{1, 2, 3};
+    const auto elements = std::vector<int>{1, 2, 3};
+    const Vector fromRange(elements.begin(), elements.end());
+
+    CHECK(fromList == fromRange);
+    CHECK(std::vector<int>(fromList.begin(), fromList.end()) == elements);
+  }
+
+  SECTION("Compares elements, not capacity") {
+    Vector vector{1, 2};
+    Vector other{1, 2};
+    CHECK(vector == other);
+
+    other.push_back(3);
+    CHECK(vector != other);
+
+    other.pop_back();
+    CHECK(vector == other);
+  }
+
+  SECTION("Copies are independent") {
+    Vector vector{1, 2};
+    auto copy = vector;
+    copy[0] = 5;
+    copy.push_back(3);
+
+    CHECK((vector == Vector{1, 2}));
+    CHECK((copy == Vector{5, 2, 3}));
+  }
+
+  SECTION("Can be filled up to capacity") {
+    Vector vector;
+    for (auto i = 0; i < 4; ++i) {
+      vector.push_back(i);
+    }
+
+    CHECK(vector.size() == vector.capacity());
+    CHECK(vector.back() == 3);
+
+    SECTION("Adding more elements throws and leaves the vector unchanged") {
+      CHECK_THROWS_AS(vector.push_back(4), const std::length_error&);
+      CHECK((vector == Vector{0, 1, 2, 3}));
+    }
+  }
+
+  SECTION("Constructing from too many elements throws") {
+    const auto elements = std::vector<int>{1, 2, 3, 4, 5};
+    CHECK_THROWS_AS(
+      Vector(elements.begin(), elements.end()), const std::length_error&);
+  }
+}
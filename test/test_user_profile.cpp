@@ -0,0 +1,234 @@
+/* Copyright (C) 2016, Nikolai Wuttke. All rights reserved.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <base/warnings.hpp>
+#include <common/user_profile.hpp>
+
+RIGEL_DISABLE_WARNINGS
+#include <catch.hpp>
+#include <nlohmann/json.hpp>
+RIGEL_RESTORE_WARNINGS
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+using namespace rigel;
+using namespace data;
+
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+/** Builds a profile the way earlier versions stored it, via nlohmann::json
+ *
+ * Mirrors the serialization code that was in use before the profile was
+ * written with loader::MsgPackWriter.
+ */
+json serializeLikeEarlierVersions(const UserProfile& profile) {
+  auto saveSlots = json::array();
+  for (const auto& slot : profile.mSaveSlots) {
+    if (!slot) {
+      saveSlots.push_back(nullptr);
+      continue;
+    }
+
+    const char* DIFFICULTY_NAMES[] = {"Easy", "Medium", "Hard"};
+    const char* WEAPON_NAMES[] = {"Normal", "Laser", "Rocket", "FlameThrower"};
+    const char* TUTORIAL_MESSAGE_NAMES[] = {
+      "FoundRapidFire", "FoundHealthMolecule", "FoundRegularWeapon",
+      "FoundLaser", "FoundFlameThrower", "FoundRocketLauncher", "EarthQuake",
+      "FoundBlueKey", "FoundAccessCard", "FoundSpaceShip", "FoundLetterN",
+      "FoundLetterU", "FoundLetterK", "FoundLetterE", "KeyNeeded",
+      "AccessCardNeeded", "CloakNeeded", "RadarsStillFunctional",
+      "HintGlobeNeeded", "FoundTurboLift", "FoundTeleporter",
+      "LettersCollectedRightOrder", "FoundSoda", "FoundForceField",
+      "FoundDoor"};
+
+    auto messages = json::array();
+    for (int i = 0; i < NUM_TUTORIAL_MESSAGES; ++i) {
+      const auto id = static_cast<TutorialMessageId>(i);
+      if (slot->mTutorialMessagesAlreadySeen.hasBeenShown(id)) {
+        messages.push_back(TUTORIAL_MESSAGE_NAMES[i]);
+      }
+    }
+
+    json serialized;
+    serialized["episode"] = slot->mSessionId.mEpisode;
+    serialized["level"] = slot->mSessionId.mLevel;
+    serialized["difficulty"] =
+      DIFFICULTY_NAMES[static_cast<int>(slot->mSessionId.mDifficulty)];
+    serialized["tutorialMessagesAlreadySeen"] = messages;
+    serialized["name"] = slot->mName;
+    serialized["weapon"] = WEAPON_NAMES[static_cast<int>(slot->mWeapon)];
+    serialized["ammo"] = slot->mAmmo;
+    serialized["score"] = slot->mScore;
+    saveSlots.push_back(serialized);
+  }
+
+  auto highScoreLists = json::array();
+  for (const auto& list : profile.mHighScoreLists) {
+    auto serializedList = json::array();
+    for (const auto& entry : list) {
+      serializedList.push_back(
+        {{"name", entry.mName}, {"score", entry.mScore}});
+    }
+
+    highScoreLists.push_back(serializedList);
+  }
+
+  json serializedProfile;
+  serializedProfile["saveSlots"] = saveSlots;
+  serializedProfile["highScoreLists"] = highScoreLists;
+  return serializedProfile;
+}
+
+
+void fillWithTestData(UserProfile& profile) {
+  SavedGame first;
+  first.mSessionId = GameSessionId{1, 4, Difficulty::Hard};
+  first.mTutorialMessagesAlreadySeen.markAsShown(
+    TutorialMessageId::FoundRapidFire);
+  first.mTutorialMessagesAlreadySeen.markAsShown(TutorialMessageId::FoundDoor);
+  first.mName = "Long name with spaces";
+  first.mWeapon = WeaponType::FlameThrower;
+  first.mAmmo = 64;
+  first.mScore = 123456;
+
+  SavedGame second;
+  second.mSessionId = GameSessionId{3, 7, Difficulty::Easy};
+  second.mName = "X";
+  second.mWeapon = WeaponType::Laser;
+  second.mAmmo = 20;
+  second.mScore = 90;
+
+  profile.mSaveSlots[0] = first;
+  profile.mSaveSlots[5] = second;
+
+  for (auto episode = 0; episode < NUM_EPISODES; ++episode) {
+    auto& list = profile.mHighScoreLists[episode];
+    for (std::size_t i = 0; i < list.size(); ++i) {
+      // Highest score first, like the lists come out of loading
+      list[i].mName = "Player " + std::to_string(episode * 100 + i);
+      list[i].mScore = static_cast<int>(
+        (list.size() - i) * 70000 + episode);
+    }
+  }
+}
+
+
+void checkEqual(const UserProfile& actual, const UserProfile& expected) {
+  for (std::size_t i = 0; i < expected.mSaveSlots.size(); ++i) {
+    INFO(i);
+
+    const auto& actualSlot = actual.mSaveSlots[i];
+    const auto& expectedSlot = expected.mSaveSlots[i];
+    REQUIRE(actualSlot.has_value() == expectedSlot.has_value());
+    if (!expectedSlot) {
+      continue;
+    }
+
+    CHECK(actualSlot->mSessionId.mEpisode == expectedSlot->mSessionId.mEpisode);
+    CHECK(actualSlot->mSessionId.mLevel == expectedSlot->mSessionId.mLevel);
+    CHECK(
+      actualSlot->mSessionId.mDifficulty ==
+      expectedSlot->mSessionId.mDifficulty);
+    CHECK(actualSlot->mName == expectedSlot->mName);
+    CHECK(actualSlot->mWeapon == expectedSlot->mWeapon);
+    CHECK(actualSlot->mAmmo == expectedSlot->mAmmo);
+    CHECK(actualSlot->mScore == expectedSlot->mScore);
+
+    for (int id = 0; id < NUM_TUTORIAL_MESSAGES; ++id) {
+      const auto messageId = static_cast<TutorialMessageId>(id);
+      CHECK(
+        actualSlot->mTutorialMessagesAlreadySeen.hasBeenShown(messageId) ==
+        expectedSlot->mTutorialMessagesAlreadySeen.hasBeenShown(messageId));
+    }
+  }
+
+  CHECK(actual.mHighScoreLists == expected.mHighScoreLists);
+}
+
+
+std::vector<std::uint8_t> readFile(const fs::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<std::uint8_t>{
+    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+
+void writeFile(const fs::path& path, const std::vector<std::uint8_t>& buffer) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+}
+
+}
+
+
+TEST_CASE("User profiles stay compatible with earlier versions") {
+  const auto profilePath =
+    fs::temp_directory_path() / "rigel_test_user_profile.rigel";
+
+  UserProfile expected;
+  fillWithTestData(expected);
+  const auto earlierVersionData =
+    json::to_msgpack(serializeLikeEarlierVersions(expected));
+
+  SECTION("Profiles written by earlier versions can be loaded") {
+    writeFile(profilePath, earlierVersionData);
+
+    UserProfile profile{profilePath.u8string()};
+    profile.loadFromDisk();
+
+    checkEqual(profile, expected);
+  }
+
+  SECTION("Saved profiles are identical to what earlier versions wrote") {
+    {
+      UserProfile profile{profilePath.u8string()};
+      fillWithTestData(profile);
+      profile.saveToDisk();
+
+      // Destroying the profile waits for the write to finish
+    }
+
+    CHECK(readFile(profilePath) == earlierVersionData);
+  }
+
+  SECTION("Saved profiles can be loaded again") {
+    {
+      UserProfile profile{profilePath.u8string()};
+      fillWithTestData(profile);
+      profile.saveToDisk();
+    }
+
+    UserProfile profile{profilePath.u8string()};
+    profile.loadFromDisk();
+
+    checkEqual(profile, expected);
+  }
+
+  std::error_code ignored;
+  fs::remove(profilePath, ignored);
+}